@@ -14,10 +14,20 @@ FIND_PATH(OPENJPEG_INCLUDE_DIR openjpeg.h
 /usr/local/include
 /usr/include/openjpeg
 /usr/include/openjpeg-1.5
+/usr/local/include/openjpeg-2.1
+/usr/include/openjpeg-2.1
+/usr/local/include/openjpeg-2.2
+/usr/include/openjpeg-2.2
+/usr/local/include/openjpeg-2.3
+/usr/include/openjpeg-2.3
+/usr/local/include/openjpeg-2.4
+/usr/include/openjpeg-2.4
+/usr/local/include/openjpeg-2.5
+/usr/include/openjpeg-2.5
 /usr/include
 )
 
-SET(OPENJPEG_NAMES ${OPENJPEG_NAMES} openjpeg)
+SET(OPENJPEG_NAMES ${OPENJPEG_NAMES} openjpeg openjp2)
 FIND_LIBRARY(OPENJPEG_LIBRARY
   NAMES ${OPENJPEG_NAMES}
   PATHS /usr/lib /usr/local/lib
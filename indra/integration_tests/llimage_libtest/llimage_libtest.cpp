@@ -43,9 +43,12 @@
 #include "v4coloru.h"
 #include "llsdserialize.h"
 #include "llcleanup.h"
+#include "lltimer.h"
 
 // system libraries
 #include <iostream>
+#include <thread>
+#include <vector>
 
 // doc string provided when invoking the program with --help 
 static const char USAGE[] = "\n"
@@ -97,6 +100,10 @@ static const char USAGE[] = "\n"
 "        Results in <metric>_report.csv\n"
 " -s, --image-stats\n"
 "        Output stats for each input and output image.\n"
+" -bench, --benchmark <n>\n"
+"        Decode each j2c input <n> times with 1, 2, 4... threads per image, up to the\n"
+"        number of cores, and print the throughput in megapixels per second.\n"
+"        Honors --discard_level. Only valid for j2c images.\n"
 "\n";
 
 // true when all image loading is done. Used by metric logging thread to know when to stop the thread.
@@ -192,6 +199,71 @@ LLPointer<LLImageRaw> load_image(const std::string &src_filename, int discard_le
 	return raw_image;
 }
 
+// Decode a j2c file over and over with more and more threads per image and report the throughput.
+// Every thread count has to decode to the same pixels as a single thread.
+void benchmark_decode(const std::string &src_filename, int discard_level, int iterations)
+{
+	LLPointer<LLImageFormatted> image = create_image(src_filename);
+	if (image->getCodec() != IMG_CODEC_J2C)
+	{
+		std::cout << "Benchmark only applies to j2c images, skipping " << src_filename << std::endl;
+		return;
+	}
+	if (!image->load(src_filename))
+	{
+		std::cout << "Error: Image " << src_filename << " could not be loaded" << std::endl;
+		return;
+	}
+
+	const int max_threads = llmax((int)std::thread::hardware_concurrency(), 1);
+	std::vector<U8> reference;
+	for (int threads = 1; ; threads = llmin(threads * 2, max_threads))
+	{
+		LLImageJ2C::setDecodeThreads(threads);
+		F64 megapixels = 0.0;
+		LLTimer timer;
+		for (int i = 0; i < iterations; ++i)
+		{
+			LLPointer<LLImageRaw> raw_image = new LLImageRaw;
+			if (discard_level != -1)
+			{
+				((LLImageJ2C*)(image.get()))->initDecode(*raw_image, discard_level, NULL);
+			}
+			if (!image->decode(raw_image, 0.0f))
+			{
+				std::cout << "Error: Image " << src_filename << " could not be decoded" << std::endl;
+				LLImageJ2C::setDecodeThreads(0);
+				return;
+			}
+			if (i == 0)
+			{
+				const U8* data = raw_image->getData();
+				if (reference.empty())
+				{
+					reference.assign(data, data + raw_image->getDataSize());
+				}
+				else if (reference.size() != (size_t)raw_image->getDataSize()
+						 || memcmp(&reference[0], data, reference.size()))
+				{
+					std::cout << "Error: Image " << src_filename << " decodes differently with " << threads << " threads" << std::endl;
+					LLImageJ2C::setDecodeThreads(0);
+					return;
+				}
+			}
+			megapixels += raw_image->getWidth() * raw_image->getHeight() / 1.0e6;
+		}
+		F64 seconds = timer.getElapsedTimeF64().value();
+		std::cout << src_filename << " : " << threads << " thread(s), "
+				  << megapixels / seconds << " MP/s, "
+				  << seconds * 1.0e3 / iterations << " ms per decode" << std::endl;
+		if (threads == max_threads)
+		{
+			break;
+		}
+	}
+	LLImageJ2C::setDecodeThreads(0);
+}
+
 // Save a raw image instance into a file
 bool save_image(const std::string &dest_filename, LLPointer<LLImageRaw> raw_image, int blocks_size, int precincts_size, int levels, bool reversible, bool output_stats)
 {
@@ -356,6 +428,7 @@ int main(int argc, char** argv)
 	int blocks_size = -1;
 	int levels = 0;
 	bool reversible = false;
+	int bench_iterations = 0;
     std::string filter_name = "";
 
 	// Init whatever is necessary
@@ -557,6 +630,22 @@ int main(int argc, char** argv)
 		{
 			image_stats = true;
 		}
+		else if (!strcmp(argv[arg], "--benchmark") || !strcmp(argv[arg], "-bench"))
+		{
+			std::string value_str;
+			if ((arg + 1) < argc)
+			{
+				value_str = argv[arg+1];
+			}
+			if (((arg + 1) >= argc) || (value_str[0] == '-'))
+			{
+				std::cout << "No valid --benchmark argument given, no benchmark will be run" << std::endl;
+			}
+			else
+			{
+				bench_iterations = atoi(value_str.c_str());
+			}
+		}
 	}
 		
 	// Check arguments consistency. Exit with proper message if inconsistent.
@@ -590,6 +679,11 @@ int main(int argc, char** argv)
 	std::list<std::string>::iterator out_end = output_filenames.end();
 	for (; in_file != in_end; ++in_file, ++out_file)
 	{
+		if (bench_iterations > 0)
+		{
+			benchmark_decode(*in_file, discard_level, bench_iterations);
+		}
+
 		// Load file
 		LLPointer<LLImageRaw> raw_image = load_image(*in_file, discard_level, region, load_size, image_stats);
 		if (!raw_image)
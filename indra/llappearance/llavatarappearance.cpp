@@ -201,6 +201,7 @@ void LLAvatarAppearance::initInstance()
 	//-------------------------------------------------------------------------
 	mRoot = createAvatarJoint();
 	mRoot->setName( "mRoot" );
+	mRoot->compileSkeleton();
 
 	const auto& mesh_entries = LLAvatarAppearanceDictionary::getInstance()->getMeshEntries();
 	for (const auto& mesh : mesh_entries)
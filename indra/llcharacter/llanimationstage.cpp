@@ -0,0 +1,79 @@
+/**
+ * @file llanimationstage.cpp
+ * @brief Evaluates the poses of many characters over several threads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llanimationstage.h"
+
+#include "llcharacter.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	const U32 CHARACTERS_PER_RUN = 4;	// fewer are not worth a thread
+}
+
+void LLAnimationStage::evaluate(U32 runs)
+{
+	if (mCharacters.empty())
+	{
+		return;
+	}
+	runs = llclamp(runs, 1U, getCount());
+
+	// Characters differ a lot in cost, with their motions and joint
+	// counts, so rather than splitting them evenly each run takes the next
+	// one left.
+	std::atomic<U32> next(0);
+	auto evaluate_run = [this, &next](U32)
+	{
+		const U32 count = getCount();
+		for (U32 i = next++; i < count; i = next++)
+		{
+			mCharacters[i]->evaluatePose();
+		}
+	};
+
+	if (runs > 1 && !mThreads)
+	{
+		mThreads = std::make_unique<LLThreadTeam>();
+	}
+	if (mThreads)
+	{
+		mThreads->run(runs, evaluate_run);
+	}
+	else
+	{
+		evaluate_run(0);
+	}
+}
+
+U32 LLAnimationStage::getDefaultRuns() const
+{
+	const U32 cores = llmax(std::thread::hardware_concurrency(), 1U);
+	return llclamp(getCount() / CHARACTERS_PER_RUN, 1U, cores);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file llanimationstage.h
+ * @brief Evaluates the poses of many characters over several threads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLANIMATIONSTAGE_H
+#define LL_LLANIMATIONSTAGE_H
+
+#include "stdtypes.h"
+#include "llthreadteam.h"
+
+#include <memory>
+#include <vector>
+
+class LLCharacter;
+
+// The part of a frame where the characters' poses are evaluated. Each
+// character is added once the main thread has begun its update with
+// LLCharacter::beginUpdateMotions(). evaluate() then runs
+// LLCharacter::evaluatePose() for all of them, threads taking the next
+// character not yet taken until none are left, and returns once all are
+// done. Ending each update with LLCharacter::endUpdateMotions() is again
+// the main thread's job.
+class LLAnimationStage
+{
+public:
+	void add(LLCharacter* character)		{ mCharacters.push_back(character); }
+
+	// Evaluates every character added over runs threads, the calling
+	// thread taking one of them. The other threads are started once and
+	// kept waiting for the next frame.
+	void evaluate(U32 runs);
+	// A run count for evaluate() suited to the character count and cores.
+	U32 getDefaultRuns() const;
+
+	void clear()							{ mCharacters.clear(); }
+	bool empty() const						{ return mCharacters.empty(); }
+	U32 getCount() const					{ return (U32)mCharacters.size(); }
+
+private:
+	std::vector<LLCharacter*> mCharacters;
+	// Started on the first evaluate() over more than one run, and kept
+	std::unique_ptr<LLThreadTeam> mThreads;
+};
+
+#endif // LL_LLANIMATIONSTAGE_H
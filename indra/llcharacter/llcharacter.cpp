@@ -50,7 +50,9 @@ LLCharacter::LLCharacter()
 	mPreferredPelvisHeight( 0.f ),
 	mSex( SEX_FEMALE ),
 	mAppearanceSerialNum( 0 ),
-	mSkeletonSerialNum( 0 )
+	mSkeletonSerialNum( 0 ),
+	mEvaluatingMotions( false ),
+	mVisualParamsRequested( false )
 {
 	llassert_always(sAllowInstancesChange) ;
 	sInstances.push_back(this);
@@ -193,6 +195,16 @@ static LLTrace::BlockTimerStatHandle FTM_UPDATE_HIDDEN_ANIMATION("Update Hidden
 static LLTrace::BlockTimerStatHandle FTM_UPDATE_MOTIONS("Update Motions");
 
 void LLCharacter::updateMotions(e_update_t update_type)
+{
+	beginUpdateMotions(update_type);
+	evaluateMotions();
+	endUpdateMotions();
+}
+
+//-----------------------------------------------------------------------------
+// beginUpdateMotions()
+//-----------------------------------------------------------------------------
+void LLCharacter::beginUpdateMotions(e_update_t update_type)
 {
 	if (update_type == HIDDEN_UPDATE)
 	{
@@ -208,10 +220,48 @@ void LLCharacter::updateMotions(e_update_t update_type)
 			mMotionController.unpauseAllMotions();
 		}
 		bool force_update = (update_type == FORCE_UPDATE);
-		{
-			LL_RECORD_BLOCK_TIME(FTM_UPDATE_MOTIONS);
-			mMotionController.updateMotions(force_update);
-		}
+		mMotionController.prepareMotions(force_update);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+//-----------------------------------------------------------------------------
+void LLCharacter::evaluateMotions()
+{
+	LL_RECORD_BLOCK_TIME(FTM_UPDATE_MOTIONS);
+	mEvaluatingMotions = true;
+	mMotionController.evaluateMotions();
+	mEvaluatingMotions = false;
+}
+
+//-----------------------------------------------------------------------------
+// endUpdateMotions()
+//-----------------------------------------------------------------------------
+bool LLCharacter::endUpdateMotions()
+{
+	mMotionController.finishMotions();
+	if (!mVisualParamsRequested)
+	{
+		return false;
+	}
+	mVisualParamsRequested = false;
+	updateVisualParams();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// requestUpdateVisualParams()
+//-----------------------------------------------------------------------------
+void LLCharacter::requestUpdateVisualParams()
+{
+	if (mEvaluatingMotions)
+	{
+		mVisualParamsRequested = true;
+	}
+	else
+	{
+		updateVisualParams();
 	}
 }
 
@@ -120,6 +120,10 @@ public:
 	// updates all visual parameters for this character
 	virtual void updateVisualParams();
 
+	// Motions call this rather than updateVisualParams(). While motions are
+	// being evaluated the update waits for endUpdateMotions().
+	void requestUpdateVisualParams();
+
 	virtual void addDebugText( const std::string& text ) = 0;
 
 	virtual const LLUUID&	getID() const = 0;
@@ -158,6 +162,20 @@ public:
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
 	void updateMotions(e_update_t update_type);
 
+	// updateMotions() in three steps, for updating many characters at once.
+	// beginUpdateMotions() and endUpdateMotions() belong to the main thread.
+	// evaluatePose() touches nothing but this character, its motions and its
+	// joints, so different characters may evaluate on different threads in
+	// between. What motions ask of the character while evaluating, such as
+	// stop requests and visual param updates, waits for endUpdateMotions(),
+	// which returns whether visual params were updated.
+	void beginUpdateMotions(e_update_t update_type);
+	void evaluateMotions();
+	bool endUpdateMotions();
+	// Evaluates the motions. Characters that also place their joints as
+	// part of their update extend it.
+	virtual void evaluatePose() { evaluateMotions(); }
+
 	LLAnimPauseRequest requestPause();
 	BOOL areAnimationsPaused() const { return mMotionController.isPaused(); }
 	void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
@@ -296,6 +314,9 @@ protected:
 	U32					mSkeletonSerialNum;
 	LLAnimPauseRequest	mPauseRequest;
 
+	bool				mEvaluatingMotions;
+	bool				mVisualParamsRequested;
+
 private:
 #if USE_LL_APPEARANCE_CODE
 	// visual parameter stuff
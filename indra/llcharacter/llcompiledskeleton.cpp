@@ -0,0 +1,182 @@
+/**
+ * @file llcompiledskeleton.cpp
+ * @brief A joint tree flattened into arrays, for world matrix updates
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llcompiledskeleton.h"
+
+#include "lljoint.h"
+
+#include <algorithm>
+
+LLCompiledSkeleton::LLCompiledSkeleton(LLJoint* root)
+:	mRoot(root),
+	mDirty(true)
+{
+}
+
+void LLCompiledSkeleton::compile()
+{
+	mJoints.clear();
+	mParents.clear();
+	mSubtreeEnds.clear();
+	mDirty = false;
+
+	if (mRoot)
+	{
+		addJoint(mRoot, -1);
+	}
+
+	const size_t count = mJoints.size();
+	mFrames.resize(count);
+	mWorldRotations.resize(count);
+	mChildScales.resize(count);
+}
+
+void LLCompiledSkeleton::addJoint(LLJoint* joint, S32 parent)
+{
+	const S32 index = getJointCount();
+	mJoints.push_back(joint);
+	mParents.push_back(parent);
+	mSubtreeEnds.push_back(index + 1);
+
+	for (LLJoint* child : joint->mChildren)
+	{
+		if (child)
+		{
+			addJoint(child, index);
+		}
+	}
+	mSubtreeEnds[index] = getJointCount();
+}
+
+S32 LLCompiledSkeleton::getJointIndex(const LLJoint* joint) const
+{
+	auto iter = std::find(mJoints.begin(), mJoints.end(), joint);
+	return iter != mJoints.end() ? (S32)(iter - mJoints.begin()) : -1;
+}
+
+void LLCompiledSkeleton::updateWorldMatrices()
+{
+	if (mDirty)
+	{
+		compile();
+	}
+	if (mJoints.empty() || !mJoints[0]->mUpdateXform)
+	{
+		return;
+	}
+
+	// The root may be placed relative to something that is not a joint,
+	// such as an object sat on, so it is updated on its own
+	mJoints[0]->updateWorldMatrix();
+	loadWorldTransform(0);
+
+	const S32 count = getJointCount();
+	for (S32 i = 1; i < count;)
+	{
+		LLJoint* joint = mJoints[i];
+		if (!joint->mUpdateXform)
+		{
+			i = mSubtreeEnds[i];
+			continue;
+		}
+		if (!(joint->mDirtyFlags & LLJoint::MATRIX_DIRTY))
+		{
+			loadWorldTransform(i++);
+			continue;
+		}
+
+		LLXformMatrix* xform = joint->getXform();
+		const S32 parent = mParents[i];
+
+		// As LLXformMatrix::update() places it, the offset scaled by the
+		// parent and rotated into its frame
+		LLVector4a offset;
+		offset.load3(xform->getPosition().mV);
+		offset.mul(mChildScales[parent]);
+		LLVector4a world_pos;
+		mFrames[parent].affineTransform(offset, world_pos);
+
+		LLQuaternion2& world_rot = mWorldRotations[i];
+		world_rot = xform->getRotation();
+		world_rot.mul(mWorldRotations[parent]);
+
+		LLMatrix4a& frame = mFrames[i];
+		frame = LLMatrix4a(world_rot);
+		frame.setRow<3>(world_pos);
+		setChildScale(i);
+
+		// The world matrix is the frame with the joint's own scale, as
+		// LLMatrix4::initAll() makes it
+		LLVector4a scale;
+		scale.load3(xform->getScale().mV);
+		LLVector4a sx, sy, sz;
+		sx.splat<0>(scale);
+		sy.splat<1>(scale);
+		sz.splat<2>(scale);
+		sx.mul(frame.getRow<0>());
+		sy.mul(frame.getRow<1>());
+		sz.mul(frame.getRow<2>());
+
+		LLMatrix4 world_mat;
+		_mm_storeu_ps(world_mat.mMatrix[0], sx);
+		_mm_storeu_ps(world_mat.mMatrix[1], sy);
+		_mm_storeu_ps(world_mat.mMatrix[2], sz);
+		_mm_storeu_ps(world_mat.mMatrix[3], world_pos);
+		LLQuaternion rot;
+		_mm_storeu_ps(rot.mQ, world_rot.getVector4a());
+		xform->setWorldTransform(LLVector3(world_pos.getF32ptr()), rot, world_mat);
+
+		LLJoint::sNumUpdates++;
+		joint->mDirtyFlags = 0x0;
+		++i;
+	}
+}
+
+void LLCompiledSkeleton::loadWorldTransform(S32 index)
+{
+	const LLXformMatrix* xform = mJoints[index]->getXform();
+	mWorldRotations[index] = xform->getWorldRotation();
+
+	LLVector4a world_pos;
+	world_pos.load3(xform->getWorldPosition().mV, 1.f);
+	mFrames[index] = LLMatrix4a(mWorldRotations[index]);
+	mFrames[index].setRow<3>(world_pos);
+	setChildScale(index);
+}
+
+void LLCompiledSkeleton::setChildScale(S32 index)
+{
+	LLXformMatrix* xform = mJoints[index]->getXform();
+	if (xform->getScaleChildOffset())
+	{
+		mChildScales[index].load3(xform->getScale().mV);
+	}
+	else
+	{
+		mChildScales[index].splat(1.f);
+	}
+}
@@ -0,0 +1,90 @@
+/**
+ * @file llcompiledskeleton.h
+ * @brief A joint tree flattened into arrays, for world matrix updates
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLCOMPILEDSKELETON_H
+#define LL_LLCOMPILEDSKELETON_H
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+
+#include <vector>
+
+class LLJoint;
+
+// The joints under a root numbered depth first, so every joint comes after
+// its parent and the joints under it follow it in one run. Parents are
+// kept as indices in a flat array, and the world frame and rotation of each
+// joint in arrays alongside, so updating the world matrices is one pass
+// over the arrays in order rather than a walk of the tree. The joints stay
+// the owners of their transforms: local values are read from them and the
+// world values written back, so the LLJoint getters keep working.
+class LLCompiledSkeleton
+{
+public:
+	// Compiled on the first update
+	explicit LLCompiledSkeleton(LLJoint* root);
+
+	// Numbers the joints under the root, the root being joint 0
+	void compile();
+	// The tree changed, compile again on the next update
+	void setDirty()							{ mDirty = true; }
+	bool isDirty() const					{ return mDirty; }
+
+	// Updates the world matrix of every dirty joint, as
+	// root->updateWorldMatrixChildren() would. Joints with mUpdateXform
+	// off are skipped along with the joints under them.
+	void updateWorldMatrices();
+
+	S32 getJointCount() const				{ return (S32)mJoints.size(); }
+	LLJoint* getJoint(S32 index) const		{ return mJoints[index]; }
+	// -1 for the root
+	S32 getParentIndex(S32 index) const		{ return mParents[index]; }
+	// One past the last joint under index
+	S32 getSubtreeEnd(S32 index) const		{ return mSubtreeEnds[index]; }
+	// Linear, or -1 when joint is not in the skeleton
+	S32 getJointIndex(const LLJoint* joint) const;
+
+private:
+	void addJoint(LLJoint* joint, S32 parent);
+	// Takes the world transform a joint already has
+	void loadWorldTransform(S32 index);
+	void setChildScale(S32 index);
+
+	LLJoint* mRoot;
+	std::vector<LLJoint*> mJoints;
+	std::vector<S32> mParents;
+	std::vector<S32> mSubtreeEnds;
+
+	// World rotation and position of each joint without its own scale,
+	// the frame its children are placed in
+	std::vector<LLMatrix4a> mFrames;
+	std::vector<LLQuaternion2> mWorldRotations;
+	// Each joint's scale where it scales the offsets of its children
+	std::vector<LLVector4a> mChildScales;
+
+	bool mDirty;
+};
+
+#endif // LL_LLCOMPILEDSKELETON_H
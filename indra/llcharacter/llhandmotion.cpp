@@ -104,7 +104,7 @@ BOOL LLHandMotion::onActivate()
 			mCharacter->setVisualParamWeight(gHandPoseNames[i], 0.f);
 		}
 		mCharacter->setVisualParamWeight(gHandPoseNames[mCurrentPose], 1.f);
-		mCharacter->updateVisualParams();
+		mCharacter->requestUpdateVisualParams();
 	}
 	return TRUE;
 }
@@ -146,7 +146,7 @@ BOOL LLHandMotion::onUpdate(F32 time, U8* joint_mask)
 			// Update visual params now if we won't blend
 			if (mCurrentPose == HAND_POSE_RELAXED)
 			{
-				mCharacter->updateVisualParams();
+				mCharacter->requestUpdateVisualParams();
 			}
 		}
 		mNewPose = HAND_POSE_RELAXED;
@@ -179,7 +179,7 @@ BOOL LLHandMotion::onUpdate(F32 time, U8* joint_mask)
 				// Update visual params now if we won't blend
 				if (mCurrentPose == *requestedHandPose)
 				{
-					mCharacter->updateVisualParams();
+					mCharacter->requestUpdateVisualParams();
 				}
 			}
 			mNewPose = *requestedHandPose;
@@ -218,7 +218,7 @@ BOOL LLHandMotion::onUpdate(F32 time, U8* joint_mask)
 			mCharacter->setVisualParamWeight(gHandPoseNames[mCurrentPose], outgoingWeight);
 		}
 
-		mCharacter->updateVisualParams();
+		mCharacter->requestUpdateVisualParams();
 		
 		if (incomingWeight == 1.f && outgoingWeight == 0.f)
 		{
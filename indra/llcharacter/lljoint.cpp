@@ -31,13 +31,14 @@
 
 #include "lljoint.h"
 
+#include "llcompiledskeleton.h"
 #include "llmath.h"
 #include "llcallstack.h"
 #include "llstl.h"
 #include <boost/algorithm/string.hpp>
 
-S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+thread_local S32 LLJoint::sNumUpdates = 0;
+thread_local S32 LLJoint::sNumTouches = 0;
 
 template <class T>
 constexpr bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -278,6 +279,7 @@ void LLJoint::addChild(LLJoint* joint)
 	joint->mXform.setParent(&mXform);
 	joint->mParent = this;	
 	joint->touch();
+	dirtySkeleton();
 }
 
 
@@ -294,6 +296,7 @@ void LLJoint::removeChild(LLJoint* joint)
 		joint->mXform.setParent(nullptr);
 		joint->mParent = nullptr;
 		joint->touch();
+		dirtySkeleton();
 	}
 }
 
@@ -303,6 +306,10 @@ void LLJoint::removeChild(LLJoint* joint)
 //--------------------------------------------------------------------
 void LLJoint::removeAllChildren()
 {
+	if (!mChildren.empty())
+	{
+		dirtySkeleton();
+	}
 	for (auto iter = mChildren.begin();
 		 iter != mChildren.end();)
 	{
@@ -315,6 +322,33 @@ void LLJoint::removeAllChildren()
 }
 
 
+//--------------------------------------------------------------------
+// compileSkeleton()
+//--------------------------------------------------------------------
+void LLJoint::compileSkeleton()
+{
+	if (!mCompiledSkeleton)
+	{
+		mCompiledSkeleton = std::make_unique<LLCompiledSkeleton>(this);
+	}
+	mCompiledSkeleton->setDirty();
+}
+
+
+//--------------------------------------------------------------------
+// dirtySkeleton()
+// Tells the compiled skeleton above, if any, that the tree changed.
+//--------------------------------------------------------------------
+void LLJoint::dirtySkeleton()
+{
+	LLJoint* root = getRoot();
+	if (root->mCompiledSkeleton)
+	{
+		root->mCompiledSkeleton->setDirty();
+	}
+}
+
+
 //--------------------------------------------------------------------
 // getPosition()
 //--------------------------------------------------------------------
@@ -1008,6 +1042,12 @@ void LLJoint::updateWorldMatrixChildren()
 {	
 	if (!this->mUpdateXform) return;
 
+	if (mCompiledSkeleton)
+	{
+		mCompiledSkeleton->updateWorldMatrices();
+		return;
+	}
+
 	if (mDirtyFlags & MATRIX_DIRTY)
 	{
 		updateWorldMatrix();
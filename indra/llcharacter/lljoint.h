@@ -31,6 +31,7 @@
 // Header Files
 //-----------------------------------------------------------------------------
 #include <list>
+#include <memory>
 
 #include "v3math.h"
 #include "m4math.h"
@@ -51,6 +52,8 @@ const U32 LL_FACE_JOINT_NUM = (LL_CHARACTER_MAX_ANIMATED_JOINTS-2);
 const S32 LL_CHARACTER_MAX_PRIORITY = 7;
 const F32 LL_MAX_PELVIS_OFFSET = 5.f;
 
+class LLCompiledSkeleton;
+
 class LLVector3OverrideMap
 {
 public:
@@ -122,6 +125,9 @@ protected:
 
     LLVector3       mDefaultPosition;
     LLVector3       mDefaultScale;
+
+	// flattened copy of the tree, when this is a root that keeps one
+	std::unique_ptr<LLCompiledSkeleton> mCompiledSkeleton;
     
 public:
 	U32				mDirtyFlags;
@@ -140,9 +146,10 @@ public:
 	typedef std::vector<LLJoint*> child_vec_t;
 	child_vec_t mChildren;
 
-	// debug statics
-	static S32		sNumTouches;
-	static S32		sNumUpdates;
+	// debug statics, counted per thread since poses may be evaluated on
+	// several at once
+	static thread_local S32	sNumTouches;
+	static thread_local S32	sNumUpdates;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
@@ -183,6 +190,7 @@ public:
 
 private:
 	void init();
+	void dirtySkeleton();
 
 public:
 	// set name and parent
@@ -221,6 +229,13 @@ public:
 	void removeChild( LLJoint *joint );
 	void removeAllChildren();
 
+	// Keeps the tree under this root compiled into an LLCompiledSkeleton,
+	// so updateWorldMatrixChildren() runs as one pass over flat arrays
+	// instead of walking the joints. Compiled again whenever joints are
+	// added or removed below.
+	void compileSkeleton();
+	LLCompiledSkeleton* getCompiledSkeleton() { return mCompiledSkeleton.get(); }
+
 	// get/set local position
 	const LLVector3& getPosition();
 	void setPosition( const LLVector3& pos, bool apply_attachment_overrides = false );
@@ -62,6 +62,8 @@ static F32 MIN_ACCELERATION_SQUARED = 0.0005f * 0.0005f;
 
 static F32 MAX_CONSTRAINTS = 10;
 
+static const S32 KEY_CURSOR_STEPS = 4;		// keys stepped over before searching
+
 //-----------------------------------------------------------------------------
 // JointMotionList
 //-----------------------------------------------------------------------------
@@ -88,40 +90,41 @@ LLKeyframeMotion::JointMotionList::~JointMotionList()
 
 U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 {
-	S32	total_size = sizeof(JointMotionList);
-
 	for (U32 i = 0; i < getNumJointMotions(); i++)
 	{
 		LLKeyframeMotion::JointMotion* joint_motion_p = mJointMotionArray[i];
 
 		LL_INFOS() << "\tJoint " << joint_motion_p->mJointName << LL_ENDL;
-		if (joint_motion_p->mUsage & LLJointState::SCALE)
-		{
-			LL_INFOS() << "\t" << joint_motion_p->mScaleCurve.mNumKeys << " scale keys at " 
-			<< joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey) << " bytes" << LL_ENDL;
-
-			total_size += joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey);
-		}
 		if (joint_motion_p->mUsage & LLJointState::ROT)
 		{
-			LL_INFOS() << "\t" << joint_motion_p->mRotationCurve.mNumKeys << " rotation keys at " 
-			<< joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey) << " bytes" << LL_ENDL;
-
-			total_size += joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey);
+			LL_INFOS() << "\t" << joint_motion_p->mRotationCurve.getNumKeys() << " rotation keys at " 
+			<< joint_motion_p->mRotationCurve.getMemoryUsage() << " bytes" << LL_ENDL;
 		}
 		if (joint_motion_p->mUsage & LLJointState::POS)
 		{
-			LL_INFOS() << "\t" << joint_motion_p->mPositionCurve.mNumKeys << " position keys at " 
-			<< joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey) << " bytes" << LL_ENDL;
-
-			total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
+			LL_INFOS() << "\t" << joint_motion_p->mPositionCurve.getNumKeys() << " position keys at " 
+			<< joint_motion_p->mPositionCurve.getMemoryUsage() << " bytes" << LL_ENDL;
 		}
 	}
+
+	U32 total_size = getMemoryUsage();
 	LL_INFOS() << "Size: " << total_size << " bytes" << LL_ENDL;
 
 	return total_size;
 }
 
+U32 LLKeyframeMotion::JointMotionList::getMemoryUsage() const
+{
+	U32 total_size = sizeof(JointMotionList) + (U32)(mJointMotionArray.capacity() * sizeof(JointMotion*));
+	for (const JointMotion* joint_motion_p : mJointMotionArray)
+	{
+		total_size += sizeof(JointMotion)
+					  + joint_motion_p->mRotationCurve.getMemoryUsage()
+					  + joint_motion_p->mPositionCurve.getMemoryUsage();
+	}
+	return total_size;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // ****Curve classes
@@ -129,191 +132,135 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
-// getValue()
+// sortKeys()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
+void LLKeyframeMotion::KeyCurve::sortKeys()
 {
-	LLVector3 value;
+	std::stable_sort(mKeys.begin(), mKeys.end(), [](const PackedKey& a, const PackedKey& b) { return a.mTime < b.mTime; });
+	mKeys.shrink_to_fit();
+}
 
-	if (mKeys.empty())
-	{
-		value.clearVec();
-		return value;
-	}
-	
-	key_map_t::iterator right = std::lower_bound(mKeys.begin(), mKeys.end(), time, [](const auto & a, const auto & b) { return a.first < b; });
-	if (right == mKeys.end())
-	{
-		// Past last key
-		--right;
-		value = right->second.mScale;
-	}
-	else if (right == mKeys.begin() || right->first == time)
+//-----------------------------------------------------------------------------
+// findKey()
+//-----------------------------------------------------------------------------
+S32 LLKeyframeMotion::KeyCurve::findKey(F32 time, F32 duration, S32& cursor) const
+{
+	auto before = [duration](const PackedKey& key, F32 time) { return U16_to_F32(key.mTime, 0.f, duration) < time; };
+
+	const S32 count = getNumKeys();
+	S32 k = llclamp(cursor, 0, count);
+	if (k > 0 && getKeyTime(k - 1, duration) >= time)
 	{
-		// Before first key or exactly on a key
-		value = right->second.mScale;
+		// Gone back, as when looping
+		k = (S32)(std::lower_bound(mKeys.begin(), mKeys.begin() + k - 1, time, before) - mKeys.begin());
 	}
 	else
 	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		ScaleKey& scale_before = left->second;
-		ScaleKey& scale_after = right->second;
-		if (right == mKeys.end())
+		// Frames are usually shorter than the time between keys, so the key
+		// is the one found last time or close after it
+		const S32 last_step = llmin(k + KEY_CURSOR_STEPS, count);
+		while (k < last_step && getKeyTime(k, duration) < time)
 		{
-			scale_after = mLoopInKey;
-			index_after = duration;
+			++k;
+		}
+		if (k == last_step && k < count)
+		{
+			k = (S32)(std::lower_bound(mKeys.begin() + k, mKeys.end(), time, before) - mKeys.begin());
 		}
-
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, scale_before, scale_after);
 	}
-	return value;
+	cursor = k;
+	return k;
 }
 
 //-----------------------------------------------------------------------------
-// interp()
+// RotationCurve::getKey()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::getKey(S32 k) const
 {
-	switch (mInterpolationType)
-	{
-	case IT_STEP:
-		return before.mScale;
-
-	default:
-	case IT_LINEAR:
-	case IT_SPLINE:
-		return lerp(before.mScale, after.mScale, u);
-	}
+	const PackedKey& key = mKeys[k];
+	LLVector3 rot_vec(U16_to_F32(key.mX, -1.f, 1.f),
+					  U16_to_F32(key.mY, -1.f, 1.f),
+					  U16_to_F32(key.mZ, -1.f, 1.f));
+	LLQuaternion rot;
+	rot.unpackFromVector3(rot_vec);
+	return rot;
 }
 
 //-----------------------------------------------------------------------------
 // RotationCurve::getValue()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration, S32& cursor) const
 {
 	if (mKeys.empty())
 	{
 		return LLQuaternion::DEFAULT;
 	}
 
-	LLQuaternion value;
-	key_map_t::iterator right = std::lower_bound(mKeys.begin(), mKeys.end(), time, [](const auto & a, const auto & b) { return a.first < b; });
-	if (right == mKeys.end())
+	const S32 right = findKey(time, duration, cursor);
+	if (right == getNumKeys())
 	{
 		// Past last key
-		--right;
-		value = right->second.mRotation;
+		return getKey(right - 1);
 	}
-	else if (right == mKeys.begin() || right->first == time)
+
+	const F32 index_after = getKeyTime(right, duration);
+	if (right == 0 || index_after == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mRotation;
+		return getKey(right);
 	}
-	else
-	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		RotationKey& rot_before = left->second;
-		RotationKey& rot_after = right->second;
-		if (right == mKeys.end())
-		{
-			rot_after = mLoopInKey;
-			index_after = duration;
-		}
 
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, rot_before, rot_after);
-	}
-	return value;
+	// Between two keys
+	const F32 index_before = getKeyTime(right - 1, duration);
+	F32 u = (time - index_before) / (index_after - index_before);
+	return nlerp(u, getKey(right - 1), getKey(right));
 }
 
 //-----------------------------------------------------------------------------
-// interp()
+// PositionCurve::getKey()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLVector3 LLKeyframeMotion::PositionCurve::getKey(S32 k) const
 {
-	switch (mInterpolationType)
-	{
-	case IT_STEP:
-		return before.mRotation;
-
-	default:
-	case IT_LINEAR:
-	case IT_SPLINE:
-		return nlerp(u, before.mRotation, after.mRotation);
-	}
+	const PackedKey& key = mKeys[k];
+	return LLVector3(U16_to_F32(key.mX, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET),
+					 U16_to_F32(key.mY, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET),
+					 U16_to_F32(key.mZ, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
 }
 
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration, S32& cursor) const
 {
-	LLVector3 value;
-
 	if (mKeys.empty())
 	{
-		value.clearVec();
-		return value;
+		return LLVector3::zero;
 	}
-	
-	key_map_t::iterator right = std::lower_bound(mKeys.begin(), mKeys.end(), time, [](const auto & a, const auto & b) { return a.first < b; });
-	if (right == mKeys.end())
+
+	const S32 right = findKey(time, duration, cursor);
+	if (right == getNumKeys())
 	{
 		// Past last key
-		--right;
-		value = right->second.mPosition;
+		return getKey(right - 1);
 	}
-	else if (right == mKeys.begin() || right->first == time)
+
+	const F32 index_after = getKeyTime(right, duration);
+	if (right == 0 || index_after == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mPosition;
+		return getKey(right);
 	}
-	else
-	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		PositionKey& pos_before = left->second;
-		PositionKey& pos_after = right->second;
-		if (right == mKeys.end())
-		{
-			pos_after = mLoopInKey;
-			index_after = duration;
-		}
 
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, pos_before, pos_after);
-	}
+	// Between two keys
+	const F32 index_before = getKeyTime(right - 1, duration);
+	F32 u = (time - index_before) / (index_after - index_before);
+	LLVector3 value = lerp(getKey(right - 1), getKey(right), u);
 
 	llassert(value.isFinite());
 	
 	return value;
 }
 
-//-----------------------------------------------------------------------------
-// interp()
-//-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
-{
-	switch (mInterpolationType)
-	{
-	case IT_STEP:
-		return before.mPosition;
-	default:
-	case IT_LINEAR:
-	case IT_SPLINE:
-		return lerp(before.mPosition, after.mPosition, u);
-	}
-}
-
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -324,7 +271,7 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 //-----------------------------------------------------------------------------
 // JointMotion::update()
 //-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration, KeyCursor& cursor) const
 {
 	// this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't 
 	// managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -335,28 +282,20 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 
 	U32 usage = joint_state->getUsage();
 
-	//-------------------------------------------------------------------------
-	// update scale component of joint state
-	//-------------------------------------------------------------------------
-	if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
-	{
-		joint_state->setScale( mScaleCurve.getValue( time, duration ) );
-	}
-
 	//-------------------------------------------------------------------------
 	// update rotation component of joint state
 	//-------------------------------------------------------------------------
-	if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
+	if ((usage & LLJointState::ROT) && mRotationCurve.getNumKeys())
 	{
-		joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+		joint_state->setRotation( mRotationCurve.getValue( time, duration, cursor.mRotation ) );
 	}
 
 	//-------------------------------------------------------------------------
 	// update position component of joint state
 	//-------------------------------------------------------------------------
-	if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
+	if ((usage & LLJointState::POS) && mPositionCurve.getNumKeys())
 	{
-		joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+		joint_state->setPosition( mPositionCurve.getValue( time, duration, cursor.mPosition ) );
 	}
 }
 
@@ -470,31 +409,7 @@ LLMotion::LLMotionInitStatus LLKeyframeMotion::onInitialize(LLCharacter *charact
 	if(joint_motion_list)
 	{
 		// motion already existed in cache, so grab it
-		mJointMotionList = joint_motion_list;
-
-		mJointStates.reserve(mJointMotionList->getNumJointMotions());
-		
-		// don't forget to allocate joint states
-		// set up joint states to point to character joints
-		for(U32 i = 0; i < mJointMotionList->getNumJointMotions(); i++)
-		{
-			JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
-			if (LLJoint *joint = mCharacter->getJoint(joint_motion->mJointName))
-			{
-				LLPointer<LLJointState> joint_state = new LLJointState;
-				mJointStates.push_back(joint_state);
-				joint_state->setJoint(joint);
-				joint_state->setUsage(joint_motion->mUsage);
-				joint_state->setPriority(joint_motion->mPriority);
-			}
-			else
-			{
-				// add dummy joint state with no associated joint
-				mJointStates.push_back(new LLJointState);
-			}
-		}
-		mAssetStatus = ASSET_LOADED;
-		setupPose();
+		initializeFromCache(joint_motion_list);
 		return STATUS_SUCCESS;
 	}
 
@@ -575,11 +490,47 @@ LLMotion::LLMotionInitStatus LLKeyframeMotion::onInitialize(LLCharacter *charact
 	return STATUS_SUCCESS;
 }
 
+//-----------------------------------------------------------------------------
+// initializeFromCache()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::initializeFromCache(JointMotionList* joint_motion_list)
+{
+	mJointMotionList = joint_motion_list;
+
+	mJointStates.clear();
+	mJointStates.reserve(mJointMotionList->getNumJointMotions());
+	
+	// don't forget to allocate joint states
+	// set up joint states to point to character joints
+	for(U32 i = 0; i < mJointMotionList->getNumJointMotions(); i++)
+	{
+		JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
+		if (LLJoint *joint = mCharacter->getJoint(joint_motion->mJointName))
+		{
+			LLPointer<LLJointState> joint_state = new LLJointState;
+			mJointStates.push_back(joint_state);
+			joint_state->setJoint(joint);
+			joint_state->setUsage(joint_motion->mUsage);
+			joint_state->setPriority(joint_motion->mPriority);
+		}
+		else
+		{
+			// add dummy joint state with no associated joint
+			mJointStates.push_back(new LLJointState);
+		}
+	}
+	mAssetStatus = ASSET_LOADED;
+	setupPose();
+}
+
 //-----------------------------------------------------------------------------
 // setupPose()
 //-----------------------------------------------------------------------------
 BOOL LLKeyframeMotion::setupPose()
 {
+	// each instance keeps its own place in the shared curves
+	mKeyCursors.assign(mJointMotionList->getNumJointMotions(), KeyCursor());
+
 	// add all valid joint states to the pose
 	for (U32 jm=0; jm<mJointMotionList->getNumJointMotions(); jm++)
 	{
@@ -692,11 +643,13 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
 	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+	llassert_always (mJointMotionList->getNumJointMotions() <= mKeyCursors.size());
 	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
 	{
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
-													  mJointMotionList->mDuration );
+													  mJointMotionList->mDuration,
+													  mKeyCursors[i]);
 	}
 	static const std::string HAND_POSE_STR("Hand Pose");
 	static const std::string HAND_POSE_PRIO_STR("Hand Pose Priority");
@@ -1478,7 +1431,8 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 		//---------------------------------------------------------------------
 		// scan rotation curve header
 		//---------------------------------------------------------------------
-		if (!dp.unpackS32(joint_motion->mRotationCurve.mNumKeys, "num_rot_keys") || joint_motion->mRotationCurve.mNumKeys < 0)
+		S32 num_rot_keys;
+		if (!dp.unpackS32(num_rot_keys, "num_rot_keys") || num_rot_keys < 0)
 		{
 			LL_WARNS() << "can't read number of rotation keys"
                        << " for animation " << asset_id << LL_ENDL;
@@ -1486,8 +1440,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 			return FALSE;
 		}
 
-		joint_motion->mRotationCurve.mInterpolationType = IT_LINEAR;
-		if (joint_motion->mRotationCurve.mNumKeys != 0)
+		if (num_rot_keys != 0)
 		{
 			joint_state->setUsage(joint_state->getUsage() | LLJointState::ROT );
 		}
@@ -1497,7 +1450,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 		//---------------------------------------------------------------------
 		RotationCurve *rCurve = &joint_motion->mRotationCurve;
 
-		for (S32 k = 0; k < joint_motion->mRotationCurve.mNumKeys; k++)
+		for (S32 k = 0; k < num_rot_keys; k++)
 		{
 			F32 time;
 			U16 time_short;
@@ -1535,8 +1488,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 				}
 			}
 			
-			RotationKey rot_key;
-			rot_key.mTime = time;
+			LLQuaternion rotation;
 			LLVector3 rot_angles;
 			U16 x, y, z;
 
@@ -1556,7 +1508,15 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 				}
 
 				LLQuaternion::Order ro = StringToOrder("ZYX");
-				rot_key.mRotation = mayaQ(rot_angles.mV[VX], rot_angles.mV[VY], rot_angles.mV[VZ], ro);
+				rotation = mayaQ(rot_angles.mV[VX], rot_angles.mV[VY], rot_angles.mV[VZ], ro);
+
+				// Kept as the current format stores it
+				time_short = F32_to_U16(time, 0.f, mJointMotionList->mDuration);
+				LLVector3 rot_vec = rotation.packToVector3();
+				rot_vec.quantize16(-1.f, 1.f, -1.f, 1.f);
+				x = F32_to_U16(rot_vec.mV[VX], -1.f, 1.f);
+				y = F32_to_U16(rot_vec.mV[VY], -1.f, 1.f);
+				z = F32_to_U16(rot_vec.mV[VZ], -1.f, 1.f);
 			}
 			else
 			{
@@ -1589,10 +1549,10 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 					delete mJointMotionList;
 					return FALSE;
 				}
-				rot_key.mRotation.unpackFromVector3(rot_vec);
+				rotation.unpackFromVector3(rot_vec);
 			}
 
-			if( !(rot_key.mRotation.isFinite()) )
+			if( !(rotation.isFinite()) )
 			{
 				LL_WARNS() << "non-finite angle in rotation key (" << k << ")"
                            << " for animation " << asset_id << LL_ENDL;
@@ -1600,15 +1560,16 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 				return FALSE;
 			}
 
-			rCurve->mKeys.emplace_back(time, rot_key);
+			rCurve->addKey(time_short, x, y, z);
 		}
 
-		std::sort(rCurve->mKeys.begin(), rCurve->mKeys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		rCurve->sortKeys();
 
 		//---------------------------------------------------------------------
 		// scan position curve header
 		//---------------------------------------------------------------------
-		if (!dp.unpackS32(joint_motion->mPositionCurve.mNumKeys, "num_pos_keys") || joint_motion->mPositionCurve.mNumKeys < 0)
+		S32 num_pos_keys;
+		if (!dp.unpackS32(num_pos_keys, "num_pos_keys") || num_pos_keys < 0)
 		{
 			LL_WARNS() << "can't read number of position keys"
                        << " for animation " << asset_id << LL_ENDL;
@@ -1616,8 +1577,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 			return FALSE;
 		}
 
-		joint_motion->mPositionCurve.mInterpolationType = IT_LINEAR;
-		if (joint_motion->mPositionCurve.mNumKeys != 0)
+		if (num_pos_keys != 0)
 		{
 			joint_state->setUsage(joint_state->getUsage() | LLJointState::POS );
 		}
@@ -1627,15 +1587,17 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 		//---------------------------------------------------------------------
 		PositionCurve *pCurve = &joint_motion->mPositionCurve;
 		BOOL is_pelvis = joint_motion->mJointName == "mPelvis";
-		for (S32 k = 0; k < joint_motion->mPositionCurve.mNumKeys; k++)
+		for (S32 k = 0; k < num_pos_keys; k++)
 		{
 			U16 time_short;
-			PositionKey pos_key;
+			F32 time;
+			LLVector3 position;
+			U16 x, y, z;
 
 			if (old_version)
 			{
-				if (!dp.unpackF32(pos_key.mTime, "time") ||
-				    !llfinite(pos_key.mTime))
+				if (!dp.unpackF32(time, "time") ||
+				    !llfinite(time))
 				{
 					LL_WARNS() << "can't read time in position key (" << k << ")"
                                << " for animation " << asset_id << LL_ENDL;
@@ -1653,12 +1615,11 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 					return FALSE;
 				}
 
-				pos_key.mTime = U16_to_F32(time_short, 0.f, mJointMotionList->mDuration);
 			}
 
 			if (old_version)
 			{
-				if (!dp.unpackVector3(pos_key.mPosition, "pos"))
+				if (!dp.unpackVector3(position, "pos"))
 				{
 					LL_WARNS() << "can't read pos in position key (" << k << ")" << LL_ENDL;
 					delete mJointMotionList;
@@ -1666,15 +1627,19 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 				}
                 
                 //MAINT-6162
-                pos_key.mPosition.mV[VX] = llclamp( pos_key.mPosition.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-                pos_key.mPosition.mV[VY] = llclamp( pos_key.mPosition.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-                pos_key.mPosition.mV[VZ] = llclamp( pos_key.mPosition.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+                position.mV[VX] = llclamp( position.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+                position.mV[VY] = llclamp( position.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+                position.mV[VZ] = llclamp( position.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+
+				// Kept as the current format stores it
+				time_short = F32_to_U16(time, 0.f, mJointMotionList->mDuration);
+				x = F32_to_U16(position.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				y = F32_to_U16(position.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				z = F32_to_U16(position.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
                 
 			}
 			else
 			{
-				U16 x, y, z;
-
 				if (!dp.unpackU16(x, "pos_x"))
 				{
 					LL_WARNS() << "can't read pos_x in position key (" << k << ")" << LL_ENDL;
@@ -1694,12 +1659,12 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 					return FALSE;
 				}
 
-				pos_key.mPosition.mV[VX] = U16_to_F32(x, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-				pos_key.mPosition.mV[VY] = U16_to_F32(y, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-				pos_key.mPosition.mV[VZ] = U16_to_F32(z, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				position.mV[VX] = U16_to_F32(x, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				position.mV[VY] = U16_to_F32(y, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				position.mV[VZ] = U16_to_F32(z, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
 			}
 			
-			if( !(pos_key.mPosition.isFinite()) )
+			if( !(position.isFinite()) )
 			{
 				LL_WARNS() << "non-finite position in key (" << k << ")" 
                            << " for animation " << asset_id << LL_ENDL;
@@ -1707,15 +1672,15 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id)
 				return FALSE;
 			}
 			
-			pCurve->mKeys.emplace_back(pos_key.mTime, pos_key);
+			pCurve->addKey(time_short, x, y, z);
 
 			if (is_pelvis)
 			{
-				mJointMotionList->mPelvisBBox.addPoint(pos_key.mPosition);
+				mJointMotionList->mPelvisBBox.addPoint(position);
 			}
 		}
 
-		std::sort(pCurve->mKeys.begin(), pCurve->mKeys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		pCurve->sortKeys();
 
 		joint_motion->mUsage = joint_state->getUsage();
 	}
@@ -2019,46 +1984,33 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		JointMotion* joint_motionp = mJointMotionList->getJointMotion(i);
 		success &= dp.packString(joint_motionp->mJointName, "joint_name");
 		success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
-		success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
+		success &= dp.packS32(joint_motionp->mRotationCurve.getNumKeys(), "num_rot_keys");
 
+		// Keys are kept as the format stores them
 		LL_DEBUGS("BVH") << "Joint " << joint_motionp->mJointName << LL_ENDL;
-		for (auto& key : joint_motionp->mRotationCurve.mKeys)
-        {
-			RotationKey& rot_key = key.second;
-			U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
-			success &= dp.packU16(time_short, "time");
+		const RotationCurve& rot_curve = joint_motionp->mRotationCurve;
+		for (S32 k = 0; k < rot_curve.getNumKeys(); k++)
+		{
+			const PackedKey& key = rot_curve.mKeys[k];
+			success &= dp.packU16(key.mTime, "time");
+			success &= dp.packU16(key.mX, "rot_angle_x");
+			success &= dp.packU16(key.mY, "rot_angle_y");
+			success &= dp.packU16(key.mZ, "rot_angle_z");
 
-			LLVector3 rot_angles = rot_key.mRotation.packToVector3();
-			
-			U16 x, y, z;
-			rot_angles.quantize16(-1.f, 1.f, -1.f, 1.f);
-			x = F32_to_U16(rot_angles.mV[VX], -1.f, 1.f);
-			y = F32_to_U16(rot_angles.mV[VY], -1.f, 1.f);
-			z = F32_to_U16(rot_angles.mV[VZ], -1.f, 1.f);
-			success &= dp.packU16(x, "rot_angle_x");
-			success &= dp.packU16(y, "rot_angle_y");
-			success &= dp.packU16(z, "rot_angle_z");
-
-			LL_DEBUGS("BVH") << "  rot: t " << rot_key.mTime << " angles " << rot_angles.mV[VX] <<","<< rot_angles.mV[VY] <<","<< rot_angles.mV[VZ] << LL_ENDL;
+			LL_DEBUGS("BVH") << "  rot: t " << rot_curve.getKeyTime(k, mJointMotionList->mDuration) << " rot " << rot_curve.getKey(k) << LL_ENDL;
 		}
 
-		success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-		for (auto& key : joint_motionp->mPositionCurve.mKeys)
-        {
-			PositionKey& pos_key = key.second;
-			U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
-			success &= dp.packU16(time_short, "time");
+		success &= dp.packS32(joint_motionp->mPositionCurve.getNumKeys(), "num_pos_keys");
+		const PositionCurve& pos_curve = joint_motionp->mPositionCurve;
+		for (S32 k = 0; k < pos_curve.getNumKeys(); k++)
+		{
+			const PackedKey& key = pos_curve.mKeys[k];
+			success &= dp.packU16(key.mTime, "time");
+			success &= dp.packU16(key.mX, "pos_x");
+			success &= dp.packU16(key.mY, "pos_y");
+			success &= dp.packU16(key.mZ, "pos_z");
 
-			U16 x, y, z;
-			pos_key.mPosition.quantize16(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			x = F32_to_U16(pos_key.mPosition.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			y = F32_to_U16(pos_key.mPosition.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			z = F32_to_U16(pos_key.mPosition.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			success &= dp.packU16(x, "pos_x");
-			success &= dp.packU16(y, "pos_y");
-			success &= dp.packU16(z, "pos_z");
-
-			LL_DEBUGS("BVH") << "  pos: t " << pos_key.mTime << " pos " << pos_key.mPosition.mV[VX] <<","<< pos_key.mPosition.mV[VY] <<","<< pos_key.mPosition.mV[VZ] << LL_ENDL;
+			LL_DEBUGS("BVH") << "  pos: t " << pos_curve.getKeyTime(k, mJointMotionList->mDuration) << " pos " << pos_curve.getKey(k) << LL_ENDL;
 		}
 	}	
 
@@ -2266,24 +2218,6 @@ void LLKeyframeMotion::setLoopIn(F32 in_point)
 	if (mJointMotionList)
 	{
 		mJointMotionList->mLoopInPoint = in_point; 
-		
-		// set up loop keys
-		for (U32 i = 0; i < mJointMotionList->getNumJointMotions(); i++)
-		{
-			JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
-			
-			PositionCurve* pos_curve = &joint_motion->mPositionCurve;
-			RotationCurve* rot_curve = &joint_motion->mRotationCurve;
-			ScaleCurve* scale_curve = &joint_motion->mScaleCurve;
-			
-			pos_curve->mLoopInKey.mTime = mJointMotionList->mLoopInPoint;
-			rot_curve->mLoopInKey.mTime = mJointMotionList->mLoopInPoint;
-			scale_curve->mLoopInKey.mTime = mJointMotionList->mLoopInPoint;
-
-			pos_curve->mLoopInKey.mPosition = pos_curve->getValue(mJointMotionList->mLoopInPoint, mJointMotionList->mDuration);
-			rot_curve->mLoopInKey.mRotation = rot_curve->getValue(mJointMotionList->mLoopInPoint, mJointMotionList->mDuration);
-			scale_curve->mLoopInKey.mScale = scale_curve->getValue(mJointMotionList->mLoopInPoint, mJointMotionList->mDuration);
-		}
 	}
 }
 
@@ -2295,24 +2229,6 @@ void LLKeyframeMotion::setLoopOut(F32 out_point)
 	if (mJointMotionList)
 	{
 		mJointMotionList->mLoopOutPoint = out_point; 
-		
-		// set up loop keys
-		for (U32 i = 0; i < mJointMotionList->getNumJointMotions(); i++)
-		{
-			JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
-			
-			PositionCurve* pos_curve = &joint_motion->mPositionCurve;
-			RotationCurve* rot_curve = &joint_motion->mRotationCurve;
-			ScaleCurve* scale_curve = &joint_motion->mScaleCurve;
-			
-			pos_curve->mLoopOutKey.mTime = mJointMotionList->mLoopOutPoint;
-			rot_curve->mLoopOutKey.mTime = mJointMotionList->mLoopOutPoint;
-			scale_curve->mLoopOutKey.mTime = mJointMotionList->mLoopOutPoint;
-
-			pos_curve->mLoopOutKey.mPosition = pos_curve->getValue(mJointMotionList->mLoopOutPoint, mJointMotionList->mDuration);
-			rot_curve->mLoopOutKey.mRotation = rot_curve->getValue(mJointMotionList->mLoopOutPoint, mJointMotionList->mDuration);
-			scale_curve->mLoopOutKey.mScale = scale_curve->getValue(mJointMotionList->mLoopOutPoint, mJointMotionList->mDuration);
-		}
 	}
 }
 
@@ -2354,6 +2270,16 @@ void LLKeyframeMotion::onLoadComplete(LLVFS *vfs,
 				// asset already loaded
 				return;
 			}
+
+			// another character asking for the same asset may have decoded
+			// it already, so share that
+			LLKeyframeMotion::JointMotionList* joint_motion_list = LLKeyframeDataCache::getKeyframeData(asset_uuid);
+			if (joint_motion_list)
+			{
+				motionp->initializeFromCache(joint_motion_list);
+				return;
+			}
+
 			LLVFile file(vfs, asset_uuid, type, LLVFile::READ);
 			S32 size = file.getSize();
 			
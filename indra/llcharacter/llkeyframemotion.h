@@ -36,6 +36,7 @@
 #include "llhandmotion.h"
 #include "lljointstate.h"
 #include "llmotion.h"
+#include "llquantize.h"
 #include "llquaternion.h"
 #include "v3dmath.h"
 #include "v3math.h"
@@ -276,87 +277,64 @@ protected:
 public:
 	enum AssetStatus { ASSET_LOADED, ASSET_FETCHED, ASSET_NEEDS_FETCH, ASSET_FETCH_FAILED, ASSET_UNDEFINED };
 
-	enum InterpolationType { IT_STEP, IT_LINEAR, IT_SPLINE };
-
-	//-------------------------------------------------------------------------
-	// ScaleKey
-	//-------------------------------------------------------------------------
-	struct ScaleKey
-	{
-		F32			mTime = 0.0f;
-		LLVector3	mScale;
-	};
-
 	//-------------------------------------------------------------------------
-	// RotationKey
+	// PackedKey
 	//-------------------------------------------------------------------------
-	struct RotationKey
+	// A key as the asset stores it: its time quantized over the duration and
+	// three quantized components, decoded only when evaluated.
+	struct PackedKey
 	{
-		F32				mTime = 0.0f;
-		LLQuaternion	mRotation;
+		U16			mTime;
+		U16			mX;
+		U16			mY;
+		U16			mZ;
 	};
 
 	//-------------------------------------------------------------------------
-	// PositionKey
+	// KeyCurve
 	//-------------------------------------------------------------------------
-	struct PositionKey
+	// Curves belong to the JointMotionList every instance of an animation
+	// shares, so where the last lookup left off is kept by each instance,
+	// in a cursor it passes in.
+	struct KeyCurve
 	{
-		F32			mTime = 0.0f;
-		LLVector3	mPosition;
+		S32 getNumKeys() const						{ return (S32)mKeys.size(); }
+		F32 getKeyTime(S32 k, F32 duration) const	{ return U16_to_F32(mKeys[k].mTime, 0.f, duration); }
+		void addKey(U16 time, U16 x, U16 y, U16 z)	{ mKeys.push_back({ time, x, y, z }); }
+		void sortKeys();
+		// Index of the first key at or after time, as std::lower_bound()
+		// finds it, starting from the cursor and leaving it there
+		S32 findKey(F32 time, F32 duration, S32& cursor) const;
+		U32 getMemoryUsage() const					{ return (U32)(mKeys.capacity() * sizeof(PackedKey)); }
+
+		std::vector<PackedKey>	mKeys;
 	};
 
 	//-------------------------------------------------------------------------
-	// ScaleCurve
+	// RotationCurve
 	//-------------------------------------------------------------------------
-	struct ScaleCurve
+	struct RotationCurve : public KeyCurve
 	{
-		ScaleCurve() = default;
-		~ScaleCurve() = default;
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
-
-		InterpolationType	mInterpolationType = LLKeyframeMotion::IT_LINEAR;
-		S32					mNumKeys = 0;
-		typedef std::vector<std::pair<F32, ScaleKey>> key_map_t;
-		key_map_t 			mKeys;
-		ScaleKey			mLoopInKey;
-		ScaleKey			mLoopOutKey;
+		LLQuaternion getKey(S32 k) const;
+		LLQuaternion getValue(F32 time, F32 duration, S32& cursor) const;
 	};
 
 	//-------------------------------------------------------------------------
-	// RotationCurve
+	// PositionCurve
 	//-------------------------------------------------------------------------
-	struct RotationCurve
+	struct PositionCurve : public KeyCurve
 	{
-		RotationCurve() = default;
-		~RotationCurve() = default;
-		LLQuaternion getValue(F32 time, F32 duration);
-		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
-
-		InterpolationType	mInterpolationType = LLKeyframeMotion::IT_LINEAR;
-		S32					mNumKeys = 0;
-		typedef std::vector<std::pair<F32, RotationKey>> key_map_t;
-		key_map_t		mKeys;
-		RotationKey		mLoopInKey;
-		RotationKey		mLoopOutKey;
+		LLVector3 getKey(S32 k) const;
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor) const;
 	};
 
 	//-------------------------------------------------------------------------
-	// PositionCurve
+	// KeyCursor
 	//-------------------------------------------------------------------------
-	struct PositionCurve
+	struct KeyCursor
 	{
-		PositionCurve() = default;
-		~PositionCurve() = default;
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
-
-		InterpolationType	mInterpolationType = LLKeyframeMotion::IT_LINEAR;
-		S32					mNumKeys = 0;
-		typedef std::vector<std::pair<F32, PositionKey>> key_map_t;
-		key_map_t		mKeys;
-		PositionKey		mLoopInKey;
-		PositionKey		mLoopOutKey;
+		S32			mRotation = 0;
+		S32			mPosition = 0;
 	};
 
 	//-------------------------------------------------------------------------
@@ -367,12 +345,11 @@ public:
 	public:
 		PositionCurve	mPositionCurve;
 		RotationCurve	mRotationCurve;
-		ScaleCurve		mScaleCurve;
 		std::string		mJointName;
 		U32				mUsage;
 		LLJoint::JointPriority	mPriority;
 
-		void update(LLJointState* joint_state, F32 time, F32 duration);
+		void update(LLJointState* joint_state, F32 time, F32 duration, KeyCursor& cursor) const;
 	};
 	
 	//-------------------------------------------------------------------------
@@ -402,12 +379,15 @@ public:
 		JointMotionList();
 		~JointMotionList();
 		U32 dumpDiagInfo();
+		U32 getMemoryUsage() const;
 		JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
 		U32 getNumJointMotions() const { return mJointMotionArray.size(); }
 	};
 
 
 protected:
+	void	initializeFromCache(JointMotionList* joint_motion_list);
+
 	static LLVFS*				sVFS;
 
 	//-------------------------------------------------------------------------
@@ -415,6 +395,7 @@ protected:
 	//-------------------------------------------------------------------------
 	JointMotionList*				mJointMotionList;
 	std::vector<LLPointer<LLJointState> > mJointStates;
+	std::vector<KeyCursor>			mKeyCursors;
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
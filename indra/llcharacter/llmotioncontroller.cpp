@@ -145,6 +145,8 @@ LLMotionController::LLMotionController()
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
 	  mLastInterp(0.f),
+	  mEvaluatePending(false),
+	  mForceUpdate(false),
 	  mLastCountAfterPurge(0)
 {
 }
@@ -176,6 +178,7 @@ void LLMotionController::deleteAllMotions()
 	mLoadingMotions.clear();
 	mLoadedMotions.clear();
 	mActiveMotions.clear();
+	mStopRequests.clear();
 
 	std::for_each(mAllMotions.begin(), mAllMotions.end(), DeletePairedPointer());
 	mAllMotions.clear();
@@ -519,7 +522,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
 		// this will only be called when an animation stops itself (runs out of time)
 		if (mLastTime <= motionp->mSendStopTimestamp)
 		{
-			mCharacter->requestStopMotion( motionp );
+			queueStopRequest(motionp);
 			stopMotionInstance(motionp, FALSE);
 		}
 	}
@@ -532,6 +535,14 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// queueStopRequest()
+//-----------------------------------------------------------------------------
+void LLMotionController::queueStopRequest(LLMotion* motionp)
+{
+	mStopRequests.push_back(motionp);
+}
+
 //-----------------------------------------------------------------------------
 // updateIdleActiveMotions()
 // Call this instead of updateMotionsByType for hidden avatars
@@ -622,7 +633,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					queueStopRequest(motionp);
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -703,7 +714,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					queueStopRequest(motionp);
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -750,7 +761,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// animation has stopped itself due to internal logic
 				// propagate this to the network
 				// as not all viewers are guaranteed to have access to the same logic
-				mCharacter->requestStopMotion( motionp );
+				queueStopRequest(motionp);
 				stopMotionInstance(motionp, FALSE);
 			}
 
@@ -812,6 +823,16 @@ void LLMotionController::updateLoadingMotions()
 // updateMotion()
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotions(bool force_update)
+{
+	prepareMotions(force_update);
+	evaluateMotions();
+	finishMotions();
+}
+
+//-----------------------------------------------------------------------------
+// prepareMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::prepareMotions(bool force_update)
 {
     // SL-763: "Distant animated objects run at super fast speed"
     // The use_quantum optimization or possibly the associated code in setTimeStamp()
@@ -824,6 +845,7 @@ void LLMotionController::updateMotions(bool force_update)
 	F32 delta_time = cur_time - mPrevTimerElapsed;
 	mPrevTimerElapsed = cur_time;
 	mLastTime = mAnimTime;
+	mEvaluatePending = false;
 
 	// Always cap the number of loaded motions
 	purgeExcessMotions();
@@ -868,10 +890,25 @@ void LLMotionController::updateMotions(bool force_update)
 	}
 
 	updateLoadingMotions();
-	
+
+	mEvaluatePending = true;
+	mForceUpdate = force_update;
+}
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::evaluateMotions()
+{
+	if (!mEvaluatePending)
+	{
+		return;
+	}
+	mEvaluatePending = false;
+
 	resetJointSignatures();
 
-	if (mPaused && !force_update)
+	if (mPaused && !mForceUpdate)
 	{
 		updateIdleActiveMotions();
 	}
@@ -885,7 +922,7 @@ void LLMotionController::updateMotions(bool force_update)
 		// update all regular motions
 		updateRegularMotions();
 		
-		if (use_quantum)
+		if (mTimeStep != 0.f)
 		{
 			mPoseBlender.blendAndCache(TRUE);
 		}
@@ -899,6 +936,20 @@ void LLMotionController::updateMotions(bool force_update)
 //	LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
 }
 
+//-----------------------------------------------------------------------------
+// finishMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishMotions()
+{
+	// The character may start and stop motions in turn
+	std::vector<LLMotion*> stop_requests;
+	stop_requests.swap(mStopRequests);
+	for (LLMotion* motionp : stop_requests)
+	{
+		mCharacter->requestStopMotion(motionp);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
@@ -133,6 +133,18 @@ public:
 	// deactivates terminated motions`
 	void updateMotions(bool force_update = false);
 
+	// updateMotions() in the three steps it takes. prepareMotions() advances
+	// the clock and starts motions that finished loading, evaluateMotions()
+	// updates the active motions and blends their poses onto the joints,
+	// and finishMotions() tells the character of motions that stopped
+	// themselves. Evaluating touches nothing but this controller, its
+	// motions and its character, so the controllers of different characters
+	// may evaluate on different threads at once. The other two steps belong
+	// to the main thread.
+	void prepareMotions(bool force_update = false);
+	void evaluateMotions();
+	void finishMotions();
+
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
@@ -189,6 +201,8 @@ protected:
 	void resetJointSignatures();
 	void updateMotionsByType(LLMotion::LLMotionBlendType motion_type);
 	void updateIdleMotion(LLMotion* motionp);
+	// The character is told by finishMotions()
+	void queueStopRequest(LLMotion* motionp);
 	void updateIdleActiveMotions();
 	void purgeExcessMotions();
 	void deactivateStoppedMotions();
@@ -227,6 +241,9 @@ protected:
 	F32					mTimeStep;
 	S32					mTimeStepCount;
 	F32					mLastInterp;
+	bool				mEvaluatePending;		// prepared but not yet evaluated
+	bool				mForceUpdate;
+	std::vector<LLMotion*>	mStopRequests;
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
 private:
@@ -440,6 +440,284 @@ void LLJointStateBlender::resetCachedJoint()
 	mJointCache.setRotation(source_joint->getRotation());
 }
 
+//-----------------------------------------------------------------------------
+// LLJointBlendBatch
+//-----------------------------------------------------------------------------
+
+// The rotation held in a vector, as is rather than normalized
+static LLQuaternion to_quaternion(const LLVector4a& v)
+{
+	LLQuaternion q;
+	q.mQ[VX] = v[VX];
+	q.mQ[VY] = v[VY];
+	q.mQ[VZ] = v[VZ];
+	q.mQ[VW] = v[VW];
+	return q;
+}
+
+// blended = nlerp(t, rot, blended)
+static void nlerp_rotation(F32 t, const LLVector4a& rot, LLVector4a& blended)
+{
+	if (rot.dot4(blended).getF32() < 0.f)
+	{
+		// the long way round, which nlerp() slerps
+		const LLQuaternion q = slerp(t, to_quaternion(rot), to_quaternion(blended));
+		blended.loadua(q.mQ);
+		return;
+	}
+
+	LLVector4a t_weight;
+	t_weight.splat(t);
+	LLVector4a inv_t_weight;
+	inv_t_weight.splat(1.f - t);
+
+	LLVector4a result;
+	result.setMul(blended, t_weight);
+	LLVector4a from;
+	from.setMul(rot, inv_t_weight);
+	result.add(from);
+
+	// normalized as LLQuaternion::normalize() does it
+	const F32 mag = sqrtf(result.dot4(result).getF32());
+	if (mag > FP_MAG_THRESHOLD)
+	{
+		if (fabs(1.f - mag) > ONE_PART_IN_A_MILLION)
+		{
+			result.mul(1.f / mag);
+		}
+	}
+	else
+	{
+		result.set(0.f, 0.f, 0.f, 1.f);
+	}
+	blended = result;
+}
+
+//-----------------------------------------------------------------------------
+// blend()
+//-----------------------------------------------------------------------------
+void LLJointBlendBatch::blend(const std::vector<LLJointStateBlender*>& blenders, BOOL apply_now)
+{
+	if (blenders.empty())
+	{
+		return;
+	}
+
+	gather(blenders, apply_now);
+	for (U32 row = 0; row < mRows; ++row)
+	{
+		blendRow(row);
+	}
+	apply(blenders, apply_now);
+}
+
+//-----------------------------------------------------------------------------
+// gather()
+//-----------------------------------------------------------------------------
+void LLJointBlendBatch::gather(const std::vector<LLJointStateBlender*>& blenders, BOOL apply_now)
+{
+	mCount = (U32)blenders.size();
+	mRows = 0;
+
+	mTargets.resize(mCount);
+	mBlendedPositions.resize(mCount);
+	mBlendedRotations.resize(mCount);
+	mBlendedScales.resize(mCount);
+	mAddedPositions.resize(mCount);
+	mAddedScales.resize(mCount);
+	mAddedRotations.resize(mCount);
+	mPositionWeights.assign(mCount, 0.f);
+	mRotationWeights.assign(mCount, 0.f);
+	mScaleWeights.assign(mCount, 0.f);
+	mBlendedUsages.assign(mCount, 0);
+
+	for (U32 k = 0; k < mCount; ++k)
+	{
+		LLJointStateBlender* jsbp = blenders[k];
+		llassert(jsbp->isActive());
+
+		// start from the joint as blendJointStates() does
+		LLJoint* target_joint = apply_now ? jsbp->mJointStates[0]->getJoint() : &jsbp->mJointCache;
+		mTargets[k] = target_joint;
+		mBlendedPositions[k].load3(target_joint->getPosition().mV);
+		mBlendedRotations[k].loadua(target_joint->getRotation().mQ);
+		mBlendedScales[k].load3(target_joint->getScale().mV);
+		mAddedPositions[k].clear();
+		mAddedScales[k].clear();
+		mAddedRotations[k] = LLQuaternion::DEFAULT;
+
+		U32 rows = 0;
+		while (rows < JSB_NUM_JOINT_STATES && jsbp->mJointStates[rows].notNull())
+		{
+			++rows;
+		}
+		mRows = llmax(mRows, rows);
+	}
+
+	const U32 size = mRows * mCount;
+	mPositions.resize(size);
+	mRotations.resize(size);
+	mScales.resize(size);
+	mWeights.resize(size);
+	mUsages.assign(size, 0);
+	mAdditive.resize(size);
+
+	for (U32 k = 0; k < mCount; ++k)
+	{
+		LLJointStateBlender* jsbp = blenders[k];
+		for (U32 row = 0; row < mRows && jsbp->mJointStates[row].notNull(); ++row)
+		{
+			const LLJointState* jsp = jsbp->mJointStates[row];
+			const F32 weight = jsp->getWeight();
+			if (weight == 0.f)
+			{
+				continue;
+			}
+
+			const U32 i = row * mCount + k;
+			mPositions[i].load3(jsp->getPosition().mV);
+			mRotations[i].loadua(jsp->getRotation().mQ);
+			mScales[i].load3(jsp->getScale().mV);
+			mWeights[i] = weight;
+			mUsages[i] = jsp->getUsage();
+			mAdditive[i] = jsbp->mAdditiveBlends[row] ? 1 : 0;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// blendRow()
+//-----------------------------------------------------------------------------
+void LLJointBlendBatch::blendRow(U32 row)
+{
+	const U32 base = row * mCount;
+	for (U32 k = 0; k < mCount; ++k)
+	{
+		const U32 i = base + k;
+		const U32 current_usage = mUsages[i];
+		if (!current_usage)
+		{
+			continue;
+		}
+		const F32 current_weight = mWeights[i];
+
+		if (mAdditive[i])
+		{
+			if (current_usage & LLJointState::POS)
+			{
+				LLVector4a added = mPositions[i];
+				added.mul(llmin(1.f, current_weight + mPositionWeights[k]) - mPositionWeights[k]);
+				mAddedPositions[k].add(added);
+			}
+
+			if (current_usage & LLJointState::SCALE)
+			{
+				LLVector4a added = mScales[i];
+				added.mul(llmin(1.f, current_weight + mScaleWeights[k]) - mScaleWeights[k]);
+				mAddedScales[k].add(added);
+			}
+
+			if (current_usage & LLJointState::ROT)
+			{
+				const F32 new_weight_sum = llmin(1.f, current_weight + mRotationWeights[k]);
+				LLQuaternion& added_rot = mAddedRotations[k];
+				added_rot = nlerp((new_weight_sum - mRotationWeights[k]), added_rot, to_quaternion(mRotations[i])) * added_rot;
+			}
+			continue;
+		}
+
+		const U32 sum_usage = mBlendedUsages[k];
+
+		if (current_usage & LLJointState::POS)
+		{
+			if (sum_usage & LLJointState::POS)
+			{
+				const F32 new_weight_sum = llmin(1.f, current_weight + mPositionWeights[k]);
+				LLVector4a blended;
+				blended.setLerp(mPositions[i], mBlendedPositions[k], mPositionWeights[k] / new_weight_sum);
+				mBlendedPositions[k] = blended;
+				mPositionWeights[k] = new_weight_sum;
+			}
+			else
+			{
+				mBlendedPositions[k] = mPositions[i];
+				mPositionWeights[k] = current_weight;
+			}
+		}
+
+		if (current_usage & LLJointState::SCALE)
+		{
+			if (sum_usage & LLJointState::SCALE)
+			{
+				const F32 new_weight_sum = llmin(1.f, current_weight + mScaleWeights[k]);
+				LLVector4a blended;
+				blended.setLerp(mScales[i], mBlendedScales[k], mScaleWeights[k] / new_weight_sum);
+				mBlendedScales[k] = blended;
+				mScaleWeights[k] = new_weight_sum;
+			}
+			else
+			{
+				mBlendedScales[k] = mScales[i];
+				mScaleWeights[k] = current_weight;
+			}
+		}
+
+		if (current_usage & LLJointState::ROT)
+		{
+			if (sum_usage & LLJointState::ROT)
+			{
+				const F32 new_weight_sum = llmin(1.f, current_weight + mRotationWeights[k]);
+				nlerp_rotation(mRotationWeights[k] / new_weight_sum, mRotations[i], mBlendedRotations[k]);
+				mRotationWeights[k] = new_weight_sum;
+			}
+			else
+			{
+				mBlendedRotations[k] = mRotations[i];
+				mRotationWeights[k] = current_weight;
+			}
+		}
+
+		mBlendedUsages[k] = sum_usage | current_usage;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// apply()
+//-----------------------------------------------------------------------------
+void LLJointBlendBatch::apply(const std::vector<LLJointStateBlender*>& blenders, BOOL apply_now)
+{
+	for (U32 k = 0; k < mCount; ++k)
+	{
+		LLVector4a& added_scale = mAddedScales[k];
+		if (!added_scale.isFinite3())
+		{
+			added_scale.clear();
+		}
+
+		LLVector4a& blended_scale = mBlendedScales[k];
+		if (!blended_scale.isFinite3())
+		{
+			blended_scale.set(1.f, 1.f, 1.f);
+		}
+
+		LLVector4a position;
+		position.setAdd(mBlendedPositions[k], mAddedPositions[k]);
+		LLVector4a scale;
+		scale.setAdd(blended_scale, added_scale);
+
+		// SL-315
+		LLJoint* target_joint = mTargets[k];
+		target_joint->setPosition(LLVector3(position.getF32ptr()));
+		target_joint->setScale(LLVector3(scale.getF32ptr()));
+		target_joint->setRotation(mAddedRotations[k] * to_quaternion(mBlendedRotations[k]));
+
+		if (apply_now)
+		{
+			blenders[k]->clear();
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // LLPoseBlender
 //-----------------------------------------------------------------------------
@@ -465,19 +743,17 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
 	for(LLJointState* jsp = pose->getFirstJointState(); jsp; jsp = pose->getNextJointState())
 	{
 		LLJoint *jointp = jsp->getJoint();
-		LLJointStateBlender* joint_blender;
-		if (mJointStateBlenderPool.find(jointp) == mJointStateBlenderPool.end())
+		LLJointStateBlender*& joint_blender = mJointStateBlenderPool[jointp];
+		if (!joint_blender)
 		{
 			// this is the first time we are animating this joint
 			// so create new jointblender and add it to our pool
 			joint_blender = new LLJointStateBlender();
-			mJointStateBlenderPool[jointp] = joint_blender;
-		}
-		else
-		{
-			joint_blender = mJointStateBlenderPool[jointp];
 		}
 
+		// a blender holds joint states exactly while it is on the active
+		// list, so only the first state added to it this frame adds it
+		const bool was_active = joint_blender->isActive();
 		if (jsp->getPriority() == LLJoint::USE_MOTION_PRIORITY)
 		{
 			joint_blender->addJointState(jsp, motion->getPriority(), motion->getBlendType() == LLMotion::ADDITIVE_BLEND);
@@ -488,7 +764,7 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
 		}
 
 		// add it to our list of active blenders
-		if (std::find(mActiveBlenders.begin(), mActiveBlenders.end(), joint_blender) == mActiveBlenders.end())
+		if (!was_active && joint_blender->isActive())
 		{
 			mActiveBlenders.emplace_back(joint_blender);
 		}
@@ -501,10 +777,7 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
 //-----------------------------------------------------------------------------
 void LLPoseBlender::blendAndApply()
 {
-	for(LLJointStateBlender* jsbp : mActiveBlenders)
-	{
-		jsbp->blendJointStates();
-	}
+	mBlendBatch.blend(mActiveBlenders, TRUE);
 
 	// we're done now so there are no more active blenders for this frame
 	mActiveBlenders.clear();
@@ -515,14 +788,14 @@ void LLPoseBlender::blendAndApply()
 //-----------------------------------------------------------------------------
 void LLPoseBlender::blendAndCache(BOOL reset_cached_joints)
 {
-	for (LLJointStateBlender* jsbp : mActiveBlenders)
+	if (reset_cached_joints)
 	{
-		if (reset_cached_joints)
+		for (LLJointStateBlender* jsbp : mActiveBlenders)
 		{
 			jsbp->resetCachedJoint();
 		}
-		jsbp->blendJointStates(FALSE);
 	}
+	mBlendBatch.blend(mActiveBlenders, FALSE);
 }
 
 //-----------------------------------------------------------------------------
@@ -34,6 +34,7 @@
 #include "lljointstate.h"
 #include "lljoint.h"
 #include "llpointer.h"
+#include "llvector4a.h"
 
 #include "absl/container/flat_hash_map.h"
 
@@ -81,6 +82,7 @@ const S32 JSB_NUM_JOINT_STATES = 6;
 
 class LLJointStateBlender
 {
+	friend class LLJointBlendBatch;
 protected:
 	LLPointer<LLJointState>	mJointStates[JSB_NUM_JOINT_STATES];
 	S32				mPriorities[JSB_NUM_JOINT_STATES];
@@ -93,11 +95,57 @@ public:
 	void interpolate(F32 u);
 	void clear();
 	void resetCachedJoint();
+	// Has joint states to blend, filled from slot zero
+	bool isActive() const { return mJointStates[0].notNull(); }
 
 public:
 	LLJoint mJointCache;
 };
 
+// Blends the joint states of many blenders together, giving the poses
+// blendJointStates() gives one blender at a time. The states are laid out by
+// field with slot N of every blender in row N, so blending is one pass over
+// the arrays per row with positions, scales and rotations in SIMD registers.
+class LLJointBlendBatch
+{
+public:
+	LLJointBlendBatch() : mCount(0), mRows(0) {}
+
+	// Blends the joint states of every blender, applying the result to the
+	// joints or caching it as LLJointStateBlender::blendJointStates() does
+	void blend(const std::vector<LLJointStateBlender*>& blenders, BOOL apply_now);
+
+private:
+	void gather(const std::vector<LLJointStateBlender*>& blenders, BOOL apply_now);
+	void blendRow(U32 row);
+	void apply(const std::vector<LLJointStateBlender*>& blenders, BOOL apply_now);
+
+	U32 mCount;
+	U32 mRows;
+
+	// Slot row of blender k at row * mCount + k, with no usage where the
+	// blender has no state in that slot or the state has no weight
+	std::vector<LLVector4a> mPositions;
+	std::vector<LLVector4a> mRotations;
+	std::vector<LLVector4a> mScales;
+	std::vector<F32> mWeights;
+	std::vector<U32> mUsages;
+	std::vector<U8> mAdditive;
+
+	// The blend so far of blender k
+	std::vector<LLJoint*> mTargets;
+	std::vector<LLVector4a> mBlendedPositions;
+	std::vector<LLVector4a> mBlendedRotations;
+	std::vector<LLVector4a> mBlendedScales;
+	std::vector<LLVector4a> mAddedPositions;
+	std::vector<LLVector4a> mAddedScales;
+	std::vector<LLQuaternion> mAddedRotations;
+	std::vector<F32> mPositionWeights;
+	std::vector<F32> mRotationWeights;
+	std::vector<F32> mScaleWeights;
+	std::vector<U32> mBlendedUsages;
+};
+
 class LLMotion;
 
 class LLPoseBlender
@@ -107,6 +155,7 @@ protected:
 	typedef absl::flat_hash_map<LLJoint*,LLJointStateBlender*> blender_map_t;
 	blender_map_t mJointStateBlenderPool;
 	blender_list_t mActiveBlenders;
+	LLJointBlendBatch mBlendBatch;
 
 	S32			mNextPoseSlot;
 	LLPose		mBlendedPose;
@@ -0,0 +1,281 @@
+/**
+ * @file llanimationstage_test.cpp
+ * @brief LLAnimationStage test cases.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llanimationstage.h"
+#include "../llcharacter.h"
+#include "../llkeyframemotion.h"
+
+#include "llframetimer.h"
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <memory>
+#include <vector>
+
+#include "../test/lltut.h"
+#include "llcharactertestutil.h"
+
+namespace
+{
+	const U32 JOINT_COUNT = 60;			// animated ones, under mRoot
+	const U32 KEY_COUNT = 24;
+	const F32 ANIM_DURATION = 2.f;
+	const U32 BENCH_CHARACTERS = 100;
+	const U32 BENCH_FRAMES = 100;
+
+	const LLUUID KEYFRAME_ID("6b9e2a5c-3f41-4f0e-9d8a-1c2b3d4e5f60");
+	const LLUUID REQUESTING_ID("0f3c6d2e-8a7b-4c59-b1e2-7d6c5b4a3f21");
+
+	// Asks for its character's visual params to be updated, and stops
+	// itself, on every update
+	class RequestingMotion : public LLMotion
+	{
+	public:
+		RequestingMotion(const LLUUID& id) : LLMotion(id), mCharacter(nullptr) {}
+		static LLMotion* create(const LLUUID& id)	{ return new RequestingMotion(id); }
+
+		/*virtual*/ BOOL getLoop() override							{ return TRUE; }
+		/*virtual*/ F32 getDuration() override						{ return 0.f; }
+		/*virtual*/ F32 getEaseInDuration() override				{ return 0.f; }
+		/*virtual*/ F32 getEaseOutDuration() override				{ return 0.f; }
+		/*virtual*/ LLJoint::JointPriority getPriority() override	{ return LLJoint::HIGH_PRIORITY; }
+		/*virtual*/ LLMotionBlendType getBlendType() override		{ return NORMAL_BLEND; }
+		/*virtual*/ F32 getMinPixelArea() override					{ return 0.f; }
+		/*virtual*/ LLMotionInitStatus onInitialize(LLCharacter* character) override
+		{
+			mCharacter = character;
+			LLPointer<LLJointState> joint_state = new LLJointState(character->getJoint("mPelvis"));
+			joint_state->setUsage(LLJointState::ROT);
+			addJointState(joint_state);
+			return STATUS_SUCCESS;
+		}
+		/*virtual*/ BOOL onActivate() override						{ return TRUE; }
+		/*virtual*/ BOOL onUpdate(F32 time, U8* joint_mask) override
+		{
+			mCharacter->requestUpdateVisualParams();
+			return FALSE;
+		}
+		/*virtual*/ void onDeactivate() override					{}
+
+	private:
+		LLCharacter* mCharacter;
+	};
+
+	typedef std::vector<std::unique_ptr<TestCharacter> > crowd_t;
+
+	F32 max_difference(const TestCharacter& a, const TestCharacter& b)
+	{
+		F32 largest = 0.f;
+		for (U32 i = 0; i < a.mJoints.size(); ++i)
+		{
+			const LLMatrix4& ma = a.mJoints[i]->getXform()->getWorldMatrix();
+			const LLMatrix4& mb = b.mJoints[i]->getXform()->getWorldMatrix();
+			for (U32 r = 0; r < 4; ++r)
+			{
+				for (U32 c = 0; c < 4; ++c)
+				{
+					largest = llmax(largest, fabsf(ma.mMatrix[r][c] - mb.mMatrix[r][c]));
+				}
+			}
+		}
+		return largest;
+	}
+
+	// Characters playing the animation from different points, all made in
+	// the same frame so their clocks agree
+	void make_crowd(crowd_t& crowd, U32 count)
+	{
+		for (U32 i = 0; i < count; ++i)
+		{
+			crowd.emplace_back(new TestCharacter(JOINT_COUNT, true));
+			crowd.back()->startMotion(KEYFRAME_ID, i * ANIM_DURATION / count);
+		}
+	}
+}
+
+namespace tut
+{
+	struct animationstage_data
+	{
+		animationstage_data()
+		{
+			static bool seeded = false;
+			if (!seeded)
+			{
+				seeded = true;
+				TestCharacter character(JOINT_COUNT, true);
+				character.registerMotion(KEYFRAME_ID, LLKeyframeMotion::create);
+				character.registerMotion(REQUESTING_ID, RequestingMotion::create);
+
+				std::vector<U8> buffer;
+				const S32 size = pack_clip(buffer, 7, JOINT_COUNT, KEY_COUNT, ANIM_DURATION);
+				ClipMotion seed(KEYFRAME_ID);
+				mLoaded = seed.load(&character, buffer, size);
+			}
+		}
+
+		static BOOL mLoaded;
+	};
+	BOOL animationstage_data::mLoaded = FALSE;
+
+	typedef test_group<animationstage_data> animationstage_test;
+	typedef animationstage_test::object animationstage_object;
+	tut::animationstage_test animationstage_testcase("LLAnimationStage");
+
+	template<> template<>
+	void animationstage_object::test<1>()
+	{
+		set_test_name("requests wait for the end of the update");
+		TestCharacter character(JOINT_COUNT, true);
+		character.startMotion(REQUESTING_ID);
+		// Activating updates once, outside any evaluation
+		ensure_equals("updated on activation", character.mVisualParamUpdates, 1);
+		ensure_equals("not stopped yet", character.mStopRequests, 0);
+
+		character.beginUpdateMotions(LLCharacter::NORMAL_UPDATE);
+		character.evaluatePose();
+		ensure_equals("visual params wait", character.mVisualParamUpdates, 1);
+		ensure_equals("stop request waits", character.mStopRequests, 0);
+
+		ensure("visual params updated at the end", character.endUpdateMotions());
+		ensure_equals("visual params", character.mVisualParamUpdates, 2);
+		ensure_equals("stop request", character.mStopRequests, 1);
+		ensure("nothing while evaluating", !character.mUpdatedWhileEvaluating);
+
+		// Easing out it still asks, until it is deactivated
+		for (U32 frame = 0; frame < 3; ++frame)
+		{
+			ms_sleep(5);
+			LLFrameTimer::updateFrameTime();
+			character.beginUpdateMotions(LLCharacter::NORMAL_UPDATE);
+			character.evaluatePose();
+			character.endUpdateMotions();
+		}
+		ensure("deactivated", !character.isMotionActive(REQUESTING_ID));
+		ensure_equals("stopped once", character.mStopRequests, 1);
+		ensure("nothing while evaluating", !character.mUpdatedWhileEvaluating);
+
+		const S32 updates = character.mVisualParamUpdates;
+		character.beginUpdateMotions(LLCharacter::NORMAL_UPDATE);
+		character.evaluatePose();
+		ensure("nothing more", !character.endUpdateMotions());
+		ensure_equals("no visual params", character.mVisualParamUpdates, updates);
+	}
+
+	template<> template<>
+	void animationstage_object::test<2>()
+	{
+		set_test_name("stage matches updating one at a time");
+		ensure("animation loaded", mLoaded);
+
+		crowd_t serial, staged;
+		make_crowd(serial, 16);
+		make_crowd(staged, 16);
+		ensure("keyframe motion playing", serial[0]->isMotionActive(KEYFRAME_ID));
+
+		LLAnimationStage stage;
+		for (U32 frame = 0; frame < 10; ++frame)
+		{
+			ms_sleep(5);
+			LLFrameTimer::updateFrameTime();
+			for (auto& character : serial)
+			{
+				character->update();
+			}
+
+			for (auto& character : staged)
+			{
+				character->beginUpdateMotions(LLCharacter::NORMAL_UPDATE);
+				stage.add(character.get());
+			}
+			stage.evaluate(4);
+			stage.clear();
+			for (auto& character : staged)
+			{
+				character->endUpdateMotions();
+			}
+
+			for (U32 i = 0; i < serial.size(); ++i)
+			{
+				ensure("same pose", max_difference(*serial[i], *staged[i]) < 1e-6f);
+			}
+		}
+		ensure("joints moved", max_difference(*serial[0], *serial[1]) > 1e-3f);
+	}
+
+	template<> template<>
+	void animationstage_object::test<3>()
+	{
+		set_test_name("crowd of characters");
+		ensure("animation loaded", mLoaded);
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time staged animation");
+		}
+
+		crowd_t serial, staged;
+		make_crowd(serial, BENCH_CHARACTERS);
+		make_crowd(staged, BENCH_CHARACTERS);
+
+		LLAnimationStage stage;
+		F64 times[2] = { 0.0, 0.0 };
+		LLTimer timer;
+		for (U32 frame = 0; frame < BENCH_FRAMES; ++frame)
+		{
+			LLFrameTimer::updateFrameTime();
+
+			timer.reset();
+			for (auto& character : serial)
+			{
+				character->update();
+			}
+			times[0] += timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (auto& character : staged)
+			{
+				character->beginUpdateMotions(LLCharacter::NORMAL_UPDATE);
+				stage.add(character.get());
+			}
+			stage.evaluate(stage.getDefaultRuns());
+			stage.clear();
+			for (auto& character : staged)
+			{
+				character->endUpdateMotions();
+			}
+			times[1] += timer.getElapsedTimeF64();
+		}
+
+		for (U32 i = 0; i < BENCH_CHARACTERS; ++i)
+		{
+			ensure("same result", max_difference(*serial[i], *staged[i]) < 1e-6f);
+		}
+		LL_INFOS() << BENCH_CHARACTERS << " characters of " << JOINT_COUNT << " animated joints over "
+				   << BENCH_FRAMES << " frames: one at a time " << times[0] * 1000.0
+				   << " ms, staged " << times[1] * 1000.0 << " ms" << LL_ENDL;
+	}
+}
@@ -0,0 +1,224 @@
+/**
+ * @file llcharactertestutil.h
+ * @brief Characters, animations and motions shared by the llcharacter tests
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLCHARACTERTESTUTIL_H
+#define LL_LLCHARACTERTESTUTIL_H
+
+#include "../llcharacter.h"
+#include "../lljoint.h"
+#include "../llkeyframemotion.h"
+
+#include "lldatapacker.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const U32 CLIP_BUFFER_SIZE = 512 * 1024;
+
+	U32 sSeed = 1;
+
+	U16 urand16()
+	{
+		sSeed = sSeed * 1664525 + 1013904223;
+		return (U16)(sSeed >> 16);
+	}
+
+	// Joint i of a test character, 0 being mRoot
+	std::string joint_name(U32 i)
+	{
+		return i == 1 ? std::string("mPelvis") : "joint" + std::to_string(i);
+	}
+
+	// A character with no renderer. Its joints hang under mRoot, mPelvis
+	// first, in a chain that branches now and then when asked to, placed as
+	// an avatar places its joints.
+	class TestCharacter : public LLCharacter
+	{
+	public:
+		TestCharacter(U32 joint_count, bool branching)
+		:	mID(LLUUID::generateNewID()),
+			mStopRequests(0),
+			mVisualParamUpdates(0),
+			mUpdatedWhileEvaluating(false)
+		{
+			sSeed = 1;
+			mJoints.emplace_back(new LLJoint);
+			mJoints[0]->setup("mRoot");
+			for (U32 i = 1; i <= joint_count; ++i)
+			{
+				mJoints.emplace_back(new LLJoint);
+				const bool branch = branching && i >= 3 && !(urand16() % 4);
+				LLJoint* parent = branch ? mJoints[urand16() % i].get() : mJoints[i - 1].get();
+				mJoints[i]->setup(joint_name(i), parent);
+				mJoints[i]->setJointNum(i - 1);
+				mJoints[i]->setPosition(LLVector3(0.f, 0.05f, 0.1f));
+			}
+			mJoints[0]->compileSkeleton();
+		}
+
+		~TestCharacter()
+		{
+			flushAllMotions();
+			// Children first
+			while (!mJoints.empty())
+			{
+				mJoints.pop_back();
+			}
+		}
+
+		/*virtual*/ const char* getAnimationPrefix() override		{ return "test"; }
+		/*virtual*/ LLJoint* getRootJoint() override				{ return mJoints[0].get(); }
+		/*virtual*/ LLVector3 getCharacterPosition() override		{ return LLVector3::zero; }
+		/*virtual*/ LLQuaternion getCharacterRotation() override	{ return LLQuaternion::DEFAULT; }
+		/*virtual*/ LLVector3 getCharacterVelocity() override		{ return LLVector3::zero; }
+		/*virtual*/ LLVector3 getCharacterAngularVelocity() override	{ return LLVector3::zero; }
+		/*virtual*/ void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm) override
+		{
+			out_pos = in_pos;
+			out_norm = LLVector3::z_axis;
+		}
+		/*virtual*/ LLJoint* getCharacterJoint(U32 i) override		{ return i < mJoints.size() ? mJoints[i].get() : nullptr; }
+		/*virtual*/ F32 getTimeDilation() override					{ return 1.f; }
+		/*virtual*/ F32 getPixelArea() const override				{ return 100000.f; }
+		/*virtual*/ LLPolyMesh* getHeadMesh() override				{ return nullptr; }
+		/*virtual*/ LLPolyMesh* getUpperBodyMesh() override			{ return nullptr; }
+		/*virtual*/ LLVector3d getPosGlobalFromAgent(const LLVector3& position) override	{ return LLVector3d(position); }
+		/*virtual*/ LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override	{ return LLVector3(position); }
+		/*virtual*/ void addDebugText(const std::string& text) override	{}
+		/*virtual*/ const LLUUID& getID() const override			{ return mID; }
+
+		/*virtual*/ void requestStopMotion(LLMotion* motion) override
+		{
+			++mStopRequests;
+			mUpdatedWhileEvaluating |= mEvaluatingMotions;
+		}
+		/*virtual*/ void updateVisualParams() override
+		{
+			++mVisualParamUpdates;
+			mUpdatedWhileEvaluating |= mEvaluatingMotions;
+			LLCharacter::updateVisualParams();
+		}
+
+		// As an avatar evaluates its pose, with its joints placed
+		/*virtual*/ void evaluatePose() override
+		{
+			evaluateMotions();
+			getRootJoint()->updateWorldMatrixChildren();
+		}
+
+		// The same, in one go on this thread
+		void update()
+		{
+			updateMotions(NORMAL_UPDATE);
+			getRootJoint()->updateWorldMatrixChildren();
+		}
+
+		LLUUID mID;
+		std::vector<std::unique_ptr<LLJoint> > mJoints;
+		S32 mStopRequests;
+		S32 mVisualParamUpdates;
+		bool mUpdatedWhileEvaluating;
+	};
+
+	// Takes an animation from a buffer, as a fetched asset would be, leaving
+	// it in the keyframe cache for the characters' own instances to find
+	class ClipMotion : public LLKeyframeMotion
+	{
+	public:
+		ClipMotion(const LLUUID& id) : LLKeyframeMotion(id) {}
+		static LLMotion* create(const LLUUID& id)	{ return new ClipMotion(id); }
+
+		BOOL load(LLCharacter* character, const std::vector<U8>& buffer, S32 size)
+		{
+			mCharacter = character;
+			LLDataPackerBinaryBuffer dp(const_cast<U8*>(&buffer[0]), size);
+			return deserialize(dp, getID());
+		}
+
+		const JointMotionList* getJointMotionList() const	{ return mJointMotionList; }
+	};
+
+	// A looping animation in the format LLKeyframeMotion::serialize()
+	// writes, each joint turning through its own keys and the pelvis moving
+	// too, as an uploaded animation has them
+	S32 pack_clip(std::vector<U8>& buffer, U32 seed, U32 joints, U32 keys, F32 duration)
+	{
+		buffer.resize(CLIP_BUFFER_SIZE);
+		LLDataPackerBinaryBuffer dp(&buffer[0], CLIP_BUFFER_SIZE);
+		dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+		dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+		dp.packS32(LLJoint::MEDIUM_PRIORITY, "base_priority");
+		dp.packF32(duration, "duration");
+		dp.packString(std::string(), "emote_name");
+		dp.packF32(0.f, "loop_in_point");
+		dp.packF32(duration, "loop_out_point");
+		dp.packS32(1, "loop");
+		dp.packF32(0.3f, "ease_in_duration");
+		dp.packF32(0.3f, "ease_out_duration");
+		dp.packU32(0, "hand_pose");
+		dp.packU32(joints, "num_joints");
+
+		sSeed = seed;
+		for (U32 i = 1; i <= joints; ++i)
+		{
+			dp.packString(joint_name(i), "joint_name");
+			dp.packS32(LLJoint::MEDIUM_PRIORITY, "joint_priority");
+
+			// Not every joint keyed as often, some keys sharing a time
+			const U32 rot_keys = keys / (1 + i % 3) + 1;
+			dp.packS32(rot_keys, "num_rot_keys");
+			U16 time = 0;
+			for (U32 k = 0; k < rot_keys; ++k)
+			{
+				if (k % 7 != 3)
+				{
+					time = (U16)(k * 65535 / rot_keys);
+				}
+				dp.packU16(time, "time");
+				// Turns well inside the unit vector packing
+				dp.packU16(32768 + urand16() % 16384 - 8192, "rot_angle_x");
+				dp.packU16(32768 + urand16() % 16384 - 8192, "rot_angle_y");
+				dp.packU16(32768 + urand16() % 16384 - 8192, "rot_angle_z");
+			}
+
+			const U32 pos_keys = (i == 1) ? keys : 0;
+			dp.packS32(pos_keys, "num_pos_keys");
+			for (U32 k = 0; k < pos_keys; ++k)
+			{
+				dp.packU16((U16)(k * 65535 / llmax(pos_keys - 1, 1U)), "time");
+				dp.packU16(32768 + urand16() % 1024 - 512, "pos_x");
+				dp.packU16(32768 + urand16() % 1024 - 512, "pos_y");
+				dp.packU16(32768 + urand16() % 1024 - 512, "pos_z");
+			}
+		}
+		dp.packS32(0, "num_constraints");
+		return dp.getCurrentSize();
+	}
+}
+
+#endif // LL_LLCHARACTERTESTUTIL_H
@@ -0,0 +1,280 @@
+/**
+ * @file llcompiledskeleton_test.cpp
+ * @brief LLCompiledSkeleton test cases.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcompiledskeleton.h"
+#include "../lljoint.h"
+
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <memory>
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// About as many as an avatar has, counting collision volumes and
+	// attachment points
+	const U32 JOINT_COUNT = 200;
+	const U32 BENCH_AVATARS = 50;
+	const U32 BENCH_FRAMES = 100;
+
+	U32 sSeed = 1;
+
+	F32 frand(F32 low, F32 high)
+	{
+		sSeed = sSeed * 1664525 + 1013904223;
+		return low + (high - low) * (F32)(sSeed >> 8) / (F32)(1 << 24);
+	}
+
+	LLQuaternion random_rotation()
+	{
+		return LLQuaternion(frand(-F_PI, F_PI), LLVector3(frand(-1.f, 1.f), frand(-1.f, 1.f), frand(0.1f, 1.f)));
+	}
+
+	// Joints in chains, each new one usually continuing the last chain and
+	// sometimes branching off an earlier joint. The same seed gives the
+	// same tree.
+	struct Skeleton
+	{
+		explicit Skeleton(U32 seed)
+		{
+			sSeed = seed;
+			for (U32 i = 0; i < JOINT_COUNT; ++i)
+			{
+				mJoints.emplace_back(new LLJoint);
+				LLJoint* parent = nullptr;
+				if (i)
+				{
+					parent = frand(0.f, 1.f) < 0.7f ? mJoints[i - 1].get() : mJoints[(U32)frand(0.f, (F32)i)].get();
+				}
+				mJoints[i]->setup("joint" + std::to_string(i), parent);
+				mJoints[i]->setPosition(LLVector3(frand(-0.3f, 0.3f), frand(-0.3f, 0.3f), frand(0.f, 0.5f)));
+				mJoints[i]->setRotation(random_rotation());
+				mJoints[i]->setScale(LLVector3(frand(0.8f, 1.2f), frand(0.8f, 1.2f), frand(0.8f, 1.2f)));
+			}
+		}
+
+		~Skeleton()
+		{
+			// Children first
+			while (!mJoints.empty())
+			{
+				mJoints.pop_back();
+			}
+		}
+
+		LLJoint* root() const		{ return mJoints[0].get(); }
+
+		std::vector<std::unique_ptr<LLJoint> > mJoints;
+	};
+
+	F32 max_difference(const Skeleton& a, const Skeleton& b)
+	{
+		F32 largest = 0.f;
+		for (U32 i = 0; i < JOINT_COUNT; ++i)
+		{
+			const LLXformMatrix* xa = a.mJoints[i]->getXform();
+			const LLXformMatrix* xb = b.mJoints[i]->getXform();
+			for (U32 r = 0; r < 4; ++r)
+			{
+				for (U32 c = 0; c < 4; ++c)
+				{
+					largest = llmax(largest, fabsf(xa->getWorldMatrix().mMatrix[r][c] - xb->getWorldMatrix().mMatrix[r][c]));
+				}
+				largest = llmax(largest, fabsf(xa->getWorldRotation().mQ[r] - xb->getWorldRotation().mQ[r]));
+			}
+			for (U32 k = 0; k < 3; ++k)
+			{
+				largest = llmax(largest, fabsf(xa->getWorldPosition().mV[k] - xb->getWorldPosition().mV[k]));
+			}
+		}
+		return largest;
+	}
+}
+
+namespace tut
+{
+	struct compiledskeleton_data
+	{
+	};
+	typedef test_group<compiledskeleton_data> compiledskeleton_test;
+	typedef compiledskeleton_test::object compiledskeleton_object;
+	tut::compiledskeleton_test compiledskeleton_testcase("LLCompiledSkeleton");
+
+	template<> template<>
+	void compiledskeleton_object::test<1>()
+	{
+		set_test_name("depth first numbering");
+		Skeleton skeleton(7);
+		LLCompiledSkeleton compiled(skeleton.root());
+		ensure("dirty until compiled", compiled.isDirty());
+		compiled.compile();
+		ensure("compiled", !compiled.isDirty());
+		ensure_equals("count", compiled.getJointCount(), (S32)JOINT_COUNT);
+		ensure("root first", compiled.getJoint(0) == skeleton.root());
+		ensure_equals("root has no parent", compiled.getParentIndex(0), -1);
+		ensure_equals("root spans all", compiled.getSubtreeEnd(0), (S32)JOINT_COUNT);
+
+		for (S32 i = 1; i < compiled.getJointCount(); ++i)
+		{
+			const S32 parent = compiled.getParentIndex(i);
+			ensure("parent comes first", parent >= 0 && parent < i);
+			ensure("parent matches", compiled.getJoint(parent) == compiled.getJoint(i)->getParent());
+			ensure("inside parent's run", compiled.getSubtreeEnd(i) <= compiled.getSubtreeEnd(parent));
+			ensure_equals("index", compiled.getJointIndex(compiled.getJoint(i)), i);
+		}
+		LLJoint stranger;
+		ensure_equals("not in the skeleton", compiled.getJointIndex(&stranger), -1);
+	}
+
+	template<> template<>
+	void compiledskeleton_object::test<2>()
+	{
+		set_test_name("matches the joint walk");
+		Skeleton walked(11), compiled(11);
+		compiled.root()->compileSkeleton();
+		ensure("root keeps it", compiled.root()->getCompiledSkeleton() != nullptr);
+
+		walked.root()->updateWorldMatrixChildren();
+		compiled.root()->updateWorldMatrixChildren();
+		ensure("first update", max_difference(walked, compiled) < 1e-4f);
+		for (U32 i = 0; i < JOINT_COUNT; ++i)
+		{
+			ensure_equals("clean", compiled.mJoints[i]->mDirtyFlags, 0U);
+		}
+
+		// Move a few joints, some of them with others under them
+		sSeed = 3;
+		for (U32 i : { 0U, 5U, 40U, 41U, 150U })
+		{
+			const LLQuaternion rot = random_rotation();
+			walked.mJoints[i]->setRotation(rot);
+			compiled.mJoints[i]->setRotation(rot);
+		}
+		walked.mJoints[60]->setScale(LLVector3(1.5f, 0.5f, 2.f));
+		compiled.mJoints[60]->setScale(LLVector3(1.5f, 0.5f, 2.f));
+		walked.root()->updateWorldMatrixChildren();
+		compiled.root()->updateWorldMatrixChildren();
+		ensure("after moves", max_difference(walked, compiled) < 1e-4f);
+
+		// Joints not updating keep their stale matrices, as do those under them
+		walked.mJoints[20]->mUpdateXform = FALSE;
+		compiled.mJoints[20]->mUpdateXform = FALSE;
+		walked.root()->setRotation(LLQuaternion());
+		compiled.root()->setRotation(LLQuaternion());
+		walked.root()->updateWorldMatrixChildren();
+		compiled.root()->updateWorldMatrixChildren();
+		ensure("skipping", max_difference(walked, compiled) < 1e-4f);
+		ensure("skipped stay dirty", compiled.mJoints[20]->mDirtyFlags & LLJoint::MATRIX_DIRTY);
+	}
+
+	template<> template<>
+	void compiledskeleton_object::test<3>()
+	{
+		set_test_name("compiled again when the tree changes");
+		Skeleton skeleton(5);
+		LLJoint* root = skeleton.root();
+		root->compileSkeleton();
+		LLCompiledSkeleton* compiled = root->getCompiledSkeleton();
+		root->updateWorldMatrixChildren();
+		ensure("compiled", !compiled->isDirty());
+
+		LLJoint extra;
+		extra.setup("extra", skeleton.mJoints[30].get());
+		ensure("dirty after adding", compiled->isDirty());
+		root->updateWorldMatrixChildren();
+		ensure_equals("one more", compiled->getJointCount(), (S32)JOINT_COUNT + 1);
+		ensure("extra found", compiled->getJointIndex(&extra) > compiled->getJointIndex(skeleton.mJoints[30].get()));
+
+		LLMatrix4 expected;
+		expected.initAll(extra.getScale(), extra.getRotation() * skeleton.mJoints[30]->getWorldRotation(),
+						 skeleton.mJoints[30]->getWorldPosition());
+		for (U32 r = 0; r < 4; ++r)
+		{
+			for (U32 c = 0; c < 4; ++c)
+			{
+				ensure_approximately_equals("extra placed", extra.getXform()->getWorldMatrix().mMatrix[r][c], expected.mMatrix[r][c], 16);
+			}
+		}
+
+		skeleton.mJoints[30]->removeChild(&extra);
+		ensure("dirty after removing", compiled->isDirty());
+		root->updateWorldMatrixChildren();
+		ensure_equals("back again", compiled->getJointCount(), (S32)JOINT_COUNT);
+	}
+
+	template<> template<>
+	void compiledskeleton_object::test<4>()
+	{
+		set_test_name("crowd of skeletons");
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time skeleton updates");
+		}
+
+		std::vector<std::unique_ptr<Skeleton> > walked, compiled;
+		for (U32 i = 0; i < BENCH_AVATARS; ++i)
+		{
+			walked.emplace_back(new Skeleton(i + 1));
+			compiled.emplace_back(new Skeleton(i + 1));
+			compiled.back()->root()->compileSkeleton();
+		}
+
+		// Every frame each avatar turns, dirtying all of its joints. Only
+		// the updates are timed.
+		F64 times[2] = { 0.0, 0.0 };
+		LLTimer timer;
+		for (U32 frame = 0; frame < BENCH_FRAMES; ++frame)
+		{
+			const LLQuaternion rot(frame * 0.01f, LLVector3::z_axis);
+			for (U32 pass = 0; pass < 2; ++pass)
+			{
+				std::vector<std::unique_ptr<Skeleton> >& avatars = pass ? compiled : walked;
+				for (auto& avatar : avatars)
+				{
+					avatar->root()->setRotation(rot);
+				}
+				timer.reset();
+				for (auto& avatar : avatars)
+				{
+					avatar->root()->updateWorldMatrixChildren();
+				}
+				times[pass] += timer.getElapsedTimeF64();
+			}
+		}
+
+		for (U32 i = 0; i < BENCH_AVATARS; ++i)
+		{
+			ensure("same result", max_difference(*walked[i], *compiled[i]) < 1e-3f);
+		}
+		LL_INFOS() << BENCH_AVATARS << " skeletons of " << JOINT_COUNT << " joints over "
+				   << BENCH_FRAMES << " frames: joint walk " << times[0] * 1000.0
+				   << " ms, compiled " << times[1] * 1000.0 << " ms" << LL_ENDL;
+	}
+}
@@ -0,0 +1,297 @@
+/**
+ * @file llkeyframemotion_test.cpp
+ * @brief LLKeyframeMotion test cases.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llcharacter.h"
+#include "../llkeyframemotion.h"
+
+#include "lldatapacker.h"
+#include "llframetimer.h"
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "../test/lltut.h"
+#include "llcharactertestutil.h"
+
+namespace
+{
+	const U32 JOINT_COUNT = 40;			// animated ones, under mRoot
+	const F32 FRAME_TIME = 1.f / 60.f;
+	const U32 BENCH_FRAMES = 600;
+
+	// What LLKeyframeMotion's curves gave when they searched every time
+	template<class CURVE>
+	S32 search_key(const CURVE& curve, F32 time, F32 duration)
+	{
+		S32 k = 0;
+		while (k < curve.getNumKeys() && curve.getKeyTime(k, duration) < time)
+		{
+			++k;
+		}
+		return k;
+	}
+
+	LLQuaternion searched_rotation(const LLKeyframeMotion::RotationCurve& curve, F32 time, F32 duration)
+	{
+		const S32 right = search_key(curve, time, duration);
+		if (right == curve.getNumKeys())
+		{
+			return curve.getKey(right - 1);
+		}
+		if (right == 0 || curve.getKeyTime(right, duration) == time)
+		{
+			return curve.getKey(right);
+		}
+		const F32 before = curve.getKeyTime(right - 1, duration);
+		const F32 u = (time - before) / (curve.getKeyTime(right, duration) - before);
+		return nlerp(u, curve.getKey(right - 1), curve.getKey(right));
+	}
+
+	LLVector3 searched_position(const LLKeyframeMotion::PositionCurve& curve, F32 time, F32 duration)
+	{
+		const S32 right = search_key(curve, time, duration);
+		if (right == curve.getNumKeys())
+		{
+			return curve.getKey(right - 1);
+		}
+		if (right == 0 || curve.getKeyTime(right, duration) == time)
+		{
+			return curve.getKey(right);
+		}
+		const F32 before = curve.getKeyTime(right - 1, duration);
+		const F32 u = (time - before) / (curve.getKeyTime(right, duration) - before);
+		return lerp(curve.getKey(right - 1), curve.getKey(right), u);
+	}
+}
+
+namespace tut
+{
+	struct keyframemotion_data
+	{
+		~keyframemotion_data()
+		{
+			LLKeyframeDataCache::clear();
+		}
+	};
+	typedef test_group<keyframemotion_data> keyframemotion_test;
+	typedef keyframemotion_test::object keyframemotion_object;
+	tut::keyframemotion_test keyframemotion_testcase("LLKeyframeMotion");
+
+	template<> template<>
+	void keyframemotion_object::test<1>()
+	{
+		set_test_name("keys kept as the asset has them");
+		TestCharacter character(JOINT_COUNT, false);
+		std::vector<U8> buffer;
+		const S32 size = pack_clip(buffer, 3, JOINT_COUNT, 60, 4.f);
+
+		ClipMotion motion(LLUUID::generateNewID());
+		ensure("loaded", motion.load(&character, buffer, size));
+		ensure_equals("file size", (S32)motion.getFileSize(), size);
+
+		std::vector<U8> written(CLIP_BUFFER_SIZE);
+		LLDataPackerBinaryBuffer dp(&written[0], CLIP_BUFFER_SIZE);
+		ensure("written", motion.serialize(dp));
+		ensure_equals("same size", dp.getCurrentSize(), size);
+		ensure("same bytes", std::equal(buffer.begin(), buffer.begin() + size, written.begin()));
+	}
+
+	template<> template<>
+	void keyframemotion_object::test<2>()
+	{
+		set_test_name("cursor finds what a search finds");
+		TestCharacter character(JOINT_COUNT, false);
+		std::vector<U8> buffer;
+		const F32 duration = 3.f;
+		const S32 size = pack_clip(buffer, 5, JOINT_COUNT, 45, duration);
+
+		ClipMotion motion(LLUUID::generateNewID());
+		ensure("loaded", motion.load(&character, buffer, size));
+		const LLKeyframeMotion::JointMotionList* list = motion.getJointMotionList();
+
+		// Frames forward through several loops, then jumps about, before
+		// the first key, past the last and exactly on keys
+		std::vector<F32> times;
+		for (F32 t = 0.f; t < duration * 3.f; t += FRAME_TIME)
+		{
+			times.push_back(fmodf(t, duration));
+		}
+		sSeed = 9;
+		for (U32 i = 0; i < 200; ++i)
+		{
+			times.push_back((F32)urand16() / 65535.f * duration * 1.2f - 0.1f * duration);
+		}
+		const LLKeyframeMotion::RotationCurve& keyed = list->getJointMotion(2)->mRotationCurve;
+		for (S32 k = 0; k < keyed.getNumKeys(); k += 3)
+		{
+			times.push_back(keyed.getKeyTime(k, duration));
+		}
+
+		for (U32 i = 0; i < list->getNumJointMotions(); ++i)
+		{
+			const LLKeyframeMotion::JointMotion* joint_motion = list->getJointMotion(i);
+			LLKeyframeMotion::KeyCursor cursor;
+			for (F32 time : times)
+			{
+				const LLQuaternion rot = joint_motion->mRotationCurve.getValue(time, duration, cursor.mRotation);
+				const LLQuaternion expected_rot = searched_rotation(joint_motion->mRotationCurve, time, duration);
+				ensure("rotation", rot == expected_rot);
+				if (joint_motion->mPositionCurve.getNumKeys())
+				{
+					const LLVector3 pos = joint_motion->mPositionCurve.getValue(time, duration, cursor.mPosition);
+					ensure("position", pos == searched_position(joint_motion->mPositionCurve, time, duration));
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void keyframemotion_object::test<3>()
+	{
+		set_test_name("shared by every character playing it");
+		const LLUUID id = LLUUID::generateNewID();
+		std::vector<U8> buffer;
+		const S32 size = pack_clip(buffer, 7, JOINT_COUNT, 30, 2.f);
+		{
+			TestCharacter character(JOINT_COUNT, false);
+			ClipMotion seed(id);
+			ensure("loaded", seed.load(&character, buffer, size));
+		}
+		const LLKeyframeMotion::JointMotionList* cached = LLKeyframeDataCache::getKeyframeData(id);
+		ensure("cached", cached != nullptr);
+
+		LLFrameTimer::updateFrameTime();
+		TestCharacter first(JOINT_COUNT, false), second(JOINT_COUNT, false);
+		for (TestCharacter* character : { &first, &second })
+		{
+			character->registerMotion(id, ClipMotion::create);
+			ensure("started", character->startMotion(id, character == &first ? 0.f : 1.f));
+			ensure("playing", character->isMotionActive(id));
+			ensure("from the cache", static_cast<ClipMotion*>(character->findMotion(id))->getJointMotionList() == cached);
+		}
+
+		// Each keeps its own place in the curves
+		ms_sleep(5);
+		LLFrameTimer::updateFrameTime();
+		first.updateMotions(LLCharacter::NORMAL_UPDATE);
+		second.updateMotions(LLCharacter::NORMAL_UPDATE);
+		ensure("different poses", first.getJoint("joint5")->getRotation() != second.getJoint("joint5")->getRotation());
+	}
+
+	template<> template<>
+	void keyframemotion_object::test<4>()
+	{
+		set_test_name("set of animations");
+
+		// Shaped like the animations built into the viewer: mostly short,
+		// a few long, some of the whole body and some of a few joints
+		struct Shape { U32 mJoints; U32 mKeys; F32 mDuration; };
+		const Shape shapes[] = {
+			{ 40, 30, 1.f }, { 40, 60, 2.f }, { 20, 90, 3.f }, { 40, 150, 5.f },
+			{ 10, 30, 1.f }, { 30, 300, 10.f }, { 40, 120, 4.f }, { 15, 45, 1.5f },
+			{ 40, 240, 8.f }, { 25, 60, 2.f }, { 40, 90, 3.f }, { 8, 20, 0.7f },
+		};
+
+		TestCharacter character(JOINT_COUNT, false);
+		std::vector<std::unique_ptr<ClipMotion> > clips;
+		U32 seed = 1;
+		for (const Shape& shape : shapes)
+		{
+			std::vector<U8> buffer;
+			const S32 size = pack_clip(buffer, seed++, shape.mJoints, shape.mKeys, shape.mDuration);
+			clips.emplace_back(new ClipMotion(LLUUID::generateNewID()));
+			ensure("loaded", clips.back()->load(&character, buffer, size));
+		}
+
+		// What the keys took when decoded into time and value pairs
+		U32 packed = 0, decoded = 0, keys = 0;
+		const U32 rot_key_size = sizeof(F32) * 2 + sizeof(LLQuaternion);
+		const U32 pos_key_size = sizeof(F32) * 2 + sizeof(LLVector3);
+		for (auto& clip : clips)
+		{
+			const LLKeyframeMotion::JointMotionList* list = clip->getJointMotionList();
+			packed += list->getMemoryUsage();
+			decoded += list->getMemoryUsage();
+			for (U32 i = 0; i < list->getNumJointMotions(); ++i)
+			{
+				const LLKeyframeMotion::JointMotion* joint_motion = list->getJointMotion(i);
+				const U32 rot_keys = joint_motion->mRotationCurve.getNumKeys();
+				const U32 pos_keys = joint_motion->mPositionCurve.getNumKeys();
+				keys += rot_keys + pos_keys;
+				decoded += rot_keys * rot_key_size + pos_keys * pos_key_size;
+				decoded -= joint_motion->mRotationCurve.getMemoryUsage() + joint_motion->mPositionCurve.getMemoryUsage();
+			}
+		}
+		ensure("smaller", packed < decoded);
+
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time key lookups");
+		}
+
+		// Every joint of every animation over frames, finding keys from the
+		// cursors or searching for them each time
+		F64 times[2] = { 0.0, 0.0 };
+		LLTimer timer;
+		F32 sum = 0.f;
+		for (U32 pass = 0; pass < 2; ++pass)
+		{
+			timer.reset();
+			for (auto& clip : clips)
+			{
+				const LLKeyframeMotion::JointMotionList* list = clip->getJointMotionList();
+				const F32 duration = list->mDuration;
+				std::vector<LLKeyframeMotion::KeyCursor> cursors(list->getNumJointMotions());
+				for (U32 frame = 0; frame < BENCH_FRAMES; ++frame)
+				{
+					const F32 time = fmodf(frame * FRAME_TIME, duration);
+					for (U32 i = 0; i < list->getNumJointMotions(); ++i)
+					{
+						const LLKeyframeMotion::JointMotion* joint_motion = list->getJointMotion(i);
+						LLKeyframeMotion::KeyCursor& cursor = cursors[i];
+						if (pass == 0)
+						{
+							cursor.mRotation = joint_motion->mRotationCurve.getNumKeys();
+							cursor.mPosition = joint_motion->mPositionCurve.getNumKeys();
+						}
+						sum += joint_motion->mRotationCurve.getValue(time, duration, cursor.mRotation).mQ[VW];
+						sum += joint_motion->mPositionCurve.getValue(time, duration, cursor.mPosition).mV[VZ];
+					}
+				}
+			}
+			times[pass] = timer.getElapsedTimeF64();
+		}
+		ensure("evaluated", llfinite(sum));
+
+		LL_INFOS() << clips.size() << " animations of " << keys << " keys: " << packed << " bytes packed, "
+				   << decoded << " bytes decoded; " << BENCH_FRAMES << " frames searching "
+				   << times[0] * 1000.0 << " ms, from cursors " << times[1] * 1000.0 << " ms" << LL_ENDL;
+	}
+}
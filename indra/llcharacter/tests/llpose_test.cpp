@@ -0,0 +1,271 @@
+/**
+ * @file llpose_test.cpp
+ * @brief LLJointBlendBatch test cases.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpose.h"
+
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <memory>
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// About as many as an avatar animates
+	const U32 JOINT_COUNT = 150;
+	const U32 BENCH_AVATARS = 50;
+	const U32 BENCH_FRAMES = 100;
+
+	U32 sSeed = 1;
+
+	F32 frand(F32 low, F32 high)
+	{
+		sSeed = sSeed * 1664525 + 1013904223;
+		return low + (high - low) * (F32)(sSeed >> 8) / (F32)(1 << 24);
+	}
+
+	LLQuaternion random_rotation()
+	{
+		return LLQuaternion(frand(-F_PI, F_PI), LLVector3(frand(-1.f, 1.f), frand(-1.f, 1.f), frand(0.1f, 1.f)));
+	}
+
+	LLVector3 random_vector(F32 low, F32 high)
+	{
+		return LLVector3(frand(low, high), frand(low, high), frand(low, high));
+	}
+
+	// Joints each with a blender holding the states of a few motions, as a
+	// character's pose blender has them after adding its motions. The same
+	// seed gives the same joints and states.
+	struct Blended
+	{
+		explicit Blended(U32 seed)
+		{
+			sSeed = seed;
+			for (U32 i = 0; i < JOINT_COUNT; ++i)
+			{
+				mJoints.emplace_back(new LLJoint("joint" + std::to_string(i)));
+				mJoints[i]->setPosition(random_vector(-0.3f, 0.3f));
+				mJoints[i]->setRotation(random_rotation());
+				mJoints[i]->setScale(random_vector(0.8f, 1.2f));
+				mBlenders.emplace_back(new LLJointStateBlender);
+			}
+			addStates();
+		}
+
+		~Blended()
+		{
+			for (LLJointStateBlender* blender : mBlenders)
+			{
+				delete blender;
+			}
+		}
+
+		// Adds the states of another frame
+		void addStates()
+		{
+			for (U32 i = 0; i < JOINT_COUNT; ++i)
+			{
+				const U32 states = 1 + (U32)frand(0.f, (F32)JSB_NUM_JOINT_STATES);
+				for (U32 s = 0; s < states; ++s)
+				{
+					LLPointer<LLJointState> state = new LLJointState(mJoints[i].get());
+					state->setUsage(LLJointState::POS | LLJointState::ROT | LLJointState::SCALE);
+					state->setPosition(random_vector(-0.3f, 0.3f));
+					LLQuaternion rot = random_rotation();
+					if (frand(0.f, 1.f) < 0.3f)
+					{
+						// the other way round, which blends by slerp
+						rot = LLQuaternion(-rot.mQ[VX], -rot.mQ[VY], -rot.mQ[VZ], -rot.mQ[VW]);
+					}
+					state->setRotation(rot);
+					state->setScale(random_vector(0.8f, 1.2f));
+					state->setUsage(1 + (U32)frand(0.f, 7.f));
+					state->setWeight(frand(0.f, 1.f) < 0.1f ? 0.f : frand(0.1f, 1.f));
+					mBlenders[i]->addJointState(state, (S32)frand(0.f, 4.f), frand(0.f, 1.f) < 0.25f);
+				}
+			}
+		}
+
+		std::vector<std::unique_ptr<LLJoint> > mJoints;
+		std::vector<LLJointStateBlender*> mBlenders;
+	};
+
+	F32 max_difference(LLJoint* a, LLJoint* b)
+	{
+		F32 largest = 0.f;
+		for (U32 k = 0; k < 3; ++k)
+		{
+			largest = llmax(largest, fabsf(a->getPosition().mV[k] - b->getPosition().mV[k]));
+			largest = llmax(largest, fabsf(a->getScale().mV[k] - b->getScale().mV[k]));
+		}
+		for (U32 k = 0; k < 4; ++k)
+		{
+			largest = llmax(largest, fabsf(a->getRotation().mQ[k] - b->getRotation().mQ[k]));
+		}
+		return largest;
+	}
+
+	F32 max_difference(const Blended& a, const Blended& b)
+	{
+		F32 largest = 0.f;
+		for (U32 i = 0; i < JOINT_COUNT; ++i)
+		{
+			largest = llmax(largest, max_difference(a.mJoints[i].get(), b.mJoints[i].get()));
+		}
+		return largest;
+	}
+
+	F32 max_cache_difference(const Blended& a, const Blended& b)
+	{
+		F32 largest = 0.f;
+		for (U32 i = 0; i < JOINT_COUNT; ++i)
+		{
+			largest = llmax(largest, max_difference(&a.mBlenders[i]->mJointCache, &b.mBlenders[i]->mJointCache));
+		}
+		return largest;
+	}
+}
+
+namespace tut
+{
+	struct pose_data
+	{
+	};
+	typedef test_group<pose_data> pose_test;
+	typedef pose_test::object pose_object;
+	tut::pose_test pose_testcase("LLPose");
+
+	template<> template<>
+	void pose_object::test<1>()
+	{
+		set_test_name("batch blend matches each blender");
+		Blended single(7), batched(7);
+		LLJointBlendBatch batch;
+
+		for (U32 frame = 0; frame < 3; ++frame)
+		{
+			for (LLJointStateBlender* blender : single.mBlenders)
+			{
+				blender->blendJointStates();
+			}
+			batch.blend(batched.mBlenders, TRUE);
+			ensure("same pose", max_difference(single, batched) < 1e-5f);
+			for (LLJointStateBlender* blender : batched.mBlenders)
+			{
+				ensure("states cleared", !blender->isActive());
+			}
+
+			sSeed = frame + 100;
+			single.addStates();
+			sSeed = frame + 100;
+			batched.addStates();
+		}
+	}
+
+	template<> template<>
+	void pose_object::test<2>()
+	{
+		set_test_name("batch blend caches as each blender does");
+		Blended single(9), batched(9);
+		LLJointBlendBatch batch;
+
+		for (LLJointStateBlender* blender : single.mBlenders)
+		{
+			blender->resetCachedJoint();
+			blender->blendJointStates(FALSE);
+		}
+		for (LLJointStateBlender* blender : batched.mBlenders)
+		{
+			blender->resetCachedJoint();
+		}
+		batch.blend(batched.mBlenders, FALSE);
+		ensure("same cache", max_cache_difference(single, batched) < 1e-5f);
+		ensure("joints untouched", max_difference(single, batched) == 0.f);
+		for (LLJointStateBlender* blender : batched.mBlenders)
+		{
+			ensure("states kept", blender->isActive());
+		}
+	}
+
+	template<> template<>
+	void pose_object::test<3>()
+	{
+		set_test_name("crowd of poses");
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time pose blending");
+		}
+
+		std::vector<std::unique_ptr<Blended> > single, batched;
+		for (U32 i = 0; i < BENCH_AVATARS; ++i)
+		{
+			single.emplace_back(new Blended(i + 1));
+			batched.emplace_back(new Blended(i + 1));
+		}
+
+		// Every frame each avatar blends and applies the states of its
+		// motions. Only the blending is timed.
+		LLJointBlendBatch batch;
+		F64 times[2] = { 0.0, 0.0 };
+		LLTimer timer;
+		for (U32 frame = 0; frame < BENCH_FRAMES; ++frame)
+		{
+			timer.reset();
+			for (auto& avatar : single)
+			{
+				for (LLJointStateBlender* blender : avatar->mBlenders)
+				{
+					blender->blendJointStates();
+				}
+			}
+			times[0] += timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (auto& avatar : batched)
+			{
+				batch.blend(avatar->mBlenders, TRUE);
+			}
+			times[1] += timer.getElapsedTimeF64();
+
+			for (U32 i = 0; i < BENCH_AVATARS; ++i)
+			{
+				ensure("same pose", max_difference(*single[i], *batched[i]) < 1e-4f);
+				sSeed = frame * BENCH_AVATARS + i + 1000;
+				single[i]->addStates();
+				sSeed = frame * BENCH_AVATARS + i + 1000;
+				batched[i]->addStates();
+			}
+		}
+
+		LL_INFOS() << BENCH_AVATARS << " poses of " << JOINT_COUNT << " joints over "
+				   << BENCH_FRAMES << " frames: each blender " << times[0] * 1000.0
+				   << " ms, batched " << times[1] * 1000.0 << " ms" << LL_ENDL;
+	}
+}
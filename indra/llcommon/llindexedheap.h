@@ -0,0 +1,208 @@
+/**
+ * @file llindexedheap.h
+ * @brief Priority queue whose entries can be reprioritized in place
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINDEXEDHEAP_H
+#define LL_LLINDEXEDHEAP_H
+
+#include <vector>
+
+//
+// Binary max-heap of data that can be reprioritized or removed while in it.
+// Each datum keeps its own place in the heap, read and written through the
+// functions the heap is built with, so finding it again takes no search
+// (LLPriQueueMap looks it up by its old priority instead). A datum not in
+// the heap must have a negative index.
+//
+
+template <class DATA_TYPE>
+class LLIndexedHeap
+{
+public:
+	typedef S32 (*get_index_fn)(const DATA_TYPE& data);
+	typedef void (*set_index_fn)(DATA_TYPE& data, S32 index);
+
+	LLIndexedHeap(get_index_fn get_index, set_index_fn set_index)
+	:	mGetIndex(get_index),
+		mSetIndex(set_index)
+	{
+	}
+
+	// Adds data, or moves it to the new priority if already in the heap.
+	void push(const F32 priority, DATA_TYPE data)
+	{
+		S32 index = mGetIndex(data);
+		if (index < 0)
+		{
+			index = (S32)mEntries.size();
+			mEntries.push_back(Entry(priority, data));
+			mSetIndex(mEntries.back().mData, index);
+			siftUp(index);
+		}
+		else
+		{
+			const F32 old_priority = mEntries[index].mPriority;
+			mEntries[index].mPriority = priority;
+			if (priority > old_priority)
+			{
+				siftUp(index);
+			}
+			else
+			{
+				siftDown(index);
+			}
+		}
+	}
+
+	// Adds data, or raises it to priority if it is in the heap lower.
+	void raise(const F32 priority, DATA_TYPE data)
+	{
+		const S32 index = mGetIndex(data);
+		if (index < 0 || mEntries[index].mPriority < priority)
+		{
+			push(priority, data);
+		}
+	}
+
+	bool pop(DATA_TYPE *datap)
+	{
+		if (mEntries.empty())
+		{
+			return false;
+		}
+		*datap = mEntries[0].mData;
+		removeAt(0);
+		return true;
+	}
+
+	void remove(DATA_TYPE data)
+	{
+		const S32 index = mGetIndex(data);
+		if (index >= 0)
+		{
+			removeAt(index);
+		}
+	}
+
+	void clear()
+	{
+		for (Entry& entry : mEntries)
+		{
+			mSetIndex(entry.mData, -1);
+		}
+		mEntries.clear();
+	}
+
+	bool contains(const DATA_TYPE& data) const	{ return mGetIndex(data) >= 0; }
+	F32 getPriority(const DATA_TYPE& data) const	{ return mEntries[mGetIndex(data)].mPriority; }
+	F32 getTopPriority() const					{ return mEntries[0].mPriority; }
+	S32 getLength() const						{ return (S32)mEntries.size(); }
+	bool empty() const							{ return mEntries.empty(); }
+
+private:
+	struct Entry
+	{
+		Entry(const F32 priority, DATA_TYPE data) : mPriority(priority), mData(data) {}
+
+		F32 mPriority;
+		DATA_TYPE mData;
+	};
+
+	void removeAt(S32 index)
+	{
+		mSetIndex(mEntries[index].mData, -1);
+		const S32 last = (S32)mEntries.size() - 1;
+		if (index != last)
+		{
+			const F32 priority = mEntries[index].mPriority;
+			place(index, mEntries[last]);
+			mEntries.pop_back();
+			if (mEntries[index].mPriority > priority)
+			{
+				siftUp(index);
+			}
+			else
+			{
+				siftDown(index);
+			}
+		}
+		else
+		{
+			mEntries.pop_back();
+		}
+	}
+
+	void siftUp(S32 index)
+	{
+		Entry entry = mEntries[index];
+		while (index > 0)
+		{
+			const S32 parent = (index - 1) / 2;
+			if (!(mEntries[parent].mPriority < entry.mPriority))
+			{
+				break;
+			}
+			place(index, mEntries[parent]);
+			index = parent;
+		}
+		place(index, entry);
+	}
+
+	void siftDown(S32 index)
+	{
+		Entry entry = mEntries[index];
+		const S32 count = (S32)mEntries.size();
+		while (true)
+		{
+			S32 child = index * 2 + 1;
+			if (child >= count)
+			{
+				break;
+			}
+			if (child + 1 < count && mEntries[child].mPriority < mEntries[child + 1].mPriority)
+			{
+				++child;
+			}
+			if (!(entry.mPriority < mEntries[child].mPriority))
+			{
+				break;
+			}
+			place(index, mEntries[child]);
+			index = child;
+		}
+		place(index, entry);
+	}
+
+	void place(S32 index, const Entry& entry)
+	{
+		mEntries[index] = entry;
+		mSetIndex(mEntries[index].mData, index);
+	}
+
+	std::vector<Entry> mEntries;
+	get_index_fn mGetIndex;
+	set_index_fn mSetIndex;
+};
+
+#endif // LL_LLINDEXEDHEAP_H
@@ -0,0 +1,265 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Read-write or read-only memory mapping of a whole file
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#include "llstring.h"
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+LLMappedFile::LLMappedFile()
+:	mData(nullptr),
+	mSize(0),
+	mReadOnly(true),
+	mOwnsFile(false),
+#if LL_WINDOWS
+	mFileHandle(INVALID_HANDLE_VALUE),
+	mMappingHandle(nullptr)
+#else
+	mFileDesc(-1)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	close();
+}
+
+bool LLMappedFile::open(const std::string& filename, size_t size, bool read_only)
+{
+	close();
+
+#if LL_WINDOWS
+	HANDLE file = CreateFileW(ll_convert_string_to_wide(filename).c_str(),
+							  read_only ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE),
+							  // Readers must tolerate a writer that already has the file open
+							  read_only ? (FILE_SHARE_READ | FILE_SHARE_WRITE) : FILE_SHARE_READ,
+							  nullptr,
+							  read_only ? OPEN_EXISTING : OPEN_ALWAYS,
+							  FILE_ATTRIBUTE_NORMAL,
+							  nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	mFileHandle = file;
+#else
+	int fd = ::open(filename.c_str(), read_only ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+	mFileDesc = fd;
+#endif
+
+	mReadOnly = read_only;
+	mOwnsFile = true;
+	if (!map(size))
+	{
+		closeFile();
+		return false;
+	}
+	return true;
+}
+
+bool LLMappedFile::attach(LLFILE* file, size_t size, bool read_only)
+{
+	close();
+	if (!file)
+	{
+		return false;
+	}
+
+	// Anything still buffered has to be in the file before it is mapped
+	fflush(file);
+#if LL_WINDOWS
+	mFileHandle = (HANDLE)_get_osfhandle(_fileno(file));
+#else
+	mFileDesc = fileno(file);
+#endif
+
+	mReadOnly = read_only;
+	mOwnsFile = false;
+	if (!map(size))
+	{
+		closeFile();
+		return false;
+	}
+	return true;
+}
+
+void LLMappedFile::close()
+{
+	unmap();
+	closeFile();
+}
+
+bool LLMappedFile::grow(size_t size)
+{
+	if (!mData || mReadOnly)
+	{
+		return false;
+	}
+	if (size <= mSize)
+	{
+		return true;
+	}
+
+	const size_t old_size = mSize;
+	unmap();
+	if (map(size))
+	{
+		return true;
+	}
+	if (!map(old_size))
+	{
+		closeFile();
+	}
+	return false;
+}
+
+bool LLMappedFile::flush()
+{
+	if (!mData || mReadOnly)
+	{
+		return false;
+	}
+
+#if LL_WINDOWS
+	return FlushViewOfFile(mData, 0) != 0;
+#else
+	return msync(mData, mSize, MS_ASYNC) == 0;
+#endif
+}
+
+// Maps size bytes of the open file, growing a writable file to size first.
+bool LLMappedFile::map(size_t size)
+{
+#if LL_WINDOWS
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx((HANDLE)mFileHandle, &file_size))
+	{
+		return false;
+	}
+	if (!size || (mReadOnly && (size_t)file_size.QuadPart < size))
+	{
+		size = (size_t)file_size.QuadPart;
+	}
+	if (!size)
+	{
+		return false;
+	}
+
+	// CreateFileMapping grows the file to the mapping size for us
+	LARGE_INTEGER map_size;
+	map_size.QuadPart = (LONGLONG)size;
+	HANDLE mapping = CreateFileMappingW((HANDLE)mFileHandle, nullptr, mReadOnly ? PAGE_READONLY : PAGE_READWRITE,
+										map_size.HighPart, map_size.LowPart, nullptr);
+	if (!mapping)
+	{
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, mReadOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	mMappingHandle = mapping;
+#else
+	struct stat file_stat;
+	if (fstat(mFileDesc, &file_stat) != 0)
+	{
+		return false;
+	}
+	if (!size || (mReadOnly && (size_t)file_stat.st_size < size))
+	{
+		size = (size_t)file_stat.st_size;
+	}
+	if (!size || (!mReadOnly && (size_t)file_stat.st_size < size && ftruncate(mFileDesc, (off_t)size) != 0))
+	{
+		return false;
+	}
+
+	void* data = mmap(nullptr, size, mReadOnly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, mFileDesc, 0);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+#endif
+
+	mData = (U8*)data;
+	mSize = size;
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (!mData)
+	{
+		return;
+	}
+
+#if LL_WINDOWS
+	UnmapViewOfFile(mData);
+	CloseHandle((HANDLE)mMappingHandle);
+	mMappingHandle = nullptr;
+#else
+	munmap(mData, mSize);
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+void LLMappedFile::closeFile()
+{
+#if LL_WINDOWS
+	if (mOwnsFile && mFileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle((HANDLE)mFileHandle);
+	}
+	mFileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (mOwnsFile && mFileDesc >= 0)
+	{
+		::close(mFileDesc);
+	}
+	mFileDesc = -1;
+#endif
+	mOwnsFile = false;
+}
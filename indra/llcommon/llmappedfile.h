@@ -0,0 +1,90 @@
+/**
+ * @file llmappedfile.h
+ * @brief Read-write or read-only memory mapping of a whole file
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <string>
+
+#include "llfile.h"
+
+/**
+ * @class LLMappedFile
+ * @brief Maps an entire file into the address space.
+ *
+ * Writable mappings are shared with the file, so stores through getData()
+ * reach the disk without explicit writes; flush() only schedules the
+ * write-back. Not thread safe, callers serialize access themselves.
+ */
+class LL_COMMON_API LLMappedFile
+{
+public:
+	LLMappedFile();
+	~LLMappedFile();
+
+	LLMappedFile(const LLMappedFile&) = delete;
+	LLMappedFile& operator=(const LLMappedFile&) = delete;
+
+	// Maps size bytes of filename. Writable files are created if missing
+	// and grown (zero filled) to size first. Pass a size of 0 to map the
+	// file at its current size. Returns false and leaves the object closed
+	// on failure.
+	bool open(const std::string& filename, size_t size, bool read_only);
+	// As open(), but maps a file the caller already holds open (and maybe
+	// share locked). close() leaves the file itself open.
+	bool attach(LLFILE* file, size_t size, bool read_only);
+	void close();
+
+	// Grows a writable file and its mapping to size, which moves getData().
+	// Nothing may hold pointers into the old mapping across the call. On
+	// failure the old mapping is kept where possible.
+	bool grow(size_t size);
+
+	// Asks the OS to start writing dirty pages back, does not wait for it.
+	bool flush();
+
+	bool isOpen() const			{ return mData != nullptr; }
+	bool isReadOnly() const		{ return mReadOnly; }
+	U8* getData() const			{ return mData; }
+	size_t getSize() const		{ return mSize; }
+
+private:
+	bool map(size_t size);
+	void unmap();
+	void closeFile();
+
+	U8*		mData;
+	size_t	mSize;
+	bool	mReadOnly;
+	bool	mOwnsFile;
+#if LL_WINDOWS
+	void*	mFileHandle;	// HANDLE
+	void*	mMappingHandle;	// HANDLE
+#else
+	int		mFileDesc;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
@@ -25,6 +25,7 @@
 
 #include "linden_common.h"
 #include "llqueuedthread.h"
+#include "llqueuedthreadpool.h"
 
 #include "llstl.h"
 #include "lltimer.h"	// ms_sleep()
@@ -36,15 +37,22 @@ using namespace std::chrono_literals;
 //============================================================================
 
 // MAIN THREAD
-LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause) :
+LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause, LLQueuedThreadPool* pool) :
 	LLThread(name),
 	mThreaded(threaded),
     mStarted(false),
 	mIdleThread(true),
 	mRequestQueueSize(0),
-    mNextHandle(0)
+    mNextHandle(0),
+	mPool(threaded ? pool : nullptr),
+	mPoolQuitting(false),
+	mPoolActive(0)
 {
-	if (mThreaded)
+	if (mPool)
+	{
+		mStarted = true; // the pool threads are already running
+	}
+	else if (mThreaded)
 	{
 		if(should_pause)
 		{
@@ -68,6 +76,15 @@ LLQueuedThread::~LLQueuedThread()
 
 void LLQueuedThread::shutdown()
 {
+	if (mPool)
+	{
+		// Stop resubmitting first, then take our requests back from the pool
+		lockData();
+		mPoolQuitting = true;
+		unlockData();
+		mPool->cancel(this);
+	}
+
 	setQuitting();
 
 	unpause(); // MAIN THREAD
@@ -135,7 +152,12 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 	S32 pending = 1;
 
 	// Frame Update
-	if (mThreaded)
+	if (mPool)
+	{
+		pending = getPending();
+		mIdleThread = (pending <= 0) && (mPoolActive <= 0);
+	}
+	else if (mThreaded)
 	{
 		pending = getPending();
 		if(pending > 0)
@@ -190,7 +212,12 @@ void LLQueuedThread::waitOnPending()
 void LLQueuedThread::printQueueStats()
 {
 	lockData();
-	if (!mRequestQueue.empty())
+	if (mPool)
+	{
+		LL_INFOS() << fmt::format(FMT_STRING("Pending Requests:{:d} Running:{:d} Pool pending:{:d}"),
+								  mRequestQueueSize.load(), mPoolActive.load(), mPool->getPending()) << LL_ENDL;
+	}
+	else if (!mRequestQueue.empty())
 	{
 		QueuedRequest *req = *mRequestQueue.begin();
 		LL_INFOS() << fmt::format(FMT_STRING("Pending Requests:{:d} Current status:{:d}"), mRequestQueue.size(), req->getStatus()) << LL_ENDL;
@@ -224,6 +251,21 @@ bool LLQueuedThread::addRequest(QueuedRequest* req)
 	}
 	
 	lockData();
+	if (mPool)
+	{
+		if (mPoolQuitting)
+		{
+			unlockData();
+			return false;
+		}
+		req->setStatus(STATUS_QUEUED);
+		mRequestHash.insert(req);
+		++mRequestQueueSize;
+		mIdleThread = false;
+		mPool->submit(this, req);
+		unlockData();
+		return true;
+	}
 	req->setStatus(STATUS_QUEUED);
 	mRequestQueue.insert(req);
 	mRequestHash.insert(req);
@@ -339,6 +381,11 @@ void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 			// not in list
 			req->setPriority(priority);
 		}
+		else if(req->getStatus() == STATUS_QUEUED && mPool)
+		{
+			// stays in its pool bucket until it is queued again
+			req->setPriority(priority);
+		}
 		else if(req->getStatus() == STATUS_QUEUED)
 		{
 			// remove from list then re-insert
@@ -477,6 +524,62 @@ S32 LLQueuedThread::processNextRequest()
 	return pending;
 }
 
+// Runs on a POOL thread, mPoolActive was raised when the pool handed us req
+void LLQueuedThread::processPooledRequest(QueuedRequest* req)
+{
+	lockData();
+	--mRequestQueueSize;
+	if ((req->getFlags() & FLAG_ABORT) || mPoolQuitting)
+	{
+		req->setStatus(STATUS_ABORTED);
+		req->finishRequest(false);
+		if (req->getFlags() & FLAG_AUTO_COMPLETE)
+		{
+			mRequestHash.erase(req);
+			req->deleteRequest();
+		}
+		unlockData();
+		--mPoolActive;
+		return;
+	}
+	llassert_always(req->getStatus() == STATUS_QUEUED);
+	req->setStatus(STATUS_INPROGRESS);
+	U32 start_priority = req->getPriority();
+	unlockData();
+
+	bool complete = req->processRequest();
+
+	lockData();
+	if (complete)
+	{
+		req->setStatus(STATUS_COMPLETE);
+		req->finishRequest(true);
+		if (req->getFlags() & FLAG_AUTO_COMPLETE)
+		{
+			mRequestHash.erase(req);
+			req->deleteRequest();
+		}
+	}
+	else
+	{
+		req->setStatus(STATUS_QUEUED);
+		if (!mPoolQuitting) // otherwise shutdown() aborts it
+		{
+			++mRequestQueueSize;
+			mPool->submit(this, req);
+		}
+	}
+	unlockData();
+
+	LLTrace::get_thread_recorder()->pushToParent();
+	--mPoolActive;
+
+	if (!complete && start_priority < PRIORITY_NORMAL)
+	{
+		LLThread::yield(); // the pool thread is shared, don't sleep it
+	}
+}
+
 // virtual
 bool LLQueuedThread::runCondition()
 {
@@ -38,9 +38,20 @@
 //============================================================================
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
+//
+// Passing an LLQueuedThreadPool makes the queue pooled: no thread of its own
+// is started and its requests run on the pool threads, several at a time.
+// Only use this when processRequest() is safe to run concurrently for
+// different requests and the subclass doesn't depend on startThread(),
+// endThread(), threadedUpdate() or its thread's local APR pool. The pool
+// must outlive the queue.
+
+class LLQueuedThreadPool;
 
 class LL_COMMON_API LLQueuedThread : public LLThread
 {
+	friend class LLQueuedThreadPool;
+
 	//------------------------------------------------------------------------
 public:
 	enum priority_t {
@@ -146,7 +157,8 @@ protected:
 public:
 	static handle_t nullHandle() { return handle_t(0); }
 
-	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false,
+				   LLQueuedThreadPool* pool = nullptr);
 	virtual ~LLQueuedThread();
 	void shutdown() override;
 	
@@ -159,6 +171,7 @@ private:
 	virtual void startThread(void);
 	virtual void endThread(void);
 	virtual void threadedUpdate(void);
+	void processPooledRequest(QueuedRequest* req); // pool thread
 
 protected:
 	handle_t generateHandle();
@@ -177,6 +190,7 @@ public:
 
 	virtual S32 getPending() const { return mRequestQueueSize; } // May be called from any thread
 	bool getThreaded() const { return mThreaded; }
+	bool isPooled() const { return mPool != nullptr; }
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
@@ -205,6 +219,11 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+	// Pooled mode, mRequestQueue stays empty and mRequestQueueSize counts the requests waiting in the pool
+	LLQueuedThreadPool* mPool;
+	bool mPoolQuitting; // guarded by mDataLock
+	std::atomic<S32> mPoolActive; // requests taken by pool threads and not yet returned
 };
 
 #endif // LL_LLQUEUEDTHREAD_H
@@ -0,0 +1,263 @@
+/**
+ * @file llqueuedthreadpool.cpp
+ * @brief Shared work-stealing thread pool for pooled LLQueuedThreads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llqueuedthreadpool.h"
+
+#include <algorithm>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	// Lets submit() keep follow-up work on the thread that produced it
+	thread_local const LLQueuedThreadPool* sCurrentPool = nullptr;
+	thread_local U32 sCurrentWorker = 0;
+}
+
+//============================================================================
+
+class LLQueuedThreadPool::Worker : public LLThread
+{
+public:
+	Worker(LLQueuedThreadPool& pool, const std::string& name, U32 index)
+	:	LLThread(name),
+		mPool(pool),
+		mIndex(index)
+	{
+	}
+
+	std::mutex mMutex;
+	std::deque<Task> mBuckets[NUM_BUCKETS];
+
+private:
+	void run() override
+	{
+		sCurrentPool = &mPool;
+		sCurrentWorker = mIndex;
+
+		while (!isQuitting() && !mPool.mQuitting)
+		{
+			Task task;
+			if (mPool.popTask(mIndex, task))
+			{
+				task.mQueue->processPooledRequest(task.mRequest);
+			}
+			else
+			{
+				mPool.waitForWork();
+			}
+		}
+
+		sCurrentPool = nullptr;
+	}
+
+	LLQueuedThreadPool& mPool;
+	const U32 mIndex;
+};
+
+//============================================================================
+
+// MAIN THREAD
+LLQueuedThreadPool::LLQueuedThreadPool(const std::string& name, U32 num_threads)
+:	mPendingTasks(0),
+	mNextWorker(0),
+	mSleepers(0),
+	mQuitting(false)
+{
+	for (auto& count : mBucketTasks)
+	{
+		count = 0;
+	}
+
+	if (!num_threads)
+	{
+		num_threads = defaultThreadCount();
+	}
+	mWorkers.reserve(num_threads);
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		mWorkers.emplace_back(std::make_unique<Worker>(*this, llformat("%s %u", name.c_str(), i), i));
+	}
+	// Start only once the vector is complete, running workers steal from all of it
+	for (auto& worker : mWorkers)
+	{
+		worker->start();
+	}
+
+	LL_INFOS() << "Started " << num_threads << " " << name << " pool threads" << LL_ENDL;
+}
+
+// MAIN THREAD
+LLQueuedThreadPool::~LLQueuedThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mQuitting = true;
+	}
+	mWakeCondition.notify_all();
+
+	// Stop every worker before any of them goes away, they reference each other's deques
+	for (auto& worker : mWorkers)
+	{
+		worker->shutdown();
+	}
+
+	if (mPendingTasks > 0)
+	{
+		LL_WARNS() << "~LLQueuedThreadPool() called with " << mPendingTasks << " queued requests" << LL_ENDL;
+	}
+}
+
+// static
+U32 LLQueuedThreadPool::defaultThreadCount()
+{
+	U32 cores = std::thread::hardware_concurrency();
+	return llmax(cores, 2U) - 1;
+}
+
+// static
+U32 LLQueuedThreadPool::bucketFor(U32 priority)
+{
+	U32 level = priority & LLQueuedThread::PRIORITY_HIGHBITS;
+	if (level >= LLQueuedThread::PRIORITY_URGENT)
+	{
+		return 0;
+	}
+	if (level >= LLQueuedThread::PRIORITY_HIGH)
+	{
+		return 1;
+	}
+	if (level >= LLQueuedThread::PRIORITY_NORMAL)
+	{
+		return 2;
+	}
+	return 3;
+}
+
+//----------------------------------------------------------------------------
+
+// ANY THREAD, the owning queue's data lock is held
+void LLQueuedThreadPool::submit(LLQueuedThread* queue, QueuedRequest* req)
+{
+	const U32 bucket = bucketFor(req->getPriority());
+	const U32 index = (sCurrentPool == this) ? sCurrentWorker : (mNextWorker++ % (U32)mWorkers.size());
+
+	Worker& worker = *mWorkers[index];
+	{
+		std::lock_guard<std::mutex> lock(worker.mMutex);
+		worker.mBuckets[bucket].push_back(Task{ queue, req });
+		++mBucketTasks[bucket];
+		++mPendingTasks;
+	}
+
+	// Pairs with the sleeper count going up before the pending check in waitForWork()
+	if (mSleepers > 0)
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mWakeCondition.notify_one();
+	}
+}
+
+// MAIN THREAD
+void LLQueuedThreadPool::cancel(LLQueuedThread* queue)
+{
+	// A task is always either in a deque or counted in mPoolActive (popTask
+	// moves it under the deque lock), and the queue no longer resubmits, so
+	// once nothing of it is running and the deques are swept it is gone.
+	while (true)
+	{
+		removeTasks(queue);
+		if (queue->mPoolActive <= 0)
+		{
+			break;
+		}
+		std::this_thread::sleep_for(1ms);
+	}
+}
+
+// POOL THREAD
+bool LLQueuedThreadPool::popTask(U32 self, Task& task)
+{
+	const U32 count = (U32)mWorkers.size();
+	for (U32 bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+	{
+		if (mBucketTasks[bucket] <= 0)
+		{
+			continue;
+		}
+
+		// Own deque first, then steal
+		for (U32 i = 0; i < count; ++i)
+		{
+			Worker& victim = *mWorkers[(self + i) % count];
+			std::lock_guard<std::mutex> lock(victim.mMutex);
+			std::deque<Task>& tasks = victim.mBuckets[bucket];
+			if (!tasks.empty())
+			{
+				task = tasks.front();
+				tasks.pop_front();
+				--mBucketTasks[bucket];
+				--mPendingTasks;
+				++task.mQueue->mPoolActive;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// POOL THREAD
+void LLQueuedThreadPool::waitForWork()
+{
+	std::unique_lock<std::mutex> lock(mSleepMutex);
+	++mSleepers;
+	mWakeCondition.wait(lock, [this]() { return mPendingTasks > 0 || mQuitting; });
+	--mSleepers;
+}
+
+S32 LLQueuedThreadPool::removeTasks(LLQueuedThread* queue)
+{
+	S32 removed = 0;
+	for (auto& worker : mWorkers)
+	{
+		std::lock_guard<std::mutex> lock(worker->mMutex);
+		for (U32 bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+		{
+			std::deque<Task>& tasks = worker->mBuckets[bucket];
+			auto end = std::remove_if(tasks.begin(), tasks.end(),
+									  [queue](const Task& task) { return task.mQueue == queue; });
+			S32 count = (S32)std::distance(end, tasks.end());
+			if (count)
+			{
+				tasks.erase(end, tasks.end());
+				mBucketTasks[bucket] -= count;
+				mPendingTasks -= count;
+				removed += count;
+			}
+		}
+	}
+	return removed;
+}
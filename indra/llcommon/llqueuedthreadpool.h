@@ -0,0 +1,107 @@
+/**
+ * @file llqueuedthreadpool.h
+ * @brief Shared work-stealing thread pool for pooled LLQueuedThreads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLQUEUEDTHREADPOOL_H
+#define LL_LLQUEUEDTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "llqueuedthread.h"
+
+//============================================================================
+// Runs the requests of any number of pooled LLQueuedThreads on N threads.
+//
+// Every pool thread owns a deque per priority bucket. Requests submitted
+// from a pool thread (including a request that is not done yet going back
+// in) stay on that thread's deques, others are dealt out round robin. A
+// thread always takes the highest non-empty bucket, from its own deque
+// first and otherwise stolen from another thread, so one busy queue can use
+// every core and urgent work never waits behind low priority work.
+//
+// Within a bucket requests run in submission order; a priority change on a
+// queued request takes effect the next time it is queued.
+
+class LL_COMMON_API LLQueuedThreadPool
+{
+public:
+	LLQueuedThreadPool(const std::string& name, U32 num_threads);
+	~LLQueuedThreadPool();
+
+	LLQueuedThreadPool(const LLQueuedThreadPool&) = delete;
+	LLQueuedThreadPool& operator=(const LLQueuedThreadPool&) = delete;
+
+	U32 getThreadCount() const { return (U32)mWorkers.size(); }
+	S32 getPending() const { return mPendingTasks; } // May be called from any thread
+
+	// 0 means one thread per core, less one for the main thread
+	static U32 defaultThreadCount();
+
+private:
+	friend class LLQueuedThread;
+
+	typedef LLQueuedThread::QueuedRequest QueuedRequest;
+
+	struct Task
+	{
+		LLQueuedThread* mQueue;
+		QueuedRequest* mRequest;
+	};
+
+	enum { NUM_BUCKETS = 4 };
+
+	class Worker;
+
+	static U32 bucketFor(U32 priority);
+
+	// Called by LLQueuedThread
+	void submit(LLQueuedThread* queue, QueuedRequest* req);
+	// Drops everything queue has waiting in the pool and waits for its
+	// running requests to return. The queue must refuse new work first.
+	void cancel(LLQueuedThread* queue);
+
+	// Called by the workers
+	bool popTask(U32 worker, Task& task);
+	void waitForWork();
+	S32 removeTasks(LLQueuedThread* queue);
+
+private:
+	std::vector<std::unique_ptr<Worker> > mWorkers;
+
+	std::atomic<S32> mPendingTasks;
+	std::atomic<S32> mBucketTasks[NUM_BUCKETS]; // lets takers skip empty buckets without locking
+	std::atomic<U32> mNextWorker;
+	std::atomic<S32> mSleepers;
+	std::atomic<bool> mQuitting;
+
+	std::mutex mSleepMutex;
+	std::condition_variable mWakeCondition;
+};
+
+#endif // LL_LLQUEUEDTHREADPOOL_H
@@ -29,6 +29,8 @@
 #define LLSD_DEBUG_INFO
 #include "linden_common.h"
 #include "llsd.h"
+#include <atomic>
+#include <new>
 #include <utility>
 
 #include "llerror.h"
@@ -67,6 +69,119 @@ S32 sLLSDNetObjects = 0;
 #define	ALLOC_LLSD_OBJECT			{ llsd::sLLSDNetObjects++;	llsd::sLLSDAllocationCount++;	}
 #define	FREE_LLSD_OBJECT			{ llsd::sLLSDNetObjects--;									}
 
+class LLSDArena::Blocks
+	/**< The memory of an LLSDArena. Every allocation is prefixed with a
+		 pointer back here, and the blocks go away with the last reference,
+		 either the arena itself or an Impl made in it.
+	*/
+{
+public:
+	Blocks()
+	:	mUseCount(1),
+		mBlocks(nullptr),
+		mNext(nullptr),
+		mEnd(nullptr),
+		mBlockSize(MIN_BLOCK_SIZE)
+	{
+	}
+
+	~Blocks()
+	{
+		while (mBlocks)
+		{
+			Block* next = mBlocks->mNext;
+			free(mBlocks);
+			mBlocks = next;
+		}
+	}
+
+	// OWNING THREAD
+	void* allocate(size_t size)
+	{
+		const size_t needed = sizeof(Blocks*) + ((size + sizeof(void*) - 1) & ~(sizeof(void*) - 1));
+		if ((size_t)(mEnd - mNext) < needed && !addBlock(needed))
+		{
+			return nullptr;
+		}
+		*reinterpret_cast<Blocks**>(mNext) = this;
+		void* ptr = mNext + sizeof(Blocks*);
+		mNext += needed;
+		++mUseCount;
+		return ptr;
+	}
+
+	// ANY THREAD
+	void release()
+	{
+		if (--mUseCount == 0)
+		{
+			delete this;
+		}
+	}
+
+	static Blocks* owner(const void* ptr)
+	{
+		return reinterpret_cast<Blocks* const*>(ptr)[-1];
+	}
+
+private:
+	// Small documents only pin a small block, large ones soon get large blocks
+	enum
+	{
+		MIN_BLOCK_SIZE = 1024,
+		MAX_BLOCK_SIZE = 65536
+	};
+
+	struct Block
+	{
+		Block* mNext;
+	};
+
+	bool addBlock(size_t needed)
+	{
+		if (needed > MAX_BLOCK_SIZE - sizeof(Block))
+		{
+			return false;
+		}
+		while (needed > mBlockSize - sizeof(Block))
+		{
+			mBlockSize *= 2;
+		}
+		Block* block = static_cast<Block*>(malloc(mBlockSize));
+		if (!block)
+		{
+			return false;
+		}
+		block->mNext = mBlocks;
+		mBlocks = block;
+		mNext = reinterpret_cast<char*>(block + 1);
+		mEnd = reinterpret_cast<char*>(block) + mBlockSize;
+		mBlockSize = llmin(mBlockSize * 2, (size_t)MAX_BLOCK_SIZE);
+		return true;
+	}
+
+	std::atomic<U32> mUseCount;
+	Block* mBlocks;
+	char* mNext;
+	char* mEnd;
+	size_t mBlockSize;
+};
+
+static thread_local LLSDArena::Blocks* sCurrentArena = nullptr;
+
+LLSDArena::LLSDArena()
+:	mBlocks(new Blocks),
+	mPrevious(sCurrentArena)
+{
+	sCurrentArena = mBlocks;
+}
+
+LLSDArena::~LLSDArena()
+{
+	sCurrentArena = mPrevious;
+	mBlocks->release();
+}
+
 class LLSD::Impl
 	/**< This class is the abstract base class of the implementation of LLSD
 		 It provides the reference counting implementation, and the default
@@ -89,8 +204,23 @@ protected:
 	bool shared() const							{ return (mUseCount > 1) && (mUseCount != STATIC_USAGE_COUNT); }
 	
 	U32 mUseCount;
+	bool mInArena;
+
+	static void* allocate(size_t size, bool& in_arena);
+	static void destroy(Impl* impl);
 
 public:
+	template<class T, class... Args>
+	static T* create(Args&&... args)
+		///< makes a new Impl, in the current thread's LLSDArena if there is one
+	{
+		static_assert(alignof(T) <= sizeof(void*), "arena allocations are only pointer aligned");
+		bool in_arena;
+		T* impl = new (allocate(sizeof(T), in_arena)) T(std::forward<Args>(args)...);
+		impl->mInArena = in_arena;
+		return impl;
+	}
+
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
 
@@ -111,14 +241,12 @@ public:
 	static  void assignUndefined(LLSD::Impl*& var);
 	static  void assign(LLSD::Impl*& var, const LLSD::Impl* other);
 	
-	virtual void assign(Impl*& var, LLSD::Boolean);
-	virtual void assign(Impl*& var, LLSD::Integer);
-	virtual void assign(Impl*& var, LLSD::Real);
 	virtual void assign(Impl*& var, const LLSD::String&);
-	virtual void assign(Impl*& var, const LLSD::UUID&);
 	virtual void assign(Impl*& var, const LLSD::Date&);
 	virtual void assign(Impl*& var, const LLSD::URI&);
 	virtual void assign(Impl*& var, const LLSD::Binary&);
+	virtual void assign(Impl*& var, LLSD::String&&);
+	virtual void assign(Impl*& var, LLSD::Binary&&);
 		///< If the receiver is the right type and unshared, these are simple
 		//   data assignments, othewise the default implementation handless
 		//   constructing the proper Impl subclass
@@ -155,11 +283,24 @@ public:
 	// containing Impl objects. This helper forwards through LLSD.
 	void calcStats(const LLSD& llsd, S32 type_counts[], S32 share_counts[]) const
 	{
+		if (llsd.mInline != LLSD::TypeUndefined)
+		{
+			type_counts[llsd.mInline]++;
+			return;
+		}
 		safe(reinterpret_cast<const Impl*>(llsd.impl)).calcStats(type_counts, share_counts);
 	}
 
-	static const Impl& getImpl(const LLSD& llsd)	{ return safe(reinterpret_cast<const Impl*>(llsd.impl)); }
-	static Impl& getImpl(LLSD& llsd)				{ return safe(reinterpret_cast<Impl*>(llsd.impl)); }
+	// Inline values answer map, array and conversion queries like Undefined
+	static const Impl& getImpl(const LLSD& llsd)	{ return safe(isInline(llsd) ? nullptr : reinterpret_cast<const Impl*>(llsd.impl)); }
+	static Impl& getImpl(LLSD& llsd)				{ return safe(isInline(llsd) ? nullptr : reinterpret_cast<Impl*>(llsd.impl)); }
+
+	static bool isInline(const LLSD& llsd)			{ return llsd.mInline != LLSD::TypeUndefined; }
+	static Impl*& outOfLine(LLSD& llsd);
+		///< drops any inline value, returning the Impl pointer to assign to
+	static void makeInline(LLSD& llsd, LLSD::Type type);
+		///< releases any Impl, the caller stores the value
+	static void copyInline(LLSD& llsd, const LLSD& other);
 
 	static const LLSD& undef();
 	
@@ -186,6 +327,7 @@ namespace
 
 	public:
 		ImplBase(DataRef value) : mValue(std::move(value)) { }
+		ImplBase(Data&& value) : mValue(std::move(value)) { }
 
 		LLSD::Type type() const override { return T; }
 
@@ -204,70 +346,25 @@ namespace
 	};
 
 	
-	class ImplBoolean final
-		: public ImplBase<LLSD::TypeBoolean, LLSD::Boolean>
-	{
-	public:
-		ImplBoolean(LLSD::Boolean v) : Base(v) { }
-
-		LLSD::Boolean	asBoolean() const override { return mValue; }
-		LLSD::Integer	asInteger() const override { return mValue ? 1 : 0; }
-		LLSD::Real		asReal() const override { return mValue ? 1 : 0; }
-		LLSD::String	asString() const override;
-	};
-
-	LLSD::String ImplBoolean::asString() const
-		// *NOTE: The reason that false is not converted to "false" is
-		// because that would break roundtripping,
-		// e.g. LLSD(false).asString().asBoolean().  There are many
-		// reasons for wanting LLSD("false").asBoolean() == true, such
-		// as "everything else seems to work that way".
-		{ return mValue ? "true" : ""; }
-
-
-	class ImplInteger final
-		: public ImplBase<LLSD::TypeInteger, LLSD::Integer>
-	{
-	public:
-		ImplInteger(LLSD::Integer v) : Base(v) { }
-
-		LLSD::Boolean	asBoolean() const override { return mValue != 0; }
-		LLSD::Integer	asInteger() const override { return mValue; }
-		LLSD::Real		asReal() const override { return mValue; }
-		LLSD::String	asString() const override;
-	};
-
-	LLSD::String ImplInteger::asString() const
-		{ return fmt::format("{:d}", mValue); }
-
-
-	class ImplReal final
-		: public ImplBase<LLSD::TypeReal, LLSD::Real>
-	{
-	public:
-		ImplReal(LLSD::Real v) : Base(v) { }
-
-		LLSD::Boolean	asBoolean() const override;
-		LLSD::Integer	asInteger() const override;
-		LLSD::Real		asReal() const override { return mValue; }
-		LLSD::String	asString() const override;
-	};
-
-	LLSD::Boolean ImplReal::asBoolean() const
-		{ return !llisnan(mValue)  &&  mValue != 0.0; }
-		
-	LLSD::Integer ImplReal::asInteger() const
-		{ return !llisnan(mValue) ? static_cast<LLSD::Integer>(mValue) : 0; }
-		
-	LLSD::String ImplReal::asString() const
-		{ return fmt::format(FMT_STRING("{:g}"), mValue); }
-
-
 	class ImplString final
 		: public ImplBase<LLSD::TypeString, LLSD::String, const LLSD::String&>
 	{
 	public:
 		ImplString(const LLSD::String& v) : Base(v) { }
+		ImplString(LLSD::String&& v) : Base(std::move(v)) { }
+
+		using Base::assign;
+		void assign(LLSD::Impl*& var, LLSD::String&& value) override
+		{
+			if (shared())
+			{
+				Impl::assign(var, std::move(value));
+			}
+			else
+			{
+				mValue = std::move(value);
+			}
+		}
 
 		LLSD::Boolean	asBoolean() const override { return !mValue.empty(); }
 		LLSD::Integer	asInteger() const override;
@@ -307,17 +404,6 @@ namespace
 	}
 	
 
-	class ImplUUID final
-		: public ImplBase<LLSD::TypeUUID, LLSD::UUID, const LLSD::UUID&>
-	{
-	public:
-		ImplUUID(const LLSD::UUID& v) : Base(v) { }
-
-		LLSD::String	asString() const override { return mValue.asString(); }
-		LLSD::UUID		asUUID() const override { return mValue; }
-	};
-
-
 	class ImplDate final
 		: public ImplBase<LLSD::TypeDate, LLSD::Date, const LLSD::Date&>
 	{
@@ -357,6 +443,20 @@ namespace
 	{
 	public:
 		ImplBinary(const LLSD::Binary& v) : Base(v) { }
+		ImplBinary(LLSD::Binary&& v) : Base(std::move(v)) { }
+
+		using Base::assign;
+		void assign(LLSD::Impl*& var, LLSD::Binary&& value) override
+		{
+			if (shared())
+			{
+				Impl::assign(var, std::move(value));
+			}
+			else
+			{
+				mValue = std::move(value);
+			}
+		}
 
 		const LLSD::Binary&	asBinary() const override { return mValue; }
 	};
@@ -369,11 +469,9 @@ namespace
 		
 		DataMap mData;
 		
-	protected:
-		ImplMap(DataMap data) : mData(std::move(data)) { }
-		
 	public:
 		ImplMap() = default;
+		ImplMap(DataMap data) : mData(std::move(data)) { }
 
         ImplMap& makeMap(LLSD::Impl*&) override;
 
@@ -407,7 +505,7 @@ namespace
 	{
 		if (shared())
 		{
-			ImplMap* i = new ImplMap(mData);
+			ImplMap* i = create<ImplMap>(mData);
 			Impl::assign(var, i);
 			return *i;
 		}
@@ -490,11 +588,9 @@ namespace
 		
 		DataVector mData;
 		
-	protected:
-		ImplArray(DataVector data) : mData(std::move(data)) { }
-		
 	public:
         ImplArray() = default;
+		ImplArray(DataVector data) : mData(std::move(data)) { }
 
 		ImplArray& makeArray(Impl*&) override;
 
@@ -528,7 +624,7 @@ namespace
 	{
 		if (shared())
 		{
-			ImplArray* i = new ImplArray(mData);
+			ImplArray* i = create<ImplArray>(mData);
 			Impl::assign(var, i);
 			return *i;
 		}
@@ -633,14 +729,16 @@ namespace
 }
 
 LLSD::Impl::Impl()
-	: mUseCount(0)
+	: mUseCount(0),
+	  mInArena(false)
 {
 	++sAllocationCount;
 	++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(0),
+	  mInArena(false)
 {
 }
 
@@ -649,6 +747,64 @@ LLSD::Impl::~Impl()
 	--sOutstandingCount;
 }
 
+void* LLSD::Impl::allocate(size_t size, bool& in_arena)
+{
+	if (sCurrentArena)
+	{
+		void* ptr = sCurrentArena->allocate(size);
+		if (ptr)
+		{
+			in_arena = true;
+			return ptr;
+		}
+	}
+	in_arena = false;
+	return ::operator new(size);
+}
+
+void LLSD::Impl::destroy(Impl* impl)
+{
+	if (impl->mInArena)
+	{
+		LLSDArena::Blocks* arena = LLSDArena::Blocks::owner(impl);
+		impl->~Impl();
+		arena->release();
+	}
+	else
+	{
+		delete impl;
+	}
+}
+
+LLSD::Impl*& LLSD::Impl::outOfLine(LLSD& llsd)
+{
+	if (llsd.mInline != LLSD::TypeUndefined)
+	{
+		llsd.mInline = LLSD::TypeUndefined;
+		llsd.impl = nullptr;
+	}
+	return llsd.impl;
+}
+
+void LLSD::Impl::makeInline(LLSD& llsd, LLSD::Type type)
+{
+	if (llsd.mInline == LLSD::TypeUndefined)
+	{
+		reset(llsd.impl, nullptr);
+	}
+	llsd.mInline = type;
+}
+
+void LLSD::Impl::copyInline(LLSD& llsd, const LLSD& other)
+{
+	// other may live in the map or array llsd is about to let go of
+	U8 value[UUID_BYTES];
+	const LLSD::Type type = other.mInline;
+	memcpy(value, other.mUUID, sizeof(value));
+	makeInline(llsd, type);
+	memcpy(llsd.mUUID, value, sizeof(value));
+}
+
 void LLSD::Impl::reset(Impl*& var, Impl* impl)
 {
 	if (var != impl)
@@ -659,7 +815,7 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 		}
 		if (var && var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
 		{
-			delete var;
+			destroy(var);
 		}
 		var = impl;
 	}
@@ -669,12 +825,13 @@ void LLSD::Impl::move(Impl*& var, Impl*& impl)
 {
 	if (var == impl) return; // Bail out var is impl
 
-	if (var && var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
+	Impl* old = var;
+	var = impl; // Steal impl to var without incrementing use since this is a move
+	impl = nullptr; // null out old-impl pointer, which may live in old
+	if (old && old->mUseCount != STATIC_USAGE_COUNT && --old->mUseCount == 0)
 	{
-		delete var; // destroy var if usage falls to 0 and not static
+		destroy(old); // destroy old if usage falls to 0 and not static
 	}
-	var = impl; // Steal impl to var without incrementing use since this is a move
-	impl = nullptr; // null out old-impl pointer
 }
 
 LLSD::Impl& LLSD::Impl::safe(Impl* impl)
@@ -691,14 +848,14 @@ const LLSD::Impl& LLSD::Impl::safe(const Impl* impl)
 
 ImplMap& LLSD::Impl::makeMap(Impl*& var)
 {
-	ImplMap* im = new ImplMap;
+	ImplMap* im = create<ImplMap>();
 	reset(var, im);
 	return *im;
 }
 
 ImplArray& LLSD::Impl::makeArray(Impl*& var)
 {
-	ImplArray* ia = new ImplArray;
+	ImplArray* ia = create<ImplArray>();
 	reset(var, ia);
 	return *ia;
 }
@@ -714,44 +871,34 @@ void LLSD::Impl::assignUndefined(Impl*& var)
 	reset(var, nullptr);
 }
 
-void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
-{
-	reset(var, new ImplBoolean(v));
-}
-
-void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
-{
-	reset(var, new ImplInteger(v));
-}
-
-void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
+void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
 {
-	reset(var, new ImplReal(v));
+	reset(var, create<ImplString>(v));
 }
 
-void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
+void LLSD::Impl::assign(Impl*& var, const LLSD::Date& v)
 {
-	reset(var, new ImplString(v));
+	reset(var, create<ImplDate>(v));
 }
 
-void LLSD::Impl::assign(Impl*& var, const LLSD::UUID& v)
+void LLSD::Impl::assign(Impl*& var, const LLSD::URI& v)
 {
-	reset(var, new ImplUUID(v));
+	reset(var, create<ImplURI>(v));
 }
 
-void LLSD::Impl::assign(Impl*& var, const LLSD::Date& v)
+void LLSD::Impl::assign(Impl*& var, const LLSD::Binary& v)
 {
-	reset(var, new ImplDate(v));
+	reset(var, create<ImplBinary>(v));
 }
 
-void LLSD::Impl::assign(Impl*& var, const LLSD::URI& v)
+void LLSD::Impl::assign(Impl*& var, LLSD::String&& v)
 {
-	reset(var, new ImplURI(v));
+	reset(var, create<ImplString>(std::move(v)));
 }
 
-void LLSD::Impl::assign(Impl*& var, const LLSD::Binary& v)
+void LLSD::Impl::assign(Impl*& var, LLSD::Binary&& v)
 {
-	reset(var, new ImplBinary(v));
+	reset(var, create<ImplBinary>(std::move(v)));
 }
 
 
@@ -818,56 +965,165 @@ namespace
 }
 
 
-LLSD::LLSD() : impl(nullptr)					{ ALLOC_LLSD_OBJECT; }
-LLSD::~LLSD()							{ FREE_LLSD_OBJECT; Impl::reset(impl, nullptr); }
+LLSD::LLSD() : impl(nullptr), mInline(TypeUndefined)	{ ALLOC_LLSD_OBJECT; }
+LLSD::~LLSD()
+{
+	FREE_LLSD_OBJECT;
+	if (!Impl::isInline(*this))
+	{
+		Impl::reset(impl, nullptr);
+	}
+}
 
-LLSD::LLSD(const LLSD& other) : impl(nullptr) { ALLOC_LLSD_OBJECT;  assign(other); }
-void LLSD::assign(const LLSD& other)	{ Impl::assign(impl, other.impl); }
+LLSD::LLSD(const LLSD& other) : impl(nullptr), mInline(TypeUndefined) { ALLOC_LLSD_OBJECT;  assign(other); }
+void LLSD::assign(const LLSD& other)
+{
+	if (Impl::isInline(other))
+	{
+		Impl::copyInline(*this, other);
+	}
+	else
+	{
+		Impl::assign(Impl::outOfLine(*this), other.impl);
+	}
+}
 
-LLSD::LLSD(LLSD&& other) noexcept : impl(nullptr) { ALLOC_LLSD_OBJECT;  Impl::move(impl, other.impl); }
-LLSD& LLSD::operator=(LLSD&& other) noexcept { Impl::move(impl, other.impl); return *this; }
+LLSD::LLSD(LLSD&& other) noexcept : impl(nullptr), mInline(TypeUndefined)
+{
+	ALLOC_LLSD_OBJECT;
+	*this = std::move(other);
+}
 
-void LLSD::clear()						{ Impl::assignUndefined(impl); }
+LLSD& LLSD::operator=(LLSD&& other) noexcept
+{
+	if (Impl::isInline(other))
+	{
+		if (this != &other)
+		{
+			// Let go of other before this does, it may live in this
+			LLSD value;
+			Impl::copyInline(value, other);
+			Impl::outOfLine(other);
+			Impl::copyInline(*this, value);
+		}
+	}
+	else
+	{
+		Impl::move(Impl::outOfLine(*this), other.impl);
+	}
+	return *this;
+}
+
+void LLSD::clear()						{ Impl::assignUndefined(Impl::outOfLine(*this)); }
 
-LLSD::Type LLSD::type() const			{ return safe(impl).type(); }
+LLSD::Type LLSD::type() const			{ return Impl::isInline(*this) ? mInline : safe(impl).type(); }
 
 // Scalar Constructors
-LLSD::LLSD(Boolean v) : impl(nullptr)			{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(Integer v) : impl(nullptr)			{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(Real v) : impl(nullptr)			{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(const UUID& v) : impl(nullptr)		{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(const String& v) : impl(nullptr)	{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(const Date& v) : impl(nullptr)		{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(const URI& v) : impl(nullptr)		{ ALLOC_LLSD_OBJECT;	assign(v); }
-LLSD::LLSD(const Binary& v) : impl(nullptr)	{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(Boolean v) : impl(nullptr), mInline(TypeUndefined)		{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(Integer v) : impl(nullptr), mInline(TypeUndefined)		{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(Real v) : impl(nullptr), mInline(TypeUndefined)			{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(const UUID& v) : impl(nullptr), mInline(TypeUndefined)	{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(const String& v) : impl(nullptr), mInline(TypeUndefined)	{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(const Date& v) : impl(nullptr), mInline(TypeUndefined)	{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(const URI& v) : impl(nullptr), mInline(TypeUndefined)		{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(const Binary& v) : impl(nullptr), mInline(TypeUndefined)	{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(String&& v) : impl(nullptr), mInline(TypeUndefined)		{ ALLOC_LLSD_OBJECT;	assign(std::move(v)); }
+LLSD::LLSD(Binary&& v) : impl(nullptr), mInline(TypeUndefined)		{ ALLOC_LLSD_OBJECT;	assign(std::move(v)); }
 
 // Convenience Constructors
-LLSD::LLSD(F32 v) : impl(nullptr)				{ ALLOC_LLSD_OBJECT;	assign((Real)v); }
+LLSD::LLSD(F32 v) : impl(nullptr), mInline(TypeUndefined)			{ ALLOC_LLSD_OBJECT;	assign((Real)v); }
 
 // Scalar Assignment
-void LLSD::assign(Boolean v)			{ safe(impl).assign(impl, v); }
-void LLSD::assign(Integer v)			{ safe(impl).assign(impl, v); }
-void LLSD::assign(Real v)				{ safe(impl).assign(impl, v); }
-void LLSD::assign(const String& v)		{ safe(impl).assign(impl, v); }
-void LLSD::assign(const UUID& v)		{ safe(impl).assign(impl, v); }
-void LLSD::assign(const Date& v)		{ safe(impl).assign(impl, v); }
-void LLSD::assign(const URI& v)			{ safe(impl).assign(impl, v); }
-void LLSD::assign(const Binary& v)		{ safe(impl).assign(impl, v); }
+void LLSD::assign(Boolean v)			{ Impl::makeInline(*this, TypeBoolean); mBoolean = v; }
+void LLSD::assign(Integer v)			{ Impl::makeInline(*this, TypeInteger); mInteger = v; }
+void LLSD::assign(Real v)				{ Impl::makeInline(*this, TypeReal); mReal = v; }
+void LLSD::assign(const UUID& v)
+{
+	const UUID id(v);
+	Impl::makeInline(*this, TypeUUID);
+	memcpy(mUUID, id.mData, UUID_BYTES);
+}
+void LLSD::assign(const String& v)		{ Impl*& var = Impl::outOfLine(*this); safe(var).assign(var, v); }
+void LLSD::assign(const Date& v)		{ Impl*& var = Impl::outOfLine(*this); safe(var).assign(var, v); }
+void LLSD::assign(const URI& v)			{ Impl*& var = Impl::outOfLine(*this); safe(var).assign(var, v); }
+void LLSD::assign(const Binary& v)		{ Impl*& var = Impl::outOfLine(*this); safe(var).assign(var, v); }
+void LLSD::assign(String&& v)			{ Impl*& var = Impl::outOfLine(*this); safe(var).assign(var, std::move(v)); }
+void LLSD::assign(Binary&& v)			{ Impl*& var = Impl::outOfLine(*this); safe(var).assign(var, std::move(v)); }
 
 // Scalar Accessors
-LLSD::Boolean	LLSD::asBoolean() const	{ return safe(impl).asBoolean(); }
-LLSD::Integer	LLSD::asInteger() const	{ return safe(impl).asInteger(); }
-LLSD::Real		LLSD::asReal() const	{ return safe(impl).asReal(); }
-LLSD::String	LLSD::asString() const	{ return safe(impl).asString(); }
-LLSD::UUID		LLSD::asUUID() const	{ return safe(impl).asUUID(); }
-LLSD::Date		LLSD::asDate() const	{ return safe(impl).asDate(); }
-LLSD::URI		LLSD::asURI() const		{ return safe(impl).asURI(); }
-const LLSD::Binary&	LLSD::asBinary() const	{ return safe(impl).asBinary(); }
+LLSD::Boolean LLSD::asBoolean() const
+{
+	switch (mInline)
+	{
+	case TypeBoolean:	return mBoolean;
+	case TypeInteger:	return mInteger != 0;
+	case TypeReal:		return !llisnan(mReal) && mReal != 0.0;
+	case TypeUUID:		return false;
+	default:			return safe(impl).asBoolean();
+	}
+}
+
+LLSD::Integer LLSD::asInteger() const
+{
+	switch (mInline)
+	{
+	case TypeBoolean:	return mBoolean ? 1 : 0;
+	case TypeInteger:	return mInteger;
+	case TypeReal:		return !llisnan(mReal) ? static_cast<Integer>(mReal) : 0;
+	case TypeUUID:		return 0;
+	default:			return safe(impl).asInteger();
+	}
+}
+
+LLSD::Real LLSD::asReal() const
+{
+	switch (mInline)
+	{
+	case TypeBoolean:	return mBoolean ? 1 : 0;
+	case TypeInteger:	return mInteger;
+	case TypeReal:		return mReal;
+	case TypeUUID:		return 0.0;
+	default:			return safe(impl).asReal();
+	}
+}
+
+LLSD::String LLSD::asString() const
+{
+	switch (mInline)
+	{
+	case TypeBoolean:
+		// *NOTE: The reason that false is not converted to "false" is
+		// because that would break roundtripping,
+		// e.g. LLSD(false).asString().asBoolean().  There are many
+		// reasons for wanting LLSD("false").asBoolean() == true, such
+		// as "everything else seems to work that way".
+		return mBoolean ? "true" : "";
+	case TypeInteger:	return fmt::format("{:d}", mInteger);
+	case TypeReal:		return fmt::format(FMT_STRING("{:g}"), mReal);
+	case TypeUUID:		return asUUID().asString();
+	default:			return safe(impl).asString();
+	}
+}
+
+LLSD::UUID LLSD::asUUID() const
+{
+	if (mInline == TypeUUID)
+	{
+		UUID id;
+		memcpy(id.mData, mUUID, UUID_BYTES);
+		return id;
+	}
+	return Impl::getImpl(*this).asUUID();
+}
+
+LLSD::Date		LLSD::asDate() const	{ return Impl::getImpl(*this).asDate(); }
+LLSD::URI		LLSD::asURI() const		{ return Impl::getImpl(*this).asURI(); }
+const LLSD::Binary&	LLSD::asBinary() const	{ return Impl::getImpl(*this).asBinary(); }
 
-const LLSD::String& LLSD::asStringRef() const { return safe(impl).asStringRef(); }
+const LLSD::String& LLSD::asStringRef() const { return Impl::getImpl(*this).asStringRef(); }
 
 // const char * helpers
-LLSD::LLSD(const char* v) : impl(nullptr)		{ ALLOC_LLSD_OBJECT;	assign(v); }
+LLSD::LLSD(const char* v) : impl(nullptr), mInline(TypeUndefined)	{ ALLOC_LLSD_OBJECT;	assign(v); }
 void LLSD::assign(const char* v)
 {
 	if(v) assign(std::string(v));
@@ -882,21 +1138,21 @@ LLSD LLSD::emptyMap()
 	return v;
 }
 
-bool LLSD::has(const String& k) const	{ return safe(impl).has(k); }
-LLSD LLSD::get(const String& k) const	{ return safe(impl).get(k); } 
-void LLSD::insert(const String& k, const LLSD& v) {	makeMap(impl).insert(k, v); }
+bool LLSD::has(const String& k) const	{ return Impl::getImpl(*this).has(k); }
+LLSD LLSD::get(const String& k) const	{ return Impl::getImpl(*this).get(k); } 
+void LLSD::insert(const String& k, const LLSD& v) {	makeMap(Impl::outOfLine(*this)).insert(k, v); }
 
 LLSD& LLSD::with(const String& k, const LLSD& v)
 										{ 
-											makeMap(impl).insert(k, v); 
+											makeMap(Impl::outOfLine(*this)).insert(k, v); 
 											return *this;
 										}
-void LLSD::erase(const String& k)		{ makeMap(impl).erase(k); }
+void LLSD::erase(const String& k)		{ makeMap(Impl::outOfLine(*this)).erase(k); }
 
 LLSD&		LLSD::operator[](const String& k)
-										{ return makeMap(impl).ref(k); }
+										{ return makeMap(Impl::outOfLine(*this)).ref(k); }
 const LLSD& LLSD::operator[](const String& k) const
-										{ return safe(impl).ref(k); }
+										{ return Impl::getImpl(*this).ref(k); }
 
 
 LLSD LLSD::emptyArray()
@@ -906,24 +1162,24 @@ LLSD LLSD::emptyArray()
 	return v;
 }
 
-int LLSD::size() const					{ return safe(impl).size(); }
+int LLSD::size() const					{ return Impl::getImpl(*this).size(); }
  
-LLSD LLSD::get(Integer i) const			{ return safe(impl).get(i); } 
-void LLSD::set(Integer i, const LLSD& v){ makeArray(impl).set(i, v); }
-void LLSD::insert(Integer i, const LLSD& v) { makeArray(impl).insert(i, v); }
+LLSD LLSD::get(Integer i) const			{ return Impl::getImpl(*this).get(i); } 
+void LLSD::set(Integer i, const LLSD& v){ makeArray(Impl::outOfLine(*this)).set(i, v); }
+void LLSD::insert(Integer i, const LLSD& v) { makeArray(Impl::outOfLine(*this)).insert(i, v); }
 
 LLSD& LLSD::with(Integer i, const LLSD& v)
 										{ 
-											makeArray(impl).insert(i, v); 
+											makeArray(Impl::outOfLine(*this)).insert(i, v); 
 											return *this;
 										}
-void LLSD::append(const LLSD& v)		{ makeArray(impl).append(v); }
-void LLSD::erase(Integer i)				{ makeArray(impl).erase(i); }
+void LLSD::append(const LLSD& v)		{ makeArray(Impl::outOfLine(*this)).append(v); }
+void LLSD::erase(Integer i)				{ makeArray(Impl::outOfLine(*this)).erase(i); }
 
 LLSD&		LLSD::operator[](Integer i)
-										{ return makeArray(impl).ref(i); }
+										{ return makeArray(Impl::outOfLine(*this)).ref(i); }
 const LLSD& LLSD::operator[](Integer i) const
-										{ return safe(impl).ref(i); }
+										{ return Impl::getImpl(*this).ref(i); }
 
 static const char *llsd_dump(const LLSD &llsd, bool useXMLFormat)
 {
@@ -963,18 +1219,18 @@ const char *LLSD::dump(const LLSD &llsd)
 	return llsd_dump(llsd, false);
 }
 
-LLSD::map_iterator			LLSD::beginMap()		{ return makeMap(impl).beginMap(); }
-LLSD::map_iterator			LLSD::endMap()			{ return makeMap(impl).endMap(); }
-LLSD::map_const_iterator	LLSD::beginMap() const	{ return safe(impl).beginMap(); }
-LLSD::map_const_iterator	LLSD::endMap() const	{ return safe(impl).endMap(); }
+LLSD::map_iterator			LLSD::beginMap()		{ return makeMap(Impl::outOfLine(*this)).beginMap(); }
+LLSD::map_iterator			LLSD::endMap()			{ return makeMap(Impl::outOfLine(*this)).endMap(); }
+LLSD::map_const_iterator	LLSD::beginMap() const	{ return Impl::getImpl(*this).beginMap(); }
+LLSD::map_const_iterator	LLSD::endMap() const	{ return Impl::getImpl(*this).endMap(); }
 
-LLSD::array_iterator		LLSD::beginArray()		{ return makeArray(impl).beginArray(); }
-LLSD::array_iterator		LLSD::endArray()		{ return makeArray(impl).endArray(); }
-LLSD::array_const_iterator	LLSD::beginArray() const{ return safe(impl).beginArray(); }
-LLSD::array_const_iterator	LLSD::endArray() const	{ return safe(impl).endArray(); }
+LLSD::array_iterator		LLSD::beginArray()		{ return makeArray(Impl::outOfLine(*this)).beginArray(); }
+LLSD::array_iterator		LLSD::endArray()		{ return makeArray(Impl::outOfLine(*this)).endArray(); }
+LLSD::array_const_iterator	LLSD::beginArray() const{ return Impl::getImpl(*this).beginArray(); }
+LLSD::array_const_iterator	LLSD::endArray() const	{ return Impl::getImpl(*this).endArray(); }
 
-LLSD::reverse_array_iterator	LLSD::rbeginArray()		{ return makeArray(impl).rbeginArray(); }
-LLSD::reverse_array_iterator	LLSD::rendArray()		{ return makeArray(impl).rendArray(); }
+LLSD::reverse_array_iterator	LLSD::rbeginArray()		{ return makeArray(Impl::outOfLine(*this)).rbeginArray(); }
+LLSD::reverse_array_iterator	LLSD::rendArray()		{ return makeArray(Impl::outOfLine(*this)).rendArray(); }
 
 namespace llsd
 {
@@ -29,6 +29,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "stdtypes.h"
@@ -194,6 +195,8 @@ public:
 		LLSD(const Date&);
 		LLSD(const URI&);
 		LLSD(const Binary&);
+		LLSD(String&&);
+		LLSD(Binary&&);
 	//@}
 
 	/** @name Convenience Constructors */
@@ -211,6 +214,8 @@ public:
 		void assign(const Date&);
 		void assign(const URI&);
 		void assign(const Binary&);
+		void assign(String&&);
+		void assign(Binary&&);
 		
 		LLSD& operator=(Boolean v)			{ assign(v); return *this; }
 		LLSD& operator=(Integer v)			{ assign(v); return *this; }
@@ -220,6 +225,8 @@ public:
 		LLSD& operator=(const Date& v)		{ assign(v); return *this; }
 		LLSD& operator=(const URI& v)		{ assign(v); return *this; }
 		LLSD& operator=(const Binary& v)	{ assign(v); return *this; }
+		LLSD& operator=(String&& v)			{ assign(std::move(v)); return *this; }
+		LLSD& operator=(Binary&& v)			{ assign(std::move(v)); return *this; }
 	//@}
 
 	/**
@@ -394,12 +401,23 @@ public:
 		bool has(Integer) const;		///< has() only works for Maps
 	//@}
 	
-	/** @name Implementation */
+	/** @name Implementation
+		Booleans, Integers, Reals and UUIDs are held inline and copied by
+		value, everything else is a shared, reference counted Impl.
+	 */
 	//@{
 public:
 		class Impl;
 private:
-		Impl* impl;
+		union
+		{
+			Impl* impl;				///< used when mInline is TypeUndefined
+			Boolean mBoolean;
+			Integer mInteger;
+			Real mReal;
+			U8 mUUID[UUID_BYTES];
+		};
+		Type mInline;				///< type of the inline value, if any
 		friend class LLSD::Impl;
 	//@}
 
@@ -418,6 +436,33 @@ public:
 	static std::string		typeString(Type type);		// Return human-readable type as a string
 };
 
+/**
+	Allocates the Impls created on this thread while it is in scope, such as
+	the strings, maps and arrays of a document being parsed, from a few large
+	blocks instead of one heap allocation each. The blocks are all freed at
+	once, when the arena has gone out of scope and the last value made in it
+	has been released. Copying an LLSD shares its Impl, so a string kept long
+	after the rest of a large document should be kept as a new value
+	(LLSD(value.asString())) rather than a copy.
+
+	Arenas nest and must be destroyed on the thread that created them.
+ */
+class LL_COMMON_API LLSDArena
+{
+public:
+	LLSDArena();
+	~LLSDArena();
+
+	LLSDArena(const LLSDArena&) = delete;
+	LLSDArena& operator=(const LLSDArena&) = delete;
+
+	class Blocks;
+
+private:
+	Blocks* mBlocks;
+	Blocks* mPrevious;
+};
+
 LL_COMMON_API std::ostream& operator<<(std::ostream& s, const LLSD& llsd);
 
 namespace llsd
@@ -34,6 +34,7 @@
 #include "llbase64.h"
 
 #include <iostream>
+#include <optional>
 
 #include <boost/iostreams/device/array.hpp>
 #include <boost/iostreams/stream.hpp>
@@ -313,7 +314,7 @@ static const char BINARY_FALSE_SERIAL = '0';
  * LLSDParser
  */
 LLSDParser::LLSDParser()
-	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false)
+	: mCheckLimits(true), mMaxBytesLeft(0), mParseLines(false), mUseArena(false), mListener(nullptr)
 {
 }
 
@@ -325,15 +326,37 @@ S32 LLSDParser::parse(std::istream& istr, LLSD& data, S32 max_bytes, S32 max_dep
 {
 	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
 	mMaxBytesLeft = max_bytes;
+	std::optional<LLSDArena> arena;
+	if (mUseArena)
+	{
+		arena.emplace();
+	}
 	return doParse(istr, data, max_depth);
 }
 
+S32 LLSDParser::parse(std::istream& istr, LLSDParserListener& listener, S32 max_bytes, S32 max_depth)
+{
+	// No arena, the values are released as they are passed on
+	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
+	mMaxBytesLeft = max_bytes;
+	mListener = &listener;
+	LLSD data;
+	S32 parse_count = doParse(istr, data, max_depth);
+	mListener = nullptr;
+	return parse_count;
+}
+
 
 // Parse using routine to get() lines, faster than parse()
 S32 LLSDParser::parseLines(std::istream& istr, LLSD& data)
 {
 	mCheckLimits = false;
 	mParseLines = true;
+	std::optional<LLSDArena> arena;
+	if (mUseArena)
+	{
+		arena.emplace();
+	}
 	return doParse(istr, data);
 }
 
@@ -394,6 +417,24 @@ void LLSDParser::account(S32 bytes) const
 	if(mCheckLimits) mMaxBytesLeft -= bytes;
 }
 
+void LLSDParser::notifyListener(const LLSD& data) const
+{
+	switch(data.type())
+	{
+	case LLSD::TypeMap:
+		mListener->endMap();
+		break;
+
+	case LLSD::TypeArray:
+		mListener->endArray();
+		break;
+
+	default:
+		mListener->value(data);
+		break;
+	}
+}
+
 
 /**
  * LLSDNotationParser
@@ -442,6 +483,7 @@ S32 LLSDNotationParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) c
 	{
 	case '{':
 	{
+		if(mListener) mListener->beginMap();
 		S32 child_count = parseMap(istr, data, max_depth - 1);
 		if((child_count == PARSE_FAILURE) || data.isUndefined())
 		{
@@ -461,6 +503,7 @@ S32 LLSDNotationParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) c
 
 	case '[':
 	{
+		if(mListener) mListener->beginArray();
 		S32 child_count = parseArray(istr, data, max_depth - 1);
 		if((child_count == PARSE_FAILURE) || data.isUndefined())
 		{
@@ -663,6 +706,10 @@ S32 LLSDNotationParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) c
 	{
 		data.clear();
 	}
+	else if(mListener)
+	{
+		notifyListener(data);
+	}
 	return parse_count;
 }
 
@@ -689,6 +736,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) c
 					int count = deserialize_string(istr, name, mMaxBytesLeft);
 					if(PARSE_FAILURE == count) return PARSE_FAILURE;
 					account(count);
+					if(mListener) mListener->key(name);
 				}
 				c = get(istr);
 			}
@@ -707,7 +755,7 @@ S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) c
 					// There must be a value for every key, thus
 					// child_count must be greater than 0.
 					parse_count += count;
-					map.insert(name, child);
+					if(!mListener) map.insert(name, child);
 				}
 				else
 				{
@@ -753,7 +801,7 @@ S32 LLSDNotationParser::parseArray(std::istream& istr, LLSD& array, S32 max_dept
 			else
 			{
 				parse_count += count;
-				array.append(child);
+				if(!mListener) array.append(child);
 			}
 			c = get(istr);
 		}
@@ -902,6 +950,7 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
 	{
 	case '{':
 	{
+		if(mListener) mListener->beginMap();
 		S32 child_count = parseMap(istr, data, max_depth - 1);
 		if((child_count == PARSE_FAILURE) || data.isUndefined())
 		{
@@ -921,6 +970,7 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
 
 	case '[':
 	{
+		if(mListener) mListener->beginArray();
 		S32 child_count = parseArray(istr, data, max_depth - 1);
 		if((child_count == PARSE_FAILURE) || data.isUndefined())
 		{
@@ -1099,6 +1149,10 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data, S32 max_depth) con
 	{
 		data.clear();
 	}
+	else if(mListener)
+	{
+		notifyListener(data);
+	}
 	return parse_count;
 }
 
@@ -1131,6 +1185,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
 			break;
 		}
 		}
+		if(mListener) mListener->key(name);
 		LLSD child;
 		S32 child_count = doParse(istr, child, max_depth);
 		if(child_count > 0)
@@ -1138,7 +1193,7 @@ S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map, S32 max_depth) con
 			// There must be a value for every key, thus child_count
 			// must be greater than 0.
 			parse_count += child_count;
-			map.insert(name, child);
+			if(!mListener) map.insert(name, child);
 		}
 		else
 		{
@@ -1180,7 +1235,7 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array, S32 max_depth)
 		if(child_count)
 		{
 			parse_count += child_count;
-			array.append(child);
+			if(!mListener) array.append(child);
 		}
 		++count;
 		c = istr.peek();
@@ -1216,6 +1271,441 @@ bool LLSDBinaryParser::parseString(
 }
 
 
+
+/**
+ * LLSDBinaryChunkParser
+ */
+LLSDBinaryChunkParser::LLSDBinaryChunkParser(S32 max_bytes, S32 max_depth)
+:	mMaxBytes(max_bytes),
+	mMaxDepth(max_depth)
+{
+	reset();
+}
+
+void LLSDBinaryChunkParser::reset()
+{
+	mResult.clear();
+	mDiscards.clear();
+	mSlot = &mResult;
+	mStack.clear();
+	mKey.clear();
+	mText.clear();
+	mBinary.clear();
+	mStatus = STATUS_MORE;
+	mState = READ_TYPE;
+	mType = 0;
+	mInKey = false;
+	mEscaped = false;
+	mScratchUsed = 0;
+	mNeeded = 0;
+	mConsumed = 0;
+	mObjects = 0;
+}
+
+LLSDBinaryChunkParser::EStatus LLSDBinaryChunkParser::feed(const char* data, size_t len)
+{
+	const char* ptr = data;
+	const char* end = data + len;
+	while (mStatus == STATUS_MORE && ptr < end)
+	{
+		switch (mState)
+		{
+		case READ_TYPE:
+			if (!readType(*ptr++))
+			{
+				fail();
+			}
+			break;
+
+		case READ_KEY:
+			if (!readKey(*ptr++))
+			{
+				fail();
+			}
+			break;
+
+		case READ_CLOSE:
+			if (*ptr++ != (mStack.back().mMap ? '}' : ']'))
+			{
+				fail();
+				break;
+			}
+			mStack.pop_back();
+			endValue();
+			break;
+
+		case READ_FIXED:
+		{
+			const size_t avail = end - ptr;
+			const char* value = ptr;
+			if (!mScratchUsed && avail >= mNeeded)
+			{
+				// Read in place unless it is split between chunks
+				ptr += mNeeded;
+			}
+			else
+			{
+				const size_t count = llmin(avail, mNeeded - mScratchUsed);
+				memcpy(mScratch + mScratchUsed, ptr, count);
+				mScratchUsed += count;
+				ptr += count;
+				if (mScratchUsed < mNeeded)
+				{
+					break;
+				}
+				mScratchUsed = 0;
+				value = mScratch;
+			}
+			if (!readFixed(value))
+			{
+				fail();
+			}
+			break;
+		}
+
+		case READ_BYTES:
+		{
+			const size_t count = llmin((size_t)(end - ptr), mNeeded);
+			if (mType == 'b')
+			{
+				mBinary.insert(mBinary.end(), (const U8*)ptr, (const U8*)ptr + count);
+			}
+			else
+			{
+				(mInKey ? mKey : mText).append(ptr, count);
+			}
+			ptr += count;
+			mNeeded -= count;
+			if (!mNeeded && !endBytes())
+			{
+				fail();
+			}
+			break;
+		}
+
+		case READ_DELIMITED:
+		{
+			// Gather up to the closing quote, escapes are decoded at the end
+			const char* start = ptr;
+			bool closed = false;
+			while (ptr < end && !closed)
+			{
+				const char c = *ptr++;
+				if (mEscaped)
+				{
+					mEscaped = false;
+				}
+				else if (c == '\\')
+				{
+					mEscaped = true;
+				}
+				else
+				{
+					closed = (c == mType);
+				}
+			}
+			(mInKey ? mKey : mText).append(start, ptr - start);
+			if (closed && !endDelimited())
+			{
+				fail();
+			}
+			break;
+		}
+		}
+	}
+	mConsumed += ptr - data;
+	return mStatus;
+}
+
+bool LLSDBinaryChunkParser::readType(char c)
+{
+	if (!beginValue())
+	{
+		return false;
+	}
+
+	mType = c;
+	switch (c)
+	{
+	case '{':
+	case '[':
+	case 'i':
+	case 's':
+	case 'l':
+	case 'b':
+		mNeeded = sizeof(U32);
+		mState = READ_FIXED;
+		return true;
+
+	case 'r':
+	case 'd':
+		mNeeded = sizeof(F64);
+		mState = READ_FIXED;
+		return true;
+
+	case 'u':
+		mNeeded = UUID_BYTES;
+		mState = READ_FIXED;
+		return true;
+
+	case '!':
+		mSlot->clear();
+		endValue();
+		return true;
+
+	case '0':
+		*mSlot = false;
+		endValue();
+		return true;
+
+	case '1':
+		*mSlot = true;
+		endValue();
+		return true;
+
+	case '\'':
+	case '"':
+		mText.clear();
+		mEscaped = false;
+		mState = READ_DELIMITED;
+		return true;
+
+	default:
+		LL_INFOS() << "Unrecognized character while parsing: int(" << (int)c
+			<< ")" << LL_ENDL;
+		return false;
+	}
+}
+
+bool LLSDBinaryChunkParser::readKey(char c)
+{
+	mInKey = true;
+	mType = c;
+	switch (c)
+	{
+	case 'k':
+		mNeeded = sizeof(U32);
+		mState = READ_FIXED;
+		return true;
+
+	case '\'':
+	case '"':
+		mKey.clear();
+		mEscaped = false;
+		mState = READ_DELIMITED;
+		return true;
+
+	default:
+		// Including a '}' before as many keys as the map said it had
+		return false;
+	}
+}
+
+bool LLSDBinaryChunkParser::readFixed(const char* data)
+{
+	switch (mType)
+	{
+	case '{':
+	case '[':
+	{
+		U32 size_nbo;
+		memcpy(&size_nbo, data, sizeof(U32));
+		const S32 size = (S32)ntohl(size_nbo);
+		if (size < 0)
+		{
+			return false;
+		}
+		const bool map = (mType == '{');
+		*mSlot = map ? LLSD::emptyMap() : LLSD::emptyArray();
+		mStack.push_back(Frame{ mSlot, size, map });
+		mState = !size ? READ_CLOSE : (map ? READ_KEY : READ_TYPE);
+		return true;
+	}
+
+	case 'i':
+	{
+		U32 value_nbo;
+		memcpy(&value_nbo, data, sizeof(U32));
+		*mSlot = (S32)ntohl(value_nbo);
+		break;
+	}
+
+	case 'r':
+	{
+		F64 real_nbo;
+		memcpy(&real_nbo, data, sizeof(F64));
+		*mSlot = ll_ntohd(real_nbo);
+		break;
+	}
+
+	case 'd':
+	{
+		F64 real;
+		memcpy(&real, data, sizeof(F64));
+		*mSlot = LLDate(real);
+		break;
+	}
+
+	case 'u':
+	{
+		LLUUID id;
+		memcpy(id.mData, data, UUID_BYTES);
+		*mSlot = id;
+		break;
+	}
+
+	default:
+		return beginBytes(data);
+	}
+	endValue();
+	return true;
+}
+
+bool LLSDBinaryChunkParser::beginValue()
+{
+	if (mMaxDepth >= 0 && (S32)mStack.size() >= mMaxDepth)
+	{
+		return false;
+	}
+	if (mStack.empty())
+	{
+		mSlot = &mResult;
+		return true;
+	}
+
+	LLSD& container = *mStack.back().mContainer;
+	if (mStack.back().mMap)
+	{
+		const S32 size = container.size();
+		mSlot = &container[mKey];
+		if (container.size() == size)
+		{
+			mDiscards.emplace_back();
+			mSlot = &mDiscards.back();
+		}
+	}
+	else
+	{
+		// The array grows here, before the value is read.  Only the
+		// innermost container ever grows, so the slots the outer frames
+		// point into stay put while it is read.
+		mSlot = &container[container.size()];
+	}
+	return true;
+}
+
+void LLSDBinaryChunkParser::endValue()
+{
+	++mObjects;
+	if (mStack.empty())
+	{
+		mStatus = STATUS_DONE;
+		return;
+	}
+
+	Frame& frame = mStack.back();
+	if (--frame.mRemaining <= 0)
+	{
+		mState = READ_CLOSE;
+	}
+	else
+	{
+		mState = frame.mMap ? READ_KEY : READ_TYPE;
+	}
+}
+
+bool LLSDBinaryChunkParser::beginBytes(const char* size_nbo)
+{
+	U32 value_nbo;
+	memcpy(&value_nbo, size_nbo, sizeof(U32));
+	const S32 size = (S32)ntohl(value_nbo);
+	if (size < 0 || (mMaxBytes >= 0 && size > mMaxBytes))
+	{
+		return false;
+	}
+
+	// Sizes are not trusted with more memory than a block up front
+	const size_t reserve = llmin(size, 65536);
+	if (mType == 'b')
+	{
+		mBinary.clear();
+		mBinary.reserve(reserve);
+	}
+	else
+	{
+		std::string& text = mInKey ? mKey : mText;
+		text.clear();
+		text.reserve(reserve);
+	}
+
+	mNeeded = size;
+	if (!mNeeded)
+	{
+		return endBytes();
+	}
+	mState = READ_BYTES;
+	return true;
+}
+
+bool LLSDBinaryChunkParser::endBytes()
+{
+	if (mInKey)
+	{
+		mInKey = false;
+		mState = READ_TYPE;
+		return true;
+	}
+
+	switch (mType)
+	{
+	case 's':
+		*mSlot = std::move(mText);
+		mText.clear();
+		break;
+
+	case 'l':
+		*mSlot = LLURI(mText);
+		break;
+
+	default:
+		*mSlot = std::move(mBinary);
+		mBinary.clear();
+		break;
+	}
+	endValue();
+	return true;
+}
+
+bool LLSDBinaryChunkParser::endDelimited()
+{
+	// The opening quote was taken by readType() or readKey()
+	std::string& raw = mInKey ? mKey : mText;
+	std::istringstream istr(raw);
+	std::string value;
+	if (LLSDParser::PARSE_FAILURE == deserialize_string_delim(istr, value, mType))
+	{
+		return false;
+	}
+
+	if (mInKey)
+	{
+		mKey = std::move(value);
+		mInKey = false;
+		mState = READ_TYPE;
+		return true;
+	}
+	*mSlot = std::move(value);
+	endValue();
+	return true;
+}
+
+void LLSDBinaryChunkParser::fail()
+{
+	mStatus = STATUS_FAILED;
+	mResult.clear();
+}
+
+
 /**
  * LLSDFormatter
  */
@@ -1548,6 +2038,160 @@ void LLSDBinaryFormatter::formatString(
 	ostr.write(string.c_str(), string.size());
 }
 
+/**
+ * LLSDBinaryChunkFormatter
+ */
+LLSDBinaryChunkFormatter::LLSDBinaryChunkFormatter(const writer_t& writer, size_t buffer_size)
+:	mWriter(writer),
+	mBuffer(llmax(buffer_size, (size_t)64)),
+	mUsed(0)
+{
+}
+
+LLSDBinaryChunkFormatter::~LLSDBinaryChunkFormatter()
+{
+	flush();
+}
+
+void LLSDBinaryChunkFormatter::flush()
+{
+	if (mUsed)
+	{
+		mWriter(&mBuffer[0], mUsed);
+		mUsed = 0;
+	}
+}
+
+void LLSDBinaryChunkFormatter::put(char c)
+{
+	if (mUsed == mBuffer.size())
+	{
+		flush();
+	}
+	mBuffer[mUsed++] = c;
+}
+
+void LLSDBinaryChunkFormatter::write(const void* data, size_t len)
+{
+	if (len > mBuffer.size() - mUsed)
+	{
+		flush();
+		if (len > mBuffer.size())
+		{
+			mWriter(static_cast<const char*>(data), len);
+			return;
+		}
+	}
+	memcpy(&mBuffer[mUsed], data, len);
+	mUsed += len;
+}
+
+void LLSDBinaryChunkFormatter::writeSize(size_t size)
+{
+	U32 size_nbo = htonl((U32)size);
+	write(&size_nbo, sizeof(U32));
+}
+
+void LLSDBinaryChunkFormatter::writeString(const std::string& string)
+{
+	writeSize(string.size());
+	write(string.data(), string.size());
+}
+
+S32 LLSDBinaryChunkFormatter::format(const LLSD& data)
+{
+	S32 format_count = 1;
+	switch(data.type())
+	{
+	case LLSD::TypeMap:
+		put('{');
+		writeSize(data.size());
+		for(auto iter = data.beginMap(), end = data.endMap(); iter != end; ++iter)
+		{
+			put('k');
+			writeString((*iter).first);
+			format_count += format((*iter).second);
+		}
+		put('}');
+		break;
+
+	case LLSD::TypeArray:
+		put('[');
+		writeSize(data.size());
+		for(auto iter = data.beginArray(), end = data.endArray(); iter != end; ++iter)
+		{
+			format_count += format(*iter);
+		}
+		put(']');
+		break;
+
+	case LLSD::TypeUndefined:
+		put('!');
+		break;
+
+	case LLSD::TypeBoolean:
+		put(data.asBoolean() ? BINARY_TRUE_SERIAL : BINARY_FALSE_SERIAL);
+		break;
+
+	case LLSD::TypeInteger:
+	{
+		put('i');
+		U32 value_nbo = htonl(data.asInteger());
+		write(&value_nbo, sizeof(U32));
+		break;
+	}
+
+	case LLSD::TypeReal:
+	{
+		put('r');
+		F64 value_nbo = ll_htond(data.asReal());
+		write(&value_nbo, sizeof(F64));
+		break;
+	}
+
+	case LLSD::TypeUUID:
+	{
+		put('u');
+		LLUUID temp = data.asUUID();
+		write(temp.mData, UUID_BYTES);
+		break;
+	}
+
+	case LLSD::TypeString:
+		put('s');
+		writeString(data.asStringRef());
+		break;
+
+	case LLSD::TypeDate:
+	{
+		put('d');
+		F64 value = data.asReal();
+		write(&value, sizeof(F64));
+		break;
+	}
+
+	case LLSD::TypeURI:
+		put('l');
+		writeString(data.asString());
+		break;
+
+	case LLSD::TypeBinary:
+	{
+		put('b');
+		const std::vector<U8>& buffer = data.asBinary();
+		writeSize(buffer.size());
+		if(!buffer.empty()) write(&buffer[0], buffer.size());
+		break;
+	}
+
+	default:
+		// *NOTE: This should never happen.
+		put('!');
+		break;
+	}
+	return format_count;
+}
+
 /**
  * local functions
  */
@@ -2148,83 +2792,99 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
 
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, U8* in, S32 size)
 {
-	U8* result = NULL;
-	U32 cur_size = 0;
-	z_stream strm;
-		
-	const U32 CHUNK = 65536;
+	std::vector<U8> result;
+	EZipRresult ret = unzip(result, in, size);
+	if (ret != ZR_OK)
+	{
+		return ret;
+	}
 
-	U8 out[CHUNK];
+	//result now holds the decompressed LLSD block
+	{
+		U32 cur_size = result.size();
+		char* result_ptr = strip_deprecated_header((char*)result.data(), cur_size);
+
+		boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
 		
+		// Mesh and material blocks are read into other structures and
+		// dropped, so a whole arena is freed at once
+		LLPointer<LLSDBinaryParser> parser = new LLSDBinaryParser;
+		parser->setUseArena(true);
+		if (!parser->parse(istrm, data, cur_size, UNZIP_LLSD_MAX_DEPTH))
+		{
+			LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
+			return ZR_PARSE_ERROR;
+		}
+	}
+
+	return ZR_OK;
+}
+
+LLUZipHelper::EZipRresult LLUZipHelper::unzip(std::vector<U8>& result, const U8* in, S32 size)
+{
+	result.clear();
+
+	z_stream strm;
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
 	strm.avail_in = size;
-	strm.next_in = in;
+	strm.next_in = const_cast<U8*>(in);
 
-	S32 ret = inflateInit(&strm);
-	
-	do
+	if (inflateInit(&strm) != Z_OK)
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out;
-		ret = inflate(&strm, Z_NO_FLUSH);
-		
-		switch (ret)
-		{
-		case Z_NEED_DICT:
-			ret = Z_DATA_ERROR;
-		case Z_DATA_ERROR:
-		case Z_MEM_ERROR:
-		case Z_STREAM_ERROR:
-			inflateEnd(&strm);
-			free(result);
-			return ZR_MEM_ERROR;
-			break;
-		}
-
-		U32 have = CHUNK-strm.avail_out;
+		return ZR_MEM_ERROR;
+	}
 
-		U8* new_result = (U8*)realloc(result, cur_size + have);
-		if (new_result == NULL)
+	// Inflate straight into result, growing it as needed. LLSD blocks
+	// usually inflate to a few times their size.
+	const size_t MIN_CAPACITY = 1024;
+	S32 ret = Z_OK;
+	try
+	{
+		result.resize(llmax((size_t)size * 4, MIN_CAPACITY));
+		size_t cur_size = 0;
+		do
 		{
-			LL_WARNS() << "Failed to unzip LLSD block: can't reallocate memory, current size: " << cur_size << " bytes; requested " << cur_size + have << " bytes." << LL_ENDL;
-			inflateEnd(&strm);
-			if (result)
+			if (cur_size == result.size())
 			{
-				free(result);
+				result.resize(result.size() * 2);
 			}
-			return ZR_MEM_ERROR;
-		}
-		result = new_result;
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
+			strm.avail_out = (uInt)(result.size() - cur_size);
+			strm.next_out = result.data() + cur_size;
+			ret = inflate(&strm, Z_NO_FLUSH);
 
-	} while (ret == Z_OK);
+			switch (ret)
+			{
+			case Z_NEED_DICT:
+			case Z_DATA_ERROR:
+			case Z_MEM_ERROR:
+			case Z_STREAM_ERROR:
+				inflateEnd(&strm);
+				result.clear();
+				return ZR_MEM_ERROR;
+			}
+
+			cur_size = result.size() - strm.avail_out;
+		} while (ret == Z_OK);
+		result.resize(cur_size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		LL_WARNS() << "Failed to unzip LLSD block: can't allocate memory, current size: " << result.size() << " bytes" << LL_ENDL;
+		inflateEnd(&strm);
+		result.clear();
+		return ZR_MEM_ERROR;
+	}
 
 	inflateEnd(&strm);
 
 	if (ret != Z_STREAM_END)
 	{
-		free(result);
+		result.clear();
 		return ZR_DATA_ERROR;
 	}
 
-	//result now points to the decompressed LLSD block
-	{
-		char* result_ptr = strip_deprecated_header((char*)result, cur_size);
-
-		boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
-		
-		if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
-		{
-			LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
-			free(result);
-			return ZR_PARSE_ERROR;
-		}
-	}
-
-	free(result);
 	return ZR_OK;
 }
 
@@ -29,12 +29,39 @@
 #ifndef LL_LLSDSERIALIZE_H
 #define LL_LLSDSERIALIZE_H
 
+#include <deque>
+#include <functional>
 #include <iosfwd>
 #include <utility>
+#include <vector>
 #include "llpointer.h"
 #include "llrefcount.h"
 #include "llsd.h"
 
+/** 
+ * @class LLSDParserListener
+ * @brief Receives a document from an LLSDParser as it is read.
+ *
+ * Passed to LLSDParser::parse() in place of an LLSD, so consumers can
+ * build their own structures without the whole document first being held
+ * as an LLSD tree. Maps and arrays arrive as begin and end calls around
+ * their contents, with each map value preceded by its key, and every
+ * other value arrives whole in value(). Repeated map keys are passed on
+ * as they appear.
+ */
+class LL_COMMON_API LLSDParserListener
+{
+public:
+	virtual ~LLSDParserListener() = default;
+
+	virtual void beginMap() = 0;
+	virtual void endMap() = 0;
+	virtual void beginArray() = 0;
+	virtual void endArray() = 0;
+	virtual void key(const std::string& key) = 0;
+	virtual void value(const LLSD& value) = 0;
+};
+
 /** 
  * @class LLSDParser
  * @brief Abstract base class for LLSD parsers.
@@ -80,6 +107,22 @@ public:
 	 */
 	S32 parse(std::istream& istr, LLSD& data, S32 max_bytes, S32 max_depth = -1);
 
+	/** 
+	 * @brief Call this method to parse a stream into a listener.
+	 *
+	 * Like the parse() above, but each value is passed to the listener
+	 * as soon as it is read and then dropped. On failure the listener
+	 * has already seen the values before the error, and the maps and
+	 * arrays they were in are not ended.
+	 * @param istr The input stream.
+	 * @param listener The listener to receive the data.
+	 * @param max_bytes As in parse().
+	 * @param max_depth As in parse().
+	 * @return Returns the number of LLSD objects parsed, or
+	 * PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 parse(std::istream& istr, LLSDParserListener& listener, S32 max_bytes, S32 max_depth = -1);
+
 	/** Like parse(), but uses a different call (istream.getline()) to read by lines
 	 *  This API is better suited for XML, where the parse cannot tell
 	 *  where the document actually ends.
@@ -91,6 +134,14 @@ public:
 	 */
 	void reset()	{ doReset();	};
 
+	/** 
+	 * @brief Sets whether each parsed document is allocated from its own
+	 * LLSDArena. Off by default: any value kept from the document keeps
+	 * the whole arena alive, so only large documents that are consumed
+	 * and dropped should use one.
+	 */
+	void setUseArena(bool use_arena)	{ mUseArena = use_arena; }
+
 
 protected:
 	/** 
@@ -197,6 +248,15 @@ protected:
 	 */
 	void account(S32 bytes) const;
 
+	/**
+	 * @brief Passes a value just parsed on to mListener.
+	 *
+	 * Maps and arrays are ended, their contents have already been
+	 * passed on.
+	 * @param data The value.
+	 */
+	void notifyListener(const LLSD& data) const;
+
 protected:
 	/**
 	 * @brief boolean to set if byte counts should be checked during parsing.
@@ -212,6 +272,17 @@ protected:
 	 * @brief Use line-based reading to get text
 	 */
 	bool mParseLines;
+
+	/**
+	 * @brief Parse each document into an LLSDArena
+	 */
+	bool mUseArena;
+
+	/**
+	 * @brief Receives the values instead of the tree during parse() with
+	 * a listener, NULL otherwise.
+	 */
+	LLSDParserListener* mListener;
 };
 
 /** 
@@ -410,6 +481,108 @@ private:
 };
 
 
+/** 
+ * @class LLSDBinaryChunkParser
+ * @brief Parser for the binary format which reads memory in place, in
+ * chunks fed as they arrive.
+ *
+ * LLSDBinaryParser pulls each byte through an istream, so data held in
+ * memory, such as the blocks of an LLCore::BufferArray, has to be wrapped
+ * in a stream first. This parser walks the chunks directly. Only the few
+ * bytes of a size or scalar split between two chunks are copied aside,
+ * and strings and binaries are built once and moved into the result.
+ *
+ * Parsing stops at the end of the first complete value, so the bytes
+ * after it are left for the caller.
+ */
+class LL_COMMON_API LLSDBinaryChunkParser
+{
+public:
+	enum EStatus
+	{
+		STATUS_MORE,	// Everything fed so far was used, the value is not complete
+		STATUS_DONE,	// getResult() is complete
+		STATUS_FAILED	// Malformed data or a limit exceeded
+	};
+
+	/** 
+	 * @param max_bytes A string or binary longer than this many bytes
+	 * fails the parse, LLSDSerialize::SIZE_UNLIMITED for no limit.
+	 * @param max_depth Max depth of nested maps and arrays, -1 for no limit.
+	 */
+	LLSDBinaryChunkParser(S32 max_bytes = -1, S32 max_depth = -1);
+
+	/** 
+	 * @brief Parses the next chunk.
+	 *
+	 * @param data Bytes following the previous chunk.
+	 * @param len Size of data.
+	 * @return Returns the status after this chunk, see getConsumed() for
+	 * how much of it was used.
+	 */
+	EStatus feed(const char* data, size_t len);
+
+	EStatus getStatus() const			{ return mStatus; }
+	size_t getConsumed() const			{ return mConsumed; }	///< Total bytes used by the value
+	S32 getObjectCount() const			{ return mObjects; }	///< As returned by LLSDParser::parse()
+	LLSD& getResult()					{ return mResult; }
+
+	/** 
+	 * @brief Starts over for another value.
+	 */
+	void reset();
+
+private:
+	enum EState
+	{
+		READ_TYPE,		// The type of a value
+		READ_KEY,		// 'k' or a quote starting a map key
+		READ_CLOSE,		// ']' or '}' ending a container
+		READ_FIXED,		// A size or scalar, into mScratch
+		READ_BYTES,		// The contents of a string, binary or key
+		READ_DELIMITED	// A quoted string in the notation format
+	};
+
+	struct Frame
+	{
+		LLSD* mContainer;
+		S32 mRemaining;
+		bool mMap;
+	};
+
+	bool readType(char c);
+	bool readKey(char c);
+	bool readFixed(const char* data);
+	bool beginValue();
+	void endValue();
+	bool beginBytes(const char* size_nbo);
+	bool endBytes();
+	bool endDelimited();
+	void fail();
+
+	LLSD mResult;
+	std::deque<LLSD> mDiscards;	// Values of repeated keys, the first one wins
+	LLSD* mSlot;				// Where the value being read goes
+	std::vector<Frame> mStack;
+	std::string mKey;
+	std::string mText;
+	LLSD::Binary mBinary;
+
+	EStatus mStatus;
+	EState mState;
+	char mType;					// Type of the value being read
+	bool mInKey;				// Bytes being read are a map key
+	bool mEscaped;				// Last delimited string byte was a backslash
+	char mScratch[UUID_BYTES];
+	size_t mScratchUsed;
+	size_t mNeeded;				// Bytes still to read for READ_FIXED or READ_BYTES
+	size_t mConsumed;
+	S32 mObjects;
+	S32 mMaxBytes;
+	S32 mMaxDepth;
+};
+
+
 /** 
  * @class LLSDFormatter
  * @brief Abstract base class for formatting LLSD.
@@ -643,6 +816,44 @@ protected:
 };
 
 
+/** 
+ * @class LLSDBinaryChunkFormatter
+ * @brief Writes the binary format through a callback instead of an
+ * ostream.
+ *
+ * Output is gathered in a small buffer and handed on in chunks. Strings
+ * and binaries too big for the buffer go to the callback straight from
+ * their LLSD, so appending to an LLCore::BufferArray copies each byte
+ * only once. The output is the same as LLSDBinaryFormatter's.
+ */
+class LL_COMMON_API LLSDBinaryChunkFormatter
+{
+public:
+	typedef std::function<void (const char* data, size_t len)> writer_t;
+
+	LLSDBinaryChunkFormatter(const writer_t& writer, size_t buffer_size = 4096);
+	~LLSDBinaryChunkFormatter();					///< Flushes
+
+	/** 
+	 * @brief Formats data, some of it may stay buffered until flush().
+	 *
+	 * @return Returns The number of LLSD objects fomatted out
+	 */
+	S32 format(const LLSD& data);
+	void flush();
+
+private:
+	void put(char c);
+	void write(const void* data, size_t len);
+	void writeSize(size_t size);
+	void writeString(const std::string& string);
+
+	writer_t mWriter;
+	std::vector<char> mBuffer;
+	size_t mUsed;
+};
+
+
 /** 
  * @class LLSDNotationStreamFormatter
  * @brief Formatter which is specialized for use on streams which
@@ -841,6 +1052,8 @@ public:
     // return OK or reason for failure
 	static EZipRresult unzip_llsd(LLSD& data, std::istream& is, S32 size);
 	static EZipRresult unzip_llsd(LLSD& data, U8* in, S32 size);
+	// Inflates a zlib block as is, for callers that parse it themselves.
+	static EZipRresult unzip(std::vector<U8>& result, const U8* in, S32 size);
 };
 
 //dirty little zip functions -- yell at davep
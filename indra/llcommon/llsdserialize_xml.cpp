@@ -250,6 +250,8 @@ public:
 	
 	void reset();
 
+	void setListener(LLSDParserListener* listener)	{ mListener = listener; }
+
 private:
 	void startElementHandler(const XML_Char* name, const XML_Char** attributes);
 	void endElementHandler(const XML_Char* name);
@@ -303,11 +305,15 @@ private:
 	
 	std::string mCurrentKey;		// Current XML <tag>
 	std::string mCurrentContent;	// String data between <tag> and </tag>
+
+	LLSDParserListener* mListener;	// Receives the values instead of mResult if set
+	std::deque<LLSD> mScratch;		// Values being read for mListener, one per mStack entry
 };
 
 
 LLSDXMLParser::Impl::Impl(bool emit_errors)
-	: mEmitErrors(emit_errors)
+	: mEmitErrors(emit_errors),
+	  mListener(nullptr)
 {
 	mParser = XML_ParserCreate(nullptr);
 	reset();
@@ -497,6 +503,7 @@ void LLSDXMLParser::Impl::reset()
 	mGracefullStop = false;
 
 	mStack.clear();
+	mScratch.clear();
 	
 	mSkipping = false;
 	
@@ -618,24 +625,50 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	
 	if (mStack.empty())
 	{
-		mStack.push_back(&mResult);
+		if (mListener)
+		{
+			mScratch.emplace_back();
+			mStack.push_back(&mScratch.back());
+		}
+		else
+		{
+			mStack.push_back(&mResult);
+		}
 	}
 	else if (mStack.back()->isMap())
 	{
 		if (mCurrentKey.empty()) { return startSkipping(); }
 		
-		LLSD& map = *mStack.back();
-		LLSD& newElement = map[mCurrentKey];
-		mStack.push_back(&newElement);		
+		if (mListener)
+		{
+			// The map itself stays empty, its values are passed on
+			mListener->key(mCurrentKey);
+			mScratch.emplace_back();
+			mStack.push_back(&mScratch.back());
+		}
+		else
+		{
+			LLSD& map = *mStack.back();
+			LLSD& newElement = map[mCurrentKey];
+			mStack.push_back(&newElement);
+		}
 
 		mCurrentKey.clear();
 	}
 	else if (mStack.back()->isArray())
 	{
-		LLSD& array = *mStack.back();
-		array.append(LLSD());
-		LLSD& newElement = array[array.size()-1];
-		mStack.push_back(&newElement);
+		if (mListener)
+		{
+			mScratch.emplace_back();
+			mStack.push_back(&mScratch.back());
+		}
+		else
+		{
+			LLSD& array = *mStack.back();
+			array.append(LLSD());
+			LLSD& newElement = array[array.size()-1];
+			mStack.push_back(&newElement);
+		}
 	}
 	else {
 		// improperly nested value in a non-structure
@@ -647,10 +680,12 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	{
 		case ELEMENT_MAP:
 			*mStack.back() = LLSD::emptyMap();
+			if (mListener) { mListener->beginMap(); }
 			break;
 		
 		case ELEMENT_ARRAY:
 			*mStack.back() = LLSD::emptyArray();
+			if (mListener) { mListener->beginArray(); }
 			break;
 			
 		default:
@@ -788,6 +823,25 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 	}
 
+	if (mListener)
+	{
+		switch (element)
+		{
+			case ELEMENT_MAP:
+				mListener->endMap();
+				break;
+
+			case ELEMENT_ARRAY:
+				mListener->endArray();
+				break;
+
+			default:
+				mListener->value(value);
+				break;
+		}
+		mScratch.pop_back();
+	}
+
 	mCurrentContent.clear();
 }
 
@@ -914,6 +968,7 @@ S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data, S32 max_depth) const
 	XML_Timer timer( &parseTime );
 	#endif	// XML_PARSER_PERFORMANCE_TESTS
 
+	impl.setListener(mListener);
 	if (mParseLines)
 	{
 		// Use line-based reading (faster code)
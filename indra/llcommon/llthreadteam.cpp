@@ -0,0 +1,125 @@
+/**
+ * @file llthreadteam.cpp
+ * @brief Threads kept waiting to share one job at a time with their caller
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llthreadteam.h"
+
+#include "llqueuedthreadpool.h"
+
+LLThreadTeam::LLThreadTeam(U32 num_threads)
+:	mJob(nullptr),
+	mParts(0),
+	mNextPart(0),
+	mGeneration(0),
+	mBusy(0),
+	mQuitting(false)
+{
+	if (!num_threads)
+	{
+		num_threads = LLQueuedThreadPool::defaultThreadCount();
+	}
+	mThreads.reserve(num_threads);
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		mThreads.emplace_back(&LLThreadTeam::threadMain, this);
+	}
+}
+
+LLThreadTeam::~LLThreadTeam()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuitting = true;
+	}
+	mStartCondition.notify_all();
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+void LLThreadTeam::run(U32 parts, const job_t& job)
+{
+	if (parts <= 1 || mThreads.empty())
+	{
+		// Not worth waking anyone
+		for (U32 part = 0; part < parts; ++part)
+		{
+			job(part);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> one_job(mRunMutex);
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &job;
+		mParts = parts;
+		mNextPart = 0;
+		mBusy = (U32)mThreads.size();
+		++mGeneration;
+	}
+	mStartCondition.notify_all();
+
+	runParts();
+
+	// Every thread has to be done with the job, not just every part, before
+	// the job and the counts can change
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCondition.wait(lock, [this] { return !mBusy; });
+	mJob = nullptr;
+}
+
+void LLThreadTeam::threadMain()
+{
+	U32 generation = 0;
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		mStartCondition.wait(lock, [this, generation] { return mQuitting || mGeneration != generation; });
+		if (mQuitting)
+		{
+			return;
+		}
+		generation = mGeneration;
+
+		lock.unlock();
+		runParts();
+		lock.lock();
+
+		if (!--mBusy)
+		{
+			mDoneCondition.notify_one();
+		}
+	}
+}
+
+void LLThreadTeam::runParts()
+{
+	for (U32 part = mNextPart++; part < mParts; part = mNextPart++)
+	{
+		(*mJob)(part);
+	}
+}
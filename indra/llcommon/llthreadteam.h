@@ -0,0 +1,86 @@
+/**
+ * @file llthreadteam.h
+ * @brief Threads kept waiting to share one job at a time with their caller
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADTEAM_H
+#define LL_LLTHREADTEAM_H
+
+#include "llpreprocessor.h"
+#include "stdtypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//============================================================================
+// Splits a job into numbered parts and runs them on the calling thread and
+// a set of threads started once, which sleep between jobs. Meant for work
+// done every frame, such as skinning or posing every avatar, where starting
+// threads each time would cost more than the threads save.
+//
+// Unlike LLQueuedThreadPool there is no queue: run() returns only once the
+// whole job is done, and one job runs at a time.
+
+class LL_COMMON_API LLThreadTeam
+{
+public:
+	typedef std::function<void(U32 part)> job_t;
+
+	// 0 means one thread per core, less one for the calling thread
+	explicit LLThreadTeam(U32 num_threads = 0);
+	~LLThreadTeam();
+
+	LLThreadTeam(const LLThreadTeam&) = delete;
+	LLThreadTeam& operator=(const LLThreadTeam&) = delete;
+
+	// Calls job once for each part from 0 to parts - 1. The caller and the
+	// team each take the next part not yet taken until none are left, so
+	// parts of uneven cost still spread well. Returns once all are done.
+	void run(U32 parts, const job_t& job);
+
+	U32 getThreadCount() const { return (U32)mThreads.size(); }
+
+private:
+	void threadMain();
+	void runParts();
+
+	std::vector<std::thread> mThreads;
+
+	std::mutex mRunMutex;		// one job at a time
+	std::mutex mMutex;			// guards the job and the counts below
+	std::condition_variable mStartCondition;
+	std::condition_variable mDoneCondition;
+
+	const job_t* mJob;
+	U32 mParts;
+	std::atomic<U32> mNextPart;
+	U32 mGeneration;			// bumped for each job, wakes the team
+	U32 mBusy;					// team threads not yet done with the job
+	bool mQuitting;
+};
+
+#endif // LL_LLTHREADTEAM_H
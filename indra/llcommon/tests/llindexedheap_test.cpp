@@ -0,0 +1,241 @@
+/**
+ * @file llindexedheap_test.cpp
+ * @brief Tests for LLIndexedHeap, checked against LLPriQueueMap.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llindexedheap.h"
+#include "../llpriqueuemap.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	struct Item
+	{
+		Item() : mHeapIndex(-1), mPriority(0.f) {}
+
+		S32 mHeapIndex;
+		F32 mPriority;		// only kept for LLPriQueueMap
+	};
+
+	S32 get_index(Item* const& item)			{ return item->mHeapIndex; }
+	void set_index(Item*& item, S32 index)		{ item->mHeapIndex = index; }
+
+	F32 get_priority(Item*& item)				{ return item->mPriority; }
+	void set_priority(Item*& item, const F32 priority)	{ item->mPriority = priority; }
+
+	typedef LLIndexedHeap<Item*> heap_t;
+
+	U32 sSeed = 1;
+	F32 frand()
+	{
+		sSeed = sSeed * 1103515245 + 12345;
+		return (F32)((sSeed >> 8) & 0xffff) / 65535.f;
+	}
+
+	// Pops everything, checking each priority is no higher than the last
+	bool pops_in_order(heap_t& heap, S32& count)
+	{
+		count = 0;
+		F32 last = F32_MAX;
+		while (!heap.empty())
+		{
+			const F32 top = heap.getTopPriority();
+			Item* item = NULL;
+			heap.pop(&item);
+			if (top > last || item->mHeapIndex != -1)
+			{
+				return false;
+			}
+			last = top;
+			++count;
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct indexedheap
+	{
+	};
+	typedef test_group<indexedheap> indexedheap_t;
+	typedef indexedheap_t::object indexedheap_object_t;
+	tut::indexedheap_t tut_indexedheap("LLIndexedHeap");
+
+	template<> template<>
+	void indexedheap_object_t::test<1>()
+	{
+		set_test_name("pops highest first");
+
+		std::vector<Item> items(1000);
+		heap_t heap(get_index, set_index);
+		sSeed = 3;
+		for (Item& item : items)
+		{
+			heap.push(frand() * 100.f, &item);
+		}
+		ensure_equals("length", heap.getLength(), 1000);
+		ensure("all in", items[0].mHeapIndex >= 0 && items[999].mHeapIndex >= 0);
+
+		S32 count = 0;
+		ensure("in order", pops_in_order(heap, count));
+		ensure_equals("all out", count, 1000);
+		Item* item = NULL;
+		ensure("empty", !heap.pop(&item));
+	}
+
+	template<> template<>
+	void indexedheap_object_t::test<2>()
+	{
+		set_test_name("reprioritized in place");
+
+		std::vector<Item> items(10);
+		heap_t heap(get_index, set_index);
+		for (S32 i = 0; i < 10; ++i)
+		{
+			heap.push((F32)i, &items[i]);
+		}
+
+		// Pushing again moves, lower as well as higher
+		heap.push(20.f, &items[2]);
+		heap.push(-1.f, &items[9]);
+		ensure_equals("once each", heap.getLength(), 10);
+		ensure_equals("raised", heap.getPriority(&items[2]), 20.f);
+		ensure_equals("lowered", heap.getPriority(&items[9]), -1.f);
+
+		// raise() only ever raises
+		heap.raise(5.f, &items[2]);
+		heap.raise(30.f, &items[7]);
+		ensure_equals("kept higher", heap.getPriority(&items[2]), 20.f);
+		ensure_equals("took higher", heap.getPriority(&items[7]), 30.f);
+
+		Item* item = NULL;
+		heap.pop(&item);
+		ensure("top", item == &items[7]);
+		heap.pop(&item);
+		ensure("next", item == &items[2]);
+
+		heap.raise(1.f, &items[2]);
+		ensure("raise adds", heap.contains(&items[2]));
+
+		S32 count = 0;
+		ensure("in order", pops_in_order(heap, count));
+		ensure_equals("rest", count, 9);
+	}
+
+	template<> template<>
+	void indexedheap_object_t::test<3>()
+	{
+		set_test_name("removed from anywhere");
+
+		std::vector<Item> items(500);
+		heap_t heap(get_index, set_index);
+		sSeed = 7;
+		for (Item& item : items)
+		{
+			heap.push(frand(), &item);
+		}
+		for (S32 i = 0; i < 500; i += 3)
+		{
+			heap.remove(&items[i]);
+			ensure("out", !heap.contains(&items[i]));
+		}
+		heap.remove(&items[0]);	// not in, no harm
+
+		S32 count = 0;
+		ensure("in order", pops_in_order(heap, count));
+		ensure_equals("rest", count, 500 - 167);
+
+		for (Item& item : items)
+		{
+			heap.push(frand(), &item);
+		}
+		heap.clear();
+		for (const Item& item : items)
+		{
+			ensure_equals("cleared", item.mHeapIndex, -1);
+		}
+	}
+
+	template<> template<>
+	void indexedheap_object_t::test<4>()
+	{
+		set_test_name("agrees with LLPriQueueMap after reprioritizing");
+
+		// The priorities of a texture list, many changing a frame
+		const S32 ITEMS = 2000;
+		const S32 FRAMES = 10;
+		const S32 CHANGES = 500;
+
+		std::vector<Item> items(ITEMS);
+		heap_t heap(get_index, set_index);
+		LLPriQueueMap<Item*> map(set_priority, get_priority);
+		sSeed = 11;
+		for (Item& item : items)
+		{
+			item.mPriority = frand();
+			heap.push(item.mPriority, &item);
+			map.push(item.mPriority, &item);
+		}
+
+		sSeed = 13;
+		for (S32 frame = 0; frame < FRAMES; ++frame)
+		{
+			for (S32 i = 0; i < CHANGES; ++i)
+			{
+				const F32 priority = frand();
+				heap.push(priority, &items[(S32)(frand() * (ITEMS - 1))]);
+			}
+		}
+
+		sSeed = 13;
+		for (S32 frame = 0; frame < FRAMES; ++frame)
+		{
+			for (S32 i = 0; i < CHANGES; ++i)
+			{
+				const F32 priority = frand();
+				map.reprioritize(priority, &items[(S32)(frand() * (ITEMS - 1))]);
+			}
+		}
+
+		// Both saw the same changes, so agree on the order
+		F32 last = F32_MAX;
+		while (!heap.empty())
+		{
+			Item* from_heap = NULL;
+			Item* from_map = NULL;
+			const F32 top = heap.getTopPriority();
+			heap.pop(&from_heap);
+			map.pop(&from_map);
+			ensure("ordered", top <= last);
+			ensure_equals("same priority", from_map->mPriority, top);
+			last = top;
+		}
+		ensure_equals("map emptied too", map.getLength(), 0);
+	}
+}
@@ -0,0 +1,252 @@
+/**
+ * @file llqueuedthreadpool_test.cpp
+ * @brief Tests for pooled LLQueuedThreads.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llqueuedthreadpool.h"
+#include "../lltimer.h"
+
+#include "../test/lltut.h"
+
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Results
+	{
+		Results() : mCompleted(0), mAborted(0), mGate(false) {}
+
+		void record(S32 id)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mOrder.push_back(id);
+		}
+
+		std::atomic<S32> mCompleted;
+		std::atomic<S32> mAborted;
+		std::atomic<bool> mGate;
+		std::mutex mMutex;
+		std::vector<S32> mOrder;
+	};
+
+	class TestQueue : public LLQueuedThread
+	{
+	public:
+		TestQueue(const std::string& name, LLQueuedThreadPool* pool = nullptr)
+		:	LLQueuedThread(name, true, false, pool)
+		{
+		}
+
+		using LLQueuedThread::generateHandle;
+		using LLQueuedThread::addRequest;
+	};
+
+	// Burns CPU for a number of passes, going back in the queue after each
+	class TestRequest : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		TestRequest(LLQueuedThread::handle_t handle, U32 priority, U32 flags, Results& results,
+					S32 id, S32 passes, U32 work, bool gate = false)
+		:	QueuedRequest(handle, priority, flags),
+			mResults(results),
+			mID(id),
+			mPasses(passes),
+			mWork(work),
+			mGate(gate),
+			mSum(0.0)
+		{
+		}
+
+		bool processRequest() override
+		{
+			if (mGate)
+			{
+				while (!mResults.mGate)
+				{
+					ms_sleep(1);
+				}
+			}
+			for (U32 i = 0; i < mWork; ++i)
+			{
+				mSum += std::sqrt((F64)(i + mPasses));
+			}
+			return --mPasses <= 0;
+		}
+
+		void finishRequest(bool completed) override
+		{
+			if (completed)
+			{
+				mResults.record(mID);
+				++mResults.mCompleted;
+			}
+			else
+			{
+				++mResults.mAborted;
+			}
+		}
+
+	private:
+		Results& mResults;
+		S32 mID;
+		S32 mPasses;
+		U32 mWork;
+		bool mGate;
+		volatile F64 mSum;
+	};
+
+	LLQueuedThread::handle_t add(TestQueue& queue, Results& results, S32 id, U32 priority,
+								 S32 passes = 1, U32 work = 0, U32 flags = LLQueuedThread::FLAG_AUTO_COMPLETE,
+								 bool gate = false)
+	{
+		LLQueuedThread::handle_t handle = queue.generateHandle();
+		queue.addRequest(new TestRequest(handle, priority, flags, results, id, passes, work, gate));
+		return handle;
+	}
+
+	bool waitFor(const std::atomic<S32>& counter, S32 count)
+	{
+		LLTimer timer;
+		while (counter < count)
+		{
+			if (timer.getElapsedTimeF64().value() > 30.0)
+			{
+				return false;
+			}
+			ms_sleep(1);
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct queuedthreadpool
+	{
+	};
+	typedef test_group<queuedthreadpool> queuedthreadpool_t;
+	typedef queuedthreadpool_t::object queuedthreadpool_object_t;
+	tut::queuedthreadpool_t tut_queuedthreadpool("LLQueuedThreadPool");
+
+	template<> template<>
+	void queuedthreadpool_object_t::test<1>()
+	{
+		set_test_name("requests from several queues all complete");
+
+		LLQueuedThreadPool pool("test", 4);
+		ensure_equals("threads", pool.getThreadCount(), 4U);
+
+		Results results;
+		TestQueue first("first", &pool);
+		TestQueue second("second", &pool);
+		ensure("pooled", first.isPooled() && second.isPooled());
+
+		std::vector<LLQueuedThread::handle_t> handles;
+		for (S32 i = 0; i < 500; ++i)
+		{
+			handles.push_back(add(first, results, i, LLQueuedThread::PRIORITY_NORMAL + i, 3, 100, 0));
+			add(second, results, 500 + i, LLQueuedThread::PRIORITY_LOW, 2, 100);
+		}
+		ensure("all finished", waitFor(results.mCompleted, 1000));
+
+		// Without auto complete the requests wait to be collected
+		for (LLQueuedThread::handle_t handle : handles)
+		{
+			ensure_equals("status", first.getRequestStatus(handle), LLQueuedThread::STATUS_COMPLETE);
+			ensure("complete", first.completeRequest(handle));
+		}
+		ensure_equals("aborted", results.mAborted.load(), 0);
+		ensure_equals("pool drained", pool.getPending(), 0);
+		ensure_equals("queue drained", first.getPending(), 0);
+	}
+
+	template<> template<>
+	void queuedthreadpool_object_t::test<2>()
+	{
+		set_test_name("abort and shutdown with queued requests");
+
+		LLQueuedThreadPool pool("test", 1);
+		Results results;
+		{
+			TestQueue queue("queue", &pool);
+			add(queue, results, -1, LLQueuedThread::PRIORITY_URGENT, 1, 0, LLQueuedThread::FLAG_AUTO_COMPLETE, true);
+
+			std::vector<LLQueuedThread::handle_t> handles;
+			for (S32 i = 0; i < 10; ++i)
+			{
+				handles.push_back(add(queue, results, i, LLQueuedThread::PRIORITY_NORMAL));
+			}
+			for (S32 i = 0; i < 10; i += 2)
+			{
+				queue.abortRequest(handles[i], true);
+			}
+			results.mGate = true;
+			ensure("survivors finished", waitFor(results.mCompleted, 6));
+			ensure("aborts finished", waitFor(results.mAborted, 5));
+
+			// Left in the pool when the queue goes away
+			results.mGate = false;
+			add(queue, results, -1, LLQueuedThread::PRIORITY_URGENT, 1, 0, LLQueuedThread::FLAG_AUTO_COMPLETE, true);
+			for (S32 i = 0; i < 10; ++i)
+			{
+				add(queue, results, 100 + i, LLQueuedThread::PRIORITY_NORMAL);
+			}
+			ms_sleep(10);
+			results.mGate = true;
+		}
+		ensure_equals("pool drained", pool.getPending(), 0);
+		ensure("dropped requests never finish", results.mCompleted <= 17);
+	}
+
+	template<> template<>
+	void queuedthreadpool_object_t::test<3>()
+	{
+		set_test_name("higher priority buckets run first");
+
+		LLQueuedThreadPool pool("test", 1);
+		TestQueue queue("queue", &pool);
+		Results results;
+
+		// Hold the only thread so everything below is queued before it runs
+		add(queue, results, 0, LLQueuedThread::PRIORITY_IMMEDIATE, 1, 0, LLQueuedThread::FLAG_AUTO_COMPLETE, true);
+		add(queue, results, 1, LLQueuedThread::PRIORITY_LOW);
+		add(queue, results, 2, LLQueuedThread::PRIORITY_NORMAL);
+		add(queue, results, 3, LLQueuedThread::PRIORITY_LOW);
+		add(queue, results, 4, LLQueuedThread::PRIORITY_HIGH);
+		add(queue, results, 5, LLQueuedThread::PRIORITY_URGENT);
+		results.mGate = true;
+		ensure("all finished", waitFor(results.mCompleted, 6));
+
+		const S32 expected[] = { 0, 5, 4, 2, 1, 3 };
+		std::lock_guard<std::mutex> lock(results.mMutex);
+		for (U32 i = 0; i < 6; ++i)
+		{
+			ensure_equals("order", results.mOrder[i], expected[i]);
+		}
+	}
+}
@@ -55,6 +55,7 @@ using namespace boost::phoenix;
 #include "../llsdserialize.h"
 #include "llsdutil.h"
 #include "../llformat.h"
+#include "../lltimer.h"
 
 #include "../test/lltut.h"
 #include "../test/namedtempfile.h"
@@ -1684,6 +1685,339 @@ namespace tut
 		ensureBinaryAndXML("map", test);
 	}
 
+	struct TestLLSDBinaryChunks
+	{
+		// Inventory fetch reply: folders of items, mostly uuids and short strings
+		LLSD makeInventory(S32 folders, S32 items)
+		{
+			LLSD reply;
+			LLSD& list = reply["folders"];
+			for (S32 f = 0; f < folders; ++f)
+			{
+				LLSD folder;
+				folder["folder_id"] = LLUUID::generateNewID();
+				folder["owner_id"] = LLUUID::generateNewID();
+				folder["version"] = f;
+				folder["descendents"] = items;
+				for (S32 i = 0; i < items; ++i)
+				{
+					LLSD item;
+					item["item_id"] = LLUUID::generateNewID();
+					item["parent_id"] = folder["folder_id"];
+					item["asset_id"] = LLUUID::generateNewID();
+					item["name"] = llformat("Item %d in folder %d", i, f);
+					item["desc"] = "2020-01-01 00:00:00 object";
+					item["type"] = 6;
+					item["inv_type"] = 6;
+					item["flags"] = i;
+					item["created_at"] = 1577836800 + i;
+					LLSD& perms = item["permissions"];
+					perms["creator_id"] = LLUUID::generateNewID();
+					perms["owner_mask"] = 0x7fffffff;
+					perms["next_owner_mask"] = 0x82000;
+					LLSD& sale = item["sale_info"];
+					sale["sale_price"] = 10;
+					sale["sale_type"] = "not";
+					folder["items"].append(item);
+				}
+				list.append(folder);
+			}
+			return reply;
+		}
+
+		// Mesh header followed by the LOD blocks it describes
+		std::string makeMeshAsset(S32 lods, S32 block_size)
+		{
+			static const char* const NAMES[] = { "lowest_lod", "low_lod", "medium_lod", "high_lod", "physics_convex" };
+			LLSD header;
+			header["version"] = 1;
+			header["creator"] = LLUUID::generateNewID();
+			header["date"] = LLDate(1577836800.0);
+			S32 offset = 0;
+			for (S32 i = 0; i < lods; ++i)
+			{
+				LLSD& lod = header[NAMES[i % 5] + llformat("%d", i / 5)];
+				lod["offset"] = offset;
+				lod["size"] = block_size;
+				offset += block_size;
+			}
+			std::ostringstream ostr;
+			LLSDSerialize::toBinary(header, ostr);
+			return ostr.str() + std::string(offset, '\x5a');
+		}
+
+		S32 parseInChunks(const std::string& data, size_t chunk, LLSD& result, size_t* consumed = NULL)
+		{
+			LLSDBinaryChunkParser parser;
+			for (size_t pos = 0; pos < data.size(); pos += chunk)
+			{
+				if (parser.feed(data.data() + pos, llmin(chunk, data.size() - pos)) != LLSDBinaryChunkParser::STATUS_MORE)
+				{
+					break;
+				}
+			}
+			if (parser.getStatus() != LLSDBinaryChunkParser::STATUS_DONE)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			result = parser.getResult();
+			if (consumed)
+			{
+				*consumed = parser.getConsumed();
+			}
+			return parser.getObjectCount();
+		}
+
+		std::string formatInChunks(const LLSD& value, size_t buffer_size)
+		{
+			std::string out;
+			LLSDBinaryChunkFormatter formatter([&out](const char* data, size_t len) { out.append(data, len); },
+											   buffer_size);
+			formatter.format(value);
+			formatter.flush();
+			return out;
+		}
+
+		void benchmark(const std::string& what, const std::string& data, S32 passes)
+		{
+			LLTimer timer;
+			for (S32 i = 0; i < passes; ++i)
+			{
+				std::istringstream istr(data);
+				LLSD result;
+				LLSDSerialize::fromBinary(result, istr, LLSDSerialize::SIZE_UNLIMITED);
+			}
+			F64 stream_time = timer.getElapsedTimeF64().value();
+
+			timer.reset();
+			for (S32 i = 0; i < passes; ++i)
+			{
+				LLSDArena arena;
+				LLSD result;
+				parseInChunks(data, 65536, result);
+			}
+			F64 chunk_time = timer.getElapsedTimeF64().value();
+
+			LL_INFOS() << what << " " << data.size() << " bytes: istream "
+					   << stream_time * 1.0e3 / passes << " ms, 64KB chunks "
+					   << chunk_time * 1.0e3 / passes << " ms (" << stream_time / chunk_time << "x)" << LL_ENDL;
+		}
+	};
+
+	typedef tut::test_group<TestLLSDBinaryChunks> TestLLSDBinaryChunksGroup;
+	typedef TestLLSDBinaryChunksGroup::object TestLLSDBinaryChunksObject;
+	TestLLSDBinaryChunksGroup gTestLLSDBinaryChunksGroup("LLSDBinaryChunkParser");
+
+	template<> template<>
+	void TestLLSDBinaryChunksObject::test<1>()
+	{
+		set_test_name("same values and output as the stream classes at any chunk size");
+
+		LLSD value = makeInventory(3, 4);
+		value["binary"] = LLSD::Binary(100000, 0xa5);
+		value["real"] = 3.25;
+		value["uri"] = LLURI("http://example.com/");
+		value["empty"] = LLSD::emptyMap();
+		value["nothing"] = LLSD();
+		value["true"] = true;
+
+		std::ostringstream ostr;
+		S32 count = LLSDSerialize::toBinary(value, ostr);
+		const std::string expected = ostr.str();
+
+		const size_t chunks[] = { 1, 2, 3, 7, 16, 4096, 1 << 20 };
+		for (size_t chunk : chunks)
+		{
+			std::string msg = llformat("chunk %d", (S32)chunk);
+			ensure_equals(msg + " format", formatInChunks(value, chunk), expected);
+
+			LLSD result;
+			size_t consumed = 0;
+			ensure_equals(msg + " count", parseInChunks(expected + "trailing", chunk, result, &consumed), count);
+			ensure_equals(msg + " consumed", consumed, expected.size());
+			ensure_equals(msg + " value", result, value);
+		}
+	}
+
+	template<> template<>
+	void TestLLSDBinaryChunksObject::test<2>()
+	{
+		set_test_name("truncated, malformed and over the limits");
+
+		LLSD value = makeInventory(2, 2);
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(value, ostr);
+		const std::string data = ostr.str();
+
+		for (size_t len = 0; len < data.size(); len += 13)
+		{
+			LLSDBinaryChunkParser parser;
+			ensure("truncated", parser.feed(data.data(), len) != LLSDBinaryChunkParser::STATUS_DONE);
+		}
+
+		LLSDBinaryChunkParser parser;
+		ensure_equals("bad type", parser.feed("{\0\0\0\1x", 6), LLSDBinaryChunkParser::STATUS_FAILED);
+		parser.reset();
+		ensure_equals("after reset", parser.feed("i\0\0\0\x2a", 5), LLSDBinaryChunkParser::STATUS_DONE);
+		ensure_equals("integer", parser.getResult().asInteger(), 42);
+
+		LLSDBinaryChunkParser shallow(-1, 2);
+		ensure_equals("max depth", shallow.feed(data.data(), data.size()), LLSDBinaryChunkParser::STATUS_FAILED);
+
+		LLSDBinaryChunkParser small(16);
+		ensure_equals("max bytes", small.feed(data.data(), data.size()), LLSDBinaryChunkParser::STATUS_FAILED);
+
+		// Notation style quoted strings, as the stream parser also accepts
+		LLSDBinaryChunkParser quoted;
+		const char map[] = "{\0\0\0\1'a\\'b'\"c\\\"d\"}";
+		ensure_equals("quoted", quoted.feed(map, sizeof(map) - 1), LLSDBinaryChunkParser::STATUS_DONE);
+		ensure_equals("quoted value", quoted.getResult()["a'b"].asString(), std::string("c\"d"));
+	}
+
+	template<> template<>
+	void TestLLSDBinaryChunksObject::test<3>()
+	{
+		set_test_name("parse time against the istream path");
+
+		const std::string mesh = makeMeshAsset(20, 1 << 16);
+		LLSD header;
+		size_t consumed = 0;
+		ensure("mesh header", parseInChunks(mesh, 65536, header, &consumed) > 0);
+		ensure_equals("last lod", header["physics_convex3"]["offset"].asInteger(), 19 << 16);
+		ensure("stops before the lods", consumed + (20 << 16) == mesh.size());
+
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time binary LLSD parsing");
+		}
+
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(makeInventory(50, 200), ostr);
+		benchmark("Inventory", ostr.str(), 5);
+		benchmark("Mesh asset header", mesh.substr(0, consumed), 5000);
+	}
+
+	// Builds the tree back up from the events, as a consumer would build
+	// its own structures
+	class TestLLSDTreeListener : public LLSDParserListener
+	{
+	public:
+		void beginMap() override			{ begin(LLSD::emptyMap()); }
+		void endMap() override				{ mStack.pop_back(); }
+		void beginArray() override			{ begin(LLSD::emptyArray()); }
+		void endArray() override			{ mStack.pop_back(); }
+		void key(const std::string& key) override	{ mKey = key; }
+		void value(const LLSD& value) override		{ slot() = value; ++mValues; }
+
+		LLSD mResult;
+		S32 mValues = 0;
+		std::vector<LLSD*> mStack;
+
+	private:
+		LLSD& slot()
+		{
+			if (mStack.empty())
+			{
+				return mResult;
+			}
+			LLSD& container = *mStack.back();
+			return container.isMap() ? container[mKey] : container[container.size()];
+		}
+
+		void begin(const LLSD& container)
+		{
+			LLSD& value = slot();
+			value = container;
+			mStack.push_back(&value);
+		}
+
+		std::string mKey;
+	};
+
+	struct TestLLSDParserListener
+	{
+		void ensureEvents(const std::string& what, LLPointer<LLSDParser> parser, const std::string& text, const LLSD& expected)
+		{
+			std::istringstream tree_stream(text);
+			LLSD tree;
+			S32 tree_count = parser->parse(tree_stream, tree, LLSDSerialize::SIZE_UNLIMITED);
+
+			parser->reset();
+			std::istringstream event_stream(text);
+			TestLLSDTreeListener listener;
+			S32 event_count = parser->parse(event_stream, listener, LLSDSerialize::SIZE_UNLIMITED);
+
+			ensure_equals(what + " count", event_count, tree_count);
+			ensure(what + " balanced", listener.mStack.empty());
+			ensure_equals(what + " value", listener.mResult, expected);
+			ensure_equals(what + " tree", tree, expected);
+		}
+	};
+
+	typedef tut::test_group<TestLLSDParserListener> TestLLSDParserListenerGroup;
+	typedef TestLLSDParserListenerGroup::object TestLLSDParserListenerObject;
+	TestLLSDParserListenerGroup gTestLLSDParserListenerGroup("LLSDParserListener");
+
+	template<> template<>
+	void TestLLSDParserListenerObject::test<1>()
+	{
+		set_test_name("events rebuild the same value in every format");
+
+		LLSD value;
+		value["folder_id"] = LLUUID::generateNewID();
+		value["name"] = "My Inventory";
+		value["version"] = 42;
+		value["date"] = LLDate(1577836800.0);
+		value["uri"] = LLURI("http://example.com/");
+		value["binary"] = LLSD::Binary(20, 0x5a);
+		value["empty_map"] = LLSD::emptyMap();
+		value["empty_array"] = LLSD::emptyArray();
+		for (S32 i = 0; i < 10; ++i)
+		{
+			LLSD item;
+			item["item_id"] = LLUUID::generateNewID();
+			item["flags"] = i;
+			item["price"] = 1.5 * i;
+			item["for_sale"] = (i % 2) != 0;
+			item["nothing"] = LLSD();
+			item["parents"].append(value["folder_id"]);
+			item["parents"].append(LLSD::emptyArray());
+			value["items"].append(item);
+		}
+
+		std::ostringstream xml;
+		LLSDSerialize::toXML(value, xml);
+		ensureEvents("xml", new LLSDXMLParser, xml.str(), value);
+
+		std::ostringstream notation;
+		LLSDSerialize::toNotation(value, notation);
+		ensureEvents("notation", new LLSDNotationParser, notation.str(), value);
+
+		std::ostringstream binary;
+		LLSDSerialize::toBinary(value, binary);
+		ensureEvents("binary", new LLSDBinaryParser, binary.str(), value);
+
+		ensureEvents("scalar", new LLSDNotationParser, "i42", LLSD(42));
+	}
+
+	template<> template<>
+	void TestLLSDParserListenerObject::test<2>()
+	{
+		set_test_name("values before a failure are passed on");
+
+		LLPointer<LLSDParser> parser = new LLSDNotationParser;
+		std::istringstream istr("[i1, i2, {'a':i3, 'b':x}]");
+		TestLLSDTreeListener listener;
+		ensure_equals("failed", parser->parse(istr, listener, LLSDSerialize::SIZE_UNLIMITED), (S32)LLSDParser::PARSE_FAILURE);
+		ensure_equals("values", listener.mValues, 3);
+		ensure_equals("unbalanced", listener.mStack.size(), (size_t)2);
+
+		std::istringstream deep("[[[i1]]]");
+		TestLLSDTreeListener shallow;
+		ensure_equals("max depth", parser->parse(deep, shallow, LLSDSerialize::SIZE_UNLIMITED, 2), (S32)LLSDParser::PARSE_FAILURE);
+		ensure_equals("nothing past max depth", shallow.mValues, 0);
+	}
+
     struct TestPythonCompatible
     {
         TestPythonCompatible():
@@ -0,0 +1,110 @@
+/**
+ * @file llthreadteam_test.cpp
+ * @brief Tests for LLThreadTeam
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llthreadteam.h"
+
+#include "../test/lltut.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace tut
+{
+	struct threadteam_data
+	{
+	};
+	typedef test_group<threadteam_data> threadteam_test;
+	typedef threadteam_test::object threadteam_object;
+	tut::threadteam_test threadteam_testcase("LLThreadTeam");
+
+	template<> template<>
+	void threadteam_object::test<1>()
+	{
+		set_test_name("every part once, job after job");
+		LLThreadTeam team(3);
+		ensure_equals("threads", team.getThreadCount(), 3U);
+
+		for (U32 parts : { 0U, 1U, 2U, 3U, 4U, 100U, 1000U })
+		{
+			std::vector<std::atomic<U32> > counts(parts);
+			for (std::atomic<U32>& count : counts)
+			{
+				count = 0;
+			}
+			team.run(parts, [&counts](U32 part) { ++counts[part]; });
+			for (U32 i = 0; i < parts; ++i)
+			{
+				ensure_equals("ran once", counts[i].load(), 1U);
+			}
+		}
+	}
+
+	template<> template<>
+	void threadteam_object::test<2>()
+	{
+		set_test_name("parts shared between threads");
+		LLThreadTeam team(3);
+
+		// Each part waits until every thread holds one, which only ends if
+		// the team and the caller all take part
+		std::atomic<U32> waiting(0);
+		std::mutex mutex;
+		std::set<std::thread::id> threads;
+		team.run(4, [&](U32)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.insert(std::this_thread::get_id());
+			}
+			++waiting;
+			while (waiting < 4)
+			{
+				std::this_thread::yield();
+			}
+		});
+		ensure_equals("four threads", threads.size(), 4U);
+		ensure("caller took part", threads.count(std::this_thread::get_id()) == 1);
+	}
+
+	template<> template<>
+	void threadteam_object::test<3>()
+	{
+		set_test_name("torn down while starting");
+		// The threads may not be waiting yet when the team goes
+		for (U32 i = 0; i < 20; ++i)
+		{
+			LLThreadTeam team(2);
+		}
+		LLThreadTeam team(2);
+		std::atomic<U32> done(0);
+		team.run(5, [&done](U32) { ++done; });
+		ensure_equals("all parts", done.load(), 5U);
+	}
+}
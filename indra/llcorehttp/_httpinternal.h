@@ -153,6 +153,10 @@ const int HTTP_CONNECTION_LIMIT_MAX = 256;
 const long HTTP_PIPELINING_DEFAULT = 0L;
 const long HTTP_PIPELINING_MAX = 20L;
 
+// HTTP/2 stream limits, zero disables HTTP/2
+const long HTTP_HTTP2_STREAMS_DEFAULT = 0L;
+const long HTTP_HTTP2_STREAMS_MAX = 256L;
+
 // Miscellaneous defaults
 const bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
@@ -163,6 +167,11 @@ const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
 // request, ready and active queues.
 const int HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS = 2;
 
+// Longest time worker thread waits on libcurl sockets when
+// only transfers are outstanding.  New requests wake it early
+// where libcurl supports it, socket activity always does.
+const int HTTP_SERVICE_LOOP_WAIT_TRANSPORT_MS = 100;
+
 // Block allocation size (a tuning parameter) is found
 // in bufferarray.h.
 
@@ -32,6 +32,8 @@
 #include "_httppolicy.h"
 
 #include "llhttpconstants.h"
+#include "httpstats.h"
+#include "lltimer.h"
 
 namespace
 {
@@ -140,7 +142,9 @@ void HttpLibcurl::start(int policy_count)
 //
 // If active list goes empty *and* we didn't queue any
 // requests for retry, we return a request for a hard
-// sleep otherwise ask for a normal polling interval.
+// sleep.  While transfers are outstanding we ask to wait
+// on their sockets, after a completion for a normal
+// polling interval.
 HttpService::ELoopSpeed HttpLibcurl::processTransport()
 {
 	HttpService::ELoopSpeed	ret(HttpService::REQUEST_SLEEP);
@@ -205,12 +209,110 @@ HttpService::ELoopSpeed HttpLibcurl::processTransport()
 
 	if (! mActiveOps.empty())
 	{
-		ret = HttpService::NORMAL;
+		ret = (std::min)(ret, HttpService::WAIT_TRANSPORT);
 	}
 	return ret;
 }
 
 
+void HttpLibcurl::waitForActivity(int timeout_ms)
+{
+	if (! mPolicyCount)
+	{
+		ms_sleep(timeout_ms);
+		return;
+	}
+
+#if LIBCURL_VERSION_NUM < 0x074400
+	// No curl_multi_wakeup(), keep the old polling latency for new requests
+	timeout_ms = (std::min)(timeout_ms, HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+#endif
+
+	// Wait on the first policy class' multi handle and pass in the
+	// sockets of the others.  Their timers have to be honored here
+	// as libcurl only looks at the first one's.
+	std::vector<curl_waitfd> extra_fds;
+	for (int policy_class(1); policy_class < mPolicyCount; ++policy_class)
+	{
+		if (! mMultiHandles[policy_class] || ! mActiveHandles[policy_class])
+		{
+			continue;
+		}
+
+		long curl_timeout(-1);
+		curl_multi_timeout(mMultiHandles[policy_class], &curl_timeout);
+		if (curl_timeout >= 0 && curl_timeout < timeout_ms)
+		{
+			timeout_ms = int(curl_timeout);
+		}
+
+		fd_set read_fds, write_fds, except_fds;
+		FD_ZERO(&read_fds);
+		FD_ZERO(&write_fds);
+		FD_ZERO(&except_fds);
+		int max_fd(-1);
+		if (CURLM_OK != curl_multi_fdset(mMultiHandles[policy_class], &read_fds, &write_fds, &except_fds, &max_fd))
+		{
+			continue;
+		}
+#if LL_WINDOWS
+		// Windows fd_sets are arrays of sockets rather than bitmaps
+		const fd_set * sets[] = { &read_fds, &write_fds, &except_fds };
+		const short events[] = { CURL_WAIT_POLLIN, CURL_WAIT_POLLOUT, CURL_WAIT_POLLPRI };
+		for (int set(0); set < 3; ++set)
+		{
+			for (u_int i(0); i < sets[set]->fd_count; ++i)
+			{
+				curl_waitfd wait_fd = { sets[set]->fd_array[i], events[set], 0 };
+				extra_fds.push_back(wait_fd);
+			}
+		}
+#else
+		for (int fd(0); fd <= max_fd; ++fd)
+		{
+			short events(0);
+			events |= FD_ISSET(fd, &read_fds) ? CURL_WAIT_POLLIN : 0;
+			events |= FD_ISSET(fd, &write_fds) ? CURL_WAIT_POLLOUT : 0;
+			events |= FD_ISSET(fd, &except_fds) ? CURL_WAIT_POLLPRI : 0;
+			if (events)
+			{
+				curl_waitfd wait_fd = { fd, events, 0 };
+				extra_fds.push_back(wait_fd);
+			}
+		}
+#endif
+	}
+
+	if (timeout_ms <= 0)
+	{
+		return;
+	}
+
+	curl_waitfd * extra(extra_fds.empty() ? nullptr : &extra_fds[0]);
+#if LIBCURL_VERSION_NUM >= 0x074400
+	CURLMcode status = curl_multi_poll(mMultiHandles[0], extra, (unsigned int)extra_fds.size(), timeout_ms, nullptr);
+#else
+	CURLMcode status = curl_multi_wait(mMultiHandles[0], extra, (unsigned int)extra_fds.size(), timeout_ms, nullptr);
+#endif
+	if (CURLM_OK != status)
+	{
+		check_curl_multi_code(status);
+		ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+	}
+}
+
+
+void HttpLibcurl::wakeup()
+{
+#if LIBCURL_VERSION_NUM >= 0x074400
+	if (mMultiHandles && mMultiHandles[0])
+	{
+		curl_multi_wakeup(mMultiHandles[0]);
+	}
+#endif
+}
+
+
 // Caller has provided us with a ref count on op.
 void HttpLibcurl::addOp(const HttpOpRequest::ptr_t &op)
 {
@@ -235,8 +337,11 @@ void HttpLibcurl::addOp(const HttpOpRequest::ptr_t &op)
 		return;
 	}
 	op->mCurlActive = true;
+	op->mMetricIssued = totalTime();
 	mActiveOps.insert(op);
 	++mActiveHandles[op->mReqPolicy];
+
+	HTTPStats::instance().recordQueueLatency(F64(op->mMetricIssued - op->mMetricCreated) / 1.0E6);
 	
 	if (op->mTracing > HTTP_TRACE_OFF)
 	{
@@ -353,6 +458,15 @@ bool HttpLibcurl::completeRequest(CURLM * multi_handle, CURL * handle, CURLcode
 	{
 		op->mStatus = HttpStatus(HttpStatus::EXT_CURL_EASY, status);
 	}
+	if (op->mStatus && handle)
+	{
+		// Start transfer time is relative to when libcurl got the request
+		double first_byte(0.0);
+		if (CURLE_OK == curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME, &first_byte) && first_byte > 0.0)
+		{
+			HTTPStats::instance().recordFirstByteLatency(F64(op->mMetricIssued - op->mMetricCreated) / 1.0E6 + first_byte);
+		}
+	}
     if (op->mStatus)
     {
         // note: CURLINFO_RESPONSE_CODE requires a long - https://curl.haxx.se/libcurl/c/CURLINFO_RESPONSE_CODE.html
@@ -476,6 +590,30 @@ void HttpLibcurl::policyUpdated(int policy_class)
 		policy.stallPolicy(policy_class, false);
 		mDirtyPolicy[policy_class] = false;
 
+#if LIBCURL_VERSION_NUM >= 0x072E00
+		if (options.mHttp2Streams > 0)
+		{
+			// HTTP/2 multiplexing.  Requests ask to wait for an
+			// existing connection so there is one per host, the
+			// connection limits only matter for hosts that answer
+			// with HTTP/1.1.
+			check_curl_multi_setopt(multi_handle,
+									 CURLMOPT_PIPELINING,
+									 CURLPIPE_MULTIPLEX);
+#if LIBCURL_VERSION_NUM >= 0x074300
+			check_curl_multi_setopt(multi_handle,
+									 CURLMOPT_MAX_CONCURRENT_STREAMS,
+									 long(options.mHttp2Streams));
+#endif
+			check_curl_multi_setopt(multi_handle,
+									 CURLMOPT_MAX_HOST_CONNECTIONS,
+									 long(options.mPerHostConnectionLimit));
+			check_curl_multi_setopt(multi_handle,
+									 CURLMOPT_MAX_TOTAL_CONNECTIONS,
+									 long(options.mConnectionLimit));
+		}
+		else
+#endif
 		if (options.mPipelining > 1)
 		{
 			// We'll try to do pipelining on this multihandle
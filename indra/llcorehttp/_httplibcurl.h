@@ -75,6 +75,22 @@ public:
 	/// Threading:  called by worker thread.
 	HttpService::ELoopSpeed processTransport();
 
+	/// Sleep until libcurl has socket activity on any policy
+	/// class, one of its timers expires, @wakeup() is called or
+	/// @timeout_ms passes, whichever comes first.  Libcurl
+	/// releases older than 7.68 have no wakeup so the wait is
+	/// capped at HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS there.
+	///
+	/// Threading:  called by worker thread.
+	void waitForActivity(int timeout_ms);
+
+	/// Interrupt a current or the next @waitForActivity() call.
+	/// Only valid between start() and shutdown(), see
+	/// HttpRequestQueue::setWakeup() for how that is arranged.
+	///
+	/// Threading:  callable by any thread.
+	void wakeup();
+
 	/// Add request to the active list.  Caller is expected to have
 	/// provided us with a reference count on the op to hold the
 	/// request.  (No additional references will be added.)
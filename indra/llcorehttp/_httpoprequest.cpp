@@ -105,6 +105,10 @@ char * os_strtrim(char * str);
 char * os_strltrim(char * str);
 void os_strlower(char * str);
 
+// Maps an Indra priority, larger is more important, onto an
+// HTTP/2 stream weight in [1, 256].
+long http2_stream_weight(LLCore::HttpRequest::priority_t priority);
+
 // Error testing and reporting for libcurl status codes
 void check_curl_easy_code(CURLcode code, int curl_setopt_option);
 
@@ -143,6 +147,7 @@ HttpOpRequest::HttpOpRequest()
 	  mCurlBodyPos(0),
 	  mCurlTemp(NULL),
 	  mCurlTempLen(0),
+	  mMetricIssued(0),
 	  mReplyBody(NULL),
 	  mReplyOffset(0),
 	  mReplyLength(0),
@@ -715,7 +720,23 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
 	{
 		xfer_timeout = timeout;
 	}
-	if (cpolicy.mPipelining > 1L)
+	if (cpolicy.mHttp2Streams > 0L)
+	{
+		// Streams share the connection the way pipelined requests
+		// do and can wait on the ones ahead of them, give the transfer
+		// the same extra room.  CURL_HTTP_VERSION_2_0 negotiates with
+		// ALPN over TLS and with the h2c upgrade otherwise, a server
+		// that declines leaves us with HTTP/1.1 under the connection
+		// limits.
+		xfer_timeout *= 2L;
+
+		check_curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
+		check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
+#if LIBCURL_VERSION_NUM >= 0x072E00
+		check_curl_easy_setopt(mCurlHandle, CURLOPT_STREAM_WEIGHT, http2_stream_weight(mReqPriority));
+#endif
+	}
+	else if (cpolicy.mPipelining > 1L)
 	{
 		// Pipelining affects both connection and transfer timeout values.
 		// Requests that are added to a pipeling immediately have completed
@@ -745,13 +766,6 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
 		xfer_timeout *= 2L;
 
 		check_curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
-
-//		// Also try requesting HTTP/2.
-///******************************/
-//		// but for test purposes, only if overriding VIEWERASSET
-//		if (getenv("VIEWERASSET"))
-///******************************/
-//		check_curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
 	}
 	// *DEBUG:  Enable following override for timeout handling and "[curl:bugs] #1420" tests
     //if (cpolicy.mPipelining)
@@ -1332,6 +1346,20 @@ char * os_strltrim(char * lstr)
 }
 
 
+long http2_stream_weight(LLCore::HttpRequest::priority_t priority)
+{
+	// Weight by the bit length of the priority so the whole U32
+	// range spreads over the weights and order is kept.
+	long bits(0);
+	while (priority)
+	{
+		++bits;
+		priority >>= 1;
+	}
+	return 1L + (bits * 255L) / 32L;
+}
+
+
 void check_curl_easy_code(CURLcode code, int curl_setopt_option)
 {
 	if (CURLE_OK != code)
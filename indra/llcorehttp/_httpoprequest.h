@@ -214,6 +214,7 @@ public:
 	size_t				mCurlBodyPos;
 	char *				mCurlTemp;				// Scratch buffer for header processing
 	size_t				mCurlTempLen;
+	HttpTime			mMetricIssued;			// When last handed to libcurl
 	
 	// Result data
 	HttpStatus			mStatus;
@@ -248,10 +248,16 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 		}
 
 		int active(transport.getActiveCountInClass(policy_class));
-		int active_limit(state.mOptions.mPipelining > 1L
-						 ? (state.mOptions.mPerHostConnectionLimit
-							* state.mOptions.mPipelining)
-						 : state.mOptions.mConnectionLimit);
+		int active_limit(state.mOptions.mConnectionLimit);
+		if (state.mOptions.mHttp2Streams > 0L)
+		{
+			// Multiplexed streams, sockets aren't the limit
+			active_limit = state.mOptions.mHttp2Streams;
+		}
+		else if (state.mOptions.mPipelining > 1L)
+		{
+			active_limit = state.mOptions.mPerHostConnectionLimit * state.mOptions.mPipelining;
+		}
 		int needed(active_limit - active);		// Expect negatives here
 
 		if (needed > 0)
@@ -320,11 +326,17 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 
 	throttle_on:
 		
-		if (! readyq.empty() || ! retryq.empty())
+		if (! retryq.empty() || (! readyq.empty() && throttle_enabled))
 		{
-			// If anything is ready, continue looping...
+			// Waiting on a retry time or the throttle, continue looping...
 			result = HttpService::NORMAL;
 		}
+		else if (! readyq.empty())
+		{
+			// Waiting on a connection, only a completion in the
+			// transport frees one.
+			result = (std::min)(result, HttpService::WAIT_TRANSPORT);
+		}
 	} // end foreach policy_class
 
 	return result;
@@ -28,6 +28,8 @@
 
 #include "_httpinternal.h"
 
+#include <curl/curl.h>
+
 
 namespace LLCore
 {
@@ -37,7 +39,8 @@ HttpPolicyClass::HttpPolicyClass()
 	: mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
 	  mPerHostConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
 	  mPipelining(HTTP_PIPELINING_DEFAULT),
-	  mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT)
+	  mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT),
+	  mHttp2Streams(HTTP_HTTP2_STREAMS_DEFAULT)
 {}
 
 
@@ -53,6 +56,7 @@ HttpPolicyClass & HttpPolicyClass::operator=(const HttpPolicyClass & other)
 		mPerHostConnectionLimit = other.mPerHostConnectionLimit;
 		mPipelining = other.mPipelining;
 		mThrottleRate = other.mThrottleRate;
+		mHttp2Streams = other.mHttp2Streams;
 	}
 	return *this;
 }
@@ -62,7 +66,8 @@ HttpPolicyClass::HttpPolicyClass(const HttpPolicyClass & other)
 	: mConnectionLimit(other.mConnectionLimit),
 	  mPerHostConnectionLimit(other.mPerHostConnectionLimit),
 	  mPipelining(other.mPipelining),
-	  mThrottleRate(other.mThrottleRate)
+	  mThrottleRate(other.mThrottleRate),
+	  mHttp2Streams(other.mHttp2Streams)
 {}
 
 
@@ -86,6 +91,23 @@ HttpStatus HttpPolicyClass::set(HttpRequest::EPolicyOption opt, long value)
 		mThrottleRate = llclamp(value, 0L, 1000000L);
 		break;
 
+	case HttpRequest::PO_HTTP2_STREAM_LIMIT:
+#if LIBCURL_VERSION_NUM >= 0x072E00
+		// The library loaded may still lack nghttp2
+		if (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2)
+		{
+			mHttp2Streams = llclamp(value, 0L, HTTP_HTTP2_STREAMS_MAX);
+		}
+		else
+		{
+			mHttp2Streams = 0L;
+		}
+#else
+		// Stream weights and multiplexing need libcurl 7.46
+		mHttp2Streams = 0L;
+#endif
+		break;
+
 	default:
 		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
 	}
@@ -114,6 +136,10 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
 		*value = mThrottleRate;
 		break;
 
+	case HttpRequest::PO_HTTP2_STREAM_LIMIT:
+		*value = mHttp2Streams;
+		break;
+
 	default:
 		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
 	}
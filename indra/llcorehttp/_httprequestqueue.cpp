@@ -83,6 +83,10 @@ HttpStatus HttpRequestQueue::addOp(const HttpRequestQueue::opPtr_t &op, bool log
 		}
 		wake = mQueue.empty();
 		mQueue.push_back(op);
+		if (wake && mWakeup)
+		{
+			mWakeup();
+		}
 	}
 	if (wake)
 	{
@@ -144,11 +148,23 @@ void HttpRequestQueue::wakeAll()
 }
 
 
+void HttpRequestQueue::setWakeup(const wakeup_fn_t & wakeup)
+{
+	HttpScopedLock lock(mQueueMutex);
+
+	mWakeup = wakeup;
+}
+
+
 void HttpRequestQueue::stopQueue()
 {
 	{
 		HttpScopedLock lock(mQueueMutex);
 
+		if (! mQueueStopped && mWakeup)
+		{
+			mWakeup();
+		}
 		mQueueStopped = true;
 		wakeAll();
 	}
@@ -28,6 +28,7 @@
 #define	_LLCORE_HTTP_REQUEST_QUEUE_H_
 
 
+#include <functional>
 #include <vector>
 
 #include "httpcommon.h"
@@ -71,6 +72,7 @@ public:
 	
 public:
     typedef std::vector<opPtr_t> OpContainer;
+    typedef std::function<void ()> wakeup_fn_t;
 
 	/// Insert an object at the back of the request queue.
 	///
@@ -113,6 +115,17 @@ public:
 	/// Threading:  callable by any thread.
 	void wakeAll();
 
+	/// Install a function to be called when an operation lands
+	/// on an empty queue or the queue is stopped.  Lets a consumer
+	/// that waits on something other than @fetchAll (such as
+	/// libcurl's sockets) notice new requests.  The function is
+	/// called with the queue lock held and never after @stopQueue,
+	/// so anything it uses only has to live that long.  Pass an
+	/// empty function to remove it.
+	///
+	/// Threading:  callable by any thread.
+	void setWakeup(const wakeup_fn_t & wakeup);
+
 	/// Disallow further request queuing.  Callers to @addOp will
 	/// get a failure status (LLCORE, HE_SHUTTING_DOWN).  Callers
 	/// to @fetchAll or @fetchOp will get requests that are on the
@@ -131,6 +144,7 @@ protected:
 	LLCoreInt::HttpMutex				mQueueMutex;
 	LLCoreInt::HttpConditionVariable	mQueueCV;
 	bool								mQueueStopped;
+	wakeup_fn_t							mWakeup;
 	
 }; // end class HttpRequestQueue
 
@@ -60,7 +60,8 @@ const HttpService::OptionDescriptor HttpService::sOptionDesc[] =
 	{	true,		true,		true,		false,		false	},		// PO_TRACE
 	{	true,		true,		false,		true,		false	},		// PO_ENABLE_PIPELINING
 	{	true,		true,		false,		true,		false	},		// PO_THROTTLE_RATE
-	{   false,		false,		true,		false,		true	}		// PO_SSL_VERIFY_CALLBACK
+	{   false,		false,		true,		false,		true	},		// PO_SSL_VERIFY_CALLBACK
+	{	true,		true,		false,		true,		false	}		// PO_HTTP2_STREAM_LIMIT
 };
 HttpService * HttpService::sInstance(nullptr);
 volatile HttpService::EState HttpService::sState(NOT_INITIALIZED);
@@ -120,6 +121,7 @@ HttpService::~HttpService()
 	
 	if (mRequestQueue)
 	{
+		mRequestQueue->setWakeup(HttpRequestQueue::wakeup_fn_t());
 		mRequestQueue->release();
 		mRequestQueue = nullptr;
 	}
@@ -217,6 +219,10 @@ void HttpService::startThread()
 	mPolicy->start();
 	mTransport->start(mLastPolicy + 1);
 
+	// Let new requests interrupt a wait on libcurl
+	HttpLibcurl * transport(mTransport);
+	mRequestQueue->setWakeup([transport]() { transport->wakeup(); });
+
 	mThread = new LLCoreInt::HttpThread(std::bind(&HttpService::threadRun, this, std::placeholders::_1));
 	sState = RUNNING;
 }
@@ -273,8 +279,10 @@ bool HttpService::cancel(HttpHandle handle)
 /// Threading:  callable by worker thread.
 void HttpService::shutdown()
 {
-	// Disallow future enqueue of requests
+	// Disallow future enqueue of requests.  Nothing calls the
+	// transport's wakeup once the queue is stopped.
 	mRequestQueue->stopQueue();
+	mRequestQueue->setWakeup(HttpRequestQueue::wakeup_fn_t());
 
 	// Cancel requests already on the request queue
 	HttpRequestQueue::OpContainer ops;
@@ -296,9 +304,9 @@ void HttpService::shutdown()
 
 // Working thread loop-forever method.  Gives time to
 // each of the request queue, policy layer and transport
-// layer pieces and then either sleeps for a small time
-// or waits for a request to come in.  Repeats until
-// requested to stop.
+// layer pieces and then either waits on libcurl's sockets
+// or waits for a request to come in.  Queuing a request
+// ends either wait.  Repeats until requested to stop.
 void HttpService::threadRun(LLCoreInt::HttpThread * thread)
 {
 	boost::this_thread::disable_interruption di;
@@ -318,10 +326,15 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
 		    new_loop = mTransport->processTransport();
 		    loop = (std::min)(loop, new_loop);
 		
-		    // Determine whether to spin, sleep briefly or sleep for next request
-		    if (REQUEST_SLEEP != loop)
+		    // Determine whether to wait briefly, wait for transfers or
+		    // sleep for next request in processRequestQueue()
+		    if (NORMAL == loop)
+		    {
+			    mTransport->waitForActivity(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+		    }
+		    else if (WAIT_TRANSPORT == loop)
 		    {
-			    ms_sleep(HTTP_SERVICE_LOOP_SLEEP_NORMAL_MS);
+			    mTransport->waitForActivity(HTTP_SERVICE_LOOP_WAIT_TRANSPORT_MS);
 		    }
         }
         catch (const LLContinueError&)
@@ -104,6 +104,7 @@ public:
 	enum ELoopSpeed
 	{
 		NORMAL,					///< continuous polling of request, ready, active queues
+		WAIT_TRANSPORT,			///< can sleep until libcurl has socket activity or a request is queued
 		REQUEST_SLEEP			///< can sleep indefinitely waiting for request queue write
 	};
 
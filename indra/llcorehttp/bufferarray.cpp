@@ -302,7 +302,7 @@ int BufferArray::findBlock(size_t pos, size_t * ret_offset)
 }
 
 
-bool BufferArray::getBlockStartEnd(int block, const char ** start, const char ** end)
+bool BufferArray::getBlockStartEnd(int block, const char ** start, const char ** end) const
 {
 	if (block < 0 || block >= (int)mBlocks.size())
 	{
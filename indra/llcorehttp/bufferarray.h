@@ -119,12 +119,24 @@ public:
 	/// append data when current position is equal to the
 	/// size of the instance or do a mix of both.
 	size_t write(size_t pos, const void * src, size_t len);
+
+	/// Count of internal blocks holding the data, for use
+	/// with @see getBlockStartEnd().
+	int getBlockCount() const
+		{
+			return int(mBlocks.size());
+		}
+
+	/// Gives read access to the data of one block in place,
+	/// letting consumers walk the instance without copying.
+	/// Pointers stay valid until the instance is modified.
+	///
+	/// @return			False if 'block' is out of range.
+	bool getBlockStartEnd(int block, const char ** start, const char ** end) const;
 	
 protected:
 	int findBlock(size_t pos, size_t * ret_offset);
 
-	bool getBlockStartEnd(int block, const char ** start, const char ** end);
-	
 protected:
 	class Block;
 	typedef std::vector<Block *> container_t;
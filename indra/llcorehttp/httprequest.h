@@ -231,6 +231,20 @@ public:
 		/// Global only
 		PO_SSL_VERIFY_CALLBACK,
 
+		/// Long value that, when positive, switches the policy
+		/// class to HTTP/2.  Requests are multiplexed as streams
+		/// over one connection per host and the value limits the
+		/// number of streams in flight for the class, replacing
+		/// the connection limits which then only apply to hosts
+		/// that fall back to HTTP/1.1.  Request priorities are
+		/// passed on to the server as stream weights.  Cleartext
+		/// URLs use the h2c upgrade.  Zero, the default, keeps
+		/// HTTP/1.1.  Reads back as zero if libcurl was built
+		/// without multiplexing support.
+		///
+		/// Per-class only
+		PO_HTTP2_STREAM_LIMIT,
+
 		PO_LAST  // Always at end
 	};
 
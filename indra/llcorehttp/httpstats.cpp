@@ -45,6 +45,8 @@ void HTTPStats::resetStats()
     mDataDown.reset();
     mDataUp.reset();
     mRequests = 0;
+    mQueueLatency.reset();
+    mFirstByteLatency.reset();
 }
 
 
@@ -61,8 +63,57 @@ void HTTPStats::recordResultCode(S32 code)
 
 }
 
+HTTPStats::LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void HTTPStats::LatencyHistogram::reset()
+{
+    for (auto& bucket : mBuckets)
+    {
+        bucket = 0;
+    }
+}
+
+void HTTPStats::LatencyHistogram::record(F64 seconds)
+{
+    int bucket(0);
+    while (bucket < BUCKET_COUNT - 1 && seconds * 1000.0 >= getBucketLimitMS(bucket))
+    {
+        ++bucket;
+    }
+    ++mBuckets[bucket];
+}
+
+U32 HTTPStats::LatencyHistogram::getTotalCount() const
+{
+    U32 total(0);
+    for (const auto& bucket : mBuckets)
+    {
+        total += bucket;
+    }
+    return total;
+}
+
 namespace
 {
+    void dump_histogram(std::stringstream& out, const HTTPStats::LatencyHistogram& histogram)
+    {
+        for (int bucket = 0; bucket < HTTPStats::LatencyHistogram::BUCKET_COUNT; ++bucket)
+        {
+            if (bucket < HTTPStats::LatencyHistogram::BUCKET_COUNT - 1)
+            {
+                out << "<" << HTTPStats::LatencyHistogram::getBucketLimitMS(bucket) << "ms ";
+            }
+            else
+            {
+                out << ">=" << HTTPStats::LatencyHistogram::getBucketLimitMS(bucket - 1) << "ms ";
+            }
+            out << histogram.getCount(bucket) << std::endl;
+        }
+    }
+
     std::string byte_count_converter(F32 bytes)
     {
         static const char unit_suffix[] = { 'B', 'K', 'M', 'G' };
@@ -101,6 +152,13 @@ void HTTPStats::dumpStats()
         out << code.first << " " << code.second << std::endl;
     }
 
+    out << std::endl;
+    out << "Queue Latency (" << mQueueLatency.getTotalCount() << " requests):" << std::endl;
+    dump_histogram(out, mQueueLatency);
+    out << std::endl;
+    out << "First Byte Latency (" << mFirstByteLatency.getTotalCount() << " requests):" << std::endl;
+    dump_histogram(out, mFirstByteLatency);
+
     LL_WARNS("HTTPCore") << out.str() << LL_ENDL;
 }
 
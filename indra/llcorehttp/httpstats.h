@@ -33,6 +33,8 @@
 #include "llsingleton.h"
 #include "llsd.h"
 
+#include <atomic>
+
 namespace LLCore
 {
     class HTTPStats final : public LLSingleton<HTTPStats>
@@ -45,6 +47,29 @@ namespace LLCore
 
         typedef LLStatsAccumulator StatsAccumulator;
 
+        // Counts of latencies in power of two millisecond buckets:
+        // bucket 0 is under 1mS, bucket n is [2^(n-1), 2^n) mS and
+        // the last bucket takes everything longer.
+        // Threading:  record() is called by the worker thread.
+        class LatencyHistogram
+        {
+        public:
+            static const int BUCKET_COUNT = 16;
+
+            LatencyHistogram();
+
+            void    reset();
+            void    record(F64 seconds);
+
+            U32     getCount(int bucket) const  { return mBuckets[bucket]; }
+            U32     getTotalCount() const;
+            // Upper bound of a bucket in mS, the last one has none.
+            static U32 getBucketLimitMS(int bucket)  { return 1U << bucket; }
+
+        private:
+            std::atomic<U32> mBuckets[BUCKET_COUNT];
+        };
+
         void    recordDataDown(size_t bytes)
         {
             mDataDown.push(bytes);
@@ -59,6 +84,21 @@ namespace LLCore
 
         void    recordResultCode(S32 code);
 
+        // Time from request creation to handing it to libcurl.
+        void    recordQueueLatency(F64 seconds)
+        {
+            mQueueLatency.record(seconds);
+        }
+
+        // Time from request creation to the first byte of the response.
+        void    recordFirstByteLatency(F64 seconds)
+        {
+            mFirstByteLatency.record(seconds);
+        }
+
+        const LatencyHistogram& getQueueLatency() const         { return mQueueLatency; }
+        const LatencyHistogram& getFirstByteLatency() const     { return mFirstByteLatency; }
+
         void    dumpStats();
     private:
         StatsAccumulator mDataDown;
@@ -67,6 +107,9 @@ namespace LLCore
         S32              mRequests;
 
         std::map<S32, S32> mResultCodes;
+
+        LatencyHistogram mQueueLatency;
+        LatencyHistogram mFirstByteLatency;
     };
 
 
@@ -3234,6 +3234,149 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+	ScopedCurlInit ready;
+
+	set_test_name("HttpRequest GETs multiplexed over HTTP/2");
+
+	std::string url_base(get_h2c_base_url());
+	if (url_base.empty())
+	{
+		skip("No HTTP/2 test peer");
+	}
+
+	// Handler can be stack-allocated *if* there are no dangling
+	// references to it after completion of this method.
+	// Create before memory record as the string copy will bump numbers.
+	TestHandler2 handler(this, "handler");
+	LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+	mHandlerCalls = 0;
+
+	HttpRequest * req = NULL;
+	HttpOptions::ptr_t opts;
+
+	try
+	{
+		// Get singletons created
+		HttpRequest::createService();
+
+		// One connection allowed but more streams than requests
+		HttpRequest::policy_t pclass(HttpRequest::createPolicyClass());
+		HttpRequest::setStaticPolicyOption(HttpRequest::PO_CONNECTION_LIMIT, pclass, 1, NULL);
+		HttpRequest::setStaticPolicyOption(HttpRequest::PO_PER_HOST_CONNECTION_LIMIT, pclass, 1, NULL);
+		long streams(0);
+		HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAM_LIMIT, pclass, 16, &streams);
+		if (! streams)
+		{
+			skip("libcurl lacks HTTP/2 multiplexing");
+		}
+
+		// Start threading early so that thread memory is invariant
+		// over the test.
+		HttpRequest::startThread();
+
+		// create a new ref counted object with an implicit reference
+		req = new HttpRequest();
+		ensure("Memory allocated on construction", mMemTotal < GetMemTotal());
+
+		opts = HttpOptions::ptr_t(new HttpOptions());
+		opts->setWantHeaders(true);
+
+		// Every answer must come from the peer's first connection
+		// and with more than one stream open on it
+		handler.mHeadersRequired.push_back(
+			regex_container_t::value_type(
+				boost::regex("x-ll-h2-connection", boost::regex::icase),
+				boost::regex("1")));
+		handler.mHeadersRequired.push_back(
+			regex_container_t::value_type(
+				boost::regex("x-ll-h2-streams", boost::regex::icase),
+				boost::regex("([2-9]|[1-9][0-9]+)")));
+
+		// Issue GETs at different priorities, more than the
+		// connection limit would allow in flight
+		mStatus = HttpStatus(200);
+		int url_limit(8);
+		for (int i(0); i < url_limit; ++i)
+		{
+			std::ostringstream url;
+			url << url_base << "stream/" << i << "/";
+			HttpHandle handle = req->requestGet(pclass,
+												HttpRequest::priority_t(i * 1000U),
+												url.str(),
+												opts,
+												HttpHeaders::ptr_t(),
+												handlerp);
+
+			std::ostringstream testtag;
+			testtag << "Valid handle returned for HTTP/2 request #" << i;
+			ensure(testtag.str(), handle != LLCORE_HTTP_HANDLE_INVALID);
+		}
+
+		// Run the notification pump.
+		int count(0);
+		int limit(LOOP_COUNT_LONG);
+		while (count++ < limit && mHandlerCalls < url_limit)
+		{
+			req->update(0);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Requests executed in reasonable time", count < limit);
+		ensure("One handler invocation for each request", mHandlerCalls == url_limit);
+
+		// Okay, request a shutdown of the servicing thread
+		handler.mHeadersRequired.clear();
+		mStatus = HttpStatus();
+		mHandlerCalls = 0;
+		HttpHandle handle = req->requestStopThread(handlerp);
+		ensure("Valid handle returned for second request", handle != LLCORE_HTTP_HANDLE_INVALID);
+
+		// Run the notification pump again
+		count = 0;
+		limit = LOOP_COUNT_LONG;
+		while (count++ < limit && mHandlerCalls < 1)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Second request executed in reasonable time", count < limit);
+		ensure("Second handler invocation", mHandlerCalls == 1);
+
+		// See that we actually shutdown the thread
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && ! HttpService::isStopped())
+		{
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Thread actually stopped running", HttpService::isStopped());
+
+		// release options
+		opts.reset();
+
+		// release the request object
+		delete req;
+		req = NULL;
+
+		// Shut down service
+		HttpRequest::destroyService();
+	}
+	catch (...)
+	{
+		stop_thread(req);
+		opts.reset();
+		delete req;
+		HttpRequest::destroyService();
+		throw;
+	}
+}
+
+
 }  // end namespace tut
 
 namespace
@@ -182,6 +182,55 @@ void HttpRequestqueueTestObjectType::test<4>()
 	ensure("All memory returned", mMemTotal == GetMemTotal());
 }
 
+template <> template <>
+void HttpRequestqueueTestObjectType::test<5>()
+{
+	set_test_name("HttpRequestQueue wakeup");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	HttpRequestQueue::init();
+
+	HttpRequestQueue * rq = HttpRequestQueue::instanceOf();
+
+	int wakeups(0);
+	rq->setWakeup([&wakeups]() { ++wakeups; });
+
+	HttpOperation::ptr_t op (new HttpOpNull());
+	rq->addOp(op);
+	ensure("Wakeup on first op", 1 == wakeups);
+
+	op.reset(new HttpOpNull());
+	rq->addOp(op);
+	ensure("No wakeup while ops are waiting", 1 == wakeups);
+
+	{
+		HttpRequestQueue::OpContainer ops;
+		rq->fetchAll(false, ops);
+		ensure("Two go in, two come out", 2 == ops.size());
+	}
+
+	op.reset(new HttpOpNull());
+	rq->addOp(op);
+	ensure("Wakeup once emptied", 2 == wakeups);
+
+	rq->stopQueue();
+	ensure("Wakeup on stop", 3 == wakeups);
+
+	op.reset(new HttpOpNull());
+	ensure("Stopped queue refuses ops", ! rq->addOp(op));
+	rq->stopQueue();
+	ensure("No wakeup once stopped", 3 == wakeups);
+	op.reset();
+
+	rq->setWakeup(HttpRequestQueue::wakeup_fn_t());
+	HttpRequestQueue::term();
+
+	// Should be clean
+	ensure("All memory returned", mMemTotal == GetMemTotal());
+}
+
 }  // end namespace tut
 
 
@@ -34,6 +34,9 @@ import sys
 import time
 import select
 import getopt
+import socket
+import struct
+import threading
 try:
     from cStringIO import StringIO
 except ImportError:
@@ -288,6 +291,187 @@ class Server(HTTPServer):
         print client_address
         print '-'*40
 
+class H2CServer(object):
+    """Minimal cleartext HTTP/2 peer for the multiplexing tests.
+
+    Takes connections either with prior knowledge or through the
+    HTTP/1.1 'Upgrade: h2c' handshake.  Request header blocks aren't
+    decoded, every request is answered with a 200 and a small LLSD body.
+    Responses are held until the connection has been quiet for a moment
+    so that concurrent streams overlap, and carry two extra headers:
+    - 'x-ll-h2-connection'  serial number of the connection, from 1
+    - 'x-ll-h2-streams'     most streams open at once on it so far
+    Requests that don't ask for the upgrade get an HTTP/1.1 200 without
+    those headers.
+    """
+    PREFACE = b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+    DATA, HEADERS, RST_STREAM, SETTINGS, PING, GOAWAY, WINDOW_UPDATE, CONTINUATION = \
+        0x0, 0x1, 0x3, 0x4, 0x6, 0x7, 0x8, 0x9
+    END_STREAM, ACK, END_HEADERS = 0x1, 0x1, 0x4
+
+    BODY = llsd.format_xml(dict(reply="success", status=200,
+                                reason="Your GET operation worked"))
+
+    def __init__(self, address):
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.socket.bind(address)
+        self.socket.listen(16)
+        self.server_port = self.socket.getsockname()[1]
+        self.serial = 0
+        self.lock = threading.Lock()
+
+    def serve_forever(self):
+        thread = threading.Thread(target=self._accept)
+        thread.daemon = True
+        thread.start()
+
+    def _accept(self):
+        while True:
+            conn, addr = self.socket.accept()
+            with self.lock:
+                self.serial += 1
+                serial = self.serial
+            thread = threading.Thread(target=self._connection, args=(conn, serial))
+            thread.daemon = True
+            thread.start()
+
+    def _connection(self, conn, serial):
+        try:
+            _H2CConnection(self, conn, serial).run()
+        except (socket.error, EOFError):
+            pass
+        finally:
+            conn.close()
+
+    @staticmethod
+    def frame(ftype, flags, stream, payload=b""):
+        return struct.pack(">I", len(payload))[1:] + \
+            struct.pack(">BBI", ftype, flags, stream & 0x7fffffff) + payload
+
+    @staticmethod
+    def hpack_literal(name, value):
+        # Literal header field without indexing, new name, no Huffman
+        def string(text):
+            text = text.encode("ascii")
+            length = len(text)
+            if length < 0x7f:
+                return struct.pack("B", length) + text
+            out, length = bytearray([0x7f]), length - 0x7f
+            while length >= 0x80:
+                out.append((length & 0x7f) | 0x80)
+                length >>= 7
+            out.append(length)
+            return bytes(out) + text
+        return b"\x00" + string(name) + string(value)
+
+class _H2CConnection(object):
+    QUIET = 0.05                        # seconds of silence before answering
+
+    def __init__(self, server, conn, serial):
+        self.server = server
+        self.conn = conn
+        self.serial = serial
+        self.buffer = b""
+        self.open = set()               # streams with a request in progress
+        self.ready = []                 # streams with a complete request
+        self.most = 0
+
+    def read(self, count):
+        while len(self.buffer) < count:
+            data = self.conn.recv(65536)
+            if not data:
+                raise EOFError()
+            self.buffer += data
+        data, self.buffer = self.buffer[:count], self.buffer[count:]
+        return data
+
+    def run(self):
+        if not self.start():
+            return
+        self.send(H2CServer.frame(H2CServer.SETTINGS, 0, 0,
+                                  struct.pack(">HI", 0x3, 100)))    # MAX_CONCURRENT_STREAMS
+        if self.read(len(H2CServer.PREFACE)) != H2CServer.PREFACE:
+            return
+        while True:
+            if not self.buffer:
+                readable = select.select([self.conn], [], [], self.QUIET)[0]
+                if not readable:
+                    self.respond()
+                    continue
+            header = bytearray(self.read(9))
+            length = (header[0] << 16) | (header[1] << 8) | header[2]
+            ftype, flags = header[3], header[4]
+            stream = struct.unpack(">I", bytes(header[5:9]))[0] & 0x7fffffff
+            payload = self.read(length)
+            if ftype == H2CServer.SETTINGS and not flags & H2CServer.ACK:
+                self.send(H2CServer.frame(H2CServer.SETTINGS, H2CServer.ACK, 0))
+            elif ftype == H2CServer.PING and not flags & H2CServer.ACK:
+                self.send(H2CServer.frame(H2CServer.PING, H2CServer.ACK, 0, payload))
+            elif ftype == H2CServer.GOAWAY:
+                return
+            elif ftype in (H2CServer.HEADERS, H2CServer.CONTINUATION, H2CServer.DATA):
+                if ftype == H2CServer.HEADERS:
+                    self.open.add(stream)
+                    self.most = max(self.most, len(self.open) + len(self.ready))
+                if ftype == H2CServer.DATA and length:
+                    # Keep the connection's window open, bodies are tiny
+                    self.send(H2CServer.frame(H2CServer.WINDOW_UPDATE, 0, 0,
+                                              struct.pack(">I", length)))
+                if flags & H2CServer.END_STREAM and stream in self.open:
+                    self.open.discard(stream)
+                    self.ready.append(stream)
+            elif ftype == H2CServer.RST_STREAM:
+                self.open.discard(stream)
+                if stream in self.ready:
+                    self.ready.remove(stream)
+
+    def start(self):
+        """Reads the connection preface or the upgrade request.  Returns
+        False if the connection was handled as plain HTTP/1.1."""
+        if self.read(len(H2CServer.PREFACE)) == H2CServer.PREFACE:
+            self.buffer = H2CServer.PREFACE + self.buffer
+            return True
+        while b"\r\n\r\n" not in self.buffer:
+            data = self.conn.recv(65536)
+            if not data:
+                raise EOFError()
+            self.buffer += data
+        request, self.buffer = self.buffer.split(b"\r\n\r\n", 1)
+        headers = [line.split(b":", 1) for line in request.split(b"\r\n")[1:]]
+        upgrade = [value.strip().lower() for name, value in headers
+                   if name.strip().lower() == b"upgrade"]
+        if b"h2c" not in upgrade:
+            self.send(b"HTTP/1.1 200 OK\r\n"
+                      b"Content-Type: application/llsd+xml\r\n"
+                      b"Content-Length: %d\r\n"
+                      b"Connection: close\r\n\r\n" % len(H2CServer.BODY)
+                      + H2CServer.BODY)
+            return False
+        self.send(b"HTTP/1.1 101 Switching Protocols\r\n"
+                  b"Connection: Upgrade\r\n"
+                  b"Upgrade: h2c\r\n\r\n")
+        # The upgraded request becomes half-closed stream 1
+        self.ready.append(1)
+        self.most = 1
+        return True
+
+    def respond(self):
+        for stream in self.ready:
+            block = b"".join(H2CServer.hpack_literal(name, value) for name, value in
+                             ((":status", "200"),
+                              ("content-type", "application/llsd+xml"),
+                              ("content-length", str(len(H2CServer.BODY))),
+                              ("x-ll-h2-connection", str(self.serial)),
+                              ("x-ll-h2-streams", str(self.most))))
+            self.send(H2CServer.frame(H2CServer.HEADERS, H2CServer.END_HEADERS, stream, block) +
+                      H2CServer.frame(H2CServer.DATA, H2CServer.END_STREAM, stream,
+                                      H2CServer.BODY))
+        self.ready = []
+
+    def send(self, data):
+        self.conn.sendall(data)
+
 if __name__ == "__main__":
     do_valgrind = False
     path_search = False
@@ -315,6 +499,16 @@ if __name__ == "__main__":
     # performed in TUT code rather than our own.
     os.environ["LL_TEST_PORT"] = str(httpd.server_port)
     debug("$LL_TEST_PORT = %s", httpd.server_port)
+
+    # Cleartext HTTP/2 peer for the multiplexing tests, same port rules.
+    make_h2c_server = lambda port: H2CServer(('127.0.0.1', port))
+    if not sys.platform.startswith("win"):
+        h2cd = make_h2c_server(0)
+    else:
+        h2cd, port = freeport(xrange(8020, 8040), make_h2c_server)
+    h2cd.serve_forever()
+    os.environ["LL_TEST_H2C_PORT"] = str(h2cd.server_port)
+    debug("$LL_TEST_H2C_PORT = %s", h2cd.server_port)
     if do_valgrind:
         args = ["valgrind", "--log-file=./valgrind.log"] + args
         path_search = True
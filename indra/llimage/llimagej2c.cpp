@@ -41,6 +41,7 @@ LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl();
 
 // Test data gathering handle
 LLImageCompressionTester* LLImageJ2C::sTesterp = nullptr ;
+S32 LLImageJ2C::sDecodeThreads = 0;
 const std::string sTesterName("ImageCompressionTester");
 
 //static
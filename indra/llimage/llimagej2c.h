@@ -78,6 +78,11 @@ public:
 
 	static std::string getEngineInfo();
 
+	// Threads a single decode may split an image over, for engines that
+	// can (OpenJPEG 2.x). 0 picks a count from the image size.
+	static void setDecodeThreads(S32 threads) { sDecodeThreads = threads; }
+	static S32 getDecodeThreads() { return sDecodeThreads; }
+
 protected:
 	friend class LLImageJ2CImpl;
 	friend class LLImageJ2COJ;
@@ -99,6 +104,7 @@ protected:
 
     // Image compression/decompression tester
 	static LLImageCompressionTester* sTesterp;
+	static S32 sDecodeThreads;
 };
 
 // Derive from this class to implement JPEG2000 decoding
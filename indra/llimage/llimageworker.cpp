@@ -32,8 +32,8 @@
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, LLQueuedThreadPool* pool)
+	: LLQueuedThread("imagedecode", threaded, false, pool)
 	, mCreationListSize(0)
 {
 	mCreationMutex = new LLMutex();
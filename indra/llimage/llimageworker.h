@@ -72,7 +72,8 @@ public:
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// With a pool, images are decoded on all of its threads at once
+	LLImageDecodeThread(bool threaded = true, LLQueuedThreadPool* pool = nullptr);
 	virtual ~LLImageDecodeThread();
 
 	handle_t decodeImage(LLImageFormatted* image,
@@ -30,7 +30,26 @@
 // this is defined so that we get static linking.
 #include "openjpeg.h"
 
+// OpenJPEG 2.x replaced the cio/dinfo API with streams and codecs, and from
+// 2.2 on decodes the code-blocks of a tile on several threads.
+#if defined(OPJ_VERSION_MAJOR) && (OPJ_VERSION_MAJOR >= 2)
+#define LL_OPENJPEG2 1
+#if (OPJ_VERSION_MAJOR > 2) || (OPJ_VERSION_MINOR >= 2)
+#define LL_OPENJPEG2_THREADS 1
+#endif
+#if (OPJ_VERSION_MAJOR > 2) || (OPJ_VERSION_MINOR >= 5)
+#define LL_OPENJPEG2_STRICT_MODE 1
+#endif
+#endif
+
 #include "lltimer.h"
+
+#if LL_OPENJPEG2
+#include "llthreadteam.h"
+
+#include <thread>
+#include <vector>
+#endif
 //#include "llmemory.h"
 
 // Factory function: see declaration in llimagej2c.cpp
@@ -93,35 +112,37 @@ int ceildivpow2(int a, int b)
 	return (a + (1 << b) - 1) >> b;
 }
 
-
-LLImageJ2COJ::LLImageJ2COJ()
-	: LLImageJ2CImpl()
+inline S32 extractLong4( U8 const *aBuffer, int nOffset )
 {
+	S32 ret = aBuffer[ nOffset ] << 24;
+	ret += aBuffer[ nOffset + 1 ] << 16;
+	ret += aBuffer[ nOffset + 2 ] << 8;
+	ret += aBuffer[ nOffset + 3 ];
+	return ret;
 }
 
-
-LLImageJ2COJ::~LLImageJ2COJ()
+inline S32 extractShort2( U8 const *aBuffer, int nOffset )
 {
+	S32 ret = aBuffer[ nOffset ] << 8;
+	ret += aBuffer[ nOffset + 1 ];
+
+	return ret;
 }
 
-bool LLImageJ2COJ::initDecode(LLImageJ2C &base, LLImageRaw &raw_image, int discard_level, int* region)
+inline bool isSOC( U8 const *aBuffer )
 {
-	// No specific implementation for this method in the OpenJpeg case
-	return false;
+	return aBuffer[ 0 ] == 0xFF && aBuffer[ 1 ] == 0x4F;
 }
 
-bool LLImageJ2COJ::initEncode(LLImageJ2C &base, LLImageRaw &raw_image, int blocks_size, int precincts_size, int levels)
+inline bool isSIZ( U8 const *aBuffer )
 {
-	// No specific implementation for this method in the OpenJpeg case
-	return false;
+	return aBuffer[ 0 ] == 0xFF && aBuffer[ 1 ] == 0x51;
 }
 
-bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count)
-{
-	LLTimer decode_timer;
 
-	/* Extract metadata */
-	/* ---------------- */
+// Copies the image comment, if any, to raw_image.mComment
+static void read_comment(LLImageJ2C &base, LLImageRaw &raw_image)
+{
 	U8* c_data = base.getData();
 	size_t c_size =  base.getDataSize();
 	size_t position = 0;
@@ -159,7 +180,368 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		}
 		++position;
 	}
-	
+}
+
+#if LL_OPENJPEG2
+// opj_stream_t over the image data when decoding, or a growing buffer when encoding
+struct LLJ2CStreamBuffer
+{
+	const U8* mData;
+	OPJ_SIZE_T mSize;
+	OPJ_SIZE_T mOffset;
+	std::vector<U8>* mOutput;
+};
+
+static OPJ_SIZE_T stream_read(void* buffer, OPJ_SIZE_T bytes, void* user_data)
+{
+	LLJ2CStreamBuffer* stream = (LLJ2CStreamBuffer*)user_data;
+	if (stream->mOffset >= stream->mSize)
+	{
+		return (OPJ_SIZE_T)-1; // end of stream
+	}
+	bytes = llmin(bytes, stream->mSize - stream->mOffset);
+	memcpy(buffer, stream->mData + stream->mOffset, bytes);
+	stream->mOffset += bytes;
+	return bytes;
+}
+
+static OPJ_SIZE_T stream_write(void* buffer, OPJ_SIZE_T bytes, void* user_data)
+{
+	LLJ2CStreamBuffer* stream = (LLJ2CStreamBuffer*)user_data;
+	std::vector<U8>& output = *stream->mOutput;
+	if (stream->mOffset + bytes > output.size())
+	{
+		output.resize(stream->mOffset + bytes);
+	}
+	memcpy(output.data() + stream->mOffset, buffer, bytes);
+	stream->mOffset += bytes;
+	return bytes;
+}
+
+static OPJ_BOOL stream_seek(OPJ_OFF_T offset, void* user_data)
+{
+	LLJ2CStreamBuffer* stream = (LLJ2CStreamBuffer*)user_data;
+	if (offset < 0)
+	{
+		return OPJ_FALSE;
+	}
+	if (stream->mOutput)
+	{
+		if ((size_t)offset > stream->mOutput->size())
+		{
+			stream->mOutput->resize((size_t)offset);
+		}
+	}
+	else if ((OPJ_SIZE_T)offset > stream->mSize)
+	{
+		return OPJ_FALSE;
+	}
+	stream->mOffset = (OPJ_SIZE_T)offset;
+	return OPJ_TRUE;
+}
+
+static OPJ_OFF_T stream_skip(OPJ_OFF_T bytes, void* user_data)
+{
+	LLJ2CStreamBuffer* stream = (LLJ2CStreamBuffer*)user_data;
+	OPJ_OFF_T offset = llmax((OPJ_OFF_T)stream->mOffset + bytes, (OPJ_OFF_T)0);
+	if (!stream->mOutput)
+	{
+		offset = llmin(offset, (OPJ_OFF_T)stream->mSize);
+	}
+	OPJ_OFF_T skipped = offset - (OPJ_OFF_T)stream->mOffset;
+	if (bytes && !skipped)
+	{
+		return (OPJ_OFF_T)-1;
+	}
+	stream_seek(offset, user_data);
+	return skipped;
+}
+
+static opj_stream_t* create_stream(LLJ2CStreamBuffer& buffer, bool input)
+{
+	opj_stream_t* stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, input ? OPJ_TRUE : OPJ_FALSE);
+	if (stream)
+	{
+		opj_stream_set_user_data(stream, &buffer, nullptr);
+		if (input)
+		{
+			opj_stream_set_user_data_length(stream, buffer.mSize);
+			opj_stream_set_read_function(stream, stream_read);
+		}
+		else
+		{
+			opj_stream_set_write_function(stream, stream_write);
+		}
+		opj_stream_set_skip_function(stream, stream_skip);
+		opj_stream_set_seek_function(stream, stream_seek);
+	}
+	return stream;
+}
+
+static void set_message_handlers(opj_codec_t* codec)
+{
+	opj_set_error_handler(codec, error_callback, nullptr);
+	opj_set_warning_handler(codec, warning_callback, nullptr);
+	opj_set_info_handler(codec, info_callback, nullptr);
+}
+
+// How many threads one decode gets, see LLImageJ2C::setDecodeThreads()
+static S32 decode_threads_for(S32 pixels)
+{
+	S32 threads = LLImageJ2C::getDecodeThreads();
+	if (threads <= 0)
+	{
+		// Small textures are better spread over the decode threads whole
+		const S32 PIXELS_PER_THREAD = 512 * 512;
+		threads = llclamp(pixels / PIXELS_PER_THREAD, 1, (S32)llmax(std::thread::hardware_concurrency(), 1U));
+	}
+	return threads;
+}
+
+// Bands of multi-tile images are decoded on threads kept from one decode to
+// the next, started the first time one needs them
+static LLThreadTeam& band_threads()
+{
+	static LLThreadTeam team;
+	return team;
+}
+
+// A horizontal run of tile rows, decoded by its own codec so that runs of a
+// multi-tile image can be decoded side by side.
+struct LLJ2CBand
+{
+	S32 mY0;	// reference grid rows
+	S32 mY1;
+	bool mSubArea;
+	S32 mThreads;
+	opj_image_t* mImage;
+	bool mDecoded;
+};
+
+// From 2.5 on the decoder rejects truncated codestreams unless told not to,
+// and a texture still downloading is one.
+static bool setup_decoder(opj_codec_t* decoder, opj_dparameters_t* parameters)
+{
+	if (!opj_setup_decoder(decoder, parameters))
+	{
+		return false;
+	}
+#if LL_OPENJPEG2_STRICT_MODE
+	opj_decoder_set_strict_mode(decoder, OPJ_FALSE);
+#endif
+	return true;
+}
+
+static void decode_band(const LLJ2CStreamBuffer& data, S32 discard_level, S32 x0, S32 x1, LLJ2CBand& band)
+{
+	LLJ2CStreamBuffer buffer = data;
+	opj_dparameters_t parameters;
+	opj_set_default_decoder_parameters(&parameters);
+	parameters.cp_reduce = discard_level;
+
+	opj_codec_t* decoder = opj_create_decompress(OPJ_CODEC_J2K);
+	set_message_handlers(decoder);
+	opj_stream_t* stream = nullptr;
+
+	band.mImage = nullptr;
+	band.mDecoded = false;
+	if (setup_decoder(decoder, &parameters))
+	{
+#if LL_OPENJPEG2_THREADS
+		if (band.mThreads > 1)
+		{
+			opj_codec_set_threads(decoder, band.mThreads);
+		}
+#endif
+		stream = create_stream(buffer, true);
+		band.mDecoded = stream
+			&& opj_read_header(stream, decoder, &band.mImage)
+			&& (!band.mSubArea || opj_set_decode_area(decoder, band.mImage, x0, band.mY0, x1, band.mY1))
+			&& opj_decode(decoder, stream, band.mImage);
+		// No opj_end_decompress(), a partial stream never gets to the end marker
+	}
+
+	if (stream)
+	{
+		opj_stream_destroy(stream);
+	}
+	opj_destroy_codec(decoder);
+}
+#endif
+
+LLImageJ2COJ::LLImageJ2COJ()
+	: LLImageJ2CImpl()
+{
+}
+
+
+LLImageJ2COJ::~LLImageJ2COJ()
+{
+}
+
+bool LLImageJ2COJ::initDecode(LLImageJ2C &base, LLImageRaw &raw_image, int discard_level, int* region)
+{
+	// No specific implementation for this method in the OpenJpeg case
+	return false;
+}
+
+bool LLImageJ2COJ::initEncode(LLImageJ2C &base, LLImageRaw &raw_image, int blocks_size, int precincts_size, int levels)
+{
+	// No specific implementation for this method in the OpenJpeg case
+	return false;
+}
+
+#if LL_OPENJPEG2
+bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count)
+{
+	/* Extract metadata */
+	/* ---------------- */
+	read_comment(base, raw_image);
+
+	const U8* c_data = base.getData();
+	const S32 c_size = base.getDataSize();
+	if (c_size < 42 || !isSOC(c_data) || !isSIZ(c_data + 2))
+	{
+		LL_DEBUGS("Texture") << "ERROR -> decodeImpl: no image header!" << LL_ENDL;
+		base.decodeFailed();
+		return true; // done
+	}
+
+	// Image area and tile grid, straight from the SIZ segment
+	const S32 x1 = extractLong4(c_data, 8);
+	const S32 y1 = extractLong4(c_data, 12);
+	const S32 x0 = extractLong4(c_data, 16);
+	const S32 y0 = extractLong4(c_data, 20);
+	const S32 tile_height = extractLong4(c_data, 28);
+	const S32 tile_y0 = extractLong4(c_data, 36);
+
+	// Only the resolutions up to the discard level are decoded
+	const S32 discard_level = base.getRawDiscardLevel();
+	const S32 width = ceildivpow2(x1 - x0, discard_level);
+	const S32 height = ceildivpow2(y1 - y0, discard_level);
+	if (width <= 0 || height <= 0 || tile_height <= 0 || tile_y0 > y0)
+	{
+		LL_DEBUGS("Texture") << "ERROR -> decodeImpl: bad image header!" << LL_ENDL;
+		base.decodeFailed();
+		return true; // done
+	}
+
+	// Tile rows are split over the threads when there are several, each
+	// band then decoding on one. Textures are usually a single tile, in
+	// which case its code-blocks are split over OpenJPEG's threads instead.
+	// The two are never stacked.
+	const S32 threads = decode_threads_for(width * height);
+	const S32 first_row = (y0 - tile_y0) / tile_height;
+	const S32 tile_rows = (y1 - tile_y0 + tile_height - 1) / tile_height - first_row;
+	const S32 band_count = llclamp(tile_rows, 1, threads);
+
+	std::vector<LLJ2CBand> bands(band_count);
+	for (S32 i = 0; i < band_count; ++i)
+	{
+		LLJ2CBand& band = bands[i];
+		band.mY0 = llmax(y0, tile_y0 + (first_row + tile_rows * i / band_count) * tile_height);
+		band.mY1 = llmin(y1, tile_y0 + (first_row + tile_rows * (i + 1) / band_count) * tile_height);
+		band.mSubArea = band_count > 1;
+		band.mThreads = band_count > 1 ? 1 : threads;
+		band.mImage = nullptr;
+		band.mDecoded = false;
+	}
+
+	const LLJ2CStreamBuffer data = { c_data, (OPJ_SIZE_T)c_size, 0, nullptr };
+	auto decode_part = [&](U32 part)
+	{
+		decode_band(data, discard_level, x0, x1, bands[part]);
+	};
+	if (band_count > 1)
+	{
+		band_threads().run(band_count, decode_part);
+	}
+	else
+	{
+		decode_part(0);
+	}
+
+	// sometimes we get bad data out of the cache - check to see if the decode succeeded
+	bool failed = false;
+	for (const LLJ2CBand& band : bands)
+	{
+		const opj_image_t* image = band.mImage;
+		failed = failed || !band.mDecoded || !image || !image->numcomps;
+		for (U32 i = 0; !failed && i < image->numcomps; ++i)
+		{
+			// if we didn't get the discard level we're expecting, fail
+			failed = ((S32)image->comps[i].factor != discard_level) || !image->comps[i].data;
+		}
+	}
+	if (!failed && bands[0].mImage->numcomps <= (OPJ_UINT32)first_channel)
+	{
+		LL_WARNS() << "trying to decode more channels than are present in image: numcomps: " << bands[0].mImage->numcomps << " first_channel: " << first_channel << LL_ENDL;
+		failed = true;
+	}
+
+	S32 channels = 0;
+	U8* rawp = nullptr;
+	if (!failed)
+	{
+		channels = llmin((S32)bands[0].mImage->numcomps - first_channel, max_channel_count);
+		raw_image.resize(width, height, channels);
+		rawp = raw_image.getData();
+		if (!rawp)
+		{
+			base.setLastError("Memory error");
+		}
+	}
+	else
+	{
+		LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image!" << LL_ENDL;
+	}
+
+	// Copy image data into our raw image format (instead of the separate
+	// channel format), bottom row first. Each band starts at its own row.
+	for (const LLJ2CBand& band : bands)
+	{
+		const opj_image_t* image = band.mImage;
+		if (rawp)
+		{
+			const S32 row_offset = ceildivpow2(band.mY0, discard_level) - ceildivpow2(y0, discard_level);
+			for (S32 comp = first_channel, dest = 0; comp < first_channel + channels; comp++, dest++)
+			{
+				const opj_image_comp_t& component = image->comps[comp];
+				const S32 comp_width = llmin((S32)component.w, width);
+				const S32 comp_height = llmin((S32)component.h, height - row_offset);
+				for (S32 y = 0; y < comp_height; y++)
+				{
+					const OPJ_INT32* src = component.data + y * component.w;
+					U8* dst = rawp + (height - 1 - row_offset - y) * width * channels + dest;
+					for (S32 x = 0; x < comp_width; x++)
+					{
+						*dst = (U8)src[x];
+						dst += channels;
+					}
+				}
+			}
+		}
+		if (image)
+		{
+			opj_image_destroy(band.mImage);
+		}
+	}
+
+	if (!rawp)
+	{
+		base.decodeFailed();
+	}
+	return true; // done
+}
+#else
+bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decode_time, S32 first_channel, S32 max_channel_count)
+{
+	LLTimer decode_timer;
+
+	/* Extract metadata */
+	/* ---------------- */
+	read_comment(base, raw_image);
+
 	opj_dparameters_t parameters;	/* decompression parameters */
 	opj_event_mgr_t event_mgr = { };		/* event manager */
 	opj_image_t *image = nullptr;
@@ -304,12 +686,14 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 
 	return true; // done
 }
+#endif
 
 
 bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, const char* comment_text, F32 encode_time, bool reversible)
 {
 	const S32 MAX_COMPS = 5;
 	opj_cparameters_t parameters;	/* compression parameters */
+#if !LL_OPENJPEG2
 	opj_event_mgr_t event_mgr = { };		/* event manager */
 
 
@@ -320,6 +704,7 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
 	event_mgr.error_handler = error_callback;
 	event_mgr.warning_handler = warning_callback;
 	event_mgr.info_handler = info_callback;
+#endif
 
 	/* set encoding parameters to default values */
 	opj_set_default_encoder_parameters(&parameters);
@@ -359,7 +744,11 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
 	//
 	// Fill in the source image from our raw image
 	//
+#if LL_OPENJPEG2
+	OPJ_COLOR_SPACE color_space = OPJ_CLRSPC_SRGB;
+#else
 	OPJ_COLOR_SPACE color_space = CLRSPC_SRGB;
+#endif
 	opj_image_cmptparm_t cmptparm[MAX_COMPS];
 	opj_image_t * image = nullptr;
 	S32 numcomps = raw_image.getComponents();
@@ -404,6 +793,39 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
 	/* encode the destination image */
 	/* ---------------------------- */
 
+#if LL_OPENJPEG2
+	std::vector<U8> output;
+	LLJ2CStreamBuffer buffer = { nullptr, 0, 0, &output };
+	opj_stream_t* stream = nullptr;
+
+	/* get a J2K compressor handle */
+	opj_codec_t* encoder = opj_create_compress(OPJ_CODEC_J2K);
+	set_message_handlers(encoder);
+
+	bool bSuccess = opj_setup_encoder(encoder, &parameters, image)
+		&& (stream = create_stream(buffer, false))
+		&& opj_start_compress(encoder, image, stream)
+		&& opj_encode(encoder, stream)
+		&& opj_end_compress(encoder, stream);
+
+	if (stream)
+	{
+		opj_stream_destroy(stream);
+	}
+	opj_destroy_codec(encoder);
+	if(parameters.cp_matrice) free(parameters.cp_matrice);
+	opj_image_destroy(image);
+
+	if (!bSuccess)
+	{
+		LL_DEBUGS("Texture") << "Failed to encode image." << LL_ENDL;
+		return false;
+	}
+
+	base.copyData(output.data(), output.size());
+	base.updateData(); // set width, height
+	return true;
+#else
 	int codestream_length;
 	opj_cio_t *cio = nullptr;
 
@@ -446,33 +868,7 @@ bool LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
 	/* free image data */
 	opj_image_destroy(image);
 	return true;
-}
-
-inline S32 extractLong4( U8 const *aBuffer, int nOffset )
-{
-	S32 ret = aBuffer[ nOffset ] << 24;
-	ret += aBuffer[ nOffset + 1 ] << 16;
-	ret += aBuffer[ nOffset + 2 ] << 8;
-	ret += aBuffer[ nOffset + 3 ];
-	return ret;
-}
-
-inline S32 extractShort2( U8 const *aBuffer, int nOffset )
-{
-	S32 ret = aBuffer[ nOffset ] << 8;
-	ret += aBuffer[ nOffset + 1 ];
-
-	return ret;
-}
-
-inline bool isSOC( U8 const *aBuffer )
-{
-	return aBuffer[ 0 ] == 0xFF && aBuffer[ 1 ] == 0x4F;
-}
-
-inline bool isSIZ( U8 const *aBuffer )
-{
-	return aBuffer[ 0 ] == 0xFF && aBuffer[ 1 ] == 0x51;
+#endif
 }
 
 bool getMetadataFast( LLImageJ2C &aImage, S32 &aW, S32 &aH, S32 &aComps )
@@ -526,6 +922,37 @@ bool LLImageJ2COJ::getMetadata(LLImageJ2C &base)
 
 	// Do it the old and slow way, decode the image with openjpeg
 
+#if LL_OPENJPEG2
+	// Only the main header is read
+	opj_dparameters_t parameters;
+	opj_set_default_decoder_parameters(&parameters);
+
+	LLJ2CStreamBuffer buffer = { base.getData(), (OPJ_SIZE_T)base.getDataSize(), 0, nullptr };
+	opj_codec_t* decoder = opj_create_decompress(OPJ_CODEC_J2K);
+	set_message_handlers(decoder);
+	opj_stream_t* stream = nullptr;
+	opj_image_t* image = nullptr;
+
+	bool success = setup_decoder(decoder, &parameters)
+		&& (stream = create_stream(buffer, true))
+		&& opj_read_header(stream, decoder, &image);
+
+	if (stream)
+	{
+		opj_stream_destroy(stream);
+	}
+	opj_destroy_codec(decoder);
+
+	if (!success || !image)
+	{
+		LL_WARNS() << "ERROR -> getMetadata: failed to decode image!" << LL_ENDL;
+		if (image)
+		{
+			opj_image_destroy(image);
+		}
+		return false;
+	}
+#else
 	opj_dparameters_t parameters;	/* decompression parameters */
 	opj_event_mgr_t event_mgr = { };		/* event manager */
 	opj_image_t *image = nullptr;
@@ -581,6 +1008,7 @@ bool LLImageJ2COJ::getMetadata(LLImageJ2C &base)
 		LL_WARNS() << "ERROR -> getMetadata: failed to decode image!" << LL_ENDL;
 		return false;
 	}
+#endif
 
 	// Copy image data into our raw image format (instead of the separate channel format
 
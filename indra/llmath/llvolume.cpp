@@ -47,6 +47,7 @@
 #include "llvolumeoctree.h"
 #include "llstl.h"
 #include "llsdserialize.h"
+#include "llmemorystream.h"
 #include "llvector4a.h"
 #include "llmatrix4a.h"
 #include "lltimer.h"
@@ -2355,20 +2356,631 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 	return retval;
 }
 
+// The parts of one face of a mesh LOD block. The arrays point into the
+// block, or into the LLSD it was parsed into.
+struct LLMeshFaceData
+{
+	LLMeshFaceData()
+	:	mPosition(nullptr), mPositionSize(0),
+		mNormal(nullptr), mNormalSize(0),
+		mTexCoord(nullptr), mTexCoordSize(0),
+		mIndices(nullptr), mIndicesSize(0),
+		mWeights(nullptr), mWeightsSize(0),
+		mHasWeights(false),
+		mNoGeometry(false)
+	{
+	}
+
+	const U8* mPosition;
+	U32 mPositionSize;
+	const U8* mNormal;
+	U32 mNormalSize;
+	const U8* mTexCoord;
+	U32 mTexCoordSize;
+	const U8* mIndices;
+	U32 mIndicesSize;
+	const U8* mWeights;
+	U32 mWeightsSize;
+	bool mHasWeights;
+	bool mNoGeometry;
+
+	LLVector3 mMinPos;
+	LLVector3 mMaxPos;
+	LLVector2 mMinTexCoord;
+	LLVector2 mMaxTexCoord;
+};
+
+namespace
+{
+	// Walks an inflated mesh LOD block, binary LLSD holding an array of
+	// face maps, in place. Binaries are referenced rather than copied and
+	// no LLSD is built. Anything laid out differently from what the mesh
+	// uploader writes makes read() fail, so the caller can hand the block
+	// to the LLSD parser instead.
+	class LLMeshLODReader
+	{
+	public:
+		LLMeshLODReader(const U8* data, U32 size)
+		:	mPos(data),
+			mEnd(data + size)
+		{
+		}
+
+		bool read(std::vector<LLMeshFaceData>& faces)
+		{
+			// Tolerate the newline left of a deprecated header
+			while (mPos < mEnd && isspace(*mPos))
+			{
+				++mPos;
+			}
+
+			U32 face_count = 0;
+			if (!readTag('[') || !readU32(face_count) || face_count > (U32)(mEnd - mPos))
+			{
+				return false;
+			}
+			faces.resize(face_count);
+			for (LLMeshFaceData& face : faces)
+			{
+				if (!readFace(face))
+				{
+					return false;
+				}
+			}
+			return readTag(']');
+		}
+
+	private:
+		enum
+		{
+			KEY_POSITION = 1 << 0,
+			KEY_NORMAL = 1 << 1,
+			KEY_TEXCOORD = 1 << 2,
+			KEY_INDICES = 1 << 3,
+			KEY_WEIGHTS = 1 << 4,
+			KEY_POSITION_DOMAIN = 1 << 5,
+			KEY_TEXCOORD_DOMAIN = 1 << 6,
+			KEY_NO_GEOMETRY = 1 << 7
+		};
+
+		// Keys the LLSD parser would find as well, a repeated one keeps its
+		// first value there, which isn't worth copying here.
+		bool readFace(LLMeshFaceData& face)
+		{
+			U32 key_count = 0;
+			if (!readTag('{') || !readU32(key_count))
+			{
+				return false;
+			}
+
+			U32 seen = 0;
+			for (U32 i = 0; i < key_count; ++i)
+			{
+				const char* key = nullptr;
+				U32 key_size = 0;
+				if (!readKey(key, key_size))
+				{
+					return false;
+				}
+
+				U32 flag = keyFlag(key, key_size);
+				if (seen & flag)
+				{
+					return false;
+				}
+				seen |= flag;
+
+				bool ok = true;
+				switch (flag)
+				{
+				case KEY_POSITION:
+					ok = readBinary(face.mPosition, face.mPositionSize);
+					break;
+				case KEY_NORMAL:
+					ok = readBinary(face.mNormal, face.mNormalSize);
+					break;
+				case KEY_TEXCOORD:
+					ok = readBinary(face.mTexCoord, face.mTexCoordSize);
+					break;
+				case KEY_INDICES:
+					ok = readBinary(face.mIndices, face.mIndicesSize);
+					break;
+				case KEY_WEIGHTS:
+					face.mHasWeights = true;
+					ok = readBinary(face.mWeights, face.mWeightsSize);
+					break;
+				case KEY_POSITION_DOMAIN:
+					ok = readDomain(face.mMinPos.mV, face.mMaxPos.mV, 3);
+					break;
+				case KEY_TEXCOORD_DOMAIN:
+					ok = readDomain(face.mMinTexCoord.mV, face.mMaxTexCoord.mV, 2);
+					break;
+				case KEY_NO_GEOMETRY:
+					face.mNoGeometry = true;
+					ok = skip(1);
+					break;
+				default:
+					ok = skip(1);
+					break;
+				}
+				if (!ok)
+				{
+					return false;
+				}
+			}
+			return readTag('}');
+		}
+
+		static U32 keyFlag(const char* key, U32 size)
+		{
+			static const std::pair<const char*, U32> KEYS[] =
+			{
+				{ "Position", KEY_POSITION },
+				{ "Normal", KEY_NORMAL },
+				{ "TexCoord0", KEY_TEXCOORD },
+				{ "TriangleList", KEY_INDICES },
+				{ "Weights", KEY_WEIGHTS },
+				{ "PositionDomain", KEY_POSITION_DOMAIN },
+				{ "TexCoord0Domain", KEY_TEXCOORD_DOMAIN },
+				{ "NoGeometry", KEY_NO_GEOMETRY }
+			};
+			for (const auto& entry : KEYS)
+			{
+				if (strlen(entry.first) == size && !memcmp(entry.first, key, size))
+				{
+					return entry.second;
+				}
+			}
+			return 0;
+		}
+
+		bool readTag(U8 tag)
+		{
+			if (mPos < mEnd && *mPos == tag)
+			{
+				++mPos;
+				return true;
+			}
+			return false;
+		}
+
+		bool readU32(U32& value)
+		{
+			if (mEnd - mPos < 4)
+			{
+				return false;
+			}
+			// Network byte order
+			value = ((U32) mPos[0] << 24) | ((U32) mPos[1] << 16) | ((U32) mPos[2] << 8) | mPos[3];
+			mPos += 4;
+			return true;
+		}
+
+		// Size and start of a sized value, skipped over
+		bool readSized(const U8*& data, U32& size)
+		{
+			if (!readU32(size) || size > (U32)(mEnd - mPos))
+			{
+				return false;
+			}
+			data = mPos;
+			mPos += size;
+			return true;
+		}
+
+		bool readKey(const char*& key, U32& size)
+		{
+			const U8* data = nullptr;
+			if (!readTag('k') || !readSized(data, size))
+			{
+				return false;
+			}
+			key = (const char*)data;
+			return true;
+		}
+
+		bool readBinary(const U8*& data, U32& size)
+		{
+			return readTag('b') && readSized(data, size);
+		}
+
+		bool readNumber(F32& value)
+		{
+			if (readTag('r'))
+			{
+				if (mEnd - mPos < 8)
+				{
+					return false;
+				}
+				U64 bits = 0;
+				for (S32 i = 0; i < 8; ++i)
+				{
+					bits = (bits << 8) | *mPos++;
+				}
+				F64 real;
+				memcpy(&real, &bits, sizeof(real));
+				value = (F32) real;
+				return true;
+			}
+			U32 integer = 0;
+			if (readTag('i') && readU32(integer))
+			{
+				value = (F32)(S32)integer;
+				return true;
+			}
+			return false;
+		}
+
+		// { "Min":[...], "Max":[...] }, count numbers each
+		bool readDomain(F32* min, F32* max, U32 count)
+		{
+			U32 key_count = 0;
+			if (!readTag('{') || !readU32(key_count) || key_count != 2)
+			{
+				return false;
+			}
+			bool have_min = false;
+			bool have_max = false;
+			for (U32 i = 0; i < key_count; ++i)
+			{
+				const char* key = nullptr;
+				U32 key_size = 0;
+				if (!readKey(key, key_size) || key_size != 3)
+				{
+					return false;
+				}
+				F32* out = nullptr;
+				if (!memcmp(key, "Min", 3) && !have_min)
+				{
+					out = min;
+					have_min = true;
+				}
+				else if (!memcmp(key, "Max", 3) && !have_max)
+				{
+					out = max;
+					have_max = true;
+				}
+				U32 size = 0;
+				if (!out || !readTag('[') || !readU32(size) || size != count)
+				{
+					return false;
+				}
+				for (U32 j = 0; j < count; ++j)
+				{
+					if (!readNumber(out[j]))
+					{
+						return false;
+					}
+				}
+				if (!readTag(']'))
+				{
+					return false;
+				}
+			}
+			return readTag('}');
+		}
+
+		// Skips one value of any type, nesting no deeper than the faces do.
+		bool skip(S32 depth)
+		{
+			if (mPos >= mEnd || depth > MAX_SKIP_DEPTH)
+			{
+				return false;
+			}
+			const U8* data = nullptr;
+			U32 size = 0;
+			switch (*mPos++)
+			{
+			case '!':
+			case '0':
+			case '1':
+				return true;
+			case 'i':
+				return readU32(size);
+			case 'r':
+			case 'd':
+				return advance(8);
+			case 'u':
+				return advance(16);
+			case 's':
+			case 'l':
+			case 'b':
+				return readSized(data, size);
+			case '[':
+				if (!readU32(size))
+				{
+					return false;
+				}
+				for (U32 i = 0; i < size; ++i)
+				{
+					if (!skip(depth + 1))
+					{
+						return false;
+					}
+				}
+				return readTag(']');
+			case '{':
+				if (!readU32(size))
+				{
+					return false;
+				}
+				for (U32 i = 0; i < size; ++i)
+				{
+					const char* key = nullptr;
+					U32 key_size = 0;
+					if (!readKey(key, key_size) || !skip(depth + 1))
+					{
+						return false;
+					}
+				}
+				return readTag('}');
+			default:
+				return false;
+			}
+		}
+
+		bool advance(U32 count)
+		{
+			if ((U32)(mEnd - mPos) < count)
+			{
+				return false;
+			}
+			mPos += count;
+			return true;
+		}
+
+		enum { MAX_SKIP_DEPTH = 8 };
+
+		const U8* mPos;
+		const U8* mEnd;
+	};
+
+	inline U16 read_u16(const U8* p)
+	{
+		U16 value;
+		memcpy(&value, p, sizeof(U16));
+		return value;
+	}
+
+	// Four U16 at p, unaligned, as floats in x, y, z and w
+	inline LLVector4a load_u16x4(const U8* p)
+	{
+		__m128i v = _mm_loadl_epi64((const __m128i*) p);
+		return LLVector4a(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128())));
+	}
+
+	// Three U16 at p as floats in x, y and z, w cleared. Reads a U16 past
+	// the last, so not for the last vertex of an array.
+	inline LLVector4a load_u16x3(const U8* p)
+	{
+		const __m128i mask = _mm_set_epi32(0, 0, 0x0000FFFF, -1);
+		__m128i v = _mm_and_si128(_mm_loadl_epi64((const __m128i*) p), mask);
+		return LLVector4a(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128())));
+	}
+
+	inline LLVector4a load_u16x3_last(const U8* p)
+	{
+		return LLVector4a((F32) read_u16(p), (F32) read_u16(p + 2), (F32) read_u16(p + 4));
+	}
+
+	// value / 65535 * range + min, as the mesh uploader quantized them
+	void dequantize_positions(LLVector4a* out, const U8* in, U32 count,
+							  const LLVector4a& min, const LLVector4a& range)
+	{
+		for (U32 j = 0; j < count; ++j)
+		{
+			out[j] = (j + 1 < count) ? load_u16x3(in) : load_u16x3_last(in);
+			out[j].div(65535.f);
+			out[j].mul(range);
+			out[j].add(min);
+			in += 6;
+		}
+	}
+
+	void dequantize_normals(LLVector4a* out, const U8* in, U32 count)
+	{
+		for (U32 j = 0; j < count; ++j)
+		{
+			out[j] = (j + 1 < count) ? load_u16x3(in) : load_u16x3_last(in);
+			out[j].div(65535.f);
+			out[j].mul(2.f);
+			out[j].sub(1.f);
+			in += 6;
+		}
+	}
+
+	// Two texture coordinates per LLVector4a
+	void dequantize_tex_coords(LLVector4a* out, const U8* in, U32 count,
+							   const LLVector4a& min, const LLVector4a& range)
+	{
+		for (U32 j = 0; j < count; j += 2)
+		{
+			if (j < count - 1)
+			{
+				*out = load_u16x4(in);
+			}
+			else
+			{
+				out->set((F32) read_u16(in), (F32) read_u16(in + 2), 0.f, 0.f);
+			}
+			in += 8;
+
+			out->div(65535.f);
+			out->mul(range);
+			out->add(min);
+			out++;
+		}
+	}
+
+	void unpack_weights(LLVolumeFace& face, const U8* weights, U32 size, U32 num_verts)
+	{
+		face.allocateWeights(num_verts);
+
+		U32 idx = 0;
+
+		U32 cur_vertex = 0;
+		while (idx < size && cur_vertex < num_verts)
+		{
+			const U8 END_INFLUENCES = 0xFF;
+			U8 joint = weights[idx++];
+
+			U32 cur_influence = 0;
+			LLVector4 wght(0,0,0,0);
+			U32 joints[4] = {0,0,0,0};
+			LLVector4 joints_with_weights(0,0,0,0);
+
+			while (joint != END_INFLUENCES && idx < size)
+			{
+				if (idx + 2 > size)
+				{
+					// truncated influence
+					idx = size + 1;
+					break;
+				}
+				U16 influence = weights[idx++];
+				influence |= ((U16) weights[idx++] << 8);
+
+				F32 w = llclamp((F32) influence / 65535.f, 0.001f, 0.999f);
+				wght.mV[cur_influence] = w;
+				joints[cur_influence] = joint;
+				cur_influence++;
+
+				if (cur_influence >= 4)
+				{
+					joint = END_INFLUENCES;
+				}
+				else if (idx < size)
+				{
+					joint = weights[idx++];
+				}
+				else
+				{
+					joint = END_INFLUENCES;
+				}
+			}
+			F32 wsum = wght.mV[VX] + wght.mV[VY] + wght.mV[VZ] + wght.mV[VW];
+			if (wsum <= 0.f)
+			{
+				wght = LLVector4(0.999f,0.f,0.f,0.f);
+			}
+			for (U32 k=0; k<4; k++)
+			{
+				F32 f_combined = (F32) joints[k] + wght[k];
+				joints_with_weights[k] = f_combined;
+				// Any weights we added above should wind up non-zero and applied to a specific bone.
+				// A failure here would indicate a floating point precision error in the math.
+				llassert((k >= cur_influence) || (f_combined - S32(f_combined) > 0.0f));
+			}
+			face.mWeights[cur_vertex].loadua(joints_with_weights.mV);
+
+			cur_vertex++;
+		}
+
+		if (cur_vertex != num_verts || idx != size)
+		{
+			LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
+		}
+	}
+}
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	//input stream is now pointing at a zlib compressed block of LLSD
+	std::vector<U8> in;
+	try
+	{
+		in.resize(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		LL_DEBUGS("MeshStreaming") << "Failed to allocate " << size << " bytes for LoD" << LL_ENDL;
+		return false;
+	}
+	is.read((char*) in.data(), size);
+
 	//decompress block
-	LLSD mdl;
-	U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, is, size);
+	std::vector<U8> block;
+	U32 uzip_result = LLUZipHelper::unzip(block, in.data(), size);
 	if (uzip_result != LLUZipHelper::ZR_OK)
 	{
 		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
 		return false;
 	}
-	
+
+	return unpackVolumeFaces(block.data(), block.size());
+}
+
+bool LLVolume::unpackVolumeFaces(const U8* data, U32 size)
+{
+	const U8* start = (const U8*) strip_deprecated_header((char*) data, size);
+
+	std::vector<LLMeshFaceData> faces;
+	LLMeshLODReader reader(start, size);
+	if (reader.read(faces))
+	{
+		return unpackMeshFaces(faces);
+	}
+
+	// Laid out in some way the reader doesn't expect, parse it as LLSD
+	const S32 MAX_LOD_DEPTH = 96;
+	LLSD mdl;
+	LLMemoryStream stream(start, size);
+	if (LLSDSerialize::fromBinary(mdl, stream, size, MAX_LOD_DEPTH) <= 0)
+	{
+		LL_DEBUGS("MeshStreaming") << "Failed to parse LLSD blob for LoD, will probably fetch from sim again." << LL_ENDL;
+		return false;
+	}
+	return unpackVolumeFaces(mdl);
+}
+
+bool LLVolume::unpackVolumeFaces(const LLSD& mdl)
+{
+	std::vector<LLMeshFaceData> faces(mdl.size());
+	for (U32 i = 0; i < faces.size(); ++i)
+	{
+		const LLSD& face_sd = mdl[i];
+		LLMeshFaceData& face = faces[i];
+
+		face.mNoGeometry = face_sd.has("NoGeometry");
+		if (face.mNoGeometry)
+		{
+			continue;
+		}
+
+		const LLSD::Binary& pos = face_sd["Position"].asBinary();
+		const LLSD::Binary& norm = face_sd["Normal"].asBinary();
+		const LLSD::Binary& tc = face_sd["TexCoord0"].asBinary();
+		const LLSD::Binary& idx = face_sd["TriangleList"].asBinary();
+		face.mPosition = pos.data();
+		face.mPositionSize = pos.size();
+		face.mNormal = norm.data();
+		face.mNormalSize = norm.size();
+		face.mTexCoord = tc.data();
+		face.mTexCoordSize = tc.size();
+		face.mIndices = idx.data();
+		face.mIndicesSize = idx.size();
+
+		face.mHasWeights = face_sd.has("Weights");
+		if (face.mHasWeights)
+		{
+			const LLSD::Binary& weights = face_sd["Weights"].asBinary();
+			face.mWeights = weights.data();
+			face.mWeightsSize = weights.size();
+		}
+
+		face.mMinPos.setValue(face_sd["PositionDomain"]["Min"]);
+		face.mMaxPos.setValue(face_sd["PositionDomain"]["Max"]);
+		LLSD tc_domain = face_sd["TexCoord0Domain"];
+		face.mMinTexCoord.setValue(tc_domain["Min"]);
+		face.mMaxTexCoord.setValue(tc_domain["Max"]);
+	}
+	return unpackMeshFaces(faces);
+}
+
+bool LLVolume::unpackMeshFaces(const std::vector<LLMeshFaceData>& faces)
+{
 	{
-		U32 face_count = mdl.size();
+		U32 face_count = faces.size();
 
 		if (face_count == 0)
 		{ //no faces unpacked, treat as failed decode
@@ -2381,8 +2993,9 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 		for (U32 i = 0; i < face_count; ++i)
 		{
 			LLVolumeFace& face = mVolumeFaces[i];
+			const LLMeshFaceData& data = faces[i];
 
-			if (mdl[i].has("NoGeometry"))
+			if (data.mNoGeometry)
 			{ //face has no geometry, continue
 				face.resizeIndices(3);
 				face.resizeVertices(1);
@@ -2393,184 +3006,58 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 				continue;
 			}
 
-			LLSD::Binary pos = mdl[i]["Position"];
-			LLSD::Binary norm = mdl[i]["Normal"];
-			LLSD::Binary tc = mdl[i]["TexCoord0"];
-			LLSD::Binary idx = mdl[i]["TriangleList"];
-
-			
-
 			//copy out indices
-			face.resizeIndices(idx.size()/2);
+			U32 count = data.mIndicesSize/2;
+			face.resizeIndices(count);
 			
-			if (idx.empty() || face.mNumIndices < 3)
+			if (!count || face.mNumIndices < 3)
 			{ //why is there an empty index list?
 				LL_WARNS() << "Empty face present! Face index: " << i << " Total: " << face_count << LL_ENDL;
 				continue;
 			}
 
-			U16* indices = (U16*) &(idx[0]);
-			U32 count = idx.size()/2;
-			for (U32 j = 0; j < count; ++j)
-			{
-				face.mIndices[j] = indices[j];
-			}
+			memcpy(face.mIndices, data.mIndices, count * sizeof(U16));
 
 			//copy out vertices
-			U32 num_verts = pos.size()/(3*2);
+			U32 num_verts = data.mPositionSize/(3*2);
 			face.resizeVertices(num_verts);
 
-			LLVector3 minp;
-			LLVector3 maxp;
-			LLVector2 min_tc; 
-			LLVector2 max_tc; 
-		
-			minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-			maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
 			LLVector4a min_pos, max_pos;
-			min_pos.load3(minp.mV);
-			max_pos.load3(maxp.mV);
-
-			min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-			max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+			min_pos.load3(data.mMinPos.mV);
+			max_pos.load3(data.mMaxPos.mV);
 
 			LLVector4a pos_range;
 			pos_range.setSub(max_pos, min_pos);
-			LLVector2 tc_range2 = max_tc - min_tc;
+			LLVector2 tc_range2 = data.mMaxTexCoord - data.mMinTexCoord;
 
 			LLVector4a tc_range;
 			tc_range.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
+			const LLVector2& min_tc = data.mMinTexCoord;
 			LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
 
-			LLVector4a* pos_out = face.mPositions;
-			LLVector4a* norm_out = face.mNormals;
-			LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
+			dequantize_positions(face.mPositions, data.mPosition, num_verts, min_pos, pos_range);
 
+			if (data.mNormalSize >= num_verts*3*2)
 			{
-				U16* v = (U16*) &(pos[0]);
-				for (U32 j = 0; j < num_verts; ++j)
-				{
-					pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
-					pos_out->div(65535.f);
-					pos_out->mul(pos_range);
-					pos_out->add(min_pos);
-					pos_out++;
-					v += 3;
-				}
-
+				dequantize_normals(face.mNormals, data.mNormal, num_verts);
 			}
-
+			else
 			{
-				if (!norm.empty())
-				{
-					U16* n = (U16*) &(norm[0]);
-					for (U32 j = 0; j < num_verts; ++j)
-					{
-						norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
-						norm_out->div(65535.f);
-						norm_out->mul(2.f);
-						norm_out->sub(1.f);
-						norm_out++;
-						n += 3;
-					}
-				}
-				else
-				{
-					memset(norm_out, 0, sizeof(LLVector4a)*num_verts);
-				}
+				memset(face.mNormals, 0, sizeof(LLVector4a)*num_verts);
 			}
 
+			if (data.mTexCoordSize >= num_verts*2*2)
 			{
-				if (!tc.empty())
-				{
-					U16* t = (U16*) &(tc[0]);
-					for (U32 j = 0; j < num_verts; j+=2)
-					{
-						if (j < num_verts-1)
-						{
-							tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
-						}
-						else
-						{
-							tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
-						}
-
-						t += 4;
-
-						tc_out->div(65535.f);
-						tc_out->mul(tc_range);
-						tc_out->add(min_tc4);
-
-						tc_out++;
-					}
-				}
-				else
-				{
-					memset(tc_out, 0, sizeof(LLVector2)*num_verts);
-				}
+				dequantize_tex_coords((LLVector4a*) face.mTexCoords, data.mTexCoord, num_verts, min_tc4, tc_range);
 			}
-
-			if (mdl[i].has("Weights"))
+			else
 			{
-				face.allocateWeights(num_verts);
-
-				LLSD::Binary weights = mdl[i]["Weights"];
-
-				U32 idx = 0;
-
-				U32 cur_vertex = 0;
-				while (idx < weights.size() && cur_vertex < num_verts)
-				{
-					const U8 END_INFLUENCES = 0xFF;
-					U8 joint = weights[idx++];
-
-					U32 cur_influence = 0;
-					LLVector4 wght(0,0,0,0);
-                    U32 joints[4] = {0,0,0,0};
-					LLVector4 joints_with_weights(0,0,0,0);
-
-					while (joint != END_INFLUENCES && idx < weights.size())
-					{
-						U16 influence = weights[idx++];
-						influence |= ((U16) weights[idx++] << 8);
-
-						F32 w = llclamp((F32) influence / 65535.f, 0.001f, 0.999f);
-						wght.mV[cur_influence] = w;
-						joints[cur_influence] = joint;
-						cur_influence++;
-
-						if (cur_influence >= 4)
-						{
-							joint = END_INFLUENCES;
-						}
-						else
-						{
-							joint = weights[idx++];
-						}
-					}
-                    F32 wsum = wght.mV[VX] + wght.mV[VY] + wght.mV[VZ] + wght.mV[VW];
-                    if (wsum <= 0.f)
-                    {
-                        wght = LLVector4(0.999f,0.f,0.f,0.f);
-                    }
-                    for (U32 k=0; k<4; k++)
-                    {
-                        F32 f_combined = (F32) joints[k] + wght[k];
-                        joints_with_weights[k] = f_combined;
-                        // Any weights we added above should wind up non-zero and applied to a specific bone.
-                        // A failure here would indicate a floating point precision error in the math.
-                        llassert((k >= cur_influence) || (f_combined - S32(f_combined) > 0.0f));
-                    }
-					face.mWeights[cur_vertex].loadua(joints_with_weights.mV);
-
-					cur_vertex++;
-				}
+				memset(face.mTexCoords, 0, sizeof(LLVector2)*num_verts);
+			}
 
-				if (cur_vertex != num_verts || idx != weights.size())
-				{
-					LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
-				}
-					
+			if (data.mHasWeights)
+			{
+				unpack_weights(face, data.mWeights, data.mWeightsSize, num_verts);
 			}
 
 			// modifier flags?
@@ -2725,6 +3212,224 @@ bool LLVolume::cacheOptimize()
 	return true;
 }
 
+namespace
+{
+	// Layout of LLVolume::packDecodedFaces(), in host byte order:
+	//  DecodedHeader
+	//  DecodedFace[face count]
+	//  per face, each run starting on a DECODED_ALIGN boundary:
+	//   vertices, as LLVolumeFace::allocateVertices() lays out positions,
+	//   normals and texture coordinates in one buffer
+	//   weights, if any
+	//   indices
+	const U32 DECODED_MAGIC = 0x46444D4C; // "LMDF"
+	const U32 DECODED_VERSION = 1;
+	const size_t DECODED_ALIGN = 64;
+
+	struct DecodedHeader
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mFaceCount;
+		U32 mSize;		// of the whole block
+	};
+
+	struct DecodedFace
+	{
+		LLVector4a mExtents[3];		// min, max and center
+		LLVector2 mTexCoordExtents[2];
+		U32 mNumVertices;
+		U32 mNumIndices;
+		U32 mHasWeights;
+		U32 mOffset;	// of the positions, from the start of the block
+	};
+
+	size_t decoded_align(size_t size)
+	{
+		return (size + DECODED_ALIGN - 1) & ~(DECODED_ALIGN - 1);
+	}
+
+	// Bytes of the vertex buffer of a face, see LLVolumeFace::allocateVertices()
+	size_t decoded_vertex_size(size_t vertices)
+	{
+		return vertices * sizeof(LLVector4a) * 2 + ((vertices * sizeof(LLVector2) + 0xF) & ~0xF);
+	}
+
+	// Bytes taken by the runs of a face
+	size_t decoded_face_size(size_t vertices, size_t indices, bool weights)
+	{
+		return decoded_align(decoded_vertex_size(vertices))
+			+ (weights ? decoded_align(vertices * sizeof(LLVector4a)) : 0)
+			+ decoded_align(indices * sizeof(U16));
+	}
+}
+
+bool LLVolume::packDecodedFaces(std::vector<U8>& block) const
+{
+	if (mVolumeFaces.empty())
+	{
+		return false;
+	}
+
+	std::vector<DecodedFace> records(mVolumeFaces.size());
+	size_t offset = decoded_align(sizeof(DecodedHeader) + records.size() * sizeof(DecodedFace));
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const LLVolumeFace& face = mVolumeFaces[i];
+		DecodedFace& record = records[i];
+		for (S32 j = 0; j < 3; ++j)
+		{
+			record.mExtents[j] = face.mExtents[j];
+		}
+		record.mTexCoordExtents[0] = face.mTexCoordExtents[0];
+		record.mTexCoordExtents[1] = face.mTexCoordExtents[1];
+		record.mNumVertices = face.mNumVertices;
+		record.mNumIndices = face.mNumIndices;
+		record.mHasWeights = face.mWeights != nullptr;
+		record.mOffset = (U32)offset;
+		offset += decoded_face_size(face.mNumVertices, face.mNumIndices, record.mHasWeights);
+		if (offset > U32_MAX)
+		{
+			return false;
+		}
+	}
+
+	try
+	{
+		block.assign(offset, 0);
+	}
+	catch (const std::bad_alloc&)
+	{
+		LL_WARNS("LLVOLUME") << "Failed to allocate " << offset << " bytes for decoded faces" << LL_ENDL;
+		return false;
+	}
+
+	DecodedHeader header;
+	header.mMagic = DECODED_MAGIC;
+	header.mVersion = DECODED_VERSION;
+	header.mFaceCount = (U32)records.size();
+	header.mSize = (U32)offset;
+	memcpy(block.data(), &header, sizeof(DecodedHeader));
+	memcpy(block.data() + sizeof(DecodedHeader), records.data(), records.size() * sizeof(DecodedFace));
+
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const LLVolumeFace& face = mVolumeFaces[i];
+		const size_t vertices = face.mNumVertices;
+		U8* dst = block.data() + records[i].mOffset;
+		if (vertices)
+		{
+			// The face's buffer may hold more vertices than it uses, copy
+			// each array to where an exact fit puts it
+			memcpy(dst, face.mPositions, vertices * sizeof(LLVector4a));
+			memcpy(dst + vertices * sizeof(LLVector4a), face.mNormals, vertices * sizeof(LLVector4a));
+			memcpy(dst + vertices * sizeof(LLVector4a) * 2, face.mTexCoords, vertices * sizeof(LLVector2));
+			dst += decoded_align(decoded_vertex_size(vertices));
+			if (face.mWeights)
+			{
+				memcpy(dst, face.mWeights, vertices * sizeof(LLVector4a));
+				dst += decoded_align(vertices * sizeof(LLVector4a));
+			}
+		}
+		if (face.mNumIndices)
+		{
+			memcpy(dst, face.mIndices, face.mNumIndices * sizeof(U16));
+		}
+	}
+	return true;
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* block, size_t size)
+{
+	DecodedHeader header;
+	if (size < sizeof(DecodedHeader))
+	{
+		return false;
+	}
+	memcpy(&header, block, sizeof(DecodedHeader));
+	if (header.mMagic != DECODED_MAGIC
+		|| header.mVersion != DECODED_VERSION
+		|| header.mSize != size
+		|| !header.mFaceCount
+		|| header.mFaceCount > (size - sizeof(DecodedHeader)) / sizeof(DecodedFace))
+	{
+		return false;
+	}
+
+	// Records are copied out, block need not be aligned
+	std::vector<DecodedFace> records(header.mFaceCount);
+	memcpy(records.data(), block + sizeof(DecodedHeader), records.size() * sizeof(DecodedFace));
+
+	// Check every range before touching the faces
+	const size_t arrays_start = decoded_align(sizeof(DecodedHeader) + records.size() * sizeof(DecodedFace));
+	for (const DecodedFace& record : records)
+	{
+		if (record.mNumVertices > 65536
+			|| record.mNumIndices > size
+			|| record.mOffset < arrays_start
+			|| record.mOffset % DECODED_ALIGN
+			|| decoded_face_size(record.mNumVertices, record.mNumIndices, record.mHasWeights) > size - record.mOffset)
+		{
+			return false;
+		}
+	}
+
+	mVolumeFaces.clear();
+	mVolumeFaces.resize(records.size());
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const DecodedFace& record = records[i];
+		LLVolumeFace& face = mVolumeFaces[i];
+		const size_t vertices = record.mNumVertices;
+		const U8* src = block + record.mOffset;
+
+		if (!face.resizeVertices(record.mNumVertices)
+			|| !face.resizeIndices(record.mNumIndices)
+			|| (record.mHasWeights && !face.allocateWeights(record.mNumVertices)))
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+
+		if (vertices)
+		{
+			// Freshly sized, positions, normals and texture coordinates
+			// are one buffer laid out as in the block
+			memcpy(face.mPositions, src, decoded_vertex_size(vertices));
+			src += decoded_align(decoded_vertex_size(vertices));
+			if (record.mHasWeights)
+			{
+				memcpy(face.mWeights, src, vertices * sizeof(LLVector4a));
+				src += decoded_align(vertices * sizeof(LLVector4a));
+			}
+		}
+		if (record.mNumIndices)
+		{
+			memcpy(face.mIndices, src, record.mNumIndices * sizeof(U16));
+		}
+
+		for (S32 j = 0; j < face.mNumIndices; ++j)
+		{
+			if (face.mIndices[j] >= face.mNumVertices)
+			{
+				mVolumeFaces.clear();
+				return false;
+			}
+		}
+
+		for (S32 j = 0; j < 3; ++j)
+		{
+			face.mExtents[j] = record.mExtents[j];
+		}
+		face.mTexCoordExtents[0] = record.mTexCoordExtents[0];
+		face.mTexCoordExtents[1] = record.mTexCoordExtents[1];
+		face.mOptimized = TRUE;
+	}
+
+	mSculptLevel = 0;
+	return true;
+}
+
 
 S32	LLVolume::getNumFaces() const
 {
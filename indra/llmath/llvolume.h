@@ -40,6 +40,7 @@ template <class T> class LLOctreeNode;
 class LLVolumeFace;
 class LLVolume;
 class LLVolumeTriangle;
+struct LLMeshFaceData;
 
 #include "lluuid.h"
 #include "v4color.h"
@@ -1081,8 +1082,19 @@ private:
 protected:
 	BOOL generate();
 	void createVolumeFaces();
+	bool unpackMeshFaces(const std::vector<LLMeshFaceData>& faces);
 public:
+	// Reads a zlib compressed mesh LOD block of size bytes from is.
 	bool unpackVolumeFaces(std::istream& is, S32 size);
+	// Reads an inflated mesh LOD block in place, without building LLSD
+	// unless the block isn't laid out the way the mesh uploader writes it.
+	bool unpackVolumeFaces(const U8* data, U32 size);
+	bool unpackVolumeFaces(const LLSD& mdl);
+
+	// Decoded, cache optimized faces as one flat block, its arrays aligned
+	// so the block can be mapped from a file and copied straight back.
+	bool packDecodedFaces(std::vector<U8>& block) const;
+	bool unpackDecodedFaces(const U8* block, size_t size);
 
 	void setMeshAssetLoaded(BOOL loaded);
 	BOOL isMeshAssetLoaded();
@@ -0,0 +1,451 @@
+/**
+ * @file llvolume_test.cpp
+ * @brief Mesh LOD decoding test cases, and a benchmark of the direct decoder
+ *        against decoding through LLSD and reloading decoded faces.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvolume.h"
+
+#include "llpointer.h"
+#include "llsdserialize.h"
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	LLPointer<LLVolume> make_mesh_volume()
+	{
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		params.setSculptID(LLUUID::null, LL_SCULPT_TYPE_MESH);
+		return new LLVolume(params, 1.f);
+	}
+
+	LLSD::Binary random_u16s(std::mt19937& rng, U32 count, U32 limit)
+	{
+		LLSD::Binary data(count * sizeof(U16));
+		for (U32 i = 0; i < count; ++i)
+		{
+			U16 value = (U16)(rng() % limit);
+			memcpy(&data[i * sizeof(U16)], &value, sizeof(U16));
+		}
+		return data;
+	}
+
+	LLSD domain(F32 min, F32 max, S32 count)
+	{
+		LLSD result;
+		for (S32 i = 0; i < count; ++i)
+		{
+			result["Min"].append(min + i);
+			result["Max"].append(max + i);
+		}
+		return result;
+	}
+
+	// An LOD block laid out the way the mesh uploader writes one
+	LLSD make_lod(std::mt19937& rng, U32 faces, U32 vertices, bool weights)
+	{
+		LLSD lod;
+		for (U32 i = 0; i < faces; ++i)
+		{
+			LLSD face;
+			face["PositionDomain"] = domain(-0.5f, 0.75f, 3);
+			face["TexCoord0Domain"] = domain(0.f, 1.f, 2);
+			face["Position"] = random_u16s(rng, vertices * 3, 65536);
+			face["Normal"] = random_u16s(rng, vertices * 3, 65536);
+			face["TexCoord0"] = random_u16s(rng, vertices * 2, 65536);
+			// Every vertex used, or cacheOptimize leaves the unused ones
+			// behind as whatever the allocation held
+			LLSD::Binary indices = random_u16s(rng, vertices * 3, vertices);
+			for (U16 v = 0; v < vertices; ++v)
+			{
+				memcpy(&indices[v * sizeof(U16)], &v, sizeof(U16));
+			}
+			face["TriangleList"] = indices;
+			if (weights)
+			{
+				LLSD::Binary influences;
+				for (U32 v = 0; v < vertices; ++v)
+				{
+					influences.push_back((U8)(rng() % 32));
+					influences.push_back((U8)rng());
+					influences.push_back((U8)rng());
+					influences.push_back(0xFF);
+				}
+				face["Weights"] = influences;
+			}
+			lod.append(face);
+		}
+		return lod;
+	}
+
+	std::string compress(LLSD& lod)
+	{
+		return zip_llsd(lod);
+	}
+
+	bool unpack(LLVolume* volume, const std::string& block)
+	{
+		std::istringstream stream(block);
+		return volume->unpackVolumeFaces(stream, block.size());
+	}
+
+	bool unpack_through_llsd(LLVolume* volume, const std::string& block)
+	{
+		LLSD lod;
+		std::istringstream stream(block);
+		return LLUZipHelper::unzip_llsd(lod, stream, block.size()) == LLUZipHelper::ZR_OK
+			&& volume->unpackVolumeFaces(lod);
+	}
+
+	bool same_faces(const LLVolume* a, const LLVolume* b)
+	{
+		if (a->getNumVolumeFaces() != b->getNumVolumeFaces())
+		{
+			return false;
+		}
+		for (S32 i = 0; i < a->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& fa = a->getVolumeFace(i);
+			const LLVolumeFace& fb = b->getVolumeFace(i);
+			if (fa.mNumVertices != fb.mNumVertices
+				|| fa.mNumIndices != fb.mNumIndices
+				|| memcmp(fa.mPositions, fb.mPositions, fa.mNumVertices * sizeof(LLVector4a))
+				|| memcmp(fa.mNormals, fb.mNormals, fa.mNumVertices * sizeof(LLVector4a))
+				|| memcmp(fa.mTexCoords, fb.mTexCoords, fa.mNumVertices * sizeof(LLVector2))
+				|| memcmp(fa.mIndices, fb.mIndices, fa.mNumIndices * sizeof(U16))
+				|| !fa.mExtents[0].equals3(fb.mExtents[0])
+				|| !fa.mExtents[1].equals3(fb.mExtents[1])
+				|| (fa.mWeights == nullptr) != (fb.mWeights == nullptr)
+				|| (fa.mWeights && memcmp(fa.mWeights, fb.mWeights, fa.mNumVertices * sizeof(LLVector4a))))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	typedef std::array<F32, 8> corner_t;		// position, normal, texture coordinate
+	typedef std::array<corner_t, 3> triangle_t;
+
+	F32 u16_at(const LLSD::Binary& data, U32 i)
+	{
+		U16 value;
+		memcpy(&value, &data[i * sizeof(U16)], sizeof(U16));
+		return (F32) value;
+	}
+
+	// Rotated to start at its smallest corner, keeping the winding
+	triangle_t canonical(triangle_t triangle)
+	{
+		while (triangle[1] < triangle[0] || triangle[2] < triangle[0])
+		{
+			std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+		}
+		return triangle;
+	}
+
+	// Checks a decoded face against its LLSD, dequantized one component
+	// at a time the way LLVolume did before decoding moved to SSE:
+	// value / 65535 * range + min. Vertex cache optimization reorders
+	// vertices and triangles, so the triangles are compared as sets.
+	bool same_as_reference(const LLVolumeFace& face, const LLSD& face_sd)
+	{
+		const LLSD::Binary& pos = face_sd["Position"].asBinary();
+		const LLSD::Binary& norm = face_sd["Normal"].asBinary();
+		const LLSD::Binary& tc = face_sd["TexCoord0"].asBinary();
+		const LLSD::Binary& idx = face_sd["TriangleList"].asBinary();
+
+		LLVector3 min_pos, max_pos;
+		min_pos.setValue(face_sd["PositionDomain"]["Min"]);
+		max_pos.setValue(face_sd["PositionDomain"]["Max"]);
+		LLSD tc_domain = face_sd["TexCoord0Domain"];
+		LLVector2 min_tc, max_tc;
+		min_tc.setValue(tc_domain["Min"]);
+		max_tc.setValue(tc_domain["Max"]);
+
+		const U32 num_indices = idx.size() / sizeof(U16);
+		if ((U32) face.mNumVertices != pos.size() / (3 * sizeof(U16))
+			|| (U32) face.mNumIndices != num_indices)
+		{
+			return false;
+		}
+
+		std::vector<triangle_t> expected;
+		std::vector<triangle_t> decoded;
+		for (U32 i = 0; i + 2 < num_indices; i += 3)
+		{
+			triangle_t reference;
+			triangle_t actual;
+			for (U32 c = 0; c < 3; ++c)
+			{
+				const U32 v = (U32) u16_at(idx, i + c);
+				corner_t& ref = reference[c];
+				for (U32 k = 0; k < 3; ++k)
+				{
+					ref[k] = u16_at(pos, v * 3 + k) / 65535.f * (max_pos.mV[k] - min_pos.mV[k]) + min_pos.mV[k];
+					ref[3 + k] = u16_at(norm, v * 3 + k) / 65535.f * 2.f - 1.f;
+				}
+				for (U32 k = 0; k < 2; ++k)
+				{
+					ref[6 + k] = u16_at(tc, v * 2 + k) / 65535.f * (max_tc.mV[k] - min_tc.mV[k]) + min_tc.mV[k];
+				}
+
+				const U16 d = face.mIndices[i + c];
+				corner_t& out = actual[c];
+				for (U32 k = 0; k < 3; ++k)
+				{
+					out[k] = face.mPositions[d][k];
+					out[3 + k] = face.mNormals[d][k];
+				}
+				out[6] = face.mTexCoords[d].mV[VX];
+				out[7] = face.mTexCoords[d].mV[VY];
+			}
+			expected.push_back(canonical(reference));
+			decoded.push_back(canonical(actual));
+		}
+		std::sort(expected.begin(), expected.end());
+		std::sort(decoded.begin(), decoded.end());
+		return expected == decoded;
+	}
+
+	// Decodes every block each way, reps times, returns the seconds each took.
+	void benchmark(const std::vector<std::string>& blocks, S32 reps, F64& direct, F64& through_llsd, F64& reload)
+	{
+		LLTimer timer;
+		for (S32 rep = 0; rep < reps; ++rep)
+		{
+			for (const std::string& block : blocks)
+			{
+				LLPointer<LLVolume> volume = make_mesh_volume();
+				unpack(volume, block);
+			}
+		}
+		direct = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 rep = 0; rep < reps; ++rep)
+		{
+			for (const std::string& block : blocks)
+			{
+				LLPointer<LLVolume> volume = make_mesh_volume();
+				unpack_through_llsd(volume, block);
+			}
+		}
+		through_llsd = timer.getElapsedTimeF64();
+
+		std::vector<std::vector<U8> > decoded;
+		for (const std::string& block : blocks)
+		{
+			LLPointer<LLVolume> volume = make_mesh_volume();
+			decoded.emplace_back();
+			if (unpack(volume, block))
+			{
+				volume->packDecodedFaces(decoded.back());
+			}
+		}
+		timer.reset();
+		for (S32 rep = 0; rep < reps; ++rep)
+		{
+			for (const std::vector<U8>& block : decoded)
+			{
+				LLPointer<LLVolume> volume = make_mesh_volume();
+				volume->unpackDecodedFaces(block.data(), block.size());
+			}
+		}
+		reload = timer.getElapsedTimeF64();
+	}
+}
+
+namespace tut
+{
+	struct llvolume_data
+	{
+		llvolume_data() : mRng(1234) {}
+
+		std::mt19937 mRng;
+	};
+	typedef test_group<llvolume_data> llvolume_test;
+	typedef llvolume_test::object llvolume_object;
+	tut::llvolume_test llvolume_testcase("LLVolume");
+
+	template<> template<>
+	void llvolume_object::test<1>()
+	{
+		set_test_name("direct decode and decoding through LLSD match the scalar reference");
+		for (U32 vertices : { 1U, 2U, 3U, 17U, 1000U })
+		{
+			LLSD lod = make_lod(mRng, 3, vertices, vertices > 2);
+			std::string block = compress(lod);
+
+			LLPointer<LLVolume> direct = make_mesh_volume();
+			LLPointer<LLVolume> through_llsd = make_mesh_volume();
+			ensure("direct", unpack(direct, block));
+			ensure("through llsd", unpack_through_llsd(through_llsd, block));
+			ensure_equals("faces", direct->getNumVolumeFaces(), 3);
+			ensure("same faces", same_faces(direct, through_llsd));
+			for (S32 i = 0; i < 3; ++i)
+			{
+				ensure("direct matches reference", same_as_reference(direct->getVolumeFace(i), lod[i]));
+				ensure("through llsd matches reference", same_as_reference(through_llsd->getVolumeFace(i), lod[i]));
+			}
+		}
+	}
+
+	template<> template<>
+	void llvolume_object::test<2>()
+	{
+		set_test_name("integer domains, extra keys and empty faces");
+		LLSD lod = make_lod(mRng, 2, 50, false);
+		// Integer domains and extra keys, as older uploaders wrote them
+		LLSD min;
+		min.append(-1);
+		min.append(-1);
+		min.append(-1);
+		lod[0]["PositionDomain"]["Min"] = min;
+		lod[0]["Comment"] = "extra";
+		lod[1] = LLSD::emptyMap();
+		lod[1]["NoGeometry"] = true;
+		std::string block = compress(lod);
+
+		LLPointer<LLVolume> direct = make_mesh_volume();
+		LLPointer<LLVolume> through_llsd = make_mesh_volume();
+		ensure("direct", unpack(direct, block));
+		ensure("through llsd", unpack_through_llsd(through_llsd, block));
+		ensure("same faces", same_faces(direct, through_llsd));
+		ensure_equals("placeholder face", direct->getVolumeFace(1).mNumVertices, 1);
+	}
+
+	template<> template<>
+	void llvolume_object::test<3>()
+	{
+		set_test_name("bad blocks");
+		LLPointer<LLVolume> volume = make_mesh_volume();
+		ensure("not zlib", !unpack(volume, "not a zlib block"));
+
+		LLSD empty = LLSD::emptyArray();
+		ensure("no faces", !unpack(volume, compress(empty)));
+
+		LLSD lod = make_lod(mRng, 1, 10, false);
+		std::string block = compress(lod);
+		ensure("truncated", !unpack(volume, block.substr(0, block.size() / 2)));
+	}
+
+	template<> template<>
+	void llvolume_object::test<4>()
+	{
+		set_test_name("decoded faces round trip");
+		LLSD lod = make_lod(mRng, 3, 300, true);
+		lod[1].erase("Weights");
+		lod[2] = LLSD::emptyMap();
+		lod[2]["NoGeometry"] = true;
+		LLPointer<LLVolume> decoded = make_mesh_volume();
+		ensure("decode", unpack(decoded, compress(lod)));
+
+		std::vector<U8> block;
+		ensure("pack", decoded->packDecodedFaces(block));
+		LLPointer<LLVolume> reloaded = make_mesh_volume();
+		ensure("unpack", reloaded->unpackDecodedFaces(block.data(), block.size()));
+		ensure("same faces", same_faces(decoded, reloaded));
+		for (S32 i = 0; i < reloaded->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& face = reloaded->getVolumeFace(i);
+			ensure("optimized", face.mOptimized);
+			ensure("center", face.mCenter->equals3(*decoded->getVolumeFace(i).mCenter));
+			ensure_equals("texture coordinate extents", face.mTexCoordExtents[1], decoded->getVolumeFace(i).mTexCoordExtents[1]);
+		}
+
+		LLPointer<LLVolume> volume = make_mesh_volume();
+		ensure("truncated", !volume->unpackDecodedFaces(block.data(), block.size() - 1));
+		std::vector<U8> bad_index(block);
+		// The last face is the one without geometry, its indices start the
+		// last 64 byte run
+		U16 index = 300;
+		memcpy(&bad_index[bad_index.size() - 64], &index, sizeof(U16));
+		ensure("index out of range", !volume->unpackDecodedFaces(bad_index.data(), bad_index.size()));
+	}
+
+	template<> template<>
+	void llvolume_object::test<5>()
+	{
+		set_test_name("decode benchmark");
+		// LL_MESH_LOD_CORPUS names a directory of compressed LOD blocks, as
+		// cut from mesh assets at their LOD offsets. Without one, decode
+		// blocks shaped like typical uploads.
+		std::vector<std::string> blocks;
+		std::string corpus = LLStringUtil::getenv("LL_MESH_LOD_CORPUS");
+		if (!corpus.empty() && boost::filesystem::is_directory(corpus))
+		{
+			for (const auto& entry : boost::filesystem::directory_iterator(corpus))
+			{
+				std::ifstream file(entry.path().string(), std::ios::binary);
+				blocks.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+		}
+		else
+		{
+			for (U32 vertices : { 100U, 1000U, 8000U, 20000U })
+			{
+				LLSD lod = make_lod(mRng, 4, vertices, vertices < 10000);
+				blocks.push_back(compress(lod));
+			}
+		}
+
+		for (const std::string& block : blocks)
+		{
+			LLPointer<LLVolume> direct = make_mesh_volume();
+			LLPointer<LLVolume> through_llsd = make_mesh_volume();
+			bool direct_ok = unpack(direct, block);
+			ensure_equals("both decode", direct_ok, unpack_through_llsd(through_llsd, block));
+			ensure("same faces", !direct_ok || same_faces(direct, through_llsd));
+		}
+
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time LOD decoding");
+		}
+
+		F64 direct = 0.0;
+		F64 through_llsd = 0.0;
+		F64 reload = 0.0;
+		benchmark(blocks, 5, direct, through_llsd, reload);
+		LL_INFOS() << "decoded " << blocks.size() << " LOD blocks 5 times: direct "
+				   << direct * 1000.0 << " ms, through LLSD "
+				   << through_llsd * 1000.0 << " ms, reloading decoded faces "
+				   << reload * 1000.0 << " ms" << LL_ENDL;
+	}
+}
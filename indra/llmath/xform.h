@@ -142,6 +142,13 @@ public:
 
 	const LLMatrix4&    getWorldMatrix() const      { return mWorldMatrix; }
 	void setWorldMatrix (const LLMatrix4& mat)   { mWorldMatrix = mat; }
+	// For world transforms worked out elsewhere, leaves what updateMatrix(FALSE) would
+	void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4& mat)
+	{
+		mWorldPosition = pos;
+		mWorldRotation = rot;
+		mWorldMatrix = mat;
+	}
 
 	void init()
 	{
@@ -66,8 +66,7 @@ const F32Milliseconds LL_AVERAGED_PING_MIN(100);    // increased to avoid retran
 const U32Milliseconds INITIAL_PING_VALUE_MSEC(1000); // initial value for the ping delay, or for ping delay for an unknown circuit
 
 const F32Seconds TARGET_PERIOD_LENGTH(5.f);
-const F32Seconds LL_DUPLICATE_SUPPRESSION_TIMEOUT(60.f); //this can be long, as time-based cleanup is
-													// only done when wrapping packetids, now...
+const U32 LL_DUPLICATE_SUPPRESSION_SPAN = 0x10000;	// most reliable ids remembered past the sender's oldest unacked
 
 LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id, 
 							 const F32Seconds circuit_heartbeat_interval, const F32Seconds circuit_timeout)
@@ -90,6 +89,7 @@ LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id,
 	mLastPingID(0),
 	mPingDelay(INITIAL_PING_VALUE_MSEC), 
 	mPingDelayAveraged(INITIAL_PING_VALUE_MSEC), 
+	mRecentlyReceivedReliablePackets(LL_DUPLICATE_SUPPRESSION_SPAN),
 	mAckCreationTime(0.f),
 	mUnackedPacketCount(0),
 	mUnackedPacketBytes(0),
@@ -229,7 +229,7 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 
 		// Cleanup
 		delete packetp;
-		mUnackedPackets.erase(iter);
+		mUnackedPackets.erase(packet_num);
 		return;
 	}
 
@@ -263,7 +263,7 @@ void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 
 		// Cleanup
 		delete packetp;
-		mFinalRetryPackets.erase(iter);
+		mFinalRetryPackets.erase(packet_num);
 	}
 	else
 	{
@@ -280,12 +280,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
 	LLReliablePacket *packetp;
 
 
-	//
-	// Theoretically we should search through the list for the packet with the oldest
-	// packet ID, as otherwise when we WRAP we will resend reliable packets out of order.
-	// Since resends are ALREADY out of order, and wrapping is highly rare (16+million packets),
-	// I'm not going to worry about this for now - djs
-	//
+	// The windows iterate in sequence order, oldest first, across wraps too.
 
 	reliable_iter iter;
 	BOOL have_resend_overflow = FALSE;
@@ -313,7 +308,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
 					packetp->mRetries = 0;
 					// Remove it from this list and add it to the final list.
 					mUnackedPackets.erase(iter++);
-					mFinalRetryPackets[packetp->mPacketID] = packetp;
+					mFinalRetryPackets.set(packetp->mPacketID, packetp);
 				}
 				else
 				{
@@ -373,7 +368,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64Seconds now)
 			{
 				// Last resend, remove it from this list and add it to the final list.
 				mUnackedPackets.erase(iter++);
-				mFinalRetryPackets[packetp->mPacketID] = packetp;
+				mFinalRetryPackets.set(packetp->mPacketID, packetp);
 			}
 			else
 			{
@@ -576,11 +571,11 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
 
 	if (params && params->mRetries)
 	{
-		mUnackedPackets[packet_info->mPacketID] = packet_info;
+		mUnackedPackets.set(packet_info->mPacketID, packet_info);
 	}
 	else
 	{
-		mFinalRetryPackets[packet_info->mPacketID] = packet_info;
+		mFinalRetryPackets.set(packet_info->mPacketID, packet_info);
 	}
 }
 
@@ -604,7 +599,7 @@ void LLCircuit::resendUnackedPackets(S32& unacked_list_length, S32& unacked_list
 
 BOOL LLCircuitData::isDuplicateResend(TPACKETID packetnum)
 {
-	return (mRecentlyReceivedReliablePackets.find(packetnum) != mRecentlyReceivedReliablePackets.end());
+	return mRecentlyReceivedReliablePackets.contains(packetnum);
 }
 
 
@@ -865,92 +860,21 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// for the packet that it was out of order with was received BEFORE
 	// the ping was sent.
 
-	// Find the current oldest reliable packetID
-	// This is to handle the case if we actually manage to wrap our
-	// packet IDs - the oldest will actually have a higher packet ID
-	// than the current.
-	BOOL wrapped = FALSE;
-	reliable_iter iter;
-	iter = mUnackedPackets.upper_bound(getPacketOutID());
-	if (iter == mUnackedPackets.end())
-	{
-		// Nothing AFTER this one, so we want the lowest packet ID
-		// then.
-		iter = mUnackedPackets.begin();
-		wrapped = TRUE;
-	}
-
-	TPACKETID packet_id = 0;
-
-	// Check against the "final" packets
-	BOOL wrapped_final = FALSE;
-	reliable_iter iter_final;
-	iter_final = mFinalRetryPackets.upper_bound(getPacketOutID());
-	if (iter_final == mFinalRetryPackets.end())
+	// Find the current oldest reliable packetID, the windows keep
+	// theirs in front even when the packet IDs wrap.
+	// If there are no unacked packets at all send the ID of the last
+	// packet we sent out. This will flush all of the destination's
+	// unacked packets, theoretically.
+	TPACKETID packet_id = getPacketOutID();
+	if (!mUnackedPackets.empty())
 	{
-		iter_final = mFinalRetryPackets.begin();
-		wrapped_final = TRUE;
+		packet_id = mUnackedPackets.front();
 	}
-
-	//LL_INFOS() << mHost << " - unacked count " << mUnackedPackets.size() << LL_ENDL;
-	//LL_INFOS() << mHost << " - final count " << mFinalRetryPackets.size() << LL_ENDL;
-	if (wrapped != wrapped_final)
+	if (!mFinalRetryPackets.empty()
+		&& (mUnackedPackets.empty()
+			|| reliable_window::precedes(mFinalRetryPackets.front(), packet_id)))
 	{
-		// One of the "unacked" or "final" lists hasn't wrapped.  Whichever one
-		// hasn't has the oldest packet.
-		if (!wrapped)
-		{
-			// Hasn't wrapped, so the one on the
-			// unacked packet list is older
-			packet_id = iter->first;
-			//LL_INFOS() << mHost << ": nowrapped unacked" << LL_ENDL;
-		}
-		else
-		{
-			packet_id = iter_final->first;
-			//LL_INFOS() << mHost << ": nowrapped final" << LL_ENDL;
-		}
-	}
-	else
-	{
-		// They both wrapped, we can just use the minimum of the two.
-		if ((iter == mUnackedPackets.end()) && (iter_final == mFinalRetryPackets.end()))
-		{
-			// Wow!  No unacked packets at all!
-			// Send the ID of the last packet we sent out.
-			// This will flush all of the destination's
-			// unacked packets, theoretically.
-			//LL_INFOS() << mHost << ": No unacked!" << LL_ENDL;
-			packet_id = getPacketOutID();
-		}
-		else
-		{
-			BOOL had_unacked = FALSE;
-			if (iter != mUnackedPackets.end())
-			{
-				// Unacked list has the lowest so far
-				packet_id = iter->first;
-				had_unacked = TRUE;
-				//LL_INFOS() << mHost << ": Unacked" << LL_ENDL;
-			}
-
-			if (iter_final != mFinalRetryPackets.end())
-			{
-				// Use the lowest of the unacked list and the final list
-				if (had_unacked)
-				{
-					// Both had a packet, use the lowest.
-					packet_id = llmin(packet_id, iter_final->first);
-					//LL_INFOS() << mHost << ": Min of unacked/final" << LL_ENDL;
-				}
-				else
-				{
-					// Only the final had a packet, use it.
-					packet_id = iter_final->first;
-					//LL_INFOS() << mHost << ": Final!" << LL_ENDL;
-				}
-			}
-		}
+		packet_id = mFinalRetryPackets.front();
 	}
 
 	// Send off the another ping.
@@ -1001,46 +925,11 @@ void LLCircuitData::clearDuplicateList(TPACKETID oldest_id)
 	// purge old data from the duplicate suppression queue
 
 	// we want to KEEP all x where oldest_id <= x <= last incoming packet, and delete everything else.
+	// The window compares packet IDs by sequence, so this holds across wraps.
 
 	//LL_INFOS() << mHost << ": clearing before oldest " << oldest_id << LL_ENDL;
 	//LL_INFOS() << "Recent list before: " << mRecentlyReceivedReliablePackets.size() << LL_ENDL;
-	if (oldest_id < mHighestPacketID)
-	{
-		// Clean up everything with a packet ID less than oldest_id.
-		packet_time_map::iterator pit_start;
-		packet_time_map::iterator pit_end;
-		pit_start = mRecentlyReceivedReliablePackets.begin();
-		pit_end = mRecentlyReceivedReliablePackets.lower_bound(oldest_id);
-		mRecentlyReceivedReliablePackets.erase(pit_start, pit_end);
-	}
-
-	// Do timeout checks on everything with an ID > mHighestPacketID.
-	// This should be empty except for wrapping IDs.  Thus, this should be
-	// highly rare.
-	U64Microseconds mt_usec = LLMessageSystem::getMessageTimeUsecs();
-
-	packet_time_map::iterator pit;
-	for(pit = mRecentlyReceivedReliablePackets.upper_bound(mHighestPacketID);
-		pit != mRecentlyReceivedReliablePackets.end(); )
-	{
-		// Validate that the packet ID seems far enough away
-		if ((pit->first - mHighestPacketID) < 100)
-		{
-			LL_WARNS() << "Probably incorrectly timing out non-wrapped packets!" << LL_ENDL;
-		}
-		U64Microseconds delta_t_usec = mt_usec - (*pit).second;
-		F64Seconds delta_t_sec = delta_t_usec;
-		if (delta_t_sec > LL_DUPLICATE_SUPPRESSION_TIMEOUT)
-		{
-			// enough time has elapsed we're not likely to get a duplicate on this one
-			LL_INFOS() << "Clearing " << pit->first << " from recent list" << LL_ENDL;
-			mRecentlyReceivedReliablePackets.erase(pit++);
-		}
-		else
-		{
-			++pit;
-		}
-	}
+	mRecentlyReceivedReliablePackets.eraseBefore(oldest_id);
 	//LL_INFOS() << "Recent list after: " << mRecentlyReceivedReliablePackets.size() << LL_ENDL;
 }
 
@@ -34,6 +34,7 @@
 #include "net.h"
 #include "llhost.h"
 #include "llpacketack.h"
+#include "llpacketidwindow.h"
 #include "lluuid.h"
 #include "llthrottle.h"
 
@@ -231,17 +232,18 @@ protected:
 	F32Milliseconds		mPingDelayAveraged;     // averaged ping delay (fast attack/slow decay)
 
 	typedef std::map<TPACKETID, U64Microseconds> packet_time_map;
+	typedef LLPacketIDWindow<U64Microseconds> packet_time_window;
 
 	packet_time_map							mPotentialLostPackets;
-	packet_time_map							mRecentlyReceivedReliablePackets;
+	packet_time_window						mRecentlyReceivedReliablePackets;
 	std::vector<TPACKETID> mAcks;
 	F32 mAckCreationTime; // first ack creation time
 
-	typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
-	typedef reliable_map::iterator					reliable_iter;
+	typedef LLPacketIDWindow<LLReliablePacket *> reliable_window;
+	typedef reliable_window::iterator				reliable_iter;
 
-	reliable_map							mUnackedPackets;
-	reliable_map							mFinalRetryPackets;
+	reliable_window							mUnackedPackets;
+	reliable_window							mFinalRetryPackets;
 
 	S32										mUnackedPacketCount;
 	S32										mUnackedPacketBytes;
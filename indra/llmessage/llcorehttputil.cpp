@@ -107,9 +107,8 @@ private:
 
 
 //=========================================================================
-// *TODO:  Currently converts only from XML content.  A mode
-// to convert using fromBinary() might be useful as well.  Mesh
-// headers could use it.
+// Converts from XML content unless the response says it is
+// binary.
 bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
 {
     // Convert response to LLSD
@@ -119,9 +118,37 @@ bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
         return false;
     }
 
+    const std::string & content_type(response->getContentType());
+    if (HTTP_CONTENT_LLSD_BINARY == content_type)
+    {
+        // LLSDSerialize::toBinary() output may come with the header
+        // LLSDSerialize::serialize() puts in front of it.  No binary value
+        // starts with '<', so anything else there is not binary LLSD.
+        static const char binary_header[] = "<? LLSD/Binary ?>\n";
+        const size_t header_len(sizeof(binary_header) - 1);
+        char header[sizeof(binary_header)];
+        size_t offset(0);
+        if (body->read(0, header, 1) && '<' == header[0])
+        {
+            if (body->read(0, header, header_len) != header_len
+                || memcmp(header, binary_header, header_len))
+            {
+                LL_WARNS("CoreHTTP") << "Binary LLSD body has a bad header from "
+                                     << response->getRequestURL() << LL_ENDL;
+                return false;
+            }
+            offset = header_len;
+        }
+        return bufferArrayToLLSD(body, offset, out_llsd) > 0;
+    }
+
     LLCore::BufferArrayStream bas(body);
     LLSD body_llsd;
-    S32 parse_status(LLSDSerialize::fromXML(body_llsd, bas, log));
+    // Responses such as inventory fetches can run to thousands of values,
+    // and callers pick them apart and drop them
+    LLPointer<LLSDXMLParser> parser = new LLSDXMLParser(log);
+    parser->setUseArena(true);
+    S32 parse_status(parser->parse(bas, body_llsd, LLSDSerialize::SIZE_UNLIMITED));
     if (LLSDParser::PARSE_FAILURE == parse_status){
         return false;
     }
@@ -130,6 +157,52 @@ bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
 }
 
 
+size_t bufferArrayToLLSD(BufferArray * body, size_t offset, LLSD & out_llsd, S32 max_bytes)
+{
+    LLSDArena arena;
+    LLSDBinaryChunkParser parser(max_bytes);
+
+    const char * start(NULL);
+    const char * end(NULL);
+    for (int block(0); body->getBlockStartEnd(block, &start, &end); ++block)
+    {
+        size_t len(end - start);
+        if (offset >= len)
+        {
+            offset -= len;
+            continue;
+        }
+
+        if (LLSDBinaryChunkParser::STATUS_MORE != parser.feed(start + offset, len - offset))
+        {
+            break;
+        }
+        offset = 0;
+    }
+
+    if (LLSDBinaryChunkParser::STATUS_DONE != parser.getStatus())
+    {
+        return 0;
+    }
+    out_llsd = parser.getResult();
+    return parser.getConsumed();
+}
+
+
+size_t llsdToBufferArray(const LLSD & value, BufferArray * body)
+{
+    const size_t start(body->size());
+    {
+        LLSDBinaryChunkFormatter formatter([body](const char * data, size_t len)
+            {
+                body->append(data, len);
+            });
+        formatter.format(value);
+    }
+    return body->size() - start;
+}
+
+
 HttpHandle requestPostWithLLSD(HttpRequest * request,
     HttpRequest::policy_t policy_id,
     HttpRequest::priority_t priority,
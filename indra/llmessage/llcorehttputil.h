@@ -86,6 +86,31 @@ bool responseToLLSD(LLCore::HttpResponse * response,
 					bool log,
 					LLSD & out_llsd);
 
+/// Parse binary LLSD straight out of the blocks of a BufferArray,
+/// without wrapping it in a stream.
+///
+/// @arg	body		Buffer holding the serialized value.
+/// @arg	offset		Where the value starts in body.
+/// @arg	out_llsd	Output LLSD object written only upon
+///						successful parse.
+/// @arg	max_bytes	As in LLSDSerialize::fromBinary().
+///
+/// @return				Bytes used by the value, zero if it could
+///						not be parsed.  Data after the value is
+///						left alone.
+///
+size_t bufferArrayToLLSD(LLCore::BufferArray * body,
+						 size_t offset,
+						 LLSD & out_llsd,
+						 S32 max_bytes = -1);
+
+/// Append the binary LLSD serialization of a value to a
+/// BufferArray, copying each byte into it once.
+///
+/// @return				Bytes appended.
+///
+size_t llsdToBufferArray(const LLSD & value, LLCore::BufferArray * body);
+
 /// Create a std::string representation of a response object
 /// suitable for logging.  Mainly intended for logging of
 /// failures and debug information.  This won't be fast,
@@ -34,8 +34,39 @@
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size)
 {
+	init(host, datap, size);
+}
+
+LLPacketBuffer::LLPacketBuffer (S32 hSocket)
+{
+	init(hSocket);
+}
+
+LLPacketBuffer::LLPacketBuffer()
+	: mSize(0)
+{
+}
+
+///////////////////////////////////////////////////////////
+
+LLPacketBuffer::~LLPacketBuffer ()
+{
+}
+
+///////////////////////////////////////////////////////////
+
+void LLPacketBuffer::init (S32 hSocket)
+{
+	mSize = receive_packet(hSocket, mData);
+	mHost = ::get_sender();
+	mReceivingIF = ::get_receiving_interface();
+}
+
+void LLPacketBuffer::init(const LLHost &host, const char *datap, const S32 size)
+{
+	mHost = host;
 	mSize = 0;
 	mData[0] = '!';
 
@@ -51,26 +82,50 @@ LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32
 			mSize = size;
 		}
 	}
-	
-}
-
-LLPacketBuffer::LLPacketBuffer (S32 hSocket)
-{
-	init(hSocket);
 }
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::~LLPacketBuffer ()
+// static
+S32 LLPacketBuffer::receiveBatch(S32 hSocket, LLPacketBuffer *buffers, S32 count)
 {
-}
+	LLNetDatagram datagrams[NET_BATCH_SIZE];
+	count = llmin(count, NET_BATCH_SIZE);
+	for (S32 i = 0; i < count; ++i)
+	{
+		datagrams[i].mData = buffers[i].mData;
+	}
 
-///////////////////////////////////////////////////////////
+	S32 received = receive_packets(hSocket, datagrams, count);
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLPacketBuffer& buffer(buffers[i]);
+		buffer.mSize = datagrams[i].mSize;
+		buffer.mHost = LLHost(datagrams[i].mAddress, datagrams[i].mPort);
+		buffer.mReceivingIF = LLHost(datagrams[i].mReceivingIF, INVALID_PORT);
+	}
+	return received;
+}
 
-void LLPacketBuffer::init (S32 hSocket)
+// static
+BOOL LLPacketBuffer::sendBatch(S32 hSocket, const LLPacketBuffer *buffers, S32 count)
 {
-	mSize = receive_packet(hSocket, mData);
-	mHost = ::get_sender();
-	mReceivingIF = ::get_receiving_interface();
+	LLNetDatagram datagrams[NET_BATCH_SIZE];
+	BOOL success = TRUE;
+	while (count > 0)
+	{
+		S32 batch = llmin(count, NET_BATCH_SIZE);
+		for (S32 i = 0; i < batch; ++i)
+		{
+			// send_packets() doesn't write through mData
+			datagrams[i].mData = const_cast<char*>(buffers[i].mData);
+			datagrams[i].mSize = buffers[i].mSize;
+			datagrams[i].mAddress = buffers[i].mHost.getAddress();
+			datagrams[i].mPort = buffers[i].mHost.getPort();
+		}
+		success = send_packets(hSocket, datagrams, batch) && success;
+		buffers += batch;
+		count -= batch;
+	}
+	return success;
 }
-
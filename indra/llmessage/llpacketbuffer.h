@@ -36,6 +36,7 @@ class LLPacketBuffer
 public:
 	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
 	LLPacketBuffer(S32 hSocket);           // receive a packet
+	LLPacketBuffer();						// empty, for preallocated batches
 	~LLPacketBuffer();
 
 	S32			getSize() const					{ return mSize; }
@@ -43,6 +44,12 @@ public:
 	LLHost		getHost() const					{ return mHost; }
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
 	void init(S32 hSocket);
+	void init(const LLHost &host, const char *datap, const S32 size);
+
+	// Receive into or send from count buffers with as few system calls
+	// as the platform allows.  receiveBatch() returns how many arrived.
+	static S32 receiveBatch(S32 hSocket, LLPacketBuffer *buffers, S32 count);
+	static BOOL sendBatch(S32 hSocket, const LLPacketBuffer *buffers, S32 count);
 
 protected:
 	char	mData[NET_BUFFER_SIZE];        // packet data		/* Flawfinder : ignore */
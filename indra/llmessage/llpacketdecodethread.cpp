@@ -0,0 +1,227 @@
+/**
+ * @file llpacketdecodethread.cpp
+ * @brief Receives and decodes template messages off the main thread
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketdecodethread.h"
+
+#include "llmessagetemplate.h"
+#include "lltimer.h"
+#include "message.h"
+
+// How long run() blocks on the socket before checking for shutdown
+static const S32 WAIT_TIMEOUT_MS = 10;
+
+LLDecodedPacket::LLDecodedPacket()
+:	mRawSize(0),
+	mMessage(nullptr),
+	mMessageSize(0),
+	mCompressedSize(0),
+	mOverflowed(false),
+	mTemplate(nullptr),
+	mData(nullptr)
+{
+}
+
+LLDecodedPacket::~LLDecodedPacket()
+{
+	delete mData;
+}
+
+void LLDecodedPacket::clear()
+{
+	mMessage = nullptr;
+	mMessageSize = 0;
+	mCompressedSize = 0;
+	mOverflowed = false;
+	mTemplate = nullptr;
+	delete mData;
+	mData = nullptr;
+	mOverruns.clear();
+}
+
+LLMsgData* LLDecodedPacket::takeData()
+{
+	LLMsgData* data = mData;
+	mData = nullptr;
+	return data;
+}
+
+void LLPacketDecodeThread::Recycler::operator()(LLDecodedPacket* packet) const
+{
+	// Can't fail, there are never more packets than the queue holds
+	mThread->mRecycled.push(packet);
+}
+
+LLPacketDecodeThread::LLPacketDecodeThread(S32 socket,
+		const LLTemplateMessageReader::message_template_number_map_t& numbers)
+:	LLThread("Packet Decode"),
+	mSocket(socket),
+	mMessageNumbers(numbers),
+	mAllocated(0)
+{
+	mSpare.reserve(NET_BATCH_SIZE);
+}
+
+LLPacketDecodeThread::~LLPacketDecodeThread()
+{
+	shutdown();
+
+	// Every packet is back in one of the queues by now
+	LLDecodedPacket* packet = nullptr;
+	while (mDecoded.pop(packet))
+	{
+		delete packet;
+	}
+	while (mRecycled.pop(packet))
+	{
+		delete packet;
+	}
+	for (LLDecodedPacket* spare : mSpare)
+	{
+		delete spare;
+	}
+	mSpare.clear();
+}
+
+LLPacketDecodeThread::packet_ptr_t LLPacketDecodeThread::pop()
+{
+	LLDecodedPacket* packet = nullptr;
+	if (!mDecoded.pop(packet))
+	{
+		packet = nullptr;
+	}
+	return packet_ptr_t(packet, Recycler{ this });
+}
+
+LLDecodedPacket* LLPacketDecodeThread::getFreePacket()
+{
+	LLDecodedPacket* packet = nullptr;
+	if (!mSpare.empty())
+	{
+		packet = mSpare.back();
+		mSpare.pop_back();
+	}
+	else if (!mRecycled.pop(packet))
+	{
+		packet = nullptr;
+		if (mAllocated < MAX_PACKETS)
+		{
+			++mAllocated;
+			packet = new LLDecodedPacket();
+		}
+	}
+	return packet;
+}
+
+void LLPacketDecodeThread::run()
+{
+	LLDecodedPacket* packets[NET_BATCH_SIZE];
+	LLNetDatagram datagrams[NET_BATCH_SIZE];
+
+	while (!isQuitting())
+	{
+		if (!wait_for_packet(mSocket, WAIT_TIMEOUT_MS))
+		{
+			continue;
+		}
+
+		S32 count = 0;
+		while (count < NET_BATCH_SIZE
+			   && (packets[count] = getFreePacket()))
+		{
+			datagrams[count].mData = packets[count]->mRaw;
+			++count;
+		}
+		if (!count)
+		{
+			// The main thread is behind, let the socket hold on to them
+			ms_sleep(1);
+			continue;
+		}
+
+		S32 received = receive_packets(mSocket, datagrams, count);
+		for (S32 i = 0; i < received; ++i)
+		{
+			LLDecodedPacket* packet = packets[i];
+			packet->mSender = LLHost(datagrams[i].mAddress, datagrams[i].mPort);
+			packet->mReceivingIF = LLHost(datagrams[i].mReceivingIF, INVALID_PORT);
+			packet->mRawSize = datagrams[i].mSize;
+			decode(*packet);
+			mDecoded.push(packet);
+		}
+		for (S32 i = received; i < count; ++i)
+		{
+			mSpare.push_back(packets[i]);
+		}
+	}
+}
+
+// Does what LLMessageSystem::checkMessages() does up to the circuit
+// lookup, checkMessages() repeats the cheap size checks on the raw packet
+// and skips the rest.
+void LLPacketDecodeThread::decode(LLDecodedPacket& packet) const
+{
+	packet.clear();
+
+	U8* buffer = (U8*)packet.mRaw;
+	S32 size = packet.mRawSize;
+	if (size < (S32)LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		return;
+	}
+
+	if (buffer[0] & LL_ACK_FLAG)
+	{
+		S32 acks = buffer[--size];
+		if (size < (S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE))
+		{
+			// Malformed, checkMessages() warns about it
+			return;
+		}
+		size -= acks * sizeof(TPACKETID);
+	}
+
+	packet.mMessage = buffer;
+	if (buffer[0] & LL_ZERO_CODE_FLAG)
+	{
+		packet.mCompressedSize = size;
+		size = LLMessageSystem::zeroCodeExpandBuffer(buffer, size, packet.mExpanded);
+		if (size < 0)
+		{
+			packet.mOverflowed = true;
+			return;
+		}
+		packet.mMessage = packet.mExpanded;
+	}
+	packet.mMessageSize = size;
+
+	packet.mTemplate = LLTemplateMessageReader::decodeTemplate(mMessageNumbers, packet.mMessage, size);
+	if (packet.mTemplate)
+	{
+		packet.mData = LLTemplateMessageReader::decodeBlocks(packet.mTemplate, packet.mMessage, size,
+															 packet.mOverruns);
+	}
+}
@@ -0,0 +1,114 @@
+/**
+ * @file llpacketdecodethread.h
+ * @brief Receives and decodes template messages off the main thread
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETDECODETHREAD_H
+#define LL_LLPACKETDECODETHREAD_H
+
+#include "llhost.h"
+#include "llthread.h"
+#include "lltemplatemessagereader.h"
+#include "net.h"
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <memory>
+#include <vector>
+
+// A packet as received, with its message already expanded and decoded
+// against the message template.
+struct LLDecodedPacket
+{
+	LLDecodedPacket();
+	~LLDecodedPacket();
+
+	// Forgets the previous packet before the slot is reused.
+	void clear();
+
+	// The decoded blocks, for LLTemplateMessageReader::readDecodedMessage().
+	LLMsgData* takeData();
+
+	LLHost mSender;
+	LLHost mReceivingIF;
+	char mRaw[NET_BUFFER_SIZE];		// as received
+	S32 mRawSize;
+
+	U8* mMessage;					// mRaw or mExpanded, without appended acks
+	S32 mMessageSize;				// 0 if the zero code expansion overflowed
+	S32 mCompressedSize;			// size before expansion, 0 if not zero coded
+	bool mOverflowed;
+	U8 mExpanded[NET_BUFFER_SIZE];
+
+	LLMessageTemplate* mTemplate;	// nullptr for unknown or malformed messages
+	LLMsgData* mData;
+	LLTemplateMessageReader::overrun_list_t mOverruns;
+};
+
+// Receives packets from the message system's socket, strips their acks,
+// expands them and decodes them against the message template, leaving only
+// the circuit bookkeeping and the handlers to the main thread.
+// Slots cycle between the two threads through a pair of single producer,
+// single consumer queues, so neither side takes a lock. Once every slot is
+// waiting for the main thread, reception pauses and the socket buffers the
+// packets as it would without the thread.
+class LLPacketDecodeThread final : public LLThread
+{
+public:
+	// Hands the slot back to the decode thread when the main thread is done.
+	struct Recycler
+	{
+		LLPacketDecodeThread* mThread;
+		void operator()(LLDecodedPacket* packet) const;
+	};
+	typedef std::unique_ptr<LLDecodedPacket, Recycler> packet_ptr_t;
+
+	// numbers must not change while the thread runs.
+	LLPacketDecodeThread(S32 socket,
+						 const LLTemplateMessageReader::message_template_number_map_t& numbers);
+	~LLPacketDecodeThread();
+
+	// Main thread: the next decoded packet, empty if there is none.
+	packet_ptr_t pop();
+
+	void run() override;
+
+private:
+	enum { MAX_PACKETS = 256 };
+
+	LLDecodedPacket* getFreePacket();
+	void decode(LLDecodedPacket& packet) const;
+
+	typedef boost::lockfree::spsc_queue<LLDecodedPacket*,
+		boost::lockfree::capacity<MAX_PACKETS> > packet_queue_t;
+
+	const S32 mSocket;
+	const LLTemplateMessageReader::message_template_number_map_t& mMessageNumbers;
+
+	packet_queue_t mDecoded;		// decode thread to main thread
+	packet_queue_t mRecycled;		// main thread to decode thread
+	std::vector<LLDecodedPacket*> mSpare;	// decode thread only
+	S32 mAllocated;					// decode thread only, up to MAX_PACKETS
+};
+
+#endif // LL_LLPACKETDECODETHREAD_H
@@ -0,0 +1,266 @@
+/**
+ * @file llpacketidwindow.h
+ * @brief Values keyed by packet id, for ids that come roughly in sequence
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETIDWINDOW_H
+#define LL_LLPACKETIDWINDOW_H
+
+#include "stdtypes.h"
+#include "llmath.h"
+
+#include <vector>
+
+// A ring of slots indexed by packet id, spanning the ids from the oldest
+// one held to the newest. Setting, finding and erasing an id are O(1),
+// iteration runs oldest first. Ids are 24 bits (see LL_MAX_OUT_PACKET_ID)
+// and compared by sequence, an id less than half the id space ahead of
+// another is newer, so the order stays right when the ids wrap.
+// Slots look like std::pair, iter->first is the id and iter->second the
+// value, so the window can stand in for a std::map<TPACKETID, T>.
+template <typename T>
+class LLPacketIDWindow
+{
+public:
+	static constexpr TPACKETID ID_MASK = 0x00FFFFFF;
+	static constexpr U32 HALF_SPACE = (ID_MASK + 1) / 2;
+
+	struct Slot
+	{
+		TPACKETID first;
+		T second;
+		bool mUsed;
+	};
+
+	class iterator
+	{
+	public:
+		iterator() : mWindow(nullptr), mID(0) {}
+		iterator(LLPacketIDWindow* window, TPACKETID id) : mWindow(window), mID(id) {}
+
+		Slot& operator*() const				{ return mWindow->slot(mID); }
+		Slot* operator->() const			{ return &mWindow->slot(mID); }
+		iterator& operator++()				{ mID = mWindow->nextUsed(next(mID)); return *this; }
+		iterator operator++(int)			{ iterator old(*this); ++*this; return old; }
+		bool operator==(const iterator& rhs) const	{ return mID == rhs.mID; }
+		bool operator!=(const iterator& rhs) const	{ return mID != rhs.mID; }
+
+	private:
+		LLPacketIDWindow* mWindow;
+		TPACKETID mID;
+	};
+
+	// Setting an id more than max_span past the oldest one drops the
+	// oldest, setting one that far behind the newest is refused.
+	explicit LLPacketIDWindow(U32 max_span = HALF_SPACE)
+	:	mMaxSpan(llclamp(max_span, (U32)1, HALF_SPACE - 1)),
+		mBase(0),
+		mHead(0),
+		mCount(0)
+	{
+	}
+
+	bool empty() const						{ return !mCount; }
+	U32 size() const						{ return mCount; }
+	// Ids between the oldest and the newest, held or not
+	U32 span() const						{ return offset(mBase, mHead); }
+
+	iterator begin()						{ return iterator(this, mBase); }
+	iterator end()							{ return iterator(this, mHead); }
+
+	// The oldest id held, only meaningful when not empty
+	TPACKETID front() const					{ return mBase; }
+
+	iterator find(TPACKETID id)
+	{
+		id &= ID_MASK;
+		return contains(id) ? iterator(this, id) : end();
+	}
+
+	bool contains(TPACKETID id) const
+	{
+		id &= ID_MASK;
+		return mCount && offset(mBase, id) < span() && slot(id).mUsed;
+	}
+
+	// Adds or replaces the value of id, returns false if id is too old.
+	bool set(TPACKETID id, const T& value)
+	{
+		id &= ID_MASK;
+		if (!mCount)
+		{
+			reserve(1);
+			mBase = id;
+			mHead = next(id);
+		}
+		else if (offset(mBase, id) >= span())
+		{
+			if (precedes(mBase, id))
+			{
+				// Newer than the newest
+				if (offset(mBase, id) >= mMaxSpan)
+				{
+					eraseBefore((id - mMaxSpan + 1) & ID_MASK);
+				}
+				if (!mCount)
+				{
+					return set(id, value);
+				}
+				reserve(offset(mBase, id) + 1);
+				mHead = next(id);
+			}
+			else
+			{
+				// Older than the oldest
+				if (offset(id, mHead) > mMaxSpan)
+				{
+					return false;
+				}
+				reserve(offset(id, mHead));
+				mBase = id;
+			}
+		}
+
+		Slot& entry = slot(id);
+		if (!entry.mUsed)
+		{
+			entry.first = id;
+			entry.mUsed = true;
+			++mCount;
+		}
+		entry.second = value;
+		return true;
+	}
+
+	bool erase(TPACKETID id)
+	{
+		id &= ID_MASK;
+		if (!contains(id))
+		{
+			return false;
+		}
+		release(slot(id));
+		if (id == mBase)
+		{
+			mBase = nextUsed(next(id));
+		}
+		return true;
+	}
+
+	void erase(const iterator& iter)
+	{
+		erase(iter->first);
+	}
+
+	// Erases every id that precedes id.
+	void eraseBefore(TPACKETID id)
+	{
+		id &= ID_MASK;
+		if (!mCount || !precedes(mBase, id))
+		{
+			return;
+		}
+		TPACKETID stop = offset(mBase, id) < span() ? id : mHead;
+		for (TPACKETID it = mBase; it != stop; it = next(it))
+		{
+			release(slot(it));
+		}
+		mBase = nextUsed(stop);
+	}
+
+	void clear()
+	{
+		eraseBefore(mHead);
+	}
+
+	// True when a comes before b in sequence
+	static bool precedes(TPACKETID a, TPACKETID b)
+	{
+		U32 delta = offset(a, b);
+		return delta && delta < HALF_SPACE;
+	}
+
+private:
+	static TPACKETID next(TPACKETID id)		{ return (id + 1) & ID_MASK; }
+	static U32 offset(TPACKETID from, TPACKETID to)	{ return (to - from) & ID_MASK; }
+
+	Slot& slot(TPACKETID id)				{ return mSlots[id & (mSlots.size() - 1)]; }
+	const Slot& slot(TPACKETID id) const	{ return mSlots[id & (mSlots.size() - 1)]; }
+
+	TPACKETID nextUsed(TPACKETID id) const
+	{
+		while (id != mHead && !slot(id).mUsed)
+		{
+			id = next(id);
+		}
+		return id;
+	}
+
+	void release(Slot& entry)
+	{
+		if (entry.mUsed)
+		{
+			entry.mUsed = false;
+			entry.second = T();
+			--mCount;
+		}
+	}
+
+	// Makes room for a span of ids, keeping the slot count a power of two.
+	void reserve(U32 span)
+	{
+		if (span <= mSlots.size())
+		{
+			return;
+		}
+		size_t size = mSlots.empty() ? MIN_SLOTS : mSlots.size();
+		while (size < span)
+		{
+			size *= 2;
+		}
+
+		std::vector<Slot> slots(size, Slot{ 0, T(), false });
+		if (mCount)
+		{
+			for (TPACKETID id = mBase; id != mHead; id = next(id))
+			{
+				const Slot& entry = slot(id);
+				if (entry.mUsed)
+				{
+					slots[id & (size - 1)] = entry;
+				}
+			}
+		}
+		mSlots.swap(slots);
+	}
+
+	enum { MIN_SLOTS = 64 };
+
+	std::vector<Slot> mSlots;
+	const U32 mMaxSpan;
+	TPACKETID mBase;		// oldest id held
+	TPACKETID mHead;		// one past the newest id held
+	U32 mCount;
+};
+
+#endif // LL_LLPACKETIDWINDOW_H
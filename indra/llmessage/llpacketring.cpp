@@ -56,7 +56,15 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mUseBatching(TRUE),
+	mReceiveBatch(NET_BATCH_SIZE),
+	mReceiveBatchCount(0),
+	mReceiveBatchNext(0),
+	mSendBatch(NET_BATCH_SIZE),
+	mSendBatchCount(0),
+	mSendBatchDepth(0),
+	mSendBatchSocket(-1)
 {
 }
 
@@ -84,6 +92,10 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	mReceiveBatchCount = 0;
+	mReceiveBatchNext = 0;
+	mSendBatchCount = 0;
 }
 
 ///////////////////////////////////////////////////////////
@@ -117,6 +129,21 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
 	mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::setUseBatching(const BOOL use_batching)
+{
+	mUseBatching = use_batching;
+}
+
+bool LLPacketRing::isReceiveFiltered() const
+{
+	return mUseInThrottle
+		|| mDropPercentage > 0.f
+		|| mPacketsToDrop
+		|| !mReceiveQueue.empty()
+		|| mReceiveBatchNext < mReceiveBatchCount
+		|| LLProxy::isSOCKSProxyEnabled();
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -244,15 +271,19 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 			{
 				packet_size = 0;
 			}
+			mLastReceivingIF = ::get_receiving_interface();
+		}
+		else if (mUseBatching || mReceiveBatchNext < mReceiveBatchCount)
+		{
+			packet_size = receiveFromBatch(socket, datap);
 		}
 		else
 		{
 			packet_size = receive_packet(socket, datap);
 			mLastSender = ::get_sender();
+			mLastReceivingIF = ::get_receiving_interface();
 		}
 
-		mLastReceivingIF = ::get_receiving_interface();
-
 		if (packet_size)  // did we actually get a packet?
 		{
 			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
@@ -279,6 +310,20 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, co
 	BOOL status = TRUE;
 	if (!mUseOutThrottle)
 	{
+		if (mSendBatchDepth && mUseBatching && !LLProxy::isSOCKSProxyEnabled())
+		{
+			if (mSendBatchCount && h_socket != mSendBatchSocket)
+			{
+				flushSendBatch();
+			}
+			mSendBatchSocket = h_socket;
+			mSendBatch[mSendBatchCount++].init(host, send_buffer, buf_size);
+			if (mSendBatchCount == (S32)mSendBatch.size())
+			{
+				flushSendBatch();
+			}
+			return TRUE;
+		}
 		return sendPacketImpl(h_socket, send_buffer, buf_size, host );
 	}
 	else
@@ -373,3 +418,44 @@ BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 bu
 						LLProxy::getInstance()->getUDPProxy().getAddress(),
 						LLProxy::getInstance()->getUDPProxy().getPort());
 }
+
+S32 LLPacketRing::receiveFromBatch(S32 socket, char *datap)
+{
+	if (mReceiveBatchNext >= mReceiveBatchCount)
+	{
+		mReceiveBatchNext = 0;
+		mReceiveBatchCount = LLPacketBuffer::receiveBatch(socket, &mReceiveBatch[0], (S32)mReceiveBatch.size());
+		if (!mReceiveBatchCount)
+		{
+			return 0;
+		}
+	}
+
+	const LLPacketBuffer& packet = mReceiveBatch[mReceiveBatchNext++];
+	memcpy(datap, packet.getData(), packet.getSize());	/*Flawfinder: ignore*/
+	mLastSender = packet.getHost();
+	mLastReceivingIF = packet.getReceivingInterface();
+	return packet.getSize();
+}
+
+void LLPacketRing::beginSendBatch()
+{
+	++mSendBatchDepth;
+}
+
+void LLPacketRing::endSendBatch()
+{
+	if (mSendBatchDepth > 0 && !--mSendBatchDepth)
+	{
+		flushSendBatch();
+	}
+}
+
+void LLPacketRing::flushSendBatch()
+{
+	if (mSendBatchCount)
+	{
+		LLPacketBuffer::sendBatch(mSendBatchSocket, &mSendBatch[0], mSendBatchCount);
+		mSendBatchCount = 0;
+	}
+}
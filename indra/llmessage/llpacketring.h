@@ -29,6 +29,7 @@
 #define LL_LLPACKETRING_H
 
 #include <queue>
+#include <vector>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
@@ -50,11 +51,22 @@ public:
 	void setUseOutThrottle(const BOOL use_throttle);
 	void setInBandwidth(const F32 bps);
 	void setOutBandwidth(const F32 bps);
+	// Receive and send up to NET_BATCH_SIZE packets per system call
+	// when neither the throttles nor the SOCKS proxy are in use.
+	void setUseBatching(const BOOL use_batching);
+	// True when packets must come through receivePacket(): it holds some
+	// already, or the in throttle, packet loss or SOCKS proxy is on.
+	bool isReceiveFiltered() const;
 	S32  receivePacket (S32 socket, char *datap);
 	S32  receiveFromRing (S32 socket, char *datap);
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, const LLHost& host);
 
+	// Sends made between these calls are held and go out together at
+	// the end, or whenever a batch fills.  Calls may nest.
+	void beginSendBatch();
+	void endSendBatch();
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
 
@@ -83,8 +95,19 @@ protected:
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
+	BOOL mUseBatching;
+	std::vector<LLPacketBuffer> mReceiveBatch;	// preallocated, NET_BATCH_SIZE
+	S32 mReceiveBatchCount;			// packets in mReceiveBatch
+	S32 mReceiveBatchNext;			// next one to hand out
+	std::vector<LLPacketBuffer> mSendBatch;		// preallocated, NET_BATCH_SIZE
+	S32 mSendBatchCount;
+	S32 mSendBatchDepth;			// beginSendBatch() nesting
+	int mSendBatchSocket;
+
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host);
+	S32  receiveFromBatch(S32 socket, char *datap);
+	void flushSendBatch();
 };
 
 
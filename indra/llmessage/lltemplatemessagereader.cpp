@@ -445,9 +445,10 @@ S32 LLTemplateMessageReader::getMessageSize() const
 }
 
 // Returns template for the message contained in buffer
-BOOL LLTemplateMessageReader::decodeTemplate(  
-		const U8* buffer, S32 buffer_size,  // inputs
-		LLMessageTemplate** msg_template, BOOL custom) // outputs
+// static
+LLMessageTemplate* LLTemplateMessageReader::decodeTemplate(
+		const message_template_number_map_t& numbers,
+		const U8* buffer, S32 buffer_size, BOOL custom)
 {
 	const U8* header = buffer + LL_PACKET_ID_SIZE;
 
@@ -455,7 +456,7 @@ BOOL LLTemplateMessageReader::decodeTemplate(
 	if (buffer_size <= 0)
 	{
 		LL_WARNS() << "No message waiting for decode!" << LL_ENDL;
-		return(FALSE);
+		return nullptr;
 	}
 
 	U32 num = 0;
@@ -492,15 +493,11 @@ BOOL LLTemplateMessageReader::decodeTemplate(
 		if (!custom)
 		LL_WARNS() << "Packet with unusable length received (too short): "
 				<< buffer_size << LL_ENDL;
-		return(FALSE);
+		return nullptr;
 	}
 
-	LLMessageTemplate* temp = get_ptr_in_map(mMessageNumbers,num);
-	if (temp)
-	{
-		*msg_template = temp;
-	}
-	else
+	LLMessageTemplate* temp = get_ptr_in_map(numbers,num);
+	if (!temp)
 	{
 		if (!custom)
 		{
@@ -508,10 +505,10 @@ BOOL LLTemplateMessageReader::decodeTemplate(
 			<< " received but not registered!" << LL_ENDL;
 		//gMessageSystem->callExceptionFunc(MX_UNREGISTERED_MESSAGE);
 		}
-		return(FALSE);
+		return nullptr;
 	}
 
-	return(TRUE);
+	return temp;
 }
 
 void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted )
@@ -543,18 +540,32 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 	llassert( !mCurrentRMessageData );
 	delete mCurrentRMessageData; // just to make sure
 
+	overrun_list_t overruns;
+	mCurrentRMessageData = decodeBlocks(mCurrentRMessageTemplate, buffer, mReceiveSize, overruns, custom);
+	if (!mCurrentRMessageData)
+	{
+		return FALSE;
+	}
+	return dispatchData(sender, overruns, custom);
+}
+
+// static
+LLMsgData* LLTemplateMessageReader::decodeBlocks(const LLMessageTemplate* msg_template,
+												 const U8* buffer, S32 buffer_size,
+												 overrun_list_t& overruns, BOOL custom)
+{
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
-	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(msg_template->mFrequency) + offset;
 
 	// create base working data set
-	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
+	LLMsgData* data = new LLMsgData(msg_template->mName);
 	
 	// loop through the template building the data structure as we go
 	LLMessageTemplate::message_block_map_t::const_iterator iter;
-	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+	for(iter = msg_template->mMemberBlocks.begin();
+		iter != msg_template->mMemberBlocks.end();
 		++iter)
 	{
 		LLMessageBlock* mbci = *iter;
@@ -577,7 +588,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		{
 			// need to read the number from the message
 			// repeat number is a single byte
-			if (decode_pos >= mReceiveSize)
+			if (decode_pos >= buffer_size)
 			{
 				// commented out - hetgrid says that missing variable blocks
 				// at end of message are legal
@@ -596,7 +607,8 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		{
 			if (!custom)
 			LL_ERRS() << "Unknown block type" << LL_ENDL;
-			return FALSE;
+			delete data;
+			return nullptr;
 		}
 
 		LLMsgBlkData* cur_data_block = nullptr;
@@ -617,7 +629,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 			}
 
 			// add the block to the message
-			mCurrentRMessageData->addBlock(cur_data_block);
+			data->addBlock(cur_data_block);
 
 			// now read the variables
 			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
@@ -639,10 +651,9 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 					U16 tsizeh = 0;
 					U32 tsize = 0;
 
-					if ((decode_pos + data_size) > mReceiveSize)
+					if ((decode_pos + data_size) > buffer_size)
 					{
-						if (!custom)
-						logRanOffEndOfPacket(sender, decode_pos, data_size);
+						overruns.push_back(std::make_pair(decode_pos, data_size));
 
 						// default to 0 length variable blocks
 						tsize = 0;
@@ -676,10 +687,9 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 				{
 					// fixed!
 					// so, copy data pointer and set data size to fixed size
-					if ((decode_pos + mvci.getSize()) > mReceiveSize)
+					if ((decode_pos + mvci.getSize()) > buffer_size)
 					{
-						if (!custom)
-						logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+						overruns.push_back(std::make_pair(decode_pos, (S32)mvci.getSize()));
 
 						// default to 0s.
 						U32 size = mvci.getSize();
@@ -700,6 +710,19 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		}
 	}
 
+	return data;
+}
+
+BOOL LLTemplateMessageReader::dispatchData(const LLHost& sender, const overrun_list_t& overruns, BOOL custom)
+{
+	if (!custom)
+	{
+		for (const auto& overrun : overruns)
+		{
+			logRanOffEndOfPacket(sender, overrun.first, overrun.second);
+		}
+	}
+
 	if (mCurrentRMessageData->mMemberBlocks.empty()
 		&& !mCurrentRMessageTemplate->mMemberBlocks.empty())
 	{
@@ -767,7 +790,8 @@ BOOL LLTemplateMessageReader::validateMessage(const U8* buffer,
 											  BOOL custom)
 {
 	mReceiveSize = buffer_size;
-	BOOL valid = decodeTemplate(buffer, buffer_size, &mCurrentRMessageTemplate, custom );
+	mCurrentRMessageTemplate = decodeTemplate(mMessageNumbers, buffer, buffer_size, custom);
+	BOOL valid = mCurrentRMessageTemplate != nullptr;
 	if(valid && !custom)
 	{
 		mCurrentRMessageTemplate->mReceiveCount++;
@@ -803,6 +827,54 @@ BOOL LLTemplateMessageReader::readMessage(const U8* buffer,
 	return decodeData(buffer, sender);
 }
 
+BOOL LLTemplateMessageReader::validateDecodedMessage(LLMessageTemplate* msg_template,
+													 S32 buffer_size,
+													 const LLHost& sender,
+													 bool trusted)
+{
+	mReceiveSize = buffer_size;
+	mCurrentRMessageTemplate = msg_template;
+	if (!msg_template)
+	{
+		return FALSE;
+	}
+	msg_template->mReceiveCount++;
+
+	if (isBanned(trusted))
+	{
+		LL_WARNS("Messaging") << "LLMessageSystem::checkMessages "
+			<< "received banned message "
+			<< getMessageName()
+			<< " from "
+			<< ((trusted) ? "trusted " : "untrusted ")
+			<< sender << LL_ENDL;
+		return FALSE;
+	}
+
+	if (isUdpBanned())
+	{
+		LL_WARNS() << "Received UDP black listed message "
+				<<  getMessageName()
+				<< " from " << sender << LL_ENDL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL LLTemplateMessageReader::readDecodedMessage(LLMsgData* data,
+												 const overrun_list_t& overruns,
+												 const LLHost& sender)
+{
+	llassert( mCurrentRMessageTemplate );
+	delete mCurrentRMessageData;
+	mCurrentRMessageData = data;
+	if (!mCurrentRMessageData)
+	{
+		return FALSE;
+	}
+	return dispatchData(sender, overruns, FALSE);
+}
+
 //virtual 
 const char* LLTemplateMessageReader::getMessageName() const
 {
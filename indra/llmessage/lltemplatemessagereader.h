@@ -29,6 +29,9 @@
 
 #include "llmessagereader.h"
 
+#include <map>
+#include <vector>
+
 class LLMessageTemplate;
 class LLMsgData;
 
@@ -37,6 +40,8 @@ class LLTemplateMessageReader : public LLMessageReader
 public:
 
 	typedef std::map<U32, LLMessageTemplate*> message_template_number_map_t;
+	// Position and size of reads that ran off the end of a packet
+	typedef std::vector<std::pair<S32, S32> > overrun_list_t;
 
 	LLTemplateMessageReader(message_template_number_map_t&);
 	virtual ~LLTemplateMessageReader();
@@ -107,15 +112,32 @@ public:
 	BOOL decodeData(const U8* buffer, const LLHost& sender, BOOL custom = FALSE);
 	LLMessageTemplate* getTemplate();
 
+	// Counterparts of validateMessage() and readMessage() for packets
+	// decoded by decodeTemplate() and decodeBlocks() off this thread.
+	// readDecodedMessage() takes ownership of data.
+	BOOL validateDecodedMessage(LLMessageTemplate* msg_template, S32 buffer_size,
+								const LLHost& sender, bool trusted = false);
+	BOOL readDecodedMessage(LLMsgData* data, const overrun_list_t& overruns,
+							const LLHost& sender);
+
+	// Thread safe as long as no templates are added meanwhile.
+	// Returns the template for an expanded packet, nullptr if unknown.
+	static LLMessageTemplate* decodeTemplate(const message_template_number_map_t& numbers,
+											 const U8* buffer, S32 buffer_size, BOOL custom = FALSE);
+	// Builds the blocks of an expanded packet without logging or
+	// calling handlers, overruns collects reads past its end.
+	static LLMsgData* decodeBlocks(const LLMessageTemplate* msg_template,
+								   const U8* buffer, S32 buffer_size,
+								   overrun_list_t& overruns, BOOL custom = FALSE);
+
 private:
 
 	void getData(const char *blockname, const char *varname, void *datap, 
 				 S32 size = 0, S32 blocknum = 0, S32 max_size = S32_MAX);
 
-	BOOL decodeTemplate(const U8* buffer, S32 buffer_size,  // inputs
-						LLMessageTemplate** msg_template, BOOL custom = FALSE);	// outputs
-
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
+	// Handler call and decode timing for mCurrentRMessageData
+	BOOL dispatchData(const LLHost& sender, const overrun_list_t& overruns, BOOL custom);
 
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
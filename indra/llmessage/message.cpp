@@ -58,6 +58,7 @@
 #include "lltrustedmessageservice.h"
 #include "llmessagetemplate.h"
 #include "llmessagetemplateparser.h"
+#include "llpacketdecodethread.h"
 #include "llsd.h"
 #include "llsdmessagebuilder.h"
 #include "llsdmessagereader.h"
@@ -152,6 +153,8 @@ void LLMessageSystem::init()
 	// initialize member variables
 	mVerboseLog = FALSE;
 
+	mDecodeThread = nullptr;
+
 	mbError = FALSE;
 	mErrorCode = 0;
 	mSendReliable = FALSE;
@@ -321,6 +324,9 @@ void LLMessageSystem::loadTemplateFile(const std::string& filename, bool failure
 
 LLMessageSystem::~LLMessageSystem()
 {
+	// The decode thread reads the templates
+	stopDecodeThread();
+
 	mMessageTemplates.clear(); // don't delete templates.
 	for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
@@ -499,9 +505,16 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		mMessageCountTime = getMessageTimeSeconds();
 	}
 
+	if (mDecodeThread && mPacketRing.isReceiveFiltered())
+	{
+		LL_INFOS("Messaging") << "Packet ring filters receives, stopping the decode thread" << LL_ENDL;
+		stopDecodeThread();
+	}
+
 	// loop until either no packets or a valid packet
 	// i.e., burn through packets from unregistered circuits
 	S32 receive_size = 0;
+	LLPacketDecodeThread::packet_ptr_t decoded;
 	do
 	{
 		clearReceiveState();
@@ -513,7 +526,22 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 
 		U8* buffer = mTrueReceiveBuffer;
 
-		if(!faked_message)
+		decoded.reset();
+		if(!faked_message && mDecodeThread)
+		{
+			decoded = mDecodeThread->pop();
+			mTrueReceiveSize = 0;
+			if (decoded)
+			{
+				// Keep the raw packet where logging and the acks expect it
+				mTrueReceiveSize = decoded->mRawSize;
+				memcpy(mTrueReceiveBuffer, decoded->mRaw, mTrueReceiveSize); /* Flawfinder: ignore*/
+				mLastSender = decoded->mSender;
+				mLastReceivingIF = decoded->mReceivingIF;
+			}
+			receive_size = mTrueReceiveSize;
+		}
+		else if(!faked_message)
 		{
 		
 			mTrueReceiveSize = mPacketRing.receivePacket(mSocket, (char *)mTrueReceiveBuffer);
@@ -578,7 +606,9 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			}
 
 			// process the message as normal
-			mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			mIncomingCompressedSize = decoded
+				? useDecodedPacket(*decoded, &buffer, &receive_size)
+				: zeroCodeExpand(&buffer, &receive_size);
 			U32 cur_rec_pkt_id = 0U;
 			memcpy(&cur_rec_pkt_id, buffer + PHL_PACKET_ID, sizeof(cur_rec_pkt_id));
 			mCurrentRecvPacketID = ntohl(cur_rec_pkt_id);
@@ -598,7 +628,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 				for(S32 i = 0; i < acks; ++i)
 				{
 					true_rcv_size -= sizeof(TPACKETID);
-					memcpy(&mem_id, &buffer[true_rcv_size], /* Flawfinder: ignore*/
+					memcpy(&mem_id, &mTrueReceiveBuffer[true_rcv_size], /* Flawfinder: ignore*/
 					     sizeof(TPACKETID));
 					packet_id = ntohl(mem_id);
 					//LL_INFOS("Messaging") << "got ack: " << packet_id << LL_ENDL;
@@ -664,11 +694,17 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			// But we don't want to acknowledge UseCircuitCode until the circuit is
 			// available, which is why the acknowledgement test is done above.  JC
 			bool trusted = cdp && cdp->getTrusted();
-			valid_packet = mTemplateMessageReader->validateMessage(
-				buffer,
-				receive_size,
-				host,
-				trusted);
+			valid_packet = decoded
+				? mTemplateMessageReader->validateDecodedMessage(
+					decoded->mTemplate,
+					receive_size,
+					host,
+					trusted)
+				: mTemplateMessageReader->validateMessage(
+					buffer,
+					receive_size,
+					host,
+					trusted);
 			if (!valid_packet)
 			{
 				clearReceiveState();
@@ -703,7 +739,9 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			if( valid_packet )
 			{
 				logValidMsg(cdp, host, recv_reliable, recv_resent, (BOOL)(acks>0) );
-				valid_packet = mTemplateMessageReader->readMessage(buffer, host);
+				valid_packet = decoded
+					? mTemplateMessageReader->readDecodedMessage(decoded->takeData(), decoded->mOverruns, host)
+					: mTemplateMessageReader->readMessage(buffer, host);
 			}
 
 			// It's possible that the circuit went away, because ANY message can disable the circuit
@@ -720,7 +758,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 				if (cdp && recv_reliable)
 				{
 					// Add to the recently received list for duplicate suppression
-					cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
+					cdp->mRecentlyReceivedReliablePackets.set(mCurrentRecvPacketID, getMessageTimeUsecs());
 
 					// Put it onto the list of packets to be acked
 					cdp->collectRAck(mCurrentRecvPacketID);
@@ -790,6 +828,9 @@ void LLMessageSystem::processAcks(F32 collect_time)
 
 	BOOL dump = FALSE;
 	{
+		// Resends and acks go out in as few system calls as possible
+		mPacketRing.beginSendBatch();
+
 		// Check the status of circuits
 		mCircuitInfo.updateWatchDogTimers(this);
 
@@ -799,6 +840,8 @@ void LLMessageSystem::processAcks(F32 collect_time)
 		//cycle through ack list for each host we need to send acks to
 		mCircuitInfo.sendAcks(collect_time);
 
+		mPacketRing.endSendBatch();
+
 		if (!mDenyTrustedCircuitSet.empty())
 		{
 			LL_INFOS("Messaging") << "Sending queued DenyTrustedCircuit messages." << LL_ENDL;
@@ -2580,6 +2623,34 @@ bool start_messaging_system(
 	return TRUE;
 }
 
+void LLMessageSystem::startDecodeThread()
+{
+	if (mDecodeThread || mbError || !mSocket)
+	{
+		return;
+	}
+	if (mPacketRing.isReceiveFiltered())
+	{
+		LL_INFOS("Messaging") << "Packet ring filters receives, not starting the decode thread" << LL_ENDL;
+		return;
+	}
+
+	mDecodeThread = new LLPacketDecodeThread(mSocket, mMessageNumbers);
+	mDecodeThread->start();
+	LL_INFOS("Messaging") << "Decoding packets on a separate thread" << LL_ENDL;
+}
+
+void LLMessageSystem::stopDecodeThread()
+{
+	if (mDecodeThread)
+	{
+		// Whatever it still holds is dropped, like a full socket buffer
+		// would, reliable messages are resent.
+		delete mDecodeThread;
+		mDecodeThread = nullptr;
+	}
+}
+
 void LLMessageSystem::startLogging()
 {
 	mVerboseLog = TRUE;
@@ -2896,18 +2967,61 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
+	S32 out_size = zeroCodeExpandBuffer(*data, in_size, mEncodedRecvBuffer);
+	if (out_size < 0)
+	{
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << LL_ENDL;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+		out_size = 0;
+	}
 	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
+	*data = mEncodedRecvBuffer;
+	*data_size = out_size;
+	mUncompressedBytesIn += *data_size;
+
+	return(in_size);
+}
+
+S32 LLMessageSystem::useDecodedPacket(const LLDecodedPacket& packet, U8** data, S32* data_size)
+{
+	mTotalBytesIn += *data_size;
+
+	if (!packet.mCompressedSize)
+	{
+		return 0;
+	}
+
+	mCompressedPacketsIn++;
+	mCompressedBytesIn += *data_size;
+	if (packet.mOverflowed)
+	{
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << LL_ENDL;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+	}
+
+	*data = packet.mMessage;
+	*data_size = packet.mMessageSize;
+	mUncompressedBytesIn += *data_size;
+
+	return packet.mCompressedSize;
+}
+
+// static
+S32 LLMessageSystem::zeroCodeExpandBuffer(const U8* in, S32 in_size, U8* out)
+{
+	S32 count = in_size;
+	
+	const U8 *inptr = in;
+	U8 *outptr = out;
 
 // skip the packet id field
 
-	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE; ++ii)
+	for (U32 ii = 0; ii < LL_PACKET_ID_SIZE && count > 0; ++ii)
 	{
 		count--;
 		*outptr++ = *inptr++;
 	}
+	out[0] &= (~LL_ZERO_CODE_FLAG);
 
 // reconstruct encoded packet, keeping track of net size gain
 
@@ -2916,25 +3030,18 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 	while (count--)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+		if (outptr > (&out[MAX_BUFFER_SIZE-1]))
 		{
-			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
-			break;
+			return -1;
 		}
 		if (!((*outptr++ = *inptr++)))
 		{
 			while (((count--)) && (!(*inptr)))
 			{
 				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+  				if (outptr > (&out[MAX_BUFFER_SIZE-256]))
   				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
-					count = -1;
-					break;
+					return -1;
   				}
 				memset(outptr,0,255);
 				outptr += 255;
@@ -2947,11 +3054,9 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 			else
 			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+  				if (outptr > (&out[MAX_BUFFER_SIZE-(*inptr)]))
 				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
+					return -1;
 				}
 				memset(outptr,0,(*inptr) - 1);
 				outptr += ((*inptr) - 1);
@@ -2960,11 +3065,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		}		
 	}
 	
-	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
-	mUncompressedBytesIn += *data_size;
-
-	return(in_size);
+	return (S32)(outptr - out);
 }
 
 
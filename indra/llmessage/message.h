@@ -184,6 +184,8 @@ class LLSDMessageBuilder;
 class LLMessageReader;
 class LLTemplateMessageReader;
 class LLSDMessageReader;
+class LLPacketDecodeThread;
+struct LLDecodedPacket;
 
 
 
@@ -455,6 +457,10 @@ public:
 
 	S32     zeroCode(U8 **data, S32 *data_size);
 	S32		zeroCodeExpand(U8 **data, S32 *data_size);
+	// Expands the zero-coded packet in into out, which holds MAX_BUFFER_SIZE
+	// bytes. Returns the expanded size, -1 if it would not fit. Touches no
+	// state, the decode thread expands with it too.
+	static S32 zeroCodeExpandBuffer(const U8* in, S32 in_size, U8* out);
 	S32		zeroCodeAdjustCurrentSendTotal();
 
 	// Uses ping-based retry
@@ -662,6 +668,13 @@ public:
 
 	U32		getListenPort( void ) const;
 
+	// Receives, expands and decodes packets on a thread of its own, the
+	// handlers still run in checkMessages(). Refuses to start while the
+	// packet ring filters receives, and stops once it does.
+	void	startDecodeThread();
+	void	stopDecodeThread();
+	bool	isDecodeThreadRunning() const		{ return mDecodeThread != nullptr; }
+
 	void startLogging();					// start verbose  logging
 	void stopLogging();						// flush and close file
 	void summarizeLogs(std::ostream& str);	// log statistics
@@ -810,6 +823,11 @@ private:
 
 	void init(); // ctor shared initialisation.
 
+	// zeroCodeExpand() for a packet the decode thread expanded
+	S32 useDecodedPacket(const LLDecodedPacket& packet, U8** data, S32* data_size);
+
+	LLPacketDecodeThread* mDecodeThread;
+
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 	S32 mIncomingCompressedSize;		// original size of compressed msg (0 if uncomp.)
@@ -36,6 +36,7 @@
 #else
 	#include <sys/types.h>
 	#include <sys/socket.h>
+	#include <sys/select.h>
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
 	#include <fcntl.h>
@@ -523,12 +524,30 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+// Destination address from the IP_PKTINFO of a received message
+static void get_destip(struct msghdr *msg, U32 *dstip)
+{
+	for (struct cmsghdr *cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
+	{
+		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		{
+			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+			if( pktinfo )
+			{
+				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+				// routed. We should stay with specified until we go to multiple
+				// interfaces
+				*dstip = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
 	int size;
 	struct iovec iov[1];
 	char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-	struct cmsghdr *cmsgptr;
 	struct msghdr msg = {0};
 
 	iov[0].iov_base = buf;
@@ -548,20 +567,7 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
 		return -1;
 	}
 
-	for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-	{
-		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-		{
-			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-			if( pktinfo )
-			{
-				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-				// routed. We should stay with specified until we go to multiple
-				// interfaces
-				*dstip = pktinfo->ipi_spec_dst.s_addr;
-			}
-		}
-	}
+	get_destip(&msg, dstip);
 
 	return size;
 }
@@ -657,6 +663,158 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 	return success;
 }
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	struct mmsghdr msgs[NET_BATCH_SIZE];
+	struct iovec iovs[NET_BATCH_SIZE];
+	struct sockaddr_in addrs[NET_BATCH_SIZE];
+	char cmsgs[NET_BATCH_SIZE][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, NET_BATCH_SIZE);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = datagrams[i].mData;
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, 0, NULL);
+	while (received == -1 && (errno == EINTR || errno == ECONNREFUSED))
+	{
+		if (errno == ECONNREFUSED)
+		{
+			// ICMP connection refused for an earlier send, reported once
+			// and ahead of any datagrams still waiting
+			LL_DEBUGS("Messaging") << "recvmmsg() reported connection refused, receiving again" << LL_ENDL;
+		}
+		received = recvmmsg(hSocket, msgs, count, 0, NULL);
+	}
+	if (received == -1)
+	{
+		// The socket is non-blocking, EAGAIN only means nothing is waiting
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			LL_INFOS() << "recvmmsg() failed: " << errno << ", " << strerror(errno) << LL_ENDL;
+		}
+		return 0;
+	}
+	if (received == 0)
+	{
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLNetDatagram& datagram(datagrams[i]);
+		datagram.mSize = msgs[i].msg_len;
+		datagram.mAddress = addrs[i].sin_addr.s_addr;
+		datagram.mPort = ntohs(addrs[i].sin_port);
+		datagram.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+		get_destip(&msgs[i].msg_hdr, &datagram.mReceivingIF);
+	}
+
+	// Leave get_sender() describing the last one, as receive_packet() does
+	stSrcAddr = addrs[received - 1];
+	gsnReceivingIFAddr = datagrams[received - 1].mReceivingIF;
+
+	return received;
+}
+
+BOOL send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	struct mmsghdr msgs[NET_BATCH_SIZE];
+	struct iovec iovs[NET_BATCH_SIZE];
+	struct sockaddr_in addrs[NET_BATCH_SIZE];
+	BOOL success = TRUE;
+
+	while (count > 0)
+	{
+		S32 batch = llmin(count, NET_BATCH_SIZE);
+		memset(msgs, 0, sizeof(msgs[0]) * batch);
+		memset(addrs, 0, sizeof(addrs[0]) * batch);
+		for (S32 i = 0; i < batch; ++i)
+		{
+			addrs[i].sin_family = AF_INET;
+			addrs[i].sin_addr.s_addr = datagrams[i].mAddress;
+			addrs[i].sin_port = htons(datagrams[i].mPort);
+			iovs[i].iov_base = datagrams[i].mData;
+			iovs[i].iov_len = datagrams[i].mSize;
+			msgs[i].msg_hdr.msg_name = &addrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int sent = sendmmsg(hSocket, msgs, batch, 0);
+		if (sent <= 0)
+		{
+			// The first datagram failed, let send_packet() retry or
+			// report it and carry on with the rest.
+			success = send_packet(hSocket, datagrams[0].mData, datagrams[0].mSize,
+								  datagrams[0].mAddress, datagrams[0].mPort) && success;
+			sent = 1;
+		}
+		datagrams += sent;
+		count -= sent;
+	}
+
+	return success;
+}
+#endif
+
 #endif
 
+#if !LL_LINUX
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	S32 received = 0;
+	while (received < count)
+	{
+		S32 size = receive_packet(hSocket, datagrams[received].mData);
+		if (size <= 0)
+		{
+			break;
+		}
+		LLNetDatagram& datagram(datagrams[received++]);
+		datagram.mSize = size;
+		datagram.mAddress = get_sender_ip();
+		datagram.mPort = get_sender_port();
+		datagram.mReceivingIF = get_receiving_interface_ip();
+	}
+	return received;
+}
+
+BOOL send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	BOOL success = TRUE;
+	for (S32 i = 0; i < count; ++i)
+	{
+		success = send_packet(hSocket, datagrams[i].mData, datagrams[i].mSize,
+							  datagrams[i].mAddress, datagrams[i].mPort) && success;
+	}
+	return success;
+}
+#endif
+
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_fds;
+	FD_ZERO(&read_fds);
+	FD_SET(hSocket, &read_fds);
+
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+	// The first argument is ignored by winsock
+	return select(hSocket + 1, &read_fds, nullptr, nullptr, &timeout) > 0;
+}
+
 //EOF
@@ -45,6 +45,31 @@ S32		receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// A datagram for the batched calls.  mData must hold NET_BUFFER_SIZE
+// bytes when receiving.
+struct LLNetDatagram
+{
+	char*	mData;
+	S32		mSize;
+	U32		mAddress;		// network byte order, as in LLHost
+	U32		mPort;
+	U32		mReceivingIF;
+};
+
+// Most datagrams moved by one batched call
+const S32 NET_BATCH_SIZE = 64;
+
+// Receives up to count datagrams, returns how many arrived.  Linux
+// takes them in one system call, elsewhere this loops on receive_packet().
+S32		receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count);
+
+// Sends count datagrams, one system call per NET_BATCH_SIZE on Linux.
+// Returns TRUE if all were sent.
+BOOL	send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count);
+
+// Waits up to timeout_ms for a datagram to arrive, returns TRUE if one did.
+BOOL	wait_for_packet(int hSocket, S32 timeout_ms);
+
 //void	get_sender(char * tmp);
 LLHost	get_sender();
 U32		get_sender_port();
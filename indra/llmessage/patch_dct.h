@@ -88,4 +88,26 @@ void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
+// A patch read from the bitstream, waiting for its inverse DCT.
+class LLPatchDecode
+{
+public:
+	F32	*patch;			// first height of the patch, rows are stride apart
+	S32	size;			// NORMAL_PATCH_SIZE or LARGE_PATCH_SIZE
+	S32	stride;
+	LLPatchHeader header;
+	S32	cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];	// as decode_patch() left them
+};
+
+// Thread safe versions of decompress_patch() with SSE kernels. They don't use
+// the state set by init_patch_decompressor() and set_group_of_patch_header(),
+// and their heights match decompress_patch() bit for bit.
+void decompress_patch_simd(F32 *patch, const S32 *cpatch, const LLPatchHeader *ph, S32 size, S32 stride);
+// Splits decodes into runs of about the same size and decompresses them on
+// the calling thread and threads kept from one call to the next. Returns
+// once every run is done. The patches must not overlap.
+void decompress_patches(LLPatchDecode *decodes, S32 count, S32 runs);
+// A run count for decompress_patches(), more than one from a few patches.
+S32 get_patch_decompress_runs(S32 count);
+
 #endif
@@ -29,7 +29,11 @@
 #include "llmath.h"
 //#include "vmath.h"
 #include "v3math.h"
+#include "llvector4a.h"
 #include "patch_dct.h"
+#include "llthreadteam.h"
+
+#include <thread>
 
 LLGroupHeader	*gGOPP;
 
@@ -39,14 +43,14 @@ void set_group_of_patch_header(LLGroupHeader *gopp)
 }
 
 F32 gPatchDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-void build_patch_dequantize_table(S32 size)
+void build_patch_dequantize_table(F32 *table, S32 size)
 {
 	S32 i, j;
 	for (j = 0; j < size; j++)
 	{
 		for (i = 0; i < size; i++)
 		{
-			gPatchDequantizeTable[j*size + i] = (1.f + 2.f*(i+j));
+			table[j*size + i] = (1.f + 2.f*(i+j));
 		}
 	}
 }
@@ -55,7 +59,7 @@ S32	gCurrentDeSize = 0;
 
 F32	gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void setup_patch_icosines(S32 size)
+void setup_patch_icosines(F32 *icosines, S32 size)
 {
 	S32 n, u;
 	F32 oosob = F_PI*0.5f/size;
@@ -64,14 +68,14 @@ void setup_patch_icosines(S32 size)
 	{
 		for (n = 0; n < size; n++)
 		{
-			gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+			icosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
 		}
 	}
 }
 
 S32	gDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-void build_decopy_matrix(S32 size)
+void build_decopy_matrix(S32 *decopy_matrix, S32 size)
 {
 	S32 i, j, count;
 	BOOL	b_diag = FALSE;
@@ -84,7 +88,7 @@ void build_decopy_matrix(S32 size)
 	while (  (i < size)
 		   &&(j < size))
 	{
-		gDeCopyMatrix[j*size + i] = count;
+		decopy_matrix[j*size + i] = count;
 
 		count++;
 
@@ -140,9 +144,9 @@ void init_patch_decompressor(S32 size)
 	if (size != gCurrentDeSize)
 	{
 		gCurrentDeSize = size;
-		build_patch_dequantize_table(size);
-		setup_patch_icosines(size);
-		build_decopy_matrix(size);
+		build_patch_dequantize_table(gPatchDequantizeTable, size);
+		setup_patch_icosines(gPatchICosines, size);
+		build_decopy_matrix(gDeCopyMatrix, size);
 	}
 }
 
@@ -682,3 +686,221 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 	}
 }
 
+// Thread safe decompression. Each patch size gets its own tables, built on
+// first use and read only afterwards, and the patch size and stride are
+// passed in rather than taken from gGOPP.
+
+namespace
+{
+	template <S32 SIZE>
+	class LLPatchTables
+	{
+	public:
+		LLPatchTables()
+		{
+			build_patch_dequantize_table(mDequantize, SIZE);
+			setup_patch_icosines(mICosines, SIZE);
+			build_decopy_matrix(mDeCopy, SIZE);
+		}
+
+		static const LLPatchTables& instance()
+		{
+			static const LLPatchTables tables;
+			return tables;
+		}
+
+		LL_ALIGN_16(F32 mDequantize[SIZE*SIZE]);
+		LL_ALIGN_16(F32 mICosines[SIZE*SIZE]);
+		S32 mDeCopy[SIZE*SIZE];
+	};
+
+	// Both passes build each output row as a sum of input rows, weighted by
+	// one factor per row, sixteen outputs at a time in four registers:
+	//  columns: out[n][] = OO_SQRT2*in[0][] + sum over u of cos[u][n]*in[u][]
+	//  lines:   out[l][] = OO_SQRT2*in[l][0] + sum over u of in[l][u]*cos[u][]
+	// Every element is summed in the same order as idct_patch() and
+	// idct_patch_large(), one multiply then one add per term, so the
+	// results are the same to the bit.
+	// Coefficients are only found in the corner of the block above row rows
+	// and left of column columns, usually a small one. The terms outside it
+	// are zeros, and the sums never hold -0 for a +0 or -0 term to change,
+	// so they are left out.
+
+	// total[0..3] += factor*in[0..15]
+	inline void idct_accumulate(LLVector4a *total, const LLVector4a& factor, const F32 *in)
+	{
+		LLVector4a term0, term1, term2, term3;
+		term0.load4a(in);
+		term1.load4a(in + 4);
+		term2.load4a(in + 8);
+		term3.load4a(in + 12);
+		term0.mul(factor);
+		term1.mul(factor);
+		term2.mul(factor);
+		term3.mul(factor);
+		total[0].add(term0);
+		total[1].add(term1);
+		total[2].add(term2);
+		total[3].add(term3);
+	}
+
+	template <S32 SIZE>
+	void idct_patch_simd(F32 *block, const F32 *icosines, S32 rows, S32 columns)
+	{
+		LL_ALIGN_16(F32 temp[SIZE*SIZE]);
+		LLVector4a total[4];
+		LLVector4a factor;
+
+		for (S32 half = 0; half < SIZE; half += 16)
+		{
+			for (S32 n = 0; n < SIZE; n++)
+			{
+				factor.splat(OO_SQRT2);
+				for (S32 v = 0; v < 4; v++)
+				{
+					total[v].load4a(block + half + v*4);
+					total[v].mul(factor);
+				}
+				for (S32 u = 1; u < rows; u++)
+				{
+					factor.splat(icosines[u*SIZE + n]);
+					idct_accumulate(total, factor, block + u*SIZE + half);
+				}
+				for (S32 v = 0; v < 4; v++)
+				{
+					total[v].store4a(temp + n*SIZE + half + v*4);
+				}
+			}
+		}
+
+		const F32 oosob = 2.f/SIZE;
+		for (S32 line = 0; line < SIZE; line++)
+		{
+			const F32 *linein = temp + line*SIZE;
+			for (S32 half = 0; half < SIZE; half += 16)
+			{
+				for (S32 v = 0; v < 4; v++)
+				{
+					total[v].splat(OO_SQRT2*linein[0]);
+				}
+				for (S32 u = 1; u < columns; u++)
+				{
+					factor.splat(linein[u]);
+					idct_accumulate(total, factor, icosines + u*SIZE + half);
+				}
+				factor.splat(oosob);
+				for (S32 v = 0; v < 4; v++)
+				{
+					total[v].mul(factor);
+					total[v].store4a(block + line*SIZE + half + v*4);
+				}
+			}
+		}
+	}
+
+	template <S32 SIZE>
+	void decompress_patch_simd(F32 *patch, const S32 *cpatch, const LLPatchHeader *ph, S32 stride)
+	{
+		const LLPatchTables<SIZE>& tables = LLPatchTables<SIZE>::instance();
+		LL_ALIGN_16(F32 block[SIZE*SIZE]);
+
+		S32		prequant = (ph->quant_wbits >> 4) + 2;
+		S32		quantize = 1<<prequant;
+		F32		ooq = 1.f/(F32)quantize;
+		F32		mult = ooq*ph->range;
+		F32		addval = mult*(F32)(1<<(prequant - 1))+ph->dc_offset;
+
+		S32		rows = 1;
+		S32		columns = 1;
+		for (S32 j = 0; j < SIZE; j++)
+		{
+			for (S32 i = 0; i < SIZE; i++)
+			{
+				S32 coefficient = cpatch[tables.mDeCopy[j*SIZE + i]];
+				if (coefficient)
+				{
+					rows = j + 1;
+					columns = llmax(columns, i + 1);
+				}
+				block[j*SIZE + i] = coefficient*tables.mDequantize[j*SIZE + i];
+			}
+		}
+
+		idct_patch_simd<SIZE>(block, tables.mICosines, rows, columns);
+
+		LLVector4a height, scale, offset;
+		scale.splat(mult);
+		offset.splat(addval);
+		for (S32 j = 0; j < SIZE; j++)
+		{
+			F32 *tpatch = patch + j*stride;
+			for (S32 i = 0; i < SIZE; i += 4)
+			{
+				// Rows of the surface are not aligned
+				height.load4a(block + j*SIZE + i);
+				height.mul(scale);
+				height.add(offset);
+				_mm_storeu_ps(tpatch + i, height);
+			}
+		}
+	}
+
+	// A packet of terrain carries up to a few dozen patches, each a few
+	// microseconds of work, so waking a kept thread pays from a handful
+	const S32 PATCHES_PER_RUN = 4;
+
+	// Started the first time a packet is worth splitting, and kept
+	LLThreadTeam& patch_threads()
+	{
+		static LLThreadTeam team;
+		return team;
+	}
+}
+
+void decompress_patch_simd(F32 *patch, const S32 *cpatch, const LLPatchHeader *ph, S32 size, S32 stride)
+{
+	if (size == NORMAL_PATCH_SIZE)
+	{
+		decompress_patch_simd<NORMAL_PATCH_SIZE>(patch, cpatch, ph, stride);
+	}
+	else
+	{
+		llassert(size == LARGE_PATCH_SIZE);
+		decompress_patch_simd<LARGE_PATCH_SIZE>(patch, cpatch, ph, stride);
+	}
+}
+
+void decompress_patches(LLPatchDecode *decodes, S32 count, S32 runs)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	runs = llclamp(runs, 1, count);
+
+	auto decompress_run = [decodes, count, runs](U32 run)
+	{
+		const S32 end = count*((S32)run + 1)/runs;
+		for (S32 i = count*(S32)run/runs; i < end; i++)
+		{
+			LLPatchDecode& decode = decodes[i];
+			decompress_patch_simd(decode.patch, decode.cpatch, &decode.header,
+								  decode.size, decode.stride);
+		}
+	};
+
+	if (runs > 1)
+	{
+		patch_threads().run(runs, decompress_run);
+	}
+	else
+	{
+		decompress_run(0);
+	}
+}
+
+S32 get_patch_decompress_runs(S32 count)
+{
+	const S32 cores = llmax((S32)std::thread::hardware_concurrency(), 1);
+	return llclamp(count/PATCHES_PER_RUN, 1, cores);
+}
@@ -0,0 +1,218 @@
+/**
+ * @file llpacketidwindow_test.cpp
+ * @brief LLPacketIDWindow test cases, and an ack storm against std::map.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketidwindow.h"
+
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <map>
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	typedef LLPacketIDWindow<S32> window_t;
+
+	std::vector<TPACKETID> ids_of(window_t& window)
+	{
+		std::vector<TPACKETID> ids;
+		for (window_t::iterator it = window.begin(); it != window.end(); ++it)
+		{
+			ids.push_back(it->first);
+		}
+		return ids;
+	}
+
+	// Sends count reliable packets starting at first, acks arriving in
+	// bursts with each burst reversed, as a simulator flushing its ack
+	// list would. Returns the seconds taken.
+	template <class CONTAINER, class INSERT, class ERASE>
+	F64 ack_storm(CONTAINER& unacked, TPACKETID first, U32 count, U32 burst,
+				  INSERT insert, ERASE erase)
+	{
+		LLTimer timer;
+		for (U32 sent = 0; sent < count; sent += burst)
+		{
+			for (U32 i = 0; i < burst; ++i)
+			{
+				insert(unacked, (first + sent + i) & window_t::ID_MASK);
+			}
+			for (U32 i = burst; i > 0; --i)
+			{
+				erase(unacked, (first + sent + i - 1) & window_t::ID_MASK);
+			}
+		}
+		return timer.getElapsedTimeF64();
+	}
+}
+
+namespace tut
+{
+	struct packetidwindow_data
+	{
+	};
+	typedef test_group<packetidwindow_data> packetidwindow_test;
+	typedef packetidwindow_test::object packetidwindow_object;
+	tut::packetidwindow_test packetidwindow_testcase("LLPacketIDWindow");
+
+	template<> template<>
+	void packetidwindow_object::test<1>()
+	{
+		set_test_name("set, find and erase");
+		window_t window;
+		ensure("starts empty", window.empty());
+		ensure("set", window.set(10, 100));
+		ensure("set", window.set(12, 120));
+		ensure("set", window.set(11, 110));
+		ensure_equals("size", window.size(), 3U);
+		ensure_equals("front", window.front(), 10U);
+		ensure("find", window.find(11) != window.end());
+		ensure_equals("value", window.find(11)->second, 110);
+		ensure("missing", window.find(13) == window.end());
+		ensure("high bits ignored", window.contains(0x01000000 | 11)
+			   && window.find(0x01000000 | 11)->first == 11);
+
+		window.set(11, 111);
+		ensure_equals("replaced", window.find(11)->second, 111);
+		ensure_equals("replace keeps size", window.size(), 3U);
+
+		ensure("erase", window.erase(10));
+		ensure("erase twice", !window.erase(10));
+		ensure_equals("front moves", window.front(), 11U);
+		window.erase(12);
+		window.erase(11);
+		ensure("empty again", window.empty());
+		ensure("begin is end", window.begin() == window.end());
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<2>()
+	{
+		set_test_name("sequence order across the wrap");
+		window_t window;
+		window.set(1, 0);
+		window.set(0xFFFFFE, 0);
+		window.set(0, 0);
+		window.set(0xFFFFFF, 0);
+
+		std::vector<TPACKETID> ids(ids_of(window));
+		ensure_equals("count", ids.size(), 4U);
+		ensure_equals("oldest", ids[0], 0xFFFFFEU);
+		ensure_equals("second", ids[1], 0xFFFFFFU);
+		ensure_equals("third", ids[2], 0U);
+		ensure_equals("newest", ids[3], 1U);
+		ensure("precedes across the wrap", window_t::precedes(0xFFFFFF, 0));
+		ensure("follows across the wrap", !window_t::precedes(0, 0xFFFFFF));
+
+		window.eraseBefore(0);
+		ensure_equals("erased before the wrap", window.size(), 2U);
+		ensure_equals("front after the wrap", window.front(), 0U);
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<3>()
+	{
+		set_test_name("erase while iterating");
+		window_t window;
+		for (TPACKETID id = 0; id < 1000; ++id)
+		{
+			window.set(id, (S32)id);
+		}
+		for (window_t::iterator it = window.begin(); it != window.end();)
+		{
+			if (it->second % 2)
+			{
+				window.erase(it++);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		std::vector<TPACKETID> ids(ids_of(window));
+		ensure_equals("evens left", ids.size(), 500U);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			ensure_equals("even, in order", ids[i], (TPACKETID)(i * 2));
+		}
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<4>()
+	{
+		set_test_name("span limit");
+		window_t window(100);
+		window.set(1000, 0);
+		window.set(1050, 0);
+		window.set(1120, 0);
+		ensure_equals("oldest dropped", window.size(), 2U);
+		ensure_equals("front", window.front(), 1050U);
+		ensure("too old refused", !window.set(1000, 0));
+		ensure("old enough kept", window.set(1030, 0));
+		ensure_equals("front moves back", window.front(), 1030U);
+
+		window.set(5000, 0);
+		ensure_equals("far jump keeps only the newest", window.size(), 1U);
+		ensure_equals("front after far jump", window.front(), 5000U);
+
+		window.clear();
+		ensure("cleared", window.empty());
+	}
+
+	template<> template<>
+	void packetidwindow_object::test<5>()
+	{
+		set_test_name("ack storm");
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time the ack storm");
+		}
+
+		const U32 COUNT = 200000;
+		const U32 BURST = 2000;
+		// Start near the wrap so the window crosses it
+		const TPACKETID FIRST = window_t::ID_MASK - COUNT / 2;
+
+		std::map<TPACKETID, S32> map;
+		F64 map_time = ack_storm(map, FIRST, COUNT, BURST,
+			[](std::map<TPACKETID, S32>& unacked, TPACKETID id) { unacked[id] = 0; },
+			[](std::map<TPACKETID, S32>& unacked, TPACKETID id) { unacked.erase(id); });
+
+		window_t window;
+		F64 window_time = ack_storm(window, FIRST, COUNT, BURST,
+			[](window_t& unacked, TPACKETID id) { unacked.set(id, 0); },
+			[](window_t& unacked, TPACKETID id) { unacked.erase(id); });
+
+		ensure("map drained", map.empty());
+		ensure("window drained", window.empty());
+		LL_INFOS() << "ack storm of " << COUNT << " packets: std::map "
+				   << map_time * 1000.0 << " ms, window "
+				   << window_time * 1000.0 << " ms" << LL_ENDL;
+	}
+}
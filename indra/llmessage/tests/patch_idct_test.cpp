@@ -0,0 +1,268 @@
+/**
+ * @file patch_idct_test.cpp
+ * @brief SIMD and batched patch decompression against the scalar kernels.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../patch_dct.h"
+
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// A surface of patches_per_edge patches a side, with the extra north
+	// and east row LLSurface keeps.
+	struct Surface
+	{
+		Surface(S32 patch_size, S32 patches_per_edge)
+		:	mPatchSize(patch_size),
+			mPatchesPerEdge(patches_per_edge),
+			mStride(patch_size*patches_per_edge + 1),
+			mHeights(mStride*mStride, 0.f)
+		{
+		}
+
+		F32* getPatch(S32 index)
+		{
+			S32 i = index % mPatchesPerEdge;
+			S32 j = index / mPatchesPerEdge;
+			return &mHeights[(j*mStride + i)*mPatchSize];
+		}
+
+		S32 getPatchCount() const	{ return mPatchesPerEdge*mPatchesPerEdge; }
+
+		S32 mPatchSize;
+		S32 mPatchesPerEdge;
+		S32 mStride;
+		std::vector<F32> mHeights;
+	};
+
+	// Coefficients like decode_patch() produces: a large DC term and
+	// smaller ones further down the zigzag, with a run of zeros at the end.
+	void make_patches(std::vector<LLPatchDecode>& decodes, Surface& surface, U32 seed)
+	{
+		std::mt19937 random(seed);
+		const S32 size = surface.mPatchSize;
+		decodes.resize(surface.getPatchCount());
+		for (S32 p = 0; p < (S32)decodes.size(); p++)
+		{
+			LLPatchDecode& decode = decodes[p];
+			decode.patch = surface.getPatch(p);
+			decode.size = size;
+			decode.stride = surface.mStride;
+			decode.header.dc_offset = (F32)(random() % 4000)*0.05f - 20.f;
+			decode.header.range = (U16)(1 + random() % 64);
+			decode.header.quant_wbits = (U8)(((random() % 6) << 4) | 0x0F);
+			decode.header.patchids = p;
+
+			memset(decode.cpatch, 0, sizeof(decode.cpatch));
+			const S32 used = 1 + random() % (size*size);
+			for (S32 i = 0; i < used; i++)
+			{
+				const S32 limit = 1 + 256/(i + 1);
+				decode.cpatch[i] = (S32)(random() % (2*limit + 1)) - limit;
+			}
+		}
+	}
+
+	void decompress_scalar(std::vector<LLPatchDecode>& decodes, Surface& surface)
+	{
+		LLGroupHeader gopp;
+		gopp.stride = surface.mStride;
+		gopp.patch_size = surface.mPatchSize;
+		gopp.layer_type = 0;
+		init_patch_decompressor(gopp.patch_size);
+		set_group_of_patch_header(&gopp);
+		for (LLPatchDecode& decode : decodes)
+		{
+			decompress_patch(decode.patch, decode.cpatch, &decode.header);
+		}
+	}
+
+	void decompress_simd(std::vector<LLPatchDecode>& decodes)
+	{
+		for (LLPatchDecode& decode : decodes)
+		{
+			decompress_patch_simd(decode.patch, decode.cpatch, &decode.header,
+								  decode.size, decode.stride);
+		}
+	}
+
+	// Decompresses the same patches into a surface of their own.
+	void retarget(std::vector<LLPatchDecode>& decodes, Surface& surface)
+	{
+		for (S32 p = 0; p < (S32)decodes.size(); p++)
+		{
+			decodes[p].patch = surface.getPatch(p);
+		}
+	}
+
+	// -ffast-math lets the compiler reorder the sums of the scalar kernels,
+	// the heights can then only be as close as the rounding allows.
+	bool same_heights(const Surface& a, const Surface& b)
+	{
+#ifdef __FAST_MATH__
+		F32 largest = 1.f;
+		for (F32 height : a.mHeights)
+		{
+			largest = llmax(largest, fabsf(height));
+		}
+		for (size_t i = 0; i < a.mHeights.size(); i++)
+		{
+			if (fabsf(a.mHeights[i] - b.mHeights[i]) > largest*1e-5f)
+			{
+				return false;
+			}
+		}
+		return true;
+#else
+		return !memcmp(a.mHeights.data(), b.mHeights.data(), a.mHeights.size()*sizeof(F32));
+#endif
+	}
+}
+
+namespace tut
+{
+	struct patch_idct_data
+	{
+		void checkSize(S32 patch_size, S32 patches_per_edge)
+		{
+			Surface scalar(patch_size, patches_per_edge);
+			Surface simd(patch_size, patches_per_edge);
+			Surface batch(patch_size, patches_per_edge);
+			std::vector<LLPatchDecode> decodes;
+			make_patches(decodes, scalar, patch_size);
+
+			decompress_scalar(decodes, scalar);
+			retarget(decodes, simd);
+			decompress_simd(decodes);
+			retarget(decodes, batch);
+			decompress_patches(decodes.data(), (S32)decodes.size(), 4);
+
+			ensure("simd matches scalar", same_heights(scalar, simd));
+			ensure("batch matches scalar", same_heights(scalar, batch));
+		}
+	};
+	typedef test_group<patch_idct_data> patch_idct_test;
+	typedef patch_idct_test::object patch_idct_object;
+	tut::patch_idct_test patch_idct_testcase("patch_idct");
+
+	template<> template<>
+	void patch_idct_object::test<1>()
+	{
+		set_test_name("normal patches match the scalar kernels");
+		checkSize(NORMAL_PATCH_SIZE, 16);
+	}
+
+	template<> template<>
+	void patch_idct_object::test<2>()
+	{
+		set_test_name("large patches match the scalar kernels");
+		checkSize(LARGE_PATCH_SIZE, 8);
+	}
+
+	template<> template<>
+	void patch_idct_object::test<3>()
+	{
+		set_test_name("batch edge cases");
+		Surface surface(NORMAL_PATCH_SIZE, 2);
+		std::vector<LLPatchDecode> decodes;
+		make_patches(decodes, surface, 3);
+
+		decompress_patches(decodes.data(), 0, 4);
+		ensure("nothing decoded", surface.mHeights[0] == 0.f);
+
+		// More runs than patches
+		decompress_patches(decodes.data(), (S32)decodes.size(), 16);
+		Surface scalar(NORMAL_PATCH_SIZE, 2);
+		retarget(decodes, scalar);
+		decompress_scalar(decodes, scalar);
+		ensure("all decoded", same_heights(scalar, surface));
+
+		ensure_equals("small batch", get_patch_decompress_runs(4), 1);
+		ensure("runs at least one", get_patch_decompress_runs(0) >= 1);
+		// A packet's worth of patches is split when there are cores for it
+		ensure("packet split", std::thread::hardware_concurrency() < 2 || get_patch_decompress_runs(16) > 1);
+
+		// Kept threads take batch after batch
+		retarget(decodes, surface);
+		for (S32 pass = 0; pass < 3; pass++)
+		{
+			decompress_patches(decodes.data(), (S32)decodes.size(), 3);
+		}
+		ensure("same again", same_heights(scalar, surface));
+	}
+
+	template<> template<>
+	void patch_idct_object::test<4>()
+	{
+		set_test_name("throughput");
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time patch decompression");
+		}
+
+		const S32 PASSES = 16;
+		Surface surface(NORMAL_PATCH_SIZE, 16);
+		std::vector<LLPatchDecode> decodes;
+		make_patches(decodes, surface, 4);
+		const S32 count = (S32)decodes.size();
+
+		LLTimer timer;
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			decompress_scalar(decodes, surface);
+		}
+		F64 scalar_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			decompress_simd(decodes);
+		}
+		F64 simd_time = timer.getElapsedTimeF64();
+
+		const S32 runs = get_patch_decompress_runs(count);
+		timer.reset();
+		for (S32 pass = 0; pass < PASSES; pass++)
+		{
+			decompress_patches(decodes.data(), count, runs);
+		}
+		F64 batch_time = timer.getElapsedTimeF64();
+
+		LL_INFOS() << PASSES << " regions of " << count << " patches: scalar "
+				   << scalar_time * 1000.0 << " ms, simd "
+				   << simd_time * 1000.0 << " ms, batch of " << runs << " runs "
+				   << batch_time * 1000.0 << " ms" << LL_ENDL;
+	}
+}
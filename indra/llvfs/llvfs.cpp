@@ -224,8 +224,9 @@ struct LLVFSFileBlock_less
 const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
      
 
-LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
-:	mDataFP(nullptr),
+LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash, const BOOL use_mapping)
+:	mMapped(FALSE),
+	mDataFP(nullptr),
 	mIndexFP(nullptr),
     mRemoveAfterCrash(remove_after_crash)
 {
@@ -547,6 +548,20 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 		}
 	}
 
+	if (use_mapping)
+	{
+		// Map what is on disk now. Stores past the end grow the file and
+		// the mapping in steps, as the stdio path grows the file on write.
+		if (mapDataFile(data_size))
+		{
+			LL_INFOS("VFS") << "Mapped " << mMappedFile.getSize() << " bytes of VFS data file " << mDataFilename << LL_ENDL;
+		}
+		else
+		{
+			LL_WARNS("VFS") << "Couldn't map VFS data file " << mDataFilename << ", falling back to stdio" << LL_ENDL;
+		}
+	}
+
 	LL_INFOS("VFS") << "Using VFS index file " << mIndexFilename << LL_ENDL;
 	LL_INFOS("VFS") << "Using VFS data file " << mDataFilename << LL_ENDL;
 
@@ -574,6 +589,8 @@ LLVFS::~LLVFS()
 
 	for_each(mFreeBlocksByLocation.begin(), mFreeBlocksByLocation.end(), DeletePairedPointer());
 	mFreeBlocksByLocation.clear();
+
+	unmapDataFile();
     
 	unlockAndClose(mDataFP);
 	mDataFP = nullptr;
@@ -596,9 +613,10 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 		const std::string& data_filename, 
 		const BOOL read_only, 
 		const U32 presize, 
-		const BOOL remove_after_crash)
+		const BOOL remove_after_crash,
+		const BOOL use_mapping)
 {
-	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash);
+	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash, use_mapping);
 
 	if( !new_vfs->isValid() )
 	{	// First name failed, retry with new names
@@ -612,7 +630,7 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 			retry_vfs_data_name = data_filename + llformat(".%u", count);
 
 			delete new_vfs;	// Delete bad VFS and try again
-			new_vfs = new LLVFS(retry_vfs_index_name, retry_vfs_data_name, read_only, presize, remove_after_crash);
+			new_vfs = new LLVFS(retry_vfs_index_name, retry_vfs_data_name, read_only, presize, remove_after_crash, use_mapping);
 
 			count++;
 		}
@@ -763,6 +781,8 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		return FALSE;
 	}
 
+	// May move or truncate the file's data
+	LLMutexLock file_lock(getFileMutex(file_id));
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -864,7 +884,17 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 
 					addFreeBlock(new_free_block);
 					
-					if (block->mSize > 0)
+					if (block->mSize > 0 && mMapped)
+					{
+						// move the file into the new block
+						if (growMapping(new_data_location + block->mSize))
+						{
+							std::shared_lock<std::shared_mutex> mapping_lock(mMappingMutex);
+							U8 *data = mMappedFile.getData();
+							memmove(data + new_data_location, data + block->mLocation, block->mSize);
+						}
+					}
+					else if (block->mSize > 0)
 					{
 						// move the file into the new block
 						std::vector<U8> buffer(block->mSize);
@@ -956,6 +986,15 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
 	}
 
+	// Both files change hands, take their stripes in a consistent order
+	LLMutex *first_mutex = getFileMutex(file_id);
+	LLMutex *second_mutex = getFileMutex(new_id);
+	if (second_mutex < first_mutex)
+	{
+		std::swap(first_mutex, second_mutex);
+	}
+	LLMutexLock first_lock(first_mutex);
+	LLMutexLock second_lock(second_mutex);
 	lockData();
 	
 	LLVFSFileSpecifier new_spec(new_id, new_type);
@@ -1044,6 +1083,7 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
 	}
 
+	LLMutexLock file_lock(getFileMutex(file_id));
     lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1073,34 +1113,15 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 	llassert(location >= 0);
 	llassert(length >= 0);
 
-	BOOL do_read = FALSE;
-	
-    lockData();
-	
-	LLVFSFileSpecifier spec(file_id, file_type);
-	fileblock_map::iterator it = mFileBlocks.find(spec);
-	if (it != mFileBlocks.end())
+	if (mMapped)
 	{
-		LLVFSFileBlock *block = (*it).second;
-
-		block->mAccessTime = (U32)time(nullptr);
-    
-		if (location > block->mSize)
-		{
-			LL_WARNS() << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << block->mSize << LL_ENDL;
-		}
-		else
-		{
-			if (length > block->mSize - location)
-			{
-				length = block->mSize - location;
-			}
-			location += block->mLocation;
-			do_read = TRUE;
-		}
+		return peekData(file_id, file_type, location, length,
+						[buffer](const U8* data, S32 bytes) { memcpy(buffer, data, bytes); });
 	}
 
-	if (do_read)
+    lockData();
+	
+	if (findReadExtent(file_id, file_type, location, length))
 	{
 		fseek(mDataFP, location, SEEK_SET);
 		bytesread = (S32)fread(buffer, 1, length, mDataFP);
@@ -1110,6 +1131,73 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	return bytesread;
 }
+
+S32 LLVFS::peekData(const LLUUID &file_id, const LLAssetType::EType file_type, S32 location, S32 length, const data_reader_t& reader)
+{
+	if (!isValid())
+	{
+		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
+	}
+	llassert(location >= 0);
+	llassert(length >= 0);
+
+	if (!mMapped)
+	{
+		std::vector<U8> buffer(llmax(length, 1));
+		S32 bytesread = getData(file_id, file_type, &buffer[0], location, length);
+		if (bytesread > 0)
+		{
+			reader(&buffer[0], bytesread);
+		}
+		return bytesread;
+	}
+
+	// Pins the file's data in place until reader is done with it
+	LLMutexLock file_lock(getFileMutex(file_id));
+
+	lockData();
+	BOOL do_read = findReadExtent(file_id, file_type, location, length);
+	unlockData();
+
+	if (!do_read || length <= 0)
+	{
+		return 0;
+	}
+
+	std::shared_lock<std::shared_mutex> mapping_lock(mMappingMutex);
+	llassert((size_t)location + (size_t)length <= mMappedFile.getSize());
+	reader(mMappedFile.getData() + location, length);
+	return length;
+}
+
+// mDataMutex must be LOCKED before calling this
+// Clamps length to the file's size and turns location into a data file offset.
+BOOL LLVFS::findReadExtent(const LLUUID &file_id, const LLAssetType::EType file_type, S32 &location, S32 &length)
+{
+	LLVFSFileSpecifier spec(file_id, file_type);
+	fileblock_map::iterator it = mFileBlocks.find(spec);
+	if (it == mFileBlocks.end())
+	{
+		return FALSE;
+	}
+
+	LLVFSFileBlock *block = (*it).second;
+
+	block->mAccessTime = (U32)time(nullptr);
+
+	if (location > block->mSize)
+	{
+		LL_WARNS() << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << block->mSize << LL_ENDL;
+		return FALSE;
+	}
+
+	if (length > block->mSize - location)
+	{
+		length = block->mSize - location;
+	}
+	location += block->mLocation;
+	return TRUE;
+}
     
 S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
 {
@@ -1124,6 +1212,7 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
     
 	llassert(length > 0);
 
+	LLMutexLock file_lock(getFileMutex(file_id));
     lockData();
     
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1171,14 +1260,34 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 				length = block->mLength - location;
 			}
 			U32 file_location = location + block->mLocation;
-			
-			fseek(mDataFP, file_location, SEEK_SET);
-			S32 write_len = (S32)fwrite(buffer, 1, length, mDataFP);
-			if (write_len != length)
+			S32 write_len = length;
+
+			if (mMapped)
 			{
-				LL_WARNS() << llformat("VFS Write Error: %d != %d",write_len,length) << LL_ENDL;
+				// Our file lock keeps the block in place, so other files
+				// don't have to wait on the copy.
+				unlockData();
+				if (growMapping(file_location + length))
+				{
+					std::shared_lock<std::shared_mutex> mapping_lock(mMappingMutex);
+					memcpy(mMappedFile.getData() + file_location, buffer, length);
+				}
+				else
+				{
+					write_len = 0;
+				}
+				lockData();
+			}
+			else
+			{
+				fseek(mDataFP, file_location, SEEK_SET);
+				write_len = (S32)fwrite(buffer, 1, length, mDataFP);
+				if (write_len != length)
+				{
+					LL_WARNS() << llformat("VFS Write Error: %d != %d",write_len,length) << LL_ENDL;
+				}
+				// fflush(mDataFP);
 			}
-			// fflush(mDataFP);
 			
 			if (location + length > block->mSize)
 			{
@@ -1590,11 +1699,18 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 			LLVFSFileBlock *file_block = *it;
 			if (file_block->mLength >= size && file_block != immune)
 			{
+				lru_list.erase(it);
+				if (!tryLockFile(file_block))
+				{
+					// Someone is copying it right now, hardly least recently used
+					continue;
+				}
+
 				// ditch this file and look again for a free block - should find it
 				// TODO: it'll be faster just to assign the free block and break
 				LL_INFOS() << "LRU: Removing " << file_block->mFileID << ":" << file_block->mFileType << LL_ENDL;
-				lru_list.erase(it);
 				removeFileBlock(file_block);
+				unlockFile(file_block);
 				file_block = nullptr;
 				continue;
 			}
@@ -1613,13 +1729,18 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 				 )
 			{
 				file_block = *it;
+				lru_list.erase(it++);
+				if (!tryLockFile(file_block))
+				{
+					continue;
+				}
 				
 				// TODO: it would be great to be able to batch all these sync() calls
 				// LL_INFOS() << "LRU2: Removing " << file_block->mFileID << ":" << file_block->mFileType << " last accessed" << file_block->mAccessTime << LL_ENDL;
 
 				cleaned_up += file_block->mLength;
-				lru_list.erase(it++);
 				removeFileBlock(file_block);
+				unlockFile(file_block);
 				file_block = nullptr;
 			}
 			//mergeFreeBlocks();
@@ -2121,6 +2242,75 @@ time_t LLVFS::creationTime()
 // protected
 //============================================================================
 
+LLMutex* LLVFS::getFileMutex(const LLUUID &file_id)
+{
+	return mMapped ? &mFileMutexes[file_id.hash() % FILE_LOCK_STRIPES] : nullptr;
+}
+
+// mDataMutex must be LOCKED before calling this
+BOOL LLVFS::tryLockFile(LLVFSFileBlock *block)
+{
+	LLMutex *mutex = getFileMutex(block->mFileID);
+	return !mutex || mutex->trylock();
+}
+
+void LLVFS::unlockFile(LLVFSFileBlock *block)
+{
+	LLMutex *mutex = getFileMutex(block->mFileID);
+	if (mutex)
+	{
+		mutex->unlock();
+	}
+}
+
+// Maps at least size bytes of the data file, whole growth steps of it.
+BOOL LLVFS::mapDataFile(U32 size)
+{
+	U32 map_size = size;
+	if (!mReadOnly)
+	{
+		map_size = llmax(size, MAPPING_GROWTH_STEP);
+	}
+	mMapped = mMappedFile.attach(mDataFP, map_size, mReadOnly);
+	return mMapped;
+}
+
+// Grows the data file and its mapping to hold size bytes. Takes
+// mMappingMutex, so must not be called with it held.
+BOOL LLVFS::growMapping(U32 size)
+{
+	{
+		std::shared_lock<std::shared_mutex> mapping_lock(mMappingMutex);
+		if (size <= mMappedFile.getSize())
+		{
+			return TRUE;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> mapping_lock(mMappingMutex);
+	if (size <= mMappedFile.getSize())
+	{
+		return TRUE;
+	}
+	size_t new_size = ((size_t)size + MAPPING_GROWTH_STEP - 1) / MAPPING_GROWTH_STEP * MAPPING_GROWTH_STEP;
+	if (!mMappedFile.grow(new_size))
+	{
+		LL_WARNS("VFS") << "Failed to grow VFS data file " << mDataFilename << " to " << new_size << " bytes" << LL_ENDL;
+		if (!mMappedFile.isOpen())
+		{
+			LL_ERRS("VFS") << "Lost the mapping of VFS data file " << mDataFilename << LL_ENDL;
+		}
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void LLVFS::unmapDataFile()
+{
+	mMappedFile.close();
+	mMapped = FALSE;
+}
+
 // static
 LLFILE *LLVFS::openAndLock(const std::string& filename, const char* mode, BOOL read_lock)
 {
@@ -28,9 +28,12 @@
 #define LL_LLVFS_H
 
 #include <deque>
+#include <functional>
+#include <shared_mutex>
 #include "lluuid.h"
 #include "llassettype.h"
 #include "llthread.h"
+#include "llmappedfile.h"
 
 enum EVFSValid 
 {
@@ -77,20 +80,28 @@ private:
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const BOOL use_mapping);
 public:
 	~LLVFS();
 
 	// Use this function normally to create LLVFS files
 	// Pass 0 to not presize
+	// Pass use_mapping to memory map the data file instead of going through
+	// stdio. Reads and writes then only hold mDataMutex for the index lookup
+	// and copy their data under a per-file lock stripe, so threads touching
+	// different files no longer queue behind each other. Falls back to stdio
+	// if the data file cannot be mapped.
 	static LLVFS * createLLVFS(const std::string& index_filename, 
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const BOOL use_mapping = FALSE);
 
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
+	BOOL isMapped() const			{ return mMapped; }
 
 	// ---------- The following fucntions lock/unlock mDataMutex ----------
 	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
@@ -108,6 +119,14 @@ public:
 	S32 getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length);
 	S32 storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length);
 
+	// Zero-copy read: calls reader with a pointer straight into the mapped
+	// data file while the file is pinned against removal and relocation.
+	// The pointer is only valid for the duration of the call and reader must
+	// not call back into this VFS. Unmapped VFSes hand reader a temporary copy.
+	// Returns the number of bytes passed to reader.
+	typedef std::function<void (const U8* data, S32 length)> data_reader_t;
+	S32 peekData(const LLUUID &file_id, const LLAssetType::EType file_type, S32 location, S32 length, const data_reader_t& reader);
+
 	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
@@ -150,9 +169,35 @@ protected:
 	// lock/unlock data mutex (mDataMutex)
 	void lockData() { mDataMutex->lock(); }
 	void unlockData() { mDataMutex->unlock(); }	
+
+	// Per-file lock stripe guarding a file's data while it is copied in or
+	// out of the mapping. Always taken before mDataMutex. Returns nullptr
+	// when the data file is not mapped, as stdio access is serialized by
+	// mDataMutex anyway.
+	LLMutex* getFileMutex(const LLUUID &file_id);
+	// Used by LRU eviction (with mDataMutex held) to skip files being copied.
+	BOOL tryLockFile(LLVFSFileBlock *block);
+	void unlockFile(LLVFSFileBlock *block);
+
+	BOOL findReadExtent(const LLUUID &file_id, const LLAssetType::EType file_type, S32 &location, S32 &length);
+
+	BOOL mapDataFile(U32 size);
+	BOOL growMapping(U32 size);
+	void unmapDataFile();
 	
 protected:
 	LLMutex* mDataMutex;
+
+	static const S32 FILE_LOCK_STRIPES = 64;
+	LLMutex mFileMutexes[FILE_LOCK_STRIPES];
+
+	// The data file is mapped and grown MAPPING_GROWTH_STEP at a time.
+	// mMappingMutex is held shared while copying through the mapping and
+	// exclusively while growing it, which moves it.
+	static const U32 MAPPING_GROWTH_STEP = 0x4000000;
+	BOOL mMapped;
+	LLMappedFile mMappedFile;
+	std::shared_mutex mMappingMutex;
 	
 	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
 	fileblock_map mFileBlocks;
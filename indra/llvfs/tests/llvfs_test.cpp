@@ -0,0 +1,280 @@
+/**
+ * @file   llvfs_test.cpp
+ * @brief  Test for llvfs.cpp, including mapped vs. stdio read throughput.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../llvfs.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "llstring.h"
+#include "lltimer.h"
+#include "../test/lltut.h"
+
+namespace
+{
+	const U32 VFS_PRESIZE = 16 * 1024 * 1024;
+	const S32 BENCH_FILES = 64;
+	const S32 BENCH_FILE_SIZE = 64 * 1024;
+	const S32 BENCH_THREADS = 8;
+	const S32 BENCH_READS_PER_THREAD = 2000;
+
+	// Every byte of a test file is derivable from its id, so readers can
+	// check what they got without sharing the source buffers.
+	U8 expected_byte(const LLUUID& id, S32 offset)
+	{
+		return (U8)(id.mData[offset % UUID_BYTES] + offset);
+	}
+
+	std::vector<U8> make_contents(const LLUUID& id, S32 size)
+	{
+		std::vector<U8> contents(size);
+		for (S32 i = 0; i < size; ++i)
+		{
+			contents[i] = expected_byte(id, i);
+		}
+		return contents;
+	}
+}
+
+namespace tut
+{
+	struct llvfs_data
+	{
+		llvfs_data()
+		{
+			boost::filesystem::path base = boost::filesystem::temp_directory_path()
+				/ boost::filesystem::unique_path("llvfs-%%%%-%%%%");
+			mIndexFile = base.string() + ".index";
+			mDataFile = base.string() + ".data";
+		}
+
+		~llvfs_data()
+		{
+			LLFile::remove(mIndexFile);
+			LLFile::remove(mDataFile);
+		}
+
+		LLVFS* openVFS(BOOL mapped, U32 presize = VFS_PRESIZE)
+		{
+			return LLVFS::createLLVFS(mIndexFile, mDataFile, FALSE, presize, FALSE, mapped);
+		}
+
+		void storeFile(LLVFS* vfs, const LLUUID& id, S32 size)
+		{
+			std::vector<U8> contents = make_contents(id, size);
+			ensure("setMaxSize", vfs->setMaxSize(id, LLAssetType::AT_TEXTURE, size));
+			ensure_equals("storeData", vfs->storeData(id, LLAssetType::AT_TEXTURE, &contents[0], 0, size), size);
+		}
+
+		bool checkFile(LLVFS* vfs, const LLUUID& id, S32 size)
+		{
+			std::vector<U8> contents(size);
+			if (vfs->getData(id, LLAssetType::AT_TEXTURE, &contents[0], 0, size) != size)
+			{
+				return false;
+			}
+			return contents == make_contents(id, size);
+		}
+
+		// Reads random files from BENCH_THREADS threads at once, returns MB/s.
+		F64 readThroughput(LLVFS* vfs, const std::vector<LLUUID>& ids, bool& all_ok)
+		{
+			std::atomic<bool> ok(true);
+			std::vector<std::thread> threads;
+
+			LLTimer timer;
+			for (S32 t = 0; t < BENCH_THREADS; ++t)
+			{
+				threads.emplace_back([vfs, &ids, &ok, t]()
+				{
+					std::vector<U8> buffer(BENCH_FILE_SIZE);
+					U32 seed = 2166136261U + t;
+					for (S32 i = 0; i < BENCH_READS_PER_THREAD; ++i)
+					{
+						seed = seed * 1664525U + 1013904223U;
+						const LLUUID& id = ids[(seed >> 8) % ids.size()];
+						S32 got = vfs->getData(id, LLAssetType::AT_TEXTURE, &buffer[0], 0, BENCH_FILE_SIZE);
+						if (got != BENCH_FILE_SIZE
+							|| buffer[0] != expected_byte(id, 0)
+							|| buffer[BENCH_FILE_SIZE - 1] != expected_byte(id, BENCH_FILE_SIZE - 1))
+						{
+							ok = false;
+						}
+					}
+				});
+			}
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			F64 seconds = llmax(timer.getElapsedTimeF64().value(), 0.000001);
+
+			all_ok = ok;
+			F64 megabytes = (F64)BENCH_THREADS * BENCH_READS_PER_THREAD * BENCH_FILE_SIZE / (1024.0 * 1024.0);
+			return megabytes / seconds;
+		}
+
+		std::string mIndexFile;
+		std::string mDataFile;
+	};
+	typedef test_group<llvfs_data> llvfs_test;
+	typedef llvfs_test::object llvfs_object;
+	tut::llvfs_test tut_llvfs_test("LLVFS");
+
+	template<> template<>
+	void llvfs_object::test<1>()
+	{
+		set_test_name("mapped store, read, rename, remove");
+
+		LLVFS* vfs = openVFS(TRUE);
+		ensure("created", vfs != nullptr);
+		ensure("mapped", vfs->isMapped());
+
+		LLUUID id;
+		id.generate();
+		storeFile(vfs, id, 5000);
+		ensure("exists", vfs->getExists(id, LLAssetType::AT_TEXTURE));
+		ensure_equals("size", vfs->getSize(id, LLAssetType::AT_TEXTURE), 5000);
+		ensure("contents", checkFile(vfs, id, 5000));
+
+		// Appends go through the same mapped path
+		std::vector<U8> tail(100, 0x5a);
+		ensure("grow", vfs->setMaxSize(id, LLAssetType::AT_TEXTURE, 5100));
+		ensure_equals("append", vfs->storeData(id, LLAssetType::AT_TEXTURE, &tail[0], -1, 100), 100);
+		ensure_equals("appended size", vfs->getSize(id, LLAssetType::AT_TEXTURE), 5100);
+
+		// Zero-copy read hands out the stored bytes, clamped to the file size
+		S32 peeked = vfs->peekData(id, LLAssetType::AT_TEXTURE, 4990, 1000,
+			[&id](const U8* data, S32 length)
+			{
+				ensure_equals("peek length", length, 110);
+				ensure_equals("peek head", data[0], expected_byte(id, 4990));
+				ensure_equals("peek tail", data[length - 1], (U8)0x5a);
+			});
+		ensure_equals("peeked", peeked, 110);
+
+		LLUUID new_id;
+		new_id.generate();
+		vfs->renameFile(id, LLAssetType::AT_TEXTURE, new_id, LLAssetType::AT_TEXTURE);
+		ensure("renamed away", !vfs->getExists(id, LLAssetType::AT_TEXTURE));
+		std::vector<U8> head(10);
+		ensure_equals("renamed read", vfs->getData(new_id, LLAssetType::AT_TEXTURE, &head[0], 0, 10), 10);
+		ensure_equals("renamed byte", head[9], expected_byte(id, 9));
+
+		vfs->removeFile(new_id, LLAssetType::AT_TEXTURE);
+		ensure("removed", !vfs->getExists(new_id, LLAssetType::AT_TEXTURE));
+
+		delete vfs;
+	}
+
+	template<> template<>
+	void llvfs_object::test<2>()
+	{
+		set_test_name("mapped and stdio share the on-disk format");
+
+		std::vector<LLUUID> ids(10);
+		LLVFS* vfs = openVFS(TRUE);
+		ensure("created mapped", vfs != nullptr);
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ids[i].generate();
+			storeFile(vfs, ids[i], 1000 + i * 3000);
+		}
+		delete vfs;
+
+		vfs = openVFS(FALSE);
+		ensure("created stdio", vfs != nullptr);
+		ensure("not mapped", !vfs->isMapped());
+		for (S32 i = 0; i < (S32)ids.size(); ++i)
+		{
+			ensure("stdio reads mapped data", checkFile(vfs, ids[i], 1000 + i * 3000));
+		}
+		delete vfs;
+	}
+
+	template<> template<>
+	void llvfs_object::test<3>()
+	{
+		set_test_name("concurrent read throughput, stdio vs. mapped");
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time VFS reads");
+		}
+
+		std::vector<LLUUID> ids(BENCH_FILES);
+		LLVFS* vfs = openVFS(FALSE);
+		ensure("created", vfs != nullptr);
+		for (auto& id : ids)
+		{
+			id.generate();
+			storeFile(vfs, id, BENCH_FILE_SIZE);
+		}
+
+		bool ok = false;
+		F64 stdio_rate = readThroughput(vfs, ids, ok);
+		ensure("stdio reads intact", ok);
+		delete vfs;
+
+		vfs = openVFS(TRUE);
+		ensure("mapped", vfs && vfs->isMapped());
+		F64 mapped_rate = readThroughput(vfs, ids, ok);
+		ensure("mapped reads intact", ok);
+		delete vfs;
+
+		LL_INFOS() << "LLVFS " << BENCH_THREADS << " reader threads: stdio "
+				   << stdio_rate << " MB/s, mapped " << mapped_rate << " MB/s" << LL_ENDL;
+	}
+
+	template<> template<>
+	void llvfs_object::test<4>()
+	{
+		set_test_name("mapped data file grows as it is written");
+
+		LLVFS* vfs = openVFS(TRUE, 0);
+		ensure("mapped", vfs && vfs->isMapped());
+		// A new VFS hands out 1GB of free space, none of it on disk yet
+		ensure("starts small", boost::filesystem::file_size(mDataFile) < 0x10000000);
+
+		// Write the tail of a file that ends past the first growth step
+		const S32 size = 0x4100000;
+		LLUUID id;
+		id.generate();
+		ensure("setMaxSize", vfs->setMaxSize(id, LLAssetType::AT_TEXTURE, size));
+		std::vector<U8> tail(100, 0xa5);
+		ensure_equals("stored past the mapping", vfs->storeData(id, LLAssetType::AT_TEXTURE, &tail[0], size - 100, 100), 100);
+		ensure("grew", boost::filesystem::file_size(mDataFile) >= size);
+		delete vfs;
+
+		vfs = openVFS(FALSE, 0);
+		ensure("created stdio", vfs != nullptr);
+		std::vector<U8> contents(100);
+		ensure_equals("read back", vfs->getData(id, LLAssetType::AT_TEXTURE, &contents[0], size - 100, 100), 100);
+		ensure("same tail", contents == tail);
+		delete vfs;
+	}
+}
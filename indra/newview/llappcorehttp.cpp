@@ -59,62 +59,63 @@ static const struct
 	U32							mMax;
 	U32							mRate;
 	bool						mPipelined;
+	bool						mHttp2;
 	std::string					mKey;
 	const char *				mUsage;
 } init_data[LLAppCoreHttp::AP_COUNT] =
 {
 	{ // AP_DEFAULT
-		8,		8,		8,		0,		false,
+		8,		8,		8,		0,		false,		false,
 		"",
 		"other"
 	},
 	{ // AP_ASSET
-		12,		1,		16,		0,		true,
+		12,		1,		16,		0,		true,		false,
 		"AssetFetchConcurrency",
 		"asset fetch"
 	},
 	{ // AP_TEXTURE
-		12,		1,		16,		0,		true,
+		12,		1,		16,		0,		true,		true,
 		"TextureFetchConcurrency",
 		"texture fetch"
 	},
 	{ // AP_MESH1
-		32,		1,		128,	0,		false,
+		32,		1,		128,	0,		false,		false,
 		"MeshMaxConcurrentRequests",
 		"mesh fetch"
 	},
 	{ // AP_MESH2
-		8,		1,		32,		0,		true,	
+		8,		1,		32,		0,		true,		true,
 		"Mesh2MaxConcurrentRequests",
 		"mesh2 fetch"
 	},
 	{ // AP_LARGE_MESH
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		false,		true,
 		"",
 		"large mesh fetch"
 	},
 	{ // AP_UPLOADS 
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		false,		false,
 		"",
 		"asset upload"
 	},
 	{ // AP_LONG_POLL
-		32,		32,		32,		0,		false,
+		32,		32,		32,		0,		false,		false,
 		"",
 		"long poll"
 	},
 	{ // AP_INVENTORY
-		4,		1,		4,		0,		false,
+		4,		1,		4,		0,		false,		false,
 		"",
 		"inventory"
 	},
 	{ // AP_MATERIALS
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		false,		false,
 		"RenderMaterials",
 		"material manager requests"
 	},
 	{ // AP_AGENT
-		2,		1,		32,		0,		false,
+		2,		1,		32,		0,		false,		false,
 		"Agent",
 		"Agent requests"
 	}
@@ -396,6 +397,14 @@ void LLAppCoreHttp::refreshSettings(bool initial)
         LL_INFOS("Init") << "HTTP Pipelining " << (mPipelined ? "enabled" : "disabled") << "!" << LL_ENDL;
 	}
 	
+	// HTTP/2 streams in flight per multiplexed class, init-time only
+	static const std::string http2_streams_key("AlchemyHttp2Streams");
+	U32 http2_streams(0);
+	if (initial && gSavedSettings.controlExists(http2_streams_key))
+	{
+		http2_streams = gSavedSettings.getU32(http2_streams_key);
+	}
+
 	for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
 	{
 		const EAppPolicy app_policy(static_cast<EAppPolicy>(i));
@@ -419,6 +428,23 @@ void LLAppCoreHttp::refreshSettings(bool initial)
 				}
 			}
 
+			if (init_data[i].mHttp2 && http2_streams)
+			{
+				// Multiplex the bulk fetches over HTTP/2 where the server
+				// offers it, hosts answering with HTTP/1.1 keep the
+				// connection limits set below
+				status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_HTTP2_STREAM_LIMIT,
+																	mHttpClasses[app_policy].mPolicy,
+																	long(http2_streams),
+																	nullptr);
+				if (! status)
+				{
+					LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+									 << " HTTP/2 stream limit.  Reason:  " << status.toString()
+									 << LL_ENDL;
+				}
+			}
+
 		}
 
 		// Init- or run-time settings.  Must use the queued request API.
@@ -159,6 +159,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "llqueuedthreadpool.h"
 #include "llevents.h"
 
 // The files below handle dependencies from cleanup.
@@ -192,6 +193,7 @@
 // in save_settings_to_globals()
 #include "llbutton.h"
 #include "llsurface.h"
+#include "llvlcomposition.h"
 #include "llvotree.h"
 #include "llvoavatar.h"
 #include "llfolderview.h"
@@ -663,6 +665,7 @@ bool LLAppViewer::sendURLToOtherInstance(const std::string& url)
 LLAppViewer* LLAppViewer::sInstance = nullptr;
 LLTextureCache* LLAppViewer::sTextureCache = nullptr; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = nullptr; 
+LLQueuedThreadPool* LLAppViewer::sImageDecodePool = nullptr;
 LLTextureFetch* LLAppViewer::sTextureFetch = nullptr; 
 
 std::string getRuntime()
@@ -2021,6 +2024,9 @@ bool LLAppViewer::cleanup()
     sTextureFetch = nullptr;
 	delete sImageDecodeThread;
     sImageDecodeThread = nullptr;
+	SUBSYSTEM_CLEANUP(LLVLComposition);
+	delete sImageDecodePool; // after the decode thread, it runs on the pool
+	sImageDecodePool = nullptr;
 	delete mFastTimerLogThread;
 	mFastTimerLogThread = nullptr;
 
@@ -2172,7 +2178,17 @@ bool LLAppViewer::initThreads()
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	U32 decode_threads = gSavedSettings.getU32("AlchemyImageDecodeThreads");
+	if (enable_threads && decode_threads != 1)
+	{
+		LLAppViewer::sImageDecodePool = new LLQueuedThreadPool("imagedecode", decode_threads);
+	}
+	// The pool already decodes a texture per thread, splitting each one
+	// again would only start more threads than there are cores
+	LLImageJ2C::setDecodeThreads(sImageDecodePool ? 1 : gSavedSettings.getS32("AlchemyImageDecodeSplitThreads"));
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, sImageDecodePool);
+	// Terrain compositing shares the decode threads
+	LLVLComposition::initClass(sImageDecodePool);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -4144,7 +4160,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 16;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4235,6 +4251,8 @@ bool LLAppViewer::initCache()
 
 	LLVOCache::getInstance()->initCache(LL_PATH_CACHE, gSavedSettings.getU32("CacheNumberOfRegionsForObjects"), getObjectCacheVersion());
 
+	gMeshRepo.initDecodedCache(LL_PATH_CACHE, (U64)gSavedSettings.getU32("MeshDecodedCacheSize") * MB, read_only);
+
 	LLSplashScreen::update(LLTrans::getString("StartupInitializingVFS"));
 
 	// Init the VFS
@@ -4357,13 +4375,14 @@ bool LLAppViewer::initCache()
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
-	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+	const BOOL map_vfs = gSavedSettings.getBOOL("AlchemyVFSMemoryMapped");
+	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false, map_vfs);
 	if (!gVFS)
 	{
 		return false;
 	}
 
-	gStaticVFS = LLVFS::createLLVFS(static_vfs_index_file, static_vfs_data_file, true, 0, false);
+	gStaticVFS = LLVFS::createLLVFS(static_vfs_index_file, static_vfs_data_file, true, 0, false, map_vfs);
 	if (!gStaticVFS)
 	{
 		return false;
@@ -4399,6 +4418,7 @@ void LLAppViewer::purgeCache()
 	LL_INFOS("AppCache") << "Purging Cache and Texture Cache..." << LL_ENDL;
 	LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
 	LLVOCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLMeshDecodedCache::removeCache(LL_PATH_CACHE);
 	std::string browser_cache = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "cef_cache");
 	if (LLFile::isdir(browser_cache))
 	{
@@ -58,6 +58,7 @@ class LLPumpIO;
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLTextureFetch;
+class LLQueuedThreadPool;
 class LLWatchdogTimeout;
 class LLViewerJoystick;
 
@@ -271,6 +272,7 @@ private:
 	// Thread objects.
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
+	static LLQueuedThreadPool* sImageDecodePool;
 	static LLTextureFetch* sTextureFetch;
 
 	S32 mNumSessions;
@@ -381,7 +381,7 @@ BOOL LLBreastMotion::onUpdate(F32 time, U8* joint_mask)
 		const F32 min_delta = (1.0-lod_factor)*(mBreastParamsMax[i]-mBreastParamsMin[i])/2.0;
 		if (llabs(position_diff[i]) > min_delta)
 		{
-			mCharacter->updateVisualParams();
+			mCharacter->requestUpdateVisualParams();
 			mBreastLastUpdatePosition_local_pt = new_local_pt;
 			return TRUE;
 		}
@@ -68,6 +68,8 @@ BOOL	LLDrawPoolAvatar::sSkipTransparent = FALSE;
 S32     LLDrawPoolAvatar::sShadowPass = -1;
 S32 LLDrawPoolAvatar::sDiffuseChannel = 0;
 F32 LLDrawPoolAvatar::sMinimumAlpha = 0.2f;
+LLSkinningBatch LLDrawPoolAvatar::sSkinningBatch;
+std::vector<LLPointer<LLVertexBuffer> > LLDrawPoolAvatar::sSkinnedBuffers;
 
 LLUUID gBlackSquareID;
 
@@ -1778,39 +1780,45 @@ void LLDrawPoolAvatar::updateRiggedFaceVertexBuffer(
 
 		LLVector4a* norm = has_normal ? (LLVector4a*) normal.get() : NULL;
 		
-		//build matrix palette
-		LLMatrix4a mat[LL_MAX_JOINTS_PER_MESH_OBJECT];
-        U32 count = LLSkinningUtil::getMeshJointCount(skin);
-        LLSkinningUtil::initSkinningMatrixPalette(mat, count, skin, avatar);
+		//build matrix palette, once per skin and avatar
+		S32 palette = sSkinningBatch.findPalette(skin, avatar);
+		if (palette < 0)
+		{
+			LLMatrix4a mat[LL_MAX_JOINTS_PER_MESH_OBJECT];
+			U32 count = LLSkinningUtil::getMeshJointCount(skin);
+			LLSkinningUtil::initSkinningMatrixPalette(mat, count, skin, avatar);
+			palette = sSkinningBatch.addPalette(skin, avatar, mat, count);
+		}
         LLSkinningUtil::checkSkinWeights(weights, buffer->getNumVerts(), skin);
 
-        const U32 max_joints = LLSkinningUtil::getMaxJointCount();
-		for (S32 j = 0; j < buffer->getNumVerts(); ++j)
-		{
-			LLMatrix4a final_mat;
-            LLSkinningUtil::getPerVertexSkinMatrix(weights[j], mat, false, final_mat, max_joints);
-			
-			const LLVector4a& v = vol_face.mPositions[j];
+		sSkinningBatch.addFace(vol_face, palette, pos, norm);
+		sSkinnedBuffers.push_back(buffer);
+	}
+}
 
-			LLVector4a dst;
-			skin->mBindShapeMatrix.affineTransform(v, dst);
-			final_mat.affineTransform(dst, dst);
-			pos[j] = dst;
+static LLTrace::BlockTimerStatHandle FTM_SKIN_RIGGED("Skin Rigged");
 
-			if (norm)
-			{
-				const LLVector4a& n = vol_face.mNormals[j];
-				skin->mBindShapeMatrix.rotate(n, dst);
-				final_mat.rotate(dst, dst);
-				dst.normalize3fast();
-				norm[j] = dst;
-			}
-		}
+// static
+void LLDrawPoolAvatar::skinRiggedFaces()
+{
+	if (!sSkinningBatch.empty())
+	{
+		LL_RECORD_BLOCK_TIME(FTM_SKIN_RIGGED);
+		sSkinningBatch.skin(sSkinningBatch.getDefaultRuns());
 	}
+	sSkinningBatch.clear();
+	sSkinnedBuffers.clear();
 }
 
 void LLDrawPoolAvatar::renderRigged(LLVOAvatar* avatar, U32 type, bool glow)
 {
+	// Queued outside the pipeline's prerender pass, by a rebuild or a
+	// single avatar render
+	if (!sSkinningBatch.empty())
+	{
+		skinRiggedFaces();
+	}
+
 	if (!avatar->shouldRenderRigged())
 	{
 		return;
@@ -28,6 +28,7 @@
 #define LL_LLDRAWPOOLAVATAR_H
 
 #include "lldrawpool.h"
+#include "llskinningbatch.h"
 
 class LLVOAvatar;
 class LLGLSLShader;
@@ -251,12 +252,18 @@ typedef enum
 	void endDeferredRiggedBump();
 		
 	void getRiggedGeometry(LLFace* face, LLPointer<LLVertexBuffer>& buffer, U32 data_mask, const LLMeshSkinInfo* skin, LLVolume* volume, const LLVolumeFace& vol_face);
+	// Software skinning is only queued here, for the faces of every avatar,
+	// and skinRiggedFaces() runs it.
 	void updateRiggedFaceVertexBuffer(LLVOAvatar* avatar,
 									  LLFace* facep, 
 									  const LLMeshSkinInfo* skin, 
 									  LLVolume* volume,
 									  const LLVolumeFace& vol_face);
 	void updateRiggedVertexBuffers(LLVOAvatar* avatar);
+	// Skins all the faces queued since the last call, called once the
+	// pipeline has prepared every avatar pool for a frame, and by
+	// renderRigged() for faces queued after that.
+	static void skinRiggedFaces();
 
 	void renderRigged(LLVOAvatar* avatar, U32 type, bool glow = false);
 	void renderRiggedSimple(LLVOAvatar* avatar);
@@ -277,6 +284,11 @@ typedef enum
 
 	std::vector<LLFace*> mRiggedFace[NUM_RIGGED_PASSES];
 
+	// Faces of all avatars waiting for software skinning, and their
+	// buffers kept alive until it is done
+	static LLSkinningBatch sSkinningBatch;
+	static std::vector<LLPointer<LLVertexBuffer> > sSkinnedBuffers;
+
 	/*virtual*/ LLViewerTexture *getDebugTexture() final override;
 	/*virtual*/ LLColor3 getDebugColor() const; // For AGP debug display
 
@@ -81,7 +81,7 @@ BOOL LLEmote::onActivate()
 	if (mParam)
 	{
 		mParam->setWeight(0.f, FALSE);
-		mCharacter->updateVisualParams();
+		mCharacter->requestUpdateVisualParams();
 	}
 	
 	return TRUE;
@@ -108,7 +108,7 @@ BOOL LLEmote::onUpdate(F32 time, U8* joint_mask)
 			default_param->setWeight( default_param_weight, FALSE);
 		}
 
-		mCharacter->updateVisualParams();
+		mCharacter->requestUpdateVisualParams();
 	}
 
 	return TRUE;
@@ -131,7 +131,7 @@ void LLEmote::onDeactivate()
 		default_param->setWeight( default_param->getMaxWeight(), FALSE);
 	}
 
-	mCharacter->updateVisualParams();
+	mCharacter->requestUpdateVisualParams();
 }
 
 
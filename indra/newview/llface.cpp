@@ -2150,6 +2150,23 @@ BOOL LLFace::hasMedia() const
 
 const F32 LEAST_IMPORTANCE = 0.05f ;
 const F32 LEAST_IMPORTANCE_FOR_LARGE_IMAGE = 0.3f ;
+const F32 VIRTUAL_SIZE_CHANGE_RATIO = 1.25f ; //same 20% the texture list ignores in decode priorities
+
+void LLFace::setVirtualSize(F32 size)
+{
+	if (size > mVSize * VIRTUAL_SIZE_CHANGE_RATIO || size * VIRTUAL_SIZE_CHANGE_RATIO < mVSize)
+	{
+		// Have the textures reprioritized now rather than on their turn in the
+		// round-robin, bigger changes closer to the camera first. Pixels weigh
+		// as calcDecodePriority() weighs them.
+		const F32 importance = llabs(sqrtf(size) - sqrtf(mVSize)) * (1.f + mImportanceToCamera);
+		for (U32 ch = 0; ch < LLRender::NUM_TEXTURE_CHANNELS; ++ch)
+		{
+			gTextureList.queueDecodePriorityUpdate(LLViewerTextureManager::staticCastToFetchedTexture(mTexture[ch]), importance);
+		}
+	}
+	mVSize = size;
+}
 
 void LLFace::resetVirtualSize()
 {
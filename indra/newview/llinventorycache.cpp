@@ -0,0 +1,797 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Memory mapped binary inventory cache file
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llinventorycache.h"
+
+#include "llcrc.h"
+#include "llfile.h"
+#include "lltracethreadrecorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <thread>
+
+namespace
+{
+	const U32 CACHE_MAGIC = 0x564e4941; // "AINV"
+	const U32 FORMAT_VERSION = 1;
+	const U32 ITEMS_PER_RUN = 8192;	// fewer are not worth a thread
+}
+
+struct LLInventoryCacheFile::Header
+{
+	U32 mMagic;
+	U32 mFormatVersion;
+	S32 mCacheVersion;
+	U32 mSectionCount;
+	U32 mItemCount;
+	U32 mStringBytes;
+	U32 mChecksum;		// of everything above
+	U32 mPadding;
+};
+
+static_assert(sizeof(LLInventoryCacheFile::Section) == 72, "inventory cache section layout changed");
+static_assert(sizeof(LLInventoryCacheFile::ItemRecord) == 152, "inventory cache item layout changed");
+
+LLInventoryCacheFile::LLInventoryCacheFile()
+{
+}
+
+LLInventoryCacheFile::~LLInventoryCacheFile()
+{
+	close();
+}
+
+bool LLInventoryCacheFile::open(const std::string& filename)
+{
+	close();
+	if (!mFile.open(filename, 0, true))
+	{
+		return false;
+	}
+	if (!validate())
+	{
+		LL_WARNS("Inventory") << "Ignoring invalid inventory cache " << filename << LL_ENDL;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void LLInventoryCacheFile::close()
+{
+	mFile.close();
+}
+
+bool LLInventoryCacheFile::validate() const
+{
+	if (mFile.getSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	const Header* header = getHeader();
+	LLCRC crc;
+	crc.update(mFile.getData(), offsetof(Header, mChecksum));
+	if (header->mMagic != CACHE_MAGIC
+		|| header->mFormatVersion != FORMAT_VERSION
+		|| header->mChecksum != crc.getCRC())
+	{
+		return false;
+	}
+
+	const U64 size = sizeof(Header)
+		+ (U64)header->mSectionCount * sizeof(Section)
+		+ (U64)header->mItemCount * sizeof(ItemRecord)
+		+ header->mStringBytes;
+	if (size != mFile.getSize())
+	{
+		return false;
+	}
+
+	// Sections cover the items in order, without gaps
+	U32 next_item = 0;
+	for (U32 i = 0; i < header->mSectionCount; ++i)
+	{
+		const Section& section = getSections()[i];
+		if (section.mFirstItem != next_item
+			|| section.mItemCount > header->mItemCount - next_item
+			|| !validString(section.mName))
+		{
+			return false;
+		}
+		next_item += section.mItemCount;
+	}
+	if (next_item != header->mItemCount)
+	{
+		return false;
+	}
+
+	const ItemRecord* items = getItems();
+	for (U32 i = 0; i < header->mItemCount; ++i)
+	{
+		if (!validString(items[i].mName) || !validString(items[i].mDescription))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool LLInventoryCacheFile::validString(const StringRef& ref) const
+{
+	const U32 bytes = getHeader()->mStringBytes;
+	return ref.mOffset <= bytes && ref.mLength <= bytes - ref.mOffset;
+}
+
+const LLInventoryCacheFile::Header* LLInventoryCacheFile::getHeader() const
+{
+	return reinterpret_cast<const Header*>(mFile.getData());
+}
+
+const LLInventoryCacheFile::Section* LLInventoryCacheFile::getSections() const
+{
+	return reinterpret_cast<const Section*>(mFile.getData() + sizeof(Header));
+}
+
+const LLInventoryCacheFile::ItemRecord* LLInventoryCacheFile::getItems() const
+{
+	return reinterpret_cast<const ItemRecord*>(getSections() + getHeader()->mSectionCount);
+}
+
+const char* LLInventoryCacheFile::getStrings() const
+{
+	return reinterpret_cast<const char*>(getItems() + getHeader()->mItemCount);
+}
+
+S32 LLInventoryCacheFile::getCacheVersion() const
+{
+	return isOpen() ? getHeader()->mCacheVersion : 0;
+}
+
+U32 LLInventoryCacheFile::getSectionCount() const
+{
+	return isOpen() ? getHeader()->mSectionCount : 0;
+}
+
+U32 LLInventoryCacheFile::getItemCount() const
+{
+	return isOpen() ? getHeader()->mItemCount : 0;
+}
+
+const LLInventoryCacheFile::Section& LLInventoryCacheFile::getSection(U32 index) const
+{
+	llassert(index < getSectionCount());
+	return getSections()[index];
+}
+
+const LLInventoryCacheFile::ItemRecord& LLInventoryCacheFile::getItem(U32 index) const
+{
+	llassert(index < getItemCount());
+	return getItems()[index];
+}
+
+std::string LLInventoryCacheFile::getString(const StringRef& ref) const
+{
+	return std::string(getStrings() + ref.mOffset, ref.mLength);
+}
+
+// The last section starting at or before item, which is the one holding it
+// since any empty sections at the same position come before it.
+U32 LLInventoryCacheFile::findSection(U32 item) const
+{
+	const Section* begin = getSections();
+	const Section* end = begin + getHeader()->mSectionCount;
+	const Section* it = std::upper_bound(begin, end, item,
+		[](U32 value, const Section& section) { return value < section.mFirstItem; });
+	return (U32)(it - begin) - 1;
+}
+
+void LLInventoryCacheFile::decodeItems(U32 runs, const decode_func_t& decode) const
+{
+	const U32 total = getItemCount();
+	if (!total)
+	{
+		return;
+	}
+	runs = llclamp(runs, 1U, total);
+
+	auto decode_run = [this, total, runs, &decode](U32 run)
+	{
+		const U32 first = (U32)((U64)total * run / runs);
+		const U32 end = (U32)((U64)total * (run + 1) / runs);
+		U32 item = first;
+		for (U32 section = findSection(first); item < end; ++section)
+		{
+			const Section& sect = getSections()[section];
+			const U32 section_end = llmin(sect.mFirstItem + sect.mItemCount, end);
+			if (section_end > item)
+			{
+				decode(section, item, section_end, run);
+				item = section_end;
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(runs - 1);
+	for (U32 run = 1; run < runs; ++run)
+	{
+		workers.emplace_back([&decode_run, run]()
+			{
+				// Inventory objects are tracked allocations, give the
+				// thread its own recorder like an LLThread gets.
+				std::optional<LLTrace::ThreadRecorder> recorder;
+				if (LLTrace::get_master_thread_recorder())
+				{
+					recorder.emplace(*LLTrace::get_master_thread_recorder());
+				}
+				decode_run(run);
+			});
+	}
+	decode_run(0);
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+U32 LLInventoryCacheFile::getDefaultRuns() const
+{
+	const U32 cores = llmax(std::thread::hardware_concurrency(), 1U);
+	return llclamp(getItemCount() / ITEMS_PER_RUN, 1U, cores);
+}
+
+//============================================================================
+
+LLInventoryCacheFile::Builder::Builder()
+{
+}
+
+LLInventoryCacheFile::Section& LLInventoryCacheFile::Builder::addSection(const LLUUID& id)
+{
+	mSections.emplace_back();
+	Section& section = mSections.back();
+	section.mID = id;
+	section.mFirstItem = (U32)mItems.size();
+	return section;
+}
+
+LLInventoryCacheFile::ItemRecord& LLInventoryCacheFile::Builder::addItem()
+{
+	llassert(!mSections.empty());
+	mItems.emplace_back();
+	ItemRecord& item = mItems.back();
+	++mSections.back().mItemCount;
+	return item;
+}
+
+LLInventoryCacheFile::StringRef LLInventoryCacheFile::Builder::addString(const std::string& str)
+{
+	StringRef ref;
+	ref.mOffset = (U32)mStrings.size();
+	ref.mLength = (U32)str.size();
+	mStrings.append(str);
+	return ref;
+}
+
+bool LLInventoryCacheFile::Builder::save(const std::string& filename, S32 cache_version) const
+{
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	header.mMagic = CACHE_MAGIC;
+	header.mFormatVersion = FORMAT_VERSION;
+	header.mCacheVersion = cache_version;
+	header.mSectionCount = (U32)mSections.size();
+	header.mItemCount = (U32)mItems.size();
+	header.mStringBytes = (U32)mStrings.size();
+	LLCRC crc;
+	crc.update(reinterpret_cast<const U8*>(&header), offsetof(Header, mChecksum));
+	header.mChecksum = crc.getCRC();
+
+	const std::string temp_filename = filename + ".tmp";
+	LLFILE* file = LLFile::fopen(temp_filename, "wb");
+	if (!file)
+	{
+		LL_WARNS("Inventory") << "Unable to write inventory cache " << temp_filename << LL_ENDL;
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(Header), 1, file) == 1;
+	if (success && !mSections.empty())
+	{
+		success = fwrite(mSections.data(), sizeof(Section), mSections.size(), file) == mSections.size();
+	}
+	if (success && !mItems.empty())
+	{
+		success = fwrite(mItems.data(), sizeof(ItemRecord), mItems.size(), file) == mItems.size();
+	}
+	if (success && !mStrings.empty())
+	{
+		success = fwrite(mStrings.data(), 1, mStrings.size(), file) == mStrings.size();
+	}
+	success = (fclose(file) == 0) && success;
+
+	if (success)
+	{
+		LLFile::remove(filename, ENOENT);
+		success = (LLFile::rename(temp_filename, filename) == 0);
+	}
+	if (!success)
+	{
+		LL_WARNS("Inventory") << "Unable to write inventory cache " << filename << LL_ENDL;
+		LLFile::remove(temp_filename, ENOENT);
+	}
+	return success;
+}
+
+//============================================================================
+
+namespace
+{
+	const U32 JOURNAL_MAGIC = 0x4e4a4941; // "AIJN"
+	const U32 JOURNAL_FORMAT_VERSION = 1;
+
+	struct JournalHeader
+	{
+		U32 mMagic;
+		U32 mFormatVersion;
+		S32 mCacheVersion;
+		U32 mPadding;
+	};
+
+	// Precedes each entry, the checksum covers the payload that follows:
+	//  U8 operation, U8 replace items, 2 bytes padding, then
+	//  OP_CATEGORY: Section, name
+	//  OP_ITEM:     parent LLUUID, ItemRecord, name, description
+	//  OP_REMOVE:   LLUUID
+	struct EntryFrame
+	{
+		U32 mSize;
+		U32 mChecksum;
+	};
+
+	const size_t OPERATION_BYTES = 4;
+
+	template<typename T>
+	void append_bytes(std::vector<U8>& buffer, const T& value)
+	{
+		const U8* bytes = reinterpret_cast<const U8*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	void append_string(std::vector<U8>& buffer, const std::string& str)
+	{
+		buffer.insert(buffer.end(), str.begin(), str.end());
+	}
+
+	// Splits the payload of an entry back into entry, false if it is damaged.
+	bool decode_entry(const U8* payload, size_t size, LLInventoryCacheJournal::Entry& entry)
+	{
+		if (size < OPERATION_BYTES)
+		{
+			return false;
+		}
+		entry.mOperation = payload[0];
+		entry.mReplaceItems = (payload[1] != 0);
+		payload += OPERATION_BYTES;
+		size -= OPERATION_BYTES;
+
+		switch (entry.mOperation)
+		{
+		case LLInventoryCacheJournal::OP_CATEGORY:
+		{
+			LLInventoryCacheFile::Section& section = entry.mCategory;
+			if (size < sizeof(section))
+			{
+				return false;
+			}
+			memcpy(&section, payload, sizeof(section));
+			if (section.mName.mLength != size - sizeof(section))
+			{
+				return false;
+			}
+			entry.mID = section.mID;
+			entry.mName.assign(reinterpret_cast<const char*>(payload + sizeof(section)), section.mName.mLength);
+			return true;
+		}
+		case LLInventoryCacheJournal::OP_ITEM:
+		{
+			LLInventoryCacheFile::ItemRecord& item = entry.mItem;
+			const size_t fixed = sizeof(LLUUID) + sizeof(item);
+			if (size < fixed)
+			{
+				return false;
+			}
+			memcpy(&entry.mParentID, payload, sizeof(LLUUID));
+			memcpy(&item, payload + sizeof(LLUUID), sizeof(item));
+			if ((U64)item.mName.mLength + item.mDescription.mLength != size - fixed)
+			{
+				return false;
+			}
+			const char* strings = reinterpret_cast<const char*>(payload + fixed);
+			entry.mID = item.mID;
+			entry.mName.assign(strings, item.mName.mLength);
+			entry.mDescription.assign(strings + item.mName.mLength, item.mDescription.mLength);
+			return true;
+		}
+		case LLInventoryCacheJournal::OP_REMOVE:
+			if (size != sizeof(LLUUID))
+			{
+				return false;
+			}
+			memcpy(&entry.mID, payload, sizeof(LLUUID));
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+LLInventoryCacheJournal::Entry::Entry()
+:	mOperation(0),
+	mReplaceItems(false),
+	mCategory(),
+	mItem()
+{
+}
+
+LLInventoryCacheJournal::LLInventoryCacheJournal()
+:	mFile(nullptr),
+	mSize(0),
+	mEntryCount(0)
+{
+}
+
+LLInventoryCacheJournal::~LLInventoryCacheJournal()
+{
+	close();
+}
+
+bool LLInventoryCacheJournal::create(const std::string& filename, S32 cache_version)
+{
+	close();
+	mFile = LLFile::fopen(filename, "wb");
+	if (!mFile)
+	{
+		LL_WARNS("Inventory") << "Unable to create inventory journal " << filename << LL_ENDL;
+		return false;
+	}
+	mFilename = filename;
+
+	JournalHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mMagic = JOURNAL_MAGIC;
+	header.mFormatVersion = JOURNAL_FORMAT_VERSION;
+	header.mCacheVersion = cache_version;
+	if (fwrite(&header, sizeof(header), 1, mFile) != 1)
+	{
+		LL_WARNS("Inventory") << "Unable to write inventory journal " << filename << LL_ENDL;
+		close();
+		return false;
+	}
+	mSize = sizeof(header);
+	return true;
+}
+
+void LLInventoryCacheJournal::close()
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+	}
+	mSize = 0;
+	mEntryCount = 0;
+}
+
+bool LLInventoryCacheJournal::append(const Entry& entry)
+{
+	if (!mFile)
+	{
+		return false;
+	}
+
+	mBuffer.assign(sizeof(EntryFrame) + OPERATION_BYTES, 0);
+	mBuffer[sizeof(EntryFrame)] = entry.mOperation;
+	mBuffer[sizeof(EntryFrame) + 1] = (entry.mOperation == OP_CATEGORY && entry.mReplaceItems) ? 1 : 0;
+	switch (entry.mOperation)
+	{
+	case OP_CATEGORY:
+	{
+		LLInventoryCacheFile::Section section = entry.mCategory;
+		section.mFirstItem = 0;
+		section.mItemCount = 0;
+		section.mName.mOffset = 0;
+		section.mName.mLength = (U32)entry.mName.size();
+		append_bytes(mBuffer, section);
+		append_string(mBuffer, entry.mName);
+		break;
+	}
+	case OP_ITEM:
+	{
+		LLInventoryCacheFile::ItemRecord item = entry.mItem;
+		item.mName.mOffset = 0;
+		item.mName.mLength = (U32)entry.mName.size();
+		item.mDescription.mOffset = item.mName.mLength;
+		item.mDescription.mLength = (U32)entry.mDescription.size();
+		append_bytes(mBuffer, entry.mParentID);
+		append_bytes(mBuffer, item);
+		append_string(mBuffer, entry.mName);
+		append_string(mBuffer, entry.mDescription);
+		break;
+	}
+	case OP_REMOVE:
+		append_bytes(mBuffer, entry.mID);
+		break;
+	default:
+		llassert(false);
+		return false;
+	}
+
+	EntryFrame frame;
+	frame.mSize = (U32)(mBuffer.size() - sizeof(EntryFrame));
+	LLCRC crc;
+	crc.update(mBuffer.data() + sizeof(EntryFrame), frame.mSize);
+	frame.mChecksum = crc.getCRC();
+	memcpy(mBuffer.data(), &frame, sizeof(frame));
+
+	if (fwrite(mBuffer.data(), 1, mBuffer.size(), mFile) != mBuffer.size())
+	{
+		LL_WARNS("Inventory") << "Unable to write inventory journal " << mFilename << LL_ENDL;
+		close();
+		return false;
+	}
+	mSize += mBuffer.size();
+	++mEntryCount;
+	return true;
+}
+
+void LLInventoryCacheJournal::flush()
+{
+	if (mFile)
+	{
+		fflush(mFile);
+	}
+}
+
+// static
+bool LLInventoryCacheJournal::replay(const std::string& filename, S32 cache_version, const replay_func_t& replay)
+{
+	LLMappedFile file;
+	if (!file.open(filename, 0, true))
+	{
+		return false;
+	}
+
+	JournalHeader header;
+	if (file.getSize() < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, file.getData(), sizeof(header));
+	if (header.mMagic != JOURNAL_MAGIC
+		|| header.mFormatVersion != JOURNAL_FORMAT_VERSION
+		|| header.mCacheVersion != cache_version)
+	{
+		LL_WARNS("Inventory") << "Ignoring inventory journal " << filename << " of another version" << LL_ENDL;
+		return false;
+	}
+
+	const U8* data = file.getData();
+	const size_t size = file.getSize();
+	size_t offset = sizeof(header);
+	Entry entry;
+	while (size - offset >= sizeof(EntryFrame))
+	{
+		EntryFrame frame;
+		memcpy(&frame, data + offset, sizeof(frame));
+		offset += sizeof(frame);
+		if (frame.mSize > size - offset)
+		{
+			break;
+		}
+		LLCRC crc;
+		crc.update(data + offset, frame.mSize);
+		if (crc.getCRC() != frame.mChecksum || !decode_entry(data + offset, frame.mSize, entry))
+		{
+			break;
+		}
+		offset += frame.mSize;
+		replay(entry);
+	}
+	if (offset != size)
+	{
+		LL_WARNS("Inventory") << "Inventory journal " << filename << " ends with a damaged entry" << LL_ENDL;
+	}
+	return true;
+}
+
+// static
+bool LLInventoryCacheJournal::compact(const std::string& cache_filename,
+									  const std::vector<std::string>& journals,
+									  S32 cache_version)
+{
+	// Entries are numbered from 1 in replay order, the cache counts as 0.
+	// An item older than the last full listing of its category is gone.
+	struct CategoryState
+	{
+		LLInventoryCacheFile::Section mSection;
+		std::string mName;
+		U64 mListed = 0;
+	};
+	struct ItemState
+	{
+		LLInventoryCacheFile::ItemRecord mRecord;
+		LLUUID mParentID;
+		std::string mName;
+		std::string mDescription;
+		U64 mWritten = 0;
+	};
+	std::map<LLUUID, CategoryState> categories;
+	std::map<LLUUID, ItemState> items;
+
+	{
+		LLInventoryCacheFile cache;
+		if (!cache.open(cache_filename) || cache.getCacheVersion() != cache_version)
+		{
+			return false;
+		}
+		for (U32 i = 0; i < cache.getSectionCount(); ++i)
+		{
+			const LLInventoryCacheFile::Section& section = cache.getSection(i);
+			if (section.mFlags & LLInventoryCacheFile::SECTION_CATEGORY)
+			{
+				CategoryState& state = categories[section.mID];
+				state.mSection = section;
+				state.mName = cache.getString(section.mName);
+			}
+			for (U32 j = section.mFirstItem; j < section.mFirstItem + section.mItemCount; ++j)
+			{
+				const LLInventoryCacheFile::ItemRecord& record = cache.getItem(j);
+				ItemState& state = items[record.mID];
+				state.mRecord = record;
+				state.mParentID = section.mID;
+				state.mName = cache.getString(record.mName);
+				state.mDescription = cache.getString(record.mDescription);
+			}
+		}
+		// Unmapped before the rename below replaces the file
+	}
+
+	U64 sequence = 0;
+	for (const std::string& journal : journals)
+	{
+		replay(journal, cache_version, [&](const Entry& entry)
+			{
+				++sequence;
+				switch (entry.mOperation)
+				{
+				case OP_CATEGORY:
+				{
+					CategoryState& state = categories[entry.mID];
+					state.mSection = entry.mCategory;
+					state.mName = entry.mName;
+					if (entry.mReplaceItems)
+					{
+						state.mListed = sequence;
+					}
+					break;
+				}
+				case OP_ITEM:
+				{
+					ItemState& state = items[entry.mID];
+					state.mRecord = entry.mItem;
+					state.mParentID = entry.mParentID;
+					state.mName = entry.mName;
+					state.mDescription = entry.mDescription;
+					state.mWritten = sequence;
+					break;
+				}
+				case OP_REMOVE:
+					categories.erase(entry.mID);
+					items.erase(entry.mID);
+					break;
+				}
+			});
+	}
+
+	std::map<LLUUID, std::vector<const ItemState*> > items_by_parent;
+	for (const auto& item : items)
+	{
+		items_by_parent[item.second.mParentID].push_back(&item.second);
+	}
+
+	LLInventoryCacheFile::Builder builder;
+	auto add_item = [&builder](const ItemState* item)
+	{
+		LLInventoryCacheFile::ItemRecord& record = builder.addItem();
+		record = item->mRecord;
+		record.mName = builder.addString(item->mName);
+		record.mDescription = builder.addString(item->mDescription);
+	};
+	for (const auto& category : categories)
+	{
+		const LLInventoryCacheFile::Section& saved = category.second.mSection;
+		LLInventoryCacheFile::Section& section = builder.addSection(category.first);
+		section.mParentID = saved.mParentID;
+		section.mOwnerID = saved.mOwnerID;
+		section.mVersion = saved.mVersion;
+		section.mType = saved.mType;
+		section.mPreferredType = saved.mPreferredType;
+		section.mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+		section.mName = builder.addString(category.second.mName);
+
+		const auto it = items_by_parent.find(category.first);
+		if (it == items_by_parent.end())
+		{
+			continue;
+		}
+		for (const ItemState* item : it->second)
+		{
+			if (item->mWritten < category.second.mListed)
+			{
+				continue;
+			}
+			add_item(item);
+		}
+	}
+
+	// Items whose category is not cached stay in a plain section, as
+	// LLInventoryModel::saveToCache() writes them, so the compacted cache
+	// loads the same as replaying the journals over the old one
+	U32 orphans = 0;
+	for (const auto& parent : items_by_parent)
+	{
+		if (categories.find(parent.first) != categories.end())
+		{
+			continue;
+		}
+		builder.addSection(parent.first);
+		for (const ItemState* item : parent.second)
+		{
+			add_item(item);
+		}
+		orphans += (U32)parent.second.size();
+	}
+
+	if (!builder.save(cache_filename, cache_version))
+	{
+		return false;
+	}
+	for (const std::string& journal : journals)
+	{
+		LLFile::remove(journal, ENOENT);
+	}
+	LL_INFOS("Inventory") << "Compacted " << journals.size() << " journals into " << cache_filename
+						  << ", " << builder.getSectionCount() << " categories and "
+						  << builder.getItemCount() << " items, " << orphans << " of them outside any cached category"
+						  << LL_ENDL;
+	return true;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file llinventorycache.h
+ * @brief Memory mapped binary inventory cache file
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// On-disk layout:
+//  Header
+//  Section[section count]  one per category, in the order they were saved
+//  ItemRecord[item count]  the items of each section, one run per section
+//  char[string bytes]      names and descriptions, not terminated
+// Every record has a fixed size, so the file is read in place through a
+// read-only mapping and the items of different sections can be decoded on
+// several threads at once. Integers are in host byte order, a file from a
+// foreign host fails the magic check like any other stale cache.
+class LLInventoryCacheFile
+{
+public:
+	struct StringRef
+	{
+		U32 mOffset;	// into the string table
+		U32 mLength;
+	};
+
+	enum
+	{
+		SECTION_CATEGORY = 1	// the category itself was saved, not just its items
+	};
+
+	struct Section
+	{
+		LLUUID mID;			// the category, parent of the section's items
+		LLUUID mParentID;
+		LLUUID mOwnerID;
+		S32 mVersion;
+		U32 mFirstItem;
+		U32 mItemCount;
+		StringRef mName;
+		S8 mType;
+		S8 mPreferredType;
+		U8 mFlags;
+		U8 mPad;
+	};
+
+	struct ItemRecord
+	{
+		LLUUID mID;
+		LLUUID mAssetID;
+		LLUUID mCreatorID;
+		LLUUID mOwnerID;
+		LLUUID mLastOwnerID;
+		LLUUID mGroupID;
+		U32 mMaskBase;
+		U32 mMaskOwner;
+		U32 mMaskGroup;
+		U32 mMaskEveryone;
+		U32 mMaskNextOwner;
+		U32 mFlags;
+		S64 mCreationDate;
+		S32 mSalePrice;
+		StringRef mName;
+		StringRef mDescription;
+		S8 mType;
+		S8 mInventoryType;
+		S8 mSaleType;
+		U8 mGroupOwned;
+	};
+
+	// Called with items [first, end) of section, all from the same run.
+	// Runs execute on different threads, calls within a run are in file order.
+	typedef std::function<void (U32 section, U32 first, U32 end, U32 run)> decode_func_t;
+
+	LLInventoryCacheFile();
+	~LLInventoryCacheFile();
+
+	// Maps filename and checks the header, the section runs and every
+	// string reference, so the records can be used without further checks.
+	bool open(const std::string& filename);
+	void close();
+
+	bool isOpen() const					{ return mFile.isOpen(); }
+
+	// LLInventoryModel's cache version of the writer.
+	S32 getCacheVersion() const;
+	U32 getSectionCount() const;
+	U32 getItemCount() const;
+
+	const Section& getSection(U32 index) const;
+	const ItemRecord& getItem(U32 index) const;
+	std::string getString(const StringRef& ref) const;
+
+	// Splits the items into runs of about the same size and decodes each
+	// run on its own thread, the calling thread taking the first one.
+	// Returns once every run is done.
+	void decodeItems(U32 runs, const decode_func_t& decode) const;
+
+	// A run count for decodeItems() suited to the item count and cores.
+	U32 getDefaultRuns() const;
+
+	class Builder
+	{
+	public:
+		Builder();
+
+		// Items added after a section belong to it.
+		Section& addSection(const LLUUID& id);
+		ItemRecord& addItem();
+		StringRef addString(const std::string& str);
+
+		// Writes to a temporary file first, an interrupted save leaves the
+		// previous cache in place.
+		bool save(const std::string& filename, S32 cache_version) const;
+
+		U32 getSectionCount() const		{ return (U32)mSections.size(); }
+		U32 getItemCount() const		{ return (U32)mItems.size(); }
+
+	private:
+		std::vector<Section> mSections;
+		std::vector<ItemRecord> mItems;
+		std::string mStrings;
+	};
+
+private:
+	struct Header;
+
+	const Header* getHeader() const;
+	const Section* getSections() const;
+	const ItemRecord* getItems() const;
+	const char* getStrings() const;
+
+	bool validate() const;
+	bool validString(const StringRef& ref) const;
+	U32 findSection(U32 item) const;
+
+private:
+	LLMappedFile mFile;
+};
+
+// Append-only log of the changes made to an inventory after its cache file
+// was written. Replaying the journals over the cache in order gives the
+// current inventory, compact() folds them into the cache file.
+// Each entry is framed by its size and checksum, so a crash can only cost
+// the entry being written when it happened.
+class LLInventoryCacheJournal
+{
+public:
+	enum EOperation
+	{
+		OP_CATEGORY = 1,	// add or replace mCategory
+		OP_ITEM = 2,		// add or replace mItem, in mParentID
+		OP_REMOVE = 3		// remove mID, category or item
+	};
+
+	struct Entry
+	{
+		Entry();
+
+		U8 mOperation;
+		bool mReplaceItems;	// OP_CATEGORY: all its items follow, forget older ones
+		LLUUID mID;			// set by replay for every operation
+		LLUUID mParentID;
+		LLInventoryCacheFile::Section mCategory;	// string refs and item run unused
+		LLInventoryCacheFile::ItemRecord mItem;		// string refs unused
+		std::string mName;
+		std::string mDescription;
+	};
+
+	typedef std::function<void (const Entry& entry)> replay_func_t;
+
+	LLInventoryCacheJournal();
+	~LLInventoryCacheJournal();
+
+	// Starts a new journal, replacing any file of that name.
+	bool create(const std::string& filename, S32 cache_version);
+	void close();
+
+	bool isOpen() const					{ return mFile != nullptr; }
+	const std::string& getFilename() const	{ return mFilename; }
+	U64 getSize() const					{ return mSize; }
+	U32 getEntryCount() const			{ return mEntryCount; }
+
+	bool append(const Entry& entry);
+	// Hands the appended entries to the OS, once per batch of changes.
+	void flush();
+
+	// Calls replay for each entry in order. Returns false if the file is
+	// missing or was written for another cache version. Replay stops at the
+	// first damaged entry.
+	static bool replay(const std::string& filename, S32 cache_version, const replay_func_t& replay);
+
+	// Rewrites cache_filename with journals applied in order, then deletes
+	// the journals. Items listed before their category was listed again are
+	// dropped, items left without a category are kept in a section of their
+	// parent's id without SECTION_CATEGORY. Safe to run on a worker thread
+	// as long as nothing else opens these files meanwhile.
+	static bool compact(const std::string& cache_filename,
+						const std::vector<std::string>& journals,
+						S32 cache_version);
+
+private:
+	LLFILE* mFile;
+	std::string mFilename;
+	U64 mSize;
+	U32 mEntryCount;
+	std::vector<U8> mBuffer;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
@@ -26,6 +26,8 @@
 
 #include "llviewerprecompiledheaders.h"
 
+#include <atomic>
+#include <thread>
 #include <typeinfo>
 #include <utility>
 
@@ -39,6 +41,8 @@
 #include "llclipboard.h"
 #include "llinventorypanel.h"
 #include "llinventorybridge.h"
+#include "llinventorycache.h"
+#include "lldiriterator.h"
 #include "llinventoryfunctions.h"
 #include "llinventoryobserver.h"
 #include "llinventorypanel.h"
@@ -83,6 +87,7 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
 static const char PRODUCTION_CACHE_FORMAT_STRING[] = "%s.inv";
 static const char GRID_CACHE_FORMAT_STRING[] = "%s.%s.inv";
+static const char BINARY_CACHE_SUFFIX[] = ".bin";
 static const char * const LOG_INV("Inventory");
 
 struct InventoryIDPtrLess
@@ -132,6 +137,364 @@ bool LLCanCache::operator()(LLInventoryCategory* cat, LLInventoryItem* item)
 	return rv;
 }
 
+///----------------------------------------------------------------------------
+/// Cache records
+///----------------------------------------------------------------------------
+
+// Everything but the string references and the item run
+static void category_to_record(const LLViewerInventoryCategory* cat,
+							   LLInventoryCacheFile::Section& section)
+{
+	section.mID = cat->getUUID();
+	section.mParentID = cat->getParentUUID();
+	section.mOwnerID = cat->getOwnerID();
+	section.mVersion = cat->getVersion();
+	section.mType = (S8)cat->getActualType();
+	section.mPreferredType = (S8)cat->getPreferredType();
+	section.mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+}
+
+static LLPointer<LLViewerInventoryCategory> category_from_record(const LLInventoryCacheFile::Section& section,
+																 const std::string& name)
+{
+	LLPointer<LLViewerInventoryCategory> cat =
+		new LLViewerInventoryCategory(section.mID, section.mParentID,
+									  (LLFolderType::EType)section.mPreferredType,
+									  name, section.mOwnerID);
+	cat->setType((LLAssetType::EType)section.mType);
+	cat->setVersion(section.mVersion);
+	return cat;
+}
+
+// The item's own fields, the viewer accessors report a link's target.
+// Everything but the string references.
+static void item_to_record(const LLViewerInventoryItem* item,
+						   LLInventoryCacheFile::ItemRecord& record)
+{
+	const LLPermissions& perm = item->LLInventoryItem::getPermissions();
+	const LLSaleInfo& sale_info = item->LLInventoryItem::getSaleInfo();
+	record.mID = item->getUUID();
+	record.mAssetID = item->LLInventoryItem::getAssetUUID();
+	record.mCreatorID = perm.getCreator();
+	record.mOwnerID = perm.getOwner();
+	record.mLastOwnerID = perm.getLastOwner();
+	record.mGroupID = perm.getGroup();
+	record.mMaskBase = perm.getMaskBase();
+	record.mMaskOwner = perm.getMaskOwner();
+	record.mMaskGroup = perm.getMaskGroup();
+	record.mMaskEveryone = perm.getMaskEveryone();
+	record.mMaskNextOwner = perm.getMaskNextOwner();
+	record.mGroupOwned = perm.isGroupOwned() ? 1 : 0;
+	record.mFlags = item->LLInventoryItem::getFlags();
+	record.mCreationDate = (S64)item->LLInventoryItem::getCreationDate();
+	record.mSalePrice = sale_info.getSalePrice();
+	record.mSaleType = (S8)sale_info.getSaleType();
+	record.mType = (S8)item->getActualType();
+	record.mInventoryType = (S8)item->LLInventoryItem::getInventoryType();
+}
+
+static LLPointer<LLViewerInventoryItem> item_from_record(const LLInventoryCacheFile::ItemRecord& record,
+														 const LLUUID& parent_id,
+														 const std::string& name,
+														 const std::string& description)
+{
+	// As LLPermissions::importFile(): the masks as saved, fixed up once
+	// group ownership is known, without fixFairUse()
+	LLPermissions perm;
+	perm.init(record.mCreatorID, record.mOwnerID, record.mLastOwnerID, record.mGroupID);
+	perm.yesReallySetOwner(record.mOwnerID, record.mGroupOwned != 0);
+	perm.setMaskBase(record.mMaskBase);
+	perm.setMaskOwner(record.mMaskOwner);
+	perm.setMaskGroup(record.mMaskGroup);
+	perm.setMaskEveryone(record.mMaskEveryone);
+	perm.setMaskNext(record.mMaskNextOwner);
+	perm.fix();
+	LLPointer<LLViewerInventoryItem> item =
+		new LLViewerInventoryItem(record.mID, parent_id, perm, record.mAssetID,
+								  (LLAssetType::EType)record.mType,
+								  (LLInventoryType::EType)record.mInventoryType,
+								  name, description,
+								  LLSaleInfo((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice),
+								  record.mFlags, (time_t)record.mCreationDate);
+	// As after importFileLocal(), cached items still need fetching
+	item->setComplete(FALSE);
+	return item;
+}
+
+///----------------------------------------------------------------------------
+/// Class LLInventoryJournalObserver
+///
+/// Appends each change to the agent's inventory to the cache journal. A full
+/// journal is closed and folded into the cache file on a worker thread while
+/// a new one takes its place.
+///----------------------------------------------------------------------------
+
+class LLInventoryJournalObserver : public LLInventoryObserver
+{
+public:
+	LLInventoryJournalObserver(LLInventoryModel* model,
+							   const LLUUID& owner_id,
+							   const std::string& cache_filename,
+							   S32 cache_version,
+							   const std::vector<std::string>& journals,
+							   U32 next_sequence,
+							   const uuid_set_t& listed_categories);
+	~LLInventoryJournalObserver() override;
+
+	void changed(U32 mask) override;
+
+	const LLUUID& getOwnerID() const { return mOwnerID; }
+
+	// Closes the journal and waits for a running compaction. What was not
+	// compacted yet is replayed at the next login.
+	void stop();
+
+private:
+	bool openJournal();
+	// Returns true if the category's items were written along with it.
+	bool journalCategory(const LLViewerInventoryCategory* cat);
+	void journalItem(const LLViewerInventoryItem* item);
+	void journalRemove(const LLUUID& id);
+
+	void startCompaction();
+	// Reaps a finished compaction, or waits for it. Returns false while
+	// one is still running.
+	bool finishCompaction(bool wait);
+
+	enum ECompactResult
+	{
+		COMPACT_RUNNING,
+		COMPACT_FAILED,
+		COMPACT_DONE
+	};
+
+	LLInventoryModel* mModel;
+	LLUUID mOwnerID;
+	std::string mCacheFilename;
+	S32 mCacheVersion;
+	U32 mSequence;
+	LLInventoryCacheJournal mJournal;
+	LLInventoryCacheJournal::Entry mEntry;
+	// Categories whose items in the cache and journals are known to be
+	// complete. Others get all their items written again once complete.
+	uuid_set_t mListedCategories;
+	std::vector<std::string> mClosedJournals;	// oldest first
+	size_t mCompacting;							// leading mClosedJournals handed to the worker
+	std::thread mCompactThread;
+	std::atomic<S32> mCompactResult;
+};
+
+static const U64 MAX_JOURNAL_BYTES = 4 * 1024 * 1024;
+static const char CACHE_JOURNAL_SUFFIX[] = ".journal.";
+
+LLInventoryJournalObserver::LLInventoryJournalObserver(LLInventoryModel* model,
+													   const LLUUID& owner_id,
+													   const std::string& cache_filename,
+													   S32 cache_version,
+													   const std::vector<std::string>& journals,
+													   U32 next_sequence,
+													   const uuid_set_t& listed_categories)
+:	mModel(model),
+	mOwnerID(owner_id),
+	mCacheFilename(cache_filename),
+	mCacheVersion(cache_version),
+	mSequence(next_sequence),
+	mListedCategories(listed_categories),
+	mClosedJournals(journals),
+	mCompacting(0),
+	mCompactResult(COMPACT_DONE)
+{
+	openJournal();
+	// Fold in what the last session left behind
+	startCompaction();
+}
+
+LLInventoryJournalObserver::~LLInventoryJournalObserver()
+{
+	stop();
+}
+
+void LLInventoryJournalObserver::stop()
+{
+	mJournal.close();
+	finishCompaction(true);
+}
+
+bool LLInventoryJournalObserver::openJournal()
+{
+	const std::string filename = mCacheFilename + CACHE_JOURNAL_SUFFIX + std::to_string(mSequence++);
+	return mJournal.create(filename, mCacheVersion);
+}
+
+void LLInventoryJournalObserver::changed(U32 mask)
+{
+	if (!mJournal.isOpen())
+	{
+		return;
+	}
+
+	// Categories first, so items written with a listing are not written twice
+	const LLUUID& root_id = mModel->getRootFolderID();
+	uuid_set_t categories;
+	uuid_vec_t items;
+	for (const LLUUID& id : mModel->getChangedIDs())
+	{
+		if (const LLViewerInventoryItem* item = mModel->getItem(id))
+		{
+			if (mModel->isObjectDescendentOf(id, root_id))
+			{
+				items.push_back(id);
+				categories.insert(item->getParentUUID());
+			}
+		}
+		else if (mModel->getCategory(id))
+		{
+			if (mModel->isObjectDescendentOf(id, root_id))
+			{
+				categories.insert(id);
+			}
+		}
+		else if (mask & LLInventoryObserver::REMOVE)
+		{
+			journalRemove(id);
+		}
+	}
+
+	uuid_set_t listed;
+	for (const LLUUID& id : categories)
+	{
+		const LLViewerInventoryCategory* cat = mModel->getCategory(id);
+		if (cat && journalCategory(cat))
+		{
+			listed.insert(id);
+		}
+	}
+	for (const LLUUID& id : items)
+	{
+		const LLViewerInventoryItem* item = mModel->getItem(id);
+		if (listed.find(item->getParentUUID()) == listed.end())
+		{
+			journalItem(item);
+		}
+	}
+
+	mJournal.flush();
+	if (mJournal.getSize() > MAX_JOURNAL_BYTES)
+	{
+		startCompaction();
+	}
+}
+
+bool LLInventoryJournalObserver::journalCategory(const LLViewerInventoryCategory* cat)
+{
+	mEntry.mOperation = LLInventoryCacheJournal::OP_CATEGORY;
+	mEntry.mReplaceItems = false;
+	category_to_record(cat, mEntry.mCategory);
+	mEntry.mName = cat->getName();
+
+	// As LLCanCache, a version is only worth keeping while it accounts for
+	// every descendent
+	if (cat->getVersion() == LLViewerInventoryCategory::VERSION_UNKNOWN
+		|| cat->getDescendentCount() != cat->getViewerDescendentCount())
+	{
+		mEntry.mCategory.mVersion = LLViewerInventoryCategory::VERSION_UNKNOWN;
+		mListedCategories.erase(cat->getUUID());
+		mJournal.append(mEntry);
+		return false;
+	}
+	if (!mListedCategories.insert(cat->getUUID()).second)
+	{
+		mJournal.append(mEntry);
+		return false;
+	}
+
+	// Complete for the first time, what the cache holds for it may be stale
+	mEntry.mReplaceItems = true;
+	mJournal.append(mEntry);
+	LLInventoryModel::cat_array_t* cats = nullptr;
+	LLInventoryModel::item_array_t* items = nullptr;
+	mModel->getDirectDescendentsOf(cat->getUUID(), cats, items);
+	if (items)
+	{
+		for (const LLPointer<LLViewerInventoryItem>& item : *items)
+		{
+			journalItem(item);
+		}
+	}
+	return true;
+}
+
+void LLInventoryJournalObserver::journalItem(const LLViewerInventoryItem* item)
+{
+	mEntry.mOperation = LLInventoryCacheJournal::OP_ITEM;
+	mEntry.mParentID = item->getParentUUID();
+	item_to_record(item, mEntry.mItem);
+	mEntry.mName = item->LLInventoryObject::getName();
+	mEntry.mDescription = item->getActualDescription();
+	mJournal.append(mEntry);
+}
+
+void LLInventoryJournalObserver::journalRemove(const LLUUID& id)
+{
+	mEntry.mOperation = LLInventoryCacheJournal::OP_REMOVE;
+	mEntry.mID = id;
+	mListedCategories.erase(id);
+	mJournal.append(mEntry);
+}
+
+void LLInventoryJournalObserver::startCompaction()
+{
+	if (!finishCompaction(false))
+	{
+		return;
+	}
+
+	if (mJournal.getEntryCount() > 0)
+	{
+		mClosedJournals.push_back(mJournal.getFilename());
+		mJournal.close();
+		openJournal();
+	}
+	if (mClosedJournals.empty())
+	{
+		return;
+	}
+
+	mCompacting = mClosedJournals.size();
+	mCompactResult = COMPACT_RUNNING;
+	mCompactThread = std::thread([this, journals = mClosedJournals, filename = mCacheFilename,
+								  version = mCacheVersion]()
+		{
+			const bool success = LLInventoryCacheJournal::compact(filename, journals, version);
+			mCompactResult = success ? COMPACT_DONE : COMPACT_FAILED;
+		});
+}
+
+bool LLInventoryJournalObserver::finishCompaction(bool wait)
+{
+	if (!mCompactThread.joinable())
+	{
+		return true;
+	}
+	if (!wait && mCompactResult == COMPACT_RUNNING)
+	{
+		return false;
+	}
+
+	mCompactThread.join();
+	if (mCompactResult == COMPACT_DONE)
+	{
+		mClosedJournals.erase(mClosedJournals.begin(), mClosedJournals.begin() + mCompacting);
+	}
+	else
+	{
+		// Kept for the next attempt, or the next login
+		LL_WARNS(LOG_INV) << "Unable to compact inventory journals into " << mCacheFilename << LL_ENDL;
+	}
+	mCompacting = 0;
+	return true;
+}
+
 ///----------------------------------------------------------------------------
 /// Class LLInventoryModel
 ///----------------------------------------------------------------------------
@@ -156,6 +519,7 @@ LLInventoryModel::LLInventoryModel()
 	mModifyMask(LLInventoryObserver::ALL),
 	mChangedItemIDs(),
 	mObservers(),
+	mJournalObserver(nullptr),
 	mHttpRequestFG(nullptr),
 	mHttpRequestBG(nullptr),
 	mHttpOptions(),
@@ -186,6 +550,7 @@ void LLInventoryModel::cleanupInventory()
 		delete observer;
 	}
 	mObservers.clear();
+	mJournalObserver = nullptr;
 
 	// Run down HTTP transport
     mHttpHeaders.reset();
@@ -1796,12 +2161,24 @@ std::string LLInventoryModel::getInvCacheAddres(const LLUUID& owner_id)
 	return inventory_addr;
 }
 
+//static
+std::string LLInventoryModel::getInvBinaryCacheAddres(const LLUUID& owner_id)
+{
+	return getInvCacheAddres(owner_id) + BINARY_CACHE_SUFFIX;
+}
+
 void LLInventoryModel::cache(
 	const LLUUID& parent_folder_id,
 	const LLUUID& agent_id)
 {
 	LL_DEBUGS(LOG_INV) << "Caching " << parent_folder_id << " for " << agent_id
 		<< LL_ENDL;
+	if (mJournalObserver && mJournalObserver->getOwnerID() == agent_id)
+	{
+		// Every change since login is in the journal already
+		mJournalObserver->stop();
+		return;
+	}
 	LLViewerInventoryCategory* root_cat = getCategory(parent_folder_id);
 	if(!root_cat) return;
 	cat_array_t categories;
@@ -1816,18 +2193,15 @@ void LLInventoryModel::cache(
 		items,
 		INCLUDE_TRASH,
 		can_cache);
-	std::string inventory_filename = getInvCacheAddres(agent_id);
-	saveToFile(inventory_filename, categories, items);
-	std::string gzip_filename(inventory_filename);
-	gzip_filename.append(".gz");
-	if(gzip_file(inventory_filename, gzip_filename))
+	const std::string cache_filename = getInvBinaryCacheAddres(agent_id);
+	if (saveToCache(cache_filename, categories, items))
 	{
-		LL_DEBUGS(LOG_INV) << "Successfully compressed " << inventory_filename << LL_ENDL;
-		LLFile::remove(inventory_filename);
-	}
-	else
-	{
-		LL_WARNS(LOG_INV) << "Unable to compress " << inventory_filename << LL_ENDL;
+		// Journals of the previous cache are stale now
+		U32 next_sequence = 0;
+		for (const std::string& journal : getCacheJournals(cache_filename, next_sequence))
+		{
+			LLFile::remove(journal);
+		}
 	}
 }
 
@@ -2129,31 +2503,52 @@ bool LLInventoryModel::loadSkeleton(
 		changed_items_t categories_to_update;
 		item_array_t possible_broken_links;
 		cat_set_t invalid_categories; // Used to mark categories that weren't successfully loaded.
-		std::string inventory_filename = getInvCacheAddres(owner_id);
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
+		std::string cache_filename = getInvBinaryCacheAddres(owner_id);
+		std::string inventory_filename = getInvCacheAddres(owner_id);
 		std::string gzip_filename(inventory_filename);
 		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
-		bool remove_inventory_file = false;
-		if(fp)
+		if(!LLFile::isfile(cache_filename) && LLFile::isfile(gzip_filename))
 		{
-			fclose(fp);
-			fp = nullptr;
+			// Left by an older viewer, convert it once and drop it. It is
+			// kept until the new cache is safely written.
 			if(gunzip_file(gzip_filename, inventory_filename))
 			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
+				if (convertLegacyCache(inventory_filename, cache_filename))
+				{
+					LL_INFOS(LOG_INV) << "Converted " << gzip_filename << " to " << cache_filename << LL_ENDL;
+					LLFile::remove(gzip_filename);
+				}
+				else
+				{
+					LL_WARNS(LOG_INV) << "Unable to convert " << gzip_filename << LL_ENDL;
+				}
+				LLFile::remove(inventory_filename);
 			}
 			else
 			{
 				LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
 			}
 		}
+		else if(LLFile::isfile(gzip_filename))
+		{
+			// Superseded by a cache written since
+			LLFile::remove(gzip_filename);
+		}
+		// Only the agent's own inventory changes enough to journal
+		const bool journaled = (owner_id == gAgent.getID());
+		U32 next_journal = 0;
+		std::vector<std::string> journals;
+		if (journaled)
+		{
+			journals = getCacheJournals(cache_filename, next_journal);
+		}
 		bool is_cache_obsolete = false;
-		if (loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete))
+		const bool cache_loaded = loadFromCache(cache_filename, categories, items, categories_to_update, is_cache_obsolete);
+		if (cache_loaded)
 		{
+			replayCacheJournals(journals, categories, items, categories_to_update);
+
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
 			// will go through each category loaded and if the version
@@ -2328,16 +2723,22 @@ bool LLInventoryModel::loadSkeleton(
 			}
 		}
 
-		if(remove_inventory_file)
-		{
-			// clean up the gunzipped file.
-			LLFile::remove(inventory_filename);
-		}
 		if(is_cache_obsolete)
 		{
-			// If out of date, remove the gzipped file too.
 			LL_WARNS(LOG_INV) << "Inv cache out of date, removing" << LL_ENDL;
-			LLFile::remove(gzip_filename);
+			LLFile::remove(cache_filename);
+		}
+		if (!cache_loaded)
+		{
+			// Journals are only good on top of the cache they followed
+			for (const std::string& journal : journals)
+			{
+				LLFile::remove(journal);
+			}
+		}
+		else if (journaled)
+		{
+			startCacheJournal(owner_id, cache_filename, journals, next_journal);
 		}
 		categories.clear(); // will unref and delete entries
 	}
@@ -2826,43 +3227,325 @@ bool LLInventoryModel::loadFromFile(const std::string& filename,
 }
 
 // static
-bool LLInventoryModel::saveToFile(const std::string& filename,
-                                  const cat_array_t& categories,
-                                  const item_array_t& items)
+bool LLInventoryModel::loadFromCache(const std::string& filename,
+									 LLInventoryModel::cat_array_t& categories,
+									 LLInventoryModel::item_array_t& items,
+									 LLInventoryModel::changed_items_t& cats_to_update,
+									 bool& is_cache_obsolete)
+{
+	LL_INFOS(LOG_INV) << "LLInventoryModel::loadFromCache(" << filename << ")" << LL_ENDL;
+	is_cache_obsolete = true;  		// Obsolete until proven current
+	LLInventoryCacheFile cache;
+	if (!cache.open(filename))
+	{
+		LL_INFOS(LOG_INV) << "unable to load inventory from: " << filename << LL_ENDL;
+		return false;
+	}
+	if (cache.getCacheVersion() != sCurrentInvCacheVersion)
+	{
+		return false;
+	}
+	is_cache_obsolete = false;
+
+	const U32 section_count = cache.getSectionCount();
+	for (U32 i = 0; i < section_count; ++i)
+	{
+		const LLInventoryCacheFile::Section& section = cache.getSection(i);
+		if ((section.mFlags & LLInventoryCacheFile::SECTION_CATEGORY)
+			&& section.mVersion != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			categories.push_back(category_from_record(section, cache.getString(section.mName)));
+		}
+	}
+
+	// Each run fills its own arrays, appended in file order afterwards
+	const U32 runs = cache.getDefaultRuns();
+	std::vector<item_array_t> run_items(runs);
+	std::vector<uuid_vec_t> run_updates(runs);
+	cache.decodeItems(runs, [&](U32 section_index, U32 first, U32 end, U32 run)
+		{
+			const LLUUID& parent_id = cache.getSection(section_index).mID;
+			item_array_t& out_items = run_items[run];
+			for (U32 i = first; i < end; ++i)
+			{
+				const LLInventoryCacheFile::ItemRecord& record = cache.getItem(i);
+				if (record.mID.isNull())
+				{
+					continue;
+				}
+				if (record.mType == LLAssetType::AT_UNKNOWN)
+				{
+					run_updates[run].push_back(parent_id);
+					continue;
+				}
+
+				out_items.push_back(item_from_record(record, parent_id, cache.getString(record.mName),
+													 cache.getString(record.mDescription)));
+			}
+		});
+
+	for (U32 run = 0; run < runs; ++run)
+	{
+		items.insert(items.end(), run_items[run].begin(), run_items[run].end());
+		cats_to_update.insert(run_updates[run].begin(), run_updates[run].end());
+	}
+	LL_INFOS(LOG_INV) << "Loaded " << categories.size() << " categories and " << items.size()
+					  << " items from " << filename << " on " << runs << " threads" << LL_ENDL;
+	return true;
+}
+
+// static
+bool LLInventoryModel::saveToCache(const std::string& filename,
+								   const cat_array_t& categories,
+								   const item_array_t& items)
 {
 	if(filename.empty())
 	{
 		LL_ERRS(LOG_INV) << "Filename is Null!" << LL_ENDL;
 		return false;
 	}
-	LL_INFOS(LOG_INV) << "LLInventoryModel::saveToFile(" << filename << ")" << LL_ENDL;
-	LLFILE* file = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
-	if(!file)
+	LL_INFOS(LOG_INV) << "LLInventoryModel::saveToCache(" << filename << ")" << LL_ENDL;
+
+	// One section per category, followed by the items of any parent that
+	// was not saved itself.
+	typedef std::map<LLUUID, std::vector<const LLViewerInventoryItem*> > items_by_parent_t;
+	items_by_parent_t items_by_parent;
+	for (const LLPointer<LLViewerInventoryItem>& item : items)
+	{
+		items_by_parent[item->getParentUUID()].push_back(item.get());
+	}
+
+	LLInventoryCacheFile::Builder builder;
+	auto add_items = [&builder](const std::vector<const LLViewerInventoryItem*>& section_items)
+	{
+		for (const LLViewerInventoryItem* item : section_items)
+		{
+			LLInventoryCacheFile::ItemRecord& record = builder.addItem();
+			item_to_record(item, record);
+			record.mName = builder.addString(item->LLInventoryObject::getName());
+			record.mDescription = builder.addString(item->getActualDescription());
+		}
+	};
+
+	for (const LLPointer<LLViewerInventoryCategory>& cat : categories)
+	{
+		LLInventoryCacheFile::Section& section = builder.addSection(cat->getUUID());
+		category_to_record(cat, section);
+		section.mName = builder.addString(cat->getName());
+
+		items_by_parent_t::iterator it = items_by_parent.find(cat->getUUID());
+		if (it != items_by_parent.end())
+		{
+			add_items(it->second);
+			items_by_parent.erase(it);
+		}
+	}
+	for (const items_by_parent_t::value_type& orphans : items_by_parent)
+	{
+		builder.addSection(orphans.first);
+		add_items(orphans.second);
+	}
+
+	return builder.save(filename, sCurrentInvCacheVersion);
+}
+
+// static
+bool LLInventoryModel::convertLegacyCache(const std::string& legacy_filename,
+										  const std::string& filename)
+{
+	cat_array_t categories;
+	item_array_t items;
+	changed_items_t cats_to_update;
+	bool is_cache_obsolete = false;
+	if (!loadFromFile(legacy_filename, categories, items, cats_to_update, is_cache_obsolete))
 	{
-		LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
 		return false;
 	}
 
-	fprintf(file, "\tinv_cache_version\t%d\n",sCurrentInvCacheVersion);
-	S32 count = categories.size();
-	S32 i;
-	for(i = 0; i < count; ++i)
+	// The text loader dropped items of unknown type and flagged their
+	// folders for a refetch, keep those folders stale.
+	for (const LLPointer<LLViewerInventoryCategory>& cat : categories)
 	{
-		LLViewerInventoryCategory* cat = categories[i];
-		if(cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		if (cats_to_update.find(cat->getUUID()) != cats_to_update.end())
 		{
-			cat->exportFileLocal(file);
+			cat->setVersion(LLViewerInventoryCategory::VERSION_UNKNOWN);
 		}
 	}
+	return saveToCache(filename, categories, items);
+}
 
-	count = items.size();
-	for(i = 0; i < count; ++i)
+// static
+std::vector<std::string> LLInventoryModel::getCacheJournals(const std::string& filename,
+															U32& next_sequence)
+{
+	const std::string dir = gDirUtilp->getDirName(filename);
+	const std::string prefix = gDirUtilp->getBaseFileName(filename) + CACHE_JOURNAL_SUFFIX;
+	std::map<U32, std::string> journals;
+	LLDirIterator iter(dir, prefix + "*");
+	std::string name;
+	while (iter.next(name))
+	{
+		const char* digits = name.c_str() + prefix.size();
+		char* end = nullptr;
+		const unsigned long sequence = strtoul(digits, &end, 10);
+		if (end != digits && *end == '\0')
+		{
+			journals[(U32)sequence] = gDirUtilp->add(dir, name);
+		}
+	}
+
+	next_sequence = journals.empty() ? 0 : journals.rbegin()->first + 1;
+	std::vector<std::string> filenames;
+	for (const auto& journal : journals)
 	{
-		items[i]->exportFile(file);
+		filenames.push_back(journal.second);
 	}
+	return filenames;
+}
 
-	fclose(file);
-	return true;
+// Replaces the entry for id, or appends it. Null entries mark removals.
+template<typename T>
+static size_t set_cached_entry(std::vector<LLPointer<T> >& array,
+							   std::map<LLUUID, size_t>& index,
+							   const LLUUID& id,
+							   const LLPointer<T>& entry)
+{
+	const auto it = index.find(id);
+	if (it != index.end())
+	{
+		array[it->second] = entry;
+		return it->second;
+	}
+	if (entry.notNull())
+	{
+		index[id] = array.size();
+		array.push_back(entry);
+	}
+	return array.size() - 1;
+}
+
+// static
+void LLInventoryModel::replayCacheJournals(const std::vector<std::string>& journals,
+										   cat_array_t& categories,
+										   item_array_t& items,
+										   changed_items_t& cats_to_update)
+{
+	if (journals.empty())
+	{
+		return;
+	}
+
+	std::map<LLUUID, size_t> cat_index;
+	std::map<LLUUID, size_t> item_index;
+	for (size_t i = 0; i < categories.size(); ++i)
+	{
+		cat_index[categories[i]->getUUID()] = i;
+	}
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		item_index[items[i]->getUUID()] = i;
+	}
+
+	// Entries are numbered from 1, the cache counts as 0. As in
+	// LLInventoryCacheJournal::compact(), an item older than the last
+	// listing of its category is gone.
+	U64 sequence = 0;
+	std::vector<U64> item_written(items.size(), 0);
+	std::map<LLUUID, U64> cat_listed;
+	const LLPointer<LLViewerInventoryCategory> no_cat;
+	const LLPointer<LLViewerInventoryItem> no_item;
+	for (const std::string& journal : journals)
+	{
+		LLInventoryCacheJournal::replay(journal, sCurrentInvCacheVersion,
+			[&](const LLInventoryCacheJournal::Entry& entry)
+			{
+				++sequence;
+				switch (entry.mOperation)
+				{
+				case LLInventoryCacheJournal::OP_CATEGORY:
+					// As in loadFromCache(), categories of unknown version are left out
+					if (entry.mCategory.mVersion != LLViewerInventoryCategory::VERSION_UNKNOWN)
+					{
+						set_cached_entry(categories, cat_index, entry.mID,
+										 category_from_record(entry.mCategory, entry.mName));
+					}
+					else
+					{
+						set_cached_entry(categories, cat_index, entry.mID, no_cat);
+					}
+					if (entry.mReplaceItems)
+					{
+						cat_listed[entry.mID] = sequence;
+					}
+					break;
+				case LLInventoryCacheJournal::OP_ITEM:
+					if (entry.mItem.mType == LLAssetType::AT_UNKNOWN)
+					{
+						cats_to_update.insert(entry.mParentID);
+						set_cached_entry(items, item_index, entry.mID, no_item);
+					}
+					else
+					{
+						const size_t i = set_cached_entry(items, item_index, entry.mID,
+							item_from_record(entry.mItem, entry.mParentID, entry.mName, entry.mDescription));
+						item_written.resize(items.size(), 0);
+						item_written[i] = sequence;
+					}
+					break;
+				case LLInventoryCacheJournal::OP_REMOVE:
+					set_cached_entry(categories, cat_index, entry.mID, no_cat);
+					set_cached_entry(items, item_index, entry.mID, no_item);
+					break;
+				}
+			});
+	}
+
+	categories.erase(std::remove_if(categories.begin(), categories.end(),
+									[](const LLPointer<LLViewerInventoryCategory>& cat) { return cat.isNull(); }),
+					 categories.end());
+	size_t kept = 0;
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		if (items[i].isNull())
+		{
+			continue;
+		}
+		const auto listed = cat_listed.find(items[i]->getParentUUID());
+		if (listed != cat_listed.end() && item_written[i] < listed->second)
+		{
+			continue;
+		}
+		items[kept++] = items[i];
+	}
+	items.resize(kept);
+	LL_INFOS(LOG_INV) << "Replayed " << sequence << " changes from " << journals.size()
+					  << " inventory journals" << LL_ENDL;
+}
+
+void LLInventoryModel::startCacheJournal(const LLUUID& owner_id,
+										 const std::string& filename,
+										 const std::vector<std::string>& journals,
+										 U32 next_sequence)
+{
+	if (mJournalObserver)
+	{
+		removeObserver(mJournalObserver);
+		delete mJournalObserver;
+		mJournalObserver = nullptr;
+	}
+
+	// Categories still holding their version were loaded in full
+	uuid_set_t listed_categories;
+	for (const auto& cat : mCategoryMap)
+	{
+		if (cat.second->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			listed_categories.insert(cat.first);
+		}
+	}
+	mJournalObserver = new LLInventoryJournalObserver(this, owner_id, filename, sCurrentInvCacheVersion,
+													  journals, next_sequence, listed_categories);
+	addObserver(mJournalObserver);
 }
 
 // message handling functionality
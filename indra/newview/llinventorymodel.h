@@ -42,6 +42,7 @@
 #include "absl/container/flat_hash_map.h"
 
 class LLInventoryObserver;
+class LLInventoryJournalObserver;
 class LLInventoryObject;
 class LLInventoryItem;
 class LLInventoryCategory;
@@ -157,6 +158,7 @@ public:
 	void createCommonSystemCategories();
 
 	static std::string getInvCacheAddres(const LLUUID& owner_id);
+	static std::string getInvBinaryCacheAddres(const LLUUID& owner_id);
 
 	// Call on logout to save a terse representation.
 	void cache(const LLUUID& parent_folder_id, const LLUUID& agent_id);
@@ -552,6 +554,8 @@ public:
 private:
 	typedef std::set<LLInventoryObserver*> observer_list_t;
 	observer_list_t mObservers;
+	// Records changes to the agent's inventory for the cache, owned by mObservers.
+	LLInventoryJournalObserver* mJournalObserver;
 	
 /**                    Notifications
  **                                                                            **
@@ -616,9 +620,33 @@ protected:
 							 item_array_t& items,
 							 changed_items_t& cats_to_update,
 							 bool& is_cache_obsolete); 
-	static bool saveToFile(const std::string& filename,
-						   const cat_array_t& categories,
-						   const item_array_t& items); 
+	// Binary cache, see LLInventoryCacheFile. Items are decoded on
+	// several threads for large inventories.
+	static bool loadFromCache(const std::string& filename,
+							  cat_array_t& categories,
+							  item_array_t& items,
+							  changed_items_t& cats_to_update,
+							  bool& is_cache_obsolete);
+	static bool saveToCache(const std::string& filename,
+							const cat_array_t& categories,
+							const item_array_t& items);
+	// Rewrites a cache left in the text format by older viewers.
+	static bool convertLegacyCache(const std::string& legacy_filename,
+								   const std::string& filename);
+	// Journals of the changes made since filename was saved, oldest first,
+	// and the sequence number for the next one.
+	static std::vector<std::string> getCacheJournals(const std::string& filename,
+													 U32& next_sequence);
+	static void replayCacheJournals(const std::vector<std::string>& journals,
+									cat_array_t& categories,
+									item_array_t& items,
+									changed_items_t& cats_to_update);
+	// From now on changes to owner_id's inventory go to a journal next to
+	// filename instead of waiting for cache() to rewrite it.
+	void startCacheJournal(const LLUUID& owner_id,
+						   const std::string& filename,
+						   const std::vector<std::string>& journals,
+						   U32 next_sequence);
 
 	//--------------------------------------------------------------------
 	// Message handling functionality
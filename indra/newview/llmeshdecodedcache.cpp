@@ -0,0 +1,242 @@
+/**
+ * @file llmeshdecodedcache.cpp
+ * @brief Cache of decoded mesh LODs, mapped back without decoding
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshdecodedcache.h"
+
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "lltimer.h"
+#include "llvolume.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+static const char* DECODED_CACHE_DIRNAME = "meshcache";
+static const char* SUBDIRS = "0123456789abcdef";
+
+#if LL_WINDOWS
+// Windows won't replace a file while it is mapped, as it is while another
+// thread loads the same LOD. Loads only keep it mapped while decoding.
+static const S32 RENAME_TRIES = 5;
+#else
+static const S32 RENAME_TRIES = 1;
+#endif
+static const U32 RENAME_RETRY_MS = 10;
+
+LLMeshDecodedCache::LLMeshDecodedCache()
+:	mMaxSize(0),
+	mReadOnly(true),
+	mEnabled(false),
+	mSize(0),
+	mTempCount(0)
+{
+}
+
+void LLMeshDecodedCache::init(ELLPath location, U64 max_size, bool read_only)
+{
+	mDirName = gDirUtilp->getExpandedFilename(location, DECODED_CACHE_DIRNAME);
+	mMaxSize = max_size;
+	mReadOnly = read_only;
+	if (!max_size)
+	{
+		return;
+	}
+
+	if (!read_only)
+	{
+		LLFile::mkdir(mDirName);
+		for (const char* subdir = SUBDIRS; *subdir; ++subdir)
+		{
+			std::string dirname = mDirName + gDirUtilp->getDirDelimiter() + *subdir;
+			LLFile::mkdir(dirname);
+			// Left over by a session that ended while writing
+			gDirUtilp->deleteFilesInDir(dirname, "*.tmp");
+		}
+	}
+	mEnabled = true;
+	trim();
+}
+
+bool LLMeshDecodedCache::load(LLVolume* volume, S32 lod)
+{
+	if (!mEnabled)
+	{
+		return false;
+	}
+
+	const std::string filename = getFilename(volume->getParams(), lod);
+	LLMappedFile file;
+	if (!file.open(filename, 0, true))
+	{
+		return false;
+	}
+	if (volume->unpackDecodedFaces(file.getData(), file.getSize()))
+	{
+		return true;
+	}
+
+	file.close();
+	LL_WARNS("MeshDecodedCache") << "Ignoring invalid decoded mesh " << filename << LL_ENDL;
+	if (!mReadOnly)
+	{
+		LLFile::remove(filename, ENOENT);
+	}
+	return false;
+}
+
+void LLMeshDecodedCache::save(const LLVolume* volume, S32 lod)
+{
+	if (!mEnabled || mReadOnly)
+	{
+		return;
+	}
+
+	std::vector<U8> block;
+	if (!volume->packDecodedFaces(block))
+	{
+		return;
+	}
+
+	// Written under a name of its own, so loads never see half a file and
+	// two threads saving the same LOD don't write over each other
+	const std::string filename = getFilename(volume->getParams(), lod);
+	const std::string temp_filename = llformat("%s.%u.tmp", filename.c_str(), mTempCount++);
+	LLFILE* file = LLFile::fopen(temp_filename, "wb");
+	if (!file)
+	{
+		LL_WARNS("MeshDecodedCache") << "Unable to write decoded mesh " << temp_filename << LL_ENDL;
+		return;
+	}
+	bool success = fwrite(block.data(), 1, block.size(), file) == block.size();
+	success = (fclose(file) == 0) && success;
+
+	for (S32 tries = 1; success; ++tries)
+	{
+		LLFile::remove(filename, ENOENT);
+		if (LLFile::rename(temp_filename, filename) == 0)
+		{
+			break;
+		}
+		if (tries >= RENAME_TRIES)
+		{
+			success = false;
+			break;
+		}
+		LL_INFOS("MeshDecodedCache") << "Decoded mesh " << filename << " in use, retrying" << LL_ENDL;
+		ms_sleep(RENAME_RETRY_MS);
+	}
+	if (success)
+	{
+		mSize += block.size();
+	}
+	else
+	{
+		LL_WARNS("MeshDecodedCache") << "Unable to write decoded mesh " << filename << LL_ENDL;
+		LLFile::remove(temp_filename, ENOENT);
+	}
+}
+
+void LLMeshDecodedCache::trim()
+{
+	if (!mEnabled || mReadOnly)
+	{
+		return;
+	}
+
+	struct Entry
+	{
+		time_t mTime;
+		S64 mSize;
+		std::string mFilename;
+	};
+
+	std::vector<Entry> entries;
+	S64 total = 0;
+	const std::string& delim = gDirUtilp->getDirDelimiter();
+	for (const char* subdir = SUBDIRS; *subdir; ++subdir)
+	{
+		std::string dirname = mDirName + delim + *subdir;
+		LLDirIterator iter(dirname, "*.mesh");
+		std::string filename;
+		while (iter.next(filename))
+		{
+			std::string path = dirname + delim + filename;
+			llstat stat_data;
+			if (!LLFile::stat(path, &stat_data))
+			{
+				entries.push_back({ stat_data.st_mtime, (S64)stat_data.st_size, path });
+				total += stat_data.st_size;
+			}
+		}
+	}
+
+	if (total > (S64)mMaxSize)
+	{
+		// Make room for a while, a trim scans the whole cache
+		const S64 target = (S64)(mMaxSize / 4 * 3);
+		std::sort(entries.begin(), entries.end(),
+				  [](const Entry& a, const Entry& b) { return a.mTime < b.mTime; });
+		U32 removed = 0;
+		for (const Entry& entry : entries)
+		{
+			if (total <= target)
+			{
+				break;
+			}
+			if (!LLFile::remove(entry.mFilename, ENOENT))
+			{
+				total -= entry.mSize;
+				++removed;
+			}
+		}
+		LL_INFOS("MeshDecodedCache") << "Removed " << removed << " decoded meshes, "
+									 << total / (1024 * 1024) << " MB left" << LL_ENDL;
+	}
+	mSize = total;
+}
+
+// static
+void LLMeshDecodedCache::removeCache(ELLPath location)
+{
+	std::string dirname = gDirUtilp->getExpandedFilename(location, DECODED_CACHE_DIRNAME);
+	if (LLFile::isdir(dirname))
+	{
+		gDirUtilp->deleteDirAndContents(dirname);
+	}
+}
+
+std::string LLMeshDecodedCache::getFilename(const LLVolumeParams& params, S32 lod) const
+{
+	// Mirroring and inverting are applied while decoding, they key the file
+	// along with the mesh and LOD
+	std::string idstr = params.getSculptID().asString();
+	const std::string& delim = gDirUtilp->getDirDelimiter();
+	return mDirName + delim + idstr[0] + delim + idstr
+		+ llformat("_%d_%02x.mesh", lod, (U32)params.getSculptType());
+}
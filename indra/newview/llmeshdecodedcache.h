@@ -0,0 +1,77 @@
+/**
+ * @file llmeshdecodedcache.h
+ * @brief Cache of decoded mesh LODs, mapped back without decoding
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHDECODEDCACHE_H
+#define LL_LLMESHDECODEDCACHE_H
+
+#include "lldir.h"
+
+#include <atomic>
+#include <string>
+
+class LLVolume;
+class LLVolumeParams;
+
+// Second tier of the mesh cache, behind the compressed assets in the VFS.
+// Holds LOD volumes as LLVolume::packDecodedFaces() lays them out, one file
+// per mesh, LOD and sculpt flags, so a hit is mapped and copied into the
+// volume without inflating, dequantizing or cache optimizing it again.
+// Files are evicted oldest written first once the cache outgrows its size.
+// load() and save() are safe from any thread once init() returned.
+class LLMeshDecodedCache
+{
+public:
+	LLMeshDecodedCache();
+
+	// Creates the cache directory under location and trims the cache to
+	// max_size. A max_size of 0 leaves the cache off.
+	void init(ELLPath location, U64 max_size, bool read_only);
+
+	bool isEnabled() const			{ return mEnabled; }
+
+	// Fills volume with the faces cached for its mesh and lod.
+	bool load(LLVolume* volume, S32 lod);
+	void save(const LLVolume* volume, S32 lod);
+
+	// Writes since the last trim() took the cache past its size.
+	bool needsTrim() const			{ return mEnabled && !mReadOnly && mSize > (S64)mMaxSize; }
+	// Deletes the oldest files until the cache is well under its size.
+	void trim();
+
+	static void removeCache(ELLPath location);
+
+private:
+	std::string getFilename(const LLVolumeParams& params, S32 lod) const;
+
+private:
+	std::string mDirName;
+	U64 mMaxSize;
+	bool mReadOnly;
+	std::atomic<bool> mEnabled;
+	std::atomic<S64> mSize;			// bytes on disk, as of the last trim() plus writes since
+	std::atomic<U32> mTempCount;	// makes the names of files being written unique
+};
+
+#endif // LL_LLMESHDECODEDCACHE_H
@@ -41,6 +41,7 @@
 #include "llhost.h"
 #include "llmath.h"
 #include "llnotificationsutil.h"
+#include "llqueuedthreadpool.h"
 #include "llsd.h"
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
@@ -107,6 +108,9 @@
 //
 //   main     Main rendering thread, very sensitive to locking and other stalls
 //   repo     Overseeing worker thread associated with the LLMeshRepoThread class
+//   decode   LLMeshDecodeThread, decodes LOD, skin, decomposition and physics
+//            shape blocks on the image decode pool, or on a pool of its own
+//            (MeshDecodeThreads)
 //   decom    Worker thread for mesh decomposition requests
 //   core     HTTP worker thread:  does the work but doesn't intrude here
 //   uploadN  0-N temporary mesh upload threads (0-1 in practice)
@@ -143,13 +147,20 @@
 //                             ...
 //                             scan mLODReqQ
 //                             fetchMeshLOD() invoked
-//                               issue Byte-Range GET for LOD
+//                               decoded cache hit appends LoadedMesh to mLoadedQ
+//                               or issue Byte-Range GET for LOD
 //                             ...
 //                             onCompleted() invoked for GET
 //                               data copied
-//                               lodReceived() invoked
-//                                 unpack data into LLVolume
-//                                 append LoadedMesh to mLoadedQ
+//                               decodeBlock() queues it, by score
+//                             ...
+//                                                  decode thread
+//                                                  processBlock() invoked
+//                                                    lodReceived() invoked
+//                                                      unpack data into LLVolume
+//                                                      write it to the decoded cache
+//                                                      append LoadedMesh to mLoadedQ
+//                                                    data cached in VFS
 //                             ...
 //         notifyLoadedMeshes() invoked again
 //           scan mLoadedQ
@@ -223,6 +234,7 @@
 //     sCacheBytesWritten              "
 //     sCacheReads                     "
 //     sCacheWrites                    "
+//     sDecodedCacheReads              "
 //     mLoadingMeshes                  mMeshMutex [4]  rw.main.none, rw.any.mMeshMutex
 //     mSkinMap                        none            rw.main.none
 //     mDecompositionMap               none            rw.main.none
@@ -256,6 +268,10 @@
 //     mUnavailableQ            mMutex        rw.repo.none [0], ro.main.none [5], rw.main.mMutex
 //     mLoadedQ                 mMutex        rw.repo.mMutex, ro.main.none [5], rw.main.mMutex
 //     mPendingLOD              mMutex        rw.repo.mMutex, rw.any.mMutex
+//     mDecodeThread            none          rw.repo.none, requests run on the decode pool and
+//                                            reach the queues above through mMutex
+//     mDecodedCache            none          rw.main.none before init, then rw.repo.none and
+//                                            rw.decode.none, thread safe once initialized
 //     mGetMeshCapability       mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMesh2Capability      mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMeshVersion          mMutex        rw.main.mMutex, ro.repo.mMutex
@@ -390,6 +406,7 @@ U32 LLMeshRepository::sCacheBytesRead = 0;
 U32 LLMeshRepository::sCacheBytesWritten = 0;
 U32 LLMeshRepository::sCacheReads = 0;
 U32 LLMeshRepository::sCacheWrites = 0;
+U32 LLMeshRepository::sDecodedCacheReads = 0;
 U32 LLMeshRepository::sMaxLockHoldoffs = 0;
 	
 LLDeadmanTimer LLMeshRepository::sQuiescentTimer(15.0, false);	// true -> gather cpu metrics
@@ -596,7 +613,14 @@ public:
 	void onCompleted(LLCore::HttpHandle handle, LLCore::HttpResponse * response) override;
 	virtual void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) = 0;
 	virtual void processFailure(LLCore::HttpStatus status) = 0;
-	
+
+protected:
+	// Lets processData() keep the data past its return
+	U8* takeData() { return mData.release(); }
+
+private:
+	std::unique_ptr<U8[]> mData;
+
 public:
 	LLVolumeParams mMeshParams;
 	bool mProcessed;
@@ -636,9 +660,10 @@ class LLMeshLODHandler : public LLMeshHandlerBase
 {
 public:
 	LOG_CLASS(LLMeshLODHandler);
-	LLMeshLODHandler(const LLVolumeParams & mesh_params, S32 lod, U32 offset, U32 requested_bytes)
+	LLMeshLODHandler(const LLVolumeParams & mesh_params, S32 lod, F32 score, U32 offset, U32 requested_bytes)
 		: LLMeshHandlerBase(offset, requested_bytes),
-		  mLOD(lod)
+		  mLOD(lod),
+		  mScore(score)
 	{
 			mMeshParams = mesh_params;
 			LLMeshRepoThread::incActiveLODRequests();
@@ -653,6 +678,7 @@ public:
 
 public:
 	S32 mLOD;
+	F32 mScore;
 };
 
 
@@ -808,6 +834,74 @@ void log_upload_error(LLCore::HttpStatus status, const LLSD& content,
 	gMeshRepo.uploadError(args);
 }
 
+// static
+LLVolumeParams LLMeshBlock::getMeshParams(const LLUUID& mesh_id)
+{
+	LLVolumeParams volume_params;
+	volume_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+	volume_params.setSculptID(mesh_id, LL_SCULPT_TYPE_MESH);
+	return volume_params;
+}
+
+LLMeshDecodeThread::LLMeshDecodeThread(LLMeshRepoThread* repo, LLQueuedThreadPool* pool)
+:	LLQueuedThread("meshdecode", true, false, pool),
+	mRepo(repo),
+	mPendingBytes(0)
+{
+}
+
+bool LLMeshDecodeThread::decode(LLMeshBlock& block, U32 priority)
+{
+	if (isQuitting())
+	{
+		return false;
+	}
+
+	handle_t handle = generateHandle();
+	DecodeRequest* req = new DecodeRequest(handle, priority, this, std::move(block));
+	if (!addRequest(req))
+	{
+		// Shut down since the check above, hand the block back so the
+		// caller decodes it itself
+		block = std::move(req->mBlock);
+		req->deleteRequest();
+		return false;
+	}
+	return true;
+}
+
+// static
+U32 LLMeshDecodeThread::getLODPriority(F32 score)
+{
+	// The score is radius over distance, meshes at a quarter and a twentieth
+	// of that fall in the pool's high and normal buckets. Within a bucket a
+	// single queue still goes by score.
+	U32 priority = score >= 0.25f ? PRIORITY_HIGH : (score >= 0.05f ? PRIORITY_NORMAL : PRIORITY_LOW);
+	return priority | (U32)(llclamp(score, 0.f, 1.f) * PRIORITY_LOWBITS);
+}
+
+LLMeshDecodeThread::DecodeRequest::DecodeRequest(handle_t handle, U32 priority, LLMeshDecodeThread* thread, LLMeshBlock&& block)
+:	LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	mThread(thread),
+	mBlock(std::move(block))
+{
+	mThread->mPendingBytes += mBlock.mSize;
+}
+
+LLMeshDecodeThread::DecodeRequest::~DecodeRequest()
+{
+	mThread->mPendingBytes -= mBlock.mSize;
+}
+
+bool LLMeshDecodeThread::DecodeRequest::processRequest()
+{
+	if (!LLApp::isQuitting())
+	{
+		mThread->mRepo->processBlock(mBlock, true);
+	}
+	return true;
+}
+
 LLMeshRepoThread::LLMeshRepoThread()
 : LLThread("mesh repo"),
   mHttpRequest(nullptr),
@@ -818,7 +912,9 @@ LLMeshRepoThread::LLMeshRepoThread()
   mHttpLegacyPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLargePolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpPriority(0),
-  mLegacyGetMeshVersion(0)
+  mLegacyGetMeshVersion(0),
+  mDecodePool(nullptr),
+  mDecodeThread(nullptr)
 {
 	LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
 
@@ -837,6 +933,17 @@ LLMeshRepoThread::LLMeshRepoThread()
 	mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH2);
 	mHttpLegacyPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH1);
 	mHttpLargePolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_LARGE_MESH);
+
+	// Decoding shares the image decode pool when there is one, otherwise
+	// one decode thread runs its queue itself and more get their own pool
+	LLQueuedThreadPool* pool = LLAppViewer::sImageDecodePool;
+	U32 decode_threads = gSavedSettings.getU32("MeshDecodeThreads");
+	if (!pool && decode_threads != 1)
+	{
+		mDecodePool = new LLQueuedThreadPool("meshdecode", decode_threads);
+		pool = mDecodePool;
+	}
+	mDecodeThread = new LLMeshDecodeThread(this, pool);
 }
 
 
@@ -847,6 +954,12 @@ LLMeshRepoThread::~LLMeshRepoThread()
 					   << ", Max Lock Holdoffs:  " << LLMeshRepository::sMaxLockHoldoffs
 					   << LL_ENDL;
 
+	// Blocks still being decoded lock mMutex, finish them first
+	delete mDecodeThread;
+	mDecodeThread = nullptr;
+	delete mDecodePool; // after the decode thread, it runs on the pool
+	mDecodePool = nullptr;
+
 	mHttpRequestSet.clear();
     mHttpHeaders.reset();
 
@@ -895,6 +1008,11 @@ void LLMeshRepoThread::run()
 		{
 			break;
 		}
+
+		if (mDecodedCache.needsTrim())
+		{
+			mDecodedCache.trim();
+		}
 		
 		if (! mHttpRequestSet.empty())
 		{
@@ -908,10 +1026,10 @@ void LLMeshRepoThread::run()
 		// in relatively similar manners, remake code to simplify/unify the process,
 		// like processRequests(&requestQ, fetchFunction); which does same thing for each element
 
-        if (!mLODReqQ.empty() && mHttpRequestSet.size() < sRequestHighWater)
+        if (!mLODReqQ.empty() && canFetch())
         {
             std::list<LODRequest> incomplete;
-            while (!mLODReqQ.empty() && mHttpRequestSet.size() < sRequestHighWater)
+            while (!mLODReqQ.empty() && canFetch())
             {
                 if (!mMutex)
                 {
@@ -928,7 +1046,7 @@ void LLMeshRepoThread::run()
                     // failed to load before, wait a bit
                     incomplete.push_front(req);
                 }
-                else if (!fetchMeshLOD(req.mMeshParams, req.mLOD, req.canRetry()))
+                else if (!fetchMeshLOD(req))
                 {
                     if (req.canRetry())
                     {
@@ -1004,10 +1122,10 @@ void LLMeshRepoThread::run()
 		// Something to do probably, lock and double-check.  We don't want
 		// to hold the lock long here.  That will stall main thread activities
 		// so we bounce it.
-		if (!mSkinReqQ.empty() && mHttpRequestSet.size() < sRequestHighWater)
+		if (!mSkinReqQ.empty() && canFetch())
 		{
 			std::list<UUIDBasedRequest> incomplete;
-			while (!mSkinReqQ.empty() && mHttpRequestSet.size() < sRequestHighWater)
+			while (!mSkinReqQ.empty() && canFetch())
 			{
 				mMutex->lock();
 				auto req = mSkinReqQ.front();
@@ -1017,7 +1135,7 @@ void LLMeshRepoThread::run()
 				{
 					incomplete.emplace_back(req);
 				}
-				else if (!fetchMeshSkinInfo(req.mId, req.canRetry()))
+				else if (!fetchMeshSkinInfo(req.mId, req.canRetry(), req.mUseCache))
 				{
 					if (req.canRetry())
 					{
@@ -1047,10 +1165,10 @@ void LLMeshRepoThread::run()
 		// *TODO:  For UI/debug-oriented lists, we might drop the fine-
 		// grained locking as there's a lowered expectation of smoothness
 		// in these cases.
-		if (!mDecompositionRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+		if (!mDecompositionRequests.empty() && canFetch())
 		{
 			std::set<UUIDBasedRequest> incomplete;
-			while (!mDecompositionRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+			while (!mDecompositionRequests.empty() && canFetch())
 			{
 				mMutex->lock();
 				std::set<UUIDBasedRequest>::iterator iter = mDecompositionRequests.begin();
@@ -1061,7 +1179,7 @@ void LLMeshRepoThread::run()
 				{
 					incomplete.insert(req);
 				}
-				else if (!fetchMeshDecomposition(req.mId))
+				else if (!fetchMeshDecomposition(req.mId, req.mUseCache))
 				{
 					if (req.canRetry())
 					{
@@ -1083,10 +1201,10 @@ void LLMeshRepoThread::run()
 		}
 
 		// holding lock, final list
-		if (!mPhysicsShapeRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+		if (!mPhysicsShapeRequests.empty() && canFetch())
 		{
 			std::set<UUIDBasedRequest> incomplete;
-			while (!mPhysicsShapeRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+			while (!mPhysicsShapeRequests.empty() && canFetch())
 			{
 				mMutex->lock();
 				std::set<UUIDBasedRequest>::iterator iter = mPhysicsShapeRequests.begin();
@@ -1097,7 +1215,7 @@ void LLMeshRepoThread::run()
 				{
 					incomplete.insert(req);
 				}
-				else if (!fetchMeshPhysicsShape(req.mId))
+				else if (!fetchMeshPhysicsShape(req.mId, req.mUseCache))
 				{
 					if (req.canRetry())
 					{
@@ -1162,7 +1280,7 @@ void LLMeshRepoThread::lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32
 }
 
 
-void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
+void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod, F32 score)
 { //could be called from any thread
 	std::unique_lock<LLMutex> header_lock(*mHeaderMutex);
 	mesh_header_map::iterator iter = mMeshHeader.find(mesh_params.getSculptID());
@@ -1170,7 +1288,7 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 	{ //if we have the header, request LOD byte range
 		header_lock.unlock();
 
-		LODRequest req(mesh_params, lod);
+		LODRequest req(mesh_params, lod, score);
 		{
 			LLMutexLock lock(mMutex);
 			mLODReqQ.push(req);
@@ -1188,13 +1306,13 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 
 		if (pending != mPendingLOD.end())
 		{ //append this lod request to existing header request
-			pending->second.push_back(lod);
+			pending->second.emplace_back(mesh_params, lod, score);
 			llassert(pending->second.size() <= LLModel::NUM_LODS);
 		}
 		else
 		{ //if no header request is pending, fetch header
 			mHeaderReqQ.push(req);
-			mPendingLOD[mesh_params].push_back(lod);
+			mPendingLOD[mesh_params].emplace_back(mesh_params, lod, score);
 		}
 	}
 }
@@ -1319,7 +1437,7 @@ LLCore::HttpHandle LLMeshRepoThread::getByteRange(const std::string & url, int l
 }
 
 
-bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
+bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry, bool use_cache)
 {
 	
 	if (!mHeaderMutex)
@@ -1353,7 +1471,7 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 		{
 			//check VFS for mesh skin info
 			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
-			if (file.getSize() >= offset+size)
+			if (use_cache && file.getSize() >= offset+size)
 			{
 				U8* buffer = new(std::nothrow) U8[size];
 				if (!buffer)
@@ -1375,14 +1493,16 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 
 				if (!zero)
 				{ //attempt to parse
-					if (skinInfoReceived(mesh_id, buffer, size))
-					{						
-						delete[] buffer;
+					LLMeshBlock block(LLMeshBlock::SKIN_INFO, LLMeshBlock::getMeshParams(mesh_id), 0, buffer, size);
+					if (decodeBlock(block, LLQueuedThread::PRIORITY_HIGH))
+					{
 						return true;
 					}
 				}
-
-				delete[] buffer;
+				else
+				{
+					delete[] buffer;
+				}
 			}
 
 			//reading from VFS failed for whatever reason, fetch from sim
@@ -1434,7 +1554,7 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 	return ret;
 }
 
-bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
+bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id, bool use_cache)
 {
 	if (!mHeaderMutex)
 	{
@@ -1467,7 +1587,7 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 		{
 			//check VFS for mesh decomposition info
 			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
-			if (file.getSize() >= offset+size)
+			if (use_cache && file.getSize() >= offset+size)
 			{
 				U8* buffer = new(std::nothrow) U8[size];
 				if (!buffer)
@@ -1490,14 +1610,16 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 
 				if (!zero)
 				{ //attempt to parse
-					if (decompositionReceived(mesh_id, buffer, size))
+					LLMeshBlock block(LLMeshBlock::DECOMPOSITION, LLMeshBlock::getMeshParams(mesh_id), 0, buffer, size);
+					if (decodeBlock(block, LLQueuedThread::PRIORITY_LOW))
 					{
-						delete[] buffer;
 						return true;
 					}
 				}
-
-				delete[] buffer;
+				else
+				{
+					delete[] buffer;
+				}
 			}
 
 			//reading from VFS failed for whatever reason, fetch from sim
@@ -1534,7 +1656,7 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 	return ret;
 }
 
-bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
+bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id, bool use_cache)
 {
 	if (!mHeaderMutex)
 	{
@@ -1567,7 +1689,7 @@ bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
 		{
 			//check VFS for mesh physics shape info
 			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
-			if (file.getSize() >= offset+size)
+			if (use_cache && file.getSize() >= offset+size)
 			{
 				LLMeshRepository::sCacheBytesRead += size;
 				++LLMeshRepository::sCacheReads;
@@ -1589,14 +1711,16 @@ bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
 
 				if (!zero)
 				{ //attempt to parse
-					if (physicsShapeReceived(mesh_id, buffer, size))
+					LLMeshBlock block(LLMeshBlock::PHYSICS_SHAPE, LLMeshBlock::getMeshParams(mesh_id), 0, buffer, size);
+					if (decodeBlock(block, LLQueuedThread::PRIORITY_LOW))
 					{
-						delete[] buffer;
 						return true;
 					}
 				}
-
-				delete[] buffer;
+				else
+				{
+					delete[] buffer;
+				}
 			}
 
 			//reading from VFS failed for whatever reason, fetch from sim
@@ -1725,13 +1849,16 @@ bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool c
 }
 
 //return false if failed to get mesh lod.
-bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry)
+bool LLMeshRepoThread::fetchMeshLOD(const LODRequest& req)
 {
 	if (!mHeaderMutex)
 	{
 		return false;
 	}
 
+	const LLVolumeParams& mesh_params = req.mMeshParams;
+	const S32 lod = req.mLOD;
+	const bool can_retry = req.canRetry();
 	const LLUUID& mesh_id = mesh_params.getSculptID();
 
 	mHeaderMutex->lock();
@@ -1755,10 +1882,25 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 				
 		if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
 		{
+			//check the decoded cache, a hit skips decoding altogether
+			if (req.mUseCache && mDecodedCache.isEnabled())
+			{
+				LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+				if (mDecodedCache.load(volume, lod))
+				{
+					++LLMeshRepository::sDecodedCacheReads;
+					LoadedMesh mesh(volume, mesh_params, lod);
+					{
+						LLMutexLock lock(mMutex);
+						mLoadedQ.push(mesh);
+					}
+					return true;
+				}
+			}
 
 			//check VFS for mesh asset
 			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
-			if (file.getSize() >= offset+size)
+			if (req.mUseCache && file.getSize() >= offset+size)
 			{
 				U8* buffer = new(std::nothrow) U8[size];
 				if (!buffer)
@@ -1782,14 +1924,17 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 
 				if (!zero)
 				{ //attempt to parse
-					if (lodReceived(mesh_params, lod, buffer, size) == MESH_OK)
+					LLMeshBlock block(LLMeshBlock::LOD, mesh_params, lod, buffer, size);
+					block.mScore = req.mScore;
+					if (decodeBlock(block, LLMeshDecodeThread::getLODPriority(req.mScore)))
 					{
-						delete[] buffer;
 						return true;
 					}
 				}
-
-				delete[] buffer;
+				else
+				{
+					delete[] buffer;
+				}
 			}
 
 			//reading from VFS failed for whatever reason, fetch from sim
@@ -1799,7 +1944,7 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 			
 			if (!http_url.empty())
 			{
-                LLMeshHandlerBase::ptr_t handler = std::make_shared<LLMeshLODHandler>(mesh_params, lod, offset, size);
+                LLMeshHandlerBase::ptr_t handler = std::make_shared<LLMeshLODHandler>(mesh_params, lod, req.mScore, offset, size);
 				LLCore::HttpHandle handle = getByteRange(http_url, legacy_cap_version, offset, size, handler);
 				if (LLCORE_HTTP_HANDLE_INVALID == handle)
 				{
@@ -1854,14 +1999,15 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 
 		data_size = dsize;
 
-		boost::iostreams::stream<boost::iostreams::array_source> stream(result_ptr, data_size);
-
-		if (!LLSDSerialize::fromBinary(header, stream, data_size))
+		// Parsed in place, the header is followed by the LOD blocks
+		LLSDBinaryChunkParser parser(data_size);
+		if (parser.feed(result_ptr, data_size) != LLSDBinaryChunkParser::STATUS_DONE)
 		{
 			LL_WARNS(LOG_MESH) << "Mesh header parse error.  Not a valid mesh asset!  ID:  " << mesh_id
 							   << LL_ENDL;
 			return false;
 		}
+		header = std::move(parser.getResult());
 
 		if (!header.isMap())
 		{
@@ -1877,7 +2023,7 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 		// make sure there is at least one lod, function returns -1 and marks as 404 otherwise
 		else if (LLMeshRepository::getActualMeshLOD(header, 0) >= 0)
 		{
-			header_size += stream.tellg();
+			header_size += parser.getConsumed();
 		}
 	}
 	else
@@ -1902,9 +2048,8 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 		pending_lod_map::iterator iter = mPendingLOD.find(mesh_params);
 		if (iter != mPendingLOD.end())
 		{
-			for (int i : iter->second)
+			for (const LODRequest& req : iter->second)
             {
-				LODRequest req(mesh_params, i);
 				mLODReqQ.push(req);
 				LLMeshRepository::sLODProcessing++;
 			}
@@ -1929,6 +2074,9 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
 	{
 		if (volume->getNumFaces() > 0)
 		{
+			// While no other thread can see the volume yet
+			mDecodedCache.save(volume, lod);
+
 			LoadedMesh mesh(volume, mesh_params, lod);
 			{
 				LLMutexLock lock(mMutex);
@@ -2058,6 +2206,157 @@ bool LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32
 	return true;
 }
 
+bool LLMeshRepoThread::canFetch() const
+{
+	// Stop fetching while the decode thread is behind, the blocks would
+	// only pile up in memory
+	return mHttpRequestSet.size() < sRequestHighWater
+		&& !(mDecodeThread && mDecodeThread->isBacklogged());
+}
+
+bool LLMeshRepoThread::decodeBlock(LLMeshBlock& block, U32 priority)
+{
+	if (mDecodeThread && !mDecodeThread->isBacklogged() && mDecodeThread->decode(block, priority))
+	{
+		return true;
+	}
+
+	// Backlogged or no decode thread, decode it here. A cached block that
+	// fails is fetched from the sim by the caller.
+	return processBlock(block, false);
+}
+
+bool LLMeshRepoThread::processBlock(const LLMeshBlock& block, bool refetch)
+{
+	const LLUUID& mesh_id = block.getMeshID();
+	U8* data = block.mData.get();
+
+	bool success = false;
+	switch (block.mType)
+	{
+	case LLMeshBlock::LOD:
+		{
+			EMeshProcessingResult result = lodReceived(block.mMeshParams, block.mLOD, data, block.mSize);
+			success = (result == MESH_OK);
+			if (!success && !block.isFromCache())
+			{
+				LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mesh_id
+								   << ", Reason: " << result
+								   << " LOD: " << block.mLOD
+								   << " Data size: " << block.mSize
+								   << " Not retrying."
+								   << LL_ENDL;
+			}
+		}
+		break;
+	case LLMeshBlock::SKIN_INFO:
+		success = skinInfoReceived(mesh_id, data, block.mSize);
+		break;
+	case LLMeshBlock::DECOMPOSITION:
+		success = decompositionReceived(mesh_id, data, block.mSize);
+		break;
+	case LLMeshBlock::PHYSICS_SHAPE:
+		success = physicsShapeReceived(mesh_id, data, block.mSize);
+		break;
+	}
+
+	if (success)
+	{
+		if (!block.isFromCache())
+		{
+			// good fetch from sim, write to VFS for caching
+			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH, LLVFile::WRITE);
+
+			S32 offset = block.mCacheOffset;
+			S32 size = llmin(block.mSize, block.mCacheSize);
+
+			if (file.getSize() >= offset+size)
+			{
+				LLMeshRepository::sCacheBytesWritten += size;
+				++LLMeshRepository::sCacheWrites;
+				file.seek(offset);
+				file.write(data, size);
+			}
+		}
+		return true;
+	}
+
+	if (block.isFromCache())
+	{
+		if (refetch)
+		{
+			// Bad cached copy found off the repo thread, fetch it from the
+			// sim instead
+			LLMutexLock lock(mMutex);
+			switch (block.mType)
+			{
+			case LLMeshBlock::LOD:
+				{
+					LODRequest req(block.mMeshParams, block.mLOD, block.mScore);
+					req.mUseCache = false;
+					mLODReqQ.push(req);
+					++LLMeshRepository::sLODProcessing;
+				}
+				break;
+			case LLMeshBlock::SKIN_INFO:
+				{
+					UUIDBasedRequest req(mesh_id);
+					req.mUseCache = false;
+					mSkinReqQ.push(req);
+				}
+				break;
+			case LLMeshBlock::DECOMPOSITION:
+				{
+					UUIDBasedRequest req(mesh_id);
+					req.mUseCache = false;
+					mDecompositionRequests.insert(req);
+				}
+				break;
+			case LLMeshBlock::PHYSICS_SHAPE:
+				{
+					UUIDBasedRequest req(mesh_id);
+					req.mUseCache = false;
+					mPhysicsShapeRequests.insert(req);
+				}
+				break;
+			}
+		}
+		return false;
+	}
+
+	switch (block.mType)
+	{
+	case LLMeshBlock::LOD:
+		{
+			LLMutexLock lock(mMutex);
+			mUnavailableQ.push(LODRequest(block.mMeshParams, block.mLOD));
+		}
+		break;
+	case LLMeshBlock::SKIN_INFO:
+		{
+			LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mesh_id
+							   << ", Unknown reason.  Not retrying."
+							   << LL_ENDL;
+			LLMutexLock lock(mMutex);
+			mSkinUnavailableQ.emplace(mesh_id);
+		}
+		break;
+	case LLMeshBlock::DECOMPOSITION:
+		LL_WARNS(LOG_MESH) << "Error during mesh decomposition processing.  ID:  " << mesh_id
+						   << ", Unknown reason.  Not retrying."
+						   << LL_ENDL;
+		// *TODO:  Mark mesh unavailable on error
+		break;
+	case LLMeshBlock::PHYSICS_SHAPE:
+		LL_WARNS(LOG_MESH) << "Error during mesh physics shape processing.  ID:  " << mesh_id
+						   << ", Unknown reason.  Not retrying."
+						   << LL_ENDL;
+		// *TODO:  Mark mesh unavailable on error
+		break;
+	}
+	return false;
+}
+
 LLMeshUploadThread::LLMeshUploadThread(LLMeshUploadThread::instance_list& data, LLVector3& scale, bool upload_textures,
 									   bool upload_skin, bool upload_joints, bool lock_scale_if_joint_position,
                                        std::string upload_url, bool do_upload,
@@ -3122,6 +3421,7 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
 			// that requires a temporary allocation and data copy.
 			body_offset = mOffset - offset;
 			data = new(std::nothrow) U8[data_size - body_offset];
+			mData.reset(data);
 			if (data)
 			{
 				body->read(body_offset, (char *) data, data_size - body_offset);
@@ -3136,7 +3436,7 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
 
 		processData(body, body_offset, data, data_size - body_offset);
 
-		delete [] data;
+		mData.reset();
 	}
 
 	// Release handler
@@ -3303,34 +3603,10 @@ void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body
 	if ((!MESH_LOD_PROCESS_FAILED)
 		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		EMeshProcessingResult result = gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size);
-		if (result == MESH_OK)
-		{
-			// good fetch from sim, write to VFS for caching
-			LLVFile file(gVFS, mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLVFile::WRITE);
-
-			S32 offset = mOffset;
-			S32 size = mRequestedBytes;
-
-			if (file.getSize() >= offset+size)
-			{
-				file.seek(offset);
-				file.write(data, size);
-				LLMeshRepository::sCacheBytesWritten += size;
-				++LLMeshRepository::sCacheWrites;
-			}
-		}
-		else
-		{
-			LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mMeshParams.getSculptID()
-							   << ", Reason: " << result
-							   << " LOD: " << mLOD
-							   << " Data size: " << data_size
-							   << " Not retrying."
-							   << LL_ENDL;
-			LLMutexLock lock(gMeshRepo.mThread->mMutex);
-			gMeshRepo.mThread->mUnavailableQ.push(LLMeshRepoThread::LODRequest(mMeshParams, mLOD));
-		}
+		// Decoded, cached or marked unavailable on the decode thread
+		LLMeshBlock block(LLMeshBlock::LOD, mMeshParams, mLOD, takeData(), data_size, mOffset, mRequestedBytes);
+		block.mScore = mScore;
+		gMeshRepo.mThread->decodeBlock(block, LLMeshDecodeThread::getLODPriority(mScore));
 	}
 	else
 	{
@@ -3366,22 +3642,10 @@ void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * /* body */, S32 /*
 										U8 * data, S32 data_size)
 {
 	if ((!MESH_SKIN_INFO_PROCESS_FAILED)
-		&& ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-		&& gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size))
+		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		LLMeshBlock block(LLMeshBlock::SKIN_INFO, LLMeshBlock::getMeshParams(mMeshID), 0, takeData(), data_size, mOffset, mRequestedBytes);
+		gMeshRepo.mThread->decodeBlock(block, LLQueuedThread::PRIORITY_HIGH);
 	}
 	else
 	{
@@ -3415,22 +3679,10 @@ void LLMeshDecompositionHandler::processData(LLCore::BufferArray * /* body */, S
 											 U8 * data, S32 data_size)
 {
 	if ((!MESH_DECOMP_PROCESS_FAILED)
-		&& ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-		&& gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size))
+		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		LLMeshBlock block(LLMeshBlock::DECOMPOSITION, LLMeshBlock::getMeshParams(mMeshID), 0, takeData(), data_size, mOffset, mRequestedBytes);
+		gMeshRepo.mThread->decodeBlock(block, LLQueuedThread::PRIORITY_LOW);
 	}
 	else
 	{
@@ -3462,22 +3714,10 @@ void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * /* body */, S3
 											U8 * data, S32 data_size)
 {
 	if ((!MESH_PHYS_SHAPE_PROCESS_FAILED)
-		&& ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-		&& gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size))
+		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		LLMeshBlock block(LLMeshBlock::PHYSICS_SHAPE, LLMeshBlock::getMeshParams(mMeshID), 0, takeData(), data_size, mOffset, mRequestedBytes);
+		gMeshRepo.mThread->decodeBlock(block, LLQueuedThread::PRIORITY_LOW);
 	}
 	else
 	{
@@ -3518,6 +3758,11 @@ void LLMeshRepository::init()
 	mThread->start();
 }
 
+void LLMeshRepository::initDecodedCache(ELLPath location, U64 max_size, bool read_only)
+{
+	mThread->mDecodedCache.init(location, max_size, read_only);
+}
+
 void LLMeshRepository::shutdown()
 {
 	LL_INFOS(LOG_MESH) << "Shutting down mesh repository." << LL_ENDL;
@@ -3874,12 +4119,10 @@ void LLMeshRepository::notifyLoadedMeshes()
 		{
 			S32 push_count = LLMeshRepoThread::sRequestHighWater - active_count;
 
-			if (mPendingRequests.size() > push_count)
+			if (!mPendingRequests.empty())
 			{
-				// More requests than the high-water limit allows so
-				// sort and forward the most important.
-
-				//calculate "score" for pending requests
+				//calculate "score" for pending requests, it also orders
+				//their decoding on the decode thread
 
 				//create score map
 				absl::flat_hash_map<LLUUID, F32> score_map;
@@ -3907,8 +4150,12 @@ void LLMeshRepository::notifyLoadedMeshes()
                 {
                     request.mScore = score_map[request.mMeshParams.getSculptID()];
 				}
+			}
 
-				//sort by "score"
+			if (mPendingRequests.size() > push_count)
+			{
+				// More requests than the high-water limit allows so
+				// sort and forward the most important.
 				std::partial_sort(mPendingRequests.begin(), mPendingRequests.begin() + push_count,
 								  mPendingRequests.end(), LLMeshRepoThread::CompareScoreGreater());
 			}
@@ -3916,7 +4163,7 @@ void LLMeshRepository::notifyLoadedMeshes()
 			while (!mPendingRequests.empty() && push_count > 0)
 			{
 				LLMeshRepoThread::LODRequest& request = mPendingRequests.front();
-				mThread->loadMeshLOD(request.mMeshParams, request.mLOD);
+				mThread->loadMeshLOD(request.mMeshParams, request.mLOD, request.mScore);
 				mPendingRequests.erase(mPendingRequests.begin());
 				LLMeshRepository::sLODPending--;
 				push_count--;
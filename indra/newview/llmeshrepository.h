@@ -27,6 +27,8 @@
 #ifndef LL_MESH_REPOSITORY_H
 #define LL_MESH_REPOSITORY_H
 
+#include <atomic>
+#include <memory>
 #include <utility>
 #include "llassettype.h"
 #include "llmodel.h"
@@ -40,6 +42,8 @@
 #include "httpheaders.h"
 #include "httphandler.h"
 #include "llthread.h"
+#include "llmeshdecodedcache.h"
+#include "llqueuedthread.h"
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/node_hash_map.h>
@@ -54,6 +58,8 @@ class LLMutex;
 class LLCondition;
 class LLVFS;
 class LLMeshRepository;
+class LLMeshRepoThread;
+class LLQueuedThreadPool;
 
 typedef enum e_mesh_processing_result_enum
 {
@@ -197,6 +203,86 @@ private:
     LLFrameTimer mTimer;
 };
 
+// A block of a mesh asset, read from cache or downloaded, waiting to be
+// decoded.
+struct LLMeshBlock
+{
+	enum EType
+	{
+		LOD,
+		SKIN_INFO,
+		DECOMPOSITION,
+		PHYSICS_SHAPE
+	};
+
+	// Takes data. A downloaded block gives the byte range it fills in the
+	// cached asset.
+	LLMeshBlock(EType type, const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 size,
+				S32 cache_offset = -1, S32 cache_size = 0)
+		: mType(type), mMeshParams(mesh_params), mLOD(lod), mScore(0.f), mData(data), mSize(size),
+		  mCacheOffset(cache_offset), mCacheSize(cache_size)
+	{
+	}
+
+	// Parameters of the default mesh volume of mesh_id
+	static LLVolumeParams getMeshParams(const LLUUID& mesh_id);
+
+	const LLUUID& getMeshID() const { return mMeshParams.getSculptID(); }
+	bool isFromCache() const { return mCacheOffset < 0; }
+
+	EType mType;
+	LLVolumeParams mMeshParams;
+	S32 mLOD;
+	F32 mScore;			// LODs only, see LODRequest::mScore
+	std::unique_ptr<U8[]> mData;
+	S32 mSize;
+	S32 mCacheOffset;	// where the block goes in the cache once decoded, -1 if read from it
+	S32 mCacheSize;
+};
+
+// Decodes mesh blocks off the repo thread, on a pool of threads when given
+// one. Decoded blocks are delivered through the repo thread's queues the
+// same way they were when the repo thread decoded them itself.
+class LLMeshDecodeThread : public LLQueuedThread
+{
+public:
+	class DecodeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~DecodeRequest(); // use deleteRequest()
+
+	public:
+		DecodeRequest(handle_t handle, U32 priority, LLMeshDecodeThread* thread, LLMeshBlock&& block);
+
+		bool processRequest() override;
+
+	private:
+		friend class LLMeshDecodeThread;
+
+		LLMeshDecodeThread* mThread;
+		LLMeshBlock mBlock;
+	};
+
+	LLMeshDecodeThread(LLMeshRepoThread* repo, LLQueuedThreadPool* pool);
+
+	// Queues block, taking its data. Returns false, leaving block as it
+	// was, once shutting down.
+	bool decode(LLMeshBlock& block, U32 priority);
+
+	// True when the blocks waiting hold too much memory. Callers should
+	// decode on their own thread and hold off fetching more.
+	bool isBacklogged() const { return mPendingBytes >= MAX_PENDING_BYTES; }
+
+	// Decode priority of an LOD, bigger on screen first (see LODRequest::mScore)
+	static U32 getLODPriority(F32 score);
+
+private:
+	static constexpr S64 MAX_PENDING_BYTES = 32 * 1024 * 1024;
+
+	LLMeshRepoThread* mRepo;
+	std::atomic<S64> mPendingBytes;
+};
+
 class LLMeshRepoThread : public LLThread
 {
 public:
@@ -239,10 +325,11 @@ public:
 	public:
 		LLVolumeParams  mMeshParams;
 		S32 mLOD;
-		F32 mScore;
+		F32 mScore;		// radius over distance of the biggest object waiting for it
+		bool mUseCache;	// false once the cached copy failed to decode
 
-		LODRequest(const LLVolumeParams&  mesh_params, S32 lod)
-			: RequestStats(), mMeshParams(mesh_params), mLOD(lod), mScore(0.f)
+		LODRequest(const LLVolumeParams&  mesh_params, S32 lod, F32 score = 0.f)
+			: RequestStats(), mMeshParams(mesh_params), mLOD(lod), mScore(score), mUseCache(true)
 		{
 		}
 	};
@@ -259,9 +346,10 @@ public:
 	{
 	public:
 		LLUUID mId;
+		bool mUseCache;
 
 		UUIDBasedRequest(const LLUUID& id)
-			: RequestStats(), mId(id)
+			: RequestStats(), mId(id), mUseCache(true)
 		{
         }
 
@@ -316,7 +404,7 @@ public:
 	std::queue<LoadedMesh> mLoadedQ;
 
 	//map of pending header requests and currently desired LODs
-	typedef std::map<LLVolumeParams, std::vector<S32> > pending_lod_map;
+	typedef std::map<LLVolumeParams, std::vector<LODRequest> > pending_lod_map;
 	pending_lod_map mPendingLOD;
 
 	// llcorehttp library interface objects.
@@ -338,16 +426,20 @@ public:
 	int mLegacyGetMeshVersion;
 	std::string mGetMeshCapability;
 
+	LLQueuedThreadPool* mDecodePool;
+	LLMeshDecodeThread* mDecodeThread;
+	LLMeshDecodedCache mDecodedCache;
+
 	LLMeshRepoThread();
 	~LLMeshRepoThread();
 
 	void run() override;
 
 	void lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
-	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
+	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod, F32 score = 0.f);
 
 	bool fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry = true);
-	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true);
+	bool fetchMeshLOD(const LODRequest& req);
 	bool headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
 	EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
 	bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
@@ -355,6 +447,18 @@ public:
 	bool physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	LLSD& getMeshHeader(const LLUUID& mesh_id);
 
+	// Decodes block on the decode thread, or right here when it is
+	// backlogged. Takes the block's data. Returns false if decoding here
+	// failed, a cached block is then up to the caller to fetch from the sim.
+	// Threads:  repo
+	bool decodeBlock(LLMeshBlock& block, U32 priority);
+
+	// Decodes block and caches it when it was downloaded. A downloaded block
+	// that fails is marked unavailable, a cached one is fetched again from
+	// the sim if refetch is set.
+	// Threads:  repo, decode
+	bool processBlock(const LLMeshBlock& block, bool refetch);
+
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	
@@ -364,15 +468,15 @@ public:
 
 	//send request for skin info, returns true if header info exists 
 	//  (should hold onto mesh_id and try again later if header info does not exist)
-	bool fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry = true);
+	bool fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry = true, bool use_cache = true);
 
 	//send request for decomposition, returns true if header info exists 
 	//  (should hold onto mesh_id and try again later if header info does not exist)
-	bool fetchMeshDecomposition(const LLUUID& mesh_id);
+	bool fetchMeshDecomposition(const LLUUID& mesh_id, bool use_cache = true);
 
 	//send request for PhysicsShape, returns true if header info exists 
 	//  (should hold onto mesh_id and try again later if header info does not exist)
-	bool fetchMeshPhysicsShape(const LLUUID& mesh_id);
+	bool fetchMeshPhysicsShape(const LLUUID& mesh_id, bool use_cache = true);
 
 	static void incActiveLODRequests();
 	static void decActiveLODRequests();
@@ -389,6 +493,9 @@ public:
 	void constructUrl(LLUUID mesh_id, std::string * url, int * legacy_version);
 
 private:
+	// Room for another fetch, in flight requests and undecoded data
+	bool canFetch() const;
+
 	// Issue a GET request to a URL with 'Range' header using
 	// the correct policy class and other attributes.  If an invalid
 	// handle is returned, the request failed and caller must retry
@@ -566,6 +673,7 @@ public:
 	static U32 sCacheBytesWritten;
 	static U32 sCacheReads;						
 	static U32 sCacheWrites;
+	static U32 sDecodedCacheReads;				// LODs loaded already decoded
 	static U32 sMaxLockHoldoffs;				// Maximum sequential locking failures
 	
 	static LLDeadmanTimer sQuiescentTimer;		// Time-to-complete-mesh-downloads after significant events
@@ -582,6 +690,9 @@ public:
 
 	void init();
 	void shutdown();
+
+	// Sets up the decoded LOD cache once the cache directory is known.
+	void initDecodedCache(ELLPath location, U64 max_size, bool read_only);
 	S32 update();
 
 	void unregisterMesh(LLVOVolume* volume);
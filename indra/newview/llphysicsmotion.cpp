@@ -338,7 +338,7 @@ BOOL LLPhysicsMotionController::onUpdate(F32 time, U8* joint_mask)
         }
                 
         if (update_visuals)
-                mCharacter->updateVisualParams();
+                mCharacter->requestUpdateVisualParams();
         
         return TRUE;
 }
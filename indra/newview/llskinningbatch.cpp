@@ -0,0 +1,196 @@
+/**
+ * @file llskinningbatch.cpp
+ * @brief Software skinning of rigged faces, in batches over several threads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llskinningbatch.h"
+
+#include "llmodel.h"
+#include "llvolume.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	const U32 VERTICES_PER_RUN = 16384;	// fewer are not worth a thread
+}
+
+LLSkinningBatch::LLSkinningBatch()
+:	mVertexCount(0)
+{
+}
+
+U32 LLSkinningBatch::addPalette(const LLMeshSkinInfo* skin, const LLVOAvatar* avatar, const LLMatrix4a* joints, U32 count)
+{
+	Palette palette;
+	palette.mFirst = (U32)mMatrices.size();
+	palette.mCount = count;
+	mMatrices.resize(mMatrices.size() + count);
+	for (U32 i = 0; i < count; ++i)
+	{
+		// Joint times bind shape, so vertices take one transform
+		mMatrices[palette.mFirst + i].setMul(joints[i], skin->mBindShapeMatrix);
+	}
+	mPalettes.push_back(palette);
+	const U32 index = (U32)mPalettes.size() - 1;
+	mPaletteIndex[std::make_pair(skin, avatar)] = index;
+	return index;
+}
+
+S32 LLSkinningBatch::findPalette(const LLMeshSkinInfo* skin, const LLVOAvatar* avatar) const
+{
+	auto found = mPaletteIndex.find(std::make_pair(skin, avatar));
+	return found != mPaletteIndex.end() ? (S32)found->second : -1;
+}
+
+void LLSkinningBatch::addFace(const LLVolumeFace& face, U32 palette, LLVector4a* positions, LLVector4a* normals)
+{
+	if (!face.mWeights || face.mNumVertices <= 0 || !mPalettes[palette].mCount
+		|| !mDestinations.insert(positions).second)
+	{
+		return;
+	}
+
+	Face entry;
+	entry.mFace = &face;
+	entry.mPalette = palette;
+	entry.mFirstVertex = mVertexCount;
+	entry.mPositions = positions;
+	entry.mNormals = face.mNormals ? normals : nullptr;
+	mFaces.push_back(entry);
+	mVertexCount += face.mNumVertices;
+}
+
+void LLSkinningBatch::skin(U32 runs)
+{
+	if (mFaces.empty())
+	{
+		return;
+	}
+	runs = llclamp(runs, 1U, mVertexCount);
+
+	// Each run takes an equal share of the vertices of all faces laid end
+	// to end, so a big face is split between runs.
+	auto skin_run = [this, runs](U32 run)
+	{
+		const U32 first = (U32)((U64)mVertexCount * run / runs);
+		const U32 end = (U32)((U64)mVertexCount * (run + 1) / runs);
+		auto face = std::upper_bound(mFaces.begin(), mFaces.end(), first,
+			[](U32 vertex, const Face& rhs) { return vertex < rhs.mFirstVertex; }) - 1;
+		for (U32 vertex = first; vertex < end; ++face)
+		{
+			const U32 face_end = llmin(face->mFirstVertex + face->mFace->mNumVertices, end);
+			const Palette& palette = mPalettes[face->mPalette];
+			skinVertices(&mMatrices[palette.mFirst], palette.mCount, *face->mFace,
+						 vertex - face->mFirstVertex, face_end - vertex,
+						 face->mPositions, face->mNormals);
+			vertex = face_end;
+		}
+	};
+
+	if (runs > 1 && !mThreads)
+	{
+		mThreads = std::make_unique<LLThreadTeam>();
+	}
+	if (mThreads)
+	{
+		mThreads->run(runs, skin_run);
+	}
+	else
+	{
+		skin_run(0);
+	}
+}
+
+U32 LLSkinningBatch::getDefaultRuns() const
+{
+	const U32 cores = llmax(std::thread::hardware_concurrency(), 1U);
+	return llclamp(mVertexCount / VERTICES_PER_RUN, 1U, cores);
+}
+
+void LLSkinningBatch::clear()
+{
+	mMatrices.clear();
+	mPalettes.clear();
+	mPaletteIndex.clear();
+	mFaces.clear();
+	mDestinations.clear();
+	mVertexCount = 0;
+}
+
+// static
+void LLSkinningBatch::skinVertices(const LLMatrix4a* palette, U32 palette_size, const LLVolumeFace& face,
+								   U32 first, U32 count, LLVector4a* positions, LLVector4a* normals)
+{
+	const LLVector4a* weights = face.mWeights;
+	const LLIVector4a max_joint((S16)(palette_size - 1));
+
+	LL_ALIGN_16(S32 joints[4]);
+	LL_ALIGN_16(F32 amounts[4]);
+
+	const U32 end = first + count;
+	for (U32 i = first; i < end; ++i)
+	{
+		// Joint indices are the integer parts of the weights
+		LLIVector4a joint;
+		joint.setFloatTrunc(weights[i]);
+		LLVector4a weight;
+		weight.setSub(weights[i], joint);
+		joint.min16(max_joint);
+		joint.max16(LLIVector4a::getZero());
+		joint.store128a(joints);
+
+		// Summed as getPerVertexSkinMatrix() does, for the same result
+		LLVector4a scale;
+		scale.setMoveHighLow(weight);
+		scale.add(weight);
+		scale.addFirst(scale.getVectorAt<1>());
+		scale.splat<0>(scale);
+		weight.div(scale);
+		weight.store4a(amounts);
+
+		LLMatrix4a final_mat;
+		final_mat.setMul(palette[joints[0]], weight.getVectorAt<0>());
+		for (U32 k = 1; k < 4; ++k)
+		{
+			// Most vertices have fewer than four influences
+			if (amounts[k] != 0.f)
+			{
+				final_mat.setMulAdd(palette[joints[k]], LLVector4a(amounts[k]));
+			}
+		}
+
+		final_mat.affineTransform(face.mPositions[i], positions[i]);
+
+		if (normals)
+		{
+			LLVector4a dst;
+			final_mat.rotate(face.mNormals[i], dst);
+			dst.normalize3fast();
+			normals[i] = dst;
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/**
+ * @file llskinningbatch.h
+ * @brief Software skinning of rigged faces, in batches over several threads
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNINGBATCH_H
+#define LL_LLSKINNINGBATCH_H
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "llthreadteam.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+class LLMeshSkinInfo;
+class LLVOAvatar;
+class LLVolumeFace;
+
+// Collects the rigged faces to skin on the CPU, of every avatar, then
+// skins them all at once. Faces an avatar wears with the same skin share
+// its matrix palette, which has the bind shape matrix folded in so each
+// vertex takes a single transform, and joints a vertex gives no weight are
+// skipped. The vertices of all faces are split evenly between threads, each
+// writing straight to the destination of the faces it has a share of. The
+// threads are started the first time they are needed and kept.
+class LLSkinningBatch
+{
+public:
+	LLSkinningBatch();
+
+	// Adds the palette of skin as worn by avatar, joint matrices made by
+	// LLSkinningUtil::initSkinningMatrixPalette(). Returns its index.
+	U32 addPalette(const LLMeshSkinInfo* skin, const LLVOAvatar* avatar, const LLMatrix4a* joints, U32 count);
+	// The palette added for skin and avatar since the last clear(), or -1
+	S32 findPalette(const LLMeshSkinInfo* skin, const LLVOAvatar* avatar) const;
+
+	// Queues the vertices of face for skinning with a palette. positions
+	// and normals, which may be null, receive mNumVertices entries each and
+	// must stay valid until skin() returns. positions already queued since
+	// the last clear() are not queued again.
+	void addFace(const LLVolumeFace& face, U32 palette, LLVector4a* positions, LLVector4a* normals);
+
+	// Skins every face added over runs threads, the calling thread taking
+	// one of them. Returns once all are done.
+	void skin(U32 runs);
+	// A run count for skin() suited to the vertex count and cores.
+	U32 getDefaultRuns() const;
+
+	void clear();
+
+	bool empty() const						{ return mFaces.empty(); }
+	U32 getVertexCount() const				{ return mVertexCount; }
+
+	// Skins count vertices of face from first on. Joint indices are clamped
+	// to the palette, weights are normalized as getPerVertexSkinMatrix()
+	// does.
+	static void skinVertices(const LLMatrix4a* palette, U32 palette_size, const LLVolumeFace& face,
+							 U32 first, U32 count, LLVector4a* positions, LLVector4a* normals);
+
+private:
+	struct Palette
+	{
+		U32 mFirst;		// into mMatrices
+		U32 mCount;
+	};
+
+	struct Face
+	{
+		const LLVolumeFace* mFace;
+		U32 mPalette;
+		U32 mFirstVertex;	// of the face, counting the faces before it
+		LLVector4a* mPositions;
+		LLVector4a* mNormals;
+	};
+
+	std::vector<LLMatrix4a> mMatrices;
+	std::vector<Palette> mPalettes;
+	absl::flat_hash_map<std::pair<const LLMeshSkinInfo*, const LLVOAvatar*>, U32> mPaletteIndex;
+	std::vector<Face> mFaces;
+	absl::flat_hash_set<const LLVector4a*> mDestinations;
+	U32 mVertexCount;
+
+	std::unique_ptr<LLThreadTeam> mThreads;
+};
+
+#endif // LL_LLSKINNINGBATCH_H
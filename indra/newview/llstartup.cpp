@@ -609,6 +609,11 @@ bool idle_startup()
 				msg->mPacketRing.setUseOutThrottle(TRUE);
 				msg->mPacketRing.setOutBandwidth(outBandwidth);
 			}
+
+			if (gSavedSettings.getBOOL("MessageDecodeThread"))
+			{
+				msg->startDecodeThread();
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
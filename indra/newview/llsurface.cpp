@@ -737,13 +737,12 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 
 	LLPatchHeader  ph;
 	S32 j, i;
-	S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 	LLSurfacePatch *patchp;
 
-	init_patch_decompressor(gopp->patch_size);
-	gopp->stride = mGridsPerEdge;
-	set_group_of_patch_header(gopp);
-
+	// The bitstream has to be read in order, so read every patch of the
+	// packet first and then run their inverse DCTs together.
+	mPatchDecodes.clear();
+	mDecodedPatches.clear();
 	while (true)
 	{
 		decode_patch_header(bitpack, &ph, b_large_patch);
@@ -774,15 +773,33 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 				<< " quant_wbits " << (S32)ph.quant_wbits
 				<< " patchids " << (S32)ph.patchids
 				<< LL_ENDL;
-			return;
+			// The patches before this one are still good
+			break;
 		}
 
 		patchp = &mPatchList[j*mPatchesPerEdge + i];
 
+		// A patch sent twice in a packet ends up with the last one
+		size_t index = std::find(mDecodedPatches.begin(), mDecodedPatches.end(), patchp) - mDecodedPatches.begin();
+		if (index == mDecodedPatches.size())
+		{
+			mDecodedPatches.push_back(patchp);
+			mPatchDecodes.emplace_back();
+		}
+
+		LLPatchDecode& decode = mPatchDecodes[index];
+		decode.patch = patchp->getDataZ();
+		decode.size = gopp->patch_size;
+		decode.stride = mGridsPerEdge;
+		decode.header = ph;
+		decode_patch(bitpack, decode.cpatch);
+	}
 
-		decode_patch(bitpack, patch);
-		decompress_patch(patchp->getDataZ(), patch, &ph);
+	const S32 count = (S32)mPatchDecodes.size();
+	decompress_patches(mPatchDecodes.data(), count, get_patch_decompress_runs(count));
 
+	for (LLSurfacePatch* patchp : mDecodedPatches)
+	{
 		// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
 		patchp->updateNorthEdge();
 		patchp->updateEastEdge();
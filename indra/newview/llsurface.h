@@ -62,6 +62,7 @@ class LLViewerRegion;
 class LLSurfacePatch;
 class LLBitPack;
 class LLGroupHeader;
+class LLPatchDecode;
 
 class LLSurface 
 {
@@ -197,6 +198,10 @@ protected:
 
 	std::set<LLSurfacePatch *> mDirtyPatchList;
 
+	// Patches read by decompressDCTPatch(), kept to reuse their memory
+	std::vector<LLPatchDecode> mPatchDecodes;
+	std::vector<LLSurfacePatch *> mDecodedPatches;
+
 
 	// The textures should never be directly initialized - use the setter methods!
 	LLPointer<LLViewerTexture> mSTexturep;		// Texture for surface
@@ -738,10 +738,16 @@ BOOL LLSurfacePatch::updateTexture()
 				}
 			}
 			
-			if (comp->generateComposition())
+			F32 tex_patch_size = meters_per_grid*grids_per_patch_edge;
+			if (comp->generateComposition()
+				&& comp->generateTexture((F32)origin_region[VX], (F32)origin_region[VY],
+										 tex_patch_size, tex_patch_size))
 			{
 				if (mVObjp)
 				{
+					// The tile is made, updateGL() uploads it. Dirtied again
+					// meanwhile, the next tile is made after this one.
+					mSTexUpdate = FALSE;
 					mVObjp->dirtyGeom();
 					gPipeline.markGLRebuild(mVObjp);
 					return TRUE;
@@ -768,15 +774,19 @@ void LLSurfacePatch::updateGL()
 	
 	updateCompositionStats();
 	F32 tex_patch_size = meters_per_grid*grids_per_patch_edge;
-	if (comp->generateTexture((F32)origin_region[VX], (F32)origin_region[VY],
-							  tex_patch_size, tex_patch_size))
+	if (comp->uploadTexture((F32)origin_region[VX], (F32)origin_region[VY],
+							tex_patch_size, tex_patch_size))
 	{
-		mSTexUpdate = FALSE;
-
 		// Also generate the water texture
 		mSurfacep->generateWaterTexture((F32)origin_region.mdV[VX], (F32)origin_region.mdV[VY],
 										tex_patch_size, tex_patch_size);
 	}
+	else if (!mSTexUpdate)
+	{
+		// The tile went stale before it was uploaded, make another
+		mSTexUpdate = TRUE;
+		mSurfacep->dirtySurfacePatch(this);
+	}
 }
 
 void LLSurfacePatch::dirtyZ()
@@ -51,7 +51,7 @@
 
 // Cache organization:
 // cache/texture.entries
-//  Unordered array of Entry structs
+//  Memory mapped LLTextureCacheIndex: Entry slots, hash table by id and LRU links
 // cache/texture.cache
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
 // cache/textures/[0-F]/UUID.texture
@@ -60,7 +60,6 @@
 //note: there is no good to define 1024 for TEXTURE_CACHE_ENTRY_SIZE while FIRST_PACKET_SIZE is 600 on sim side.
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE;//1024;
 const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by when it exceeds its limit
-const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
 const S32 TEXTURE_FAST_CACHE_ENTRY_OVERHEAD = sizeof(S32) * 4; //w, h, c, level
 const S32 TEXTURE_FAST_CACHE_ENTRY_SIZE = 16 * 16 * 4 + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
 const F32 TEXTURE_LAZY_PURGE_TIME_LIMIT = .004f; // 4ms. Would be better to autoadjust, but there is a major cache rework in progress.
@@ -840,14 +839,12 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mHeaderMutex(),
 	  mListMutex(),
 	  mFastCacheMutex(),
-	  mHeaderAPRFile(NULL),
 	  mFastCachePoolp(NULL), //do not allow to change the texture cache until setReadOnly() is called.
 	  mPrioritizeWriteListEmpty(true),
 	  mCompletedListEmpty(true),
 	  mReadOnly(TRUE),
 	  mFastCachep(NULL),
 	  mFastCachePadBuffer(NULL),
-	  mTexturesSizeTotal(0),
 	  mDoPurge(false)
 {
     mHeaderAPRFilePoolp = new LLVolatileAPRPool("Texture Cache Header"); // is_local = true, because this pool is for headers, headers are under own mutex
@@ -856,7 +853,10 @@ LLTextureCache::LLTextureCache(bool threaded)
 LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList() ;
-	writeUpdatedEntries() ;
+	{
+		LLMutexLock lock(&mHeaderMutex);
+		mIndex.close(); // marks the index clean for the next session
+	}
 	delete mFastCachep;
 	delete mFastCachePoolp;
 	delete mHeaderAPRFilePoolp;
@@ -944,9 +944,9 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
 	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
+	S32 idx = mIndex.find(id);
 	
-	return (iter != mHeaderIDMap.end()) ;
+	return (idx >= 0 && mIndex.getEntry(idx)->mImageSize > 0) ;
 }
 
 //debug
@@ -991,7 +991,6 @@ BOOL LLTextureCache::isInLocal(const LLUUID& id)
 //////////////////////////////////////////////////////////////////////////////
 
 //static
-F32 LLTextureCache::sHeaderCacheVersion = 1.71f;
 U32 LLTextureCache::sCacheMaxEntries = 1024 * 1024; //~1 million textures.
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 std::string LLTextureCache::sHeaderCacheEncoderVersion = LLImageJ2C::getEngineInfo();
@@ -1024,7 +1023,6 @@ void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
 	if (!mReadOnly)
 	{
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
 
 		//remove the legacy cache if exists
 		std::string texture_dir = mTexturesDirName ;
@@ -1109,229 +1107,63 @@ U64 LLTextureCache::initCache(ELLPath location, U64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
-{
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, mHeaderAPRFilePoolp);
-	if(offset > 0)
-	{
-		mHeaderAPRFile->seek(APR_SET, offset);
-	}
-	return mHeaderAPRFile;
-}
-
-void LLTextureCache::closeHeaderEntriesFile()
-{
-	if(!mHeaderAPRFile)
-	{
-		return ;
-	}
-
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
-}
-
-void LLTextureCache::readEntriesHeader()
-{
-	// mHeaderEntriesInfo initializes to default values so safe not to read it
-	llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName, mHeaderAPRFilePoolp))
-	{
-		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						  mHeaderAPRFilePoolp);
-	}
-	else //create an empty entries header.
-	{
-		setEntriesHeader();
-		writeEntriesHeader() ;
-	}
-}
-
-void LLTextureCache::setEntriesHeader()
-{
-	if (sHeaderEncoderStringSize < sHeaderCacheEncoderVersion.size() + 1)
-	{
-		// For simplicity we use predefined size of header, so if version string
-		// doesn't fit, either getEngineInfo() returned malformed string or 
-		// sHeaderEncoderStringSize need to be increased.
-		// Also take into accout that c_str() returns additional null character
-		LL_ERRS() << "Version string doesn't fit in header" << LL_ENDL;
-	}
-
-	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
-	mHeaderEntriesInfo.mAdressSize = sHeaderCacheAddressSize;
-	strcpy(mHeaderEntriesInfo.mEncoderVersion, sHeaderCacheEncoderVersion.c_str());
-	mHeaderEntriesInfo.mEntries = 0;
-}
-
-void LLTextureCache::writeEntriesHeader()
-{
-	llassert_always(mHeaderAPRFile == NULL);
-	if (!mReadOnly)
-	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						   mHeaderAPRFilePoolp);
-	}
-}
-
 //mHeaderMutex is locked before calling this.
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
-
+	S32 idx = mIndex.find(id);
 	if (idx < 0)
 	{
 		if (create && !mReadOnly)
 		{
-			if (mHeaderEntriesInfo.mEntries < sCacheMaxEntries)
-			{
-				// Add an entry to the end of the list
-				idx = mHeaderEntriesInfo.mEntries++;
-
-			}
-			else if (!mFreeList.empty())
-			{
-				idx = *(mFreeList.begin());
-				mFreeList.erase(mFreeList.begin());
-			}
-			else
+			idx = mIndex.insert(id, time(NULL));
+			if (idx < 0)
 			{
-				// Look for a still valid entry in the LRU
-				for (std::set<LLUUID>::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
+				// Every slot is in use, recycle the least recently used texture.
+				// Skip entries that are still being written.
+				S32 oldest = mIndex.getOldest();
+				while (oldest >= 0 && mIndex.getEntry(oldest)->mImageSize < 0)
 				{
-					std::set<LLUUID>::iterator curiter2 = iter2++;
-					LLUUID oldid = *curiter2;
-					// Erase entry from LRU regardless
-					mLRU.erase(curiter2);
-					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
-					{
-						idx = iter3->second;
-						removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
-						break;
-					}
+					oldest = mIndex.getNewer(oldest);
+				}
+				if (oldest >= 0)
+				{
+					Entry old_entry = *mIndex.getEntry(oldest);
+					std::string tex_filename = getTextureFileName(old_entry.mID);
+					removeEntry(oldest, old_entry, tex_filename);
+					idx = mIndex.insert(id, time(NULL));
 				}
-				// if (idx < 0) at this point, we will rebuild the LRU 
-				//  and retry if called from setHeaderCacheEntry(),
-				//  otherwise this shouldn't happen and will trigger an error
 			}
 			if (idx >= 0)
 			{
-				entry.mID = id ;
-				entry.mImageSize = -1 ; //mark it is a brand-new entry.					
-				entry.mBodySize = 0 ;
+				entry = *mIndex.getEntry(idx); // mImageSize is -1, it is a brand-new entry.
 			}
 		}
 	}
 	else
 	{
-		// Remove this entry from the LRU if it exists
-		mLRU.erase(id);
-		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-		if(iter != mUpdatedEntryMap.end())
-		{
-			entry = iter->second ;
-		}
-		else
+		entry = *mIndex.getEntry(idx);
+		if (entry.mImageSize < 0)
 		{
-			readEntryFromHeaderImmediately(idx, entry) ;
+			// Another worker is still creating this entry, there is nothing to read yet
+			if (!create)
+			{
+				idx = -1;
+			}
 		}
-		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
+		else if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
 			LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
 
 			//erase this entry and the cached texture from the cache.
 			std::string tex_filename = getTextureFileName(id);
 			removeEntry(idx, entry, tex_filename) ;
-			mUpdatedEntryMap.erase(idx) ;
 			idx = -1 ;
 		}
 	}
 	return idx;
 }
 
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
-{	
-	LLAPRFile* aprfile ;
-	S32 bytes_written ;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			idx = -1 ;//mark the idx invalid.
-			return ;
-		}
-
-		mHeaderAPRFile->seek(APR_SET, offset);
-	}
-	else
-	{
-		aprfile = openHeaderEntriesFile(false, offset);
-	}
-	bytes_written = aprfile->write((void*)&entry, sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
-	{
-		clearCorruptedCache() ; //clear the cache.
-		idx = -1 ;//mark the idx invalid.
-
-		return ;
-	}
-
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx) ;
-}
-
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
-{
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-	S32 bytes_read = aprfile->read((void*)&entry, sizeof(Entry));
-	closeHeaderEntriesFile();
-
-	if(bytes_read != sizeof(Entry))
-	{
-		clearCorruptedCache() ; //clear the cache.
-		idx = -1 ;//mark the idx invalid.
-	}
-}
-
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
-void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
-{
-	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
-
-	if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
-	{
-		return ; //there are enough empty entry index space, no need to stamp time.
-	}
-
-	if (idx >= 0)
-	{
-		if (!mReadOnly)
-		{
-			entry.mTime = time(NULL);			
-			mUpdatedEntryMap[idx] = entry ;
-		}
-	}
-}
-
-//update an existing entry, write to header file immediately.
+//update an existing entry, the index is mapped so this reaches the header file directly.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
 	S32 new_body_size = llmax(0, new_data_size - TEXTURE_CACHE_ENTRY_SIZE) ;
@@ -1346,32 +1178,22 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 
 		lockHeaders() ;
 
-		bool update_header = false ;
-		if(entry.mImageSize < 0) //is a brand-new entry
-		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = new_body_size ;
-			mTexturesSizeTotal += new_body_size ;
-			
-			// Update Header
-			update_header = true ;
-		}				
-		else if (entry.mBodySize != new_body_size)
+		const Entry* current = mIndex.getEntry(idx);
+		if (current && current->mID == entry.mID)
 		{
-			//already in mHeaderIDMap.
-			mTexturesSizeMap[entry.mID] = new_body_size ;
-			mTexturesSizeTotal -= entry.mBodySize ;
-			mTexturesSizeTotal += new_body_size ;
+			mIndex.setSizes(idx, new_image_size, new_body_size);
+			mIndex.touch(idx, time(NULL));
+			entry = *current;
+
+			if (mIndex.getBodyBytes() > sCacheMaxTexturesSize)
+			{
+				purge = true;
+			}
 		}
-		entry.mTime = time(NULL);
-		entry.mImageSize = new_image_size ; 
-		entry.mBodySize = new_body_size ;
-		
-		writeEntryToHeaderImmediately(idx, entry, update_header) ;
-	
-		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
+		else
 		{
-			purge = true;
+			// The slot was recycled for another texture while we were working
+			idx = -1;
 		}
 		
 		unlockHeaders() ;
@@ -1385,241 +1207,47 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 	return false ;
 }
 
-U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
-{
-	U32 num_entries = mHeaderEntriesInfo.mEntries;
-
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
-
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
-	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
-	}
-	else //update the header file first.
-	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		if(!aprfile)
-		{
-			return 0;
-		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
-	}
-	for (U32 idx=0; idx<num_entries; idx++)
-	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
-		{
-			LL_WARNS() << "Corrupted header entries, failed at " << idx << " / " << num_entries << LL_ENDL;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
-		}
-		entries.push_back(entry);
-// 		LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
-		if(entry.mImageSize > entry.mBodySize)
-		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = entry.mBodySize;
-			mTexturesSizeTotal += entry.mBodySize;
-		}
-		else
-		{
-			mFreeList.insert(idx);
-		}
-	}
-	closeHeaderEntriesFile();
-	return num_entries;
-}
-
-void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
-{
-	size_t num_entries = entries.size();
-	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
-	
-	if (!mReadOnly)
-	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		U64 write_size = U64(sizeof(Entry)) * num_entries;
-		U64 bytes_written = aprfile->write((void*) (entries.data()), write_size);
-		if (bytes_written != write_size)
-		{
-			clearCorruptedCache(); //clear the cache.
-			return;
-		}
-		closeHeaderEntriesFile();
-	}
-}
-
 void LLTextureCache::writeUpdatedEntries()
 {
-	lockHeaders() ;
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
+	LLMutexLock lock(&mHeaderMutex);
+	if (!mReadOnly)
 	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		closeHeaderEntriesFile();
+		mIndex.flush();
 	}
-	unlockHeaders() ;
 }
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
-{
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
-	{
-		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			return ;
-		}
-		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry) ;
-		S32 prev_idx = -1 ;
-		S32 delta_idx ;
-		for (auto& iter : mUpdatedEntryMap)
-        {
-			delta_idx = iter.first - prev_idx - 1;
-			prev_idx = iter.first ;
-			if(delta_idx)
-			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter.second), entry_size);
-			if(bytes_written != entry_size)
-			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
-			}
-		}
-		mUpdatedEntryMap.clear() ;
-	}
-}
 //----------------------------------------------------------------------------
 
-// Called from either the main thread or the worker thread
+// Called from the main thread
 void LLTextureCache::readHeaderCache()
 {
-	mHeaderMutex.lock();
-
-	mLRU.clear(); // always clear the LRU
+	LLMutexLock lock(&mHeaderMutex);
 
-	readEntriesHeader();
-	
-	if (mHeaderEntriesInfo.mVersion != sHeaderCacheVersion
-		|| mHeaderEntriesInfo.mAdressSize != sHeaderCacheAddressSize
-		|| strcmp(mHeaderEntriesInfo.mEncoderVersion, sHeaderCacheEncoderVersion.c_str()) != 0)
+	std::vector<LLUUID> dropped;
+	switch (mIndex.open(mHeaderEntriesFileName, sCacheMaxEntries, sHeaderCacheAddressSize,
+						sHeaderCacheEncoderVersion, mReadOnly, &dropped))
 	{
-		if (!mReadOnly)
-		{
-			LL_INFOS() << "Texture Cache version mismatch, Purging." << LL_ENDL;
-			purgeAllTextures(false);
-		}
+	case LLTextureCacheIndex::OPEN_CREATED:
+		// Missing, damaged or written by another version, nothing else in the cache can be trusted
+		LL_INFOS() << "Texture Cache version mismatch, Purging." << LL_ENDL;
+		purgeAllTextures(false);
+		break;
+	case LLTextureCacheIndex::OPEN_FAILED:
+		LL_WARNS("TextureCache") << "Unable to open texture cache index " << mHeaderEntriesFileName << LL_ENDL;
+		break;
+	default:
+		break;
 	}
-	else
+
+	if (!dropped.empty())
 	{
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
-		if (num_entries)
+		// Special case: cache size was reduced, entries past the new end lost their slot
+		LL_INFOS() << "Texture Cache Entries: " << mIndex.getNumEntries() << " Max: " << sCacheMaxEntries << " Purging: " << dropped.size() << LL_ENDL;
+		for (const LLUUID& id : dropped)
 		{
-			U32 empty_entries = 0;
-			typedef std::pair<U32, S32> lru_data_t;
-			std::set<lru_data_t> lru;
-			std::set<U32> purge_list;
-			for (U32 i=0; i<num_entries; i++)
-			{
-				Entry& entry = entries[i];
-				if (entry.mImageSize <= 0)
-				{
-					// This will be in the Free List, don't put it in the LRU
-					++empty_entries;
-				}
-				else
-				{
-					lru.emplace(entry.mTime, i);
-					if (entry.mBodySize > 0)
-					{
-						if (entry.mBodySize > entry.mImageSize)
-						{
-							// Shouldn't happen, failsafe only
-							LL_WARNS() << "Bad entry: " << i << ": " << entry.mID << ": BodySize: " << entry.mBodySize << LL_ENDL;
-							purge_list.insert(i);
-						}
-					}
-				}
-			}
-			if (num_entries - empty_entries > sCacheMaxEntries)
-			{
-				// Special case: cache size was reduced, need to remove entries
-				// Note: After we prune entries, we will call this again and create the LRU
-				U32 entries_to_purge = (num_entries - empty_entries) - sCacheMaxEntries;
-				LL_INFOS() << "Texture Cache Entries: " << num_entries << " Max: " << sCacheMaxEntries << " Empty: " << empty_entries << " Purging: " << entries_to_purge << LL_ENDL;
-				// We can exit the following loop with the given condition, since if we'd reach the end of the lru set we'd have:
-				// purge_list.size() = lru.size() = num_entries - empty_entries = entries_to_purge + sCacheMaxEntries >= entries_to_purge
-				// So, it's certain that iter will never reach lru.end() first.
-				std::set<lru_data_t>::iterator iter = lru.begin();
-				while (purge_list.size() < entries_to_purge)
-				{
-					purge_list.insert(iter->second);
-					++iter;
-				}
-			}
-			else
-			{
-				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
-				for (const auto& iter : lru)
-                {
-					mLRU.insert(entries[iter.second].mID);
-// 					LL_INFOS() << "LRU: " << iter->first << " : " << iter->second << LL_ENDL;
-					if (--lru_entries <= 0)
-						break;
-				}
-			}
-			
-			if (!purge_list.empty())
-			{
-				for (auto iter : purge_list)
-                {
-					std::string tex_filename = getTextureFileName(entries[iter].mID);
-					removeEntry((S32)iter, entries[iter], tex_filename);
-				}
-				// If we removed any entries, we need to rebuild the entries list,
-				// write the header, and call this again
-				std::vector<Entry> new_entries;
-				for (U32 i=0; i<num_entries; i++)
-				{
-					const Entry& entry = entries[i];
-					if (entry.mImageSize > 0)
-					{
-						new_entries.push_back(entry);
-					}
-				}
-                mFreeList.clear(); // recreating list, no longer valid.
-				llassert_always(new_entries.size() <= sCacheMaxEntries);
-				mHeaderEntriesInfo.mEntries = new_entries.size();
-				writeEntriesHeader();
-				writeEntriesAndClose(new_entries);
-				mHeaderMutex.unlock(); // unlock the mutex before calling again
-				readHeaderCache(); // repeat with new entries file
-				mHeaderMutex.lock();
-			}
-			else
-			{
-				//entries are not changed, nothing here.
-			}
+			LLAPRFile::remove(getTextureFileName(id), mHeaderAPRFilePoolp);
 		}
 	}
-	mHeaderMutex.unlock();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1629,7 +1257,6 @@ void LLTextureCache::clearCorruptedCache()
 {
 	LL_WARNS() << "the texture cache is corrupted, need to be cleared." << LL_ENDL ;
 
-	closeHeaderEntriesFile();//close possible file handler
 	purgeAllTextures(false) ; //clear the cache.
 
 	if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1649,6 +1276,10 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+	// The index lives in the directory being cleared, let go of the mapping first
+	bool reopen_index = mIndex.isOpen() && !purge_directories;
+	mIndex.close();
+
 	if (!mReadOnly)
 	{
 		const char* subdirs = "0123456789abcdef";
@@ -1673,25 +1304,23 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mTexturesSizeTotal = 0;
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
-	mUpdatedEntryMap.clear();
 
-	// Info with 0 entries
-	setEntriesHeader();
-	writeEntriesHeader();
+	if (reopen_index)
+	{
+		// Starts out empty
+		mIndex.open(mHeaderEntriesFileName, sCacheMaxEntries, sHeaderCacheAddressSize,
+					sHeaderCacheEncoderVersion, mReadOnly);
+	}
 
 	LL_INFOS() << "The entire texture cache is cleared." << LL_ENDL ;
 }
 
-void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
+// Returns true while the cache is still above the purge target
+bool LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 {
 	if (mReadOnly)
 	{
-		return;
+		return false;
 	}
 
 	if (!mThreaded)
@@ -1702,74 +1331,22 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 	// time_limit doesn't account for lock time
 	LLMutexLock lock(&mHeaderMutex);
 
-	if (mPurgeEntryList.empty())
-	{
-		// Read the entries list and form list of textures to purge
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
-		if (!num_entries)
-		{
-			return; // nothing to purge
-		}
-
-		// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-		typedef std::set<std::pair<U32, S32> > time_idx_set_t;
-		std::set<std::pair<U32, S32> > time_idx_set;
-		for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-			iter1 != mTexturesSizeMap.end(); ++iter1)
-		{
-			if (iter1->second > 0)
-			{
-				id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-				if (iter2 != mHeaderIDMap.end())
-				{
-					S32 idx = iter2->second;
-					time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-				}
-				else
-				{
-					LL_ERRS("TextureCache") << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL;
-				}
-			}
-		}
-
-		S64 cache_size = mTexturesSizeTotal;
-		S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f - TEXTURE_CACHE_PURGE_AMOUNT) * 100)) / 100;
-		for (time_idx_set_t::iterator iter = time_idx_set.begin();
-			iter != time_idx_set.end(); ++iter)
-		{
-			S32 idx = iter->second;
-			if (cache_size >= purged_cache_size)
-			{
-				cache_size -= entries[idx].mBodySize;
-				mPurgeEntryList.push_back(std::pair<S32, Entry>(idx, entries[idx]));
-			}
-			else
-			{
-				break;
-			}
-		}
-		LL_DEBUGS("TextureCache") << "Formed Purge list of " << mPurgeEntryList.size() << " entries" << LL_ENDL;
-	}
-	else
+	// Walk the LRU from the oldest end, only entries with bodies take up space
+	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f - TEXTURE_CACHE_PURGE_AMOUNT) * 100)) / 100;
+	LLTimer timer;
+	S32 idx = mIndex.getOldest();
+	while (idx >= 0 && mIndex.getBodyBytes() >= purged_cache_size && timer.getElapsedTimeF32() < time_limit_sec)
 	{
-		// Remove collected entried
-		LLTimer timer;
-		while (!mPurgeEntryList.empty() && timer.getElapsedTimeF32() < time_limit_sec)
+		S32 next_idx = mIndex.getNewer(idx);
+		Entry entry = *mIndex.getEntry(idx);
+		if (entry.mBodySize > 0)
 		{
-			S32 idx = mPurgeEntryList.back().first;
-			Entry entry = mPurgeEntryList.back().second;
-			mPurgeEntryList.pop_back();
-			// make sure record is still valid
-			id_map_t::iterator iter_header = mHeaderIDMap.find(entry.mID);
-			if (iter_header != mHeaderIDMap.end() && iter_header->second == idx)
-			{
-				std::string tex_filename = getTextureFileName(entry.mID);
-				removeEntry(idx, entry, tex_filename);
-				writeEntryToHeaderImmediately(idx, entry);
-			}
+			std::string tex_filename = getTextureFileName(entry.mID);
+			removeEntry(idx, entry, tex_filename);
 		}
+		idx = next_idx;
 	}
+	return mIndex.getBodyBytes() >= purged_cache_size;
 }
 
 void LLTextureCache::purgeTextures(bool validate)
@@ -1789,35 +1366,12 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	LL_INFOS() << "TEXTURE CACHE: Purging." << LL_ENDL;
 
-	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
+	U32 num_entries = mIndex.getNumEntries();
 	if (!num_entries)
 	{
 		return; // nothing to purge
 	}
 	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
-	std::set<std::pair<U32,S32> > time_idx_set;
-	for (auto& iter1 : mTexturesSizeMap)
-    {
-		if (iter1.second > 0)
-		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1.first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.emplace(entries[idx].mTime, idx);
-// 				LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
-			}
-			else
-			{
-				LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
-			}
-		}
-	}
-	
 	// Validate 1/256th of the files on startup
 	U32 validate_idx = 0;
 	if (validate)
@@ -1828,52 +1382,57 @@ void LLTextureCache::purgeTextures(bool validate)
 		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
 	}
 
-	S64 cache_size = mTexturesSizeTotal;
 	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
 	S32 purge_count = 0;
-	for (const auto& iter : time_idx_set)
-    {
-		S32 idx = iter.second;
-		bool purge_entry = false;
-		std::string filename = getTextureFileName(entries[idx].mID);
-		if (cache_size >= purged_cache_size)
-		{
-			purge_entry = true;
-		}
-		else if (validate)
+	// The LRU list is already in time order, oldest first
+	S32 idx = mIndex.getOldest();
+	while (idx >= 0)
+	{
+		S32 next_idx = mIndex.getNewer(idx);
+		Entry entry = *mIndex.getEntry(idx);
+		if (entry.mBodySize > 0)
 		{
-			// make sure file exists and is the correct size
-			U32 uuididx = entries[idx].mID.mData[0];
-			if (uuididx == validate_idx)
+			bool purge_entry = false;
+			std::string filename = getTextureFileName(entry.mID);
+			if (mIndex.getBodyBytes() >= purged_cache_size)
+			{
+				purge_entry = true;
+			}
+			else if (validate)
 			{
- 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
-				// mHeaderAPRFilePoolp because this is under header mutex in main thread
-				S32 bodysize = LLAPRFile::size(filename, mHeaderAPRFilePoolp);
-				if (bodysize != entries[idx].mBodySize)
+				// make sure file exists and is the correct size
+				U32 uuididx = entry.mID.mData[0];
+				if (uuididx == validate_idx)
 				{
-					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize
-							<< filename << LL_ENDL;
-					purge_entry = true;
+	 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entry.mBodySize << LL_ENDL;
+					// mHeaderAPRFilePoolp because this is under header mutex in main thread
+					S32 bodysize = LLAPRFile::size(filename, mHeaderAPRFilePoolp);
+					if (bodysize != entry.mBodySize)
+					{
+						LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entry.mBodySize
+								<< filename << LL_ENDL;
+						purge_entry = true;
+					}
 				}
 			}
+			else
+			{
+				break;
+			}
+
+			if (purge_entry)
+			{
+				purge_count++;
+		 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
+				removeEntry(idx, entry, filename) ;
+			}
 		}
-		else
-		{
-			break;
-		}
-		
-		if (purge_entry)
-		{
-			purge_count++;
-	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
-			cache_size -= entries[idx].mBodySize;
-			removeEntry(idx, entries[idx], filename) ;			
-		}
+		idx = next_idx;
 	}
 
 	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
 
-	writeEntriesAndClose(entries);
+	mIndex.flush();
 	
 	// *FIX:Mani - watchdog back on.
 	LLAppViewer::instance()->resumeMainloopTimeout();
@@ -1881,7 +1440,7 @@ void LLTextureCache::purgeTextures(bool validate)
 	LL_INFOS("TextureCache") << "TEXTURE CACHE:"
 			<< " PURGED: " << purge_count
 			<< " ENTRIES: " << num_entries
-			<< " CACHE SIZE: " << mTexturesSizeTotal / (1024 * 1024) << " MB"
+			<< " CACHE SIZE: " << mIndex.getBodyBytes() / (1024 * 1024) << " MB"
 			<< LL_ENDL;
 }
 
@@ -1918,9 +1477,9 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
 	LLMutexLock lock(&mHeaderMutex);	
 	S32 idx = openAndReadEntry(id, entry, false);
-	if (idx >= 0)
-	{		
-		updateEntryTimeStamp(idx, entry); // updates time
+	if (idx >= 0 && !mReadOnly)
+	{
+		mIndex.touch(idx, time(NULL)); // most recently used
 	}
 	return idx;
 }
@@ -1929,18 +1488,9 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize)
 {
 	mHeaderMutex.lock();
-	S32 idx = openAndReadEntry(id, entry, true); // read or create
+	S32 idx = openAndReadEntry(id, entry, true); // read or create, recycles the LRU entry when full
 	mHeaderMutex.unlock();
 
-	if(idx < 0) // retry once
-	{
-		readHeaderCache(); // We couldn't write an entry, so refresh the LRU
-
-		mHeaderMutex.lock();
-		idx = openAndReadEntry(id, entry, true);
-		mHeaderMutex.unlock();
-	}
-
 	if (idx >= 0)
 	{
 		updateEntry(idx, entry, imagesize, datasize);				
@@ -2032,8 +1582,7 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 	{
 		// NOTE: Needs to be done on the control thread
 		//  (i.e. here)
-		purgeTexturesLazy(TEXTURE_LAZY_PURGE_TIME_LIMIT);
-		mDoPurge = !mPurgeEntryList.empty();
+		mDoPurge = purgeTexturesLazy(TEXTURE_LAZY_PURGE_TIME_LIMIT);
 	}
 	
 	if (rawimage.isNull() || rawimage->isBufferInvalid() || !rawimage->getData())
@@ -2057,13 +1606,13 @@ LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& d
 	U32 offset;
 	{
 		LLMutexLock lock(&mHeaderMutex);
-		id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-		if(iter == mHeaderIDMap.end())
+		S32 idx = mIndex.find(id);
+		if(idx < 0 || mIndex.getEntry(idx)->mImageSize <= 0)
 		{
 			return NULL; //not in the cache
 		}
 
-		offset = iter->second;
+		offset = idx;
 	}
 	offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
@@ -2286,20 +1835,6 @@ void LLTextureCache::addCompleted(Responder* responder, bool success)
 
 //////////////////////////////////////////////////////////////////////////////
 
-//called after mHeaderMutex is locked.
-void LLTextureCache::removeCachedTexture(const LLUUID& id)
-{
-	if(mTexturesSizeMap.find(id) != mTexturesSizeMap.end())
-	{
-		mTexturesSizeTotal -= mTexturesSizeMap[id] ;
-		mTexturesSizeMap.erase(id);
-	}
-	mHeaderIDMap.erase(id);
-	// We are inside header's mutex so mHeaderAPRFilePoolp is safe to use,
-	// but getLocalAPRFilePool() is not safe, it might be in use by worker
-	LLAPRFile::remove(getTextureFileName(id), mHeaderAPRFilePoolp);
-}
-
 //called after mHeaderMutex is locked.
 void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 {
@@ -2321,13 +1856,10 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 			  file_maybe_exists = false;
 		  }
 		}
-		mTexturesSizeTotal -= entry.mBodySize;
+		mIndex.remove(idx);
 
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
-		mTexturesSizeMap.erase(entry.mID);		
-		mFreeList.insert(idx);	
 	}
 
 	if (file_maybe_exists)
@@ -2344,15 +1876,16 @@ bool LLTextureCache::removeFromCache(const LLUUID& id)
 	{
 		lockHeaders() ;
 
+		// Entries still being created go too, this is how failed writes clean up
+		S32 idx = mIndex.find(id);
 		Entry entry;
-		S32 idx = openAndReadEntry(id, entry, false);
-		std::string tex_filename = getTextureFileName(id);
-		removeEntry(idx, entry, tex_filename) ;
 		if (idx >= 0)
-		{			
-			writeEntryToHeaderImmediately(idx, entry);					
-			ret = true;
+		{
+			entry = *mIndex.getEntry(idx);
 		}
+		std::string tex_filename = getTextureFileName(id);
+		removeEntry(idx, entry, tex_filename) ;
+		ret = (idx >= 0);
 
 		unlockHeaders() ;
 	}
@@ -30,6 +30,8 @@
 #include "lldir.h"
 #include "lluuid.h"
 
+#include "lltexturecacheindex.h"
+
 #include "llworkerthread.h"
 
 class LLImageFormatted;
@@ -43,33 +45,7 @@ class LLTextureCache final : public LLWorkerThread
 	friend class LLTextureCacheLocalFileWorker;
 
 private:
-	// Entries
-	static const U32 sHeaderEncoderStringSize = 32;
-	struct EntriesInfo
-	{
-		EntriesInfo() : mVersion(0.f), mAdressSize(0), mEntries(0) { memset(mEncoderVersion, 0, sHeaderEncoderStringSize); }
-		F32 mVersion;
-		U32 mAdressSize;
-		char mEncoderVersion[sHeaderEncoderStringSize];
-		U32 mEntries;
-	};
-	struct Entry
-	{
-        	Entry() :
-		        mImageSize(0),
-			mBodySize(0),
-			mTime(0)
-		{
-		}
-		Entry(const LLUUID& id, S32 imagesize, S32 bodysize, U32 time) :
-			mID(id), mImageSize(imagesize), mBodySize(bodysize), mTime(time) {}
-		void init(const LLUUID& id, U32 time) { mID = id, mImageSize = 0; mBodySize = 0; mTime = time; }
-		LLUUID mID; // 16 bytes
-		S32 mImageSize; // total size of image if known
-		S32 mBodySize; // size of body file in body cache
-		U32 mTime; // seconds since 1/1/1970
-	};
-
+	typedef LLTextureCacheIndex::Entry Entry;
 	
 public:
 
@@ -131,9 +107,9 @@ public:
 	// debug
 	S32 getNumReads() { return mReaders.size(); }
 	S32 getNumWrites() { return mWriters.size(); }
-	S64Bytes getUsage() { return S64Bytes(mTexturesSizeTotal); }
+	S64Bytes getUsage() { return S64Bytes(mIndex.getBodyBytes()); }
 	S64Bytes getMaxUsage() { return S64Bytes(sCacheMaxTexturesSize); }
-	U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
+	U32 getEntries() { return mIndex.getNumEntries(); }
 	U32 getMaxEntries() { return sCacheMaxEntries; };
 	BOOL isInCache(const LLUUID& id) ;
 	BOOL isInLocal(const LLUUID& id) ; //not thread safe at the moment
@@ -152,26 +128,14 @@ private:
 	void readHeaderCache();
 	void clearCorruptedCache();
 	void purgeAllTextures(bool purge_directories);
-	void purgeTexturesLazy(F32 time_limit_sec);
+	bool purgeTexturesLazy(F32 time_limit_sec);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-	void closeHeaderEntriesFile();
-	void readEntriesHeader();
-	void setEntriesHeader();
-	void writeEntriesHeader();
 	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
 	bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
-	void updateEntryTimeStamp(S32 idx, Entry& entry) ;
-	U32 openAndReadEntries(std::vector<Entry>& entries);
-	void writeEntriesAndClose(const std::vector<Entry>& entries);
-	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
-	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
 	void removeEntry(S32 idx, Entry& entry, std::string& filename);
-	void removeCachedTexture(const LLUUID& id) ;
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
 	void writeUpdatedEntries() ;
-	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
 	
@@ -185,7 +149,6 @@ private:
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
 	LLMutex mFastCacheMutex;
-	LLAPRFile* mHeaderAPRFile;
 	LLVolatileAPRPool* mFastCachePoolp;
 
 	// mLocalAPRFilePoolp is not thread safe and is meant only for workers
@@ -211,11 +174,7 @@ private:
 	std::string mHeaderEntriesFileName;
 	std::string mHeaderDataFileName;
 	std::string mFastCacheFileName;
-	EntriesInfo mHeaderEntriesInfo;
-	std::set<S32> mFreeList; // deleted entries
-	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID, S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	LLTextureCacheIndex mIndex; // guarded by mHeaderMutex
 
 	LLAPRFile*   mFastCachep;
 	LLFrameTimer mFastCacheTimer;
@@ -223,18 +182,9 @@ private:
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
-	S64 mTexturesSizeTotal;
 	LLAtomicBool mDoPurge;
 
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
-	typedef std::vector<std::pair<S32, Entry> > idx_entry_vector_t;
-	idx_entry_vector_t mPurgeEntryList;
-
 	// Statics
-	static F32 sHeaderCacheVersion;
 	static U32 sHeaderCacheAddressSize;
 	static std::string sHeaderCacheEncoderVersion;
 	static U32 sCacheMaxEntries;
@@ -0,0 +1,628 @@
+/**
+ * @file lltexturecacheindex.cpp
+ * @brief Memory mapped, hashed header entry index for LLTextureCache
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturecacheindex.h"
+
+#include "llcrc.h"
+#include "llfile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+
+namespace
+{
+	const U32 INDEX_MAGIC = 0x58444954; // "TIDX"
+	const U32 INDEX_VERSION = 2;
+	const U32 EMPTY_BUCKET = LLTextureCacheIndex::INVALID_SLOT;
+	const size_t ENCODER_VERSION_LENGTH = 32;
+}
+
+struct LLTextureCacheIndex::Header
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mAddressSize;
+	char mEncoderVersion[ENCODER_VERSION_LENGTH];
+	U32 mMaxEntries;
+	U32 mHashSize;		// bucket count, power of two
+	U32 mHighWater;
+	U32 mNumEntries;
+	U32 mFreeHead;
+	U32 mOldest;
+	U32 mNewest;
+	U32 mClean;			// zero while a writer has the index open
+	U32 mReserved;
+	S64 mBodyBytes;		// sum of mBodySize over live entries
+	U32 mChecksum;		// of everything above, the used slots and the hash table,
+						// only trusted when mClean is set
+	U32 mPadding;
+};
+
+static_assert(sizeof(LLTextureCacheIndex::Entry) == 36, "texture cache index entry layout changed");
+
+LLTextureCacheIndex::LLTextureCacheIndex()
+:	mReadOnly(true)
+{
+}
+
+LLTextureCacheIndex::~LLTextureCacheIndex()
+{
+	close();
+}
+
+LLTextureCacheIndex::EOpenResult LLTextureCacheIndex::open(const std::string& filename, U32 max_entries, U32 address_size,
+														   const std::string& encoder_version, bool read_only,
+														   std::vector<LLUUID>* dropped)
+{
+	close();
+	mReadOnly = read_only;
+	if (!max_entries && !read_only)
+	{
+		return OPEN_FAILED;
+	}
+
+	EOpenResult result = OPEN_EXISTING;
+	if (mFile.open(filename, 0, read_only) && validateHeader(address_size, encoder_version))
+	{
+		if (read_only)
+		{
+			// Dirty just means the writing instance is still running, its
+			// updates keep the lookup structures consistent.
+			return OPEN_EXISTING;
+		}
+
+		Header* header = getHeader();
+		if (header->mMaxEntries != max_entries)
+		{
+			// Slot numbers are positions in texture.cache and the fast cache,
+			// so entries keep their slot and only the ones past the new end go.
+			U32 keep = llmin(header->mHighWater, max_entries);
+			std::vector<Entry> kept(getSlots(), getSlots() + keep);
+			if (dropped)
+			{
+				for (U32 i = keep; i < header->mHighWater; ++i)
+				{
+					if (slotAt(i).mID.notNull())
+					{
+						dropped->push_back(slotAt(i).mID);
+					}
+				}
+			}
+
+			mFile.close();
+			LLFile::remove(filename);
+			if (!mFile.open(filename, fileSizeFor(max_entries), false))
+			{
+				return OPEN_FAILED;
+			}
+			initHeader(max_entries, address_size, encoder_version);
+			if (keep)
+			{
+				memcpy(getSlots(), &kept[0], keep * sizeof(Entry));
+			}
+			getHeader()->mHighWater = keep;
+			rebuild(dropped);
+			result = OPEN_RECOVERED;
+		}
+		else if (!header->mClean)
+		{
+			LL_WARNS("TextureCache") << "Texture cache index was not closed cleanly, rebuilding lookup tables" << LL_ENDL;
+			rebuild(dropped);
+			result = OPEN_RECOVERED;
+		}
+	}
+	else
+	{
+		mFile.close();
+		if (read_only)
+		{
+			return OPEN_FAILED;
+		}
+
+		LLFile::remove(filename, ENOENT);
+		if (!mFile.open(filename, fileSizeFor(max_entries), false))
+		{
+			LL_WARNS("TextureCache") << "Unable to map texture cache index " << filename << LL_ENDL;
+			return OPEN_FAILED;
+		}
+		initHeader(max_entries, address_size, encoder_version);
+		result = OPEN_CREATED;
+	}
+
+	setClean(false);
+	return result;
+}
+
+void LLTextureCacheIndex::close()
+{
+	if (!mFile.isOpen())
+	{
+		return;
+	}
+	if (!mReadOnly)
+	{
+		setClean(true);
+	}
+	mFile.close();
+}
+
+void LLTextureCacheIndex::flush()
+{
+	mFile.flush();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Lookup and update
+
+S32 LLTextureCacheIndex::find(const LLUUID& id) const
+{
+	if (!mFile.isOpen() || id.isNull())
+	{
+		return -1;
+	}
+
+	const U32* buckets = getBuckets();
+	const U32 mask = getHeader()->mHashSize - 1;
+	const U32 max_entries = getHeader()->mMaxEntries;
+	// Bounded by the table size so a damaged read-only index can't spin
+	for (U32 bucket = homeBucket(id), probes = 0; probes <= mask; bucket = (bucket + 1) & mask, ++probes)
+	{
+		U32 slot = buckets[bucket];
+		if (slot == EMPTY_BUCKET)
+		{
+			break;
+		}
+		if (slot < max_entries && slotAt(slot).mID == id)
+		{
+			return (S32)slot;
+		}
+	}
+	return -1;
+}
+
+S32 LLTextureCacheIndex::insert(const LLUUID& id, U32 time)
+{
+	if (!mFile.isOpen() || mReadOnly || id.isNull())
+	{
+		return -1;
+	}
+
+	Header* header = getHeader();
+	U32 slot;
+	if (header->mFreeHead != INVALID_SLOT)
+	{
+		slot = header->mFreeHead;
+		header->mFreeHead = slotAt(slot).mNewer;
+	}
+	else if (header->mHighWater < header->mMaxEntries)
+	{
+		slot = header->mHighWater++;
+	}
+	else
+	{
+		return -1;
+	}
+
+	Entry& entry = slotAt(slot);
+	entry.mID = id;
+	entry.mImageSize = -1;
+	entry.mBodySize = 0;
+	entry.mTime = time;
+	linkNewest(slot);
+	hashInsert(slot);
+	++header->mNumEntries;
+	return (S32)slot;
+}
+
+void LLTextureCacheIndex::remove(S32 slot)
+{
+	if (!mFile.isOpen() || mReadOnly || slot < 0 || (U32)slot >= getHeader()->mHighWater)
+	{
+		return;
+	}
+
+	Entry& entry = slotAt(slot);
+	if (entry.mID.isNull())
+	{
+		return; // already free
+	}
+
+	Header* header = getHeader();
+	hashRemove(slot);
+	unlink(slot);
+	header->mBodyBytes -= entry.mBodySize;
+	--header->mNumEntries;
+
+	entry.mID.setNull();
+	entry.mImageSize = 0;
+	entry.mBodySize = 0;
+	entry.mTime = 0;
+	entry.mOlder = INVALID_SLOT;
+	entry.mNewer = header->mFreeHead;
+	header->mFreeHead = slot;
+}
+
+void LLTextureCacheIndex::touch(S32 slot, U32 time)
+{
+	if (!mFile.isOpen() || mReadOnly || slot < 0 || (U32)slot >= getHeader()->mHighWater)
+	{
+		return;
+	}
+
+	slotAt(slot).mTime = time;
+	if (getHeader()->mNewest != (U32)slot)
+	{
+		unlink(slot);
+		linkNewest(slot);
+	}
+}
+
+void LLTextureCacheIndex::setSizes(S32 slot, S32 image_size, S32 body_size)
+{
+	if (!mFile.isOpen() || mReadOnly || slot < 0 || (U32)slot >= getHeader()->mHighWater)
+	{
+		return;
+	}
+
+	Entry& entry = slotAt(slot);
+	getHeader()->mBodyBytes += body_size - entry.mBodySize;
+	entry.mImageSize = image_size;
+	entry.mBodySize = body_size;
+}
+
+const LLTextureCacheIndex::Entry* LLTextureCacheIndex::getEntry(S32 slot) const
+{
+	if (!mFile.isOpen() || slot < 0 || (U32)slot >= getHeader()->mMaxEntries)
+	{
+		return nullptr;
+	}
+	return &slotAt(slot);
+}
+
+S32 LLTextureCacheIndex::getOldest() const
+{
+	if (!mFile.isOpen() || getHeader()->mOldest == INVALID_SLOT)
+	{
+		return -1;
+	}
+	return (S32)getHeader()->mOldest;
+}
+
+S32 LLTextureCacheIndex::getNewer(S32 slot) const
+{
+	if (!mFile.isOpen() || slot < 0 || (U32)slot >= getHeader()->mMaxEntries)
+	{
+		return -1;
+	}
+	U32 newer = slotAt(slot).mNewer;
+	return newer < getHeader()->mMaxEntries ? (S32)newer : -1;
+}
+
+U32 LLTextureCacheIndex::getHighWater() const
+{
+	return mFile.isOpen() ? getHeader()->mHighWater : 0;
+}
+
+U32 LLTextureCacheIndex::getNumEntries() const
+{
+	return mFile.isOpen() ? getHeader()->mNumEntries : 0;
+}
+
+U32 LLTextureCacheIndex::getMaxEntries() const
+{
+	return mFile.isOpen() ? getHeader()->mMaxEntries : 0;
+}
+
+S64 LLTextureCacheIndex::getBodyBytes() const
+{
+	return mFile.isOpen() ? getHeader()->mBodyBytes : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Layout
+
+LLTextureCacheIndex::Header* LLTextureCacheIndex::getHeader() const
+{
+	return (Header*)mFile.getData();
+}
+
+LLTextureCacheIndex::Entry* LLTextureCacheIndex::getSlots() const
+{
+	return (Entry*)(mFile.getData() + sizeof(Header));
+}
+
+U32* LLTextureCacheIndex::getBuckets() const
+{
+	return (U32*)(mFile.getData() + sizeof(Header) + (size_t)getHeader()->mMaxEntries * sizeof(Entry));
+}
+
+// static
+U32 LLTextureCacheIndex::hashSizeFor(U32 max_entries)
+{
+	// Keep the load factor at or below one half
+	U32 size = 16;
+	while (size < max_entries * 2)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+// static
+size_t LLTextureCacheIndex::fileSizeFor(U32 max_entries)
+{
+	return sizeof(Header) + (size_t)max_entries * sizeof(Entry) + (size_t)hashSizeFor(max_entries) * sizeof(U32);
+}
+
+bool LLTextureCacheIndex::validateHeader(U32 address_size, const std::string& encoder_version) const
+{
+	if (mFile.getSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	const Header* header = getHeader();
+	if (header->mMagic != INDEX_MAGIC
+		|| header->mVersion != INDEX_VERSION
+		|| header->mAddressSize != address_size
+		|| strncmp(header->mEncoderVersion, encoder_version.c_str(), ENCODER_VERSION_LENGTH - 1) != 0)
+	{
+		return false;
+	}
+
+	if (!header->mMaxEntries
+		|| header->mHashSize != hashSizeFor(header->mMaxEntries)
+		|| mFile.getSize() < fileSizeFor(header->mMaxEntries)
+		|| header->mHighWater > header->mMaxEntries)
+	{
+		return false;
+	}
+
+	if (header->mClean)
+	{
+		if (header->mChecksum != computeChecksum())
+		{
+			LL_WARNS("TextureCache") << "Texture cache index checksum mismatch" << LL_ENDL;
+			return false;
+		}
+		// Links are only followed without a rebuild when the index is clean
+		if ((header->mFreeHead != INVALID_SLOT && header->mFreeHead >= header->mHighWater)
+			|| (header->mOldest != INVALID_SLOT && header->mOldest >= header->mHighWater)
+			|| (header->mNewest != INVALID_SLOT && header->mNewest >= header->mHighWater))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void LLTextureCacheIndex::initHeader(U32 max_entries, U32 address_size, const std::string& encoder_version)
+{
+	Header* header = getHeader();
+	memset(header, 0, sizeof(Header));
+	header->mMagic = INDEX_MAGIC;
+	header->mVersion = INDEX_VERSION;
+	header->mAddressSize = address_size;
+	strncpy(header->mEncoderVersion, encoder_version.c_str(), ENCODER_VERSION_LENGTH - 1);
+	header->mMaxEntries = max_entries;
+	header->mHashSize = hashSizeFor(max_entries);
+	header->mFreeHead = INVALID_SLOT;
+	header->mOldest = INVALID_SLOT;
+	header->mNewest = INVALID_SLOT;
+	memset(getBuckets(), 0xff, (size_t)header->mHashSize * sizeof(U32));
+}
+
+U32 LLTextureCacheIndex::computeChecksum() const
+{
+	const Header* header = getHeader();
+	LLCRC crc;
+	crc.update(mFile.getData(), offsetof(Header, mChecksum));
+	crc.update((const U8*)getSlots(), (size_t)header->mHighWater * sizeof(Entry));
+	crc.update((const U8*)getBuckets(), (size_t)header->mHashSize * sizeof(U32));
+	return crc.getCRC();
+}
+
+void LLTextureCacheIndex::setClean(bool clean)
+{
+	Header* header = getHeader();
+	header->mClean = clean ? 1 : 0;
+	// A dirty index is never trusted, so only a clean one pays for the checksum
+	header->mChecksum = clean ? computeChecksum() : 0;
+	mFile.flush();
+}
+
+// Everything but the slot array is derived state, recreate it from the slots.
+// Records that don't survive have their ids appended to dropped, so the
+// caller can delete their bodies, and trailing unused slots are given back.
+void LLTextureCacheIndex::rebuild(std::vector<LLUUID>* dropped)
+{
+	Header* header = getHeader();
+	memset(getBuckets(), 0xff, (size_t)header->mHashSize * sizeof(U32));
+	header->mNumEntries = 0;
+	header->mBodyBytes = 0;
+	header->mFreeHead = INVALID_SLOT;
+	header->mOldest = INVALID_SLOT;
+	header->mNewest = INVALID_SLOT;
+
+	std::vector<std::pair<U32, U32> > live; // time, slot
+	live.reserve(header->mHighWater);
+	for (U32 i = 0; i < header->mHighWater; ++i)
+	{
+		const Entry& entry = slotAt(i);
+		// Entries still being created when we went down never got their data
+		if (entry.mID.notNull() && entry.mImageSize > 0 && entry.mBodySize >= 0 && entry.mBodySize <= entry.mImageSize)
+		{
+			live.push_back(std::make_pair(entry.mTime, i));
+		}
+		else if (entry.mID.notNull() && dropped)
+		{
+			dropped->push_back(entry.mID);
+		}
+	}
+	std::sort(live.begin(), live.end());
+
+	std::vector<bool> used(header->mHighWater, false);
+	for (const auto& item : live)
+	{
+		U32 slot = item.second;
+		if (find(slotAt(slot).mID) >= 0)
+		{
+			// Duplicate id, keep the newest copy
+			S32 older = find(slotAt(slot).mID);
+			header->mBodyBytes -= slotAt(older).mBodySize;
+			--header->mNumEntries;
+			hashRemove(older);
+			unlink(older);
+			used[older] = false;
+		}
+		linkNewest(slot);
+		hashInsert(slot);
+		header->mBodyBytes += slotAt(slot).mBodySize;
+		++header->mNumEntries;
+		used[slot] = true;
+	}
+
+	// Trailing unused slots go back past the high water mark
+	U32 high_water = header->mHighWater;
+	while (high_water > 0 && !used[high_water - 1])
+	{
+		slotAt(--high_water).mID.setNull();
+	}
+	header->mHighWater = high_water;
+
+	// Free list in descending order so low slots get reused first
+	for (U32 i = header->mHighWater; i-- > 0; )
+	{
+		if (!used[i])
+		{
+			Entry& entry = slotAt(i);
+			entry.mID.setNull();
+			entry.mImageSize = 0;
+			entry.mBodySize = 0;
+			entry.mTime = 0;
+			entry.mOlder = INVALID_SLOT;
+			entry.mNewer = header->mFreeHead;
+			header->mFreeHead = i;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Hash table and LRU list
+
+U32 LLTextureCacheIndex::homeBucket(const LLUUID& id) const
+{
+	// Asset ids are random, any four bytes hash well. Not LLUUID::hash(),
+	// which is free to change between builds and this table lives on disk.
+	U32 a, b;
+	memcpy(&a, &id.mData[0], sizeof(U32));
+	memcpy(&b, &id.mData[8], sizeof(U32));
+	return (a ^ (b * 0x9e3779b1U)) & (getHeader()->mHashSize - 1);
+}
+
+void LLTextureCacheIndex::hashInsert(U32 slot)
+{
+	U32* buckets = getBuckets();
+	const U32 mask = getHeader()->mHashSize - 1;
+	U32 bucket = homeBucket(slotAt(slot).mID);
+	while (buckets[bucket] != EMPTY_BUCKET)
+	{
+		bucket = (bucket + 1) & mask;
+	}
+	buckets[bucket] = slot;
+}
+
+void LLTextureCacheIndex::hashRemove(U32 slot)
+{
+	U32* buckets = getBuckets();
+	const U32 mask = getHeader()->mHashSize - 1;
+	U32 hole = homeBucket(slotAt(slot).mID);
+	while (buckets[hole] != slot)
+	{
+		if (buckets[hole] == EMPTY_BUCKET)
+		{
+			llassert(false);
+			return;
+		}
+		hole = (hole + 1) & mask;
+	}
+
+	// Backward shift deletion, keeps probe sequences intact without tombstones
+	for (U32 next = (hole + 1) & mask; buckets[next] != EMPTY_BUCKET; next = (next + 1) & mask)
+	{
+		U32 home = homeBucket(slotAt(buckets[next]).mID);
+		bool stays = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+		if (!stays)
+		{
+			buckets[hole] = buckets[next];
+			hole = next;
+		}
+	}
+	buckets[hole] = EMPTY_BUCKET;
+}
+
+void LLTextureCacheIndex::linkNewest(U32 slot)
+{
+	Header* header = getHeader();
+	Entry& entry = slotAt(slot);
+	entry.mOlder = header->mNewest;
+	entry.mNewer = INVALID_SLOT;
+	if (header->mNewest != INVALID_SLOT)
+	{
+		slotAt(header->mNewest).mNewer = slot;
+	}
+	else
+	{
+		header->mOldest = slot;
+	}
+	header->mNewest = slot;
+}
+
+void LLTextureCacheIndex::unlink(U32 slot)
+{
+	Header* header = getHeader();
+	Entry& entry = slotAt(slot);
+	if (entry.mOlder != INVALID_SLOT)
+	{
+		slotAt(entry.mOlder).mNewer = entry.mNewer;
+	}
+	else
+	{
+		header->mOldest = entry.mNewer;
+	}
+	if (entry.mNewer != INVALID_SLOT)
+	{
+		slotAt(entry.mNewer).mOlder = entry.mOlder;
+	}
+	else
+	{
+		header->mNewest = entry.mOlder;
+	}
+	entry.mOlder = INVALID_SLOT;
+	entry.mNewer = INVALID_SLOT;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file lltexturecacheindex.h
+ * @brief Memory mapped, hashed header entry index for LLTextureCache
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTURECACHEINDEX_H
+#define LL_LLTEXTURECACHEINDEX_H
+
+#include "llmappedfile.h"
+#include "lluuid.h"
+
+#include <vector>
+
+// On-disk layout, one fixed size file:
+//  Header
+//  Entry[max entries]      slot array, the slot number is the texture's
+//                          index into texture.cache and the fast cache
+//  U32[hash size]          open addressed (linear probing) table of slots,
+//                          keyed by the texture id
+// Live entries are also chained oldest to newest through mOlder/mNewer and
+// free slots through mNewer, so lookups, LRU updates and evictions never
+// have to scan the file. The header carries a clean flag and a checksum of
+// the whole index; after an unclean shutdown the hash table, LRU and free
+// list are rebuilt from the slot array.
+class LLTextureCacheIndex
+{
+public:
+	struct Entry
+	{
+		LLUUID mID;		// 16 bytes
+		S32 mImageSize;	// total size of image if known, -1 while the entry is being created
+		S32 mBodySize;	// size of body file in body cache
+		U32 mTime;		// seconds since 1/1/1970
+		U32 mOlder;		// LRU neighbours
+		U32 mNewer;		// doubles as the free list link
+	};
+
+	static const U32 INVALID_SLOT = 0xffffffff;
+
+	enum EOpenResult
+	{
+		OPEN_FAILED,	// could not map the file, index is closed
+		OPEN_EXISTING,	// reused a cleanly closed index as is
+		OPEN_RECOVERED,	// reused the entries, lookup structures were rebuilt
+		OPEN_CREATED	// started empty, any previous cache contents are stale
+	};
+
+	LLTextureCacheIndex();
+	~LLTextureCacheIndex();
+
+	// Slots at or past max_entries in an existing, larger index, and entries
+	// left unfinished by a crash, are dropped and their ids appended to
+	// dropped so the caller can delete the bodies.
+	EOpenResult open(const std::string& filename, U32 max_entries, U32 address_size,
+					 const std::string& encoder_version, bool read_only,
+					 std::vector<LLUUID>* dropped = nullptr);
+	// Marks the index clean before unmapping it.
+	void close();
+	// Schedules dirty pages for write back.
+	void flush();
+
+	bool isOpen() const					{ return mFile.isOpen(); }
+
+	// Returns the slot holding id, or -1.
+	S32 find(const LLUUID& id) const;
+	// Claims a free slot for id as the newest entry, with mImageSize = -1.
+	// Returns -1 when every slot is in use.
+	S32 insert(const LLUUID& id, U32 time);
+	void remove(S32 slot);
+	// Makes slot the most recently used entry.
+	void touch(S32 slot, U32 time);
+	void setSizes(S32 slot, S32 image_size, S32 body_size);
+
+	const Entry* getEntry(S32 slot) const;
+	S32 getOldest() const;
+	S32 getNewer(S32 slot) const;
+	// Slots below this have been used at some point, for full scans.
+	U32 getHighWater() const;
+
+	U32 getNumEntries() const;
+	U32 getMaxEntries() const;
+	S64 getBodyBytes() const;
+
+private:
+	struct Header;
+
+	Header* getHeader() const;
+	Entry* getSlots() const;
+	U32* getBuckets() const;
+	Entry& slotAt(U32 slot) const		{ return getSlots()[slot]; }
+
+	static U32 hashSizeFor(U32 max_entries);
+	static size_t fileSizeFor(U32 max_entries);
+
+	bool validateHeader(U32 address_size, const std::string& encoder_version) const;
+	void initHeader(U32 max_entries, U32 address_size, const std::string& encoder_version);
+	U32 computeChecksum() const;
+	void setClean(bool clean);
+	void rebuild(std::vector<LLUUID>* dropped);
+
+	U32 homeBucket(const LLUUID& id) const;
+	void hashInsert(U32 slot);
+	void hashRemove(U32 slot);
+	void linkNewest(U32 slot);
+	void unlink(U32 slot);
+
+private:
+	LLMappedFile mFile;
+	bool mReadOnly;
+};
+
+#endif // LL_LLTEXTURECACHEINDEX_H
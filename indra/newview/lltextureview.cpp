@@ -68,8 +68,8 @@ std::set<LLViewerFetchedTexture*> LLTextureView::sDebugImages;
 
 ////////////////////////////////////////////////////////////////////////////
 
-static std::string title_string1a("Tex UUID Area  DDis(Req)  DecodePri(Fetch)     [download] pk/max");
-static std::string title_string1b("Tex UUID Area  DDis(Req)  Fetch(DecodePri)     [download] pk/max");
+static std::string title_string1a("Tex UUID Area  DDis(Req)  DecodePri(Fetch)  ResT  [download] pk/max");
+static std::string title_string1b("Tex UUID Area  DDis(Req)  Fetch(DecodePri)  ResT  [download] pk/max");
 static std::string title_string2("State");
 static std::string title_string3("Pkt Bnd");
 static std::string title_string4("  W x H (Dis) Mem");
@@ -198,29 +198,32 @@ void LLTextureBar::draw()
 
 	LLGLSUIDefault gls_ui;
 	
-	// Name, pixel_area, requested pixel area, decode priority
+	// Name, pixel_area, requested pixel area, decode priority, seconds the
+	// last wait for the wanted resolution took
 	std::string uuid_str;
 	mImagep->mID.toString(uuid_str);
 	uuid_str = uuid_str.substr(0,7);
 	if (mTextureView->mOrderFetch)
 	{
-		tex_str = llformat("%s %7.0f %d(%d) 0x%08x(%8.0f)",
+		tex_str = llformat("%s %7.0f %d(%d) 0x%08x(%8.0f) %5.1f",
 						   uuid_str.c_str(),
 						   mImagep->mMaxVirtualSize,
 						   mImagep->mDesiredDiscardLevel,
 						   mImagep->mRequestedDiscardLevel,
 						   mImagep->mFetchPriority,
-						   mImagep->getDecodePriority());
+						   mImagep->getDecodePriority(),
+						   mImagep->getTimeToResolution());
 	}
 	else
 	{
-		tex_str = llformat("%s %7.0f %d(%d) %8.0f(0x%08x)",
+		tex_str = llformat("%s %7.0f %d(%d) %8.0f(0x%08x) %5.1f",
 						   uuid_str.c_str(),
 						   mImagep->mMaxVirtualSize,
 						   mImagep->mDesiredDiscardLevel,
 						   mImagep->mRequestedDiscardLevel,
 						   mImagep->getDecodePriority(),
-						   mImagep->mFetchPriority);
+						   mImagep->mFetchPriority,
+						   mImagep->getTimeToResolution());
 	}
 
 	LLFontGL::getFontMonospace()->renderUTF8(tex_str, 0, title_x1, getRect().getHeight(),
@@ -631,10 +634,10 @@ void LLGLTexMemBar::draw()
 											 color, LLFontGL::LEFT, LLFontGL::TOP);
 	
 	// Mesh status line
-	text = llformat("Mesh: Reqs(Tot/Htp/Big): %u/%u/%u Rtr/Err: %u/%u Cread/Cwrite: %u/%u Low/At/High: %d/%d/%d",
+	text = llformat("Mesh: Reqs(Tot/Htp/Big): %u/%u/%u Rtr/Err: %u/%u Cread/Cwrite/Dread: %u/%u/%u Low/At/High: %d/%d/%d",
 					LLMeshRepository::sMeshRequestCount, LLMeshRepository::sHTTPRequestCount, LLMeshRepository::sHTTPLargeRequestCount,
 					LLMeshRepository::sHTTPRetryCount, LLMeshRepository::sHTTPErrorCount,
-					LLMeshRepository::sCacheReads, LLMeshRepository::sCacheWrites,
+					LLMeshRepository::sCacheReads, LLMeshRepository::sCacheWrites, LLMeshRepository::sDecodedCacheReads,
 					LLMeshRepoThread::sRequestLowWater, LLMeshRepoThread::sRequestWaterLevel, LLMeshRepoThread::sRequestHighWater);
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*2,
 											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
@@ -969,6 +969,8 @@ void LLViewerObjectList::update(LLAgent &agent)
 	}
 	else
 	{
+		// Avatars evaluate their poses together once all objects are idled
+		LLVOAvatar::beginAnimationStage();
 		for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
 			idle_iter != idle_end; idle_iter++)
 		{
@@ -976,6 +978,7 @@ void LLViewerObjectList::update(LLAgent &agent)
 			llassert(objectp->isActive());
                 objectp->idleUpdate(agent, frame_time);
 		}
+		LLVOAvatar::endAnimationStage();
 
 		//update flexible objects
 		LLVolumeImplFlexible::updateClass();
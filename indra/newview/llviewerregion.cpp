@@ -727,6 +727,10 @@ void LLViewerRegion::saveObjectCache()
 {
 	if (!mCacheLoaded)
 	{
+		if(LLVOCache::instanceExists())
+		{
+			LLVOCache::getInstance()->discardPrefetch(mHandle);
+		}
 		return;
 	}
 
@@ -203,7 +203,8 @@ LLTrace::EventStatHandle<F64Seconds >	AVATAR_EDIT_TIME("avataredittime", "Second
 															MOUSELOOK_TIME("mouselooktime", "Seconds in Mouselook"),
 															FPS_10_TIME("fps10time", "Seconds below 10 FPS"),
 															FPS_8_TIME("fps8time", "Seconds below 8 FPS"),
-															FPS_2_TIME("fps2time", "Seconds below 2 FPS");
+															FPS_2_TIME("fps2time", "Seconds below 2 FPS"),
+															TEXTURE_RESOLUTION_TIME("textureresolutiontime", "Seconds for textures to reach the resolution they are seen at");
 
 LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > OBJECT_CACHE_HIT_RATE("object_cache_hits");
 
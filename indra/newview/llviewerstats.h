@@ -238,7 +238,8 @@ extern LLTrace::EventStatHandle<F64Seconds >	AVATAR_EDIT_TIME,
 																MOUSELOOK_TIME,
 																FPS_10_TIME,
 																FPS_8_TIME,
-																FPS_2_TIME;
+																FPS_2_TIME,
+																TEXTURE_RESOLUTION_TIME;
 
 extern LLTrace::EventStatHandle<LLUnit<F32, LLUnits::Percent> > OBJECT_CACHE_HIT_RATE;
 
@@ -62,6 +62,7 @@
 #include "llmediaentry.h"
 #include "llvovolume.h"
 #include "llviewermedia.h"
+#include "llviewerstats.h"
 #include "lltexturecache.h"
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -1127,7 +1128,10 @@ void LLViewerFetchedTexture::init(bool firstinit)
 	{
 		mDecodePriority = 0.f;
 		mInImageList = 0;
+		mDecodeQueueIndex = -1;
 	}
+	mResolutionWaitStart = 0.f;
+	mTimeToResolution = -1.f;
 
 	// Only set mIsMissingAsset true when we know for certain that the database
 	// does not contain this image.
@@ -1181,6 +1185,10 @@ LLViewerFetchedTexture::~LLViewerFetchedTexture()
 	{
 		LLAppViewer::getTextureFetch()->deleteRequest(getID(), true);
 	}
+	if (mDecodeQueueIndex >= 0)
+	{
+		gTextureList.dequeueDecodePriorityUpdate(this);
+	}
 	cleanup();	
 }
 
@@ -1598,6 +1606,11 @@ BOOL LLViewerFetchedTexture::createTexture(S32 usename/*= 0*/)
 
 	setActive();
 
+	if (res)
+	{
+		updateResolutionWait();
+	}
+
 	if (!needsToSaveRawImage())
 	{
 		mNeedsAux = FALSE;
@@ -1885,6 +1898,31 @@ void LLViewerFetchedTexture::setDecodePriority(F32 priority)
 	}
 }
 
+void LLViewerFetchedTexture::updateResolutionWait()
+{
+	if (mDesiredDiscardLevel > MAX_DISCARD_LEVEL || mIsMissingAsset)
+	{
+		// Not wanted at any level, or never coming
+		mResolutionWaitStart = 0.f;
+		return;
+	}
+
+	const S32 current_discard = getDiscardLevel();
+	if (current_discard >= 0 && current_discard <= mDesiredDiscardLevel)
+	{
+		if (mResolutionWaitStart > 0.f)
+		{
+			mTimeToResolution = gFrameTimeSeconds - mResolutionWaitStart;
+			record(LLStatViewer::TEXTURE_RESOLUTION_TIME, F64Seconds(mTimeToResolution));
+			mResolutionWaitStart = 0.f;
+		}
+	}
+	else if (mResolutionWaitStart <= 0.f)
+	{
+		mResolutionWaitStart = gFrameTimeSeconds;
+	}
+}
+
 void LLViewerFetchedTexture::setAdditionalDecodePriority(F32 priority)
 {
 	priority = llclamp(priority, 0.f, 1.f);
@@ -374,6 +374,14 @@ public:
 	BOOL isInImageList() const {return mInImageList ;}
 	void setInImageList(BOOL flag) {mInImageList = flag ;}
 
+	// Place in LLViewerTextureList's queue of priority updates, -1 when not queued
+	S32  getDecodeQueueIndex() const {return mDecodeQueueIndex ;}
+	void setDecodeQueueIndex(S32 index) {mDecodeQueueIndex = index ;}
+
+	// Times how long the texture takes to reach the discard level it is wanted at
+	void updateResolutionWait() ;
+	F32  getTimeToResolution() const {return mTimeToResolution ;}
+
 	LLFrameTimer* getLastPacketTimer() {return &mLastPacketTimer;}
 
 	U32 getFetchPriority() const { return mFetchPriority ;}
@@ -518,6 +526,9 @@ protected:
 	LLFrameTimer mStopFetchingTimer;	// Time since mDecodePriority == 0.f.
 
 	BOOL  mInImageList;				// TRUE if image is in list (in which case don't reset priority!)
+	S32   mDecodeQueueIndex;
+	F32   mResolutionWaitStart;		// Frame time the wanted discard level was first missing, 0 if it is not
+	F32   mTimeToResolution;		// Seconds the last wait for the wanted discard level took, -1 if none yet
 	BOOL  mNeedsCreateTexture;	
 
 	BOOL   mForSculpt ; //a flag if the texture is used as sculpt data.
@@ -90,8 +90,19 @@ LLTextureKey::LLTextureKey(LLUUID id, ETexListType tex_type)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+static S32 get_decode_queue_index(LLViewerFetchedTexture* const& image)
+{
+	return image->getDecodeQueueIndex();
+}
+
+static void set_decode_queue_index(LLViewerFetchedTexture*& image, S32 index)
+{
+	image->setDecodeQueueIndex(index);
+}
+
 LLViewerTextureList::LLViewerTextureList() 
 	: mForceResetTextureStats(FALSE),
+	mDecodeQueue(get_decode_queue_index, set_decode_queue_index),
 	mInitialized(FALSE),
 	mMaxResidentTexMemInMegaBytes(0),
 	mMaxTotalTextureMemInMegaBytes(0)
@@ -328,6 +339,7 @@ void LLViewerTextureList::shutdown()
 	mUUIDMap.clear();
 	mUUIDHashMap.clear();
 	
+	mDecodeQueue.clear();
 	mImageList.clear();
 
 	mInitialized = FALSE ; //prevent loading textures again.
@@ -736,6 +748,7 @@ void LLViewerTextureList::deleteImage(LLViewerFetchedTexture *image)
 		llverify(mUUIDMap.erase(key) == 1);
 		llverify(mUUIDHashMap.erase(key) == 1);
 		sNumImages--;
+		mDecodeQueue.remove(image);
 		removeImageFromList(image);
 	}
 }
@@ -862,9 +875,39 @@ void LLViewerTextureList::clearFetchingRequests()
 	}
 }
 
+void LLViewerTextureList::queueDecodePriorityUpdate(LLViewerFetchedTexture* imagep, F32 importance)
+{
+	if (mInitialized && imagep && imagep->isInImageList())
+	{
+		mDecodeQueue.raise(importance, imagep);
+	}
+}
+
+void LLViewerTextureList::dequeueDecodePriorityUpdate(LLViewerFetchedTexture* imagep)
+{
+	mDecodeQueue.remove(imagep);
+}
+
 void LLViewerTextureList::updateImagesDecodePriorities()
 {
-	// Update the decode priority for N images each frame
+	// Update the images whose faces changed the most first, so the fetch
+	// order follows the camera within a frame
+	{
+		static const S32 MAX_QUEUED_UPDATES = gSavedSettings.getS32("TextureFetchUpdateQueuedPriorities"); // default: 512
+		S32 update_counter = MAX_QUEUED_UPDATES;
+		LLViewerFetchedTexture* imagep = NULL;
+		while ((update_counter-- > 0) && mDecodeQueue.pop(&imagep))
+		{
+			if (imagep->isInDebug() || imagep->isUnremovable())
+			{
+				continue;
+			}
+			updateImageDecodePriority(imagep);
+		}
+	}
+
+	// Update the decode priority for N images each frame, which also ages
+	// and flushes unused ones
 	{
 		F32 lazy_flush_timeout = 30.f; // stop decoding
 		F32 max_inactive_time  = 20.f; // actually delete
@@ -951,32 +994,38 @@ void LLViewerTextureList::updateImagesDecodePriorities()
 				}
 			}
 
-			if (!imagep->isInImageList())
-			{
-				continue;
-			}
-			if(imagep->isInFastCacheList())
-			{
-				continue; //wait for loading from the fast cache.
-			}
-
-			imagep->processTextureStats();
-			F32 old_priority = imagep->getDecodePriority();
-			F32 old_priority_test = llmax(old_priority, 0.0f);
-			F32 decode_priority = imagep->calcDecodePriority();
-			F32 decode_priority_test = llmax(decode_priority, 0.0f);
-			// Ignore < 20% difference
-			if ((decode_priority_test < old_priority_test * .8f) ||
-				(decode_priority_test > old_priority_test * 1.25f))
-			{
-				removeImageFromList(imagep);
-				imagep->setDecodePriority(decode_priority);
-				addImageToList(imagep);
-			}
+			updateImageDecodePriority(imagep);
 		}
 	}
 }
 
+void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imagep)
+{
+	if (!imagep->isInImageList())
+	{
+		return;
+	}
+	if(imagep->isInFastCacheList())
+	{
+		return; //wait for loading from the fast cache.
+	}
+
+	imagep->processTextureStats();
+	F32 old_priority = imagep->getDecodePriority();
+	F32 old_priority_test = llmax(old_priority, 0.0f);
+	F32 decode_priority = imagep->calcDecodePriority();
+	F32 decode_priority_test = llmax(decode_priority, 0.0f);
+	// Ignore < 20% difference
+	if ((decode_priority_test < old_priority_test * .8f) ||
+		(decode_priority_test > old_priority_test * 1.25f))
+	{
+		removeImageFromList(imagep);
+		imagep->setDecodePriority(decode_priority);
+		addImageToList(imagep);
+	}
+	imagep->updateResolutionWait();
+}
+
 void LLViewerTextureList::setDebugFetching(LLViewerFetchedTexture* tex, S32 debug_level)
 {
 	if(!tex->setDebugFetching(debug_level))
@@ -34,6 +34,7 @@
 #include "llui.h"
 #include <list>
 #include "lluiimage.h"
+#include "llindexedheap.h"
 
 #include "absl/container/flat_hash_map.h"
 
@@ -131,6 +132,12 @@ public:
 	void updateImages(F32 max_time);
 	void forceImmediateUpdate(LLViewerFetchedTexture* imagep) ;
 
+	// Has the image's decode priority recomputed at the next update, ahead
+	// of images queued with less importance, rather than waiting for its
+	// turn in the round-robin.
+	void queueDecodePriorityUpdate(LLViewerFetchedTexture* imagep, F32 importance);
+	void dequeueDecodePriorityUpdate(LLViewerFetchedTexture* imagep);
+
 	// Decode and create textures for all images currently in list.
 	void decodeAllImages(F32 max_decode_time); 
 
@@ -153,6 +160,7 @@ public:
 	
 private:
 	void updateImagesDecodePriorities();
+	void updateImageDecodePriority(LLViewerFetchedTexture* imagep);
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
@@ -232,6 +240,11 @@ private:
 	typedef std::set<LLPointer<LLViewerFetchedTexture>, LLViewerFetchedTexture::Compare> image_priority_list_t;	
 	image_priority_list_t mImageList;
 
+	// Images whose faces changed size enough to need a new decode priority.
+	// Raw pointers, as images take themselves out when deleted.
+	typedef LLIndexedHeap<LLViewerFetchedTexture*> decode_queue_t;
+	decode_queue_t mDecodeQueue;
+
 	// simply holds on to LLViewerFetchedTexture references to stop them from being purged too soon
 	std::set<LLPointer<LLViewerFetchedTexture> > mImagePreloads;
 
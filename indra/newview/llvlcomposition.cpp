@@ -38,6 +38,10 @@
 #include "noise.h"
 #include "llregionhandle.h" // for from_region_handle
 #include "llviewercontrol.h"
+#include "llqueuedthread.h"
+#include "llvector4a.h"
+
+#include <atomic>
 
 
 
@@ -58,84 +62,193 @@ F32 bilinear(const F32 v00, const F32 v01, const F32 v10, const F32 v11, const F
 }
 
 
-LLVLComposition::LLVLComposition(LLSurface *surfacep, const U32 width, const F32 scale) :
-	LLViewerLayer(width, scale),
-	mParamsReady(FALSE)
-{
-	mSurfacep = surfacep;
+static const U32 BASE_SIZE = 128;
 
-	// Load Terrain Textures - Original ones
-	setDetailTextureID(0, TERRAIN_DIRT_DETAIL);
-	setDetailTextureID(1, TERRAIN_GRASS_DETAIL);
-	setDetailTextureID(2, TERRAIN_MOUNTAIN_DETAIL);
-	setDetailTextureID(3, TERRAIN_ROCK_DETAIL);
+//============================================================================
+// Compositing jobs
 
-	// Initialize the texture matrix to defaults.
-	for (S32 i = 0; i < CORNER_COUNT; ++i)
+class LLVLComposition::Job : public LLThreadSafeRefCount
+{
+public:
+	Job(U32 generation)
+	:	mGeneration(generation),
+		mDone(false)
 	{
-		mStartHeight[i] = gSavedSettings.getF32("TerrainColorStartHeight");
-		mHeightRange[i] = gSavedSettings.getF32("TerrainColorHeightRange");
 	}
-	mTexScaleX = 16.f;
-	mTexScaleY = 16.f;
-	mTexturesLoaded = FALSE;
-}
 
+	// On the compositing thread, or the main thread without one
+	void execute()
+	{
+		run();
+		mDone = true;
+	}
 
-void LLVLComposition::setSurface(LLSurface *surfacep)
-{
-	mSurfacep = surfacep;
-}
+	bool isDone() const				{ return mDone; }
 
+	const U32 mGeneration;	// of the parameters the job was made with
 
-void LLVLComposition::setDetailTextureID(S32 corner, const LLUUID& id)
+protected:
+	virtual void run() = 0;
+
+private:
+	std::atomic<bool> mDone;
+};
+
+// Heights are sampled on the main thread, the noise runs on the job.
+class LLVLComposition::HeightJob : public LLVLComposition::Job
 {
-	if(id.isNull())
+public:
+	HeightJob(U32 generation) : Job(generation) {}
+
+	S32 mXBegin;
+	S32 mYBegin;
+	S32 mXEnd;
+	S32 mYEnd;
+	U32 mWidth;
+	F32 mScale;
+	LLVector3d mOriginGlobal;
+	F32 mStartHeight[CORNER_COUNT];
+	F32 mHeightRange[CORNER_COUNT];
+	std::vector<F32> mHeights;	// of the area, row by row
+	std::vector<F32> mValues;	// composition values of the same grid points
+
+protected:
+	void run() override;
+};
+
+// Blends the detail textures of an area into a tile of the surface texture,
+// from a copy of the composition values the area reads.
+class LLVLComposition::TextureJob : public LLVLComposition::Job
+{
+public:
+	TextureJob(U32 generation) : Job(generation), mClaimed(false) {}
+
+	// LLViewerLayer::getValueScaled() over the copied values
+	F32 getValueScaled(const F32 x, const F32 y) const;
+
+	S32 mTexXBegin;
+	S32 mTexYBegin;
+	S32 mTexXEnd;
+	S32 mTexYEnd;
+	F32 mTexXRatio;
+	F32 mTexYRatio;
+	F32 mSTXStride;
+	F32 mSTYStride;
+
+	U32 mWidth;
+	F32 mScaleInv;
+	S32 mWindowX;
+	S32 mWindowY;
+	S32 mWindowWidth;
+	S32 mWindowHeight;
+	std::vector<F32> mWindow;
+
+	LLPointer<LLImageRaw> mDetails[CORNER_COUNT];
+	LLPointer<LLImageRaw> mTile;
+
+	bool mClaimed;	// generateTexture() returned TRUE for it, main thread only
+
+protected:
+	void run() override;
+};
+
+class LLVLComposition::CompositionThread : public LLQueuedThread
+{
+public:
+	class JobRequest : public LLQueuedThread::QueuedRequest
 	{
-		return;
-	}
-	// This is terrain texture, but we are not setting it as BOOST_TERRAIN
-	// since we will be manipulating it later as needed.
-	mDetailTextures[corner] = LLViewerTextureManager::getFetchedTexture(id);
-	mDetailTextures[corner]->setNoDelete() ;
-	mRawImages[corner] = nullptr;
-}
+	protected:
+		virtual ~JobRequest() = default; // use deleteRequest()
 
-BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
-									  const F32 width, const F32 height)
-{
-	if (!mParamsReady)
+	public:
+		JobRequest(handle_t handle, Job* job)
+		:	LLQueuedThread::QueuedRequest(handle, PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+			mJob(job)
+		{
+		}
+
+		bool processRequest() override
+		{
+			mJob->execute();
+			return true;
+		}
+
+	private:
+		friend class CompositionThread;
+
+		LLPointer<Job> mJob;
+	};
+
+	CompositionThread(LLQueuedThreadPool* pool)
+	:	LLQueuedThread("terraincomposition", true, false, pool)
 	{
-		// All the parameters haven't been set yet (we haven't gotten the message from the sim)
-		return FALSE;
 	}
 
-	llassert(mSurfacep);
-
-	if (!mSurfacep || !mSurfacep->getRegion()) 
+	// Returns false once shutting down, the job is left to the caller.
+	bool queue(Job* job)
 	{
-		// We don't always have the region yet here....
-		return FALSE;
+		if (isQuitting())
+		{
+			return false;
+		}
+
+		JobRequest* req = new JobRequest(generateHandle(), job);
+		if (!addRequest(req))
+		{
+			req->deleteRequest();
+			return false;
+		}
+		return true;
 	}
+};
 
-	S32 x_begin, y_begin, x_end, y_end;
+LLVLComposition::CompositionThread* LLVLComposition::sThread = nullptr;
 
-	x_begin = ll_round( x * mScaleInv );
-	y_begin = ll_round( y * mScaleInv );
-	x_end = ll_round( (x + width) * mScaleInv );
-	y_end = ll_round( (y + width) * mScaleInv );
+// static
+void LLVLComposition::initClass(LLQueuedThreadPool* pool)
+{
+	// noise2() builds its tables on the first call, make it here rather
+	// than on the compositing thread while the main thread may be in it.
+	F32 vec[2] = { 0.f, 0.f };
+	noise2(vec);
 
-	if (x_end > mWidth)
+	sThread = new CompositionThread(pool);
+}
+
+// static
+void LLVLComposition::cleanupClass()
+{
+	delete sThread;
+	sThread = nullptr;
+}
+
+// static
+void LLVLComposition::queueJob(Job* job)
+{
+	if (!sThread || !sThread->queue(job))
 	{
-		x_end = mWidth;
+		job->execute();
 	}
-	if (y_end > mWidth)
+}
+
+// Surface heights at the composition grid points of an area, row by row
+static void sample_heights(LLSurface* surfacep, const F32 scale, const S32 x_begin, const S32 y_begin,
+						   const S32 x_end, const S32 y_end, std::vector<F32>& heights)
+{
+	heights.clear();
+	heights.reserve(llmax(0, x_end - x_begin) * llmax(0, y_end - y_begin));
+	for (S32 j = y_begin; j < y_end; j++)
 	{
-		y_end = mWidth;
+		for (S32 i = x_begin; i < x_end; i++)
+		{
+			LLVector3 location(i*scale, j*scale, 0.f);
+			heights.push_back(surfacep->resolveHeightRegion(location));
+		}
 	}
+}
 
-	LLVector3d origin_global = from_region_handle(mSurfacep->getRegion()->getHandle());
-
+void LLVLComposition::HeightJob::run()
+{
 	// For perlin noise generation...
 	const F32 slope_squared = 1.5f*1.5f;
 	const F32 xyScale = 4.9215f; //0.93284f;
@@ -153,10 +266,14 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 
 	const F32 inv_width = 1.f / (F32)mWidth;
 
+	mValues.resize(mHeights.size());
+	auto heightp = mHeights.cbegin();
+	auto valuep = mValues.begin();
+
 	// OK, for now, just have the composition value equal the height at the point.
-	for (S32 j = y_begin; j < y_end; j++)
+	for (S32 j = mYBegin; j < mYEnd; j++)
 	{
-		for (S32 i = x_begin; i < x_end; i++)
+		for (S32 i = mXBegin; i < mXEnd; i++)
 		{
 
 			F32 vec[3];
@@ -177,11 +294,11 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 
 			LLVector3 location(i*mScale, j*mScale, 0.f);
 
-			F32 height = mSurfacep->resolveHeightRegion(location) + z_offset;
+			F32 height = *heightp++ + z_offset;
 
 			// Step 0: Measure the exact height at this texel
-			vec[0] = (F32)(origin_global.mdV[VX]+location.mV[VX])*xyScaleInv;	//  Adjust to non-integer lattice
-			vec[1] = (F32)(origin_global.mdV[VY]+location.mV[VY])*xyScaleInv;
+			vec[0] = (F32)(mOriginGlobal.mdV[VX]+location.mV[VX])*xyScaleInv;	//  Adjust to non-integer lattice
+			vec[1] = (F32)(mOriginGlobal.mdV[VY]+location.mV[VY])*xyScaleInv;
 			vec[2] = height*zScaleInv;
 			//
 			//  Choose material value by adding to the exact height a random value 
@@ -198,13 +315,303 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 
 			scaled_noisy_height = llmax(0.f, scaled_noisy_height);
 			scaled_noisy_height = llmin(3.f, scaled_noisy_height);
-			*(mDatap + i + j*mWidth) = scaled_noisy_height;
+			*valuep++ = scaled_noisy_height;
+		}
+	}
+}
+
+F32 LLVLComposition::TextureJob::getValueScaled(const F32 x, const F32 y) const
+{
+	S32 x1, x2, y1, y2;
+	F32 x_frac, y_frac;
+
+	x_frac = x*mScaleInv;
+	x1 = llfloor(x_frac);
+	x2 = x1 + 1;
+	x_frac -= x1;
+
+	y_frac = y*mScaleInv;
+	y1 = llfloor(y_frac);
+	y2 = y1 + 1;
+	y_frac -= y1;
+
+	// Clamp to the layer as getValueScaled() does, then into the window
+	x1 = llclamp(llclamp(x1, 0, (S32)mWidth-1) - mWindowX, 0, mWindowWidth-1);
+	x2 = llclamp(llclamp(x2, 0, (S32)mWidth-1) - mWindowX, 0, mWindowWidth-1);
+	y1 = llclamp(llclamp(y1, 0, (S32)mWidth-1) - mWindowY, 0, mWindowHeight-1);
+	y2 = llclamp(llclamp(y2, 0, (S32)mWidth-1) - mWindowY, 0, mWindowHeight-1);
+
+	S32 row1 = y1 * mWindowWidth;
+	S32 row2 = y2 * mWindowWidth;
+
+	F32 row1_left  = mWindow[ row1 + x1 ];
+	F32 row1_right = mWindow[ row1 + x2 ];
+	F32 row2_left  = mWindow[ row2 + x1 ];
+	F32 row2_right = mWindow[ row2 + x2 ];
+
+	F32 row1_interp = row1_left - x_frac * (row1_left - row1_right);
+	F32 row2_interp = row2_left - x_frac * (row2_left - row2_right);
+
+	return row1_interp - y_frac * (row1_interp - row2_interp);
+}
+
+// out = from + weight * (to - from), truncated to bytes sixteen at a time.
+// quads is a multiple of 4.
+static void blend_row(const LLVector4a* from, const LLVector4a* to, const LLVector4a* weight,
+					  const S32 quads, U8* out)
+{
+	for (S32 q = 0; q < quads; q += 4, out += 16)
+	{
+		__m128i blended[4];
+		for (S32 k = 0; k < 4; k++)
+		{
+			LLVector4a delta;
+			delta.setSub(to[q + k], from[q + k]);
+			delta.mul(weight[q + k]);
+			delta.add(from[q + k]);
+			blended[k] = _mm_cvttps_epi32(delta);
+		}
+		__m128i low = _mm_packs_epi32(blended[0], blended[1]);
+		__m128i high = _mm_packs_epi32(blended[2], blended[3]);
+		_mm_storeu_si128((__m128i*)out, _mm_packus_epi16(low, high));
+	}
+}
+
+void LLVLComposition::TextureJob::run()
+{
+	const U32 st_comps = 3;
+	const U32 st_width = BASE_SIZE;
+	const U32 st_height = BASE_SIZE;
+
+	const S32 tile_width = mTexXEnd - mTexXBegin;
+	const S32 tile_height = mTexYEnd - mTexYBegin;
+	if (tile_width <= 0 || tile_height <= 0)
+	{
+		return;
+	}
+	mTile = new LLImageRaw(tile_width, tile_height, st_comps);
+	U8* tilep = mTile->getData();
+
+	const U8* st_data[CORNER_COUNT];
+	S32 st_data_size[CORNER_COUNT];
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		st_data[i] = mDetails[i]->getData();
+		st_data_size[i] = mDetails[i]->getDataSize();
+	}
+
+	// Each row gathers the two detail texels and the weight of every
+	// component, then blends them together. The padding stays zero.
+	const S32 row_comps = tile_width * st_comps;
+	const S32 row_quads = (row_comps + 15) / 16 * 4;
+	std::vector<LLVector4a> from(row_quads), to(row_quads), weight(row_quads);
+	for (S32 q = 0; q < row_quads; q++)
+	{
+		from[q].clear();
+		to[q].clear();
+		weight[q].clear();
+	}
+	F32* fromp = from[0].getF32ptr();
+	F32* top = to[0].getF32ptr();
+	F32* weightp = weight[0].getF32ptr();
+	std::vector<U8> row(row_quads * 4);
+
+	////////////////////////////////
+	//
+	// Iterate through the target texture, striding through the
+	// subtextures and interpolating appropriately.
+	//
+	//
+
+	F32 sti, stj;
+	stj = (mTexYBegin * mSTYStride) - st_height*(llfloor((mTexYBegin * mSTYStride)/st_height));
+
+	for (S32 j = mTexYBegin; j < mTexYEnd; j++)
+	{
+		S32 c = 0;
+		sti = (mTexXBegin * mSTXStride) - st_width*((U32)(mTexXBegin * mSTXStride)/st_width);
+		for (S32 i = mTexXBegin; i < mTexXEnd; i++)
+		{
+			S32 tex0, tex1;
+			F32 composition = getValueScaled(i*mTexXRatio, j*mTexYRatio);
+
+			tex0 = llfloor( composition );
+			tex0 = llclamp(tex0, 0, 3);
+			composition -= tex0;
+			tex1 = tex0 + 1;
+			tex1 = llclamp(tex1, 0, 3);
+
+			S32 st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
+			for (U32 k = 0; k < st_comps; k++)
+			{
+				if (st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
+				{
+					// SJB: This shouldn't be happening, but does... Rounding error?
+					fromp[c] = 0.f;
+					top[c] = 0.f;
+					weightp[c] = 0.f;
+				}
+				else
+				{
+					fromp[c] = *(st_data[tex0] + st_offset);
+					top[c] = *(st_data[tex1] + st_offset);
+					weightp[c] = composition;
+				}
+				c++;
+				st_offset++;
+			}
+
+			sti += mSTXStride;
+			if (sti >= st_width)
+			{
+				sti -= st_width;
+			}
+		}
+
+		blend_row(from.data(), to.data(), weight.data(), row_quads, row.data());
+		memcpy(tilep + (j - mTexYBegin) * row_comps, row.data(), row_comps);
+
+		stj += mSTYStride;
+		if (stj >= st_height)
+		{
+			stj -= st_height;
+		}
+	}
+}
+
+//============================================================================
+
+LLVLComposition::LLVLComposition(LLSurface *surfacep, const U32 width, const F32 scale) :
+	LLViewerLayer(width, scale),
+	mParamsReady(FALSE),
+	mGeneration(0)
+{
+	mSurfacep = surfacep;
+
+	// Load Terrain Textures - Original ones
+	setDetailTextureID(0, TERRAIN_DIRT_DETAIL);
+	setDetailTextureID(1, TERRAIN_GRASS_DETAIL);
+	setDetailTextureID(2, TERRAIN_MOUNTAIN_DETAIL);
+	setDetailTextureID(3, TERRAIN_ROCK_DETAIL);
+
+	// Initialize the texture matrix to defaults.
+	for (S32 i = 0; i < CORNER_COUNT; ++i)
+	{
+		mStartHeight[i] = gSavedSettings.getF32("TerrainColorStartHeight");
+		mHeightRange[i] = gSavedSettings.getF32("TerrainColorHeightRange");
+	}
+	mTexScaleX = 16.f;
+	mTexScaleY = 16.f;
+	mTexturesLoaded = FALSE;
+}
+
+LLVLComposition::~LLVLComposition()
+{
+	// Jobs still running hold on to themselves and finish unseen
+}
+
+
+void LLVLComposition::setSurface(LLSurface *surfacep)
+{
+	mSurfacep = surfacep;
+}
+
+
+void LLVLComposition::setDetailTextureID(S32 corner, const LLUUID& id)
+{
+	if(id.isNull())
+	{
+		return;
+	}
+	// This is terrain texture, but we are not setting it as BOOST_TERRAIN
+	// since we will be manipulating it later as needed.
+	mDetailTextures[corner] = LLViewerTextureManager::getFetchedTexture(id);
+	mDetailTextures[corner]->setNoDelete() ;
+	mRawImages[corner] = nullptr;
+	dirtyJobs();
+}
+
+BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
+									  const F32 width, const F32 height)
+{
+	if (!mParamsReady)
+	{
+		// All the parameters haven't been set yet (we haven't gotten the message from the sim)
+		return FALSE;
+	}
+
+	llassert(mSurfacep);
+
+	if (!mSurfacep || !mSurfacep->getRegion()) 
+	{
+		// We don't always have the region yet here....
+		return FALSE;
+	}
+
+	S32 x_begin, y_begin, x_end, y_end;
+
+	x_begin = ll_round( x * mScaleInv );
+	y_begin = ll_round( y * mScaleInv );
+	x_end = ll_round( (x + width) * mScaleInv );
+	y_end = ll_round( (y + width) * mScaleInv );
+
+	if (x_end > mWidth)
+	{
+		x_end = mWidth;
+	}
+	if (y_end > mWidth)
+	{
+		y_end = mWidth;
+	}
+
+	std::vector<F32> heights;
+	sample_heights(mSurfacep, mScale, x_begin, y_begin, x_end, y_end, heights);
+
+	area_t area(x_begin, y_begin);
+	auto iter = mHeightJobs.find(area);
+	if (iter == mHeightJobs.end())
+	{
+		LLPointer<HeightJob> job = new HeightJob(mGeneration);
+		job->mXBegin = x_begin;
+		job->mYBegin = y_begin;
+		job->mXEnd = x_end;
+		job->mYEnd = y_end;
+		job->mWidth = mWidth;
+		job->mScale = mScale;
+		job->mOriginGlobal = from_region_handle(mSurfacep->getRegion()->getHandle());
+		for (S32 i = 0; i < CORNER_COUNT; i++)
+		{
+			job->mStartHeight[i] = mStartHeight[i];
+			job->mHeightRange[i] = mHeightRange[i];
 		}
+		job->mHeights = heights;
+		iter = mHeightJobs.emplace(area, job).first;
+		queueJob(job);
 	}
+
+	HeightJob* job = iter->second;
+	if (!job->isDone())
+	{
+		return FALSE;
+	}
+	if (job->mGeneration != mGeneration || job->mHeights != heights)
+	{
+		// The surface or the parameters changed meanwhile, start over
+		mHeightJobs.erase(iter);
+		return FALSE;
+	}
+
+	for (S32 j = y_begin, k = 0; j < y_end; j++)
+	{
+		for (S32 i = x_begin; i < x_end; i++)
+		{
+			*(mDatap + i + j*mWidth) = job->mValues[k++];
+		}
+	}
+	mHeightJobs.erase(iter);
 	return TRUE;
 }
 
-static const U32 BASE_SIZE = 128;
 
 BOOL LLVLComposition::generateComposition()
 {
@@ -246,6 +653,52 @@ BOOL LLVLComposition::generateComposition()
 	return TRUE;
 }
 
+BOOL LLVLComposition::getTextureArea(const F32 x, const F32 y, const F32 width,
+									 S32& tex_x_begin, S32& tex_y_begin,
+									 S32& tex_x_end, S32& tex_y_end) const
+{
+	///////////////////////////////////////
+	//
+	// Generate and clamp x/y bounding box.
+	//
+	//
+
+	S32 x_begin, y_begin, x_end, y_end;
+	x_begin = (S32)(x * mScaleInv);
+	y_begin = (S32)(y * mScaleInv);
+	x_end = ll_round( (x + width) * mScaleInv );
+	y_end = ll_round( (y + width) * mScaleInv );
+
+	if (x_end > mWidth)
+	{
+		LL_WARNS("Terrain") << "x end > width" << LL_ENDL;
+		x_end = mWidth;
+	}
+	if (y_end > mWidth)
+	{
+		LL_WARNS("Terrain") << "y end > width" << LL_ENDL;
+		y_end = mWidth;
+	}
+
+	LLViewerTexture *texturep = mSurfacep->getSTexture();
+	U32 tex_width = texturep->getWidth();
+	U32 tex_height = texturep->getHeight();
+
+	if (texturep->getComponents() != 3)
+	{
+		LL_WARNS("Terrain") << "Base texture comps != input texture comps" << LL_ENDL;
+		return FALSE;
+	}
+
+	F32 tex_x_scalef = (F32)tex_width / (F32)mWidth;
+	F32 tex_y_scalef = (F32)tex_height / (F32)mWidth;
+	tex_x_begin = (S32)((F32)x_begin * tex_x_scalef);
+	tex_y_begin = (S32)((F32)y_begin * tex_y_scalef);
+	tex_x_end = (S32)((F32)x_end * tex_x_scalef);
+	tex_y_end = (S32)((F32)y_end * tex_y_scalef);
+	return TRUE;
+}
+
 BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 									  const F32 width, const F32 height)
 {
@@ -253,7 +706,29 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	llassert(x >= 0.f);
 	llassert(y >= 0.f);
 
-	LLTimer gen_timer;
+	S32 tex_x_begin, tex_y_begin, tex_x_end, tex_y_end;
+	if (!getTextureArea(x, y, width, tex_x_begin, tex_y_begin, tex_x_end, tex_y_end))
+	{
+		return FALSE;
+	}
+
+	area_t area(tex_x_begin, tex_y_begin);
+	auto iter = mTextureJobs.find(area);
+	if (iter != mTextureJobs.end())
+	{
+		TextureJob* job = iter->second;
+		if (job->mGeneration == mGeneration && !job->mClaimed)
+		{
+			if (!job->isDone())
+			{
+				return FALSE;
+			}
+			job->mClaimed = true;
+			return TRUE;
+		}
+		// Stale, or asked for again since it was done, composite it anew
+		mTextureJobs.erase(iter);
+	}
 
 	///////////////////////////
 	//
@@ -262,9 +737,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	//
 
 	// These have already been validated by generateComposition.
-	U8* st_data[4];
-	S32 st_data_size[4]; // for debugging
-
 	for (S32 i = 0; i < 4; i++)
 	{
 		if (mRawImages[i].isNull())
@@ -302,158 +774,132 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 				newraw->composite(mRawImages[i]);
 				mRawImages[i] = newraw; // deletes old
 			}
+			else
+			{
+				// The texture may write to its own raw image while a job reads it
+				mRawImages[i] = new LLImageRaw(mRawImages[i]->getData(), BASE_SIZE, BASE_SIZE, 3);
+			}
 		}
-		st_data[i] = mRawImages[i]->getData();
-		st_data_size[i] = mRawImages[i]->getDataSize();
 	}
 
-	///////////////////////////////////////
-	//
-	// Generate and clamp x/y bounding box.
-	//
-	//
-
-	S32 x_begin, y_begin, x_end, y_end;
-	x_begin = (S32)(x * mScaleInv);
-	y_begin = (S32)(y * mScaleInv);
-	x_end = ll_round( (x + width) * mScaleInv );
-	y_end = ll_round( (y + width) * mScaleInv );
-
-	if (x_end > mWidth)
-	{
-		LL_WARNS("Terrain") << "x end > width" << LL_ENDL;
-		x_end = mWidth;
-	}
-	if (y_end > mWidth)
-	{
-		LL_WARNS("Terrain") << "y end > width" << LL_ENDL;
-		y_end = mWidth;
-	}
-
-
 	///////////////////////////////////////////
 	//
 	// Generate target texture information, stride ratios.
 	//
 	//
 
-	LLViewerTexture *texturep;
-	U32 tex_width, tex_height, tex_comps;
-	U32 tex_stride;
-	F32 tex_x_scalef, tex_y_scalef;
-	S32 tex_x_begin, tex_y_begin, tex_x_end, tex_y_end;
-	F32 tex_x_ratiof, tex_y_ratiof;
-
-	texturep = mSurfacep->getSTexture();
-	tex_width = texturep->getWidth();
-	tex_height = texturep->getHeight();
-	tex_comps = texturep->getComponents();
-	tex_stride = tex_width * tex_comps;
+	LLViewerTexture *texturep = mSurfacep->getSTexture();
+	U32 tex_width = texturep->getWidth();
+	U32 tex_height = texturep->getHeight();
 
-	U32 st_comps = 3;
 	U32 st_width = BASE_SIZE;
 	U32 st_height = BASE_SIZE;
-	
-	if (tex_comps != st_comps)
+
+	LLPointer<TextureJob> job = new TextureJob(mGeneration);
+	job->mTexXBegin = tex_x_begin;
+	job->mTexYBegin = tex_y_begin;
+	job->mTexXEnd = tex_x_end;
+	job->mTexYEnd = tex_y_end;
+	job->mTexXRatio = (F32)mWidth*mScale / (F32)tex_width;
+	job->mTexYRatio = (F32)mWidth*mScale / (F32)tex_height;
+
+	job->mSTXStride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
+	job->mSTYStride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
+	llassert(job->mSTXStride > 0.f);
+	llassert(job->mSTYStride > 0.f);
+
+	// The composition values the area samples, the one past the last for
+	// the interpolation included
+	job->mWidth = mWidth;
+	job->mScaleInv = mScaleInv;
+	S32 last = (S32)mWidth - 1;
+	job->mWindowX = llclamp(llfloor(tex_x_begin*job->mTexXRatio*mScaleInv), 0, last);
+	job->mWindowY = llclamp(llfloor(tex_y_begin*job->mTexYRatio*mScaleInv), 0, last);
+	S32 window_x_end = llclamp(llfloor((tex_x_end - 1)*job->mTexXRatio*mScaleInv) + 1, job->mWindowX, last);
+	S32 window_y_end = llclamp(llfloor((tex_y_end - 1)*job->mTexYRatio*mScaleInv) + 1, job->mWindowY, last);
+	job->mWindowWidth = window_x_end - job->mWindowX + 1;
+	job->mWindowHeight = window_y_end - job->mWindowY + 1;
+	job->mWindow.reserve(job->mWindowWidth * job->mWindowHeight);
+	for (S32 j = job->mWindowY; j <= window_y_end; j++)
 	{
-		LL_WARNS("Terrain") << "Base texture comps != input texture comps" << LL_ENDL;
-		return FALSE;
+		const F32* rowp = mDatap + j*mWidth;
+		job->mWindow.insert(job->mWindow.end(), rowp + job->mWindowX, rowp + window_x_end + 1);
 	}
 
-	tex_x_scalef = (F32)tex_width / (F32)mWidth;
-	tex_y_scalef = (F32)tex_height / (F32)mWidth;
-	tex_x_begin = (S32)((F32)x_begin * tex_x_scalef);
-	tex_y_begin = (S32)((F32)y_begin * tex_y_scalef);
-	tex_x_end = (S32)((F32)x_end * tex_x_scalef);
-	tex_y_end = (S32)((F32)y_end * tex_y_scalef);
-
-	tex_x_ratiof = (F32)mWidth*mScale / (F32)tex_width;
-	tex_y_ratiof = (F32)mWidth*mScale / (F32)tex_height;
-
-	LLPointer<LLImageRaw> raw = new LLImageRaw(tex_width, tex_height, tex_comps);
-	U8 *rawp = raw->getData();
-
-	F32 st_x_stride, st_y_stride;
-	st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
-	st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		job->mDetails[i] = mRawImages[i];
+	}
 
-	llassert(st_x_stride > 0.f);
-	llassert(st_y_stride > 0.f);
-	////////////////////////////////
-	//
-	// Iterate through the target texture, striding through the
-	// subtextures and interpolating appropriately.
-	//
-	//
+	iter = mTextureJobs.emplace(area, job).first;
+	queueJob(job);
 
-	F32 sti, stj;
-	S32 st_offset;
-	sti = (tex_x_begin * st_x_stride) - st_width*(llfloor((tex_x_begin * st_x_stride)/st_width));
-	stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
+	for (auto& detail_texture : mDetailTextures)
+    {
+		// Un-boost detail textures (will get re-boosted if rendering in high detail)
+        detail_texture->setBoostLevel(LLGLTexture::BOOST_NONE);
+        detail_texture->setMinDiscardLevel(MAX_DISCARD_LEVEL + 1);
+	}
 
-	st_offset = (llfloor(stj * st_width) + llfloor(sti)) * st_comps;
-	for (S32 j = tex_y_begin; j < tex_y_end; j++)
+	if (!job->isDone())
 	{
-		U32 offset = j * tex_stride + tex_x_begin * tex_comps;
-		sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
-		for (S32 i = tex_x_begin; i < tex_x_end; i++)
-		{
-			S32 tex0, tex1;
-			F32 composition = getValueScaled(i*tex_x_ratiof, j*tex_y_ratiof);
+		return FALSE;
+	}
+	job->mClaimed = true;
+	return TRUE;
+}
 
-			tex0 = llfloor( composition );
-			tex0 = llclamp(tex0, 0, 3);
-			composition -= tex0;
-			tex1 = tex0 + 1;
-			tex1 = llclamp(tex1, 0, 3);
+BOOL LLVLComposition::uploadTexture(const F32 x, const F32 y,
+									const F32 width, const F32 height)
+{
+	S32 tex_x_begin, tex_y_begin, tex_x_end, tex_y_end;
+	if (!getTextureArea(x, y, width, tex_x_begin, tex_y_begin, tex_x_end, tex_y_end))
+	{
+		return FALSE;
+	}
 
-			st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
-			for (U32 k = 0; k < tex_comps; k++)
-			{
-				// Linearly interpolate based on composition.
-				if (st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
-				{
-					// SJB: This shouldn't be happening, but does... Rounding error?
-					//LL_WARNS() << "offset 0 [" << tex0 << "] =" << st_offset << " >= size=" << st_data_size[tex0] << LL_ENDL;
-					//LL_WARNS() << "offset 1 [" << tex1 << "] =" << st_offset << " >= size=" << st_data_size[tex1] << LL_ENDL;
-				}
-				else
-				{
-					F32 a = *(st_data[tex0] + st_offset);
-					F32 b = *(st_data[tex1] + st_offset);
-					rawp[ offset ] = (U8)lltrunc( a + composition * (b - a) );
-				}
-				offset++;
-				st_offset++;
-			}
+	auto iter = mTextureJobs.find(area_t(tex_x_begin, tex_y_begin));
+	if (iter == mTextureJobs.end() || !iter->second->isDone())
+	{
+		return FALSE;
+	}
+	LLPointer<TextureJob> job = iter->second;
+	mTextureJobs.erase(iter);
+	if (job->mGeneration != mGeneration)
+	{
+		return FALSE;
+	}
 
-			sti += st_x_stride;
-			if (sti >= st_width)
-			{
-				sti -= st_width;
-			}
-		}
+	LLViewerTexture *texturep = mSurfacep->getSTexture();
+	S32 tex_width = texturep->getWidth();
+	S32 tex_height = texturep->getHeight();
+	S32 tex_comps = texturep->getComponents();
+	if (mCompositeImage.isNull()
+		|| mCompositeImage->getWidth() != tex_width
+		|| mCompositeImage->getHeight() != tex_height)
+	{
+		mCompositeImage = new LLImageRaw(tex_width, tex_height, tex_comps);
+		mCompositeImage->clear(128, 128, 128);
+	}
 
-		stj += st_y_stride;
-		if (stj >= st_height)
+	if (job->mTile.notNull())
+	{
+		const S32 row_bytes = job->mTile->getWidth() * tex_comps;
+		const U8* tilep = job->mTile->getData();
+		U8* rawp = mCompositeImage->getData() + (tex_y_begin * tex_width + tex_x_begin) * tex_comps;
+		for (S32 j = 0; j < job->mTile->getHeight(); j++)
 		{
-			stj -= st_height;
+			memcpy(rawp, tilep, row_bytes);
+			rawp += tex_width * tex_comps;
+			tilep += row_bytes;
 		}
 	}
 
 	if (!texturep->hasGLTexture())
 	{
-		texturep->createGLTexture(0, raw);
+		texturep->createGLTexture(0, mCompositeImage);
 	}
-	texturep->setSubImage(raw, tex_x_begin, tex_y_begin, tex_x_end - tex_x_begin, tex_y_end - tex_y_begin);
-
-	for (auto& detail_texture : mDetailTextures)
-    {
-		// Un-boost detail textures (will get re-boosted if rendering in high detail)
-        detail_texture->setBoostLevel(LLGLTexture::BOOST_NONE);
-        detail_texture->setMinDiscardLevel(MAX_DISCARD_LEVEL + 1);
-	}
-	
+	texturep->setSubImage(mCompositeImage, tex_x_begin, tex_y_begin, tex_x_end - tex_x_begin, tex_y_end - tex_y_begin);
 	return TRUE;
 }
 
@@ -475,6 +921,7 @@ F32 LLVLComposition::getStartHeight(S32 corner)
 void LLVLComposition::setStartHeight(S32 corner, const F32 start_height)
 {
 	mStartHeight[corner] = start_height;
+	dirtyJobs();
 }
 
 F32 LLVLComposition::getHeightRange(S32 corner)
@@ -485,4 +932,5 @@ F32 LLVLComposition::getHeightRange(S32 corner)
 void LLVLComposition::setHeightRange(S32 corner, const F32 range)
 {
 	mHeightRange[corner] = range;
+	dirtyJobs();
 }
@@ -30,21 +30,36 @@
 #include "llviewerlayer.h"
 #include "llviewertexture.h"
 
+#include <map>
+
 class LLSurface;
+class LLQueuedThreadPool;
 
+// Heights and textures are composited on a background thread. The calls
+// below queue the work for an area the first time they are made for it,
+// and return TRUE from the call that finds it done, so callers keep asking
+// once a frame until then.
 class LLVLComposition final : public LLViewerLayer
 {
 public:
 	LLVLComposition(LLSurface *surfacep, const U32 width, const F32 scale);
-	/*virtual*/ ~LLVLComposition() = default;
+	/*virtual*/ ~LLVLComposition();
+
+	// Starts the compositing thread, on pool if there is one. Without it
+	// everything is composited in the calls below, on the main thread.
+	static void initClass(LLQueuedThreadPool* pool);
+	static void cleanupClass();
 
 	void setSurface(LLSurface *surfacep);
 
 	// Viewer side hack to generate composition values
 	BOOL generateHeights(const F32 x, const F32 y, const F32 width, const F32 height);
 	BOOL generateComposition();
-	// Generate texture from composition values.
+	// Generate texture from composition values, the tile is ready for
+	// uploadTexture() once this returns TRUE.
 	BOOL generateTexture(const F32 x, const F32 y, const F32 width, const F32 height);		
+	// Uploads the tile generateTexture() made for the same area, GL thread.
+	BOOL uploadTexture(const F32 x, const F32 y, const F32 width, const F32 height);
 
 	// Use these as indeces ito the get/setters below that use 'corner'
 	enum ECorner
@@ -69,10 +84,35 @@ public:
 	void setParamsReady()		{ mParamsReady = TRUE; }
 	BOOL getParamsReady() const	{ return mParamsReady; }
 protected:
+	class Job;
+	class HeightJob;
+	class TextureJob;
+	class CompositionThread;
+
+	// Runs job on the compositing thread, or right away without one.
+	static void queueJob(Job* job);
+	// The texels of the surface texture covering an area of the region
+	BOOL getTextureArea(const F32 x, const F32 y, const F32 width, S32& tex_x_begin, S32& tex_y_begin,
+						S32& tex_x_end, S32& tex_y_end) const;
+	// Drops the results that no longer match the parameters.
+	void dirtyJobs()			{ ++mGeneration; }
+
 	BOOL mParamsReady;
 	LLSurface *mSurfacep;
 	BOOL mTexturesLoaded;
 
+	// Work in progress or done and not yet picked up, by first texel
+	typedef std::pair<S32, S32> area_t;
+	std::map<area_t, LLPointer<HeightJob> > mHeightJobs;
+	std::map<area_t, LLPointer<TextureJob> > mTextureJobs;
+	U32 mGeneration;
+
+	// setSubImage() reads rows as long as the surface texture, so tiles are
+	// copied into this image the size of it before they are uploaded.
+	LLPointer<LLImageRaw> mCompositeImage;
+
+	static CompositionThread* sThread;
+
 	LLPointer<LLViewerFetchedTexture> mDetailTextures[CORNER_COUNT];
 	LLPointer<LLImageRaw> mRawImages[CORNER_COUNT];
 
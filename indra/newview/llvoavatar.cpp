@@ -47,6 +47,7 @@
 #include "llagent.h" //  Get state values from here
 #include "llagentcamera.h"
 #include "llagentwearables.h"
+#include "llanimationstage.h"
 #include "llanimationstates.h"
 #include "llaoengine.h"
 #include "llavatarnamecache.h"
@@ -617,6 +618,8 @@ F32 LLVOAvatar::sLODFactor = 1.f;
 F32 LLVOAvatar::sPhysicsLODFactor = 1.f;
 bool LLVOAvatar::sUseImpostors = false; // overwridden by RenderAvatarMaxNonImpostors
 BOOL LLVOAvatar::sJointDebug = FALSE;
+bool LLVOAvatar::sAnimationStageOpen = false;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sStagedAvatars;
 F32 LLVOAvatar::sUnbakedTime = 0.f;
 F32 LLVOAvatar::sUnbakedUpdateTime = 0.f;
 F32 LLVOAvatar::sGreyTime = 0.f;
@@ -686,6 +689,7 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mUseServerBakes(FALSE),
 	mVisibleChat(FALSE),
 	mTurning(FALSE),
+	mWasSitGroundConstrained(false),
 	mIsSitting(FALSE),
 	mNameIsSet(false),
 	mTitle(),
@@ -2560,8 +2564,28 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 	// animate the character
 	// store off last frame's root position to be consistent with camera position
 	mLastRootPos = mRoot->getWorldPosition();
+
+	// Self keeps to its own updateCharacter(), and joint debugging counts
+	// the joints of one avatar at a time
+	if (sAnimationStageOpen && !isSelf() && !sJointDebug)
+	{
+		if (beginCharacterUpdate(agent))
+		{
+			sStagedAvatars.push_back(this);
+		}
+		else
+		{
+			finishIdleUpdate(FALSE);
+		}
+		return;
+	}
+
 	BOOL detailed_update = updateCharacter(agent);
+	finishIdleUpdate(detailed_update);
+}
 
+void LLVOAvatar::finishIdleUpdate(BOOL detailed_update)
+{
 	static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
 	bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
 						 LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -2581,6 +2605,47 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 	idleUpdateRenderComplexity();
 }
 
+// static
+void LLVOAvatar::beginAnimationStage()
+{
+	sAnimationStageOpen = true;
+}
+
+static LLTrace::BlockTimerStatHandle FTM_AVATAR_ANIMATION_STAGE("Avatar Animation Stage");
+
+// static
+void LLVOAvatar::endAnimationStage()
+{
+	sAnimationStageOpen = false;
+	if (sStagedAvatars.empty())
+	{
+		return;
+	}
+	LL_RECORD_BLOCK_TIME(FTM_AVATAR_ANIMATION_STAGE);
+
+	static LLAnimationStage stage;
+	for (LLVOAvatar* avatar : sStagedAvatars)
+	{
+		if (!avatar->isDead())
+		{
+			stage.add(avatar);
+		}
+	}
+	stage.evaluate(stage.getDefaultRuns());
+	stage.clear();
+
+	// Back on the main thread, in the order the avatars were staged
+	for (LLVOAvatar* avatar : sStagedAvatars)
+	{
+		if (!avatar->isDead())
+		{
+			avatar->endCharacterUpdate();
+			avatar->finishIdleUpdate(TRUE);
+		}
+	}
+	sStagedAvatars.clear();
+}
+
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
 {
 	bool render_visualizer = voice_enabled;
@@ -4380,6 +4445,21 @@ void LLVOAvatar::updateRootPositionAndRotation(LLAgent& agent, F32 speed, bool w
 //
 //------------------------------------------------------------------------
 BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
+{
+	if (!beginCharacterUpdate(agent))
+	{
+		return FALSE;
+	}
+	evaluatePose();
+	endCharacterUpdate();
+	return TRUE;
+}
+
+//------------------------------------------------------------------------
+// beginCharacterUpdate()
+// Everything up to evaluating the motions, main thread only
+//------------------------------------------------------------------------
+BOOL LLVOAvatar::beginCharacterUpdate(LLAgent &agent)
 {	
 	updateDebugText();
 	
@@ -4456,6 +4536,7 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// remembering the value here prevents a display glitch if the
 	// animation gets toggled during this update.
 	bool was_sit_ground_constrained = isMotionActive(ANIM_AGENT_SIT_GROUND_CONSTRAINED);
+	mWasSitGroundConstrained = was_sit_ground_constrained;
 
 	//--------------------------------------------------------------------
     // This does a bunch of state updating, including figuring out
@@ -4474,15 +4555,27 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// update animations
 	if (mSpecialRenderMode == 1) // Animation Preview
 	{
-		updateMotions(LLCharacter::FORCE_UPDATE);
+		beginUpdateMotions(LLCharacter::FORCE_UPDATE);
 	}
 	else
 	{
-		updateMotions(LLCharacter::NORMAL_UPDATE);
+		beginUpdateMotions(LLCharacter::NORMAL_UPDATE);
 	}
 
+	return TRUE;
+}
+
+//------------------------------------------------------------------------
+// evaluatePose()
+// Motions, and the joints they move. Touches nothing outside this avatar,
+// so the poses of many avatars can be evaluated at once.
+//------------------------------------------------------------------------
+void LLVOAvatar::evaluatePose()
+{
+	evaluateMotions();
+
 	// Special handling for sitting on ground.
-	if (!getParent() && (isSitting() || was_sit_ground_constrained))
+	if (!getParent() && (isSitting() || mWasSitGroundConstrained))
 	{
 		
 		F32 off_z = getHoverOffset().mV[VZ];
@@ -4496,19 +4589,30 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 		}
 	}
 
+	// Update child joints as needed.
+	mRoot->updateWorldMatrixChildren();
+}
+
+//------------------------------------------------------------------------
+// endCharacterUpdate()
+// What follows the pose, main thread only
+//------------------------------------------------------------------------
+void LLVOAvatar::endCharacterUpdate()
+{
+	// Visual params the motions changed may move joints too
+	if (endUpdateMotions())
+	{
+		mRoot->updateWorldMatrixChildren();
+	}
+
 	// update head position
 	updateHeadOffset();
 
 	// Generate footstep sounds when feet hit the ground
     updateFootstepSounds();
 
-	// Update child joints as needed.
-	mRoot->updateWorldMatrixChildren();
-
 	// System avatar mesh vertices need to be reskinned.
 	mNeedsSkin = TRUE;
-
-	return TRUE;
 }
 
 //-----------------------------------------------------------------------------
@@ -264,6 +264,14 @@ public:
 	void 			updateAnimationDebugText();
 	virtual void	updateDebugText();
 	virtual BOOL 	updateCharacter(LLAgent &agent);
+	// updateCharacter() in the steps the animation stage takes it in.
+	// beginCharacterUpdate() returns FALSE when the pose is not evaluated
+	// this frame, which ends the update.
+	BOOL			beginCharacterUpdate(LLAgent &agent);
+	/*virtual*/ void evaluatePose() override;
+	void			endCharacterUpdate();
+	// The rest of idleUpdate() after updateCharacter()
+	void			finishIdleUpdate(BOOL detailed_update);
     void			updateFootstepSounds();
     void			computeUpdatePeriod();
     void			updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
@@ -332,6 +340,15 @@ public:
 	static BOOL		sJointDebug; // output total number of joints being touched for each avatar
 	static BOOL		sDebugAvatarRotation;
 
+	// While the animation stage is open, avatars other than self put off
+	// evaluating their pose, and the rest of their idle update, until it
+	// ends. Their poses are then evaluated all at once over several threads.
+	static void		beginAnimationStage();
+	static void		endAnimationStage();
+private:
+	static bool		sAnimationStageOpen;
+	static std::vector<LLPointer<LLVOAvatar> > sStagedAvatars;
+
 	//--------------------------------------------------------------------
 	// Region state
 	//--------------------------------------------------------------------
@@ -908,6 +925,7 @@ private:
 	F32 		mSpeedAccum; // measures speed (for diagnostics mostly).
 	BOOL 		mTurning; // controls hysteresis on avatar rotation
 	F32			mSpeed; // misc. animation repeated state
+	bool		mWasSitGroundConstrained; // over the steps of updateCharacter()
 
 	//--------------------------------------------------------------------
 	// Dimensions
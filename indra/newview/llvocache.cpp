@@ -35,6 +35,8 @@
 #include "pipeline.h"
 #include "llagentcamera.h"
 #include "llmemory.h"
+#include "llmappedfile.h"
+#include "llqueuedthread.h"
 
 //static variables
 U32 LLVOCacheEntry::sMinFrameRange = 0;
@@ -59,6 +61,18 @@ BOOL check_write(LLAPRFile* apr_file, void* src, S32 n_bytes)
 // LLVOCacheEntry
 //---------------------------------------------------------------------------
 
+// Fixed part of an entry in a region cache file, followed by mDataSize bytes
+// of the object update. Entries are packed back to back.
+struct LLVOCacheEntryRecord
+{
+	U32 mLocalID;
+	U32 mCRC;
+	S32 mHitCount;
+	S32 mDupeCount;
+	S32 mCRCChangeCount;
+	S32 mDataSize;
+};
+
 LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp)
 :	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
 	LLTrace::MemTrackable<LLVOCacheEntry, 16>("LLVOCacheEntry"),
@@ -100,81 +114,54 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(const U8*& data, const U8* end)
 :	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
 	LLTrace::MemTrackable<LLVOCacheEntry, 16>("LLVOCacheEntry"), 
 	mLastCameraUpdated(0),
+	mLocalID(0),
 	mParentID(0),
+	mCRC(0),
 	mUpdateFlags(static_cast<U32>(-1)),
+	mHitCount(0),
+	mDupeCount(0),
+	mCRCChangeCount(0),
 	mBuffer(nullptr),
 	mSceneContrib(0.f),
 	mState(INACTIVE),
 	mValid(FALSE),
 	mBSphereRadius(-1.0f)
 {
-	S32 size = -1;
-	BOOL success;
-
 	mDP.assignBuffer(mBuffer, 0);
-	
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
 
-		// Corruption in the cache entries
-		if ((size > 10000) || (size < 1))
-		{
-			// We've got a bogus size, skip reading it.
-			// We won't bother seeking, because the rest of this file
-			// is likely bogus, and will be tossed anyway.
-			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
+	LLVOCacheEntryRecord record;
+	if (end - data < (S32)sizeof(LLVOCacheEntryRecord))
 	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = nullptr ;
-		}
+		LL_WARNS() << "Truncated cache entry, aborting!" << LL_ENDL;
+		return;
 	}
+	memcpy(&record, data, sizeof(LLVOCacheEntryRecord)); // records are not aligned
 
-	if(!success)
+	// Corruption in the cache entries
+	S32 size = record.mDataSize;
+	if ((size > 10000) || (size < 1) || (end - data - (S32)sizeof(LLVOCacheEntryRecord) < size))
 	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = nullptr;
-		mEntry = nullptr;
-		mState = INACTIVE;
+		// We've got a bogus size, the rest of this file
+		// is likely bogus, and will be tossed anyway.
+		LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
+		return;
 	}
+	data += sizeof(LLVOCacheEntryRecord);
+
+	mLocalID = record.mLocalID;
+	mCRC = record.mCRC;
+	mHitCount = record.mHitCount;
+	mDupeCount = record.mDupeCount;
+	mCRCChangeCount = record.mCRCChangeCount;
+
+	mBuffer = new U8[size];
+	memcpy(mBuffer, data, size);
+	mDP.assignBuffer(mBuffer, size);
+	data += size;
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -348,38 +335,23 @@ void LLVOCacheEntry::dump() const
 		<< LL_ENDL;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
+void LLVOCacheEntry::writeToBuffer(std::vector<U8>& buffer) const
 {
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
+	LLVOCacheEntryRecord record;
+	record.mLocalID = mLocalID;
+	record.mCRC = mCRC;
+	record.mHitCount = mHitCount;
+	record.mDupeCount = mDupeCount;
+	record.mCRCChangeCount = mCRCChangeCount;
+	record.mDataSize = mDP.getBufferSize();
+
+	size_t offset = buffer.size();
+	buffer.resize(offset + sizeof(LLVOCacheEntryRecord) + record.mDataSize);
+	memcpy(&buffer[offset], &record, sizeof(LLVOCacheEntryRecord));
+	if (record.mDataSize > 0)
 	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
-		{
-			success = check_write(apr_file, (void*)mBuffer, size);
-		}
+		memcpy(&buffer[offset + sizeof(LLVOCacheEntryRecord)], mBuffer, record.mDataSize);
 	}
-
-	return success ;
 }
 
 //static 
@@ -1061,6 +1033,245 @@ void LLVOCachePartition::removeOccluder(LLVOCacheGroup* group)
 	}
 	mOccludedGroups.erase(group);
 }
+//-------------------------------------------------------------------
+//LLVOCacheThread
+//-------------------------------------------------------------------
+// Reads and writes the region cache files. Requests run one at a time in
+// the order they were queued, so a read sees every write queued before it.
+
+// Header of a region cache file, followed by mEntryCount entries in
+// mDataSize bytes.
+struct LLVOCacheFileHeader
+{
+	U32 mMagic;
+	U32 mEntryCount;
+	U32 mDataSize;
+	U32 mPad;
+	LLUUID mCacheID;
+};
+
+static const U32 REGION_CACHE_MAGIC = 0x434f564c; // "LVOC"
+
+class LLVOCacheThread final : public LLQueuedThread
+{
+public:
+	class ReadRequest final : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		~ReadRequest() = default; // use deleteRequest()
+
+	public:
+		ReadRequest(handle_t handle, const std::string& filename);
+
+		/*virtual*/ bool processRequest() override;
+
+		// input
+		const std::string mFilename;
+		// output, null if the file could not be read
+		LLUUID mCacheID;
+		LLVOCacheEntry::vocache_entry_map_t mEntries;
+		bool mSuccess;
+	};
+
+	class FileRequest final : public LLQueuedThread::QueuedRequest
+	{
+	public:
+		enum EOperation
+		{
+			WRITE,		// replace the file with mData
+			WRITE_AT,	// overwrite mData.size() bytes at mOffset
+			REMOVE
+		};
+
+	protected:
+		~FileRequest() = default; // use deleteRequest()
+
+	public:
+		FileRequest(handle_t handle, EOperation operation, const std::string& filename,
+					S32 offset, std::vector<U8>& data);
+
+		/*virtual*/ bool processRequest() override;
+
+	private:
+		const EOperation mOperation;
+		const std::string mFilename;
+		const S32 mOffset;
+		std::vector<U8> mData;
+	};
+
+public:
+	LLVOCacheThread() : LLQueuedThread("vocache") {}
+
+	handle_t read(const std::string& filename);
+	// Takes the result of a read, waiting for it if needed. Returns false
+	// if the file was missing, damaged or written for another cache id.
+	bool takeRead(handle_t handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	void discardRead(handle_t handle);
+
+	// These take data over, the request deletes itself when done.
+	void write(const std::string& filename, std::vector<U8>& data);
+	void writeAt(const std::string& filename, S32 offset, std::vector<U8>& data);
+	void remove(const std::string& filename);
+};
+
+LLVOCacheThread::ReadRequest::ReadRequest(handle_t handle, const std::string& filename)
+:	LLQueuedThread::QueuedRequest(handle, PRIORITY_NORMAL),
+	mFilename(filename),
+	mSuccess(false)
+{
+}
+
+// Runs on the cache thread
+bool LLVOCacheThread::ReadRequest::processRequest()
+{
+	LLMappedFile file;
+	if (!file.open(mFilename, 0, true))
+	{
+		return true; // done (failed)
+	}
+
+	LLVOCacheFileHeader header;
+	if (file.getSize() < sizeof(LLVOCacheFileHeader))
+	{
+		LL_WARNS() << "Truncated object cache file " << mFilename << LL_ENDL;
+		return true;
+	}
+	memcpy(&header, file.getData(), sizeof(LLVOCacheFileHeader));
+	if (header.mMagic != REGION_CACHE_MAGIC
+		|| header.mDataSize != file.getSize() - sizeof(LLVOCacheFileHeader))
+	{
+		LL_WARNS() << "Bad object cache file header for " << mFilename << LL_ENDL;
+		return true;
+	}
+	mCacheID = header.mCacheID;
+
+	const U8* data = file.getData() + sizeof(LLVOCacheFileHeader);
+	const U8* end = file.getData() + file.getSize();
+	mSuccess = true;
+	for (U32 i = 0; i < header.mEntryCount; i++)
+	{
+		LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(data, end);
+		if (!entry->getLocalID())
+		{
+			LL_WARNS() << "Aborting cache file load for " << mFilename << ", cache file corruption!" << LL_ENDL;
+			mSuccess = false;
+			break;
+		}
+		mEntries[entry->getLocalID()] = entry;
+	}
+	return true;
+}
+
+LLVOCacheThread::FileRequest::FileRequest(handle_t handle, EOperation operation, const std::string& filename,
+										  S32 offset, std::vector<U8>& data)
+:	LLQueuedThread::QueuedRequest(handle, PRIORITY_NORMAL, FLAG_AUTO_COMPLETE),
+	mOperation(operation),
+	mFilename(filename),
+	mOffset(offset)
+{
+	mData.swap(data);
+}
+
+// Runs on the cache thread
+bool LLVOCacheThread::FileRequest::processRequest()
+{
+	if (mOperation == REMOVE)
+	{
+		LLFile::remove(mFilename, ENOENT);
+		return true;
+	}
+
+	LLFILE* file = LLFile::fopen(mFilename, mOperation == WRITE ? "wb" : "r+b");
+	bool success = file != nullptr;
+	if (success && mOperation == WRITE_AT)
+	{
+		success = fseek(file, mOffset, SEEK_SET) == 0;
+	}
+	if (success && !mData.empty())
+	{
+		success = fwrite(&mData[0], 1, mData.size(), file) == mData.size();
+	}
+	if (file)
+	{
+		success = (fclose(file) == 0) && success;
+	}
+
+	if (!success)
+	{
+		LL_WARNS() << "Failed to write object cache file " << mFilename << LL_ENDL;
+		if (mOperation == WRITE)
+		{
+			// A partial region file fails its next read and is dropped then.
+			LLFile::remove(mFilename, ENOENT);
+		}
+	}
+	return true;
+}
+
+LLVOCacheThread::handle_t LLVOCacheThread::read(const std::string& filename)
+{
+	handle_t handle = generateHandle();
+	addRequest(new ReadRequest(handle, filename));
+	return handle;
+}
+
+bool LLVOCacheThread::takeRead(handle_t handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	waitForResult(handle, false);
+	ReadRequest* req = (ReadRequest*)getRequest(handle);
+	if (!req)
+	{
+		return false;
+	}
+
+	bool success = false;
+	if (req->mCacheID != id)
+	{
+		if (req->mCacheID.notNull())
+		{
+			LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+		}
+	}
+	else
+	{
+		success = req->mSuccess;
+		for (const auto& entry : req->mEntries)
+		{
+			cache_entry_map[entry.first] = entry.second;
+		}
+	}
+	completeRequest(handle);
+	return success;
+}
+
+void LLVOCacheThread::discardRead(handle_t handle)
+{
+	// A request still queued or running deletes itself once aborted, one
+	// that already finished has to be completed here.
+	abortRequest(handle, true);
+	status_t status = getRequestStatus(handle);
+	if (status == STATUS_COMPLETE || status == STATUS_ABORTED)
+	{
+		completeRequest(handle);
+	}
+}
+
+void LLVOCacheThread::write(const std::string& filename, std::vector<U8>& data)
+{
+	addRequest(new FileRequest(generateHandle(), FileRequest::WRITE, filename, 0, data));
+}
+
+void LLVOCacheThread::writeAt(const std::string& filename, S32 offset, std::vector<U8>& data)
+{
+	addRequest(new FileRequest(generateHandle(), FileRequest::WRITE_AT, filename, offset, data));
+}
+
+void LLVOCacheThread::remove(const std::string& filename)
+{
+	std::vector<U8> data;
+	addRequest(new FileRequest(generateHandle(), FileRequest::REMOVE, filename, 0, data));
+}
+
 //-------------------------------------------------------------------
 //LLVOCache
 //-------------------------------------------------------------------
@@ -1078,7 +1289,8 @@ LLVOCache::LLVOCache(bool read_only) :
 	mInitialized(false),
 	mReadOnly(read_only),
 	mCacheSize(1),
-	mNumEntries(0)
+	mNumEntries(0),
+	mThread(nullptr)
 {
 	mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 	mLocalAPRFilePoolp = new LLVolatileAPRPool("VOCache Local Pool") ;
@@ -1088,9 +1300,11 @@ LLVOCache::~LLVOCache()
 {
 	if(mEnabled)
 	{
+		waitOnThread(); //let the queued writes land before the header
 		writeCacheHeader();
 		clearCacheInMemory();
 	}
+	delete mThread;
 	delete mLocalAPRFilePoolp;
 }
 
@@ -1114,6 +1328,10 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
 		return ;
 	}
 	mInitialized = true;
+	if (!mThread)
+	{
+		mThread = new LLVOCacheThread();
+	}
 
 	setDirNames(location);
 	if (!mReadOnly)
@@ -1164,6 +1382,8 @@ void LLVOCache::removeCache(ELLPath location, bool started)
 
 	LL_INFOS() << "about to remove the object cache due to settings." << LL_ENDL ;
 
+	waitOnThread();
+
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	LL_INFOS() << "Removing cache at " << cache_dir << LL_ENDL;
@@ -1188,6 +1408,8 @@ void LLVOCache::removeCache()
 		return ;
 	}
 
+	waitOnThread();
+
 	std::string mask = "*";
 	LL_INFOS() << "Removing object cache at " << mObjectCacheDirName << LL_ENDL;
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
@@ -1211,6 +1433,7 @@ void LLVOCache::removeEntry(HeaderEntryInfo* entry)
 	header_entry_queue_t::iterator iter = mHeaderEntryQueue.find(entry);
 	if(iter != mHeaderEntryQueue.end())
 	{		
+		discardPrefetch(entry->mHandle);
 		mHandleEntryMap.erase(entry->mHandle);		
 		mHeaderEntryQueue.erase(iter);
 		removeFromCache(entry);
@@ -1267,7 +1490,7 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 
 	std::string filename;
 	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename, mLocalAPRFilePoolp);
+	mThread->remove(filename);
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
 }
@@ -1407,12 +1630,54 @@ void LLVOCache::writeCacheHeader()
 	return ;
 }
 
-BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
+void LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 {
-	LLAPRFile apr_file(mHeaderFileName, APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
-	apr_file.seek(APR_SET, entry->mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo)) ;
+	std::vector<U8> data(sizeof(HeaderEntryInfo));
+	memcpy(&data[0], entry, sizeof(HeaderEntryInfo));
+	mThread->writeAt(mHeaderFileName, entry->mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo), data);
+}
+
+void LLVOCache::prefetch(U64 handle)
+{
+	if(!mEnabled || !mInitialized)
+	{
+		return;
+	}
+
+	if(mHandleEntryMap.find(handle) == mHandleEntryMap.end() //no cache
+		|| mPendingReads.find(handle) != mPendingReads.end())
+	{
+		return;
+	}
 
-	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	mPendingReads[handle] = mThread->read(filename);
+}
+
+void LLVOCache::discardPrefetch(U64 handle)
+{
+	pending_read_map_t::iterator iter = mPendingReads.find(handle);
+	if(iter != mPendingReads.end())
+	{
+		mThread->discardRead(iter->second);
+		mPendingReads.erase(iter);
+	}
+}
+
+void LLVOCache::waitOnThread()
+{
+	if(!mThread)
+	{
+		return;
+	}
+
+	for (const auto& pending : mPendingReads)
+	{
+		mThread->discardRead(pending.second);
+	}
+	mPendingReads.clear();
+	mThread->waitOnPending();
 }
 
 void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
@@ -1431,46 +1696,22 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 		return ;
 	}
 
-	bool success = true ;
+	LLQueuedThread::handle_t read_handle;
+	pending_read_map_t::iterator pending = mPendingReads.find(handle);
+	if(pending != mPendingReads.end())
+	{
+		read_handle = pending->second;
+		mPendingReads.erase(pending);
+	}
+	else
 	{
 		std::string filename;
 		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-				success = false ;
-			}
-
-			if(success)
-			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-					{
-						LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
+		read_handle = mThread->read(filename);
 	}
-	
+
+	//only waits for what the prefetch has not read yet
+	bool success = mThread->takeRead(read_handle, id, cache_entry_map);
 	if(!success)
 	{
 		if(cache_entry_map.empty())
@@ -1488,6 +1729,7 @@ void LLVOCache::purgeEntries(U32 size)
 	{
 		header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin() ;
 		HeaderEntryInfo* entry = *iter ;			
+		discardPrefetch(entry->mHandle);
 		mHandleEntryMap.erase(entry->mHandle);
 		mHeaderEntryQueue.erase(iter) ;
 		removeFromCache(entry) ;
@@ -1540,11 +1782,7 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 	}
 
 	//update cache header
-	if(!updateEntry(entry))
-	{
-		LL_WARNS() << "Failed to update cache header index " << entry->mIndex << ". handle = " << handle << LL_ENDL;
-		return ; //update failed.
-	}
+	updateEntry(entry);
 
 	if(!dirty_cache)
 	{
@@ -1552,39 +1790,30 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
-	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
+	//a read queued before this write would hand out the old file
+	discardPrefetch(handle);
 
-	
-		if(success)
+	//serialize here, the cache thread writes the file
+	std::vector<U8> buffer(sizeof(LLVOCacheFileHeader));
+	U32 num_entries = 0;
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		if(!removal_enabled || iter->second->isValid())
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-			{
-				if(!removal_enabled || iter->second->isValid())
-				{
-					success = iter->second->writeToFile(&apr_file) ;
-					if(!success)
-					{
-						break;
-					}
-				}
-			}
+			iter->second->writeToBuffer(buffer);
+			num_entries++;
 		}
 	}
 
-	if(!success)
-	{
-		removeEntry(entry) ;
-	}
+	LLVOCacheFileHeader header;
+	header.mMagic = REGION_CACHE_MAGIC;
+	header.mEntryCount = num_entries;
+	header.mDataSize = buffer.size() - sizeof(LLVOCacheFileHeader);
+	header.mPad = 0;
+	header.mCacheID = id;
+	memcpy(&buffer[0], &header, sizeof(LLVOCacheFileHeader));
 
-	return ;
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	mThread->write(filename, buffer);
 }
@@ -83,7 +83,9 @@ protected:
 	~LLVOCacheEntry();
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	// Decodes an entry written by writeToBuffer() and advances data past it.
+	// A damaged entry is left with a local id of 0.
+	LLVOCacheEntry(const U8*& data, const U8* end);
 	LLVOCacheEntry();	
 
 	void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -106,7 +108,7 @@ public:
 	F32 getSceneContribution() const             { return mSceneContrib;}
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
+	void writeToBuffer(std::vector<U8>& buffer) const;
 	LLDataPackerBinaryBuffer *getDP();
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
@@ -218,8 +220,11 @@ private:
 	U32   mIdleHash;
 };
 
+class LLVOCacheThread;
+
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe, region files are read and written
+//on its own worker thread but the cache is only used from the main thread.
 //
 class LLVOCache final : public LLParamSingleton<LLVOCache>
 {
@@ -263,7 +268,14 @@ public:
 	void initCache(ELLPath location, U32 size, U32 cache_version);
 	void removeCache(ELLPath location, bool started = false) ;
 
+	// Starts reading the region's file in the background, readFromCache()
+	// then only waits for what is left of it.
+	void prefetch(U64 handle);
+	// Drops a prefetch the region will not use.
+	void discardPrefetch(U64 handle);
+
 	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
+	// Queues the file write, cache_entry_map can be changed once this returns.
 	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
 	void removeEntry(U64 handle) ;
 
@@ -281,9 +293,13 @@ private:
 	void removeCache() ;
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
-	BOOL updateEntry(const HeaderEntryInfo* entry);
+	void updateEntry(const HeaderEntryInfo* entry);
+	// Drops the prefetched reads and waits for the queued file operations.
+	void waitOnThread();
 	
 private:
+	typedef std::map<U64, U32> pending_read_map_t; // region handle to LLVOCacheThread request
+
 	bool                 mEnabled;
 	bool                 mInitialized ;
 	bool                 mReadOnly ;
@@ -295,6 +311,8 @@ private:
 	LLVolatileAPRPool*   mLocalAPRFilePoolp ; 	
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
+	LLVOCacheThread*     mThread;
+	pending_read_map_t   mPendingReads;
 };
 
 #endif
@@ -211,6 +211,13 @@ LLViewerRegion* LLWorld::addRegion(const U64 &region_handle, const LLHost &host)
 		regionp->setCapability("Seed", seedUrl);
 	}
 
+	// Start reading the object cache now, the region wants it once the
+	// handshake arrives.
+	if (LLVOCache::instanceExists())
+	{
+		LLVOCache::getInstance()->prefetch(region_handle);
+	}
+
 	mRegionList.push_back(regionp);
 	mActiveRegionList.push_back(regionp);
 	mCulledRegionList.push_back(regionp);
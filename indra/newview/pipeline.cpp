@@ -4305,6 +4305,8 @@ void LLPipeline::renderGeom(LLCamera& camera, bool forceVBOUpdate)
 			poolp->prerender();
 		}
 	}
+	// The avatar pools only queued their rigged faces, skin them together
+	LLDrawPoolAvatar::skinRiggedFaces();
 
 	{
 		LL_RECORD_BLOCK_TIME(FTM_POOLS);
@@ -4482,6 +4484,7 @@ void LLPipeline::renderGeomDeferred(LLCamera& camera)
 			poolp->prerender();
 		}
 	}
+	LLDrawPoolAvatar::skinRiggedFaces();
 
 	LLGLEnable multisample(RenderFSAASamples > 0 ? GL_MULTISAMPLE_ARB : 0);
 
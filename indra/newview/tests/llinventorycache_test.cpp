@@ -0,0 +1,514 @@
+/**
+ * @file llinventorycache_test.cpp
+ * @brief Test for llinventorycache.cpp, including load time of a large inventory.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llinventorycache.h"
+
+#include "llfile.h"
+#include "llformat.h"
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <set>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace
+{
+	const S32 CACHE_VERSION = 2;
+	const U32 BENCH_FOLDERS = 5000;
+	const U32 BENCH_ITEMS_PER_FOLDER = 40;
+
+	// What a loader builds from each record
+	struct DecodedItem
+	{
+		LLUUID mID;
+		LLUUID mParentID;
+		std::string mName;
+		std::string mDescription;
+		U32 mFlags;
+	};
+}
+
+namespace tut
+{
+	struct inventorycache
+	{
+		inventorycache()
+		{
+			mFilename = (boost::filesystem::temp_directory_path()
+						 / boost::filesystem::unique_path("inventory-%%%%-%%%%.inv.bin")).string();
+		}
+
+		~inventorycache()
+		{
+			LLFile::remove(mFilename, ENOENT);
+		}
+
+		// Folder f holds f % items_per_folder items, so some are empty
+		void build(LLInventoryCacheFile::Builder& builder, U32 folders, U32 items_per_folder, bool vary)
+		{
+			for (U32 f = 0; f < folders; ++f)
+			{
+				LLInventoryCacheFile::Section& section = builder.addSection(LLUUID::generateNewID());
+				section.mVersion = f;
+				section.mName = builder.addString(llformat("Folder %u", f));
+				section.mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+
+				const U32 count = vary ? f % items_per_folder : items_per_folder;
+				for (U32 i = 0; i < count; ++i)
+				{
+					LLInventoryCacheFile::ItemRecord& item = builder.addItem();
+					item.mID.generate();
+					item.mAssetID.generate();
+					item.mCreatorID.generate();
+					item.mMaskOwner = 0x7fffffff;
+					item.mFlags = f * 1000 + i;
+					item.mCreationDate = 1577836800 + i;
+					item.mName = builder.addString(llformat("Item %u in folder %u", i, f));
+					item.mDescription = builder.addString("2020-01-01 00:00:00 object");
+				}
+			}
+		}
+
+		std::vector<DecodedItem> decode(const LLInventoryCacheFile& cache, U32 runs)
+		{
+			std::vector<std::vector<DecodedItem> > run_items(runs);
+			cache.decodeItems(runs, [&](U32 section, U32 first, U32 end, U32 run)
+				{
+					const LLUUID& parent_id = cache.getSection(section).mID;
+					for (U32 i = first; i < end; ++i)
+					{
+						const LLInventoryCacheFile::ItemRecord& record = cache.getItem(i);
+						DecodedItem item;
+						item.mID = record.mID;
+						item.mParentID = parent_id;
+						item.mName = cache.getString(record.mName);
+						item.mDescription = cache.getString(record.mDescription);
+						item.mFlags = record.mFlags;
+						run_items[run].push_back(item);
+					}
+				});
+
+			std::vector<DecodedItem> items;
+			for (const auto& run : run_items)
+			{
+				items.insert(items.end(), run.begin(), run.end());
+			}
+			return items;
+		}
+
+		// Item ids of every section, by section id
+		std::map<LLUUID, std::set<LLUUID> > contents(const LLInventoryCacheFile& cache)
+		{
+			std::map<LLUUID, std::set<LLUUID> > sections;
+			for (U32 i = 0; i < cache.getSectionCount(); ++i)
+			{
+				const LLInventoryCacheFile::Section& section = cache.getSection(i);
+				std::set<LLUUID>& items = sections[section.mID];
+				for (U32 j = section.mFirstItem; j < section.mFirstItem + section.mItemCount; ++j)
+				{
+					items.insert(cache.getItem(j).mID);
+				}
+			}
+			return sections;
+		}
+
+		// Item ids by parent after replaying journals over the cache, the
+		// way LLInventoryModel::replayJournals() does at login
+		std::map<LLUUID, std::set<LLUUID> > replayed(const std::vector<std::string>& journals)
+		{
+			std::map<LLUUID, LLUUID> parents;
+			std::map<LLUUID, U64> written;
+			std::map<LLUUID, U64> listed;
+			{
+				LLInventoryCacheFile cache;
+				ensure("open for replay", cache.open(mFilename));
+				for (const auto& section : contents(cache))
+				{
+					for (const LLUUID& id : section.second)
+					{
+						parents[id] = section.first;
+					}
+				}
+			}
+
+			U64 sequence = 0;
+			for (const std::string& journal : journals)
+			{
+				LLInventoryCacheJournal::replay(journal, CACHE_VERSION,
+					[&](const LLInventoryCacheJournal::Entry& entry)
+					{
+						++sequence;
+						if (entry.mOperation == LLInventoryCacheJournal::OP_CATEGORY && entry.mReplaceItems)
+						{
+							listed[entry.mID] = sequence;
+						}
+						else if (entry.mOperation == LLInventoryCacheJournal::OP_ITEM)
+						{
+							parents[entry.mID] = entry.mParentID;
+							written[entry.mID] = sequence;
+						}
+						else if (entry.mOperation == LLInventoryCacheJournal::OP_REMOVE)
+						{
+							parents.erase(entry.mID);
+						}
+					});
+			}
+
+			std::map<LLUUID, std::set<LLUUID> > sections;
+			for (const auto& item : parents)
+			{
+				const auto it = listed.find(item.second);
+				if (it == listed.end() || written[item.first] >= it->second)
+				{
+					sections[item.second].insert(item.first);
+				}
+			}
+			return sections;
+		}
+
+		static LLInventoryCacheJournal::Entry category(const LLUUID& id, bool replace_items)
+		{
+			LLInventoryCacheJournal::Entry entry;
+			entry.mOperation = LLInventoryCacheJournal::OP_CATEGORY;
+			entry.mReplaceItems = replace_items;
+			entry.mCategory.mID = id;
+			entry.mCategory.mVersion = 3;
+			entry.mCategory.mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+			entry.mName = "Journaled folder";
+			return entry;
+		}
+
+		static LLInventoryCacheJournal::Entry item(const LLUUID& id, const LLUUID& parent_id)
+		{
+			LLInventoryCacheJournal::Entry entry;
+			entry.mOperation = LLInventoryCacheJournal::OP_ITEM;
+			entry.mParentID = parent_id;
+			entry.mItem.mID = id;
+			entry.mItem.mFlags = 42;
+			entry.mName = "Journaled item";
+			entry.mDescription = "with a description";
+			return entry;
+		}
+
+		static LLInventoryCacheJournal::Entry remove(const LLUUID& id)
+		{
+			LLInventoryCacheJournal::Entry entry;
+			entry.mOperation = LLInventoryCacheJournal::OP_REMOVE;
+			entry.mID = id;
+			return entry;
+		}
+
+		std::string mFilename;
+	};
+	typedef test_group<inventorycache> inventorycache_t;
+	typedef inventorycache_t::object inventorycache_object_t;
+	tut::inventorycache_t tut_inventorycache("LLInventoryCacheFile");
+
+	template<> template<>
+	void inventorycache_object_t::test<1>()
+	{
+		set_test_name("round trip, in file order with any number of runs");
+
+		LLInventoryCacheFile::Builder builder;
+		build(builder, 50, 7, true);
+		ensure("save", builder.save(mFilename, CACHE_VERSION));
+
+		LLInventoryCacheFile cache;
+		ensure("open", cache.open(mFilename));
+		ensure_equals("version", cache.getCacheVersion(), CACHE_VERSION);
+		ensure_equals("sections", cache.getSectionCount(), 50U);
+		ensure_equals("items", cache.getItemCount(), builder.getItemCount());
+		ensure_equals("folder name", cache.getString(cache.getSection(12).mName), std::string("Folder 12"));
+
+		const U32 runs[] = { 1, 2, 3, 7, 64, 1000 };
+		for (U32 run_count : runs)
+		{
+			std::vector<DecodedItem> items = decode(cache, run_count);
+			ensure_equals("decoded", items.size(), (size_t)cache.getItemCount());
+			for (U32 i = 0; i < items.size(); ++i)
+			{
+				const DecodedItem& item = items[i];
+				ensure("id", item.mID == cache.getItem(i).mID);
+				const U32 folder = item.mFlags / 1000;
+				ensure("parent", item.mParentID == cache.getSection(folder).mID);
+				ensure_equals("name", item.mName, llformat("Item %u in folder %u", item.mFlags % 1000, folder));
+			}
+		}
+	}
+
+	template<> template<>
+	void inventorycache_object_t::test<2>()
+	{
+		set_test_name("damaged files are refused");
+
+		LLInventoryCacheFile::Builder builder;
+		build(builder, 10, 5, false);
+		ensure("save", builder.save(mFilename, CACHE_VERSION));
+
+		std::string data;
+		{
+			llifstream istr(mFilename.c_str(), std::ios::binary);
+			data.assign(std::istreambuf_iterator<char>(istr), std::istreambuf_iterator<char>());
+		}
+		auto write = [this](const std::string& contents)
+		{
+			llofstream ostr(mFilename.c_str(), std::ios::binary | std::ios::trunc);
+			ostr.write(contents.data(), contents.size());
+		};
+
+		LLInventoryCacheFile cache;
+		write(data.substr(0, data.size() - 1));
+		ensure("truncated", !cache.open(mFilename));
+
+		std::string bad_header(data);
+		bad_header[8] ^= 0x01;
+		write(bad_header);
+		ensure("header checksum", !cache.open(mFilename));
+
+		// First item's name offset, past the header and the sections
+		std::string bad_string(data);
+		const size_t name_offset = 32 + 10 * sizeof(LLInventoryCacheFile::Section)
+			+ offsetof(LLInventoryCacheFile::ItemRecord, mName);
+		bad_string[name_offset + 3] = 0x7f;
+		write(bad_string);
+		ensure("string out of bounds", !cache.open(mFilename));
+
+		write(data);
+		ensure("intact", cache.open(mFilename));
+	}
+
+	template<> template<>
+	void inventorycache_object_t::test<3>()
+	{
+		set_test_name("load time of a large inventory");
+
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time the inventory cache");
+		}
+
+		const U32 total = BENCH_FOLDERS * BENCH_ITEMS_PER_FOLDER;
+		LLTimer timer;
+		LLInventoryCacheFile::Builder builder;
+		build(builder, BENCH_FOLDERS, BENCH_ITEMS_PER_FOLDER, false);
+		ensure("save", builder.save(mFilename, CACHE_VERSION));
+		F64 save_time = timer.getElapsedTimeF64().value();
+
+		LLInventoryCacheFile cache;
+		timer.reset();
+		ensure("open", cache.open(mFilename));
+		F64 open_time = timer.getElapsedTimeF64().value();
+
+		timer.reset();
+		ensure_equals("one run", decode(cache, 1).size(), (size_t)total);
+		F64 single_time = timer.getElapsedTimeF64().value();
+
+		const U32 runs = cache.getDefaultRuns();
+		timer.reset();
+		ensure_equals("default runs", decode(cache, runs).size(), (size_t)total);
+		F64 parallel_time = timer.getElapsedTimeF64().value();
+
+		LL_INFOS() << "LLInventoryCacheFile " << total << " items: save " << save_time * 1.0e3
+				   << " ms, open " << open_time * 1.0e3 << " ms, decode on 1 thread "
+				   << single_time * 1.0e3 << " ms, on " << runs << " threads "
+				   << parallel_time * 1.0e3 << " ms" << LL_ENDL;
+	}
+
+	template<> template<>
+	void inventorycache_object_t::test<4>()
+	{
+		set_test_name("journal replay stops at a torn entry");
+
+		const std::string journal_filename = mFilename + ".journal.0";
+		const LLUUID folder_id = LLUUID::generateNewID();
+		const LLUUID item_id = LLUUID::generateNewID();
+		{
+			LLInventoryCacheJournal journal;
+			ensure("create", journal.create(journal_filename, CACHE_VERSION));
+			ensure("category", journal.append(category(folder_id, true)));
+			ensure("item", journal.append(item(item_id, folder_id)));
+			ensure("remove", journal.append(remove(item_id)));
+			ensure_equals("entries", journal.getEntryCount(), 3U);
+		}
+
+		std::vector<LLInventoryCacheJournal::Entry> entries;
+		auto collect = [&entries](const LLInventoryCacheJournal::Entry& entry) { entries.push_back(entry); };
+		ensure("other version", !LLInventoryCacheJournal::replay(journal_filename, CACHE_VERSION + 1, collect));
+		ensure("replay", LLInventoryCacheJournal::replay(journal_filename, CACHE_VERSION, collect));
+		ensure_equals("replayed", entries.size(), (size_t)3);
+		ensure("category id", entries[0].mID == folder_id);
+		ensure("replace items", entries[0].mReplaceItems);
+		ensure_equals("category name", entries[0].mName, std::string("Journaled folder"));
+		ensure("item parent", entries[1].mParentID == folder_id);
+		ensure_equals("item description", entries[1].mDescription, std::string("with a description"));
+		ensure_equals("item flags", entries[1].mItem.mFlags, 42U);
+		ensure("removed id", entries[2].mOperation == LLInventoryCacheJournal::OP_REMOVE
+			   && entries[2].mID == item_id);
+
+		// Cut into the last entry, as a crash while writing it would
+		std::string data;
+		{
+			llifstream istr(journal_filename.c_str(), std::ios::binary);
+			data.assign(std::istreambuf_iterator<char>(istr), std::istreambuf_iterator<char>());
+		}
+		{
+			llofstream ostr(journal_filename.c_str(), std::ios::binary | std::ios::trunc);
+			ostr.write(data.data(), data.size() - 5);
+		}
+		entries.clear();
+		ensure("torn replay", LLInventoryCacheJournal::replay(journal_filename, CACHE_VERSION, collect));
+		ensure_equals("torn entries", entries.size(), (size_t)2);
+		LLFile::remove(journal_filename, ENOENT);
+	}
+
+	template<> template<>
+	void inventorycache_object_t::test<5>()
+	{
+		set_test_name("journals compact into the cache");
+
+		const LLUUID folder_a = LLUUID::generateNewID();
+		const LLUUID folder_b = LLUUID::generateNewID();
+		const LLUUID folder_c = LLUUID::generateNewID();
+		const LLUUID a1 = LLUUID::generateNewID();
+		const LLUUID a2 = LLUUID::generateNewID();
+		const LLUUID a3 = LLUUID::generateNewID();
+		const LLUUID b1 = LLUUID::generateNewID();
+		const LLUUID b2 = LLUUID::generateNewID();
+		const LLUUID c1 = LLUUID::generateNewID();
+
+		LLInventoryCacheFile::Builder builder;
+		builder.addSection(folder_a).mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+		builder.addItem().mID = a1;
+		builder.addItem().mID = a2;
+		builder.addSection(folder_b).mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+		builder.addItem().mID = b1;
+		ensure("save", builder.save(mFilename, CACHE_VERSION));
+
+		// Two journals, the second one listing B again without b1
+		const std::string first = mFilename + ".journal.0";
+		const std::string second = mFilename + ".journal.1";
+		{
+			LLInventoryCacheJournal journal;
+			ensure("create first", journal.create(first, CACHE_VERSION));
+			journal.append(item(a3, folder_a));
+			journal.append(remove(a1));
+			journal.append(item(b2, folder_b));
+			ensure("create second", journal.create(second, CACHE_VERSION));
+			journal.append(category(folder_b, true));
+			journal.append(item(b2, folder_b));
+			journal.append(category(folder_c, false));
+			journal.append(item(c1, folder_c));
+		}
+
+		std::vector<std::string> journals = { first, second };
+		ensure("compact", LLInventoryCacheJournal::compact(mFilename, journals, CACHE_VERSION));
+		ensure("journals removed", !LLFile::isfile(first) && !LLFile::isfile(second));
+
+		LLInventoryCacheFile cache;
+		ensure("open", cache.open(mFilename));
+		std::map<LLUUID, std::set<LLUUID> > sections = contents(cache);
+		ensure_equals("sections", sections.size(), (size_t)3);
+		ensure("a", sections[folder_a] == std::set<LLUUID>({ a2, a3 }));
+		ensure("b", sections[folder_b] == std::set<LLUUID>({ b2 }));
+		ensure("c", sections[folder_c] == std::set<LLUUID>({ c1 }));
+		for (U32 i = 0; i < cache.getItemCount(); ++i)
+		{
+			if (cache.getItem(i).mID == c1)
+			{
+				ensure_equals("journaled name", cache.getString(cache.getItem(i).mName),
+							  std::string("Journaled item"));
+			}
+		}
+	}
+
+	template<> template<>
+	void inventorycache_object_t::test<6>()
+	{
+		set_test_name("compacted cache holds what replay does, orphans included");
+
+		const LLUUID folder_a = LLUUID::generateNewID();
+		const LLUUID folder_b = LLUUID::generateNewID();
+		const LLUUID unsaved = LLUUID::generateNewID();
+		const LLUUID gone = LLUUID::generateNewID();
+		const LLUUID a1 = LLUUID::generateNewID();
+		const LLUUID a2 = LLUUID::generateNewID();
+		const LLUUID b1 = LLUUID::generateNewID();
+		const LLUUID b2 = LLUUID::generateNewID();
+		const LLUUID u1 = LLUUID::generateNewID();
+		const LLUUID g1 = LLUUID::generateNewID();
+
+		// The items of a parent that was not saved get a plain section
+		LLInventoryCacheFile::Builder builder;
+		builder.addSection(folder_a).mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+		builder.addItem().mID = a1;
+		builder.addSection(folder_b).mFlags = LLInventoryCacheFile::SECTION_CATEGORY;
+		builder.addItem().mID = b1;
+		builder.addSection(unsaved);
+		builder.addItem().mID = u1;
+		ensure("save", builder.save(mFilename, CACHE_VERSION));
+
+		// Folder A goes away with its items left behind, B is listed again
+		// and an item lands in a folder that was never cached
+		const std::string journal_filename = mFilename + ".journal.0";
+		{
+			LLInventoryCacheJournal journal;
+			ensure("create", journal.create(journal_filename, CACHE_VERSION));
+			journal.append(item(a2, folder_a));
+			journal.append(remove(folder_a));
+			journal.append(category(folder_b, true));
+			journal.append(item(b2, folder_b));
+			journal.append(item(g1, gone));
+			journal.append(item(u1, unsaved));
+		}
+
+		std::vector<std::string> journals = { journal_filename };
+		const std::map<LLUUID, std::set<LLUUID> > expected = replayed(journals);
+		ensure("compact", LLInventoryCacheJournal::compact(mFilename, journals, CACHE_VERSION));
+
+		LLInventoryCacheFile cache;
+		ensure("open", cache.open(mFilename));
+		std::map<LLUUID, std::set<LLUUID> > sections = contents(cache);
+		ensure("a kept", sections[folder_a] == std::set<LLUUID>({ a1, a2 }));
+		ensure("b relisted", sections[folder_b] == std::set<LLUUID>({ b2 }));
+		ensure("unsaved kept", sections[unsaved] == std::set<LLUUID>({ u1 }));
+		ensure("gone kept", sections[gone] == std::set<LLUUID>({ g1 }));
+		for (U32 i = 0; i < cache.getSectionCount(); ++i)
+		{
+			const LLInventoryCacheFile::Section& section = cache.getSection(i);
+			ensure("only b is a category", ((section.mFlags & LLInventoryCacheFile::SECTION_CATEGORY) != 0)
+				   == (section.mID == folder_b));
+		}
+
+		ensure("same as replay", sections == expected);
+	}
+}
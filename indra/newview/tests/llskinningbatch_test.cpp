@@ -0,0 +1,329 @@
+/**
+ * @file llskinningbatch_test.cpp
+ * @brief LLSkinningBatch test cases, and a crowd of synthetic rigged meshes.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llskinningbatch.h"
+
+#include "llmodel.h"
+#include "llstring.h"
+#include "lltimer.h"
+#include "llvolume.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	const U32 JOINT_COUNT = 110;
+	const U32 BENCH_AVATARS = 50;
+	const U32 BENCH_FACES_PER_AVATAR = 8;
+	const U32 BENCH_VERTICES_PER_FACE = 4000;
+
+	U32 sSeed = 1;
+
+	F32 frand(F32 low, F32 high)
+	{
+		sSeed = sSeed * 1664525 + 1013904223;
+		return low + (high - low) * (F32)(sSeed >> 8) / (F32)(1 << 24);
+	}
+
+	// A rotation about z, some scale and a translation
+	void make_joint(LLMatrix4a& mat)
+	{
+		const F32 angle = frand(-1.f, 1.f);
+		const F32 scale = frand(0.8f, 1.2f);
+		mat.setIdentity();
+		F32* m = mat.getF32ptr();
+		m[0] = cosf(angle) * scale;
+		m[1] = sinf(angle) * scale;
+		m[4] = -sinf(angle) * scale;
+		m[5] = cosf(angle) * scale;
+		m[10] = scale;
+		m[12] = frand(-2.f, 2.f);
+		m[13] = frand(-2.f, 2.f);
+		m[14] = frand(-2.f, 2.f);
+	}
+
+	void make_skin(LLMeshSkinInfo& skin, std::vector<LLMatrix4a>& joints)
+	{
+		skin.mInvBindMatrix.resize(JOINT_COUNT);
+		joints.resize(JOINT_COUNT);
+		for (U32 i = 0; i < JOINT_COUNT; ++i)
+		{
+			make_joint(skin.mInvBindMatrix[i]);
+			make_joint(joints[i]);
+			// What initSkinningMatrixPalette() makes
+			LLMatrix4a world = joints[i];
+			joints[i].setMul(world, skin.mInvBindMatrix[i]);
+		}
+		make_joint(skin.mBindShapeMatrix);
+	}
+
+	// Weights as unpacked from a mesh asset, joint index plus weight,
+	// with one to four influences
+	void make_face(LLVolumeFace& face, U32 vertices)
+	{
+		face.allocateVertices(vertices);
+		face.allocateWeights(vertices);
+		face.mNumVertices = vertices;
+		for (U32 i = 0; i < vertices; ++i)
+		{
+			face.mPositions[i].set(frand(-1.f, 1.f), frand(-1.f, 1.f), frand(-1.f, 1.f));
+			face.mNormals[i].set(frand(-1.f, 1.f), frand(-1.f, 1.f), frand(0.1f, 1.f));
+			face.mNormals[i].normalize3fast();
+
+			const U32 influences = 1 + i % 4;
+			F32 w[4] = { 0.f, 0.f, 0.f, 0.f };
+			for (U32 k = 0; k < influences; ++k)
+			{
+				const U32 joint = (i * 7 + k * 13) % JOINT_COUNT;
+				w[k] = (F32)joint + frand(0.05f, 0.95f);
+			}
+			face.mWeights[i].loadua(w);
+		}
+	}
+
+	// The loop LLDrawPoolAvatar::updateRiggedFaceVertexBuffer() ran
+	void reference_skin(const LLMeshSkinInfo& skin, const LLMatrix4a* mat, const LLVolumeFace& face,
+						LLVector4a* pos, LLVector4a* norm)
+	{
+		for (S32 j = 0; j < face.mNumVertices; ++j)
+		{
+			LL_ALIGN_16(S32 idx[4]);
+			LLIVector4a current_joint_index;
+			current_joint_index.setFloatTrunc(face.mWeights[j]);
+			LLVector4a weight;
+			weight.setSub(face.mWeights[j], current_joint_index);
+			current_joint_index.store128a(idx);
+
+			LLVector4a scale;
+			scale.setMoveHighLow(weight);
+			scale.add(weight);
+			scale.addFirst(scale.getVectorAt<1>());
+			scale.splat<0>(scale);
+			weight.div(scale);
+
+			LLMatrix4a final_mat;
+			final_mat.setMul(mat[idx[0]], weight.getVectorAt<0>());
+			final_mat.setMulAdd(mat[idx[1]], weight.getVectorAt<1>());
+			final_mat.setMulAdd(mat[idx[2]], weight.getVectorAt<2>());
+			final_mat.setMulAdd(mat[idx[3]], weight.getVectorAt<3>());
+
+			LLVector4a dst;
+			skin.mBindShapeMatrix.affineTransform(face.mPositions[j], dst);
+			final_mat.affineTransform(dst, dst);
+			pos[j] = dst;
+
+			skin.mBindShapeMatrix.rotate(face.mNormals[j], dst);
+			final_mat.rotate(dst, dst);
+			dst.normalize3fast();
+			norm[j] = dst;
+		}
+	}
+
+	F32 max_difference(const LLVector4a* a, const LLVector4a* b, U32 count)
+	{
+		F32 largest = 0.f;
+		for (U32 i = 0; i < count; ++i)
+		{
+			for (U32 k = 0; k < 3; ++k)
+			{
+				largest = llmax(largest, fabsf(a[i][k] - b[i][k]));
+			}
+		}
+		return largest;
+	}
+
+	struct Output
+	{
+		explicit Output(U32 count) : mPositions(count), mNormals(count) {}
+
+		std::vector<LLVector4a> mPositions;
+		std::vector<LLVector4a> mNormals;
+	};
+}
+
+namespace tut
+{
+	struct skinningbatch_data
+	{
+	};
+	typedef test_group<skinningbatch_data> skinningbatch_test;
+	typedef skinningbatch_test::object skinningbatch_object;
+	tut::skinningbatch_test skinningbatch_testcase("LLSkinningBatch");
+
+	template<> template<>
+	void skinningbatch_object::test<1>()
+	{
+		set_test_name("matches per vertex skinning");
+		LLMeshSkinInfo skin;
+		std::vector<LLMatrix4a> joints;
+		make_skin(skin, joints);
+
+		// Odd count for a partial block at the end
+		LLVolumeFace face;
+		make_face(face, 1001);
+
+		Output expected(face.mNumVertices);
+		reference_skin(skin, joints.data(), face, expected.mPositions.data(), expected.mNormals.data());
+
+		// Only compared, never dereferenced
+		const LLVOAvatar* other_avatar = reinterpret_cast<const LLVOAvatar*>(&skin);
+
+		LLSkinningBatch batch;
+		U32 palette = batch.addPalette(&skin, nullptr, joints.data(), JOINT_COUNT);
+		ensure_equals("palette found", batch.findPalette(&skin, nullptr), (S32)palette);
+		ensure_equals("unknown skin", batch.findPalette(nullptr, nullptr), -1);
+		ensure_equals("worn by another avatar", batch.findPalette(&skin, other_avatar), -1);
+
+		Output skinned(face.mNumVertices);
+		batch.addFace(face, palette, skinned.mPositions.data(), skinned.mNormals.data());
+		batch.addFace(face, palette, skinned.mPositions.data(), skinned.mNormals.data());
+		ensure_equals("queued once", batch.getVertexCount(), (U32)face.mNumVertices);
+		batch.skin(1);
+
+		// The bind shape is folded into the palette, close but not exact
+		ensure("positions", max_difference(expected.mPositions.data(), skinned.mPositions.data(), face.mNumVertices) < 1e-3f);
+		ensure("normals", max_difference(expected.mNormals.data(), skinned.mNormals.data(), face.mNumVertices) < 1e-3f);
+
+		batch.clear();
+		ensure("cleared", batch.empty());
+		ensure_equals("cleared count", batch.getVertexCount(), 0U);
+	}
+
+	template<> template<>
+	void skinningbatch_object::test<2>()
+	{
+		set_test_name("threads split faces the same way");
+		LLMeshSkinInfo skins[2];
+		std::vector<LLMatrix4a> joints[2];
+		make_skin(skins[0], joints[0]);
+		make_skin(skins[1], joints[1]);
+
+		const U32 sizes[] = { 3, 5000, 1, 777, 12000, 4 };
+		const U32 face_count = LL_ARRAY_SIZE(sizes);
+		std::vector<std::unique_ptr<LLVolumeFace> > faces;
+		for (U32 i = 0; i < face_count; ++i)
+		{
+			faces.emplace_back(new LLVolumeFace);
+			make_face(*faces.back(), sizes[i]);
+		}
+
+		std::vector<Output> single, several;
+		for (U32 runs : { 1U, 7U })
+		{
+			std::vector<Output>& out = runs == 1 ? single : several;
+			LLSkinningBatch batch;
+			U32 palettes[2] = { batch.addPalette(&skins[0], nullptr, joints[0].data(), JOINT_COUNT),
+								batch.addPalette(&skins[1], nullptr, joints[1].data(), JOINT_COUNT) };
+			for (U32 i = 0; i < face_count; ++i)
+			{
+				out.emplace_back(sizes[i]);
+				// Only some faces get normals
+				batch.addFace(*faces[i], palettes[i % 2], out[i].mPositions.data(),
+							  i % 3 ? out[i].mNormals.data() : nullptr);
+			}
+			batch.skin(runs);
+		}
+
+		for (U32 i = 0; i < face_count; ++i)
+		{
+			ensure_equals("positions", max_difference(single[i].mPositions.data(), several[i].mPositions.data(), sizes[i]), 0.f);
+			ensure_equals("normals", max_difference(single[i].mNormals.data(), several[i].mNormals.data(), sizes[i]), 0.f);
+		}
+	}
+
+	template<> template<>
+	void skinningbatch_object::test<3>()
+	{
+		set_test_name("crowd of rigged meshes");
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time skinning a crowd");
+		}
+
+		LLMeshSkinInfo skin;
+		std::vector<LLMatrix4a> joints;
+		make_skin(skin, joints);
+
+		std::vector<std::unique_ptr<LLVolumeFace> > faces;
+		for (U32 i = 0; i < BENCH_FACES_PER_AVATAR; ++i)
+		{
+			faces.emplace_back(new LLVolumeFace);
+			make_face(*faces.back(), BENCH_VERTICES_PER_FACE);
+		}
+		const U32 avatar_vertices = BENCH_FACES_PER_AVATAR * BENCH_VERTICES_PER_FACE;
+		Output out(BENCH_AVATARS * avatar_vertices);
+
+		// Every avatar wears the same mesh, each face of it skinned on its own
+		LLTimer timer;
+		for (U32 avatar = 0; avatar < BENCH_AVATARS; ++avatar)
+		{
+			for (U32 i = 0; i < BENCH_FACES_PER_AVATAR; ++i)
+			{
+				const U32 offset = avatar * avatar_vertices + i * BENCH_VERTICES_PER_FACE;
+				reference_skin(skin, joints.data(), *faces[i], &out.mPositions[offset], &out.mNormals[offset]);
+			}
+		}
+		F64 reference_time = timer.getElapsedTimeF64();
+
+		// A batch per avatar, then the whole crowd in one batch as
+		// LLDrawPoolAvatar makes it
+		LLSkinningBatch batch;
+		F64 batch_time[2];
+		U32 runs[2] = { 0, 0 };
+		for (U32 pass = 0; pass < 2; ++pass)
+		{
+			const bool per_avatar = pass == 0;
+			timer.reset();
+			for (U32 avatar = 0; avatar < BENCH_AVATARS; ++avatar)
+			{
+				U32 palette = batch.addPalette(&skin, nullptr, joints.data(), JOINT_COUNT);
+				for (U32 i = 0; i < BENCH_FACES_PER_AVATAR; ++i)
+				{
+					const U32 offset = avatar * avatar_vertices + i * BENCH_VERTICES_PER_FACE;
+					batch.addFace(*faces[i], palette, &out.mPositions[offset], &out.mNormals[offset]);
+				}
+				if (per_avatar || avatar == BENCH_AVATARS - 1)
+				{
+					runs[pass] = llmax(runs[pass], batch.getDefaultRuns());
+					batch.skin(batch.getDefaultRuns());
+					batch.clear();
+				}
+			}
+			batch_time[pass] = timer.getElapsedTimeF64();
+		}
+
+		LL_INFOS() << BENCH_AVATARS << " avatars of " << avatar_vertices
+				   << " vertices: per vertex " << reference_time * 1000.0
+				   << " ms, a batch per avatar on up to " << runs[0] << " threads " << batch_time[0] * 1000.0
+				   << " ms, one batch on " << runs[1] << " threads " << batch_time[1] * 1000.0
+				   << " ms" << LL_ENDL;
+	}
+}
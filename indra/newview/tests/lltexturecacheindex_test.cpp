@@ -0,0 +1,295 @@
+/**
+ * @file lltexturecacheindex_test.cpp
+ * @brief Test for lltexturecacheindex.cpp.
+ *
+ * $LicenseInfo:firstyear=2020&license=viewerlgpl$
+ * Alchemy Viewer Source Code
+ * Copyright (C) 2020, Alchemy Viewer Project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../lltexturecacheindex.h"
+
+#include "llfile.h"
+
+#include <vector>
+#include <boost/filesystem.hpp>
+
+namespace
+{
+	const std::string ENCODER("test encoder 1.0");
+	const U32 ADDRESS_SIZE = 64;
+	const U32 FULL_ENTRIES = 4096;
+}
+
+namespace tut
+{
+	struct texturecacheindex
+	{
+		texturecacheindex()
+		{
+			std::string base = (boost::filesystem::temp_directory_path()
+								/ boost::filesystem::unique_path("texture-%%%%-%%%%")).string();
+			mFilename = base + ".entries";
+			mCrashedFilename = base + ".crashed";
+		}
+
+		~texturecacheindex()
+		{
+			LLFile::remove(mFilename, ENOENT);
+			LLFile::remove(mCrashedFilename, ENOENT);
+		}
+
+		LLTextureCacheIndex::EOpenResult open(LLTextureCacheIndex& index, U32 max_entries, bool read_only = false,
+											  std::vector<LLUUID>* dropped = nullptr)
+		{
+			return index.open(mFilename, max_entries, ADDRESS_SIZE, ENCODER, read_only, dropped);
+		}
+
+		S32 add(LLTextureCacheIndex& index, const LLUUID& id, U32 time, S32 body_size)
+		{
+			S32 slot = index.insert(id, time);
+			if (slot >= 0)
+			{
+				index.setSizes(slot, body_size * 2, body_size);
+			}
+			return slot;
+		}
+
+		std::string mFilename;
+		std::string mCrashedFilename;
+		LLUUID mPending;
+	};
+	typedef test_group<texturecacheindex> texturecacheindex_t;
+	typedef texturecacheindex_t::object texturecacheindex_object_t;
+	tut::texturecacheindex_t tut_texturecacheindex("LLTextureCacheIndex");
+
+	template<> template<>
+	void texturecacheindex_object_t::test<1>()
+	{
+		set_test_name("insert, find, LRU order, remove");
+
+		LLTextureCacheIndex index;
+		ensure_equals("new index", open(index, 8), LLTextureCacheIndex::OPEN_CREATED);
+
+		std::vector<LLUUID> ids(8);
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			ids[i].generate();
+			ensure_equals("slot", add(index, ids[i], 100 + i, 1000), (S32)i);
+		}
+		ensure_equals("full", index.insert(LLUUID::generateNewID(), 200), -1);
+		ensure_equals("count", index.getNumEntries(), 8U);
+		ensure_equals("bytes", index.getBodyBytes(), (S64)8000);
+
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			ensure_equals("find", index.find(ids[i]), (S32)i);
+		}
+		ensure_equals("missing", index.find(LLUUID::generateNewID()), -1);
+
+		// Touching moves an entry to the new end of the LRU
+		ensure_equals("oldest", index.getOldest(), 0);
+		index.touch(0, 300);
+		ensure_equals("oldest after touch", index.getOldest(), 1);
+
+		index.remove(3);
+		ensure_equals("removed", index.find(ids[3]), -1);
+		ensure_equals("count after remove", index.getNumEntries(), 7U);
+		ensure_equals("bytes after remove", index.getBodyBytes(), (S64)7000);
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			if (i != 3)
+			{
+				ensure_equals("find after remove", index.find(ids[i]), (S32)i);
+			}
+		}
+
+		// The freed slot is handed out again
+		LLUUID replacement = LLUUID::generateNewID();
+		ensure_equals("reuse", index.insert(replacement, 400), 3);
+
+		std::vector<S32> order;
+		for (S32 slot = index.getOldest(); slot >= 0; slot = index.getNewer(slot))
+		{
+			order.push_back(slot);
+		}
+		const S32 expected[] = { 1, 2, 4, 5, 6, 7, 0, 3 };
+		ensure_equals("lru length", order.size(), (size_t)8);
+		for (U32 i = 0; i < order.size(); ++i)
+		{
+			ensure_equals("lru order", order[i], expected[i]);
+		}
+	}
+
+	template<> template<>
+	void texturecacheindex_object_t::test<2>()
+	{
+		set_test_name("clean reopen, crash recovery, corruption");
+
+		std::vector<LLUUID> ids(100);
+		{
+			LLTextureCacheIndex index;
+			open(index, 128);
+			for (U32 i = 0; i < ids.size(); ++i)
+			{
+				ids[i].generate();
+				add(index, ids[i], 1000 - i, 10 + i);
+			}
+			// Never gets sizes, must not survive a crash
+			mPending = LLUUID::generateNewID();
+			index.insert(mPending, 5000);
+			index.close();
+		}
+
+		{
+			LLTextureCacheIndex index;
+			ensure_equals("clean reopen", open(index, 128), LLTextureCacheIndex::OPEN_EXISTING);
+			ensure_equals("clean count", index.getNumEntries(), 101U);
+			index.remove(index.find(ids[99]));
+
+			LLTextureCacheIndex reader;
+			ensure_equals("read-only while dirty", open(reader, 128, true), LLTextureCacheIndex::OPEN_EXISTING);
+			ensure_equals("reader sees writer", reader.find(ids[0]), 0);
+			reader.close();
+
+			// A copy taken while the index is open looks like the file left behind by a crash
+			index.flush();
+			ensure("snapshot", LLFile::copy(mFilename, mCrashedFilename));
+		}
+
+		{
+			LLTextureCacheIndex recovered;
+			std::vector<LLUUID> dropped;
+			ensure_equals("dirty reopen", recovered.open(mCrashedFilename, 128, ADDRESS_SIZE, ENCODER, false, &dropped),
+						  LLTextureCacheIndex::OPEN_RECOVERED);
+			ensure_equals("recovered count", recovered.getNumEntries(), 99U);
+			ensure_equals("unfinished entry dropped", dropped.size(), (size_t)1);
+			ensure("dropped id", dropped[0] == mPending);
+			// Slots 99 (removed) and 100 (unfinished) are given back
+			ensure_equals("compacted", recovered.getHighWater(), 99U);
+			ensure_equals("removed entry stays removed", recovered.find(ids[99]), -1);
+			// Oldest by time is the last inserted surviving entry
+			ensure_equals("recovered lru", recovered.getOldest(), recovered.find(ids[98]));
+			S64 bytes = 0;
+			for (U32 i = 0; i < 99; ++i)
+			{
+				ensure("recovered find", recovered.find(ids[i]) >= 0);
+				bytes += 10 + i;
+			}
+			ensure_equals("recovered bytes", recovered.getBodyBytes(), bytes);
+			ensure_equals("reused from the end", add(recovered, LLUUID::generateNewID(), 6000, 1), 99);
+		}
+
+		// Damage a slot of the clean index, the index must start over
+		ensure("snapshot clean", LLFile::copy(mFilename, mCrashedFilename));
+		LLFILE* fp = LLFile::fopen(mCrashedFilename, "r+b");
+		ensure("reopen raw body", fp != nullptr);
+		fseek(fp, 200, SEEK_SET);
+		fputc(0x7f, fp);
+		LLFile::close(fp);
+
+		LLTextureCacheIndex damaged;
+		ensure_equals("corrupt body", damaged.open(mCrashedFilename, 128, ADDRESS_SIZE, ENCODER, false),
+					  LLTextureCacheIndex::OPEN_CREATED);
+		damaged.close();
+
+		// Damage the header, the index must start over
+		fp = LLFile::fopen(mFilename, "r+b");
+		ensure("reopen raw", fp != nullptr);
+		fseek(fp, 60, SEEK_SET);
+		fputc(0x7f, fp);
+		LLFile::close(fp);
+
+		LLTextureCacheIndex index;
+		ensure_equals("corrupt header", open(index, 128), LLTextureCacheIndex::OPEN_CREATED);
+		ensure_equals("corrupt count", index.getNumEntries(), 0U);
+	}
+
+	template<> template<>
+	void texturecacheindex_object_t::test<3>()
+	{
+		set_test_name("capacity change keeps slot numbers");
+
+		std::vector<LLUUID> ids(64);
+		{
+			LLTextureCacheIndex index;
+			open(index, 64);
+			for (U32 i = 0; i < ids.size(); ++i)
+			{
+				ids[i].generate();
+				add(index, ids[i], i, 1);
+			}
+		}
+
+		std::vector<LLUUID> dropped;
+		LLTextureCacheIndex index;
+		ensure_equals("shrink", open(index, 32, false, &dropped), LLTextureCacheIndex::OPEN_RECOVERED);
+		ensure_equals("dropped", dropped.size(), (size_t)32);
+		ensure_equals("kept", index.getNumEntries(), 32U);
+		for (U32 i = 0; i < 32; ++i)
+		{
+			ensure_equals("same slot", index.find(ids[i]), (S32)i);
+			ensure("dropped id", dropped[i] == ids[i + 32]);
+		}
+		index.close();
+
+		ensure_equals("grow", open(index, 256), LLTextureCacheIndex::OPEN_RECOVERED);
+		ensure_equals("grown max", index.getMaxEntries(), 256U);
+		ensure_equals("still there", index.find(ids[31]), 31);
+		ensure_equals("new slots", add(index, LLUUID::generateNewID(), 100, 1), 32);
+	}
+
+	template<> template<>
+	void texturecacheindex_object_t::test<4>()
+	{
+		set_test_name("LRU eviction at full capacity");
+
+		LLTextureCacheIndex index;
+		open(index, FULL_ENTRIES);
+
+		std::vector<LLUUID> ids(FULL_ENTRIES);
+		for (U32 i = 0; i < FULL_ENTRIES; ++i)
+		{
+			ids[i].generate();
+			add(index, ids[i], i, 1000);
+		}
+		for (U32 i = 0; i < FULL_ENTRIES; ++i)
+		{
+			ensure("found", index.find(ids[(i * 7919U) % FULL_ENTRIES]) >= 0);
+		}
+
+		// Steady state churn: every new texture evicts the least recently used one
+		for (U32 i = 0; i < FULL_ENTRIES; ++i)
+		{
+			S32 oldest = index.getOldest();
+			ensure_equals("evicts in insert order", index.getEntry(oldest)->mID, ids[i]);
+			index.remove(oldest);
+			add(index, LLUUID::generateNewID(), FULL_ENTRIES + i, 1000);
+		}
+		ensure_equals("still full", index.getNumEntries(), FULL_ENTRIES);
+
+		index.close();
+		ensure_equals("reopen", open(index, FULL_ENTRIES), LLTextureCacheIndex::OPEN_EXISTING);
+		ensure_equals("reopened full", index.getNumEntries(), FULL_ENTRIES);
+	}
+}
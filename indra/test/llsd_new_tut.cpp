@@ -30,8 +30,13 @@
 #include "linden_common.h"
 #include "lltut.h"
 
+#include "llformat.h"
+#include "llsdserialize.h"
 #include "llsdtraits.h"
 #include "llstring.h"
+#include "lltimer.h"
+
+#include <sstream>
 
 using std::fpclassify;
 
@@ -739,34 +744,34 @@ namespace tut
 		}
 		
 		{
-			SDAllocationCheck check("assign integer value", 1);
+			SDAllocationCheck check("assign integer value", 0);
 			LLSD v = 45;
 			v = 33;
 			v = 0;
 		}
 
 		{
-			SDAllocationCheck check("copy construct integer", 1);
+			SDAllocationCheck check("copy construct integer", 0);
 			LLSD v = 45;
 			LLSD w = v;
 		}
 
 		{
-			SDAllocationCheck check("assign integer", 1);
+			SDAllocationCheck check("assign integer", 0);
 			LLSD v = 45;
 			LLSD w;
 			w = v;
 		}
 		
 		{
-			SDAllocationCheck check("avoids extra clone", 2);
+			SDAllocationCheck check("avoids extra clone", 1);
 			LLSD v = 45;
 			LLSD w = v;
 			w = "nice day";
 		}
 
 		{
-			SDAllocationCheck check("shared values test for threaded work", 9);
+			SDAllocationCheck check("shared values test for threaded work", 4);
 
 			//U32 start_llsd_count = LLSD::outstandingCount();
 
@@ -774,7 +779,7 @@ namespace tut
 
 			m["one"] = 1;
 			m["two"] = 2;
-			m["one_copy"] = m["one"];			// 3 (m, "one" and "two")
+			m["one_copy"] = m["one"];			// 1 (m, the integers are inline)
 
 			m["undef_one"] = LLSD();
 			m["undef_two"] = LLSD();
@@ -784,16 +789,16 @@ namespace tut
 				LLSD first_array = LLSD::emptyArray();
 				first_array.append(1.0f);
 				first_array.append(2.0f);			
-				first_array.append(3.0f);			// 7
+				first_array.append(3.0f);			// 2
 
 				m["array"] = first_array;
 				m["array_clone"] = first_array;
-				m["array_copy"] = m["array"];		// 7
+				m["array_copy"] = m["array"];		// 2
 			}
 
 			m["string_one"] = "string one value";
 			m["string_two"] = "string two value";
-			m["string_one_copy"] = m["string_one"];		// 9
+			m["string_one_copy"] = m["string_one"];		// 4
 
 			//U32 llsd_object_count = LLSD::outstandingCount();
 			//std::cout << "Using " << (llsd_object_count - start_llsd_count) << " LLSD objects" << std::endl;
@@ -811,6 +816,127 @@ namespace tut
 		ensure("type is a string", v.isString());
 	}
 
+	template<> template<>
+	void SDTestObject::test<15>()
+		// inline scalars are values, not shared
+	{
+		SDCleanupCheck check;
+
+		{
+			SDAllocationCheck check("inline scalars", 0);
+			LLUUID id = LLUUID::generateNewID();
+			LLSD v = id;
+			LLSD w = v;
+			w = 12;
+			ensureTypeAndValue("copy keeps uuid", v, id);
+			ensureTypeAndValue("copy changed", w, 12);
+			ensure_equals("uuid as string", v.asString(), id.asString());
+
+			LLSD moved(std::move(w));
+			ensure("moved from", w.isUndefined());
+			ensureTypeAndValue("moved to", moved, 12);
+
+			v = 2.5;
+			ensure_equals("real as integer", v.asInteger(), 2);
+			v = false;
+			ensure_equals("false as string", v.asString(), std::string());
+		}
+
+		{
+			SDAllocationCheck check("inline value from own map", 2);
+			LLSD m;
+			m["one"] = 1;
+			m = m["one"];
+			ensureTypeAndValue("took member", m, 1);
+			m["two"] = 2;
+			m = std::move(m["two"]);
+			ensureTypeAndValue("took moved member", m, 2);
+		}
+	}
+
+	template<> template<>
+	void SDTestObject::test<16>()
+		// arena allocated documents
+	{
+		SDCleanupCheck check;
+
+		LLSD kept;
+		{
+			LLSDArena arena;
+			LLSD doc;
+			for (S32 i = 0; i < 5000; ++i)
+			{
+				doc[i]["name"] = llformat("item %d", i);
+				doc[i]["data"] = LLSD::Binary(16, (U8)i);
+			}
+			kept = doc[4321];
+		}
+		// The blocks stay until the last value made in them is gone
+		ensure_equals("kept name", kept["name"].asString(), std::string("item 4321"));
+		ensure_equals("kept data", kept["data"].asBinary().size(), (size_t)16);
+		kept["name"] = "renamed";
+		ensure_equals("modified after arena", kept["name"].asString(), std::string("renamed"));
+	}
+
+	template<> template<>
+	void SDTestObject::test<17>()
+		// allocations and parse time for a typical document
+	{
+		if (LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty())
+		{
+			skip("set LL_TEST_BENCHMARKS to time LLSD parsing");
+		}
+
+		const S32 ENTRIES = 2000;
+		const S32 PASSES = 20;
+
+		// Shaped like an inventory or object properties response
+		LLSD doc;
+		for (S32 i = 0; i < ENTRIES; ++i)
+		{
+			LLSD& entry = doc["items"][i];
+			entry["item_id"] = LLUUID::generateNewID();
+			entry["parent_id"] = LLUUID::generateNewID();
+			entry["name"] = llformat("Object %d", i);
+			entry["flags"] = i;
+			entry["sale_price"] = 10;
+			entry["for_sale"] = (i & 1) != 0;
+			entry["scale"] = 0.5 * i;
+			entry["permissions"]["owner_mask"] = 0x7fffffff;
+			entry["permissions"]["group_mask"] = 0;
+		}
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(doc, ostr);
+		const std::string binary = ostr.str();
+
+		S32 values = 0;
+		for (S32 i = 0; i < ENTRIES; ++i)
+		{
+			values += 1 + doc["items"][i].size() + doc["items"][i]["permissions"].size();
+		}
+
+		for (S32 use_arena = 0; use_arena < 2; ++use_arena)
+		{
+			U32 allocations = llsd::allocationCount();
+			LLTimer timer;
+			for (S32 pass = 0; pass < PASSES; ++pass)
+			{
+				LLSD parsed;
+				std::istringstream istr(binary);
+				LLPointer<LLSDBinaryParser> parser = new LLSDBinaryParser;
+				parser->setUseArena(use_arena != 0);
+				parser->parse(istr, parsed, binary.size());
+				ensure_equals("entries", parsed["items"].size(), ENTRIES);
+			}
+			F64 elapsed = timer.getElapsedTimeF64().value();
+			allocations = llsd::allocationCount() - allocations;
+
+			LL_INFOS() << "LLSD binary parse of " << values << " values " << (use_arena ? "with" : "without")
+					   << " arena: " << allocations / PASSES << " Impls, "
+					   << elapsed * 1.0e3 / PASSES << " ms" << LL_ENDL;
+		}
+	}
+
 	/* TO DO:
 		conversion of undefined to UUID, Date, URI and Binary
 		conversion of undefined to map and array
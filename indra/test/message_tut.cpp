@@ -34,6 +34,9 @@
 #include "llsdserialize.h"
 #include "message.h"
 #include "message_prehash.h"
+#include "net.h"
+#include "llstring.h"
+#include "lltimer.h"
 
 namespace
 {
@@ -48,6 +51,61 @@ namespace
 		virtual void extendedResult(S32 code, const LLSD& result, const LLSD& headers) { }
 		S32 mStatus;
 	};
+
+	void countTestMessage(LLMessageSystem*, void** user_data)
+	{
+		++*reinterpret_cast<S32*>(user_data);
+	}
+
+	void recordTestMessage(LLMessageSystem* msg, void** user_data)
+	{
+		U32 value = 0;
+		msg->getU32Fast(_PREHASH_TestBlock1, _PREHASH_Test1, value);
+		reinterpret_cast<std::vector<U32>*>(user_data)->push_back(value);
+	}
+
+	// A TestMessage packet carrying value, zero coded and with acks
+	// appended as asked
+	std::string makeTestPacket(U32 packet_id, U32 value, bool zero_coded, S32 acks)
+	{
+		std::string packet;
+		packet += (char)((zero_coded ? LL_ZERO_CODE_FLAG : 0) | (acks ? LL_ACK_FLAG : 0));
+		U32 id = htonl(packet_id);
+		packet.append((const char*)&id, sizeof(id));
+		packet += '\0';	// no extra header
+
+		// Low 1, then the U32 body
+		U8 body[8] = { 0xff, 0xff, 0x00, 0x01 };
+		memcpy(body + 4, &value, sizeof(value));
+		for (S32 i = 0; i < 8; ++i)
+		{
+			if (!zero_coded || body[i])
+			{
+				packet += (char)body[i];
+				continue;
+			}
+			// A run of zeroes is a zero and its length
+			S32 run = 0;
+			while (i + run < 8 && !body[i + run])
+			{
+				++run;
+			}
+			packet += '\0';
+			packet += (char)run;
+			i += run - 1;
+		}
+
+		for (S32 i = 0; i < acks; ++i)
+		{
+			U32 ack = htonl(packet_id + 100000 + i);
+			packet.append((const char*)&ack, sizeof(ack));
+		}
+		if (acks)
+		{
+			packet += (char)acks;
+		}
+		return packet;
+	}
 }
 
 namespace tut
@@ -127,6 +185,25 @@ namespace tut
 			}
 			file.close();
 		}
+
+		// Restarts the message system on port with a template that knows
+		// TestMessage
+		bool startWithTestMessage(U32 port)
+		{
+			std::string template_file(mTestConfigDir + mSep + "message_template.msg");
+			{
+				llofstream file(template_file.c_str());
+				file << "version 2.0\n"
+					 << "{\n\tTestMessage Low 1 NotTrusted Unencoded\n"
+					 << "\t{\n\t\tTestBlock1 Single\n\t\t{ Test1 U32 }\n\t}\n}\n";
+			}
+			delete static_cast<LLMessageSystem*>(gMessageSystem);
+			gMessageSystem = NULL;
+			bool started = start_messaging_system(template_file, port, 1, 0, 0, FALSE,
+												  "notasharedsecret", NULL, false, 5, 100);
+			LLFile::remove(template_file);
+			return started;
+		}
 	};
 	
 	typedef test_group<LLMessageSystemTestData>	LLMessageSystemTestGroup;
@@ -143,5 +220,167 @@ namespace tut
 		gMessageSystem->dispatch(name, message, response);
 		ensure_equals(response->mStatus, HTTP_NOT_FOUND);
 	}
-}
 
+	template<> template<>
+	void LLMessageSystemTestObject::test<2>()
+		// loopback replay through checkMessages with and without batched
+		// receives, timed in packets/sec when LL_TEST_BENCHMARKS is set
+	{
+		const bool benchmark = !LLStringUtil::getenv("LL_TEST_BENCHMARKS").empty();
+
+		ensure("messaging system started", startWithTestMessage(13036));
+
+		S32 handled = 0;
+		gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, countTestMessage, (void**)&handled);
+
+		S32 sender = -1;
+		int sender_port = NET_USE_OS_ASSIGNED_PORT;
+		ensure_equals("sender socket", start_net(sender, sender_port), 0);
+		U32 loopback = ip_string_to_u32(LOOPBACK_ADDRESS_STRING);
+		gMessageSystem->enableCircuit(LLHost(loopback, sender_port), FALSE);
+
+		// Bursts stay well inside the socket's receive buffer
+		const S32 BURST = 256;
+		const S32 BURSTS = benchmark ? 40 : 4;
+		const S32 PACKET_SIZE = 14;
+		std::vector<char> packets(BURST * PACKET_SIZE);
+		std::vector<LLNetDatagram> datagrams(BURST);
+		U32 packet_id = 0;
+
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			const BOOL batched = (pass == 1);
+			gMessageSystem->mPacketRing.setUseBatching(batched);
+			handled = 0;
+			F64 receive_time = 0.0;
+			for (S32 burst = 0; burst < BURSTS; ++burst)
+			{
+				for (S32 i = 0; i < BURST; ++i)
+				{
+					// flags, packet id, no extra header, Low 1, U32 body
+					char* packet = &packets[i * PACKET_SIZE];
+					U32 id = htonl(++packet_id);
+					U32 body = i;
+					packet[0] = 0;
+					memcpy(packet + 1, &id, sizeof(id));
+					packet[5] = 0;
+					packet[6] = (char)0xff;
+					packet[7] = (char)0xff;
+					packet[8] = 0;
+					packet[9] = 1;
+					memcpy(packet + 10, &body, sizeof(body));
+
+					datagrams[i].mData = packet;
+					datagrams[i].mSize = PACKET_SIZE;
+					datagrams[i].mAddress = loopback;
+					datagrams[i].mPort = gMessageSystem->getListenPort();
+				}
+				ensure("burst sent", send_packets(sender, &datagrams[0], BURST));
+
+				S32 wanted = (burst + 1) * BURST;
+				LLTimer timer;
+				S64 frame = 0;
+				while (handled < wanted && timer.getElapsedTimeF64().value() < 5.0)
+				{
+					gMessageSystem->checkMessages(++frame);
+				}
+				receive_time += timer.getElapsedTimeF64().value();
+			}
+			ensure_equals("every packet handled", handled, BURST * BURSTS);
+
+			if (benchmark)
+			{
+				LL_INFOS() << (batched ? "batched" : "single") << " receive: "
+						   << S32(BURST * BURSTS / receive_time) << " packets/sec" << LL_ENDL;
+			}
+		}
+
+		end_net(sender);
+	}
+
+	template<> template<>
+	void LLMessageSystemTestObject::test<3>()
+		// the decode thread dispatches the same messages as checkMessages
+		// decoding them inline
+	{
+		ensure("messaging system started", startWithTestMessage(13037));
+
+		std::vector<U32> handled;
+		gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, recordTestMessage, (void**)&handled);
+
+		S32 sender = -1;
+		int sender_port = NET_USE_OS_ASSIGNED_PORT;
+		ensure_equals("sender socket", start_net(sender, sender_port), 0);
+		U32 loopback = ip_string_to_u32(LOOPBACK_ADDRESS_STRING);
+		gMessageSystem->enableCircuit(LLHost(loopback, sender_port), FALSE);
+
+		// Plain, zero coded and with acks appended, with a packet too
+		// short and a message the template doesn't know among them
+		const S32 PACKETS = 200;
+		const S32 SHORT = 7;
+		const S32 UNKNOWN = 14;		// even, so not zero coded
+		std::vector<U32> expected;
+		for (S32 i = 0; i < PACKETS; ++i)
+		{
+			if (i % 50 != SHORT && i % 50 != UNKNOWN)
+			{
+				expected.push_back(i % 3 ? (i << 16) | i : 0);
+			}
+		}
+
+		std::vector<U32> results[2];
+		U32 packet_id = 0;
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			const bool threaded = (pass == 1);
+			if (threaded)
+			{
+				gMessageSystem->startDecodeThread();
+				ensure("decode thread started", gMessageSystem->isDecodeThreadRunning());
+			}
+
+			std::vector<std::string> packets;
+			for (S32 i = 0; i < PACKETS; ++i)
+			{
+				if (i % 50 == SHORT)
+				{
+					packets.push_back(std::string(3, '\0'));
+					continue;
+				}
+				std::string packet = makeTestPacket(++packet_id, i % 3 ? (i << 16) | i : 0,
+													i % 2 == 1, i % 4 == 2 ? i % 5 + 1 : 0);
+				if (i % 50 == UNKNOWN)
+				{
+					// Low 2
+					packet[9] = 2;
+				}
+				packets.push_back(packet);
+			}
+
+			std::vector<LLNetDatagram> datagrams(PACKETS);
+			for (S32 i = 0; i < PACKETS; ++i)
+			{
+				datagrams[i].mData = &packets[i][0];
+				datagrams[i].mSize = (S32)packets[i].size();
+				datagrams[i].mAddress = loopback;
+				datagrams[i].mPort = gMessageSystem->getListenPort();
+			}
+			ensure("stream sent", send_packets(sender, &datagrams[0], PACKETS));
+
+			handled.clear();
+			LLTimer timer;
+			S64 frame = 0;
+			while (handled.size() < expected.size() && timer.getElapsedTimeF64().value() < 5.0)
+			{
+				gMessageSystem->checkMessages(++frame);
+			}
+			results[pass] = handled;
+			gMessageSystem->stopDecodeThread();
+		}
+
+		ensure("inline dispatch", results[0] == expected);
+		ensure("threaded dispatch", results[1] == results[0]);
+
+		end_net(sender);
+	}
+}